@@ -57,6 +57,11 @@ where options are:
   --remote-shutdown
     shutdown the remote cartesi machine after the execution.
 
+  --remote-shared-memory
+    move cmio data and memory contents to and from the remote cartesi machine
+    through shared memory, instead of encoding them in JSON.
+    only works when the remote cartesi machine runs in the same host.
+
   --no-remote-create
     use existing cartesi machine in the remote server instead of creating
     a new one.
@@ -240,10 +245,61 @@ where options are:
         when omitted or defined as 0, the number of hardware threads is used if
         it can be identified or else a single thread is used.
 
+  --poll-backend=<backend>
+    selects how the host waits for events of VirtIO devices.
+
+    <backend> is one of
+        auto
+        select
+        epoll
+
+        auto (default)
+        uses epoll where available, select otherwise.
+
+        select
+        portable, but rescans every file descriptor on every poll and
+        cannot handle file descriptors past 1023.
+
+        epoll
+        keeps registrations in the kernel across polls (Linux only).
+
+  --console-output=<mode>[,<key>:<value>[,...]...]
+    selects where console output written by the guest goes.
+
+    <mode> is one of
+        direct
+        buffered
+        file
+
+        direct (default)
+        writes each character to stdout as soon as the guest writes it.
+
+        buffered
+        accumulates characters in a buffer that a background thread writes
+        to stdout in large chunks, so chatty guests do not slow down the run.
+
+        file
+        like buffered, but writes to the file given in filename.
+
+    <key>:<value> is one of
+        filename:<filename>
+        buffer_size:<number>
+
+        filename
+        file that receives console output in file mode.
+
+        buffer_size (optional)
+        size of output buffer in bytes (default: 1Mi).
+
   --htif-no-console-putchar
     suppress any console output during machine run.
     this includes anything written to machine's stdout or stderr.
 
+  --huge-pages
+    ask the host to back RAM and flash drives without image files with transparent
+    huge pages. whether it succeeded is reported by get_memory_ranges().
+    the machine state and its merkle tree are not affected.
+
   --skip-root-hash-check
     skip merkle tree root hash check when loading a stored machine.
     i.e., assume the stored machine files are not corrupt.
@@ -297,6 +353,22 @@ where options are:
 
     NON REPRODUCIBLE OPTION, DON'T USE THIS OPTION IN PRODUCTION
 
+  --virtio-blk=filename:<filename>[,read_only]
+    add a VirtIO block device backed by a host image file, whose length
+    must be a multiple of 512 bytes.
+    the guest sees the devices as /dev/vda, /dev/vdb, ... in the order
+    they were given, and can mount them using the following command:
+
+        busybox mount /dev/vda <mountpoint>
+
+    the host performs the device I/O asynchronously, so writes made by the
+    guest only reach the image file after the guest flushes them.
+
+    read_only (optional)
+    forbids the guest from writing to the image file.
+
+    NON REPRODUCIBLE OPTION, DON'T USE THIS OPTION IN PRODUCTION
+
   -v or --volume=<host_directory>:<guest_directory>
     like --virtio-9p, but also appends init commands to auto mount the
     host directory in the guest directory.
@@ -306,7 +378,7 @@ where options are:
 
     NON REPRODUCIBLE OPTION, DON'T USE THIS OPTION IN PRODUCTION
 
-  --virtio-net=<iface>
+  --virtio-net=<iface>[,queue_pairs:<number>]
     add a VirtIO network device using host TUN/TAP interface.
     this allows the use of the host network from inside the machine.
     this is more efficient and has fewer limitations than the user-space
@@ -335,6 +407,13 @@ where options are:
         busybox ip route add default via 10.0.2.2 dev eth0
         echo "nameserver 8.8.8.8" > /etc/resolv.conf
 
+    queue_pairs (optional)
+    number of receive/transmit queue pairs, from 1 to 8 (default: 1).
+    each pair is served by its own host thread and tap queue, so the guest
+    can spread network traffic across several CPUs.
+    more than one pair requires the tap interface to be created with the
+    multi_queue option (sudo ip tuntap add dev tap0 mode tap multi_queue).
+
     NON REPRODUCIBLE OPTION, DON'T USE THIS OPTION IN PRODUCTION
 
   --virtio-net=user
@@ -549,6 +628,7 @@ local remote_protocol = "jsonrpc"
 local remote_address
 local remote_fork = false
 local remote_shutdown = false
+local remote_shared_memory = false
 local remote_create = true
 local remote_destroy = true
 local perform_rollbacks = true
@@ -583,10 +663,15 @@ local cmio
 local cmio_advance
 local cmio_inspect
 local concurrency_update_merkle_tree = 0
+local poll_backend = "auto"
 local skip_root_hash_check = false
 local skip_root_hash_store = false
+local huge_pages = false
 local skip_version_check = false
 local htif_no_console_putchar = false
+local console_output_mode = "direct"
+local console_output_filename
+local console_output_buffer_size = 0
 local htif_console_getchar = false
 local htif_yield_automatic = true
 local htif_yield_manual = true
@@ -656,6 +741,19 @@ local function handle_virtio_9p(tag, host_directory)
     return true
 end
 
+local function handle_virtio_blk(all, opts)
+    if not opts then return false end
+    local b = util.parse_options(opts, {
+        filename = true,
+        read_only = true,
+    })
+    assert(type(b.filename) == "string", "missing virtio block image filename in " .. all)
+    assert(not b.read_only or b.read_only == true, "invalid virtio block read_only value in " .. all)
+    unreproducible = true
+    table.insert(virtio, { type = "blk", image_filename = b.filename, read_only = b.read_only or false })
+    return true
+end
+
 local function handle_volume_option(host_directory, guest_directory)
     if not host_directory or not guest_directory then return false end
     unreproducible = true
@@ -755,7 +853,14 @@ local function handle_virtio_net(mode, opts)
             table.insert(virtio, virtio_net_user_config)
         end
     else
-        table.insert(virtio, { type = "net-tuntap", iface = opts })
+        local queue_pairs = 1
+        if opts and opts ~= "" then
+            local t = util.parse_options(opts, {
+                queue_pairs = true,
+            })
+            queue_pairs = assert(util.parse_number(t.queue_pairs), "invalid virtio network queue_pairs in " .. opts)
+        end
+        table.insert(virtio, { type = "net-tuntap", iface = mode, queue_pairs = queue_pairs })
     end
     return true
 end
@@ -947,6 +1052,10 @@ local options = {
         "^%-%-virtio%-9p%=([%w_-]+):(.*)$",
         handle_virtio_9p,
     },
+    {
+        "^(%-%-virtio%-blk%=(.+))$",
+        handle_virtio_blk,
+    },
     {
         "^%-v%=([^:]+):(.*)$",
         handle_volume_option,
@@ -960,7 +1069,7 @@ local options = {
         handle_virtio_console,
     },
     {
-        "^%-%-virtio%-net%=([%w+]+),?([%w:,]*)$",
+        "^%-%-virtio%-net%=([%w+]+),?([%w_:,]*)$",
         handle_virtio_net,
     },
     {
@@ -1135,6 +1244,36 @@ local options = {
             return true
         end,
     },
+    {
+        "^%-%-poll%-backend%=(.+)$",
+        function(backend)
+            if not backend then return false end
+            assert(backend == "auto" or backend == "select" or backend == "epoll", "invalid poll backend " .. backend)
+            poll_backend = backend
+            return true
+        end,
+    },
+    {
+        "^%-%-console%-output%=([^,]+),?(.*)$",
+        function(mode, opts)
+            if not mode then return false end
+            assert(mode == "direct" or mode == "buffered" or mode == "file", "invalid console output mode " .. mode)
+            console_output_mode = mode
+            if opts ~= "" then
+                local c = util.parse_options(opts, {
+                    filename = true,
+                    buffer_size = true,
+                })
+                console_output_filename = c.filename
+                if c.buffer_size then
+                    console_output_buffer_size =
+                        assert(util.parse_number(c.buffer_size), "invalid console output buffer_size in " .. opts)
+                end
+            end
+            assert(mode ~= "file" or console_output_filename, "missing console output filename")
+            return true
+        end,
+    },
     {
         "^%-%-htif%-no%-console%-putchar$",
         function(all)
@@ -1151,6 +1290,14 @@ local options = {
             return true
         end,
     },
+    {
+        "^%-%-huge%-pages$",
+        function(all)
+            if not all then return false end
+            huge_pages = true
+            return true
+        end,
+    },
     {
         "^%-%-skip%-root%-hash%-store$",
         function(all)
@@ -1319,6 +1466,14 @@ local options = {
             return true
         end,
     },
+    {
+        "^%-%-remote%-shared%-memory$",
+        function(o)
+            if not o then return false end
+            remote_shared_memory = true
+            return true
+        end,
+    },
     {
         "^%-%-no%-remote%-create$",
         function(o)
@@ -1774,6 +1929,7 @@ if remote_address then
     local v = assert(remote.get_version())
     stderr("Connected: remote version is %d.%d.%d\n", v.major, v.minor, v.patch)
     if remote_fork then remote = assert(protocol.stub(remote.fork())) end
+    if remote_shared_memory then assert(remote.enable_shared_memory()) end
     local shutdown = function() remote.shutdown() end
     if remote_shutdown then
         setmetatable(remote_shutdown_deleter, {
@@ -1792,9 +1948,16 @@ local runtime = {
     htif = {
         no_console_putchar = htif_no_console_putchar,
     },
+    console = {
+        output_mode = console_output_mode,
+        output_filename = console_output_filename,
+        output_buffer_size = console_output_buffer_size,
+    },
     skip_root_hash_check = skip_root_hash_check,
     skip_root_hash_store = skip_root_hash_store,
     skip_version_check = skip_version_check,
+    poll_backend = poll_backend,
+    huge_pages = huge_pages,
 }
 
 local main_machine
@@ -97,7 +97,8 @@ static execute_status clint_write(void *context, i_device_state_access *a, uint6
             if (log2_size == 3) {
                 a->write_clint_mtimecmp(val);
                 a->reset_mip(MIP_MTIP_MASK);
-                return execute_status::success;
+                // The interpreter must compute the cycle of its next timer check again
+                return execute_status::success_and_serve_interrupts;
             }
             // partial mtimecmp is not supported
             return execute_status::failure;
@@ -320,6 +320,15 @@ static int jsonrpc_server_class_rebind(lua_State *L) {
     return 1;
 }
 
+/// \brief This is the enable_shared_memory method implementation.
+static int jsonrpc_server_class_enable_shared_memory(lua_State *L) {
+    auto &managed_jsonrpc_mg_mgr =
+        clua_check<clua_managed_cm_ptr<cm_jsonrpc_mg_mgr>>(L, lua_upvalueindex(1), lua_upvalueindex(2));
+    TRY_EXECUTE(cm_jsonrpc_enable_shared_memory(managed_jsonrpc_mg_mgr.get(), err_msg));
+    lua_pushnumber(L, 1);
+    return 1;
+}
+
 /// \brief This is the fork method implementation.
 static int jsonrpc_server_class_fork(lua_State *L) {
     auto &managed_jsonrpc_mg_mgr =
@@ -338,6 +347,7 @@ static const auto jsonrpc_server_static_methods = cartesi::clua_make_luaL_Reg_ar
     {"shutdown", jsonrpc_server_class_shutdown},
     {"fork", jsonrpc_server_class_fork},
     {"rebind", jsonrpc_server_class_rebind},
+    {"enable_shared_memory", jsonrpc_server_class_enable_shared_memory},
 });
 
 /// \brief This is the jsonrpc.stub() method implementation.
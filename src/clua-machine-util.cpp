@@ -152,8 +152,6 @@ static uint64_t opt_uint_field(lua_State *L, int tabidx, const char *field, uint
     return static_cast<uint64_t>(val);
 }
 
-// NOLINTNEXTLINE
-#if 0 // Unused
 /// \brief Returns an optional string field indexed by string in a table.
 /// \param L Lua state.
 /// \param tabidx Table stack index.
@@ -171,7 +169,6 @@ static std::string opt_string_field(lua_State *L, int tabidx, const char *field)
     lua_pop(L, 1);
     return str;
 }
-#endif
 
 /// \brief Returns an allocated optional c string field indexed by string in a table.
 /// \param L Lua state.
@@ -326,6 +323,46 @@ static CM_BRACKET_TYPE check_cm_bracket_type_field(lua_State *L, int tabidx, con
     }
 }
 
+/// \brief Returns an optional CM_POLL_BACKEND table field indexed by string in a table.
+/// \param L Lua state
+/// \param tabidx Table stack index
+/// \param field Field index
+/// \returns Corresponding CM_POLL_BACKEND, or CM_POLL_BACKEND_AUTO if missing
+static CM_POLL_BACKEND opt_cm_poll_backend_field(lua_State *L, int tabidx, const char *field) {
+    auto name = opt_string_field(L, tabidx, field);
+    if (name.empty() || name == "auto") {
+        return CM_POLL_BACKEND_AUTO;
+    } else if (name == "select") {
+        return CM_POLL_BACKEND_SELECT;
+    } else if (name == "epoll") {
+        return CM_POLL_BACKEND_EPOLL;
+    } else {
+        luaL_error(L, "invalid %s (expected poll backend)", field);
+        return CM_POLL_BACKEND_AUTO; // never reached
+    }
+}
+
+/// \brief Returns an optional CM_CONSOLE_OUTPUT_MODE table field indexed by string in a table.
+/// \param L Lua state
+/// \param tabidx Table stack index
+/// \param field Field index
+/// \returns Corresponding CM_CONSOLE_OUTPUT_MODE, or CM_CONSOLE_OUTPUT_DIRECT if missing
+static CM_CONSOLE_OUTPUT_MODE opt_cm_console_output_mode_field(lua_State *L, int tabidx, const char *field) {
+    auto name = opt_string_field(L, tabidx, field);
+    if (name.empty() || name == "direct") {
+        return CM_CONSOLE_OUTPUT_DIRECT;
+    } else if (name == "buffered") {
+        return CM_CONSOLE_OUTPUT_BUFFERED;
+    } else if (name == "file") {
+        return CM_CONSOLE_OUTPUT_FILE;
+    } else if (name == "memory") {
+        return CM_CONSOLE_OUTPUT_MEMORY;
+    } else {
+        luaL_error(L, "invalid %s (expected console output mode)", field);
+        return CM_CONSOLE_OUTPUT_DIRECT; // never reached
+    }
+}
+
 /// \brief Loads a cm_bracket_note from Lua
 /// \param L Lua state
 /// \param tabidx Bracket_note stack index
@@ -733,6 +770,7 @@ void clua_push_cm_memory_range_descr_array(lua_State *L, const cm_memory_range_d
         clua_setintegerfield(L, mrd.start, "start", -1);            // array config
         clua_setintegerfield(L, mrd.length, "length", -1);          // array config
         clua_setstringfield(L, mrd.description, "description", -1); // array config
+        clua_setbooleanfield(L, mrd.huge_pages, "huge_pages", -1);  // array config
         lua_rawseti(L, -2, i + 1);                                  // array
     }
 }
@@ -969,6 +1007,12 @@ static void push_cm_virtio_device_config(lua_State *L, const cm_virtio_device_co
         case CM_VIRTIO_DEVICE_NET_TUNTAP:
             clua_setstringfield(L, "net-tuntap", "type", -1);
             clua_setstringfield(L, v->device.net_tuntap.iface, "iface", -1);
+            clua_setintegerfield(L, v->device.net_tuntap.queue_pairs, "queue_pairs", -1);
+            break;
+        case CM_VIRTIO_DEVICE_BLK:
+            clua_setstringfield(L, "blk", "type", -1);
+            clua_setstringfield(L, v->device.blk.image_filename, "image_filename", -1);
+            clua_setbooleanfield(L, v->device.blk.read_only, "read_only", -1);
             break;
         default:
             luaL_error(L, "invalid virtio device config type");
@@ -1213,6 +1257,11 @@ cm_virtio_device_config *clua_check_cm_virtio_device_config(lua_State *L, int ta
     } else if (type == "net-tuntap") {
         m->type = CM_VIRTIO_DEVICE_NET_TUNTAP;
         m->device.net_tuntap.iface = opt_copy_string_field(L, tabidx, "iface");
+        m->device.net_tuntap.queue_pairs = opt_uint_field(L, tabidx, "queue_pairs", 1);
+    } else if (type == "blk") {
+        m->type = CM_VIRTIO_DEVICE_BLK;
+        m->device.blk.image_filename = opt_copy_string_field(L, tabidx, "image_filename");
+        m->device.blk.read_only = opt_boolean_field(L, tabidx, "read_only");
     } else {
         luaL_error(L, "invalid virtio device type '%s'", type.c_str());
     }
@@ -1487,6 +1536,20 @@ static void check_cm_htif_runtime_config(lua_State *L, int tabidx, cm_htif_runti
     lua_pop(L, 1);
 }
 
+/// \brief Loads C api console runtime config from Lua
+/// \param L Lua state
+/// \param tabidx Runtime config stack index
+/// \param c C api console runtime config structure to receive results
+static void check_cm_console_runtime_config(lua_State *L, int tabidx, cm_console_runtime_config *c) {
+    if (!opt_table_field(L, tabidx, "console")) {
+        return;
+    }
+    c->output_mode = opt_cm_console_output_mode_field(L, -1, "output_mode");
+    c->output_filename = opt_copy_string_field(L, -1, "output_filename");
+    c->output_buffer_size = opt_uint_field(L, -1, "output_buffer_size");
+    lua_pop(L, 1);
+}
+
 cm_machine_runtime_config *clua_check_cm_machine_runtime_config(lua_State *L, int tabidx, int ctxidx) {
     luaL_checktype(L, tabidx, LUA_TTABLE);
     auto &managed =
@@ -1494,10 +1557,13 @@ cm_machine_runtime_config *clua_check_cm_machine_runtime_config(lua_State *L, in
     cm_machine_runtime_config *config = managed.get();
     check_cm_concurrency_runtime_config(L, tabidx, &config->concurrency);
     check_cm_htif_runtime_config(L, tabidx, &config->htif);
+    check_cm_console_runtime_config(L, tabidx, &config->console);
     config->skip_root_hash_check = opt_boolean_field(L, tabidx, "skip_root_hash_check");
     config->skip_root_hash_store = opt_boolean_field(L, tabidx, "skip_root_hash_store");
     config->skip_version_check = opt_boolean_field(L, tabidx, "skip_version_check");
     config->soft_yield = opt_boolean_field(L, tabidx, "soft_yield");
+    config->poll_backend = opt_cm_poll_backend_field(L, tabidx, "poll_backend");
+    config->huge_pages = opt_boolean_field(L, tabidx, "huge_pages");
     managed.release();
     lua_pop(L, 1);
     return config;
@@ -0,0 +1,235 @@
+// Copyright Cartesi and individual authors (see AUTHORS)
+// SPDX-License-Identifier: LGPL-3.0-or-later
+//
+// This program is free software: you can redistribute it and/or modify it under
+// the terms of the GNU Lesser General Public License as published by the Free
+// Software Foundation, either version 3 of the License, or (at your option) any
+// later version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+// PARTICULAR PURPOSE. See the GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License along
+// with this program (see COPYING). If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+
+#include "console-output.h"
+#include "os.h"
+
+namespace cartesi {
+
+using namespace std::string_literals;
+
+console_output::console_output(const console_runtime_config &config) : m_mode{config.output_mode} {
+    if (m_mode == console_output_mode::direct) {
+        return;
+    }
+    const uint64_t buffer_size =
+        config.output_buffer_size != 0 ? config.output_buffer_size : CONSOLE_OUTPUT_BUFFER_SIZE_DEFAULT;
+    if (buffer_size > CONSOLE_OUTPUT_BUFFER_SIZE_MAX) {
+        throw std::invalid_argument{"console output buffer size is too large"};
+    }
+    switch (m_mode) {
+        case console_output_mode::buffered:
+            m_file = stdout;
+            break;
+        case console_output_mode::file:
+            if (config.output_filename.empty()) {
+                throw std::invalid_argument{"console output file name must be specified"};
+            }
+            m_file = fopen(config.output_filename.c_str(), "wb");
+            if (m_file == nullptr) {
+                throw std::system_error{errno, std::generic_category(),
+                    "could not open console output file '"s + config.output_filename + "'"s};
+            }
+            break;
+        case console_output_mode::memory:
+            break;
+        default:
+            throw std::invalid_argument{"invalid console output mode"};
+    }
+    m_ring.resize(buffer_size);
+#ifdef HAVE_THREADS
+    if (m_file != nullptr) {
+        try {
+            m_flusher = std::thread{&console_output::work, this};
+        } catch (...) {
+            if (m_mode == console_output_mode::file) {
+                (void) fclose(m_file);
+            }
+            throw;
+        }
+    }
+#endif
+}
+
+console_output::~console_output() {
+    if (m_file == nullptr) {
+        return;
+    }
+#ifdef HAVE_THREADS
+    {
+        const std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_data_cv.notify_one();
+    m_flusher.join();
+#endif
+    drain();
+    if (m_mode == console_output_mode::file) {
+        (void) fclose(m_file);
+    }
+}
+
+void console_output::push(const uint8_t *data, size_t length) {
+    const uint64_t capacity = m_ring.size();
+    const uint64_t tail = (m_head + m_size) % capacity;
+    const uint64_t first = std::min<uint64_t>(length, capacity - tail);
+    memcpy(m_ring.data() + tail, data, first);
+    memcpy(m_ring.data(), data + first, length - first);
+    m_size += length;
+}
+
+void console_output::write(const uint8_t *data, size_t length) {
+    if (m_mode == console_output_mode::direct) {
+        os_putchars(data, length);
+        return;
+    }
+    const uint64_t capacity = m_ring.size();
+#ifdef HAVE_THREADS
+    std::unique_lock<std::mutex> lock(m_mutex);
+#endif
+    if (m_mode == console_output_mode::memory) {
+        // Keep only the most recent characters
+        if (length > capacity) {
+            m_discarded += length - capacity;
+            data += length - capacity;
+            length = capacity;
+        }
+        const uint64_t overflow = m_size + length > capacity ? m_size + length - capacity : 0;
+        m_head = (m_head + overflow) % capacity;
+        m_size -= overflow;
+        m_discarded += overflow;
+        push(data, length);
+        return;
+    }
+    while (length > 0) {
+        const uint64_t room = capacity - m_size;
+        if (room == 0) {
+            // The ring is full, so we must wait for the flusher to catch up
+#ifdef HAVE_THREADS
+            m_data_cv.notify_one();
+            m_room_cv.wait(lock, [this, capacity] { return m_size < capacity; });
+#else
+            drain();
+#endif
+            continue;
+        }
+        const auto chunk = static_cast<size_t>(std::min<uint64_t>(room, length));
+        push(data, chunk);
+        data += chunk;
+        length -= chunk;
+    }
+#ifdef HAVE_THREADS
+    // Wake up the flusher early when the ring is filling up
+    if (m_size >= capacity / 2) {
+        m_data_cv.notify_one();
+    }
+#endif
+}
+
+void console_output::drain() {
+#ifdef HAVE_THREADS
+    const std::lock_guard<std::mutex> drain_lock(m_drain_mutex);
+    uint64_t head = 0;
+    uint64_t size = 0;
+    {
+        const std::lock_guard<std::mutex> lock(m_mutex);
+        head = m_head;
+        size = m_size;
+    }
+#else
+    uint64_t head = m_head;
+    uint64_t size = m_size;
+#endif
+    if (size == 0) {
+        return;
+    }
+    // Writers only ever append past the characters being drained, so they can proceed concurrently
+    const uint64_t capacity = m_ring.size();
+    while (size > 0) {
+        const uint64_t chunk = std::min(size, capacity - head);
+        (void) fwrite(m_ring.data() + head, 1, chunk, m_file);
+        head = (head + chunk) % capacity;
+        size -= chunk;
+        {
+#ifdef HAVE_THREADS
+            const std::lock_guard<std::mutex> lock(m_mutex);
+#endif
+            m_head = head;
+            m_size -= chunk;
+        }
+#ifdef HAVE_THREADS
+        m_room_cv.notify_all();
+#endif
+    }
+    (void) fflush(m_file);
+}
+
+void console_output::flush() {
+    if (m_file != nullptr) {
+        drain();
+    }
+}
+
+uint64_t console_output::read(uint8_t *data, uint64_t max_length) {
+    if (m_mode != console_output_mode::memory) {
+        return 0;
+    }
+#ifdef HAVE_THREADS
+    const std::lock_guard<std::mutex> lock(m_mutex);
+#endif
+    const uint64_t capacity = m_ring.size();
+    const uint64_t length = std::min(max_length, m_size);
+    const uint64_t first = std::min(length, capacity - m_head);
+    memcpy(data, m_ring.data() + m_head, first);
+    memcpy(data + first, m_ring.data(), length - first);
+    m_head = (m_head + length) % capacity;
+    m_size -= length;
+    return length;
+}
+
+uint64_t console_output::get_discarded() const {
+#ifdef HAVE_THREADS
+    const std::lock_guard<std::mutex> lock(m_mutex);
+#endif
+    return m_discarded;
+}
+
+#ifdef HAVE_THREADS
+void console_output::work() {
+    const uint64_t capacity = m_ring.size();
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (!m_stopping) {
+        // Sleep until there is something to write
+        m_data_cv.wait(lock, [this] { return m_stopping || m_size > 0; });
+        // Give writers some time to accumulate a larger chunk, unless the ring is filling up
+        m_data_cv.wait_for(lock, std::chrono::microseconds(CONSOLE_OUTPUT_FLUSH_INTERVAL_US),
+            [this, capacity] { return m_stopping || m_size >= capacity / 2; });
+        lock.unlock();
+        drain();
+        lock.lock();
+    }
+}
+#endif
+
+} // namespace cartesi
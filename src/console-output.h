@@ -0,0 +1,119 @@
+// Copyright Cartesi and individual authors (see AUTHORS)
+// SPDX-License-Identifier: LGPL-3.0-or-later
+//
+// This program is free software: you can redistribute it and/or modify it under
+// the terms of the GNU Lesser General Public License as published by the Free
+// Software Foundation, either version 3 of the License, or (at your option) any
+// later version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+// PARTICULAR PURPOSE. See the GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License along
+// with this program (see COPYING). If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef CONSOLE_OUTPUT_H
+#define CONSOLE_OUTPUT_H
+
+/// \file
+/// \brief Sink of guest console output
+
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+#include "os-features.h"
+
+#ifdef HAVE_THREADS
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#endif
+
+#include "machine-runtime-config.h"
+
+namespace cartesi {
+
+/// \brief Console output constants
+enum console_output_constants : uint64_t {
+    CONSOLE_OUTPUT_BUFFER_SIZE_DEFAULT = UINT64_C(1) << 20, ///< Size of ring buffer when none is configured
+    CONSOLE_OUTPUT_BUFFER_SIZE_MAX = UINT64_C(1) << 30,     ///< Maximum size of ring buffer
+    CONSOLE_OUTPUT_FLUSH_INTERVAL_US = 10000,               ///< Maximum time output waits in the buffer to be flushed
+};
+
+/// \brief Receives the characters written by the guest to the HTIF and VirtIO consoles
+/// \details In direct mode, characters go straight to the host stdout, as they always did. In the other modes,
+/// characters are appended to a ring buffer, so the interpreter never waits for the host. Buffered and file modes
+/// drain the ring from a background thread, which writes large chunks to stdout or to a file. Memory mode keeps the
+/// most recent output in the ring until the host reads it, discarding the oldest characters when it overflows.
+class console_output final {
+public:
+    /// \brief Constructor
+    /// \param config Console runtime configuration
+    explicit console_output(const console_runtime_config &config);
+    ~console_output();
+    console_output(const console_output &other) = delete;
+    console_output(console_output &&other) = delete;
+    console_output &operator=(const console_output &other) = delete;
+    console_output &operator=(console_output &&other) = delete;
+
+    /// \brief Writes characters to the console
+    void write(const uint8_t *data, size_t length);
+
+    /// \brief Writes a character to the console
+    void write(uint8_t ch) {
+        write(&ch, 1);
+    }
+
+    /// \brief Writes all buffered characters to their destination and waits for completion
+    /// \details Does nothing in direct and memory modes.
+    void flush();
+
+    /// \brief Moves captured characters out of the buffer, oldest first
+    /// \param data Receives the characters
+    /// \param max_length Maximum number of characters to move
+    /// \returns Number of characters moved
+    /// \details Only memory mode captures characters, in other modes this always returns 0.
+    uint64_t read(uint8_t *data, uint64_t max_length);
+
+    /// \brief Returns the number of characters memory mode discarded because the buffer was full
+    uint64_t get_discarded() const;
+
+    /// \brief Returns the output mode
+    console_output_mode get_mode() const {
+        return m_mode;
+    }
+
+private:
+    /// \brief Appends characters to the ring, which must have enough room for them
+    void push(const uint8_t *data, size_t length);
+
+    /// \brief Writes the characters that were in the ring when called to their destination
+    void drain();
+
+#ifdef HAVE_THREADS
+    /// \brief Flusher thread main loop.
+    void work();
+#endif
+
+    console_output_mode m_mode;        ///< Output mode
+    FILE *m_file{nullptr};             ///< Destination of buffered and file modes
+    std::vector<uint8_t> m_ring;       ///< Ring buffer
+    uint64_t m_head{0};                ///< Offset of the oldest character in the ring
+    uint64_t m_size{0};                ///< Number of characters in the ring
+    uint64_t m_discarded{0};           ///< Characters discarded by memory mode
+#ifdef HAVE_THREADS
+    mutable std::mutex m_mutex;        ///< Protects the ring state
+    std::mutex m_drain_mutex;          ///< Serializes drains, so characters are written in order
+    std::condition_variable m_data_cv; ///< Signals the flusher that the ring is filling up or must be flushed
+    std::condition_variable m_room_cv; ///< Signals writers that the flusher made room in the ring
+    std::thread m_flusher;             ///< Flusher thread
+    bool m_stopping{false};            ///< Whether the flusher must exit
+#endif
+};
+
+} // namespace cartesi
+
+#endif
@@ -147,6 +147,10 @@ private:
         return m_a.write_memory(paddr, data, length);
     }
 
+    unsigned char *do_get_host_memory(uint64_t paddr, uint64_t length, bool write) override {
+        return m_a.get_host_memory(paddr, length, write);
+    }
+
     uint64_t do_read_pma_istart(int p) override {
         return m_a.read_pma_istart(p);
     }
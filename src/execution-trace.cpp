@@ -0,0 +1,281 @@
+// Copyright Cartesi and individual authors (see AUTHORS)
+// SPDX-License-Identifier: LGPL-3.0-or-later
+//
+// This program is free software: you can redistribute it and/or modify it under
+// the terms of the GNU Lesser General Public License as published by the Free
+// Software Foundation, either version 3 of the License, or (at your option) any
+// later version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+// PARTICULAR PURPOSE. See the GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License along
+// with this program (see COPYING). If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include <stdexcept>
+#include <string>
+
+#include "execution-trace.h"
+#include "pma.h"
+
+namespace cartesi {
+
+using namespace std::string_literals;
+
+// The binary representation starts with a magic string and stores every integer as a LEB128 varint.
+// The mcycle of each event is stored as a delta from the previous event, so most events take a handful of bytes.
+static constexpr char execution_trace_magic[] = "CMXTRACE1";
+
+static void put_varint(std::string &out, uint64_t val) {
+    while (val >= 0x80) {
+        out.push_back(static_cast<char>((val & 0x7f) | 0x80));
+        val >>= 7;
+    }
+    out.push_back(static_cast<char>(val));
+}
+
+static uint64_t get_varint(const std::string &in, size_t &pos) {
+    uint64_t val = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        if (pos >= in.size()) {
+            throw std::invalid_argument{"truncated execution trace"};
+        }
+        const auto byte = static_cast<uint8_t>(in[pos++]);
+        val |= static_cast<uint64_t>(byte & 0x7f) << shift;
+        if ((byte & 0x80) == 0) {
+            return val;
+        }
+    }
+    throw std::invalid_argument{"invalid varint in execution trace"};
+}
+
+static std::string get_bytes(const std::string &in, size_t &pos, uint64_t length) {
+    if (length > in.size() - pos) {
+        throw std::invalid_argument{"truncated execution trace"};
+    }
+    std::string bytes = in.substr(pos, length);
+    pos += length;
+    return bytes;
+}
+
+std::string execution_trace::to_binary(void) const {
+    std::string out(execution_trace_magic, sizeof(execution_trace_magic) - 1);
+    put_varint(out, mcycle_begin);
+    put_varint(out, mcycle_end);
+    put_varint(out, mcycle_final);
+    put_varint(out, static_cast<uint64_t>(break_reason));
+    put_varint(out, events.size());
+    uint64_t mcycle = mcycle_begin;
+    for (const auto &event : events) {
+        put_varint(out, static_cast<uint64_t>(event.type));
+        put_varint(out, event.mcycle - mcycle);
+        mcycle = event.mcycle;
+        put_varint(out, static_cast<uint64_t>(event.log2_size));
+        put_varint(out, event.address);
+        put_varint(out, event.value);
+        put_varint(out, event.status);
+        put_varint(out, event.effects.size());
+        for (const auto &effect : event.effects) {
+            put_varint(out, static_cast<uint64_t>(effect.type));
+            put_varint(out, effect.value);
+            if (effect.type == execution_trace_effect_type::write_memory) {
+                put_varint(out, effect.data.size());
+                out.append(effect.data);
+            }
+        }
+    }
+    return out;
+}
+
+execution_trace execution_trace::from_binary(const std::string &bin) {
+    size_t pos = sizeof(execution_trace_magic) - 1;
+    if (bin.compare(0, pos, execution_trace_magic) != 0) {
+        throw std::invalid_argument{"invalid execution trace header"};
+    }
+    execution_trace trace;
+    trace.mcycle_begin = get_varint(bin, pos);
+    trace.mcycle_end = get_varint(bin, pos);
+    trace.mcycle_final = get_varint(bin, pos);
+    const uint64_t break_reason = get_varint(bin, pos);
+    if (break_reason > static_cast<uint64_t>(interpreter_break_reason::reached_break_condition)) {
+        throw std::invalid_argument{"invalid break reason in execution trace"};
+    }
+    trace.break_reason = static_cast<interpreter_break_reason>(break_reason);
+    // Every event takes several bytes, so a count larger than the remaining input is malformed
+    const uint64_t event_count = get_varint(bin, pos);
+    if (event_count > bin.size() - pos) {
+        throw std::invalid_argument{"truncated execution trace"};
+    }
+    trace.events.resize(event_count);
+    uint64_t mcycle = trace.mcycle_begin;
+    for (auto &event : trace.events) {
+        const uint64_t type = get_varint(bin, pos);
+        if (type > static_cast<uint64_t>(execution_trace_event_type::poll)) {
+            throw std::invalid_argument{"invalid event type in execution trace"};
+        }
+        event.type = static_cast<execution_trace_event_type>(type);
+        mcycle += get_varint(bin, pos);
+        event.mcycle = mcycle;
+        const uint64_t log2_size = get_varint(bin, pos);
+        if (log2_size > 3) {
+            throw std::invalid_argument{"invalid access size in execution trace"};
+        }
+        event.log2_size = static_cast<int>(log2_size);
+        event.address = get_varint(bin, pos);
+        event.value = get_varint(bin, pos);
+        event.status = get_varint(bin, pos);
+        const uint64_t effect_count = get_varint(bin, pos);
+        if (effect_count > bin.size() - pos) {
+            throw std::invalid_argument{"truncated execution trace"};
+        }
+        event.effects.resize(effect_count);
+        for (auto &effect : event.effects) {
+            const uint64_t effect_type = get_varint(bin, pos);
+            if (effect_type > static_cast<uint64_t>(execution_trace_effect_type::write_memory)) {
+                throw std::invalid_argument{"invalid effect type in execution trace"};
+            }
+            effect.type = static_cast<execution_trace_effect_type>(effect_type);
+            effect.value = get_varint(bin, pos);
+            if (effect.type == execution_trace_effect_type::write_memory) {
+                effect.data = get_bytes(bin, pos, get_varint(bin, pos));
+            }
+        }
+    }
+    if (pos != bin.size()) {
+        throw std::invalid_argument{"trailing data in execution trace"};
+    }
+    return trace;
+}
+
+/// \brief Applies the changes recorded for an event to the machine state
+static void apply_effects(i_device_state_access &da, const execution_trace_event &event) {
+    for (const auto &effect : event.effects) {
+        switch (effect.type) {
+            case execution_trace_effect_type::set_mip:
+                da.set_mip(effect.value);
+                break;
+            case execution_trace_effect_type::reset_mip:
+                da.reset_mip(effect.value);
+                break;
+            case execution_trace_effect_type::set_iflags_H:
+                da.set_iflags_H();
+                break;
+            case execution_trace_effect_type::set_iflags_Y:
+                da.set_iflags_Y();
+                break;
+            case execution_trace_effect_type::set_iflags_X:
+                da.set_iflags_X();
+                break;
+            case execution_trace_effect_type::write_clint_mtimecmp:
+                da.write_clint_mtimecmp(effect.value);
+                break;
+            case execution_trace_effect_type::write_plic_girqpend:
+                da.write_plic_girqpend(effect.value);
+                break;
+            case execution_trace_effect_type::write_plic_girqsrvd:
+                da.write_plic_girqsrvd(effect.value);
+                break;
+            case execution_trace_effect_type::write_htif_fromhost:
+                da.write_htif_fromhost(effect.value);
+                break;
+            case execution_trace_effect_type::write_htif_tohost:
+                da.write_htif_tohost(effect.value);
+                break;
+            case execution_trace_effect_type::write_memory:
+                // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+                if (!da.write_memory(effect.value, reinterpret_cast<const unsigned char *>(effect.data.data()),
+                        effect.data.size())) {
+                    throw std::runtime_error{"execution trace memory write failed"};
+                }
+                break;
+        }
+    }
+}
+
+bool execution_tracer::is_traced(const pma_entry &pma) {
+    const auto did = pma.get_istart_DID();
+    return did == PMA_ISTART_DID::VIRTIO || did == PMA_ISTART_DID::HTIF;
+}
+
+const execution_trace_event &execution_tracer::consume(execution_trace_event_type type, uint64_t mcycle,
+    uint64_t address) {
+    if (m_next >= m_trace.events.size()) {
+        throw std::runtime_error{"execution diverged from trace (trace exhausted at mcycle "s +
+            std::to_string(mcycle) + ")"s};
+    }
+    const auto &event = m_trace.events[m_next];
+    if (event.type != type || event.mcycle != mcycle || event.address != address) {
+        throw std::runtime_error{"execution diverged from trace at mcycle "s + std::to_string(mcycle)};
+    }
+    ++m_next;
+    return event;
+}
+
+bool execution_tracer::read_device(pma_entry &pma, i_device_state_access &da, uint64_t mcycle, uint64_t offset,
+    uint64_t *pval, int log2_size) {
+    const uint64_t paddr = pma.get_start() + offset;
+    if (is_replaying()) {
+        const auto &event = consume(execution_trace_event_type::read_device, mcycle, paddr);
+        if (event.log2_size != log2_size) {
+            throw std::runtime_error{"execution diverged from trace at mcycle "s + std::to_string(mcycle)};
+        }
+        apply_effects(da, event);
+        *pval = event.value;
+        return event.status != 0;
+    }
+    execution_trace_event event{execution_trace_event_type::read_device, log2_size, mcycle, paddr, 0, 0, {}};
+    recording_device_state_access rda(da, event.effects);
+    auto &device = pma.get_device_noexcept();
+    const bool status = device.get_driver()->read(device.get_context(), &rda, offset, pval, log2_size);
+    event.value = *pval;
+    event.status = status ? 1 : 0;
+    m_recorded->events.push_back(std::move(event));
+    return status;
+}
+
+execute_status execution_tracer::write_device(pma_entry &pma, i_device_state_access &da, uint64_t mcycle,
+    uint64_t offset, uint64_t val, int log2_size) {
+    const uint64_t paddr = pma.get_start() + offset;
+    if (is_replaying()) {
+        const auto &event = consume(execution_trace_event_type::write_device, mcycle, paddr);
+        if (event.log2_size != log2_size || event.value != val) {
+            throw std::runtime_error{"execution diverged from trace at mcycle "s + std::to_string(mcycle)};
+        }
+        apply_effects(da, event);
+        return static_cast<execute_status>(event.status);
+    }
+    execution_trace_event event{execution_trace_event_type::write_device, log2_size, mcycle, paddr, val, 0, {}};
+    recording_device_state_access rda(da, event.effects);
+    auto &device = pma.get_device_noexcept();
+    const execute_status status = device.get_driver()->write(device.get_context(), &rda, offset, val, log2_size);
+    event.status = static_cast<uint64_t>(status);
+    m_recorded->events.push_back(std::move(event));
+    return status;
+}
+
+void execution_tracer::record_poll(uint64_t mcycle, uint64_t mcycle_max, uint64_t next_mcycle,
+    std::vector<execution_trace_effect> &&effects) {
+    if (next_mcycle == mcycle && effects.empty()) {
+        return;
+    }
+    m_recorded->events.push_back(
+        {execution_trace_event_type::poll, 0, mcycle, mcycle_max, next_mcycle, 0, std::move(effects)});
+}
+
+uint64_t execution_tracer::replay_poll(i_device_state_access &da, uint64_t mcycle, uint64_t mcycle_max) {
+    // Polls that had no observable outcome were not recorded, so only consume the next event if it is ours
+    if (m_next >= m_trace.events.size()) {
+        return mcycle;
+    }
+    const auto &event = m_trace.events[m_next];
+    if (event.type != execution_trace_event_type::poll || event.mcycle != mcycle || event.address != mcycle_max) {
+        return mcycle;
+    }
+    ++m_next;
+    apply_effects(da, event);
+    return event.value;
+}
+
+} // namespace cartesi
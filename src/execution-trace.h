@@ -0,0 +1,297 @@
+// Copyright Cartesi and individual authors (see AUTHORS)
+// SPDX-License-Identifier: LGPL-3.0-or-later
+//
+// This program is free software: you can redistribute it and/or modify it under
+// the terms of the GNU Lesser General Public License as published by the Free
+// Software Foundation, either version 3 of the License, or (at your option) any
+// later version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+// PARTICULAR PURPOSE. See the GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License along
+// with this program (see COPYING). If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef EXECUTION_TRACE_H
+#define EXECUTION_TRACE_H
+
+/// \file
+/// \brief Trace of the nondeterministic events consumed by a machine run
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "i-device-state-access.h"
+#include "interpret.h"
+
+namespace cartesi {
+
+// Forward declarations
+class pma_entry;
+
+/// \brief Type of event kept in an execution trace
+enum class execution_trace_event_type : uint8_t {
+    read_device,  ///< Load from a device that interacts with the host
+    write_device, ///< Store to a device that interacts with the host
+    poll,         ///< Poll for external interrupts
+};
+
+/// \brief Type of change a device made to the machine state
+enum class execution_trace_effect_type : uint8_t {
+    set_mip,
+    reset_mip,
+    set_iflags_H,
+    set_iflags_Y,
+    set_iflags_X,
+    write_clint_mtimecmp,
+    write_plic_girqpend,
+    write_plic_girqsrvd,
+    write_htif_fromhost,
+    write_htif_tohost,
+    write_memory,
+};
+
+/// \brief Change a device made to the machine state while handling an event
+struct execution_trace_effect {
+    execution_trace_effect_type type{}; ///< Type of change
+    uint64_t value{0};                  ///< Mask, register value, or physical address of memory write
+    std::string data;                   ///< Data written to memory
+};
+
+/// \brief Nondeterministic event consumed by the interpreter
+struct execution_trace_event {
+    execution_trace_event_type type{};           ///< Type of event
+    int log2_size{0};                            ///< Log2 of size of device access
+    uint64_t mcycle{0};                          ///< Value of mcycle when the event happened
+    uint64_t address{0};                         ///< Physical address of device access, or mcycle limit of poll
+    uint64_t value{0};                           ///< Value loaded or stored, or mcycle after poll
+    uint64_t status{0};                          ///< Whether load succeeded, or execute_status of store
+    std::vector<execution_trace_effect> effects; ///< Changes made to the machine state
+};
+
+/// \brief Trace of the nondeterministic events consumed by a machine run
+/// \details Everything the interpreter does is a function of the machine state,
+/// except for the devices that interact with the host (VirtIO and HTIF) and the
+/// polling of external interrupts, which may also advance mcycle while waiting.
+/// The trace keeps only those events and the changes they made to the machine state,
+/// so the run can be re-executed on another machine that starts from the same state.
+struct execution_trace {
+    uint64_t mcycle_begin{0};                                                ///< Value of mcycle when the run started
+    uint64_t mcycle_end{0};                                                  ///< Target mcycle of the run
+    uint64_t mcycle_final{0};                                                ///< Value of mcycle when the run stopped
+    interpreter_break_reason break_reason{interpreter_break_reason::failed}; ///< Reason the run stopped
+    std::vector<execution_trace_event> events;                               ///< Events in the order they were consumed
+
+    /// \brief Encodes the trace into a compact binary representation
+    std::string to_binary(void) const;
+
+    /// \brief Decodes a trace from the binary representation produced by to_binary()
+    static execution_trace from_binary(const std::string &bin);
+};
+
+/// \brief Records or replays the events of an execution trace while the machine runs
+class execution_tracer {
+public:
+    /// \brief Constructs a tracer that serves events from devices and appends them to a trace
+    /// \param trace Trace to record into
+    explicit execution_tracer(execution_trace &trace) : m_trace(trace), m_recorded(&trace) {}
+
+    /// \brief Constructs a tracer that serves events from a trace, skipping devices and host polling
+    /// \param trace Trace to replay
+    explicit execution_tracer(const execution_trace &trace) : m_trace(trace), m_recorded(nullptr) {}
+
+    /// \brief Checks if the tracer is replaying a trace
+    bool is_replaying(void) const {
+        return m_recorded == nullptr;
+    }
+
+    /// \brief Checks if all events in the trace were consumed
+    bool is_done(void) const {
+        return m_next == m_trace.events.size();
+    }
+
+    /// \brief Checks if accesses to a device range must go through the tracer
+    static bool is_traced(const pma_entry &pma);
+
+    /// \brief Loads a value from a device, recording or replaying the load
+    bool read_device(pma_entry &pma, i_device_state_access &da, uint64_t mcycle, uint64_t offset, uint64_t *pval,
+        int log2_size);
+
+    /// \brief Stores a value to a device, recording or replaying the store
+    execute_status write_device(pma_entry &pma, i_device_state_access &da, uint64_t mcycle, uint64_t offset,
+        uint64_t val, int log2_size);
+
+    /// \brief Records a poll for external interrupts
+    /// \details Polls that did not advance mcycle nor change the machine state are omitted.
+    void record_poll(uint64_t mcycle, uint64_t mcycle_max, uint64_t next_mcycle,
+        std::vector<execution_trace_effect> &&effects);
+
+    /// \brief Replays a poll for external interrupts
+    /// \returns Value of mcycle after the poll
+    uint64_t replay_poll(i_device_state_access &da, uint64_t mcycle, uint64_t mcycle_max);
+
+private:
+    /// \brief Consumes the next event in the trace, making sure it matches the expected one
+    const execution_trace_event &consume(execution_trace_event_type type, uint64_t mcycle, uint64_t address);
+
+    const execution_trace &m_trace; // NOLINT(cppcoreguidelines-avoid-const-or-ref-data-members)
+    execution_trace *m_recorded;    ///< Trace receiving events, or nullptr when replaying
+    size_t m_next{0};               ///< Index of next event to replay
+};
+
+/// \brief Device state access that records every change a device makes to the machine state
+class recording_device_state_access final : public i_device_state_access {
+public:
+    /// \brief Constructor
+    /// \param da Device state access to forward to
+    /// \param effects Receives the changes made through this object
+    recording_device_state_access(i_device_state_access &da, std::vector<execution_trace_effect> &effects) :
+        m_da(da),
+        m_effects(effects) {}
+
+    /// \brief No copy constructor
+    recording_device_state_access(const recording_device_state_access &) = delete;
+    /// \brief No copy assignment
+    recording_device_state_access &operator=(const recording_device_state_access &) = delete;
+    /// \brief No move constructor
+    recording_device_state_access(recording_device_state_access &&) = delete;
+    /// \brief No move assignment
+    recording_device_state_access &operator=(recording_device_state_access &&) = delete;
+    /// \brief Default destructor
+    ~recording_device_state_access() override = default;
+
+private:
+    void record(execution_trace_effect_type type, uint64_t value) {
+        m_effects.push_back({type, value, {}});
+    }
+
+    void do_set_mip(uint64_t mask) override {
+        record(execution_trace_effect_type::set_mip, mask);
+        m_da.set_mip(mask);
+    }
+
+    void do_reset_mip(uint64_t mask) override {
+        record(execution_trace_effect_type::reset_mip, mask);
+        m_da.reset_mip(mask);
+    }
+
+    uint64_t do_read_mip(void) override {
+        return m_da.read_mip();
+    }
+
+    uint64_t do_read_mcycle(void) override {
+        return m_da.read_mcycle();
+    }
+
+    void do_set_iflags_H(void) override {
+        record(execution_trace_effect_type::set_iflags_H, 0);
+        m_da.set_iflags_H();
+    }
+
+    void do_set_iflags_Y(void) override {
+        record(execution_trace_effect_type::set_iflags_Y, 0);
+        m_da.set_iflags_Y();
+    }
+
+    void do_set_iflags_X(void) override {
+        record(execution_trace_effect_type::set_iflags_X, 0);
+        m_da.set_iflags_X();
+    }
+
+    uint64_t do_read_clint_mtimecmp(void) override {
+        return m_da.read_clint_mtimecmp();
+    }
+
+    void do_write_clint_mtimecmp(uint64_t val) override {
+        record(execution_trace_effect_type::write_clint_mtimecmp, val);
+        m_da.write_clint_mtimecmp(val);
+    }
+
+    uint64_t do_read_plic_girqpend(void) override {
+        return m_da.read_plic_girqpend();
+    }
+
+    void do_write_plic_girqpend(uint64_t val) override {
+        record(execution_trace_effect_type::write_plic_girqpend, val);
+        m_da.write_plic_girqpend(val);
+    }
+
+    uint64_t do_read_plic_girqsrvd(void) override {
+        return m_da.read_plic_girqsrvd();
+    }
+
+    void do_write_plic_girqsrvd(uint64_t val) override {
+        record(execution_trace_effect_type::write_plic_girqsrvd, val);
+        m_da.write_plic_girqsrvd(val);
+    }
+
+    uint64_t do_read_htif_fromhost(void) override {
+        return m_da.read_htif_fromhost();
+    }
+
+    void do_write_htif_fromhost(uint64_t val) override {
+        record(execution_trace_effect_type::write_htif_fromhost, val);
+        m_da.write_htif_fromhost(val);
+    }
+
+    uint64_t do_read_htif_tohost(void) override {
+        return m_da.read_htif_tohost();
+    }
+
+    void do_write_htif_tohost(uint64_t val) override {
+        record(execution_trace_effect_type::write_htif_tohost, val);
+        m_da.write_htif_tohost(val);
+    }
+
+    uint64_t do_read_htif_ihalt(void) override {
+        return m_da.read_htif_ihalt();
+    }
+
+    uint64_t do_read_htif_iconsole(void) override {
+        return m_da.read_htif_iconsole();
+    }
+
+    uint64_t do_read_htif_iyield(void) override {
+        return m_da.read_htif_iyield();
+    }
+
+    bool do_read_memory(uint64_t paddr, unsigned char *data, uint64_t length) override {
+        return m_da.read_memory(paddr, data, length);
+    }
+
+    bool do_write_memory(uint64_t paddr, const unsigned char *data, uint64_t length) override {
+        if (!m_da.write_memory(paddr, data, length)) {
+            return false;
+        }
+        // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+        m_effects.push_back({execution_trace_effect_type::write_memory, paddr,
+            std::string(reinterpret_cast<const char *>(data), length)});
+        return true;
+    }
+
+    unsigned char *do_get_host_memory(uint64_t paddr, uint64_t length, bool write) override {
+        // Writes through host pointers would escape the trace, so force devices to copy instead
+        (void) paddr;
+        (void) length;
+        (void) write;
+        return nullptr;
+    }
+
+    uint64_t do_read_pma_istart(int p) override {
+        return m_da.read_pma_istart(p);
+    }
+
+    uint64_t do_read_pma_ilength(int p) override {
+        return m_da.read_pma_ilength(p);
+    }
+
+    i_device_state_access &m_da;                   // NOLINT(cppcoreguidelines-avoid-const-or-ref-data-members)
+    std::vector<execution_trace_effect> &m_effects; // NOLINT(cppcoreguidelines-avoid-const-or-ref-data-members)
+};
+
+} // namespace cartesi
+
+#endif
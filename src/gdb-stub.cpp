@@ -0,0 +1,915 @@
+// Copyright Cartesi and individual authors (see AUTHORS)
+// SPDX-License-Identifier: LGPL-3.0-or-later
+//
+// This program is free software: you can redistribute it and/or modify it under
+// the terms of the GNU Lesser General Public License as published by the Free
+// Software Foundation, either version 3 of the License, or (at your option) any
+// later version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+// PARTICULAR PURPOSE. See the GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License along
+// with this program (see COPYING). If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <utility>
+
+#include "gdb-stub.h"
+#include "json-util.h"
+#include "os-features.h"
+#include "pma-constants.h"
+#include "shadow-state.h"
+
+#ifdef HAVE_SOCKETS
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+namespace cartesi {
+
+using namespace std::string_literals;
+
+/// \brief Signals reported to GDB when the machine stops
+enum gdb_signal : int {
+    GDB_SIGINT = 2,   ///< Reached end cycle set with the stepc and stepu monitor commands, or interrupted by GDB
+    GDB_SIGQUIT = 3,  ///< Reached end cycle of the session
+    GDB_SIGTRAP = 5,  ///< Reached breakpoint or watchpoint, finished single-step, or yielded
+    GDB_SIGTERM = 15, ///< Halted
+};
+
+/// \brief Number of cycles the machine runs before the stub checks whether GDB requested an interrupt
+static constexpr uint64_t GDB_STUB_RUN_SLICE = UINT64_C(1) << 22;
+
+/// \brief Maximum size of a packet exchanged with GDB
+static constexpr size_t GDB_STUB_PACKET_SIZE = 0x4000;
+
+/// \brief Character GDB sends to interrupt the machine while it runs
+static constexpr int GDB_INTERRUPT = 0x03;
+
+/// \brief Number of registers in the g and G packets: x0 to x31, and pc
+static constexpr int GDB_REG_COUNT = X_REG_COUNT + 1;
+
+/// \brief Encodes bytes as hexadecimal digits
+static std::string bytes_to_hex(const unsigned char *data, size_t length) {
+    static constexpr const char *digits = "0123456789abcdef";
+    std::string hex;
+    hex.reserve(2 * length);
+    for (size_t i = 0; i < length; ++i) {
+        hex.push_back(digits[data[i] >> 4]);
+        hex.push_back(digits[data[i] & 0xf]);
+    }
+    return hex;
+}
+
+/// \brief Decodes a single hexadecimal digit
+/// \returns Value of digit, or -1 if invalid
+static int hex_digit(char c) {
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    }
+    if (c >= 'a' && c <= 'f') {
+        return c - 'a' + 10;
+    }
+    if (c >= 'A' && c <= 'F') {
+        return c - 'A' + 10;
+    }
+    return -1;
+}
+
+/// \brief Decodes hexadecimal digits into bytes
+static std::string hex_to_bytes(const std::string &hex) {
+    if (hex.size() % 2 != 0) {
+        throw std::invalid_argument{"odd number of hexadecimal digits"};
+    }
+    std::string bytes;
+    bytes.reserve(hex.size() / 2);
+    for (size_t i = 0; i < hex.size(); i += 2) {
+        const int hi = hex_digit(hex[i]);
+        const int lo = hex_digit(hex[i + 1]);
+        if (hi < 0 || lo < 0) {
+            throw std::invalid_argument{"invalid hexadecimal digit"};
+        }
+        bytes.push_back(static_cast<char>((hi << 4) | lo));
+    }
+    return bytes;
+}
+
+/// \brief Parses a hexadecimal number
+static uint64_t parse_hex(const std::string &hex) {
+    if (hex.empty() || hex.size() > 16) {
+        throw std::invalid_argument{"invalid hexadecimal number"};
+    }
+    uint64_t val = 0;
+    for (const char c : hex) {
+        const int d = hex_digit(c);
+        if (d < 0) {
+            throw std::invalid_argument{"invalid hexadecimal digit"};
+        }
+        val = (val << 4) | static_cast<uint64_t>(d);
+    }
+    return val;
+}
+
+/// \brief Parses a number in C notation (decimal, or hexadecimal with a 0x prefix)
+static uint64_t parse_number(const std::string &s) {
+    size_t end = 0;
+    const uint64_t val = std::stoull(s, &end, 0);
+    if (end != s.size()) {
+        throw std::invalid_argument{"invalid number '"s + s + "'"s};
+    }
+    return val;
+}
+
+/// \brief Formats a number as hexadecimal digits without leading zeros
+static std::string number_to_hex(uint64_t val) {
+    std::ostringstream sout;
+    sout << std::hex << val;
+    return sout.str();
+}
+
+/// \brief Encodes a register value as GDB expects, in target byte order
+static std::string reg_to_hex(uint64_t val) {
+    std::array<unsigned char, sizeof(uint64_t)> bytes{};
+    for (auto &b : bytes) {
+        b = static_cast<unsigned char>(val);
+        val >>= 8;
+    }
+    return bytes_to_hex(bytes.data(), bytes.size());
+}
+
+/// \brief Decodes a register value sent by GDB in target byte order
+static uint64_t hex_to_reg(const std::string &hex) {
+    const std::string bytes = hex_to_bytes(hex);
+    if (bytes.size() != sizeof(uint64_t)) {
+        throw std::invalid_argument{"invalid register value"};
+    }
+    uint64_t val = 0;
+    for (auto it = bytes.rbegin(); it != bytes.rend(); ++it) {
+        val = (val << 8) | static_cast<unsigned char>(*it);
+    }
+    return val;
+}
+
+/// \brief Splits a string at the first occurrence of a separator
+static std::pair<std::string, std::string> split(const std::string &s, char sep) {
+    const auto pos = s.find(sep);
+    if (pos == std::string::npos) {
+        return {s, {}};
+    }
+    return {s.substr(0, pos), s.substr(pos + 1)};
+}
+
+/// \brief Checks if a string starts with a prefix
+static bool starts_with(const std::string &s, const char *prefix) {
+    return s.rfind(prefix, 0) == 0;
+}
+
+/// \brief Formats a stop reply with a signal
+static std::string stop_reply(int signal) {
+    const auto sig = static_cast<unsigned char>(signal);
+    return "S"s + bytes_to_hex(&sig, 1);
+}
+
+/// \brief Reads all registers in the g packet format
+/// \details Registers are read with a single peek of the shadow state, instead of one read per register.
+static std::string read_registers(machine &m) {
+    std::array<unsigned char, offsetof(shadow_state, pc) + sizeof(uint64_t)> regs{};
+    m.read_memory(PMA_SHADOW_STATE_START, regs.data(), regs.size());
+    return bytes_to_hex(regs.data(), X_REG_COUNT * sizeof(uint64_t)) +
+        bytes_to_hex(regs.data() + offsetof(shadow_state, pc), sizeof(uint64_t));
+}
+
+/// \brief Writes all registers from the G packet format
+static void write_registers(machine &m, const std::string &hex) {
+    constexpr size_t reg_hex_size = 2 * sizeof(uint64_t);
+    if (hex.size() < GDB_REG_COUNT * reg_hex_size) {
+        throw std::invalid_argument{"too few registers"};
+    }
+    for (int i = 1; i < X_REG_COUNT; ++i) {
+        m.write_x(i, hex_to_reg(hex.substr(i * reg_hex_size, reg_hex_size)));
+    }
+    m.write_pc(hex_to_reg(hex.substr(X_REG_COUNT * reg_hex_size, reg_hex_size)));
+}
+
+/// \brief Reads a register in GDB numbering: x0 to x31, pc, then f0 to f31
+static uint64_t read_register(machine &m, uint64_t reg) {
+    if (reg < X_REG_COUNT) {
+        return m.read_x(static_cast<int>(reg));
+    }
+    if (reg == X_REG_COUNT) {
+        return m.read_pc();
+    }
+    if (reg <= X_REG_COUNT + F_REG_COUNT) {
+        return m.read_f(static_cast<int>(reg - X_REG_COUNT - 1));
+    }
+    throw std::invalid_argument{"invalid register"};
+}
+
+/// \brief Writes a register in GDB numbering: x0 to x31, pc, then f0 to f31
+static void write_register(machine &m, uint64_t reg, uint64_t val) {
+    if (reg == 0) {
+        return; // x0 is hardwired to zero
+    }
+    if (reg < X_REG_COUNT) {
+        m.write_x(static_cast<int>(reg), val);
+    } else if (reg == X_REG_COUNT) {
+        m.write_pc(val);
+    } else if (reg <= X_REG_COUNT + F_REG_COUNT) {
+        m.write_f(static_cast<int>(reg - X_REG_COUNT - 1), val);
+    } else {
+        throw std::invalid_argument{"invalid register"};
+    }
+}
+
+/// \brief Parses the address and length of memory packets
+static std::pair<uint64_t, uint64_t> parse_address_length(const std::string &s) {
+    const auto [address, length] = split(s, ',');
+    return {parse_hex(address), parse_hex(length)};
+}
+
+#ifdef HAVE_SOCKETS
+
+/// \brief Sends all bytes to a socket
+static void send_all(int fd, const std::string &data) {
+#ifdef MSG_NOSIGNAL
+    constexpr int flags = MSG_NOSIGNAL;
+#else
+    constexpr int flags = 0;
+#endif
+    size_t sent = 0;
+    while (sent < data.size()) {
+        const auto n = send(fd, data.data() + sent, data.size() - sent, flags);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw std::system_error{errno, std::generic_category(), "failed sending to GDB"};
+        }
+        sent += static_cast<size_t>(n);
+    }
+}
+
+/// \brief Listens at an address for a single connection
+/// \param address Either <host>:<port> for TCP or unix:<path> for a Unix socket
+/// \param unix_path Receives the path of the Unix socket, or an empty string for TCP
+/// \returns Listening socket
+static int listen_at(const std::string &address, std::string &unix_path) {
+    int listen_fd = -1;
+    unix_path.clear();
+    if (starts_with(address, "unix:")) {
+        unix_path = address.substr(5);
+        sockaddr_un sa{};
+        if (unix_path.empty() || unix_path.size() >= sizeof(sa.sun_path)) {
+            throw std::invalid_argument{"invalid Unix socket path in GDB address '"s + address + "'"s};
+        }
+        sa.sun_family = AF_UNIX;
+        memcpy(sa.sun_path, unix_path.c_str(), unix_path.size() + 1);
+        listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (listen_fd < 0) {
+            throw std::system_error{errno, std::generic_category(), "failed creating GDB socket"};
+        }
+        // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+        if (bind(listen_fd, reinterpret_cast<sockaddr *>(&sa), sizeof(sa)) < 0 || listen(listen_fd, 1) < 0) {
+            const int errno_copy = errno;
+            close(listen_fd);
+            throw std::system_error{errno_copy, std::generic_category(),
+                "unable to listen at GDB address '"s + address + "'"s};
+        }
+    } else {
+        const auto colon = address.rfind(':');
+        if (colon == std::string::npos) {
+            throw std::invalid_argument{"missing port in GDB address '"s + address + "'"s};
+        }
+        std::string host = address.substr(0, colon);
+        const std::string port = address.substr(colon + 1);
+        if (host.size() >= 2 && host.front() == '[' && host.back() == ']') {
+            host = host.substr(1, host.size() - 2);
+        }
+        addrinfo hints{};
+        hints.ai_family = AF_UNSPEC;
+        hints.ai_socktype = SOCK_STREAM;
+        hints.ai_flags = AI_PASSIVE;
+        addrinfo *res = nullptr;
+        if (getaddrinfo(host.empty() ? nullptr : host.c_str(), port.c_str(), &hints, &res) != 0 || !res) {
+            throw std::invalid_argument{"unable to resolve GDB address '"s + address + "'"s};
+        }
+        const std::unique_ptr<addrinfo, decltype(&freeaddrinfo)> res_ptr{res, &freeaddrinfo};
+        int errno_copy = 0;
+        for (const auto *ai = res; ai && listen_fd < 0; ai = ai->ai_next) {
+            const int fd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+            if (fd < 0) {
+                errno_copy = errno;
+                continue;
+            }
+            const int yes = 1;
+            (void) setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes));
+            if (bind(fd, ai->ai_addr, ai->ai_addrlen) == 0 && listen(fd, 1) == 0) {
+                listen_fd = fd;
+            } else {
+                errno_copy = errno;
+                close(fd);
+            }
+        }
+        if (listen_fd < 0) {
+            throw std::system_error{errno_copy, std::generic_category(),
+                "unable to listen at GDB address '"s + address + "'"s};
+        }
+    }
+    return listen_fd;
+}
+
+/// \brief Checks, without blocking, if a socket has a pending connection
+static bool is_readable(int fd) {
+    pollfd pfd{fd, POLLIN, 0};
+    return poll(&pfd, 1, 0) > 0 && pfd.revents != 0;
+}
+
+#endif
+
+gdb_stub::~gdb_stub() {
+    close_session();
+}
+
+void gdb_stub::close_session(void) {
+#ifdef HAVE_SOCKETS
+    if (m_fd >= 0) {
+        close(m_fd);
+        m_fd = -1;
+    }
+    if (m_listen_fd >= 0) {
+        close(m_listen_fd);
+        m_listen_fd = -1;
+        if (!m_unix_path.empty()) {
+            unlink(m_unix_path.c_str());
+        }
+    }
+#endif
+    m_running = false;
+}
+
+void gdb_stub::serve(const std::string &address, uint64_t mcycle_end) {
+    listen(address, mcycle_end);
+#ifdef HAVE_SOCKETS
+    try {
+        while (serve_some()) {
+            const int fd = get_wait_fd();
+            if (fd >= 0) {
+                pollfd pfd{fd, POLLIN, 0};
+                while (poll(&pfd, 1, -1) < 0 && errno == EINTR) {
+                    ;
+                }
+            }
+        }
+    } catch (...) {
+        close_session();
+        throw;
+    }
+#endif
+}
+
+void gdb_stub::listen(const std::string &address, uint64_t mcycle_end) {
+#ifdef HAVE_SOCKETS
+    if (m_fd >= 0 || m_listen_fd >= 0) {
+        throw std::runtime_error{"GDB stub is already serving"};
+    }
+    m_listen_fd = listen_at(address, m_unix_path);
+    m_in.clear();
+    m_in_pos = 0;
+    m_packet_state = packet_state::idle;
+    m_unacked.clear();
+    m_noack = false;
+    m_mcycle_end = mcycle_end;
+    m_mcycle_limit = UINT64_MAX;
+    m_stop_reply = stop_reply(GDB_SIGTRAP);
+    m_running = false;
+    m_breakpoints.clear();
+    m_watchpoints.clear();
+#else
+    (void) address;
+    (void) mcycle_end;
+    throw std::runtime_error{"GDB stub is unsupported in this platform"};
+#endif
+}
+
+int gdb_stub::get_wait_fd(void) const {
+    if (m_fd < 0) {
+        return m_listen_fd;
+    }
+    if (m_running || m_in_pos < m_in.size()) {
+        return -1;
+    }
+    return m_fd;
+}
+
+bool gdb_stub::serve_some(void) {
+#ifdef HAVE_SOCKETS
+    if (m_fd < 0) {
+        if (m_listen_fd < 0) {
+            return false;
+        }
+        if (!is_readable(m_listen_fd)) {
+            return true;
+        }
+        int fd = -1;
+        do {
+            fd = accept(m_listen_fd, nullptr, nullptr);
+        } while (fd < 0 && errno == EINTR);
+        if (fd < 0) {
+            const int errno_copy = errno;
+            close_session();
+            throw std::system_error{errno_copy, std::generic_category(), "failed accepting GDB connection"};
+        }
+        // Only one GDB is served, so we can stop listening
+        close(m_listen_fd);
+        m_listen_fd = -1;
+        if (!m_unix_path.empty()) {
+            unlink(m_unix_path.c_str());
+        } else {
+            // Interactive sessions exchange many small packets
+            const int yes = 1;
+            (void) setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &yes, sizeof(yes));
+        }
+        m_fd = fd;
+        return true;
+    }
+    if (m_running) {
+        if (run_slice()) {
+            m_running = false;
+            send_packet(m_stop_reply);
+        }
+        return true;
+    }
+    // Packets may arrive in pieces, so only handle one once it is complete
+    std::string data;
+    if ((m_in_pos == m_in.size() && !recv_available()) || (recv_packet(data) && !handle_packet(data))) {
+        close_session();
+        return false;
+    }
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool gdb_stub::recv_available(void) {
+#ifdef HAVE_SOCKETS
+    m_in.erase(0, m_in_pos);
+    m_in_pos = 0;
+    std::array<char, 4096> buf{};
+    ssize_t n = 0;
+    do {
+        n = recv(m_fd, buf.data(), buf.size(), MSG_DONTWAIT);
+    } while (n < 0 && errno == EINTR);
+    if (n < 0) {
+        if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            return true;
+        }
+        throw std::system_error{errno, std::generic_category(), "failed receiving from GDB"};
+    }
+    m_in.append(buf.data(), static_cast<size_t>(n));
+    return n > 0;
+#else
+    return false;
+#endif
+}
+
+bool gdb_stub::recv_interrupt(void) {
+    if (m_in_pos == m_in.size() && !recv_available()) {
+        // Stop running also if GDB went away
+        return true;
+    }
+    while (m_in_pos < m_in.size()) {
+        const char c = m_in[m_in_pos];
+        if (c == GDB_INTERRUPT) {
+            ++m_in_pos;
+            return true;
+        }
+        if (c != '+' && c != '-') {
+            // Packets are handled once the machine stops
+            return false;
+        }
+        ++m_in_pos;
+        recv_ack(c);
+    }
+    return false;
+}
+
+void gdb_stub::recv_ack(char c) {
+    if (c == '+') {
+        m_unacked.clear();
+    } else if (!m_unacked.empty()) {
+#ifdef HAVE_SOCKETS
+        send_all(m_fd, m_unacked); // GDB requested retransmission
+#endif
+    }
+}
+
+void gdb_stub::send_ack(bool valid) {
+    if (!m_noack) {
+#ifdef HAVE_SOCKETS
+        send_all(m_fd, valid ? "+" : "-");
+#else
+        (void) valid;
+#endif
+    }
+}
+
+bool gdb_stub::recv_packet(std::string &data) {
+    while (m_in_pos < m_in.size()) {
+        const char c = m_in[m_in_pos++];
+        switch (m_packet_state) {
+            case packet_state::idle:
+                // Interrupts mean nothing while the machine is stopped
+                if (c == '$') {
+                    m_packet.clear();
+                    m_packet_sum = 0;
+                    m_packet_state = packet_state::data;
+                } else if (c == '+' || c == '-') {
+                    recv_ack(c);
+                }
+                break;
+            case packet_state::data:
+                if (c == '#') {
+                    m_packet_state = packet_state::checksum_hi;
+                } else if (m_packet.size() >= GDB_STUB_PACKET_SIZE) {
+                    // GDB exceeded the packet size we advertised, so reject the packet instead of buffering it
+                    send_ack(false);
+                    m_packet.clear();
+                    m_packet_state = packet_state::discard;
+                } else {
+                    m_packet.push_back(c);
+                    m_packet_sum += static_cast<unsigned char>(c);
+                }
+                break;
+            case packet_state::discard:
+                // The checksum digits that follow are skipped while idle
+                if (c == '#') {
+                    m_packet_state = packet_state::idle;
+                }
+                break;
+            case packet_state::checksum_hi:
+                m_packet_checksum_hi = hex_digit(c);
+                m_packet_state = packet_state::checksum_lo;
+                break;
+            case packet_state::checksum_lo: {
+                m_packet_state = packet_state::idle;
+                const int lo = hex_digit(c);
+                if (m_packet_checksum_hi < 0 || lo < 0 ||
+                    static_cast<unsigned>((m_packet_checksum_hi << 4) | lo) != (m_packet_sum & 0xff)) {
+                    send_ack(false); // request retransmission
+                    break;
+                }
+                send_ack(true);
+                data.clear();
+                for (size_t i = 0; i < m_packet.size(); ++i) {
+                    if (m_packet[i] == '}' && i + 1 < m_packet.size()) {
+                        data.push_back(static_cast<char>(m_packet[++i] ^ 0x20));
+                    } else {
+                        data.push_back(m_packet[i]);
+                    }
+                }
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+void gdb_stub::send_packet(const std::string &data) {
+    std::string packet{"$"};
+    packet.reserve(data.size() + 4);
+    unsigned sum = 0;
+    for (char c : data) {
+        if (c == '#' || c == '$' || c == '}' || c == '*') {
+            packet.push_back('}');
+            sum += '}';
+            c = static_cast<char>(c ^ 0x20);
+        }
+        packet.push_back(c);
+        sum += static_cast<unsigned char>(c);
+    }
+    const auto checksum = static_cast<unsigned char>(sum);
+    packet += "#"s + bytes_to_hex(&checksum, 1);
+#ifdef HAVE_SOCKETS
+    send_all(m_fd, packet);
+#endif
+    // The acknowledgment is handled when it arrives, so the stub never waits for it
+    if (!m_noack) {
+        m_unacked = std::move(packet);
+    }
+}
+
+void gdb_stub::send_output(const std::string &text) {
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+    send_packet("O"s + bytes_to_hex(reinterpret_cast<const unsigned char *>(text.data()), text.size()));
+}
+
+bool gdb_stub::handle_packet(const std::string &data) {
+    if (data.empty()) {
+        send_packet("");
+        return true;
+    }
+    const char type = data[0];
+    const std::string payload = data.substr(1);
+    if (type == 'D') { // GDB is detaching
+        send_packet("OK");
+        return false;
+    }
+    if (type == 'k') { // GDB is killing the session, and expects no reply
+        return false;
+    }
+    if (starts_with(data, "vKill")) {
+        send_packet("OK");
+        return false;
+    }
+    if (data == "QStartNoAckMode") { // acknowledgments are redundant over a reliable stream
+        send_packet("OK");
+        m_noack = true;
+        return true;
+    }
+    std::string reply;
+    try {
+        switch (type) {
+            case '?':
+                reply = m_stop_reply;
+                break;
+            case '!':
+            case 'H':
+            case 'T':
+                reply = "OK";
+                break;
+            case 'g':
+                reply = read_registers(m_m);
+                break;
+            case 'G':
+                write_registers(m_m, payload);
+                reply = "OK";
+                break;
+            case 'p':
+                reply = reg_to_hex(read_register(m_m, parse_hex(payload)));
+                break;
+            case 'P': {
+                const auto [reg, val] = split(payload, '=');
+                write_register(m_m, parse_hex(reg), hex_to_reg(val));
+                reply = "OK";
+                break;
+            }
+            case 'm': {
+                const auto [address, length] = parse_address_length(payload);
+                std::string mem(std::min<uint64_t>(length, GDB_STUB_PACKET_SIZE / 2), '\0');
+                // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+                auto *mem_data = reinterpret_cast<unsigned char *>(mem.data());
+                m_m.read_virtual_memory(address, mem_data, mem.size());
+                reply = bytes_to_hex(mem_data, mem.size());
+                break;
+            }
+            case 'M':
+            case 'X': {
+                const auto [address_length, contents] = split(payload, ':');
+                const auto [address, length] = parse_address_length(address_length);
+                const std::string mem = type == 'M' ? hex_to_bytes(contents) : contents;
+                if (mem.size() != length) {
+                    throw std::invalid_argument{"memory length mismatch"};
+                }
+                // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+                m_m.write_virtual_memory(address, reinterpret_cast<const unsigned char *>(mem.data()), mem.size());
+                reply = "OK";
+                break;
+            }
+            case 'c':
+            case 's':
+                if (!payload.empty()) {
+                    m_m.write_pc(parse_hex(payload));
+                }
+                if (resume(type == 's')) {
+                    // The stop reply is sent when the machine stops
+                    return true;
+                }
+                reply = m_stop_reply;
+                break;
+            case 'C':
+            case 'S': {
+                // Signals mean nothing to the machine, so only the resume address is used
+                const auto address = split(payload, ';').second;
+                if (!address.empty()) {
+                    m_m.write_pc(parse_hex(address));
+                }
+                if (resume(type == 'S')) {
+                    return true;
+                }
+                reply = m_stop_reply;
+                break;
+            }
+            case 'Z':
+            case 'z':
+                reply = handle_break_condition(payload, type == 'Z');
+                break;
+            case 'q':
+                reply = handle_query(data);
+                break;
+            default: // unsupported packets get an empty reply, including vMustReplyEmpty and vCont?
+                break;
+        }
+    } catch (const std::exception &) {
+        // GDB may access invalid addresses while debugging
+        reply = "E01";
+    }
+    send_packet(reply);
+    return true;
+}
+
+std::string gdb_stub::handle_query(const std::string &query) {
+    if (starts_with(query, "qSupported")) {
+        return "PacketSize="s + number_to_hex(GDB_STUB_PACKET_SIZE) + ";QStartNoAckMode+;hwbreak+"s;
+    }
+    if (query == "qAttached") { // we are attached to an existing machine
+        return "1";
+    }
+    if (query == "qSymbol::") { // we do not need symbol lookups
+        return "OK";
+    }
+    if (starts_with(query, "qRcmd,")) {
+        return handle_monitor_command(hex_to_bytes(query.substr(6)));
+    }
+    return "";
+}
+
+std::string gdb_stub::handle_monitor_command(const std::string &command) {
+    const auto [name, arg] = split(command, ' ');
+    std::ostringstream sout;
+    try {
+        if (name == "help") {
+            sout << "stepc <n>            limit continue to <n> cycles\n"
+                    "stepu <mcycle>       limit continue up to cycle <mcycle>\n"
+                    "stepc_clear          remove cycle limit\n"
+                    "cycles               print current cycle\n"
+                    "csr <name>[=<value>] print or modify a CSR\n"
+                    "hash                 print root hash of machine state\n"
+                    "store <dir>          store machine state in <dir>\n"
+                    "breakpc <address>    toggle breakpoint at <address>\n";
+        } else if (name == "stepc") {
+            const uint64_t mcycle = m_m.read_mcycle();
+            const uint64_t n = parse_number(arg);
+            m_mcycle_limit = n > UINT64_MAX - mcycle ? UINT64_MAX : mcycle + n;
+        } else if (name == "stepu") {
+            m_mcycle_limit = std::max(m_m.read_mcycle(), parse_number(arg));
+        } else if (command == "stepc_clear") {
+            m_mcycle_limit = UINT64_MAX;
+        } else if (command == "cycles") {
+            sout << m_m.read_mcycle() << '\n';
+        } else if (name == "csr" && !arg.empty()) {
+            const auto [csr_name, val] = split(arg, '=');
+            machine::csr csr{};
+            ju_get_opt_field(nlohmann::json{{"csr", csr_name}}, "csr"s, csr);
+            if (arg.find('=') != std::string::npos) {
+                m_m.write_csr(csr, parse_number(val));
+                sout << csr_name << " = ";
+            }
+            const uint64_t csr_val = m_m.read_csr(csr);
+            sout << "0x" << std::hex << csr_val << std::dec << " (" << csr_val << ")\n";
+        } else if (command == "hash") {
+            machine_merkle_tree::hash_type hash;
+            m_m.get_root_hash(hash);
+            sout << m_m.read_mcycle() << ": " << bytes_to_hex(hash.data(), hash.size()) << '\n';
+        } else if (name == "store" && !arg.empty()) {
+            m_m.store(arg);
+            sout << "machine state stored to \"" << arg << "\"\n";
+        } else if (name == "breakpc" && !arg.empty()) {
+            const uint64_t pc = parse_number(arg);
+            const auto it = std::find(m_breakpoints.begin(), m_breakpoints.end(), pc);
+            if (it != m_breakpoints.end()) {
+                m_breakpoints.erase(it);
+                sout << "disabled PC breakpoint at 0x" << std::hex << pc << '\n';
+            } else {
+                handle_break_condition("0,"s + number_to_hex(pc) + ",4"s, true);
+                sout << "enabled PC breakpoint at 0x" << std::hex << pc << '\n';
+            }
+        } else {
+            return "";
+        }
+    } catch (const std::exception &e) {
+        sout << "ERROR: " << e.what() << '\n';
+    }
+    if (!sout.str().empty()) {
+        send_output(sout.str());
+    }
+    return "OK";
+}
+
+std::string gdb_stub::handle_break_condition(const std::string &payload, bool insert) {
+    // Payload is type,address,kind optionally followed by ;conditions, which we ignore
+    const auto [type, rest] = split(split(payload, ';').first, ',');
+    const auto [address_hex, kind_hex] = split(rest, ',');
+    const uint64_t address = parse_hex(address_hex);
+    const uint64_t kind = parse_hex(kind_hex);
+    machine_break_conditions conditions;
+    if (type == "0" || type == "1") { // software and hardware breakpoints are the same to us
+        conditions.breakpoints.push_back(address);
+    } else if (type == "2" || type == "3" || type == "4") { // write, read, and access watchpoints
+        conditions.watchpoints.push_back(machine_watchpoint{address, kind, true, type != "2", type != "3"});
+    } else {
+        return "";
+    }
+    if (insert) {
+        // Reject conditions the interpreter would refuse when GDB inserts them, instead of when it resumes
+        const break_condition_monitor validate{conditions, 0};
+        (void) validate;
+        m_breakpoints.insert(m_breakpoints.end(), conditions.breakpoints.begin(), conditions.breakpoints.end());
+        m_watchpoints.insert(m_watchpoints.end(), conditions.watchpoints.begin(), conditions.watchpoints.end());
+    } else if (!conditions.breakpoints.empty()) {
+        const auto it = std::find(m_breakpoints.begin(), m_breakpoints.end(), address);
+        if (it != m_breakpoints.end()) {
+            m_breakpoints.erase(it);
+        }
+    } else {
+        const auto &w = conditions.watchpoints.front();
+        const auto it = std::find_if(m_watchpoints.begin(), m_watchpoints.end(), [&w](const auto &other) {
+            return other.start == w.start && other.length == w.length && other.read == w.read &&
+                other.write == w.write;
+        });
+        if (it != m_watchpoints.end()) {
+            m_watchpoints.erase(it);
+        }
+    }
+    return "OK";
+}
+
+bool gdb_stub::resume(bool single_step) {
+    const uint64_t mcycle_begin = m_m.read_mcycle();
+    const uint64_t mcycle_end = std::min(m_mcycle_end, m_mcycle_limit);
+    if (mcycle_begin >= mcycle_end) {
+        m_stop_reply = stop_reply(mcycle_end == m_mcycle_end ? GDB_SIGQUIT : GDB_SIGINT);
+        return false;
+    }
+    m_single_step = single_step;
+    m_resume_mcycle_begin = mcycle_begin;
+    m_resume_mcycle_end = single_step ? mcycle_begin + 1 : mcycle_end;
+    m_running = true;
+    return true;
+}
+
+bool gdb_stub::run_slice(void) {
+    uint64_t mcycle = m_m.read_mcycle();
+    // Each run ignores breakpoints where it starts, so we check the ones between slices ourselves
+    if (mcycle != m_resume_mcycle_begin &&
+        std::find(m_breakpoints.begin(), m_breakpoints.end(), m_m.read_pc()) != m_breakpoints.end()) {
+        m_stop_reply = stop_reply(GDB_SIGTRAP);
+        return true;
+    }
+    const uint64_t mcycle_end = m_resume_mcycle_end;
+    const uint64_t slice_end = mcycle_end - mcycle > GDB_STUB_RUN_SLICE ? mcycle + GDB_STUB_RUN_SLICE : mcycle_end;
+    const machine_break_conditions conditions{m_breakpoints, m_watchpoints, {}};
+    machine_break_event event;
+    const auto reason = m_m.run_until(slice_end, conditions, event);
+    mcycle = m_m.read_mcycle();
+    if (reason == interpreter_break_reason::reached_target_mcycle ||
+        reason == interpreter_break_reason::yielded_softly) {
+        if (mcycle < mcycle_end) {
+            if (recv_interrupt()) {
+                m_stop_reply = stop_reply(GDB_SIGINT);
+                return true;
+            }
+            return false;
+        }
+        if (m_single_step) {
+            m_stop_reply = stop_reply(GDB_SIGTRAP);
+        } else {
+            m_stop_reply = stop_reply(mcycle == m_mcycle_end ? GDB_SIGQUIT : GDB_SIGINT);
+        }
+    } else if (reason == interpreter_break_reason::reached_break_condition &&
+        event.type == machine_break_event_type::watchpoint) {
+        const auto &w = m_watchpoints[event.index];
+        const char *kind = !w.read ? "watch" : (!w.write ? "rwatch" : "awatch");
+        m_stop_reply = "T"s + stop_reply(GDB_SIGTRAP).substr(1) + kind + ":"s + number_to_hex(event.address) + ";"s;
+    } else if (reason == interpreter_break_reason::halted) {
+        m_stop_reply = stop_reply(GDB_SIGTERM);
+    } else if (reason == interpreter_break_reason::yielded_manually) {
+        send_output("machine yielded manually\n");
+        m_stop_reply = stop_reply(GDB_SIGTRAP);
+    } else if (reason == interpreter_break_reason::yielded_automatically) {
+        send_output("machine yielded automatically\n");
+        m_stop_reply = stop_reply(GDB_SIGTRAP);
+    } else {
+        m_stop_reply = stop_reply(GDB_SIGTRAP);
+    }
+    return true;
+}
+
+} // namespace cartesi
@@ -0,0 +1,158 @@
+// Copyright Cartesi and individual authors (see AUTHORS)
+// SPDX-License-Identifier: LGPL-3.0-or-later
+//
+// This program is free software: you can redistribute it and/or modify it under
+// the terms of the GNU Lesser General Public License as published by the Free
+// Software Foundation, either version 3 of the License, or (at your option) any
+// later version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+// PARTICULAR PURPOSE. See the GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License along
+// with this program (see COPYING). If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef GDB_STUB_H
+#define GDB_STUB_H
+
+/// \file
+/// \brief GDB Remote Serial Protocol stub
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "machine-break-conditions.h"
+
+namespace cartesi {
+
+/// \brief GDB Remote Serial Protocol stub serving a machine
+/// \details Continue and single-step requests are served with machine::run_until(), so breakpoints and
+/// watchpoints are checked by the interpreter itself and the machine runs at full speed between them.
+/// The machine runs in slices, between which the stub checks whether GDB requested an interrupt.
+/// The stub never waits for GDB inside serve_some(), so a server can drive it from its own event loop.
+class gdb_stub {
+public:
+    /// \brief Constructor
+    /// \param m Machine to serve
+    explicit gdb_stub(machine &m) : m_m(m) {}
+
+    /// \brief No copy constructor
+    gdb_stub(const gdb_stub &) = delete;
+    /// \brief No copy assignment
+    gdb_stub &operator=(const gdb_stub &) = delete;
+    /// \brief No move constructor
+    gdb_stub(gdb_stub &&) = delete;
+    /// \brief No move assignment
+    gdb_stub &operator=(gdb_stub &&) = delete;
+
+    /// \brief Destructor closes the connection, if any
+    ~gdb_stub();
+
+    /// \brief Waits for GDB to connect and serves it until it detaches or kills the session
+    /// \param address Address to listen at, either <host>:<port> for TCP or unix:<path> for a Unix socket
+    /// \param mcycle_end End cycle for continue and single-step requests
+    void serve(const std::string &address, uint64_t mcycle_end);
+
+    /// \brief Starts listening for GDB, without waiting for it to connect
+    /// \param address Address to listen at, either <host>:<port> for TCP or unix:<path> for a Unix socket
+    /// \param mcycle_end End cycle for continue and single-step requests
+    void listen(const std::string &address, uint64_t mcycle_end);
+
+    /// \brief Returns the socket to wait on for input before calling serve_some()
+    /// \returns The listening socket until GDB connects, then the connection with GDB, or -1 when serve_some()
+    /// has work to do right away, because the machine is running or input is already buffered
+    int get_wait_fd(void) const;
+
+    /// \brief Accepts GDB, handles one packet it sent, or runs the machine for one slice, without waiting for GDB
+    /// \returns False once GDB detached or killed the session, and the connection was closed
+    bool serve_some(void);
+
+private:
+    /// \brief State of the packet being received from GDB
+    enum class packet_state {
+        idle,        ///< Waiting for the start of a packet
+        data,        ///< Receiving packet data
+        discard,     ///< Skipping the data of a packet that is too large
+        checksum_hi, ///< Receiving the first checksum digit
+        checksum_lo, ///< Receiving the second checksum digit
+    };
+
+    /// \brief Receives, without blocking, bytes GDB already sent
+    /// \returns False if GDB closed the connection
+    bool recv_available(void);
+
+    /// \brief Checks, without blocking, if GDB sent an interrupt request
+    bool recv_interrupt(void);
+
+    /// \brief Handles an acknowledgment of the last packet sent to GDB
+    void recv_ack(char c);
+
+    /// \brief Acknowledges a packet received from GDB, unless acknowledgments are disabled
+    /// \param valid False to request retransmission
+    void send_ack(bool valid);
+
+    /// \brief Consumes received bytes until a whole packet from GDB was received
+    /// \param data Receives the packet data
+    /// \returns True if a packet was received, false if all bytes were consumed before that
+    bool recv_packet(std::string &data);
+
+    /// \brief Sends a packet to GDB
+    void send_packet(const std::string &data);
+
+    /// \brief Sends text to be printed by GDB
+    void send_output(const std::string &text);
+
+    /// \brief Handles a packet received from GDB
+    /// \returns False if the session ended
+    bool handle_packet(const std::string &data);
+
+    /// \brief Handles a query packet
+    std::string handle_query(const std::string &query);
+
+    /// \brief Handles a monitor command
+    std::string handle_monitor_command(const std::string &command);
+
+    /// \brief Handles the insertion or removal of a breakpoint or watchpoint
+    std::string handle_break_condition(const std::string &payload, bool insert);
+
+    /// \brief Resumes the machine, which then runs in slices from serve_some() until it stops
+    /// \param single_step True to execute a single instruction
+    /// \returns False if the machine cannot run, in which case m_stop_reply is the reply to send to GDB
+    bool resume(bool single_step);
+
+    /// \brief Runs the resumed machine for one slice
+    /// \returns True if the machine stopped, in which case m_stop_reply is the reply to send to GDB
+    bool run_slice(void);
+
+    /// \brief Closes the connection with GDB and the listening socket, if any
+    void close_session(void);
+
+    machine &m_m;                                    // NOLINT(cppcoreguidelines-avoid-const-or-ref-data-members)
+    int m_listen_fd{-1};                             ///< Socket listening for GDB until it connects
+    std::string m_unix_path;                         ///< Path of Unix socket listening for GDB, if any
+    int m_fd{-1};                                    ///< Connection with GDB
+    std::string m_in;                                ///< Bytes received from GDB but not consumed yet
+    size_t m_in_pos{0};                              ///< Position of next byte to consume in m_in
+    packet_state m_packet_state{packet_state::idle}; ///< State of the packet being received
+    std::string m_packet;                            ///< Data of the packet being received, still escaped
+    unsigned m_packet_sum{0};                        ///< Checksum of m_packet
+    int m_packet_checksum_hi{0};                     ///< First checksum digit of the packet being received
+    std::string m_unacked;                           ///< Last packet sent, until GDB acknowledges it
+    bool m_noack{false};                             ///< True if GDB disabled packet acknowledgments
+    uint64_t m_mcycle_end{0};                        ///< End cycle for continue and single-step requests
+    uint64_t m_mcycle_limit{UINT64_MAX};             ///< End cycle set with the stepc and stepu monitor commands
+    std::string m_stop_reply{"S05"};                 ///< Reply to last continue or single-step request
+    bool m_running{false};                           ///< True while a continue or single-step request runs
+    bool m_single_step{false};                       ///< True if the running request is a single-step
+    uint64_t m_resume_mcycle_begin{0};               ///< Value of mcycle when the running request started
+    uint64_t m_resume_mcycle_end{0};                 ///< End cycle of the running request
+    std::vector<uint64_t> m_breakpoints;             ///< Breakpoints inserted by GDB
+    std::vector<machine_watchpoint> m_watchpoints;   ///< Watchpoints inserted by GDB
+};
+
+} // namespace cartesi
+
+#endif
@@ -28,7 +28,7 @@ static bool htif_peek(const pma_entry &pma, const machine &m, uint64_t page_offs
     return (page_offset % PMA_PAGE_SIZE) == 0 && page_offset < pma.get_length();
 }
 
-pma_entry make_htif_pma_entry(uint64_t start, uint64_t length, htif_runtime_config *context) {
+pma_entry make_htif_pma_entry(uint64_t start, uint64_t length, htif_context *context) {
     const pma_entry::flags f{
         true,                // R
         true,                // W
@@ -19,13 +19,13 @@
 
 #include <cstdint>
 
-#include "machine-runtime-config.h"
+#include "htif.h"
 #include "pma.h"
 
 namespace cartesi {
 
 /// \brief Creates a PMA entry for the HTIF device
-pma_entry make_htif_pma_entry(uint64_t start, uint64_t length, htif_runtime_config *context);
+pma_entry make_htif_pma_entry(uint64_t start, uint64_t length, htif_context *context);
 
 } // namespace cartesi
 
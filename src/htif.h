@@ -32,6 +32,15 @@ namespace cartesi {
 extern const pma_driver htif_driver;
 
 // Forward declarations
+struct htif_runtime_config;
+class console_output;
+
+/// \brief HTIF device context
+struct htif_context {
+    const htif_runtime_config *runtime_config; ///< HTIF runtime configuration
+    console_output *console;                   ///< Receives characters written to the console
+};
+
 /// \brief HTIF shifts
 enum HTIF_shifts {
     HTIF_DEV_SHIFT = HTIF_DEV_SHIFT_DEF,
@@ -190,6 +190,19 @@ public:
         return do_write_memory(paddr, data, length);
     }
 
+    /// \brief Obtains a host pointer to a memory PMA range, for direct access.
+    /// \param paddr Target physical address.
+    /// \param length Size of range.
+    /// \param write True if the range will be written to through the pointer.
+    /// \returns Pointer to the start of the range in host memory, or nullptr if direct access is unavailable.
+    /// \details The entire range must fit inside the same memory PMA range, otherwise it fails.
+    /// When \p write is true, all pages in range are marked dirty before returning.
+    /// Callers must fall back to read_memory() or write_memory() when it returns nullptr.
+    /// The pointer is only valid until the machine state is next modified by other means.
+    unsigned char *get_host_memory(uint64_t paddr, uint64_t length, bool write) {
+        return do_get_host_memory(paddr, length, write);
+    }
+
     /// \brief Reads the istart field of a PMA entry
     /// \param p Index of PMA
     uint64_t read_pma_istart(int p) {
@@ -225,6 +238,7 @@ private:
     virtual uint64_t do_read_htif_iyield(void) = 0;
     virtual bool do_read_memory(uint64_t paddr, unsigned char *data, uint64_t length) = 0;
     virtual bool do_write_memory(uint64_t paddr, const unsigned char *data, uint64_t length) = 0;
+    virtual unsigned char *do_get_host_memory(uint64_t paddr, uint64_t length, bool write) = 0;
     virtual uint64_t do_read_pma_istart(int p) = 0;
     virtual uint64_t do_read_pma_ilength(int p) = 0;
 };
@@ -20,6 +20,7 @@
 /// \file
 /// \brief Hasher interface
 
+#include <algorithm>
 #include <array>
 #include <cstddef>
 #include <cstdint>
@@ -133,6 +134,82 @@ inline static void get_merkle_tree_hash(H &h, const unsigned char *data, uint64_
     }
 }
 
+/// \brief  Computes the merkle tree hash of a pristine (all zeros) buffer
+/// \tparam H Hasher class
+/// \param h Hasher object
+/// \param length Length of buffer
+/// \param word_length  Length of each word
+/// \param result Receives the resulting merkle tree hash
+template <typename H>
+inline static void get_pristine_merkle_tree_hash(H &h, uint64_t length, uint64_t word_length,
+    typename H::hash_type &result) {
+    const uint64_t words = word_length != 0 ? length / word_length : 0;
+    if (words == 0 || words * word_length != length || (words & (words - 1)) != 0) {
+        throw std::invalid_argument("length must be a power of 2 multiple of word_length");
+    }
+    const unsigned char zero = 0;
+    h.begin();
+    for (uint64_t i = 0; i < word_length; ++i) {
+        h.add_data(&zero, 1);
+    }
+    h.end(result);
+    for (uint64_t l = word_length; l < length; l <<= 1) {
+        h.begin();
+        h.add_data(result.data(), result.size());
+        h.add_data(result.data(), result.size());
+        h.end(result);
+    }
+}
+
+/// \brief  Computes the merkle tree hash of a data buffer padded with zeros
+/// \tparam H Hasher class
+/// \param h Hasher object
+/// \param data Data to be hashed
+/// \param data_length Length of data
+/// \param padded_length Length of data after padding, a power of 2 multiple of word_length
+/// \param word_length  Length of each word
+/// \param result Receives the resulting merkle tree hash
+/// \details Only subtrees that overlap the data are hashed word by word. Subtrees that fall entirely in the padding
+/// use pristine hashes, so the cost depends on data_length rather than on padded_length.
+template <typename H>
+inline static void get_padded_merkle_tree_hash(H &h, const unsigned char *data, uint64_t data_length,
+    uint64_t padded_length, uint64_t word_length, typename H::hash_type &result) {
+    if (data_length > padded_length) {
+        throw std::invalid_argument("data_length must not exceed padded_length");
+    }
+    if (data_length == padded_length) {
+        get_merkle_tree_hash(h, data, data_length, word_length, result);
+    } else if (data_length == 0) {
+        get_pristine_merkle_tree_hash(h, padded_length, word_length, result);
+    } else if (padded_length > word_length) {
+        if (padded_length & 1) {
+            throw std::invalid_argument("padded_length must be a power of 2 multiple of word_length");
+        }
+        padded_length = padded_length / 2;
+        typename H::hash_type left;
+        const uint64_t left_length = std::min(data_length, padded_length);
+        get_padded_merkle_tree_hash(h, data, left_length, padded_length, word_length, left);
+        get_padded_merkle_tree_hash(h, data + left_length, data_length - left_length, padded_length, word_length,
+            result);
+        h.begin();
+        h.add_data(left.data(), left.size());
+        h.add_data(result.data(), result.size());
+        h.end(result);
+    } else {
+        if (padded_length != word_length) {
+            throw std::invalid_argument("padded_length must be a power of 2 multiple of word_length");
+        }
+        // Partial word
+        const unsigned char zero = 0;
+        h.begin();
+        h.add_data(data, data_length);
+        for (uint64_t i = data_length; i < word_length; ++i) {
+            h.add_data(&zero, 1);
+        }
+        h.end(result);
+    }
+}
+
 } // namespace cartesi
 
 #endif
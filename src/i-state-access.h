@@ -668,6 +668,17 @@ public:
         return derived().do_write_memory(paddr, data, length);
     }
 
+    /// \brief Obtains a host pointer to a memory PMA range, for direct access.
+    /// \param paddr Target physical address.
+    /// \param length Size of range.
+    /// \param write True if the range will be written to through the pointer.
+    /// \returns Pointer to the start of the range in host memory, or nullptr if direct access is unavailable.
+    /// \details The entire range must fit inside the same memory PMA range, otherwise it fails.
+    /// When \p write is true, all pages in range are marked dirty before returning.
+    unsigned char *get_host_memory(uint64_t paddr, uint64_t length, bool write) {
+        return derived().do_get_host_memory(paddr, length, write);
+    }
+
     /// \brief Reads a word from memory.
     /// \tparam T Type of word to read.
     /// \param paddr Target physical address.
@@ -764,6 +775,14 @@ public:
         return derived().template do_replace_tlb_entry<ETYPE>(vaddr, paddr, pma);
     }
 
+    /// \brief Invalidates a TLB entry.
+    /// \tparam ETYPE TLB entry type to flush.
+    /// \param eidx Index of entry.
+    template <TLB_entry_type ETYPE>
+    void flush_tlb_entry(uint64_t eidx) {
+        return derived().template do_flush_tlb_entry<ETYPE>(eidx);
+    }
+
     /// \brief Invalidates all TLB entries of a type.
     /// \tparam ETYPE TLB entry type to flush.
     template <TLB_entry_type ETYPE>
@@ -784,6 +803,56 @@ public:
         return derived().do_flush_tlb_vaddr(vaddr);
     }
 
+    /// \brief Looks up the page-walk cache for the last-level page table of a virtual address.
+    /// \param satp Current value of satp.
+    /// \param vaddr Virtual address being translated.
+    /// \param table_addr Receives the physical address of the last-level page table on a hit.
+    /// \returns True on a hit, false otherwise.
+    bool read_page_walk_cache(uint64_t satp, uint64_t vaddr, uint64_t &table_addr) {
+        return derived().do_read_page_walk_cache(satp, vaddr, table_addr);
+    }
+
+    /// \brief Adds a walk that reached the last-level page table to the page-walk cache.
+    /// \param satp Value of satp used by the walk.
+    /// \param vaddr Virtual address being translated.
+    /// \param count Number of non-leaf PTEs visited.
+    /// \param pte_addr Physical addresses of the non-leaf PTEs.
+    /// \param pte Values of the non-leaf PTEs.
+    /// \param table_addr Physical address of the last-level page table.
+    void write_page_walk_cache(uint64_t satp, uint64_t vaddr, int count, const uint64_t *pte_addr,
+        const uint64_t *pte, uint64_t table_addr) {
+        return derived().do_write_page_walk_cache(satp, vaddr, count, pte_addr, pte, table_addr);
+    }
+
+    /// \brief Looks up the page-walk cache for the translation of a virtual address that falls in a superpage.
+    /// \param satp Current value of satp.
+    /// \param vaddr Virtual address being translated.
+    /// \param access Inputs of the permission checks other than the PTEs.
+    /// \param paddr Receives the physical address on a hit.
+    /// \returns True on a hit, false otherwise.
+    bool read_superpage_walk_cache(uint64_t satp, uint64_t vaddr, uint64_t access, uint64_t &paddr) {
+        return derived().do_read_superpage_walk_cache(satp, vaddr, access, paddr);
+    }
+
+    /// \brief Adds a walk that ended in a superpage leaf PTE to the page-walk cache.
+    /// \param satp Value of satp used by the walk.
+    /// \param vaddr Virtual address being translated.
+    /// \param access Inputs of the permission checks other than the PTEs.
+    /// \param count Number of PTEs visited, including the leaf.
+    /// \param pte_addr Physical addresses of the PTEs.
+    /// \param pte Values of the PTEs.
+    /// \param ppn Physical address of the superpage.
+    /// \param vaddr_mask Mask of the superpage offset bits.
+    void write_superpage_walk_cache(uint64_t satp, uint64_t vaddr, uint64_t access, int count,
+        const uint64_t *pte_addr, const uint64_t *pte, uint64_t ppn, uint64_t vaddr_mask) {
+        return derived().do_write_superpage_walk_cache(satp, vaddr, access, count, pte_addr, pte, ppn, vaddr_mask);
+    }
+
+    /// \brief Invalidates all page-walk cache entries.
+    void flush_page_walk_cache() {
+        return derived().do_flush_page_walk_cache();
+    }
+
     /// \brief Returns true if soft yield HINT instruction is enabled at runtime
     bool get_soft_yield() {
         return derived().do_get_soft_yield();
@@ -799,6 +868,83 @@ public:
         return derived().do_write_memory_with_padding(paddr, data, data_length, write_length_log2_size);
     }
 
+    /// \brief Returns true if the run must stop on break conditions
+    bool has_break_conditions() {
+        return derived().do_has_break_conditions();
+    }
+
+    /// \brief Checks if the instruction about to be executed has a breakpoint
+    /// \param pc Virtual address of instruction.
+    /// \param mcycle Current machine mcycle.
+    bool check_breakpoint(uint64_t pc, uint64_t mcycle) {
+        return derived().do_check_breakpoint(pc, mcycle);
+    }
+
+    /// \brief Checks if any instruction in a virtual page has a breakpoint
+    /// \param vaddr_page Virtual address of page.
+    bool is_breakpoint_page(uint64_t vaddr_page) {
+        return derived().do_is_breakpoint_page(vaddr_page);
+    }
+
+    /// \brief Checks a memory access against watchpoints
+    /// \param vaddr Virtual address of access.
+    /// \param paddr Physical address of access.
+    /// \param length Length of access.
+    /// \param write True for stores, false for loads.
+    /// \returns True if the page accessed overlaps a watchpoint.
+    bool check_memory_access(uint64_t vaddr, uint64_t paddr, uint64_t length, bool write) {
+        return derived().do_check_memory_access(vaddr, paddr, length, write);
+    }
+
+    /// \brief Checks a memory access that hit the TLB against watchpoints, if the entry maps a watched page
+    /// \tparam ETYPE TLB entry type.
+    /// \param vaddr Virtual address of access.
+    /// \param length Length of access.
+    template <TLB_entry_type ETYPE>
+    void check_memory_access_via_tlb(uint64_t vaddr, uint64_t length) {
+        return derived().template do_check_memory_access_via_tlb<ETYPE>(vaddr, length);
+    }
+
+    /// \brief Flags whether a TLB entry maps a watched page, so hits on it are checked against watchpoints
+    /// \tparam ETYPE TLB entry type.
+    /// \param eidx TLB entry index.
+    /// \param watched True if the page mapped by the entry overlaps a watchpoint.
+    template <TLB_entry_type ETYPE>
+    void set_tlb_entry_watched(uint64_t eidx, bool watched) {
+        return derived().template do_set_tlb_entry_watched<ETYPE>(eidx, watched);
+    }
+
+    /// \brief Checks if a break condition was reached after executing an instruction
+    /// \param pc Current pc.
+    /// \param mcycle Current machine mcycle.
+    bool check_break_conditions(uint64_t pc, uint64_t mcycle) {
+        return derived().do_check_break_conditions(pc, mcycle);
+    }
+
+    /// \brief Returns true if a break condition was reached
+    bool is_break_condition_reached() {
+        return derived().do_is_break_condition_reached();
+    }
+
+    /// \brief Returns true if the guest is being profiled
+    bool has_profiler() {
+        return derived().do_has_profiler();
+    }
+
+    /// \brief Accounts for an instruction about to be executed in the guest profile
+    /// \param pc Virtual address of instruction.
+    /// \param mcycle Current machine mcycle.
+    /// \param insn Instruction.
+    void profile_insn(uint64_t pc, uint64_t mcycle, uint32_t insn) {
+        derived().do_profile_insn(pc, mcycle, insn);
+    }
+
+    /// \brief Accounts for a trap in the guest profile
+    /// \param cause Trap cause.
+    void profile_trap(uint64_t cause) {
+        derived().do_profile_trap(cause);
+    }
+
 #ifdef DUMP_COUNTERS
     auto &get_statistics() {
         return derived().do_get_statistics();
@@ -19,6 +19,7 @@
 
 #include <cstdint>
 
+#include "machine-break-conditions.h"
 #include "machine.h"
 
 namespace cartesi {
@@ -56,6 +57,48 @@ public:
         return do_run(mcycle_end);
     }
 
+    /// \brief Runs the machine like run(), recording the nondeterministic events it consumes.
+    interpreter_break_reason run_record_trace(uint64_t mcycle_end, execution_trace &trace) {
+        return do_run_record_trace(mcycle_end, trace);
+    }
+
+    /// \brief Re-executes a run recorded by run_record_trace().
+    interpreter_break_reason run_replay_trace(const execution_trace &trace) {
+        return do_run_replay_trace(trace);
+    }
+
+    /// \brief Runs the machine like run(), but also stops exactly when a break condition is reached.
+    interpreter_break_reason run_until(uint64_t mcycle_end, const machine_break_conditions &conditions,
+        machine_break_event &event) {
+        return do_run_until(mcycle_end, conditions, event);
+    }
+
+    /// \brief Waits for GDB to connect to an address and serves it until it detaches.
+    void serve_gdb(const std::string &address, uint64_t mcycle_end) {
+        do_serve_gdb(address, mcycle_end);
+    }
+
+    /// \brief Starts profiling the guest in subsequent runs, discarding any previous profile.
+    void start_profiler(uint64_t sample_interval) {
+        do_start_profiler(sample_interval);
+    }
+
+    /// \brief Stops profiling the guest and discards the profile.
+    void stop_profiler(void) {
+        do_stop_profiler();
+    }
+
+    /// \brief Writes the profile collected since the profiler was started.
+    void write_profile(const std::string &filename, machine_profile_format format,
+        const std::string &elf_filename) const {
+        do_write_profile(filename, format, elf_filename);
+    }
+
+    /// \brief Moves console output captured in memory out of the machine.
+    uint64_t read_console_output(unsigned char *data, uint64_t max_length) {
+        return do_read_console_output(data, max_length);
+    }
+
     /// \brief Serialize entire state to directory
     void store(const std::string &dir) {
         do_store(dir);
@@ -690,6 +733,11 @@ public:
         do_send_cmio_response(reason, data, length);
     }
 
+    /// \brief Returns the host memory backing the cmio tx buffer.
+    const unsigned char *get_cmio_tx_buffer(uint64_t &length) const {
+        return do_get_cmio_tx_buffer(length);
+    }
+
     /// \brief Sends cmio response. and returns an access log
     access_log log_send_cmio_response(uint16_t reason, const unsigned char *data, size_t length,
         const access_log::type &log_type, bool one_based) {
@@ -698,6 +746,16 @@ public:
 
 private:
     virtual interpreter_break_reason do_run(uint64_t mcycle_end) = 0;
+    virtual interpreter_break_reason do_run_record_trace(uint64_t mcycle_end, execution_trace &trace) = 0;
+    virtual interpreter_break_reason do_run_replay_trace(const execution_trace &trace) = 0;
+    virtual interpreter_break_reason do_run_until(uint64_t mcycle_end, const machine_break_conditions &conditions,
+        machine_break_event &event) = 0;
+    virtual void do_serve_gdb(const std::string &address, uint64_t mcycle_end) = 0;
+    virtual void do_start_profiler(uint64_t sample_interval) = 0;
+    virtual void do_stop_profiler(void) = 0;
+    virtual void do_write_profile(const std::string &filename, machine_profile_format format,
+        const std::string &elf_filename) const = 0;
+    virtual uint64_t do_read_console_output(unsigned char *data, uint64_t max_length) = 0;
     virtual void do_store(const std::string &dir) = 0;
     virtual access_log do_log_uarch_step(const access_log::type &log_type, bool one_based = false) = 0;
     virtual machine_merkle_tree::proof_type do_get_proof(uint64_t address, int log2_size) const = 0;
@@ -822,6 +880,7 @@ private:
     virtual uarch_interpreter_break_reason do_run_uarch(uint64_t uarch_cycle_end) = 0;
     virtual machine_memory_range_descrs do_get_memory_ranges(void) const = 0;
     virtual void do_send_cmio_response(uint16_t reason, const unsigned char *data, size_t length) = 0;
+    virtual const unsigned char *do_get_cmio_tx_buffer(uint64_t &length) const = 0;
     virtual access_log do_log_send_cmio_response(uint16_t reason, const unsigned char *data, size_t length,
         const access_log::type &log_type, bool one_based) = 0;
 };
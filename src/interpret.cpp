@@ -330,6 +330,9 @@ static NO_INLINE void set_priv(STATE_ACCESS &a, int new_prv) {
 /// \details This function is outlined to minimize host CPU code cache pressure.
 template <typename STATE_ACCESS>
 static NO_INLINE uint64_t raise_exception(STATE_ACCESS &a, uint64_t pc, uint64_t cause, uint64_t tval) {
+    if (unlikely(a.has_profiler())) {
+        a.profile_trap(cause);
+    }
 #if defined(DUMP_EXCEPTIONS) || defined(DUMP_MMU_EXCEPTIONS) || defined(DUMP_INTERRUPTS) ||                            \
     defined(DUMP_ILLEGAL_INSN_EXCEPTIONS)
     {
@@ -796,6 +799,7 @@ static FORCE_INLINE int32_t insn_get_C_SWSP_imm(uint32_t insn) {
 }
 
 /// \brief Read an aligned word from virtual memory (slow path that goes through virtual address translation).
+/// \tparam BREAK_CONDITIONS True if the run must stop on break conditions.
 /// \tparam T uint8_t, uint16_t, uint32_t, or uint64_t.
 /// \tparam STATE_ACCESS Class of machine state accessor object.
 /// \tparam RAISE_STORE_EXCEPTIONS Boolean, when true load exceptions are converted into store exceptions.
@@ -810,7 +814,7 @@ static FORCE_INLINE int32_t insn_get_C_SWSP_imm(uint32_t insn) {
 /// instead it returns a new PC in case an exception is raised. This is because the function
 /// is outlined, and taking PC by reference would cause the compiler to store it in a stack variable
 /// instead of always storing it in register (this is an optimization).
-template <typename T, typename STATE_ACCESS, bool RAISE_STORE_EXCEPTIONS = false>
+template <bool BREAK_CONDITIONS, typename T, typename STATE_ACCESS, bool RAISE_STORE_EXCEPTIONS = false>
 static NO_INLINE std::pair<bool, uint64_t> read_virtual_memory_slow(STATE_ACCESS &a, uint64_t pc, uint64_t mcycle,
     uint64_t vaddr, T *pval) {
     using U = std::make_unsigned_t<T>;
@@ -833,8 +837,16 @@ static NO_INLINE std::pair<bool, uint64_t> read_virtual_memory_slow(STATE_ACCESS
             unsigned char *hpage = a.template replace_tlb_entry<TLB_READ>(vaddr, paddr, pma);
             const uint64_t hoffset = vaddr & PAGE_OFFSET_MASK;
             a.read_memory_word(paddr, hpage, hoffset, pval);
+            // Watched pages stay in the TLB, flagged so later hits on them are checked too
+            if constexpr (BREAK_CONDITIONS) {
+                a.template set_tlb_entry_watched<TLB_READ>(tlb_get_entry_index(vaddr),
+                    a.check_memory_access(vaddr, paddr, sizeof(T), false));
+            }
             return {true, pc};
         } else if (likely(pma.get_istart_IO())) {
+            if constexpr (BREAK_CONDITIONS) {
+                a.check_memory_access(vaddr, paddr, sizeof(T), false);
+            }
             const uint64_t offset = paddr - pma.get_start();
             uint64_t val{};
             // If we do not know how to read, we treat this as a PMA violation
@@ -851,6 +863,7 @@ static NO_INLINE std::pair<bool, uint64_t> read_virtual_memory_slow(STATE_ACCESS
 }
 
 /// \brief Read an aligned word from virtual memory.
+/// \tparam BREAK_CONDITIONS True if the run must stop on break conditions.
 /// \tparam T uint8_t, uint16_t, uint32_t, or uint64_t.
 /// \tparam STATE_ACCESS Class of machine state accessor object.
 /// \param a Machine state accessor object.
@@ -858,22 +871,26 @@ static NO_INLINE std::pair<bool, uint64_t> read_virtual_memory_slow(STATE_ACCESS
 /// \param vaddr Virtual address for word.
 /// \param pval Pointer to word receiving value.
 /// \returns True if succeeded, false otherwise.
-template <typename T, typename STATE_ACCESS, bool RAISE_STORE_EXCEPTIONS = false>
+template <bool BREAK_CONDITIONS, typename T, typename STATE_ACCESS, bool RAISE_STORE_EXCEPTIONS = false>
 static FORCE_INLINE bool read_virtual_memory(STATE_ACCESS &a, uint64_t &pc, uint64_t mcycle, uint64_t vaddr, T *pval) {
     // Try hitting the TLB
     if (unlikely(!(a.template read_memory_word_via_tlb<TLB_READ>(vaddr, pval)))) {
         // Outline the slow path into a function call to minimize host CPU code cache pressure
         INC_COUNTER(a.get_statistics(), tlb_rmiss);
-        auto [status, new_pc] =
-            read_virtual_memory_slow<T, STATE_ACCESS, RAISE_STORE_EXCEPTIONS>(a, pc, mcycle, vaddr, pval);
+        auto [status, new_pc] = read_virtual_memory_slow<BREAK_CONDITIONS, T, STATE_ACCESS, RAISE_STORE_EXCEPTIONS>(a,
+            pc, mcycle, vaddr, pval);
         pc = new_pc;
         return status;
     }
     INC_COUNTER(a.get_statistics(), tlb_rhit);
+    if constexpr (BREAK_CONDITIONS) {
+        a.template check_memory_access_via_tlb<TLB_READ>(vaddr, sizeof(T));
+    }
     return true;
 }
 
 /// \brief Writes an aligned word to virtual memory (slow path that goes through virtual address translation).
+/// \tparam BREAK_CONDITIONS True if the run must stop on break conditions.
 /// \tparam T uint8_t, uint16_t, uint32_t, or uint64_t.
 /// \tparam STATE_ACCESS Class of machine state accessor object.
 /// \param a Machine state accessor object.
@@ -887,7 +904,7 @@ static FORCE_INLINE bool read_virtual_memory(STATE_ACCESS &a, uint64_t &pc, uint
 /// instead it returns a new PC in case an exception is raised. This is because the function
 /// is outlined, and taking PC by reference would cause the compiler to store it in a stack variable
 /// instead of always storing it in register (this is an optimization).
-template <typename T, typename STATE_ACCESS>
+template <bool BREAK_CONDITIONS, typename T, typename STATE_ACCESS>
 static NO_INLINE std::pair<execute_status, uint64_t> write_virtual_memory_slow(STATE_ACCESS &a, uint64_t pc,
     uint64_t mcycle, uint64_t vaddr, uint64_t val64) {
     using U = std::make_unsigned_t<T>;
@@ -908,8 +925,16 @@ static NO_INLINE std::pair<execute_status, uint64_t> write_virtual_memory_slow(S
             unsigned char *hpage = a.template replace_tlb_entry<TLB_WRITE>(vaddr, paddr, pma);
             const uint64_t hoffset = vaddr & PAGE_OFFSET_MASK;
             a.write_memory_word(paddr, hpage, hoffset, static_cast<T>(val64));
+            // Watched pages stay in the TLB, flagged so later hits on them are checked too
+            if constexpr (BREAK_CONDITIONS) {
+                a.template set_tlb_entry_watched<TLB_WRITE>(tlb_get_entry_index(vaddr),
+                    a.check_memory_access(vaddr, paddr, sizeof(T), true));
+            }
             return {execute_status::success, pc};
         } else if (likely(pma.get_istart_IO())) {
+            if constexpr (BREAK_CONDITIONS) {
+                a.check_memory_access(vaddr, paddr, sizeof(T), true);
+            }
             const uint64_t offset = paddr - pma.get_start();
             auto status =
                 a.write_device(pma, mcycle, offset, static_cast<U>(static_cast<T>(val64)), log2_size<U>::value);
@@ -924,6 +949,7 @@ static NO_INLINE std::pair<execute_status, uint64_t> write_virtual_memory_slow(S
 }
 
 /// \brief Writes an aligned word to virtual memory.
+/// \tparam BREAK_CONDITIONS True if the run must stop on break conditions.
 /// \tparam T uint8_t, uint16_t, uint32_t, or uint64_t.
 /// \tparam STATE_ACCESS Class of machine state accessor object.
 /// \param a Machine state accessor object.
@@ -931,18 +957,21 @@ static NO_INLINE std::pair<execute_status, uint64_t> write_virtual_memory_slow(S
 /// \param vaddr Virtual address for word.
 /// \param val64 Value to write.
 /// \returns True if succeeded, false if exception raised.
-template <typename T, typename STATE_ACCESS>
+template <bool BREAK_CONDITIONS, typename T, typename STATE_ACCESS>
 static FORCE_INLINE execute_status write_virtual_memory(STATE_ACCESS &a, uint64_t &pc, uint64_t mcycle, uint64_t vaddr,
     uint64_t val64) {
     // Try hitting the TLB
     if (unlikely((!a.template write_memory_word_via_tlb<TLB_WRITE>(vaddr, static_cast<T>(val64))))) {
         INC_COUNTER(a.get_statistics(), tlb_wmiss);
         // Outline the slow path into a function call to minimize host CPU code cache pressure
-        auto [status, new_pc] = write_virtual_memory_slow<T>(a, pc, mcycle, vaddr, val64);
+        auto [status, new_pc] = write_virtual_memory_slow<BREAK_CONDITIONS, T>(a, pc, mcycle, vaddr, val64);
         pc = new_pc;
         return status;
     }
     INC_COUNTER(a.get_statistics(), tlb_whit);
+    if constexpr (BREAK_CONDITIONS) {
+        a.template check_memory_access_via_tlb<TLB_WRITE>(vaddr, sizeof(T));
+    }
     return execute_status::success;
 }
 
@@ -1045,15 +1074,16 @@ static FORCE_INLINE execute_status execute_jump(STATE_ACCESS &a, uint64_t &pc, u
 }
 
 /// \brief Execute the LR instruction.
+/// \tparam BREAK_CONDITIONS True if the run must stop on break conditions.
 /// \tparam STATE_ACCESS Class of machine state accessor object.
 /// \param a Machine state accessor object.
 /// \param pc Interpreter loop program counter (will be overwritten).
 /// \param insn Instruction.
-template <typename T, typename STATE_ACCESS>
+template <bool BREAK_CONDITIONS, typename T, typename STATE_ACCESS>
 static FORCE_INLINE execute_status execute_LR(STATE_ACCESS &a, uint64_t &pc, uint64_t mcycle, uint32_t insn) {
     const uint64_t vaddr = a.read_x(insn_get_rs1(insn));
     T val = 0;
-    if (unlikely(!read_virtual_memory<T>(a, pc, mcycle, vaddr, &val))) {
+    if (unlikely((!read_virtual_memory<BREAK_CONDITIONS, T>(a, pc, mcycle, vaddr, &val)))) {
         return advance_to_raised_exception(a, pc);
     }
     a.write_ilrsc(vaddr);
@@ -1066,17 +1096,19 @@ static FORCE_INLINE execute_status execute_LR(STATE_ACCESS &a, uint64_t &pc, uin
 }
 
 /// \brief Execute the SC instruction.
+/// \tparam BREAK_CONDITIONS True if the run must stop on break conditions.
 /// \tparam STATE_ACCESS Class of machine state accessor object.
 /// \param a Machine state accessor object.
 /// \param pc Interpreter loop program counter (will be overwritten).
 /// \param insn Instruction.
-template <typename T, typename STATE_ACCESS>
+template <bool BREAK_CONDITIONS, typename T, typename STATE_ACCESS>
 static FORCE_INLINE execute_status execute_SC(STATE_ACCESS &a, uint64_t &pc, uint64_t mcycle, uint32_t insn) {
     uint64_t val = 0;
     const uint64_t vaddr = a.read_x(insn_get_rs1(insn));
     execute_status status = execute_status::success;
     if (a.read_ilrsc() == vaddr) {
-        status = write_virtual_memory<T>(a, pc, mcycle, vaddr, static_cast<T>(a.read_x(insn_get_rs2(insn))));
+        status = write_virtual_memory<BREAK_CONDITIONS, T>(a, pc, mcycle, vaddr,
+            static_cast<T>(a.read_x(insn_get_rs2(insn))));
         if (unlikely(status == execute_status::failure)) {
             return advance_to_raised_exception(a, pc);
         }
@@ -1093,7 +1125,7 @@ static FORCE_INLINE execute_status execute_SC(STATE_ACCESS &a, uint64_t &pc, uin
 }
 
 /// \brief Implementation of the LR.W instruction.
-template <typename STATE_ACCESS>
+template <bool BREAK_CONDITIONS, typename STATE_ACCESS>
 static FORCE_INLINE execute_status execute_LR_W(STATE_ACCESS &a, uint64_t &pc, uint64_t mcycle, uint32_t insn) {
     (void) a;
     (void) pc;
@@ -1102,29 +1134,29 @@ static FORCE_INLINE execute_status execute_LR_W(STATE_ACCESS &a, uint64_t &pc, u
         return raise_illegal_insn_exception(a, pc, insn);
     }
     dump_insn(a, pc, insn, "lr.w");
-    return execute_LR<int32_t>(a, pc, mcycle, insn);
+    return execute_LR<BREAK_CONDITIONS, int32_t>(a, pc, mcycle, insn);
 }
 
 /// \brief Implementation of the SC.W instruction.
-template <typename STATE_ACCESS>
+template <bool BREAK_CONDITIONS, typename STATE_ACCESS>
 static FORCE_INLINE execute_status execute_SC_W(STATE_ACCESS &a, uint64_t &pc, uint64_t mcycle, uint32_t insn) {
     dump_insn(a, pc, insn, "sc.w");
-    return execute_SC<int32_t>(a, pc, mcycle, insn);
+    return execute_SC<BREAK_CONDITIONS, int32_t>(a, pc, mcycle, insn);
 }
 
-template <typename T, typename STATE_ACCESS, typename F>
+template <bool BREAK_CONDITIONS, typename T, typename STATE_ACCESS, typename F>
 static FORCE_INLINE execute_status execute_AMO(STATE_ACCESS &a, uint64_t &pc, uint64_t mcycle, uint32_t insn,
     const F &f) {
     const uint64_t vaddr = a.read_x(insn_get_rs1(insn));
     T valm = 0;
     // AMOs never raise load exceptions. Since any unreadable page is also unwritable,
     // attempting to perform an AMO on an unreadable page always raises a store page-fault exception.
-    if (unlikely((!read_virtual_memory<T, STATE_ACCESS, true>(a, pc, mcycle, vaddr, &valm)))) {
+    if (unlikely((!read_virtual_memory<BREAK_CONDITIONS, T, STATE_ACCESS, true>(a, pc, mcycle, vaddr, &valm)))) {
         return advance_to_raised_exception(a, pc);
     }
     T valr = static_cast<T>(a.read_x(insn_get_rs2(insn)));
     valr = f(valm, valr);
-    const execute_status status = write_virtual_memory<T>(a, pc, mcycle, vaddr, valr);
+    const execute_status status = write_virtual_memory<BREAK_CONDITIONS, T>(a, pc, mcycle, vaddr, valr);
     if (unlikely(status == execute_status::failure)) {
         return advance_to_raised_exception(a, pc);
     }
@@ -1137,51 +1169,54 @@ static FORCE_INLINE execute_status execute_AMO(STATE_ACCESS &a, uint64_t &pc, ui
 }
 
 /// \brief Implementation of the AMOSWAP.W instruction.
-template <typename STATE_ACCESS>
+template <bool BREAK_CONDITIONS, typename STATE_ACCESS>
 static FORCE_INLINE execute_status execute_AMOSWAP_W(STATE_ACCESS &a, uint64_t &pc, uint64_t mcycle, uint32_t insn) {
     dump_insn(a, pc, insn, "amoswap.w");
-    return execute_AMO<int32_t>(a, pc, mcycle, insn, [](int32_t valm, int32_t valr) -> int32_t {
+    return execute_AMO<BREAK_CONDITIONS, int32_t>(a, pc, mcycle, insn, [](int32_t valm, int32_t valr) -> int32_t {
         (void) valm;
         return valr;
     });
 }
 
 /// \brief Implementation of the AMOADD.W instruction.
-template <typename STATE_ACCESS>
+template <bool BREAK_CONDITIONS, typename STATE_ACCESS>
 static FORCE_INLINE execute_status execute_AMOADD_W(STATE_ACCESS &a, uint64_t &pc, uint64_t mcycle, uint32_t insn) {
     dump_insn(a, pc, insn, "amoadd.w");
-    return execute_AMO<int32_t>(a, pc, mcycle, insn, [](int32_t valm, int32_t valr) -> int32_t {
+    return execute_AMO<BREAK_CONDITIONS, int32_t>(a, pc, mcycle, insn, [](int32_t valm, int32_t valr) -> int32_t {
         int32_t val = 0;
         __builtin_add_overflow(valm, valr, &val);
         return val;
     });
 }
 
-template <typename STATE_ACCESS>
+template <bool BREAK_CONDITIONS, typename STATE_ACCESS>
 static FORCE_INLINE execute_status execute_AMOXOR_W(STATE_ACCESS &a, uint64_t &pc, uint64_t mcycle, uint32_t insn) {
     dump_insn(a, pc, insn, "amoxor.w");
-    return execute_AMO<int32_t>(a, pc, mcycle, insn, [](int32_t valm, int32_t valr) -> int32_t { return valm ^ valr; });
+    return execute_AMO<BREAK_CONDITIONS, int32_t>(a, pc, mcycle, insn,
+        [](int32_t valm, int32_t valr) -> int32_t { return valm ^ valr; });
 }
 
 /// \brief Implementation of the AMOAND.W instruction.
-template <typename STATE_ACCESS>
+template <bool BREAK_CONDITIONS, typename STATE_ACCESS>
 static FORCE_INLINE execute_status execute_AMOAND_W(STATE_ACCESS &a, uint64_t &pc, uint64_t mcycle, uint32_t insn) {
     dump_insn(a, pc, insn, "amoand.w");
-    return execute_AMO<int32_t>(a, pc, mcycle, insn, [](int32_t valm, int32_t valr) -> int32_t { return valm & valr; });
+    return execute_AMO<BREAK_CONDITIONS, int32_t>(a, pc, mcycle, insn,
+        [](int32_t valm, int32_t valr) -> int32_t { return valm & valr; });
 }
 
 /// \brief Implementation of the AMOOR.W instruction.
-template <typename STATE_ACCESS>
+template <bool BREAK_CONDITIONS, typename STATE_ACCESS>
 static FORCE_INLINE execute_status execute_AMOOR_W(STATE_ACCESS &a, uint64_t &pc, uint64_t mcycle, uint32_t insn) {
     dump_insn(a, pc, insn, "amoor.w");
-    return execute_AMO<int32_t>(a, pc, mcycle, insn, [](int32_t valm, int32_t valr) -> int32_t { return valm | valr; });
+    return execute_AMO<BREAK_CONDITIONS, int32_t>(a, pc, mcycle, insn,
+        [](int32_t valm, int32_t valr) -> int32_t { return valm | valr; });
 }
 
 /// \brief Implementation of the AMOMIN.W instruction.
-template <typename STATE_ACCESS>
+template <bool BREAK_CONDITIONS, typename STATE_ACCESS>
 static FORCE_INLINE execute_status execute_AMOMIN_W(STATE_ACCESS &a, uint64_t &pc, uint64_t mcycle, uint32_t insn) {
     dump_insn(a, pc, insn, "amomin.w");
-    return execute_AMO<int32_t>(a, pc, mcycle, insn, [](int32_t valm, int32_t valr) -> int32_t {
+    return execute_AMO<BREAK_CONDITIONS, int32_t>(a, pc, mcycle, insn, [](int32_t valm, int32_t valr) -> int32_t {
         if (valm < valr) {
             return valm;
         } else {
@@ -1191,10 +1226,10 @@ static FORCE_INLINE execute_status execute_AMOMIN_W(STATE_ACCESS &a, uint64_t &p
 }
 
 /// \brief Implementation of the AMOMAX.W instruction.
-template <typename STATE_ACCESS>
+template <bool BREAK_CONDITIONS, typename STATE_ACCESS>
 static FORCE_INLINE execute_status execute_AMOMAX_W(STATE_ACCESS &a, uint64_t &pc, uint64_t mcycle, uint32_t insn) {
     dump_insn(a, pc, insn, "amomax.w");
-    return execute_AMO<int32_t>(a, pc, mcycle, insn, [](int32_t valm, int32_t valr) -> int32_t {
+    return execute_AMO<BREAK_CONDITIONS, int32_t>(a, pc, mcycle, insn, [](int32_t valm, int32_t valr) -> int32_t {
         if (valm > valr) {
             return valm;
         } else {
@@ -1204,10 +1239,10 @@ static FORCE_INLINE execute_status execute_AMOMAX_W(STATE_ACCESS &a, uint64_t &p
 }
 
 /// \brief Implementation of the AMOMINU.W instruction.
-template <typename STATE_ACCESS>
+template <bool BREAK_CONDITIONS, typename STATE_ACCESS>
 static FORCE_INLINE execute_status execute_AMOMINU_W(STATE_ACCESS &a, uint64_t &pc, uint64_t mcycle, uint32_t insn) {
     dump_insn(a, pc, insn, "amominu.w");
-    return execute_AMO<int32_t>(a, pc, mcycle, insn, [](int32_t valm, int32_t valr) -> int32_t {
+    return execute_AMO<BREAK_CONDITIONS, int32_t>(a, pc, mcycle, insn, [](int32_t valm, int32_t valr) -> int32_t {
         if (static_cast<uint32_t>(valm) < static_cast<uint32_t>(valr)) {
             return valm;
         } else {
@@ -1217,10 +1252,10 @@ static FORCE_INLINE execute_status execute_AMOMINU_W(STATE_ACCESS &a, uint64_t &
 }
 
 /// \brief Implementation of the AMOMAXU.W instruction.
-template <typename STATE_ACCESS>
+template <bool BREAK_CONDITIONS, typename STATE_ACCESS>
 static FORCE_INLINE execute_status execute_AMOMAXU_W(STATE_ACCESS &a, uint64_t &pc, uint64_t mcycle, uint32_t insn) {
     dump_insn(a, pc, insn, "amomaxu.w");
-    return execute_AMO<int32_t>(a, pc, mcycle, insn, [](int32_t valm, int32_t valr) -> int32_t {
+    return execute_AMO<BREAK_CONDITIONS, int32_t>(a, pc, mcycle, insn, [](int32_t valm, int32_t valr) -> int32_t {
         if (static_cast<uint32_t>(valm) > static_cast<uint32_t>(valr)) {
             return valm;
         } else {
@@ -1230,68 +1265,71 @@ static FORCE_INLINE execute_status execute_AMOMAXU_W(STATE_ACCESS &a, uint64_t &
 }
 
 /// \brief Implementation of the LR.D instruction.
-template <typename STATE_ACCESS>
+template <bool BREAK_CONDITIONS, typename STATE_ACCESS>
 static FORCE_INLINE execute_status execute_LR_D(STATE_ACCESS &a, uint64_t &pc, uint64_t mcycle, uint32_t insn) {
     if (unlikely((insn & 0b00000001111100000000000000000000) != 0)) {
         return raise_illegal_insn_exception(a, pc, insn);
     }
     dump_insn(a, pc, insn, "lr.d");
-    return execute_LR<uint64_t>(a, pc, mcycle, insn);
+    return execute_LR<BREAK_CONDITIONS, uint64_t>(a, pc, mcycle, insn);
 }
 
 /// \brief Implementation of the SC.D instruction.
-template <typename STATE_ACCESS>
+template <bool BREAK_CONDITIONS, typename STATE_ACCESS>
 static FORCE_INLINE execute_status execute_SC_D(STATE_ACCESS &a, uint64_t &pc, uint64_t mcycle, uint32_t insn) {
     dump_insn(a, pc, insn, "sc.d");
-    return execute_SC<uint64_t>(a, pc, mcycle, insn);
+    return execute_SC<BREAK_CONDITIONS, uint64_t>(a, pc, mcycle, insn);
 }
 
 /// \brief Implementation of the AMOSWAP.D instruction.
-template <typename STATE_ACCESS>
+template <bool BREAK_CONDITIONS, typename STATE_ACCESS>
 static FORCE_INLINE execute_status execute_AMOSWAP_D(STATE_ACCESS &a, uint64_t &pc, uint64_t mcycle, uint32_t insn) {
     dump_insn(a, pc, insn, "amoswap.d");
-    return execute_AMO<int64_t>(a, pc, mcycle, insn, [](int64_t valm, int64_t valr) -> int64_t {
+    return execute_AMO<BREAK_CONDITIONS, int64_t>(a, pc, mcycle, insn, [](int64_t valm, int64_t valr) -> int64_t {
         (void) valm;
         return valr;
     });
 }
 
 /// \brief Implementation of the AMOADD.D instruction.
-template <typename STATE_ACCESS>
+template <bool BREAK_CONDITIONS, typename STATE_ACCESS>
 static FORCE_INLINE execute_status execute_AMOADD_D(STATE_ACCESS &a, uint64_t &pc, uint64_t mcycle, uint32_t insn) {
     dump_insn(a, pc, insn, "amoadd.d");
-    return execute_AMO<int64_t>(a, pc, mcycle, insn, [](int64_t valm, int64_t valr) -> int64_t {
+    return execute_AMO<BREAK_CONDITIONS, int64_t>(a, pc, mcycle, insn, [](int64_t valm, int64_t valr) -> int64_t {
         int64_t val = 0;
         __builtin_add_overflow(valm, valr, &val);
         return val;
     });
 }
 
-template <typename STATE_ACCESS>
+template <bool BREAK_CONDITIONS, typename STATE_ACCESS>
 static FORCE_INLINE execute_status execute_AMOXOR_D(STATE_ACCESS &a, uint64_t &pc, uint64_t mcycle, uint32_t insn) {
     dump_insn(a, pc, insn, "amoxor.d");
-    return execute_AMO<int64_t>(a, pc, mcycle, insn, [](int64_t valm, int64_t valr) -> int64_t { return valm ^ valr; });
+    return execute_AMO<BREAK_CONDITIONS, int64_t>(a, pc, mcycle, insn,
+        [](int64_t valm, int64_t valr) -> int64_t { return valm ^ valr; });
 }
 
 /// \brief Implementation of the AMOAND.D instruction.
-template <typename STATE_ACCESS>
+template <bool BREAK_CONDITIONS, typename STATE_ACCESS>
 static FORCE_INLINE execute_status execute_AMOAND_D(STATE_ACCESS &a, uint64_t &pc, uint64_t mcycle, uint32_t insn) {
     dump_insn(a, pc, insn, "amoand.d");
-    return execute_AMO<int64_t>(a, pc, mcycle, insn, [](int64_t valm, int64_t valr) -> int64_t { return valm & valr; });
+    return execute_AMO<BREAK_CONDITIONS, int64_t>(a, pc, mcycle, insn,
+        [](int64_t valm, int64_t valr) -> int64_t { return valm & valr; });
 }
 
 /// \brief Implementation of the AMOOR.D instruction.
-template <typename STATE_ACCESS>
+template <bool BREAK_CONDITIONS, typename STATE_ACCESS>
 static FORCE_INLINE execute_status execute_AMOOR_D(STATE_ACCESS &a, uint64_t &pc, uint64_t mcycle, uint32_t insn) {
     dump_insn(a, pc, insn, "amoor.d");
-    return execute_AMO<int64_t>(a, pc, mcycle, insn, [](int64_t valm, int64_t valr) -> int64_t { return valm | valr; });
+    return execute_AMO<BREAK_CONDITIONS, int64_t>(a, pc, mcycle, insn,
+        [](int64_t valm, int64_t valr) -> int64_t { return valm | valr; });
 }
 
 /// \brief Implementation of the AMOMIN.D instruction.
-template <typename STATE_ACCESS>
+template <bool BREAK_CONDITIONS, typename STATE_ACCESS>
 static FORCE_INLINE execute_status execute_AMOMIN_D(STATE_ACCESS &a, uint64_t &pc, uint64_t mcycle, uint32_t insn) {
     dump_insn(a, pc, insn, "amomin.d");
-    return execute_AMO<int64_t>(a, pc, mcycle, insn, [](int64_t valm, int64_t valr) -> int64_t {
+    return execute_AMO<BREAK_CONDITIONS, int64_t>(a, pc, mcycle, insn, [](int64_t valm, int64_t valr) -> int64_t {
         if (valm < valr) {
             return valm;
         } else {
@@ -1301,10 +1339,10 @@ static FORCE_INLINE execute_status execute_AMOMIN_D(STATE_ACCESS &a, uint64_t &p
 }
 
 /// \brief Implementation of the AMOMAX.D instruction.
-template <typename STATE_ACCESS>
+template <bool BREAK_CONDITIONS, typename STATE_ACCESS>
 static FORCE_INLINE execute_status execute_AMOMAX_D(STATE_ACCESS &a, uint64_t &pc, uint64_t mcycle, uint32_t insn) {
     dump_insn(a, pc, insn, "amomax.d");
-    return execute_AMO<int64_t>(a, pc, mcycle, insn, [](int64_t valm, int64_t valr) -> int64_t {
+    return execute_AMO<BREAK_CONDITIONS, int64_t>(a, pc, mcycle, insn, [](int64_t valm, int64_t valr) -> int64_t {
         if (valm > valr) {
             return valm;
         } else {
@@ -1314,10 +1352,10 @@ static FORCE_INLINE execute_status execute_AMOMAX_D(STATE_ACCESS &a, uint64_t &p
 }
 
 /// \brief Implementation of the AMOMINU.D instruction.
-template <typename STATE_ACCESS>
+template <bool BREAK_CONDITIONS, typename STATE_ACCESS>
 static FORCE_INLINE execute_status execute_AMOMINU_D(STATE_ACCESS &a, uint64_t &pc, uint64_t mcycle, uint32_t insn) {
     dump_insn(a, pc, insn, "amominu.d");
-    return execute_AMO<uint64_t>(a, pc, mcycle, insn, [](uint64_t valm, uint64_t valr) -> uint64_t {
+    return execute_AMO<BREAK_CONDITIONS, uint64_t>(a, pc, mcycle, insn, [](uint64_t valm, uint64_t valr) -> uint64_t {
         if (valm < valr) {
             return valm;
         } else {
@@ -1327,10 +1365,10 @@ static FORCE_INLINE execute_status execute_AMOMINU_D(STATE_ACCESS &a, uint64_t &
 }
 
 /// \brief Implementation of the AMOMAXU.D instruction.
-template <typename STATE_ACCESS>
+template <bool BREAK_CONDITIONS, typename STATE_ACCESS>
 static FORCE_INLINE execute_status execute_AMOMAXU_D(STATE_ACCESS &a, uint64_t &pc, uint64_t mcycle, uint32_t insn) {
     dump_insn(a, pc, insn, "amomaxu.d");
-    return execute_AMO<uint64_t>(a, pc, mcycle, insn, [](uint64_t valm, uint64_t valr) -> uint64_t {
+    return execute_AMO<BREAK_CONDITIONS, uint64_t>(a, pc, mcycle, insn, [](uint64_t valm, uint64_t valr) -> uint64_t {
         if (valm > valr) {
             return valm;
         } else {
@@ -2003,6 +2041,10 @@ static NO_INLINE execute_status write_csr_satp(STATE_ACCESS &a, uint64_t val) {
     // Note that there is no need to flush the TLB when PPN has changed,
     // because software is required to execute SFENCE.VMA when recycling an ASID.
     const uint64_t mod = old_satp ^ stap;
+    // The page-walk cache is keyed by satp, so this only drops entries that can no longer hit
+    if (mod != 0) {
+        a.flush_page_walk_cache();
+    }
     if (mod & (SATP_ASID_MASK | SATP_MODE_MASK)) {
         a.flush_all_tlb();
         INC_COUNTER(a.get_statistics(), tlb_flush_all);
@@ -3000,12 +3042,12 @@ static FORCE_INLINE execute_status execute_SRAIW(STATE_ACCESS &a, uint64_t &pc,
     });
 }
 
-template <typename T, typename STATE_ACCESS>
+template <bool BREAK_CONDITIONS, typename T, typename STATE_ACCESS>
 static FORCE_INLINE execute_status execute_S(STATE_ACCESS &a, uint64_t &pc, uint64_t mcycle, uint32_t insn) {
     const uint64_t vaddr = a.read_x(insn_get_rs1(insn));
     const int32_t imm = insn_S_get_imm(insn);
     const uint64_t val = a.read_x(insn_get_rs2(insn));
-    const execute_status status = write_virtual_memory<T>(a, pc, mcycle, vaddr + imm, val);
+    const execute_status status = write_virtual_memory<BREAK_CONDITIONS, T>(a, pc, mcycle, vaddr + imm, val);
     if (unlikely(status == execute_status::failure)) {
         return advance_to_raised_exception(a, pc);
     }
@@ -3013,39 +3055,39 @@ static FORCE_INLINE execute_status execute_S(STATE_ACCESS &a, uint64_t &pc, uint
 }
 
 /// \brief Implementation of the SB instruction.
-template <typename STATE_ACCESS>
+template <bool BREAK_CONDITIONS, typename STATE_ACCESS>
 static FORCE_INLINE execute_status execute_SB(STATE_ACCESS &a, uint64_t &pc, uint64_t mcycle, uint32_t insn) {
     dump_insn(a, pc, insn, "sb");
-    return execute_S<uint8_t>(a, pc, mcycle, insn);
+    return execute_S<BREAK_CONDITIONS, uint8_t>(a, pc, mcycle, insn);
 }
 
 /// \brief Implementation of the SH instruction.
-template <typename STATE_ACCESS>
+template <bool BREAK_CONDITIONS, typename STATE_ACCESS>
 static FORCE_INLINE execute_status execute_SH(STATE_ACCESS &a, uint64_t &pc, uint64_t mcycle, uint32_t insn) {
     dump_insn(a, pc, insn, "sh");
-    return execute_S<uint16_t>(a, pc, mcycle, insn);
+    return execute_S<BREAK_CONDITIONS, uint16_t>(a, pc, mcycle, insn);
 }
 
 /// \brief Implementation of the SW instruction.
-template <typename STATE_ACCESS>
+template <bool BREAK_CONDITIONS, typename STATE_ACCESS>
 static FORCE_INLINE execute_status execute_SW(STATE_ACCESS &a, uint64_t &pc, uint64_t mcycle, uint32_t insn) {
     dump_insn(a, pc, insn, "sw");
-    return execute_S<uint32_t>(a, pc, mcycle, insn);
+    return execute_S<BREAK_CONDITIONS, uint32_t>(a, pc, mcycle, insn);
 }
 
 /// \brief Implementation of the SD instruction.
-template <typename STATE_ACCESS>
+template <bool BREAK_CONDITIONS, typename STATE_ACCESS>
 static FORCE_INLINE execute_status execute_SD(STATE_ACCESS &a, uint64_t &pc, uint64_t mcycle, uint32_t insn) {
     dump_insn(a, pc, insn, "sd");
-    return execute_S<uint64_t>(a, pc, mcycle, insn);
+    return execute_S<BREAK_CONDITIONS, uint64_t>(a, pc, mcycle, insn);
 }
 
-template <typename T, typename STATE_ACCESS>
+template <bool BREAK_CONDITIONS, typename T, typename STATE_ACCESS>
 static FORCE_INLINE execute_status execute_L(STATE_ACCESS &a, uint64_t &pc, uint64_t mcycle, uint32_t insn) {
     const uint64_t vaddr = a.read_x(insn_get_rs1(insn));
     const int32_t imm = insn_I_get_imm(insn);
     T val = 0;
-    if (unlikely(!read_virtual_memory<T>(a, pc, mcycle, vaddr + imm, &val))) {
+    if (unlikely((!read_virtual_memory<BREAK_CONDITIONS, T>(a, pc, mcycle, vaddr + imm, &val)))) {
         return advance_to_raised_exception(a, pc);
     }
     const uint32_t rd = insn_get_rd(insn);
@@ -3063,52 +3105,52 @@ static FORCE_INLINE execute_status execute_L(STATE_ACCESS &a, uint64_t &pc, uint
 }
 
 /// \brief Implementation of the LB instruction.
-template <typename STATE_ACCESS>
+template <bool BREAK_CONDITIONS, typename STATE_ACCESS>
 static FORCE_INLINE execute_status execute_LB(STATE_ACCESS &a, uint64_t &pc, uint64_t mcycle, uint32_t insn) {
     dump_insn(a, pc, insn, "lb");
-    return execute_L<int8_t>(a, pc, mcycle, insn);
+    return execute_L<BREAK_CONDITIONS, int8_t>(a, pc, mcycle, insn);
 }
 
 /// \brief Implementation of the LH instruction.
-template <typename STATE_ACCESS>
+template <bool BREAK_CONDITIONS, typename STATE_ACCESS>
 static FORCE_INLINE execute_status execute_LH(STATE_ACCESS &a, uint64_t &pc, uint64_t mcycle, uint32_t insn) {
     dump_insn(a, pc, insn, "lh");
-    return execute_L<int16_t>(a, pc, mcycle, insn);
+    return execute_L<BREAK_CONDITIONS, int16_t>(a, pc, mcycle, insn);
 }
 
 /// \brief Implementation of the LW instruction.
-template <typename STATE_ACCESS>
+template <bool BREAK_CONDITIONS, typename STATE_ACCESS>
 static FORCE_INLINE execute_status execute_LW(STATE_ACCESS &a, uint64_t &pc, uint64_t mcycle, uint32_t insn) {
     dump_insn(a, pc, insn, "lw");
-    return execute_L<int32_t>(a, pc, mcycle, insn);
+    return execute_L<BREAK_CONDITIONS, int32_t>(a, pc, mcycle, insn);
 }
 
 /// \brief Implementation of the LD instruction.
-template <typename STATE_ACCESS>
+template <bool BREAK_CONDITIONS, typename STATE_ACCESS>
 static FORCE_INLINE execute_status execute_LD(STATE_ACCESS &a, uint64_t &pc, uint64_t mcycle, uint32_t insn) {
     dump_insn(a, pc, insn, "ld");
-    return execute_L<int64_t>(a, pc, mcycle, insn);
+    return execute_L<BREAK_CONDITIONS, int64_t>(a, pc, mcycle, insn);
 }
 
 /// \brief Implementation of the LBU instruction.
-template <typename STATE_ACCESS>
+template <bool BREAK_CONDITIONS, typename STATE_ACCESS>
 static FORCE_INLINE execute_status execute_LBU(STATE_ACCESS &a, uint64_t &pc, uint64_t mcycle, uint32_t insn) {
     dump_insn(a, pc, insn, "lbu");
-    return execute_L<uint8_t>(a, pc, mcycle, insn);
+    return execute_L<BREAK_CONDITIONS, uint8_t>(a, pc, mcycle, insn);
 }
 
 /// \brief Implementation of the LHU instruction.
-template <typename STATE_ACCESS>
+template <bool BREAK_CONDITIONS, typename STATE_ACCESS>
 static FORCE_INLINE execute_status execute_LHU(STATE_ACCESS &a, uint64_t &pc, uint64_t mcycle, uint32_t insn) {
     dump_insn(a, pc, insn, "lhu");
-    return execute_L<uint16_t>(a, pc, mcycle, insn);
+    return execute_L<BREAK_CONDITIONS, uint16_t>(a, pc, mcycle, insn);
 }
 
 /// \brief Implementation of the LWU instruction.
-template <typename STATE_ACCESS>
+template <bool BREAK_CONDITIONS, typename STATE_ACCESS>
 static FORCE_INLINE execute_status execute_LWU(STATE_ACCESS &a, uint64_t &pc, uint64_t mcycle, uint32_t insn) {
     dump_insn(a, pc, insn, "lwu");
-    return execute_L<uint32_t>(a, pc, mcycle, insn);
+    return execute_L<BREAK_CONDITIONS, uint32_t>(a, pc, mcycle, insn);
 }
 
 template <typename STATE_ACCESS, typename F>
@@ -3238,6 +3280,8 @@ static FORCE_INLINE execute_status execute_SFENCE_VMA(STATE_ACCESS &a, uint64_t
     }
     const uint32_t rs1 = insn_get_rs1(insn);
     const uint32_t rs2 = insn_get_rs2(insn);
+    // Every form of SFENCE.VMA also invalidates cached non-leaf PTEs
+    a.flush_page_walk_cache();
     if (rs1 == 0) {
         a.flush_all_tlb();
         INC_COUNTER(a.get_statistics(), tlb_flush_all);
@@ -3293,61 +3337,61 @@ static FORCE_INLINE execute_status execute_SRLIW_SRAIW(STATE_ACCESS &a, uint64_t
     }
 }
 
-template <typename STATE_ACCESS>
+template <bool BREAK_CONDITIONS, typename STATE_ACCESS>
 static FORCE_INLINE execute_status execute_AMO_W(STATE_ACCESS &a, uint64_t &pc, uint64_t mcycle, uint32_t insn) {
     switch (static_cast<insn_AMO_funct7_sr2>(insn_get_funct7_sr2(insn))) {
         case insn_AMO_funct7_sr2::AMOADD:
-            return execute_AMOADD_W(a, pc, mcycle, insn);
+            return execute_AMOADD_W<BREAK_CONDITIONS>(a, pc, mcycle, insn);
         case insn_AMO_funct7_sr2::AMOSWAP:
-            return execute_AMOSWAP_W(a, pc, mcycle, insn);
+            return execute_AMOSWAP_W<BREAK_CONDITIONS>(a, pc, mcycle, insn);
         case insn_AMO_funct7_sr2::LR:
-            return execute_LR_W(a, pc, mcycle, insn);
+            return execute_LR_W<BREAK_CONDITIONS>(a, pc, mcycle, insn);
         case insn_AMO_funct7_sr2::SC:
-            return execute_SC_W(a, pc, mcycle, insn);
+            return execute_SC_W<BREAK_CONDITIONS>(a, pc, mcycle, insn);
         case insn_AMO_funct7_sr2::AMOXOR:
-            return execute_AMOXOR_W(a, pc, mcycle, insn);
+            return execute_AMOXOR_W<BREAK_CONDITIONS>(a, pc, mcycle, insn);
         case insn_AMO_funct7_sr2::AMOOR:
-            return execute_AMOOR_W(a, pc, mcycle, insn);
+            return execute_AMOOR_W<BREAK_CONDITIONS>(a, pc, mcycle, insn);
         case insn_AMO_funct7_sr2::AMOAND:
-            return execute_AMOAND_W(a, pc, mcycle, insn);
+            return execute_AMOAND_W<BREAK_CONDITIONS>(a, pc, mcycle, insn);
         case insn_AMO_funct7_sr2::AMOMIN:
-            return execute_AMOMIN_W(a, pc, mcycle, insn);
+            return execute_AMOMIN_W<BREAK_CONDITIONS>(a, pc, mcycle, insn);
         case insn_AMO_funct7_sr2::AMOMAX:
-            return execute_AMOMAX_W(a, pc, mcycle, insn);
+            return execute_AMOMAX_W<BREAK_CONDITIONS>(a, pc, mcycle, insn);
         case insn_AMO_funct7_sr2::AMOMINU:
-            return execute_AMOMINU_W(a, pc, mcycle, insn);
+            return execute_AMOMINU_W<BREAK_CONDITIONS>(a, pc, mcycle, insn);
         case insn_AMO_funct7_sr2::AMOMAXU:
-            return execute_AMOMAXU_W(a, pc, mcycle, insn);
+            return execute_AMOMAXU_W<BREAK_CONDITIONS>(a, pc, mcycle, insn);
         default:
             return raise_illegal_insn_exception(a, pc, insn);
     }
 }
 
-template <typename STATE_ACCESS>
+template <bool BREAK_CONDITIONS, typename STATE_ACCESS>
 static FORCE_INLINE execute_status execute_AMO_D(STATE_ACCESS &a, uint64_t &pc, uint64_t mcycle, uint32_t insn) {
     switch (static_cast<insn_AMO_funct7_sr2>(insn_get_funct7_sr2(insn))) {
         case insn_AMO_funct7_sr2::AMOADD:
-            return execute_AMOADD_D(a, pc, mcycle, insn);
+            return execute_AMOADD_D<BREAK_CONDITIONS>(a, pc, mcycle, insn);
         case insn_AMO_funct7_sr2::AMOSWAP:
-            return execute_AMOSWAP_D(a, pc, mcycle, insn);
+            return execute_AMOSWAP_D<BREAK_CONDITIONS>(a, pc, mcycle, insn);
         case insn_AMO_funct7_sr2::LR:
-            return execute_LR_D(a, pc, mcycle, insn);
+            return execute_LR_D<BREAK_CONDITIONS>(a, pc, mcycle, insn);
         case insn_AMO_funct7_sr2::SC:
-            return execute_SC_D(a, pc, mcycle, insn);
+            return execute_SC_D<BREAK_CONDITIONS>(a, pc, mcycle, insn);
         case insn_AMO_funct7_sr2::AMOXOR:
-            return execute_AMOXOR_D(a, pc, mcycle, insn);
+            return execute_AMOXOR_D<BREAK_CONDITIONS>(a, pc, mcycle, insn);
         case insn_AMO_funct7_sr2::AMOOR:
-            return execute_AMOOR_D(a, pc, mcycle, insn);
+            return execute_AMOOR_D<BREAK_CONDITIONS>(a, pc, mcycle, insn);
         case insn_AMO_funct7_sr2::AMOAND:
-            return execute_AMOAND_D(a, pc, mcycle, insn);
+            return execute_AMOAND_D<BREAK_CONDITIONS>(a, pc, mcycle, insn);
         case insn_AMO_funct7_sr2::AMOMIN:
-            return execute_AMOMIN_D(a, pc, mcycle, insn);
+            return execute_AMOMIN_D<BREAK_CONDITIONS>(a, pc, mcycle, insn);
         case insn_AMO_funct7_sr2::AMOMAX:
-            return execute_AMOMAX_D(a, pc, mcycle, insn);
+            return execute_AMOMAX_D<BREAK_CONDITIONS>(a, pc, mcycle, insn);
         case insn_AMO_funct7_sr2::AMOMINU:
-            return execute_AMOMINU_D(a, pc, mcycle, insn);
+            return execute_AMOMINU_D<BREAK_CONDITIONS>(a, pc, mcycle, insn);
         case insn_AMO_funct7_sr2::AMOMAXU:
-            return execute_AMOMAXU_D(a, pc, mcycle, insn);
+            return execute_AMOMAXU_D<BREAK_CONDITIONS>(a, pc, mcycle, insn);
         default:
             return raise_illegal_insn_exception(a, pc, insn);
     }
@@ -3607,39 +3651,39 @@ static FORCE_INLINE execute_status execute_float_unary_op_rm(STATE_ACCESS &a, ui
     return advance_to_next_insn(a, pc);
 }
 
-template <typename T, typename STATE_ACCESS>
+template <bool BREAK_CONDITIONS, typename T, typename STATE_ACCESS>
 static FORCE_INLINE execute_status execute_FS(STATE_ACCESS &a, uint64_t &pc, uint64_t mcycle, uint32_t insn) {
     const uint64_t vaddr = a.read_x(insn_get_rs1(insn));
     const int32_t imm = insn_S_get_imm(insn);
     // A narrower n-bit transfer out of the floating-point
     // registers will transfer the lower n bits of the register ignoring the upper FLEN−n bits.
     T val = static_cast<T>(a.read_f(insn_get_rs2(insn)));
-    const execute_status status = write_virtual_memory<T>(a, pc, mcycle, vaddr + imm, val);
+    const execute_status status = write_virtual_memory<BREAK_CONDITIONS, T>(a, pc, mcycle, vaddr + imm, val);
     if (unlikely(status == execute_status::failure)) {
         return advance_to_raised_exception(a, pc);
     }
     return advance_to_next_insn(a, pc, status);
 }
 
-template <typename STATE_ACCESS>
+template <bool BREAK_CONDITIONS, typename STATE_ACCESS>
 static FORCE_INLINE execute_status execute_FSW(STATE_ACCESS &a, uint64_t &pc, uint64_t mcycle, uint32_t insn) {
     dump_insn(a, pc, insn, "fsw");
-    return execute_FS<uint32_t>(a, pc, mcycle, insn);
+    return execute_FS<BREAK_CONDITIONS, uint32_t>(a, pc, mcycle, insn);
 }
 
-template <typename STATE_ACCESS>
+template <bool BREAK_CONDITIONS, typename STATE_ACCESS>
 static FORCE_INLINE execute_status execute_FSD(STATE_ACCESS &a, uint64_t &pc, uint64_t mcycle, uint32_t insn) {
     dump_insn(a, pc, insn, "fsd");
-    return execute_FS<uint64_t>(a, pc, mcycle, insn);
+    return execute_FS<BREAK_CONDITIONS, uint64_t>(a, pc, mcycle, insn);
 }
 
-template <typename T, typename STATE_ACCESS>
+template <bool BREAK_CONDITIONS, typename T, typename STATE_ACCESS>
 static FORCE_INLINE execute_status execute_FL(STATE_ACCESS &a, uint64_t &pc, uint64_t mcycle, uint32_t insn) {
     // Loads the float value from virtual memory
     const uint64_t vaddr = a.read_x(insn_get_rs1(insn));
     const int32_t imm = insn_I_get_imm(insn);
     T val = 0;
-    if (unlikely(!read_virtual_memory(a, pc, mcycle, vaddr + imm, &val))) {
+    if (unlikely(!read_virtual_memory<BREAK_CONDITIONS>(a, pc, mcycle, vaddr + imm, &val))) {
         return advance_to_raised_exception(a, pc);
     }
     // A narrower n-bit transfer, n < FLEN,
@@ -3649,16 +3693,16 @@ static FORCE_INLINE execute_status execute_FL(STATE_ACCESS &a, uint64_t &pc, uin
     return advance_to_next_insn(a, pc);
 }
 
-template <typename STATE_ACCESS>
+template <bool BREAK_CONDITIONS, typename STATE_ACCESS>
 static FORCE_INLINE execute_status execute_FLW(STATE_ACCESS &a, uint64_t &pc, uint64_t mcycle, uint32_t insn) {
     dump_insn(a, pc, insn, "flw");
-    return execute_FL<uint32_t>(a, pc, mcycle, insn);
+    return execute_FL<BREAK_CONDITIONS, uint32_t>(a, pc, mcycle, insn);
 }
 
-template <typename STATE_ACCESS>
+template <bool BREAK_CONDITIONS, typename STATE_ACCESS>
 static FORCE_INLINE execute_status execute_FLD(STATE_ACCESS &a, uint64_t &pc, uint64_t mcycle, uint32_t insn) {
     dump_insn(a, pc, insn, "fld");
-    return execute_FL<uint64_t>(a, pc, mcycle, insn);
+    return execute_FL<BREAK_CONDITIONS, uint64_t>(a, pc, mcycle, insn);
 }
 
 template <typename STATE_ACCESS>
@@ -4530,12 +4574,12 @@ static FORCE_INLINE execute_status execute_FD(STATE_ACCESS &a, uint64_t &pc, uin
     }
 }
 
-template <typename T, typename STATE_ACCESS>
+template <bool BREAK_CONDITIONS, typename T, typename STATE_ACCESS>
 static FORCE_INLINE execute_status execute_C_L(STATE_ACCESS &a, uint64_t &pc, uint64_t mcycle, uint32_t rd,
     uint32_t rs1, int32_t imm) {
     const uint64_t vaddr = a.read_x(rs1);
     T val = 0;
-    if (unlikely(!read_virtual_memory<T>(a, pc, mcycle, vaddr + imm, &val))) {
+    if (unlikely((!read_virtual_memory<BREAK_CONDITIONS, T>(a, pc, mcycle, vaddr + imm, &val)))) {
         return advance_to_raised_exception(a, pc);
     }
     // This static branch is eliminated by the compiler
@@ -4547,25 +4591,25 @@ static FORCE_INLINE execute_status execute_C_L(STATE_ACCESS &a, uint64_t &pc, ui
     return advance_to_next_insn<2>(a, pc);
 }
 
-template <typename T, typename STATE_ACCESS>
+template <bool BREAK_CONDITIONS, typename T, typename STATE_ACCESS>
 static FORCE_INLINE execute_status execute_C_S(STATE_ACCESS &a, uint64_t &pc, uint64_t mcycle, uint32_t rs2,
     uint32_t rs1, int32_t imm) {
     const uint64_t vaddr = a.read_x(rs1);
     const uint64_t val = a.read_x(rs2);
-    const execute_status status = write_virtual_memory<T>(a, pc, mcycle, vaddr + imm, val);
+    const execute_status status = write_virtual_memory<BREAK_CONDITIONS, T>(a, pc, mcycle, vaddr + imm, val);
     if (unlikely(status == execute_status::failure)) {
         return advance_to_raised_exception(a, pc);
     }
     return advance_to_next_insn<2>(a, pc, status);
 }
 
-template <typename T, typename STATE_ACCESS>
+template <bool BREAK_CONDITIONS, typename T, typename STATE_ACCESS>
 static FORCE_INLINE execute_status execute_C_FL(STATE_ACCESS &a, uint64_t &pc, uint64_t mcycle, uint32_t rd,
     uint32_t rs1, int32_t imm) {
     // Loads the float value from virtual memory
     const uint64_t vaddr = a.read_x(rs1);
     T val = 0;
-    if (unlikely(!read_virtual_memory(a, pc, mcycle, vaddr + imm, &val))) {
+    if (unlikely(!read_virtual_memory<BREAK_CONDITIONS>(a, pc, mcycle, vaddr + imm, &val))) {
         return advance_to_raised_exception(a, pc);
     }
     // A narrower n-bit transfer, n < FLEN,
@@ -4574,14 +4618,14 @@ static FORCE_INLINE execute_status execute_C_FL(STATE_ACCESS &a, uint64_t &pc, u
     return advance_to_next_insn<2>(a, pc);
 }
 
-template <typename T, typename STATE_ACCESS>
+template <bool BREAK_CONDITIONS, typename T, typename STATE_ACCESS>
 static FORCE_INLINE execute_status execute_C_FS(STATE_ACCESS &a, uint64_t &pc, uint64_t mcycle, uint32_t rs2,
     uint32_t rs1, int32_t imm) {
     const uint64_t vaddr = a.read_x(rs1);
     // A narrower n-bit transfer out of the floating-point
     // registers will transfer the lower n bits of the register ignoring the upper FLEN−n bits.
     T val = static_cast<T>(a.read_f(rs2));
-    const execute_status status = write_virtual_memory<T>(a, pc, mcycle, vaddr + imm, val);
+    const execute_status status = write_virtual_memory<BREAK_CONDITIONS, T>(a, pc, mcycle, vaddr + imm, val);
     if (unlikely(status == execute_status::failure)) {
         return advance_to_raised_exception(a, pc);
     }
@@ -4610,63 +4654,63 @@ static FORCE_INLINE execute_status execute_C_ADDI4SPN(STATE_ACCESS &a, uint64_t
 }
 
 /// \brief Implementation of the C.FLD instruction.
-template <typename STATE_ACCESS>
+template <bool BREAK_CONDITIONS, typename STATE_ACCESS>
 static FORCE_INLINE execute_status execute_C_FLD(STATE_ACCESS &a, uint64_t &pc, uint64_t mcycle, uint32_t insn) {
     dump_insn(a, pc, insn, "c.fld");
     const uint32_t rd = insn_get_CIW_CL_rd_CS_CA_rs2(insn);
     const uint32_t rs1 = insn_get_CL_CS_CA_CB_rs1(insn);
     const int32_t imm = insn_get_CL_CS_imm(insn);
-    return execute_C_FL<uint64_t>(a, pc, mcycle, rd, rs1, imm);
+    return execute_C_FL<BREAK_CONDITIONS, uint64_t>(a, pc, mcycle, rd, rs1, imm);
 }
 
 /// \brief Implementation of the C.LW instruction.
-template <typename STATE_ACCESS>
+template <bool BREAK_CONDITIONS, typename STATE_ACCESS>
 static FORCE_INLINE execute_status execute_C_LW(STATE_ACCESS &a, uint64_t &pc, uint64_t mcycle, uint32_t insn) {
     dump_insn(a, pc, insn, "c.lw");
     const uint32_t rd = insn_get_CIW_CL_rd_CS_CA_rs2(insn);
     const uint32_t rs1 = insn_get_CL_CS_CA_CB_rs1(insn);
     const int32_t imm = insn_get_C_LW_C_SW_imm(insn);
-    return execute_C_L<int32_t>(a, pc, mcycle, rd, rs1, imm);
+    return execute_C_L<BREAK_CONDITIONS, int32_t>(a, pc, mcycle, rd, rs1, imm);
 }
 
 /// \brief Implementation of the C.LD instruction.
-template <typename STATE_ACCESS>
+template <bool BREAK_CONDITIONS, typename STATE_ACCESS>
 static FORCE_INLINE execute_status execute_C_LD(STATE_ACCESS &a, uint64_t &pc, uint64_t mcycle, uint32_t insn) {
     dump_insn(a, pc, insn, "c.ld");
     const uint32_t rd = insn_get_CIW_CL_rd_CS_CA_rs2(insn);
     const uint32_t rs1 = insn_get_CL_CS_CA_CB_rs1(insn);
     const int32_t imm = insn_get_CL_CS_imm(insn);
-    return execute_C_L<int64_t>(a, pc, mcycle, rd, rs1, imm);
+    return execute_C_L<BREAK_CONDITIONS, int64_t>(a, pc, mcycle, rd, rs1, imm);
 }
 
 /// \brief Implementation of the C.FSD instruction.
-template <typename STATE_ACCESS>
+template <bool BREAK_CONDITIONS, typename STATE_ACCESS>
 static FORCE_INLINE execute_status execute_C_FSD(STATE_ACCESS &a, uint64_t &pc, uint64_t mcycle, uint32_t insn) {
     dump_insn(a, pc, insn, "c.fsd");
     const uint32_t rs1 = insn_get_CL_CS_CA_CB_rs1(insn);
     const uint32_t rs2 = insn_get_CIW_CL_rd_CS_CA_rs2(insn);
     const int32_t imm = insn_get_CL_CS_imm(insn);
-    return execute_C_FS<uint64_t>(a, pc, mcycle, rs2, rs1, imm);
+    return execute_C_FS<BREAK_CONDITIONS, uint64_t>(a, pc, mcycle, rs2, rs1, imm);
 }
 
 /// \brief Implementation of the C.SW instruction.
-template <typename STATE_ACCESS>
+template <bool BREAK_CONDITIONS, typename STATE_ACCESS>
 static FORCE_INLINE execute_status execute_C_SW(STATE_ACCESS &a, uint64_t &pc, uint64_t mcycle, uint32_t insn) {
     dump_insn(a, pc, insn, "c.sw");
     const uint32_t rs1 = insn_get_CL_CS_CA_CB_rs1(insn);
     const uint32_t rs2 = insn_get_CIW_CL_rd_CS_CA_rs2(insn);
     const int32_t imm = insn_get_C_LW_C_SW_imm(insn);
-    return execute_C_S<uint32_t>(a, pc, mcycle, rs2, rs1, imm);
+    return execute_C_S<BREAK_CONDITIONS, uint32_t>(a, pc, mcycle, rs2, rs1, imm);
 }
 
 /// \brief Implementation of the C.SD instruction.
-template <typename STATE_ACCESS>
+template <bool BREAK_CONDITIONS, typename STATE_ACCESS>
 static FORCE_INLINE execute_status execute_C_SD(STATE_ACCESS &a, uint64_t &pc, uint64_t mcycle, uint32_t insn) {
     dump_insn(a, pc, insn, "c.sd");
     const uint32_t rs1 = insn_get_CL_CS_CA_CB_rs1(insn);
     const uint32_t rs2 = insn_get_CIW_CL_rd_CS_CA_rs2(insn);
     const int32_t imm = insn_get_CL_CS_imm(insn);
-    return execute_C_S<uint64_t>(a, pc, mcycle, rs2, rs1, imm);
+    return execute_C_S<BREAK_CONDITIONS, uint64_t>(a, pc, mcycle, rs2, rs1, imm);
 }
 
 /// \brief Implementation of the C.NOP instruction.
@@ -4980,16 +5024,16 @@ static FORCE_INLINE execute_status execute_C_SLLI(STATE_ACCESS &a, uint64_t &pc,
 }
 
 /// \brief Implementation of the C.FLDSP instruction.
-template <typename STATE_ACCESS>
+template <bool BREAK_CONDITIONS, typename STATE_ACCESS>
 static FORCE_INLINE execute_status execute_C_FLDSP(STATE_ACCESS &a, uint64_t &pc, uint64_t mcycle, uint32_t insn) {
     dump_insn(a, pc, insn, "c.fldsp");
     const uint32_t rd = insn_get_rd(insn);
     const int32_t imm = insn_get_C_FLDSP_LDSP_imm(insn);
-    return execute_C_FL<uint64_t>(a, pc, mcycle, rd, 0x2, imm);
+    return execute_C_FL<BREAK_CONDITIONS, uint64_t>(a, pc, mcycle, rd, 0x2, imm);
 }
 
 /// \brief Implementation of the C.LWSP instruction.
-template <typename STATE_ACCESS>
+template <bool BREAK_CONDITIONS, typename STATE_ACCESS>
 static FORCE_INLINE execute_status execute_C_LWSP(STATE_ACCESS &a, uint64_t &pc, uint64_t mcycle, uint32_t insn) {
     dump_insn(a, pc, insn, "c.lwsp");
     const uint32_t rd = insn_get_rd(insn);
@@ -4997,11 +5041,11 @@ static FORCE_INLINE execute_status execute_C_LWSP(STATE_ACCESS &a, uint64_t &pc,
         return raise_illegal_insn_exception(a, pc, insn);
     }
     const int32_t imm = insn_get_C_LWSP_imm(insn);
-    return execute_C_L<int32_t>(a, pc, mcycle, rd, 0x2, imm);
+    return execute_C_L<BREAK_CONDITIONS, int32_t>(a, pc, mcycle, rd, 0x2, imm);
 }
 
 /// \brief Implementation of the C.LDSP instruction.
-template <typename STATE_ACCESS>
+template <bool BREAK_CONDITIONS, typename STATE_ACCESS>
 static FORCE_INLINE execute_status execute_C_LDSP(STATE_ACCESS &a, uint64_t &pc, uint64_t mcycle, uint32_t insn) {
     dump_insn(a, pc, insn, "c.ldsp");
     const uint32_t rd = insn_get_rd(insn);
@@ -5009,7 +5053,7 @@ static FORCE_INLINE execute_status execute_C_LDSP(STATE_ACCESS &a, uint64_t &pc,
         return raise_illegal_insn_exception(a, pc, insn);
     }
     const int32_t imm = insn_get_C_FLDSP_LDSP_imm(insn);
-    return execute_C_L<int64_t>(a, pc, mcycle, rd, 0x2, imm);
+    return execute_C_L<BREAK_CONDITIONS, int64_t>(a, pc, mcycle, rd, 0x2, imm);
 }
 
 /// \brief Implementation of the C.JR instruction.
@@ -5092,33 +5136,34 @@ static FORCE_INLINE execute_status execute_C_Q2_SET0(STATE_ACCESS &a, uint64_t &
 }
 
 /// \brief Implementation of the C.FSDSP instruction.
-template <typename STATE_ACCESS>
+template <bool BREAK_CONDITIONS, typename STATE_ACCESS>
 static FORCE_INLINE execute_status execute_C_FSDSP(STATE_ACCESS &a, uint64_t &pc, uint64_t mcycle, uint32_t insn) {
     dump_insn(a, pc, insn, "c.fsdsp");
     const uint32_t rs2 = insn_get_CR_CSS_rs2(insn);
     const int32_t imm = insn_get_C_FSDSP_SDSP_imm(insn);
-    return execute_C_FS<uint64_t>(a, pc, mcycle, rs2, 0x2, imm);
+    return execute_C_FS<BREAK_CONDITIONS, uint64_t>(a, pc, mcycle, rs2, 0x2, imm);
 }
 
 /// \brief Implementation of the C.SWSP instruction.
-template <typename STATE_ACCESS>
+template <bool BREAK_CONDITIONS, typename STATE_ACCESS>
 static FORCE_INLINE execute_status execute_C_SWSP(STATE_ACCESS &a, uint64_t &pc, uint64_t mcycle, uint32_t insn) {
     dump_insn(a, pc, insn, "c.swsp");
     const uint32_t rs2 = insn_get_CR_CSS_rs2(insn);
     const int32_t imm = insn_get_C_SWSP_imm(insn);
-    return execute_C_S<uint32_t>(a, pc, mcycle, rs2, 0x2, imm);
+    return execute_C_S<BREAK_CONDITIONS, uint32_t>(a, pc, mcycle, rs2, 0x2, imm);
 }
 
 /// \brief Implementation of the C.SDSP instruction.
-template <typename STATE_ACCESS>
+template <bool BREAK_CONDITIONS, typename STATE_ACCESS>
 static FORCE_INLINE execute_status execute_C_SDSP(STATE_ACCESS &a, uint64_t &pc, uint64_t mcycle, uint32_t insn) {
     dump_insn(a, pc, insn, "c.sdsp");
     const uint32_t rs2 = insn_get_CR_CSS_rs2(insn);
     const int32_t imm = insn_get_C_FSDSP_SDSP_imm(insn);
-    return execute_C_S<uint64_t>(a, pc, mcycle, rs2, 0x2, imm);
+    return execute_C_S<BREAK_CONDITIONS, uint64_t>(a, pc, mcycle, rs2, 0x2, imm);
 }
 
 /// \brief Decodes and executes an instruction.
+/// \tparam BREAK_CONDITIONS True if the run must stop on break conditions.
 /// \tparam STATE_ACCESS Class of machine state accessor object.
 /// \param a Machine state accessor object.
 /// \param pc Current pc.
@@ -5130,7 +5175,7 @@ static FORCE_INLINE execute_status execute_C_SDSP(STATE_ACCESS &a, uint64_t &pc,
 ///  See [RV32/64G Instruction Set
 ///  Listings](https://content.riscv.org/wp-content/uploads/2017/05/riscv-spec-v2.2.pdf#chapter.19) and [Instruction
 ///  listings for RISC-V](https://content.riscv.org/wp-content/uploads/2017/05/riscv-spec-v2.2.pdf#table.19.2).
-template <typename STATE_ACCESS>
+template <bool BREAK_CONDITIONS, typename STATE_ACCESS>
 static FORCE_INLINE execute_status execute_insn(STATE_ACCESS &a, uint64_t &pc, uint64_t &mcycle, uint32_t insn) {
     // Is compressed instruction
     if ((insn & 3) != 3) {
@@ -5142,13 +5187,13 @@ static FORCE_INLINE execute_status execute_insn(STATE_ACCESS &a, uint64_t &pc, u
             case insn_c_funct3::C_ADDI4SPN:
                 return execute_C_ADDI4SPN(a, pc, insn);
             case insn_c_funct3::C_LW:
-                return execute_C_LW(a, pc, mcycle, insn);
+                return execute_C_LW<BREAK_CONDITIONS>(a, pc, mcycle, insn);
             case insn_c_funct3::C_LD:
-                return execute_C_LD(a, pc, mcycle, insn);
+                return execute_C_LD<BREAK_CONDITIONS>(a, pc, mcycle, insn);
             case insn_c_funct3::C_SW:
-                return execute_C_SW(a, pc, mcycle, insn);
+                return execute_C_SW<BREAK_CONDITIONS>(a, pc, mcycle, insn);
             case insn_c_funct3::C_SD:
-                return execute_C_SD(a, pc, mcycle, insn);
+                return execute_C_SD<BREAK_CONDITIONS>(a, pc, mcycle, insn);
             case insn_c_funct3::C_Q1_SET0:
                 return execute_C_Q1_SET0(a, pc, insn);
             case insn_c_funct3::C_ADDIW:
@@ -5168,15 +5213,15 @@ static FORCE_INLINE execute_status execute_insn(STATE_ACCESS &a, uint64_t &pc, u
             case insn_c_funct3::C_SLLI:
                 return execute_C_SLLI(a, pc, insn);
             case insn_c_funct3::C_LWSP:
-                return execute_C_LWSP(a, pc, mcycle, insn);
+                return execute_C_LWSP<BREAK_CONDITIONS>(a, pc, mcycle, insn);
             case insn_c_funct3::C_LDSP:
-                return execute_C_LDSP(a, pc, mcycle, insn);
+                return execute_C_LDSP<BREAK_CONDITIONS>(a, pc, mcycle, insn);
             case insn_c_funct3::C_Q2_SET0:
                 return execute_C_Q2_SET0(a, pc, insn);
             case insn_c_funct3::C_SWSP:
-                return execute_C_SWSP(a, pc, mcycle, insn);
+                return execute_C_SWSP<BREAK_CONDITIONS>(a, pc, mcycle, insn);
             case insn_c_funct3::C_SDSP:
-                return execute_C_SDSP(a, pc, mcycle, insn);
+                return execute_C_SDSP<BREAK_CONDITIONS>(a, pc, mcycle, insn);
             default: {
                 // Here we are sure that the next instruction, at best, can only be a floating point instruction,
                 // or, at worst, an illegal instruction.
@@ -5189,13 +5234,13 @@ static FORCE_INLINE execute_status execute_insn(STATE_ACCESS &a, uint64_t &pc, u
                 }
                 switch (c_funct3) {
                     case insn_c_funct3::C_FLD:
-                        return execute_C_FLD(a, pc, mcycle, insn);
+                        return execute_C_FLD<BREAK_CONDITIONS>(a, pc, mcycle, insn);
                     case insn_c_funct3::C_FSD:
-                        return execute_C_FSD(a, pc, mcycle, insn);
+                        return execute_C_FSD<BREAK_CONDITIONS>(a, pc, mcycle, insn);
                     case insn_c_funct3::C_FLDSP:
-                        return execute_C_FLDSP(a, pc, mcycle, insn);
+                        return execute_C_FLDSP<BREAK_CONDITIONS>(a, pc, mcycle, insn);
                     case insn_c_funct3::C_FSDSP:
-                        return execute_C_FSDSP(a, pc, mcycle, insn);
+                        return execute_C_FSDSP<BREAK_CONDITIONS>(a, pc, mcycle, insn);
                     default:
                         return raise_illegal_insn_exception(a, pc, insn);
                 }
@@ -5207,27 +5252,27 @@ static FORCE_INLINE execute_status execute_insn(STATE_ACCESS &a, uint64_t &pc, u
         auto funct3_00000_opcode = static_cast<insn_funct3_00000_opcode>(insn_get_funct3_00000_opcode(insn));
         switch (funct3_00000_opcode) {
             case insn_funct3_00000_opcode::LB:
-                return execute_LB(a, pc, mcycle, insn);
+                return execute_LB<BREAK_CONDITIONS>(a, pc, mcycle, insn);
             case insn_funct3_00000_opcode::LH:
-                return execute_LH(a, pc, mcycle, insn);
+                return execute_LH<BREAK_CONDITIONS>(a, pc, mcycle, insn);
             case insn_funct3_00000_opcode::LW:
-                return execute_LW(a, pc, mcycle, insn);
+                return execute_LW<BREAK_CONDITIONS>(a, pc, mcycle, insn);
             case insn_funct3_00000_opcode::LD:
-                return execute_LD(a, pc, mcycle, insn);
+                return execute_LD<BREAK_CONDITIONS>(a, pc, mcycle, insn);
             case insn_funct3_00000_opcode::LBU:
-                return execute_LBU(a, pc, mcycle, insn);
+                return execute_LBU<BREAK_CONDITIONS>(a, pc, mcycle, insn);
             case insn_funct3_00000_opcode::LHU:
-                return execute_LHU(a, pc, mcycle, insn);
+                return execute_LHU<BREAK_CONDITIONS>(a, pc, mcycle, insn);
             case insn_funct3_00000_opcode::LWU:
-                return execute_LWU(a, pc, mcycle, insn);
+                return execute_LWU<BREAK_CONDITIONS>(a, pc, mcycle, insn);
             case insn_funct3_00000_opcode::SB:
-                return execute_SB(a, pc, mcycle, insn);
+                return execute_SB<BREAK_CONDITIONS>(a, pc, mcycle, insn);
             case insn_funct3_00000_opcode::SH:
-                return execute_SH(a, pc, mcycle, insn);
+                return execute_SH<BREAK_CONDITIONS>(a, pc, mcycle, insn);
             case insn_funct3_00000_opcode::SW:
-                return execute_SW(a, pc, mcycle, insn);
+                return execute_SW<BREAK_CONDITIONS>(a, pc, mcycle, insn);
             case insn_funct3_00000_opcode::SD:
-                return execute_SD(a, pc, mcycle, insn);
+                return execute_SD<BREAK_CONDITIONS>(a, pc, mcycle, insn);
             case insn_funct3_00000_opcode::FENCE:
                 return execute_FENCE(a, pc, insn);
             case insn_funct3_00000_opcode::FENCE_I:
@@ -5316,9 +5361,9 @@ static FORCE_INLINE execute_status execute_insn(STATE_ACCESS &a, uint64_t &pc, u
             case insn_funct3_00000_opcode::SRLIW_SRAIW:
                 return execute_SRLIW_SRAIW(a, pc, insn);
             case insn_funct3_00000_opcode::AMO_W:
-                return execute_AMO_W(a, pc, mcycle, insn);
+                return execute_AMO_W<BREAK_CONDITIONS>(a, pc, mcycle, insn);
             case insn_funct3_00000_opcode::AMO_D:
-                return execute_AMO_D(a, pc, mcycle, insn);
+                return execute_AMO_D<BREAK_CONDITIONS>(a, pc, mcycle, insn);
             case insn_funct3_00000_opcode::ADD_MUL_SUB:
                 return execute_ADD_MUL_SUB(a, pc, insn);
             case insn_funct3_00000_opcode::SLL_MULH:
@@ -5352,13 +5397,13 @@ static FORCE_INLINE execute_status execute_insn(STATE_ACCESS &a, uint64_t &pc, u
                 }
                 switch (funct3_00000_opcode) {
                     case insn_funct3_00000_opcode::FSW:
-                        return execute_FSW(a, pc, mcycle, insn);
+                        return execute_FSW<BREAK_CONDITIONS>(a, pc, mcycle, insn);
                     case insn_funct3_00000_opcode::FSD:
-                        return execute_FSD(a, pc, mcycle, insn);
+                        return execute_FSD<BREAK_CONDITIONS>(a, pc, mcycle, insn);
                     case insn_funct3_00000_opcode::FLW:
-                        return execute_FLW(a, pc, mcycle, insn);
+                        return execute_FLW<BREAK_CONDITIONS>(a, pc, mcycle, insn);
                     case insn_funct3_00000_opcode::FLD:
-                        return execute_FLD(a, pc, mcycle, insn);
+                        return execute_FLD<BREAK_CONDITIONS>(a, pc, mcycle, insn);
                     case insn_funct3_00000_opcode::FMADD_RNE:
                     case insn_funct3_00000_opcode::FMADD_RTZ:
                     case insn_funct3_00000_opcode::FMADD_RDN:
@@ -5404,8 +5449,9 @@ static FORCE_INLINE execute_status execute_insn(STATE_ACCESS &a, uint64_t &pc, u
 
 /// \brief Instruction fetch status code
 enum class fetch_status : int {
-    exception, ///< Instruction fetch failed: exception raised
-    success    ///< Instruction fetch succeeded: proceed to execute
+    exception,  ///< Instruction fetch failed: exception raised
+    success,    ///< Instruction fetch succeeded: proceed to execute
+    breakpoint, ///< Instruction has a breakpoint: stop before executing
 };
 
 /// \brief Translate fetch pc to a host pointer (slow path that goes through virtual address translation).
@@ -5460,32 +5506,170 @@ static FORCE_INLINE fetch_status fetch_translate_pc(STATE_ACCESS &a, uint64_t &p
     return fetch_status::success;
 }
 
+/// \brief Number of code pages kept in the fetch translation cache
+/// \details Redefine to compare sizes with tests/misc/benchmark-fetch-cache.cpp. The last fetched page is always kept
+/// in the interpreter loop variables, and larger sizes add a direct-mapped array of recently fetched pages behind it.
+#ifndef FETCH_CACHE_SIZE
+#define FETCH_CACHE_SIZE 1
+#endif
+
+/// \brief Translations of recently fetched code pages, looked up when the last fetched page does not match.
+/// \details Entries are direct-mapped by the low bits of the virtual page number. These are also the low bits of the
+/// code TLB index, so the TLB entry evicted by filling a page can only be cached in the entry the page itself
+/// replaces. The last fetched page, when valid, is always a copy of its entry here. With a single entry, this array is
+/// never accessed, so the interpreter loop only keeps the last fetched page.
+struct fetch_cache {
+    static constexpr uint64_t size = FETCH_CACHE_SIZE;
+    static_assert(size > 0 && (size & (size - 1)) == 0 && size <= PMA_TLB_SIZE,
+        "fetch cache size must be a power of 2 no larger than the TLB");
+
+    // NOLINTBEGIN(cppcoreguidelines-avoid-c-arrays,modernize-avoid-c-arrays)
+    uint64_t vaddr_page[size]; ///< Virtual page of each entry, or PAGE_OFFSET_MASK when invalid
+    uint64_t vh_offset[size];  ///< Offset from virtual to host address of each entry
+    // NOLINTEND(cppcoreguidelines-avoid-c-arrays,modernize-avoid-c-arrays)
+
+    FORCE_INLINE fetch_cache() {
+        for (uint64_t i = 0; i < size; ++i) {
+            vaddr_page[i] = PAGE_OFFSET_MASK;
+            vh_offset[i] = 0;
+        }
+    }
+
+    /// \brief Obtains the entry that may hold a virtual page.
+    static FORCE_INLINE uint64_t get_index(uint64_t vaddr_page) {
+        return (vaddr_page >> LOG2_PAGE_SIZE) & (size - 1);
+    }
+
+    /// \brief Looks up a virtual page, making it the last fetched page on hit.
+    FORCE_INLINE bool lookup(uint64_t vaddr_page_in, uint64_t &fetch_vaddr_page, uint64_t &fetch_vh_offset) const {
+        if constexpr (size > 1) {
+            const uint64_t i = get_index(vaddr_page_in);
+            if (vaddr_page[i] == vaddr_page_in) {
+                fetch_vaddr_page = vaddr_page_in;
+                fetch_vh_offset = vh_offset[i];
+                return true;
+            }
+        } else {
+            (void) vaddr_page_in;
+            (void) fetch_vaddr_page;
+            (void) fetch_vh_offset;
+        }
+        return false;
+    }
+
+    /// \brief Replaces the entry of a virtual page with the last fetched page, which may be invalid.
+    FORCE_INLINE void replace(uint64_t vaddr_page_in, uint64_t fetch_vaddr_page, uint64_t fetch_vh_offset) {
+        if constexpr (size > 1) {
+            const uint64_t i = get_index(vaddr_page_in);
+            vaddr_page[i] = fetch_vaddr_page;
+            vh_offset[i] = fetch_vh_offset;
+        } else {
+            (void) vaddr_page_in;
+            (void) fetch_vaddr_page;
+            (void) fetch_vh_offset;
+        }
+    }
+};
+
+/// \brief Checks if the translation of a virtual page can be kept in the fetch translation cache.
+/// \tparam BREAK_CONDITIONS True if the run must stop on break conditions.
+/// \tparam STATE_ACCESS Class of machine state accessor object.
+/// \param a Machine state accessor object.
+/// \param vaddr_page Virtual address of page.
+/// \return False if the page has breakpoints, true otherwise.
+template <bool BREAK_CONDITIONS, typename STATE_ACCESS>
+static FORCE_INLINE bool is_fetch_page_cacheable(STATE_ACCESS &a, uint64_t vaddr_page) {
+    if constexpr (BREAK_CONDITIONS) {
+        return !a.is_breakpoint_page(vaddr_page);
+    } else {
+        (void) a;
+        (void) vaddr_page;
+        return true;
+    }
+}
+
+/// \brief Invalidates the fetch translation cache entries whose translation the code TLB no longer holds.
+/// \tparam STATE_ACCESS Class of machine state accessor object.
+/// \param a Machine state accessor object.
+/// \param fetch_vaddr_page Fetch virtual address translation page cache.
+/// \param fetch_vh_offset Fetch virtual address host pointer offset cache.
+/// \param fc Translations of other recently fetched pages.
+/// \details The code TLB is flushed by privilege level changes, SFENCE.VMA and satp writes, and the cache must
+/// never hold a page the TLB does not, so running with or without the cache leaves the TLB in the same state.
+/// In the microarchitecture, which executes a single instruction per run, the cache is simply invalidated.
+template <typename STATE_ACCESS>
+static FORCE_INLINE void revalidate_fetch_cache(STATE_ACCESS &a, uint64_t &fetch_vaddr_page,
+    uint64_t fetch_vh_offset, fetch_cache &fc) {
+#ifdef MICROARCHITECTURE
+    (void) a;
+    (void) fetch_vh_offset;
+    (void) fc;
+    fetch_vaddr_page = PAGE_OFFSET_MASK;
+#else
+    unsigned char *hptr = nullptr;
+    const bool hit = a.template translate_vaddr_via_tlb<TLB_CODE, uint16_t>(fetch_vaddr_page, &hptr);
+    if (unlikely(!hit || cast_ptr_to_addr<uint64_t>(hptr) != fetch_vaddr_page + fetch_vh_offset)) {
+        INC_COUNTER(a.get_statistics(), fetch_cache_flush);
+        fetch_vaddr_page = PAGE_OFFSET_MASK;
+    }
+    if constexpr (fetch_cache::size > 1) {
+        for (uint64_t i = 0; i < fetch_cache::size; ++i) {
+            const uint64_t vaddr_page = fc.vaddr_page[i];
+            if (vaddr_page != PAGE_OFFSET_MASK &&
+                (!a.template translate_vaddr_via_tlb<TLB_CODE, uint16_t>(vaddr_page, &hptr) ||
+                    cast_ptr_to_addr<uint64_t>(hptr) != vaddr_page + fc.vh_offset[i])) {
+                INC_COUNTER(a.get_statistics(), fetch_cache_flush);
+                fc.vaddr_page[i] = PAGE_OFFSET_MASK;
+            }
+        }
+    } else {
+        (void) fc;
+    }
+#endif
+}
+
 /// \brief Loads the next instruction.
+/// \tparam BREAK_CONDITIONS True if the run must stop on break conditions.
 /// \tparam STATE_ACCESS Class of machine state accessor object.
 /// \param a Machine state accessor object.
 /// \param pc Virtual address for the current instruction being executed.
+/// \param mcycle Current machine mcycle.
 /// \param insn Receives the instruction.
 /// \param fetch_vaddr_page Fetch virtual address translation page cache.
 /// \param fetch_vh_offset Fetch virtual address host pointer offset cache.
+/// \param fc Translations of other recently fetched pages.
 /// \return Returns fetch_status::success if load succeeded, fetch_status::exception if it caused an exception.
-//          In that case, raise the exception.
-template <typename STATE_ACCESS>
-static FORCE_INLINE fetch_status fetch_insn(STATE_ACCESS &a, uint64_t &pc, uint32_t &insn, uint64_t &fetch_vaddr_page,
-    uint64_t &fetch_vh_offset) {
+//          In that case, raise the exception. Returns fetch_status::breakpoint if the instruction has a breakpoint.
+template <bool BREAK_CONDITIONS, typename STATE_ACCESS>
+static FORCE_INLINE fetch_status fetch_insn(STATE_ACCESS &a, uint64_t &pc, uint64_t mcycle, uint32_t &insn,
+    uint64_t &fetch_vaddr_page, uint64_t &fetch_vh_offset, fetch_cache &fc) {
     unsigned char *hptr = nullptr;
     const uint64_t vaddr_page = pc & ~PAGE_OFFSET_MASK;
-    // If pc is in the same page as the last pc fetch,
-    // we can just reuse last fetch translation, skipping TLB or slow address translation altogether.
-    if (likely(vaddr_page == fetch_vaddr_page)) {
+    // If pc is in the same page as the last pc fetch, or in another recently fetched page,
+    // we can just reuse that fetch translation, skipping TLB or slow address translation altogether.
+    if (likely(vaddr_page == fetch_vaddr_page || fc.lookup(vaddr_page, fetch_vaddr_page, fetch_vh_offset))) {
         hptr = cast_addr_to_ptr<unsigned char *>(pc + fetch_vh_offset);
     } else {
+        // Pages with breakpoints are never kept in the fetch translation cache, so they are checked here
+        if constexpr (BREAK_CONDITIONS) {
+            if (unlikely(a.check_breakpoint(pc, mcycle))) {
+                return fetch_status::breakpoint;
+            }
+        }
         // Not in the same page as last the fetch, we need to perform address translation
         if (unlikely(fetch_translate_pc(a, pc, pc, &hptr) == fetch_status::exception)) {
             return fetch_status::exception;
         }
-        // Update fetch address translation cache
-        fetch_vaddr_page = vaddr_page;
-        fetch_vh_offset = cast_ptr_to_addr<uint64_t>(hptr) - pc;
+        // Update fetch address translation cache.
+        // Pages that cannot be cached still invalidate their entry, because filling their code TLB entry may have
+        // evicted the page cached there from the TLB.
+        if (likely(is_fetch_page_cacheable<BREAK_CONDITIONS>(a, vaddr_page))) {
+            fetch_vaddr_page = vaddr_page;
+            fetch_vh_offset = cast_ptr_to_addr<uint64_t>(hptr) - pc;
+        } else {
+            fetch_vaddr_page = PAGE_OFFSET_MASK;
+        }
+        fc.replace(vaddr_page, fetch_vaddr_page, fetch_vh_offset);
     }
     // The following code assumes pc is always 2-byte aligned, this is guaranteed by RISC-V spec.
     // If pc is pointing to the very last 2 bytes of a page, it's crossing a page boundary.
@@ -5500,8 +5684,13 @@ static FORCE_INLINE fetch_status fetch_insn(STATE_ACCESS &a, uint64_t &pc, uint3
                 return fetch_status::exception;
             }
             // Update fetch translation cache
-            fetch_vaddr_page = vaddr & ~PAGE_OFFSET_MASK;
-            fetch_vh_offset = cast_ptr_to_addr<uint64_t>(hptr) - vaddr;
+            if (likely(is_fetch_page_cacheable<BREAK_CONDITIONS>(a, vaddr & ~PAGE_OFFSET_MASK))) {
+                fetch_vaddr_page = vaddr & ~PAGE_OFFSET_MASK;
+                fetch_vh_offset = cast_ptr_to_addr<uint64_t>(hptr) - vaddr;
+            } else {
+                fetch_vaddr_page = PAGE_OFFSET_MASK;
+            }
+            fc.replace(vaddr & ~PAGE_OFFSET_MASK, fetch_vaddr_page, fetch_vh_offset);
             // Produce the final 4-byte instruction
             insn |= aliased_aligned_read<uint16_t>(hptr) << 16;
         }
@@ -5516,6 +5705,266 @@ static FORCE_INLINE fetch_status fetch_insn(STATE_ACCESS &a, uint64_t &pc, uint3
     return fetch_status::success;
 }
 
+/// \brief Checks if an instruction can start a fused instruction pair.
+/// \param insn Instruction.
+/// \return True if insn is a LUI, AUIPC, SLLI, SLT or SLTU instruction.
+static FORCE_INLINE bool is_fused_pair_head(uint32_t insn) {
+    switch (static_cast<insn_funct3_00000_opcode>(insn_get_funct3_00000_opcode(insn))) {
+        case insn_funct3_00000_opcode::LUI_000:
+        case insn_funct3_00000_opcode::LUI_001:
+        case insn_funct3_00000_opcode::LUI_010:
+        case insn_funct3_00000_opcode::LUI_011:
+        case insn_funct3_00000_opcode::LUI_100:
+        case insn_funct3_00000_opcode::LUI_101:
+        case insn_funct3_00000_opcode::LUI_110:
+        case insn_funct3_00000_opcode::LUI_111:
+        case insn_funct3_00000_opcode::AUIPC_000:
+        case insn_funct3_00000_opcode::AUIPC_001:
+        case insn_funct3_00000_opcode::AUIPC_010:
+        case insn_funct3_00000_opcode::AUIPC_011:
+        case insn_funct3_00000_opcode::AUIPC_100:
+        case insn_funct3_00000_opcode::AUIPC_101:
+        case insn_funct3_00000_opcode::AUIPC_110:
+        case insn_funct3_00000_opcode::AUIPC_111:
+        case insn_funct3_00000_opcode::SLLI:
+        case insn_funct3_00000_opcode::SLT_MULHSU:
+        case insn_funct3_00000_opcode::SLTU_MULHU:
+            return true;
+        default:
+            return false;
+    }
+}
+
+/// \brief Executes a pair of instructions as a single fused operation, if they form one of the supported idioms.
+/// \tparam BREAK_CONDITIONS True if the run must stop on break conditions.
+/// \tparam STATE_ACCESS Class of machine state accessor object.
+/// \param a Machine state accessor object.
+/// \param pc Interpreter loop program counter (will be overwritten).
+/// \param mcycle Interpreter loop machine cycle (incremented for the first instruction of the pair).
+/// \param insn First instruction of the pair.
+/// \param next_insn Instruction that follows insn in memory.
+/// \param status Receives the execute status of the second instruction.
+/// \return True if the pair was executed, false if the instructions do not form a supported idiom.
+/// \details The supported idioms are the sequences compilers emit most often: LUI+ADDI(W) and AUIPC+ADDI
+/// materialize constants and addresses, AUIPC+JALR performs far calls, AUIPC+LD/LW loads globals, SLLI+SRLI
+/// zero-extends and SLT(U)+BEQZ/BNEZ compares and branches. The first instruction of each pair can never raise an
+/// exception, and the second one reads the register written by the first. The result is exactly the same as
+/// executing both instructions one after the other.
+template <bool BREAK_CONDITIONS, typename STATE_ACCESS>
+static FORCE_INLINE bool execute_fused_pair(STATE_ACCESS &a, uint64_t &pc, uint64_t &mcycle, uint32_t insn,
+    uint32_t next_insn, execute_status &status) {
+    const uint32_t rd = insn_get_rd(insn);
+    if (unlikely(rd == 0) || insn_get_rs1(next_insn) != rd) {
+        return false;
+    }
+    const auto next_funct3_00000_opcode =
+        static_cast<insn_funct3_00000_opcode>(insn_get_funct3_00000_opcode(next_insn));
+    const uint32_t next_rd = insn_get_rd(next_insn);
+    switch (static_cast<insn_funct3_00000_opcode>(insn_get_funct3_00000_opcode(insn))) {
+        case insn_funct3_00000_opcode::SLLI:
+            // SLLI+SRLI with the same destination, both with valid shift amounts
+            if (next_funct3_00000_opcode != insn_funct3_00000_opcode::SRLI_SRAI || next_rd != rd ||
+                insn_get_funct7_sr1(insn) != 0 || insn_get_funct7_sr1(next_insn) != insn_SRLI_SRAI_funct7_sr1::SRLI) {
+                return false;
+            }
+            dump_insn(a, pc, insn, "slli");
+            dump_insn(a, pc + 4, next_insn, "srli");
+            a.write_x(rd,
+                (a.read_x(insn_get_rs1(insn)) << (insn_I_get_uimm(insn) & 0b111111)) >>
+                    (insn_I_get_uimm(next_insn) & 0b111111));
+            pc += 8;
+            break;
+        case insn_funct3_00000_opcode::SLT_MULHSU:
+        case insn_funct3_00000_opcode::SLTU_MULHU: {
+            // SLT(U)+BEQZ/BNEZ on the comparison result
+            if ((next_funct3_00000_opcode != insn_funct3_00000_opcode::BEQ &&
+                    next_funct3_00000_opcode != insn_funct3_00000_opcode::BNE) ||
+                insn_get_rs2(next_insn) != 0 || insn_get_funct7(insn) != 0) {
+                return false;
+            }
+            const uint64_t rs1 = a.read_x(insn_get_rs1(insn));
+            const uint64_t rs2 = a.read_x(insn_get_rs2(insn));
+            bool cond = false;
+            if (insn_get_funct3(insn) == 0b010) {
+                dump_insn(a, pc, insn, "slt");
+                cond = static_cast<int64_t>(rs1) < static_cast<int64_t>(rs2);
+            } else {
+                dump_insn(a, pc, insn, "sltu");
+                cond = rs1 < rs2;
+            }
+            a.write_x(rd, static_cast<uint64_t>(cond));
+            pc += 4;
+            if (next_funct3_00000_opcode == insn_funct3_00000_opcode::BNE) {
+                dump_insn(a, pc, next_insn, "bne");
+            } else {
+                dump_insn(a, pc, next_insn, "beq");
+                cond = !cond;
+            }
+            pc = cond ? static_cast<uint64_t>(static_cast<int64_t>(pc + insn_B_get_imm(next_insn))) : pc + 4;
+            break;
+        }
+        default: {
+            const bool auipc = (insn & 0b1111111) == (static_cast<uint32_t>(insn_funct3_00000_opcode::AUIPC_000));
+            const uint64_t val = (auipc ? pc : 0) + insn_U_get_imm(insn);
+            switch (next_funct3_00000_opcode) {
+                case insn_funct3_00000_opcode::ADDI:
+                case insn_funct3_00000_opcode::ADDIW:
+                    // LUI+ADDI(W) or AUIPC+ADDI with the same destination
+                    if (next_rd != rd ||
+                        (auipc && next_funct3_00000_opcode == insn_funct3_00000_opcode::ADDIW)) {
+                        return false;
+                    }
+                    dump_insn(a, pc, insn, auipc ? "auipc" : "lui");
+                    if (next_funct3_00000_opcode == insn_funct3_00000_opcode::ADDI) {
+                        dump_insn(a, pc + 4, next_insn, "addi");
+                        a.write_x(rd, val + insn_I_get_imm(next_insn));
+                    } else {
+                        dump_insn(a, pc + 4, next_insn, "addiw");
+                        a.write_x(rd,
+                            static_cast<uint64_t>(static_cast<int32_t>(
+                                static_cast<uint32_t>(val) + static_cast<uint32_t>(insn_I_get_imm(next_insn)))));
+                    }
+                    pc += 8;
+                    break;
+                case insn_funct3_00000_opcode::JALR:
+                    // AUIPC+JALR
+                    if (!auipc) {
+                        return false;
+                    }
+                    dump_insn(a, pc, insn, "auipc");
+                    dump_insn(a, pc + 4, next_insn, "jalr");
+                    a.write_x(rd, val);
+                    if (next_rd != 0) {
+                        a.write_x(next_rd, pc + 8);
+                    }
+                    pc = (val + insn_I_get_imm(next_insn)) & ~static_cast<uint64_t>(1);
+                    break;
+                case insn_funct3_00000_opcode::LD:
+                case insn_funct3_00000_opcode::LW:
+                    // AUIPC+LD/LW, the load may raise an exception, so it goes through the regular implementation
+                    if (!auipc) {
+                        return false;
+                    }
+                    dump_insn(a, pc, insn, "auipc");
+                    a.write_x(rd, val);
+                    pc += 4;
+                    ++mcycle;
+                    INC_COUNTER(a.get_statistics(), fused_pair);
+                    status = next_funct3_00000_opcode == insn_funct3_00000_opcode::LD ?
+                        execute_LD<BREAK_CONDITIONS>(a, pc, mcycle, next_insn) :
+                        execute_LW<BREAK_CONDITIONS>(a, pc, mcycle, next_insn);
+                    return true;
+                default:
+                    return false;
+            }
+            break;
+        }
+    }
+    ++mcycle;
+    INC_COUNTER(a.get_statistics(), fused_pair);
+    status = execute_status::success;
+    return true;
+}
+
+/// \brief Fast-forwards an idle loop made of WFI followed by a jump back to it.
+/// \tparam STATE_ACCESS Class of machine state accessor object.
+/// \param a Machine state accessor object.
+/// \param mcycle Interpreter loop machine cycle (advanced by all skipped cycles but the last one).
+/// \param mcycle_tick_end Machine cycle of the next interrupt check.
+/// \param next_insn Instruction that follows WFI in memory.
+/// \return True if the loop was skipped, false if it must be executed normally.
+/// \details In reproducible mode WFI does nothing, so each iteration only advances mcycle by two. No interrupt can
+/// become pending before the next interrupt check, which in this mode is the next timer event, so every iteration
+/// that completes before it is skipped at once. The result is exactly the same as executing the loop.
+template <typename STATE_ACCESS>
+static FORCE_INLINE bool skip_idle_loop(STATE_ACCESS &a, uint64_t &mcycle, uint64_t mcycle_tick_end,
+    uint32_t next_insn) {
+    // Only "j -4" and "c.j -4" jump back to WFI
+    if ((next_insn != UINT32_C(0xffdff06f) && (next_insn & 0xffff) != UINT32_C(0xbff5)) || a.read_iunrep() != 0) {
+        return false;
+    }
+    // WFI must not raise an illegal instruction exception
+    const auto priv = a.read_iflags_PRV();
+    if (priv == PRV_U || (priv < PRV_M && (a.read_mstatus() & MSTATUS_TW_MASK) != 0)) {
+        return false;
+    }
+    // The interpreter loop accounts for the last cycle
+    mcycle += ((mcycle_tick_end - mcycle) & ~static_cast<uint64_t>(1)) - 1;
+    INC_COUNTER(a.get_statistics(), idle_skip);
+    return true;
+}
+
+/// \brief Executes an instruction, fused with the next one when both form a supported idiom.
+/// \tparam BREAK_CONDITIONS True if the run must stop on break conditions.
+/// \tparam STATE_ACCESS Class of machine state accessor object.
+/// \param a Machine state accessor object.
+/// \param pc Interpreter loop program counter (will be overwritten).
+/// \param mcycle Interpreter loop machine cycle.
+/// \param mcycle_tick_end Machine cycle of the next interrupt check.
+/// \param insn Instruction.
+/// \param fetch_vaddr_page Fetch virtual address translation page cache.
+/// \param fetch_vh_offset Fetch virtual address host pointer offset cache.
+/// \return execute_status::failure if an exception was raised, or
+///  execute_status::success otherwise.
+/// \details A pair is only fused if both instructions retire before the next interrupt check, and if the second
+/// one lies in the same page as the first, so it can be read through the fetch translation cache. Idle loops made
+/// of WFI and a jump back to it are skipped under the same conditions.
+template <bool BREAK_CONDITIONS, typename STATE_ACCESS>
+static FORCE_INLINE execute_status execute_insn_or_fused_pair(STATE_ACCESS &a, uint64_t &pc, uint64_t &mcycle,
+    uint64_t mcycle_tick_end, uint32_t insn, uint64_t fetch_vaddr_page, uint64_t fetch_vh_offset) {
+    const bool wfi = insn == static_cast<uint32_t>(insn_privileged::WFI);
+    if ((wfi || is_fused_pair_head(insn)) && mcycle + 1 < mcycle_tick_end &&
+        (pc & ~PAGE_OFFSET_MASK) == fetch_vaddr_page && (pc & PAGE_OFFSET_MASK) <= PAGE_OFFSET_MASK - 7) {
+        const uint32_t next_insn =
+            aliased_unaligned_read<uint32_t, uint16_t>(cast_addr_to_ptr<unsigned char *>(pc + 4 + fetch_vh_offset));
+        if (unlikely(wfi)) {
+            if (skip_idle_loop(a, mcycle, mcycle_tick_end, next_insn)) {
+                return execute_status::success;
+            }
+        } else {
+            execute_status status = execute_status::success;
+            if (execute_fused_pair<BREAK_CONDITIONS>(a, pc, mcycle, insn, next_insn, status)) {
+                return status;
+            }
+        }
+    }
+    return execute_insn<BREAK_CONDITIONS>(a, pc, mcycle, insn);
+}
+
+/// \brief Obtains the machine cycle at which the interpreter loop must next check for interrupts.
+/// \param a Machine state accessor object.
+/// \param mcycle Current machine cycle.
+/// \param mcycle_end Machine cycle at which the run ends.
+/// \returns The earliest of mcycle_end and the next pending event.
+/// \details In interactive mode, host devices are polled at every RTC tick, so each tick is an event.
+/// Otherwise, the only thing a tick can do is to raise the timer interrupt, so the next event is the first tick at
+/// or after mtimecmp. Any instruction that could move this event, such as a write to mtimecmp, breaks the inner loop
+/// so the budget is computed again.
+template <typename STATE_ACCESS>
+static inline uint64_t get_next_event_mcycle(STATE_ACCESS &a, uint64_t mcycle, uint64_t mcycle_end) {
+    // Cycles until the next RTC tick
+    const uint64_t tick_cycles = RTC_FREQ_DIV - mcycle % RTC_FREQ_DIV;
+#ifndef MICROARCHITECTURE
+    if (!a.read_iunrep()) {
+        // Must match the conditions in set_rtc_interrupt()
+        const uint64_t timecmp_cycle = rtc_time_to_cycle(a.read_clint_mtimecmp());
+        if (timecmp_cycle == 0 || timecmp_cycle > UINT64_MAX - RTC_FREQ_DIV) {
+            // The timer never fires
+            return mcycle_end;
+        }
+        if (timecmp_cycle > mcycle) {
+            // Round up to the first tick at or after mtimecmp, while avoiding unsigned overflows
+            const uint64_t timecmp_tick = timecmp_cycle + (RTC_FREQ_DIV - 1 - (timecmp_cycle - 1) % RTC_FREQ_DIV);
+            return mcycle + std::min(mcycle_end - mcycle, timecmp_tick - mcycle);
+        }
+    }
+#else
+    (void) a;
+#endif
+    // Limit up to the next RTC tick, while avoiding unsigned overflows
+    return mcycle + std::min(mcycle_end - mcycle, tick_cycles);
+}
+
 /// \brief Checks that false brk is consistent with rest of state
 template <typename STATE_ACCESS>
 static void assert_no_brk(STATE_ACCESS &a) {
@@ -5527,7 +5976,11 @@ static void assert_no_brk(STATE_ACCESS &a) {
 }
 
 /// \brief Interpreter hot loop
-template <typename STATE_ACCESS>
+/// \tparam BREAK_CONDITIONS True if the run must stop on break conditions.
+/// \tparam PROFILE True if the guest is being profiled.
+/// \details The loop is instantiated with break conditions and profiling only when they are enabled,
+/// so the common case pays nothing for them.
+template <bool BREAK_CONDITIONS, bool PROFILE, typename STATE_ACCESS>
 static NO_INLINE execute_status interpret_loop(STATE_ACCESS &a, uint64_t mcycle_end, uint64_t mcycle) {
     // The interpret loop is constantly reading and modifying the pc and mcycle variables,
     // because of this care is taken to make them stack variables that are propagated across inline functions,
@@ -5538,12 +5991,20 @@ static NO_INLINE execute_status interpret_loop(STATE_ACCESS &a, uint64_t mcycle_
     // the actual values during interpreter loop, so they should be used with extra care,
     // taking this into account in any instruction execution code.
 
+    // Instruction pairs are fused only when nothing needs to observe the boundary between them
+#ifdef MICROARCHITECTURE
+    constexpr bool fuse_insns = false;
+#else
+    constexpr bool fuse_insns = !BREAK_CONDITIONS && !PROFILE;
+#endif
+
     // Read machine program counter
     uint64_t pc = a.read_pc();
 
     // Initialize fetch address translation cache invalidated
     uint64_t fetch_vaddr_page = PAGE_OFFSET_MASK;
     uint64_t fetch_vh_offset = 0;
+    fetch_cache fc;
 
     // The outer loop continues until there is an interruption that should be handled
     // externally, or mcycle reaches mcycle_end
@@ -5564,13 +6025,16 @@ static NO_INLINE execute_status interpret_loop(STATE_ACCESS &a, uint64_t mcycle_
         // Raise the highest priority pending interrupt, if any
         pc = raise_interrupt_if_any(a, pc);
 
+        // Taking the interrupt may have changed the privilege level
+        revalidate_fetch_cache(a, fetch_vaddr_page, fetch_vh_offset, fc);
+
 #ifndef NDEBUG
         // After raising any exception for a given interrupt, we expect no pending break
         assert_no_brk(a);
 #endif
 
-        // Limit mcycle_tick_end up to the next RTC tick, while avoiding unsigned overflows
-        const uint64_t mcycle_tick_end = mcycle + std::min(mcycle_end - mcycle, RTC_FREQ_DIV - mcycle % RTC_FREQ_DIV);
+        // Limit mcycle_tick_end up to the next pending event
+        const uint64_t mcycle_tick_end = get_next_event_mcycle(a, mcycle, mcycle_end);
 
         // The inner loop continues until there is an interrupt condition
         // or mcycle reaches mcycle_tick_end
@@ -5580,25 +6044,51 @@ static NO_INLINE execute_status interpret_loop(STATE_ACCESS &a, uint64_t mcycle_
             uint32_t insn = 0;
 
             // Try to fetch the next instruction
-            if (likely(fetch_insn(a, pc, insn, fetch_vaddr_page, fetch_vh_offset) == fetch_status::success)) {
+            const fetch_status fstatus =
+                fetch_insn<BREAK_CONDITIONS>(a, pc, mcycle, insn, fetch_vaddr_page, fetch_vh_offset, fc);
+            if constexpr (BREAK_CONDITIONS) {
+                if (unlikely(fstatus == fetch_status::breakpoint)) {
+                    // Stop before executing the instruction
+                    a.write_pc(pc);
+                    a.write_mcycle(mcycle);
+                    return execute_status::success;
+                }
+            }
+            if (likely(fstatus == fetch_status::success)) {
+                if constexpr (PROFILE) {
+                    a.profile_insn(pc, mcycle, insn);
+                }
                 // Try to execute it
-                const execute_status status = execute_insn(a, pc, mcycle, insn);
+                execute_status status = execute_status::success;
+                if constexpr (fuse_insns) {
+                    status = execute_insn_or_fused_pair<BREAK_CONDITIONS>(a, pc, mcycle, mcycle_tick_end, insn,
+                        fetch_vaddr_page, fetch_vh_offset);
+                } else {
+                    status = execute_insn<BREAK_CONDITIONS>(a, pc, mcycle, insn);
+                }
 
                 // When execute status is above success, we have to deal with special loop conditions,
                 // this is very unlikely to happen most of the time
                 if (unlikely(status > execute_status::success)) {
-                    // We must invalidate the fetch cache whenever privilege mode changes,
-                    // either due to a raised exception (execute_status::failure) or
-                    // due to MRET/SRET instructions (execute_status::success_and_serve_interrupts)
-                    // As a simplification (and optimization), the next line will also invalidate in more cases,
-                    // but this it's fine.
-                    fetch_vaddr_page = PAGE_OFFSET_MASK;
+                    // The code TLB may have been flushed, either due to SFENCE.VMA or satp writes
+                    // (execute_status::success_and_flush_fetch), or due to a privilege level change by a raised
+                    // exception (execute_status::failure) or by MRET/SRET instructions
+                    // (execute_status::success_and_serve_interrupts), so the fetch cache must be revalidated.
+                    // Traps, returns and CSR writes that leave the TLB alone keep the cache.
+                    revalidate_fetch_cache(a, fetch_vaddr_page, fetch_vh_offset, fc);
                     // All status above execute_status::success_and_serve_interrupts will require breaking the loop
                     if (unlikely(status >= execute_status::success_and_serve_interrupts)) {
                         // Increment the cycle counter mcycle
                         ++mcycle;
 
                         if (likely(status == execute_status::success_and_serve_interrupts)) {
+                            if constexpr (BREAK_CONDITIONS) {
+                                if (unlikely(a.check_break_conditions(pc, mcycle))) {
+                                    a.write_pc(pc);
+                                    a.write_mcycle(mcycle);
+                                    return execute_status::success;
+                                }
+                            }
                             // We have to break the inner loop to check and serve any pending interrupt immediately
                             break;
                         } else { // execute_status::success_and_yield or execute_status::success_and_halt
@@ -5610,11 +6100,23 @@ static NO_INLINE execute_status interpret_loop(STATE_ACCESS &a, uint64_t mcycle_
                         }
                     }
                 }
+            } else {
+                // Raising the fetch exception may have changed the privilege level
+                revalidate_fetch_cache(a, fetch_vaddr_page, fetch_vh_offset, fc);
             }
 
             // Increment the cycle counter mcycle
             ++mcycle;
 
+            if constexpr (BREAK_CONDITIONS) {
+                // Watchpoints were checked while executing the instruction, CSR predicates are checked now
+                if (unlikely(a.check_break_conditions(pc, mcycle))) {
+                    a.write_pc(pc);
+                    a.write_mcycle(mcycle);
+                    return execute_status::success;
+                }
+            }
+
 #ifndef NDEBUG
             // After a inner loop iteration, there can be no pending interrupts
             assert_no_brk(a);
@@ -5655,7 +6157,18 @@ interpreter_break_reason interpret(STATE_ACCESS &a, uint64_t mcycle_end) {
 
     // Run the interpreter loop,
     // the loop is outlined in a dedicated function so the compiler can optimize it better
-    const execute_status status = interpret_loop(a, mcycle_end, mcycle);
+#ifndef MICROARCHITECTURE
+    execute_status status = execute_status::success;
+    if (unlikely(a.has_profiler())) {
+        status = a.has_break_conditions() ? interpret_loop<true, true>(a, mcycle_end, mcycle) :
+                                            interpret_loop<false, true>(a, mcycle_end, mcycle);
+    } else {
+        status = a.has_break_conditions() ? interpret_loop<true, false>(a, mcycle_end, mcycle) :
+                                            interpret_loop<false, false>(a, mcycle_end, mcycle);
+    }
+#else
+    const execute_status status = interpret_loop<false, false>(a, mcycle_end, mcycle);
+#endif
 
     // Detect and return the reason for stopping the interpreter loop
     if (a.read_iflags_H()) {
@@ -5666,6 +6179,8 @@ interpreter_break_reason interpret(STATE_ACCESS &a, uint64_t mcycle_end) {
         return interpreter_break_reason::yielded_automatically;
     } else if (status == execute_status::success_and_yield) {
         return interpreter_break_reason::yielded_softly;
+    } else if (a.is_break_condition_reached()) {
+        return interpreter_break_reason::reached_break_condition;
     } else {                                   // Reached mcycle_end
         assert(a.read_mcycle() == mcycle_end); // LCOV_EXCL_LINE
         return interpreter_break_reason::reached_target_mcycle;
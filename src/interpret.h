@@ -43,7 +43,8 @@ enum class interpreter_break_reason {
     yielded_manually,
     yielded_automatically,
     yielded_softly,
-    reached_target_mcycle
+    reached_target_mcycle,
+    reached_break_condition ///< Only returned by machine::run_until()
 };
 
 /// \brief Tries to run the interpreter until mcycle hits a target
@@ -200,7 +200,8 @@ interpreter_break_reason interpreter_break_reason_from_name(const std::string &n
     using ibr = interpreter_break_reason;
     const static std::unordered_map<std::string, ibr> g_ibr_name = {{"failed", ibr::failed}, {"halted", ibr::halted},
         {"yielded_manually", ibr::yielded_manually}, {"yielded_automatically", ibr::yielded_automatically},
-        {"yielded_softly", ibr::yielded_softly}, {"reached_target_mcycle", ibr::reached_target_mcycle}};
+        {"yielded_softly", ibr::yielded_softly}, {"reached_target_mcycle", ibr::reached_target_mcycle},
+        {"reached_break_condition", ibr::reached_break_condition}};
     auto got = g_ibr_name.find(name);
     if (got == g_ibr_name.end()) {
         throw std::domain_error{"invalid interpreter break reason"};
@@ -454,6 +455,94 @@ template void ju_get_opt_field<bool>(const nlohmann::json &j, const bool &key, h
 template void ju_get_opt_field<std::string>(const nlohmann::json &j, const std::string &key, htif_runtime_config &value,
     const std::string &path);
 
+static console_output_mode console_output_mode_from_name(const std::string &name) {
+    const static std::unordered_map<std::string, console_output_mode> g_com_name = {
+        {"direct", console_output_mode::direct}, {"buffered", console_output_mode::buffered},
+        {"file", console_output_mode::file}, {"memory", console_output_mode::memory}};
+    auto got = g_com_name.find(name);
+    if (got == g_com_name.end()) {
+        throw std::domain_error{"invalid console output mode"};
+    }
+    return got->second;
+}
+
+static std::string console_output_mode_name(console_output_mode mode) {
+    switch (mode) {
+        case console_output_mode::direct:
+            return "direct";
+        case console_output_mode::buffered:
+            return "buffered";
+        case console_output_mode::file:
+            return "file";
+        case console_output_mode::memory:
+            return "memory";
+    }
+    throw std::domain_error{"invalid console output mode"};
+}
+
+template <typename K>
+void ju_get_opt_field(const nlohmann::json &j, const K &key, console_runtime_config &value, const std::string &path) {
+    if (!contains(j, key)) {
+        return;
+    }
+    const auto &jk = j[key];
+    const auto new_path = path + to_string(key) + "/";
+    if (contains(jk, "output_mode"s)) {
+        if (!jk["output_mode"].is_string()) {
+            throw std::invalid_argument("field \""s + new_path + "output_mode\" not a string");
+        }
+        value.output_mode = console_output_mode_from_name(jk["output_mode"].template get<std::string>());
+    }
+    ju_get_opt_field(jk, "output_filename"s, value.output_filename, new_path);
+    ju_get_opt_field(jk, "output_buffer_size"s, value.output_buffer_size, new_path);
+}
+
+template void ju_get_opt_field<uint64_t>(const nlohmann::json &j, const uint64_t &key, console_runtime_config &value,
+    const std::string &path);
+
+template void ju_get_opt_field<std::string>(const nlohmann::json &j, const std::string &key,
+    console_runtime_config &value, const std::string &path);
+
+static os_poll_backend poll_backend_from_name(const std::string &name) {
+    const static std::unordered_map<std::string, os_poll_backend> g_opb_name = {
+        {"auto", os_poll_backend::automatic}, {"select", os_poll_backend::select}, {"epoll", os_poll_backend::epoll}};
+    auto got = g_opb_name.find(name);
+    if (got == g_opb_name.end()) {
+        throw std::domain_error{"invalid poll backend"};
+    }
+    return got->second;
+}
+
+static std::string poll_backend_name(os_poll_backend backend) {
+    switch (backend) {
+        case os_poll_backend::automatic:
+            return "auto";
+        case os_poll_backend::select:
+            return "select";
+        case os_poll_backend::epoll:
+            return "epoll";
+    }
+    throw std::domain_error{"invalid poll backend"};
+}
+
+template <typename K>
+void ju_get_opt_field(const nlohmann::json &j, const K &key, os_poll_backend &value, const std::string &path) {
+    if (!contains(j, key)) {
+        return;
+    }
+    const auto &jk = j[key];
+    if (!jk.is_string()) {
+        throw std::invalid_argument("field \""s + path + to_string(key) + "\" not a string");
+    }
+    value = poll_backend_from_name(jk.template get<std::string>());
+}
+
+template void ju_get_opt_field<uint64_t>(const nlohmann::json &j, const uint64_t &key, os_poll_backend &value,
+    const std::string &path);
+
+template void ju_get_opt_field<std::string>(const nlohmann::json &j, const std::string &key, os_poll_backend &value,
+    const std::string &path);
+
 template <typename K>
 void ju_get_opt_field(const nlohmann::json &j, const K &key, machine_runtime_config &value, const std::string &path) {
     if (!contains(j, key)) {
@@ -461,10 +550,13 @@ void ju_get_opt_field(const nlohmann::json &j, const K &key, machine_runtime_con
     }
     ju_get_field(j[key], "concurrency"s, value.concurrency, path + to_string(key) + "/");
     ju_get_field(j[key], "htif"s, value.htif, path + to_string(key) + "/");
+    ju_get_opt_field(j[key], "console"s, value.console, path + to_string(key) + "/");
     ju_get_opt_field(j[key], "skip_root_hash_check"s, value.skip_root_hash_check, path + to_string(key) + "/");
     ju_get_opt_field(j[key], "skip_root_hash_store"s, value.skip_root_hash_store, path + to_string(key) + "/");
     ju_get_opt_field(j[key], "skip_version_check"s, value.skip_version_check, path + to_string(key) + "/");
     ju_get_opt_field(j[key], "soft_yield"s, value.soft_yield, path + to_string(key) + "/");
+    ju_get_opt_field(j[key], "poll_backend"s, value.poll_backend, path + to_string(key) + "/");
+    ju_get_opt_field(j[key], "huge_pages"s, value.huge_pages, path + to_string(key) + "/");
 }
 
 template void ju_get_opt_field<uint64_t>(const nlohmann::json &j, const uint64_t &key, machine_runtime_config &value,
@@ -1138,6 +1230,7 @@ void ju_get_opt_field(const nlohmann::json &j, const K &key, machine_memory_rang
     ju_get_opt_field(jconfig, "length"s, value.length, new_path);
     ju_get_opt_field(jconfig, "start"s, value.start, new_path);
     ju_get_opt_field(jconfig, "description"s, value.description, new_path);
+    ju_get_opt_field(jconfig, "huge_pages"s, value.huge_pages, new_path);
 }
 
 template void ju_get_opt_field<uint64_t>(const nlohmann::json &j, const uint64_t &key,
@@ -1158,6 +1251,192 @@ template void ju_get_opt_field<uint64_t>(const nlohmann::json &j, const uint64_t
 template void ju_get_opt_field<std::string>(const nlohmann::json &j, const std::string &key,
     machine_memory_range_descrs &value, const std::string &path);
 
+static machine_csr_comparison csr_comparison_from_name(const std::string &name) {
+    if (name == "equal") {
+        return machine_csr_comparison::equal;
+    }
+    if (name == "not_equal") {
+        return machine_csr_comparison::not_equal;
+    }
+    throw std::domain_error{"invalid csr comparison"};
+}
+
+static std::string csr_comparison_name(machine_csr_comparison comparison) {
+    switch (comparison) {
+        case machine_csr_comparison::equal:
+            return "equal";
+        case machine_csr_comparison::not_equal:
+            return "not_equal";
+    }
+    throw std::domain_error{"invalid csr comparison"};
+}
+
+static machine_break_event_type break_event_type_from_name(const std::string &name) {
+    using bet = machine_break_event_type;
+    const static std::unordered_map<std::string, bet> g_bet_name = {{"none", bet::none},
+        {"breakpoint", bet::breakpoint}, {"watchpoint", bet::watchpoint}, {"csr_predicate", bet::csr_predicate}};
+    auto got = g_bet_name.find(name);
+    if (got == g_bet_name.end()) {
+        throw std::domain_error{"invalid break event type"};
+    }
+    return got->second;
+}
+
+static std::string break_event_type_name(machine_break_event_type type) {
+    switch (type) {
+        case machine_break_event_type::none:
+            return "none";
+        case machine_break_event_type::breakpoint:
+            return "breakpoint";
+        case machine_break_event_type::watchpoint:
+            return "watchpoint";
+        case machine_break_event_type::csr_predicate:
+            return "csr_predicate";
+    }
+    throw std::domain_error{"invalid break event type"};
+}
+
+template <typename K>
+void ju_get_opt_field(const nlohmann::json &j, const K &key, machine_watchpoint &value, const std::string &path) {
+    if (!contains(j, key)) {
+        return;
+    }
+    const auto &jw = j[key];
+    const auto new_path = path + to_string(key) + "/";
+    ju_get_field(jw, "start"s, value.start, new_path);
+    ju_get_field(jw, "length"s, value.length, new_path);
+    ju_get_opt_field(jw, "virtual_address"s, value.virtual_address, new_path);
+    ju_get_opt_field(jw, "read"s, value.read, new_path);
+    ju_get_opt_field(jw, "write"s, value.write, new_path);
+}
+
+template void ju_get_opt_field<uint64_t>(const nlohmann::json &j, const uint64_t &key, machine_watchpoint &value,
+    const std::string &path);
+
+template void ju_get_opt_field<std::string>(const nlohmann::json &j, const std::string &key, machine_watchpoint &value,
+    const std::string &path);
+
+template <typename K>
+void ju_get_opt_field(const nlohmann::json &j, const K &key, machine_csr_predicate &value, const std::string &path) {
+    if (!contains(j, key)) {
+        return;
+    }
+    const auto &jp = j[key];
+    const auto new_path = path + to_string(key) + "/";
+    ju_get_field(jp, "csr"s, value.csr, new_path);
+    ju_get_opt_field(jp, "mask"s, value.mask, new_path);
+    ju_get_field(jp, "value"s, value.value, new_path);
+    if (contains(jp, "comparison"s)) {
+        std::string comparison;
+        ju_get_field(jp, "comparison"s, comparison, new_path);
+        value.comparison = csr_comparison_from_name(comparison);
+    }
+}
+
+template void ju_get_opt_field<uint64_t>(const nlohmann::json &j, const uint64_t &key, machine_csr_predicate &value,
+    const std::string &path);
+
+template void ju_get_opt_field<std::string>(const nlohmann::json &j, const std::string &key,
+    machine_csr_predicate &value, const std::string &path);
+
+template <typename K>
+void ju_get_opt_field(const nlohmann::json &j, const K &key, machine_break_conditions &value,
+    const std::string &path) {
+    if (!contains(j, key)) {
+        return;
+    }
+    const auto &jc = j[key];
+    const auto new_path = path + to_string(key) + "/";
+    ju_get_opt_vector_like_field(jc, "breakpoints"s, value.breakpoints, new_path);
+    ju_get_opt_vector_like_field(jc, "watchpoints"s, value.watchpoints, new_path);
+    ju_get_opt_vector_like_field(jc, "csr_predicates"s, value.csr_predicates, new_path);
+}
+
+template void ju_get_opt_field<uint64_t>(const nlohmann::json &j, const uint64_t &key, machine_break_conditions &value,
+    const std::string &path);
+
+template void ju_get_opt_field<std::string>(const nlohmann::json &j, const std::string &key,
+    machine_break_conditions &value, const std::string &path);
+
+template <typename K>
+void ju_get_opt_field(const nlohmann::json &j, const K &key, machine_break_event &value, const std::string &path) {
+    if (!contains(j, key)) {
+        return;
+    }
+    const auto &je = j[key];
+    const auto new_path = path + to_string(key) + "/";
+    std::string type;
+    ju_get_field(je, "type"s, type, new_path);
+    value.type = break_event_type_from_name(type);
+    ju_get_field(je, "index"s, value.index, new_path);
+    ju_get_field(je, "address"s, value.address, new_path);
+}
+
+template void ju_get_opt_field<uint64_t>(const nlohmann::json &j, const uint64_t &key, machine_break_event &value,
+    const std::string &path);
+
+template void ju_get_opt_field<std::string>(const nlohmann::json &j, const std::string &key, machine_break_event &value,
+    const std::string &path);
+
+template <typename K>
+void ju_get_opt_field(const nlohmann::json &j, const K &key,
+    std::pair<interpreter_break_reason, machine_break_event> &value, const std::string &path) {
+    if (!contains(j, key)) {
+        return;
+    }
+    const auto &jr = j[key];
+    const auto new_path = path + to_string(key) + "/";
+    ju_get_field(jr, "break_reason"s, value.first, new_path);
+    ju_get_field(jr, "event"s, value.second, new_path);
+}
+
+template void ju_get_opt_field<uint64_t>(const nlohmann::json &j, const uint64_t &key,
+    std::pair<interpreter_break_reason, machine_break_event> &value, const std::string &path);
+
+template void ju_get_opt_field<std::string>(const nlohmann::json &j, const std::string &key,
+    std::pair<interpreter_break_reason, machine_break_event> &value, const std::string &path);
+
+static machine_profile_format profile_format_from_name(const std::string &name) {
+    using mpf = machine_profile_format;
+    const static std::unordered_map<std::string, mpf> g_mpf_name = {{"collapsed", mpf::collapsed},
+        {"pprof", mpf::pprof}, {"summary", mpf::summary}};
+    auto got = g_mpf_name.find(name);
+    if (got == g_mpf_name.end()) {
+        throw std::domain_error{"invalid profile format"};
+    }
+    return got->second;
+}
+
+static std::string profile_format_name(machine_profile_format format) {
+    switch (format) {
+        case machine_profile_format::collapsed:
+            return "collapsed";
+        case machine_profile_format::pprof:
+            return "pprof";
+        case machine_profile_format::summary:
+            return "summary";
+    }
+    throw std::domain_error{"invalid profile format"};
+}
+
+template <typename K>
+void ju_get_opt_field(const nlohmann::json &j, const K &key, machine_profile_format &value, const std::string &path) {
+    if (!contains(j, key)) {
+        return;
+    }
+    const auto &jk = j[key];
+    if (!jk.is_string()) {
+        throw std::invalid_argument("field \""s + path + to_string(key) + "\" not a string");
+    }
+    value = profile_format_from_name(jk.template get<std::string>());
+}
+
+template void ju_get_opt_field<uint64_t>(const nlohmann::json &j, const uint64_t &key, machine_profile_format &value,
+    const std::string &path);
+
+template void ju_get_opt_field<std::string>(const nlohmann::json &j, const std::string &key,
+    machine_profile_format &value, const std::string &path);
+
 void to_json(nlohmann::json &j, const machine::csr &csr) {
     j = csr_to_name(csr);
 }
@@ -1373,19 +1652,31 @@ void to_json(nlohmann::json &j, const htif_runtime_config &config) {
     };
 }
 
+void to_json(nlohmann::json &j, const console_runtime_config &config) {
+    j = nlohmann::json{
+        {"output_mode", console_output_mode_name(config.output_mode)},
+        {"output_filename", config.output_filename},
+        {"output_buffer_size", config.output_buffer_size},
+    };
+}
+
 void to_json(nlohmann::json &j, const machine_runtime_config &runtime) {
     j = nlohmann::json{
         {"concurrency", runtime.concurrency},
         {"htif", runtime.htif},
+        {"console", runtime.console},
         {"skip_root_hash_check", runtime.skip_root_hash_check},
         {"skip_root_hash_store", runtime.skip_root_hash_store},
         {"skip_version_check", runtime.skip_version_check},
         {"soft_yield", runtime.soft_yield},
+        {"poll_backend", runtime.poll_backend},
+        {"huge_pages", runtime.huge_pages},
     };
 }
 
 void to_json(nlohmann::json &j, const machine_memory_range_descr &mrd) {
-    j = nlohmann::json{{"length", mrd.length}, {"start", mrd.start}, {"description", mrd.description}};
+    j = nlohmann::json{{"length", mrd.length}, {"start", mrd.start}, {"description", mrd.description},
+        {"huge_pages", mrd.huge_pages}};
 }
 
 void to_json(nlohmann::json &j, const machine_memory_range_descrs &mrds) {
@@ -1394,4 +1685,32 @@ void to_json(nlohmann::json &j, const machine_memory_range_descrs &mrds) {
         [](const auto &a) -> nlohmann::json { return a; });
 }
 
+void to_json(nlohmann::json &j, const machine_watchpoint &w) {
+    j = nlohmann::json{{"start", w.start}, {"length", w.length}, {"virtual_address", w.virtual_address},
+        {"read", w.read}, {"write", w.write}};
+}
+
+void to_json(nlohmann::json &j, const machine_csr_predicate &p) {
+    j = nlohmann::json{{"csr", p.csr}, {"mask", p.mask}, {"value", p.value},
+        {"comparison", csr_comparison_name(p.comparison)}};
+}
+
+void to_json(nlohmann::json &j, const machine_break_conditions &conditions) {
+    j = nlohmann::json{{"breakpoints", conditions.breakpoints}, {"watchpoints", conditions.watchpoints},
+        {"csr_predicates", conditions.csr_predicates}};
+}
+
+void to_json(nlohmann::json &j, const machine_break_event &event) {
+    j = nlohmann::json{{"type", break_event_type_name(event.type)}, {"index", event.index},
+        {"address", event.address}};
+}
+
+void to_json(nlohmann::json &j, const os_poll_backend &backend) {
+    j = poll_backend_name(backend);
+}
+
+void to_json(nlohmann::json &j, const machine_profile_format &format) {
+    j = profile_format_name(format);
+}
+
 } // namespace cartesi
@@ -25,6 +25,7 @@
 #define JSON_HAS_FILESYSTEM 0 // NOLINT(cppcoreguidelines-macro-usage)
 #include <json.hpp>
 
+#include "machine-break-conditions.h"
 #include "machine-merkle-tree.h"
 #include "machine.h"
 #include "semantic-version.h"
@@ -174,6 +175,16 @@ template <typename K>
 void ju_get_opt_field(const nlohmann::json &j, const K &key, htif_runtime_config &value,
     const std::string &path = "params/");
 
+/// \brief Attempts to load a console_runtime_config object from a field in a JSON object
+/// \tparam K Key type (explicit extern declarations for uint64_t and std::string are provided)
+/// \param j JSON object to load from
+/// \param key Key to load value from
+/// \param value Object to store value
+/// \param path Path to j
+template <typename K>
+void ju_get_opt_field(const nlohmann::json &j, const K &key, console_runtime_config &value,
+    const std::string &path = "params/");
+
 /// \brief Attempts to load an machine_runtime_config object from a field in a JSON object
 /// \tparam K Key type (explicit extern declarations for uint64_t and std::string are provided)
 /// \param j JSON object to load from
@@ -431,6 +442,75 @@ template <typename K>
 void ju_get_opt_field(const nlohmann::json &j, const K &key, machine_memory_range_descrs &value,
     const std::string &path = "params/");
 
+/// \brief Attempts to load a machine_watchpoint object from a field in a JSON object
+/// \tparam K Key type (explicit extern declarations for uint64_t and std::string are provided)
+/// \param j JSON object to load from
+/// \param key Key to load value from
+/// \param value Object to store value
+/// \param path Path to j
+template <typename K>
+void ju_get_opt_field(const nlohmann::json &j, const K &key, machine_watchpoint &value,
+    const std::string &path = "params/");
+
+/// \brief Attempts to load a machine_csr_predicate object from a field in a JSON object
+/// \tparam K Key type (explicit extern declarations for uint64_t and std::string are provided)
+/// \param j JSON object to load from
+/// \param key Key to load value from
+/// \param value Object to store value
+/// \param path Path to j
+template <typename K>
+void ju_get_opt_field(const nlohmann::json &j, const K &key, machine_csr_predicate &value,
+    const std::string &path = "params/");
+
+/// \brief Attempts to load a machine_break_conditions object from a field in a JSON object
+/// \tparam K Key type (explicit extern declarations for uint64_t and std::string are provided)
+/// \param j JSON object to load from
+/// \param key Key to load value from
+/// \param value Object to store value
+/// \param path Path to j
+template <typename K>
+void ju_get_opt_field(const nlohmann::json &j, const K &key, machine_break_conditions &value,
+    const std::string &path = "params/");
+
+/// \brief Attempts to load a machine_break_event object from a field in a JSON object
+/// \tparam K Key type (explicit extern declarations for uint64_t and std::string are provided)
+/// \param j JSON object to load from
+/// \param key Key to load value from
+/// \param value Object to store value
+/// \param path Path to j
+template <typename K>
+void ju_get_opt_field(const nlohmann::json &j, const K &key, machine_break_event &value,
+    const std::string &path = "params/");
+
+/// \brief Attempts to load the break reason and event returned by machine.run_until from a field in a JSON object
+/// \tparam K Key type (explicit extern declarations for uint64_t and std::string are provided)
+/// \param j JSON object to load from
+/// \param key Key to load value from
+/// \param value Object to store value
+/// \param path Path to j
+template <typename K>
+void ju_get_opt_field(const nlohmann::json &j, const K &key,
+    std::pair<interpreter_break_reason, machine_break_event> &value, const std::string &path = "params/");
+
+/// \brief Attempts to load an os_poll_backend name from a field in a JSON object
+/// \tparam K Key type (explicit extern declarations for uint64_t and std::string are provided)
+/// \param j JSON object to load from
+/// \param key Key to load value from
+/// \param value Object to store value
+/// \param path Path to j
+template <typename K>
+void ju_get_opt_field(const nlohmann::json &j, const K &key, os_poll_backend &value, const std::string &path = "params/");
+
+/// \brief Attempts to load a machine_profile_format name from a field in a JSON object
+/// \tparam K Key type (explicit extern declarations for uint64_t and std::string are provided)
+/// \param j JSON object to load from
+/// \param key Key to load value from
+/// \param value Object to store value
+/// \param path Path to j
+template <typename K>
+void ju_get_opt_field(const nlohmann::json &j, const K &key, machine_profile_format &value,
+    const std::string &path = "params/");
+
 /// \brief Attempts to load an array from a field in a JSON object
 /// \tparam K Key type (explicit extern declarations for uint64_t and std::string are provided)
 /// \param j JSON object to load from
@@ -590,9 +670,16 @@ void to_json(nlohmann::json &j, const uarch_config &config);
 void to_json(nlohmann::json &j, const machine_config &config);
 void to_json(nlohmann::json &j, const concurrency_runtime_config &config);
 void to_json(nlohmann::json &j, const htif_runtime_config &config);
+void to_json(nlohmann::json &j, const console_runtime_config &config);
 void to_json(nlohmann::json &j, const machine_runtime_config &runtime);
 void to_json(nlohmann::json &j, const machine::csr &csr);
 void to_json(nlohmann::json &j, const machine_memory_range_descrs &mrds);
+void to_json(nlohmann::json &j, const machine_watchpoint &w);
+void to_json(nlohmann::json &j, const machine_csr_predicate &p);
+void to_json(nlohmann::json &j, const machine_break_conditions &conditions);
+void to_json(nlohmann::json &j, const machine_break_event &event);
+void to_json(nlohmann::json &j, const machine_profile_format &format);
+void to_json(nlohmann::json &j, const os_poll_backend &backend);
 
 // Extern template declarations
 extern template void ju_get_opt_field(const nlohmann::json &j, const std::string &key, std::string &value,
@@ -635,6 +722,10 @@ extern template void ju_get_opt_field(const nlohmann::json &j, const bool &key,
     const std::string &base = "params/");
 extern template void ju_get_opt_field(const nlohmann::json &j, const std::string &key, htif_runtime_config &value,
     const std::string &base = "params/");
+extern template void ju_get_opt_field(const nlohmann::json &j, const uint64_t &key, console_runtime_config &value,
+    const std::string &base = "params/");
+extern template void ju_get_opt_field(const nlohmann::json &j, const std::string &key, console_runtime_config &value,
+    const std::string &base = "params/");
 extern template void ju_get_opt_field(const nlohmann::json &j, const uint64_t &key, machine_runtime_config &value,
     const std::string &base = "params/");
 extern template void ju_get_opt_field(const nlohmann::json &j, const std::string &key, machine_runtime_config &value,
@@ -747,6 +838,34 @@ extern template void ju_get_opt_field(const nlohmann::json &j, const uint64_t &k
     const std::string &base = "params/");
 extern template void ju_get_opt_field(const nlohmann::json &j, const std::string &key,
     machine_memory_range_descrs &value, const std::string &base = "params/");
+extern template void ju_get_opt_field(const nlohmann::json &j, const uint64_t &key, machine_watchpoint &value,
+    const std::string &base = "params/");
+extern template void ju_get_opt_field(const nlohmann::json &j, const std::string &key, machine_watchpoint &value,
+    const std::string &base = "params/");
+extern template void ju_get_opt_field(const nlohmann::json &j, const uint64_t &key, machine_csr_predicate &value,
+    const std::string &base = "params/");
+extern template void ju_get_opt_field(const nlohmann::json &j, const std::string &key, machine_csr_predicate &value,
+    const std::string &base = "params/");
+extern template void ju_get_opt_field(const nlohmann::json &j, const uint64_t &key, machine_break_conditions &value,
+    const std::string &base = "params/");
+extern template void ju_get_opt_field(const nlohmann::json &j, const std::string &key, machine_break_conditions &value,
+    const std::string &base = "params/");
+extern template void ju_get_opt_field(const nlohmann::json &j, const uint64_t &key, machine_break_event &value,
+    const std::string &base = "params/");
+extern template void ju_get_opt_field(const nlohmann::json &j, const std::string &key, machine_break_event &value,
+    const std::string &base = "params/");
+extern template void ju_get_opt_field(const nlohmann::json &j, const uint64_t &key,
+    std::pair<interpreter_break_reason, machine_break_event> &value, const std::string &base = "params/");
+extern template void ju_get_opt_field(const nlohmann::json &j, const std::string &key,
+    std::pair<interpreter_break_reason, machine_break_event> &value, const std::string &base = "params/");
+extern template void ju_get_opt_field(const nlohmann::json &j, const uint64_t &key, os_poll_backend &value,
+    const std::string &base = "params/");
+extern template void ju_get_opt_field(const nlohmann::json &j, const std::string &key, os_poll_backend &value,
+    const std::string &base = "params/");
+extern template void ju_get_opt_field(const nlohmann::json &j, const uint64_t &key, machine_profile_format &value,
+    const std::string &base = "params/");
+extern template void ju_get_opt_field(const nlohmann::json &j, const std::string &key, machine_profile_format &value,
+    const std::string &base = "params/");
 
 } // namespace cartesi
 
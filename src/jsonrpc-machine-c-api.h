@@ -161,6 +161,18 @@ CM_API int cm_jsonrpc_fork(const cm_jsonrpc_mg_mgr *mgr, char **address, char **
 /// \returns 0 for successful verification, non zero code for error
 CM_API int cm_jsonrpc_rebind(const cm_jsonrpc_mg_mgr *mgr, const char *address, char **err_msg);
 
+/// \brief Moves cmio data and memory contents through memory shared with the server, instead of encoding them in JSON
+/// \param mgr Cartesi jsonrpc connection manager. Must be pointer to valid object
+/// \param err_msg Receives the error message if function execution fails
+/// or NULL in case of successful function execution. In case of failure error_msg
+/// must be deleted by the function caller using cm_delete_cstring
+/// \returns 0 for success, non zero code for error
+/// \details The client creates a named shared memory segment and asks the server to map it, so it only works when
+/// both run in the same host. After success, cm_send_cmio_response, cm_read_memory, and cm_write_memory on machines
+/// from this manager move their data through the segment. cm_machine_get_cmio_tx_buffer also becomes available,
+/// returning a pointer to a copy of the tx buffer in the segment that is refreshed on each call.
+CM_API int cm_jsonrpc_enable_shared_memory(const cm_jsonrpc_mg_mgr *mgr, char **err_msg);
+
 /// \brief Gets the address of a general-purpose register from remote cartesi server
 /// \param mgr Cartesi jsonrpc connection manager. Must be pointer to valid object
 /// \param i Register index. Between 0 and X_REG_COUNT-1, inclusive.
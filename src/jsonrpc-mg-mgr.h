@@ -18,6 +18,7 @@
 #define JSONRPC_MG_MGR_H
 
 #include <boost/container/static_vector.hpp>
+#include <cstdint>
 #include <mongoose.h>
 #include <string>
 
@@ -27,6 +28,8 @@ class jsonrpc_mg_mgr final {
 
     boost::container::static_vector<std::string, 2> m_address{};
     struct mg_mgr m_mgr {}; // unnecessary initialization to silince clang-tidy
+    unsigned char *m_shared_memory{nullptr}; // memory shared with the server, if any
+    uint64_t m_shared_memory_length{0};
 
 public:
     explicit jsonrpc_mg_mgr(std::string remote_address);
@@ -45,6 +48,9 @@ public:
     void commit(void);
     void rollback(void);
     void shutdown(void);
+    void set_shared_memory(unsigned char *shared_memory, uint64_t length);
+    unsigned char *get_shared_memory(void) const;
+    uint64_t get_shared_memory_length(void) const;
 };
 
 } // namespace cartesi
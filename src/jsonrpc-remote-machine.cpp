@@ -29,6 +29,7 @@
 #include <unordered_set>
 
 #include <fcntl.h>
+#include <poll.h>
 #include <sys/types.h>
 #include <sys/wait.h>
 #include <unistd.h>
@@ -36,9 +37,11 @@
 #include <mongoose.h>
 
 #include "base64.h"
+#include "gdb-stub.h"
 #include "json-util.h"
 #include "jsonrpc-discover.h"
 #include "machine.h"
+#include "os.h"
 #include "unique-c-ptr.h"
 
 #define SLOG_PREFIX log_prefix
@@ -196,14 +199,51 @@ enum class http_handler_status {
     shutdown        ///< Previous request was for shutdown
 };
 
+/// \brief Memory segment shared with a client, used to move large buffers without encoding them in JSON
+class shared_memory_segment final {
+    unsigned char *m_data; ///< Start of segment in host memory
+    uint64_t m_length;     ///< Length of segment
+
+public:
+    /// \brief Maps an existing named segment
+    shared_memory_segment(const std::string &name, uint64_t length) :
+        m_data{cartesi::os_map_shared_memory(name.c_str(), length, false)},
+        m_length{length} {}
+    shared_memory_segment(const shared_memory_segment &other) = delete;
+    shared_memory_segment(shared_memory_segment &&other) noexcept = delete;
+    shared_memory_segment &operator=(const shared_memory_segment &other) = delete;
+    shared_memory_segment &operator=(shared_memory_segment &&other) noexcept = delete;
+    ~shared_memory_segment() {
+        cartesi::os_unmap_file(m_data, m_length);
+    }
+
+    /// \brief Returns pointer to a range within the segment
+    /// \param offset Offset of range from start of segment
+    /// \param length Length of range
+    unsigned char *get_range(uint64_t offset, uint64_t length) const {
+        if (offset > m_length || length > m_length - offset) {
+            throw std::invalid_argument{"range not contained in shared memory"};
+        }
+        return m_data + offset;
+    }
+};
+
+/// \brief Owning pointer to memory segment shared with a client
+using shared_memory_ptr = std::unique_ptr<shared_memory_segment>;
+
 /// \brief HTTP handler data
 struct http_handler_data {
     std::string server_address;                ///< Address server receives requests at
+    std::string gdb_address;                   ///< Address machine.serve_gdb listens at by default
     std::unique_ptr<cartesi::machine> machine; ///< Cartesi Machine, if any
     http_handler_status status;                ///< Status of last request
     mg_mgr event_manager;                      ///< Mongoose event manager
     mg_connection *listen_connection;          ///< Listen connection
     struct http_handler_data *child;           ///< Pointer to handler data for forked child now running, if any
+    shared_memory_ptr shared_memory;           ///< Memory shared with the client, if any
+    std::unique_ptr<cartesi::gdb_stub> gdb;    ///< GDB stub served from the event loop, while a session is active
+    mg_connection *gdb_connection;             ///< Connection waiting for the machine.serve_gdb response, if any
+    json gdb_request;                          ///< Request machine.serve_gdb is responding to
 };
 
 /// \brief Forward declaration of http handler
@@ -650,7 +690,9 @@ static json jsonrpc_fork_handler(const json &j, mg_connection *con, http_handler
         // So we return with a status and destroy the event_manager only after mg_mgr_poll returns in our loop.
         h->status = http_handler_status::forked_child;
         h->child->server_address = new_server_address;
+        h->child->gdb_address = h->gdb_address;
         h->child->machine = std::move(h->machine);
+        h->child->shared_memory = std::move(h->shared_memory);
         return json{};
     }
     // parent
@@ -686,6 +728,33 @@ static json jsonrpc_rebind_handler(const json &j, mg_connection *con, http_handl
     return jsonrpc_response_ok(j);
 }
 
+/// \brief JSONRPC handler for the attach_shared_memory method
+/// \param j JSON request object
+/// \param con Mongoose connection
+/// \param h Handler data
+/// \returns JSON response object
+/// \details Maps a named shared memory segment created by the client, replacing any previous one.
+/// The *_shared_memory machine methods then move data through it instead of encoding it in JSON.
+static json jsonrpc_attach_shared_memory_handler(const json &j, mg_connection *con, http_handler_data *h) {
+    (void) con;
+    static const char *param_name[] = {"name", "length"};
+    auto args = parse_args<std::string, uint64_t>(j, param_name);
+    h->shared_memory.reset();
+    h->shared_memory = std::make_unique<shared_memory_segment>(std::get<0>(args), std::get<1>(args));
+    return jsonrpc_response_ok(j);
+}
+
+/// \brief Returns pointer to a range in the memory shared with the client
+/// \param h Handler data
+/// \param offset Offset of range from start of shared memory
+/// \param length Length of range
+static unsigned char *get_shared_memory_range(const http_handler_data *h, uint64_t offset, uint64_t length) {
+    if (!h->shared_memory) {
+        throw std::invalid_argument{"no shared memory"};
+    }
+    return h->shared_memory->get_range(offset, length);
+}
+
 /// \brief JSONRPC handler for the machine.machine.directory method
 /// \param j JSON request object
 /// \param con Mongoose connection
@@ -785,6 +854,8 @@ static std::string interpreter_break_reason_name(cartesi::interpreter_break_reas
             return "yielded_softly";
         case R::reached_target_mcycle:
             return "reached_target_mcycle";
+        case R::reached_break_condition:
+            return "reached_break_condition";
     }
     throw std::domain_error{"invalid interpreter break reason"};
 }
@@ -805,6 +876,160 @@ static json jsonrpc_machine_run_handler(const json &j, mg_connection *con, http_
     return jsonrpc_response_ok(j, interpreter_break_reason_name(reason));
 }
 
+/// \brief JSONRPC handler for the machine.run_record_trace method
+/// \param j JSON request object
+/// \param con Mongoose connection
+/// \param h Handler data
+/// \returns JSON response object
+static json jsonrpc_machine_run_record_trace_handler(const json &j, mg_connection *con, http_handler_data *h) {
+    (void) con;
+    if (!h->machine) {
+        return jsonrpc_response_invalid_request(j, "no machine");
+    }
+    static const char *param_name[] = {"mcycle_end"};
+    auto args = parse_args<uint64_t>(j, param_name);
+    cartesi::execution_trace trace;
+    h->machine->run_record_trace(std::get<0>(args), trace);
+    return jsonrpc_response_ok(j, cartesi::encode_base64(trace.to_binary()));
+}
+
+/// \brief JSONRPC handler for the machine.run_replay_trace method
+/// \param j JSON request object
+/// \param con Mongoose connection
+/// \param h Handler data
+/// \returns JSON response object
+static json jsonrpc_machine_run_replay_trace_handler(const json &j, mg_connection *con, http_handler_data *h) {
+    (void) con;
+    if (!h->machine) {
+        return jsonrpc_response_invalid_request(j, "no machine");
+    }
+    static const char *param_name[] = {"trace"};
+    auto args = parse_args<std::string>(j, param_name);
+    auto trace = cartesi::execution_trace::from_binary(cartesi::decode_base64(std::get<0>(args)));
+    auto reason = h->machine->run_replay_trace(trace);
+    return jsonrpc_response_ok(j, interpreter_break_reason_name(reason));
+}
+
+/// \brief JSONRPC handler for the machine.run_until method
+/// \param j JSON request object
+/// \param con Mongoose connection
+/// \param h Handler data
+/// \returns JSON response object
+static json jsonrpc_machine_run_until_handler(const json &j, mg_connection *con, http_handler_data *h) {
+    (void) con;
+    if (!h->machine) {
+        return jsonrpc_response_invalid_request(j, "no machine");
+    }
+    static const char *param_name[] = {"mcycle_end", "conditions"};
+    auto args = parse_args<uint64_t, cartesi::machine_break_conditions>(j, param_name);
+    cartesi::machine_break_event event;
+    auto reason = h->machine->run_until(std::get<0>(args), std::get<1>(args), event);
+    return jsonrpc_response_ok(j, json{{"break_reason", interpreter_break_reason_name(reason)}, {"event", event}});
+}
+
+/// \brief JSONRPC handler for the machine.serve_gdb method
+/// \param j JSON request object
+/// \param con Mongoose connection
+/// \param h Handler data
+/// \returns JSON response object
+/// \details GDB is served from the event loop, between polls of the JSON-RPC connections.
+/// The response is only sent once GDB detaches. Until then, requests other than get_version and rpc.discover
+/// fail with an error, because GDB owns the machine.
+static json jsonrpc_machine_serve_gdb_handler(const json &j, mg_connection *con, http_handler_data *h) {
+    if (!h->machine) {
+        return jsonrpc_response_invalid_request(j, "no machine");
+    }
+    static const char *param_name[] = {"mcycle_end", "address"};
+    auto args = parse_args<uint64_t, cartesi::optional_param<std::string>>(j, param_name);
+    const std::string address = std::get<1>(args).value_or(h->gdb_address);
+    auto stub = std::make_unique<cartesi::gdb_stub>(*h->machine);
+    stub->listen(address, std::get<0>(args));
+    SLOG(info) << h->server_address << " waiting for GDB to connect at " << address;
+    h->gdb = std::move(stub);
+    h->gdb_connection = con;
+    h->gdb_request = j;
+    return json{};
+}
+
+/// \brief JSONRPC handler for the machine.start_profiler method
+/// \param j JSON request object
+/// \param con Mongoose connection
+/// \param h Handler data
+/// \returns JSON response object
+static json jsonrpc_machine_start_profiler_handler(const json &j, mg_connection *con, http_handler_data *h) {
+    (void) con;
+    if (!h->machine) {
+        return jsonrpc_response_invalid_request(j, "no machine");
+    }
+    static const char *param_name[] = {"sample_interval"};
+    auto args = parse_args<uint64_t>(j, param_name);
+    h->machine->start_profiler(std::get<0>(args));
+    return jsonrpc_response_ok(j);
+}
+
+/// \brief JSONRPC handler for the machine.stop_profiler method
+/// \param j JSON request object
+/// \param con Mongoose connection
+/// \param h Handler data
+/// \returns JSON response object
+static json jsonrpc_machine_stop_profiler_handler(const json &j, mg_connection *con, http_handler_data *h) {
+    (void) con;
+    if (!h->machine) {
+        return jsonrpc_response_invalid_request(j, "no machine");
+    }
+    jsonrpc_check_no_params(j);
+    h->machine->stop_profiler();
+    return jsonrpc_response_ok(j);
+}
+
+/// \brief JSONRPC handler for the machine.write_profile method
+/// \param j JSON request object
+/// \param con Mongoose connection
+/// \param h Handler data
+/// \returns JSON response object
+static json jsonrpc_machine_write_profile_handler(const json &j, mg_connection *con, http_handler_data *h) {
+    (void) con;
+    if (!h->machine) {
+        return jsonrpc_response_invalid_request(j, "no machine");
+    }
+    static const char *param_name[] = {"filename", "format", "elf_filename"};
+    auto args = parse_args<std::string, cartesi::machine_profile_format, cartesi::optional_param<std::string>>(j,
+        param_name);
+    h->machine->write_profile(std::get<0>(args), std::get<1>(args), std::get<2>(args).value_or(""));
+    return jsonrpc_response_ok(j);
+}
+
+/// \brief JSONRPC handler for the machine.read_console_output method
+/// \param j JSON request object
+/// \param con Mongoose connection
+/// \param h Handler data
+/// \returns JSON response object
+static json jsonrpc_machine_read_console_output_handler(const json &j, mg_connection *con, http_handler_data *h) {
+    (void) con;
+    if (!h->machine) {
+        return jsonrpc_response_invalid_request(j, "no machine");
+    }
+    static const char *param_name[] = {"max_length"};
+    auto args = parse_args<uint64_t>(j, param_name);
+    const uint64_t max_length = std::get<0>(args);
+    // Read in chunks, so the size of the request does not dictate how much memory we allocate up front
+    constexpr uint64_t chunk_size = 65536;
+    std::string data;
+    while (data.size() < max_length) {
+        const uint64_t want = std::min(chunk_size, max_length - data.size());
+        const auto offset = data.size();
+        data.resize(offset + want);
+        // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+        const uint64_t got = h->machine->read_console_output(reinterpret_cast<unsigned char *>(data.data() + offset),
+            want);
+        data.resize(offset + got);
+        if (got < want) {
+            break;
+        }
+    }
+    return jsonrpc_response_ok(j, cartesi::encode_base64(data));
+}
+
 /// \brief Translate an uarch_interpret_break_reason value to string
 /// \param reason uarch_interpret_break_reason value to translate
 /// \returns String representation of value
@@ -1118,6 +1343,44 @@ static json jsonrpc_machine_read_memory_handler(const json &j, mg_connection *co
     return jsonrpc_response_ok(j, cartesi::encode_base64(data.get(), length));
 }
 
+/// \brief JSONRPC handler for the machine.read_memory_to_shared_memory method
+/// \param j JSON request object
+/// \param con Mongoose connection
+/// \param h Handler data
+/// \returns JSON response object
+static json jsonrpc_machine_read_memory_to_shared_memory_handler(const json &j, mg_connection *con,
+    http_handler_data *h) {
+    (void) con;
+    if (!h->machine) {
+        return jsonrpc_response_invalid_request(j, "no machine");
+    }
+    static const char *param_name[] = {"address", "length", "offset"};
+    auto args = parse_args<uint64_t, uint64_t, uint64_t>(j, param_name);
+    auto length = std::get<1>(args);
+    auto *data = get_shared_memory_range(h, std::get<2>(args), length);
+    h->machine->read_memory(std::get<0>(args), data, length);
+    return jsonrpc_response_ok(j);
+}
+
+/// \brief JSONRPC handler for the machine.write_memory_from_shared_memory method
+/// \param j JSON request object
+/// \param con Mongoose connection
+/// \param h Handler data
+/// \returns JSON response object
+static json jsonrpc_machine_write_memory_from_shared_memory_handler(const json &j, mg_connection *con,
+    http_handler_data *h) {
+    (void) con;
+    if (!h->machine) {
+        return jsonrpc_response_invalid_request(j, "no machine");
+    }
+    static const char *param_name[] = {"address", "length", "offset"};
+    auto args = parse_args<uint64_t, uint64_t, uint64_t>(j, param_name);
+    auto length = std::get<1>(args);
+    const auto *data = get_shared_memory_range(h, std::get<2>(args), length);
+    h->machine->write_memory(std::get<0>(args), data, length);
+    return jsonrpc_response_ok(j);
+}
+
 /// \brief JSONRPC handler for the machine.write_memory method
 /// \param j JSON request object
 /// \param con Mongoose connection
@@ -1666,6 +1929,25 @@ static json jsonrpc_machine_send_cmio_response_handler(const json &j, mg_connect
     return jsonrpc_response_ok(j);
 }
 
+/// \brief JSONRPC handler for the machine.send_cmio_response_from_shared_memory method
+/// \param j JSON request object
+/// \param con Mongoose connection
+/// \param h Handler data
+/// \returns JSON response object
+static json jsonrpc_machine_send_cmio_response_from_shared_memory_handler(const json &j, mg_connection *con,
+    http_handler_data *h) {
+    (void) con;
+    if (!h->machine) {
+        return jsonrpc_response_invalid_request(j, "no machine");
+    }
+    static const char *param_name[] = {"reason", "length", "offset"};
+    auto args = parse_args<uint16_t, uint64_t, uint64_t>(j, param_name);
+    auto length = std::get<1>(args);
+    const auto *data = get_shared_memory_range(h, std::get<2>(args), length);
+    h->machine->send_cmio_response(std::get<0>(args), data, length);
+    return jsonrpc_response_ok(j);
+}
+
 static json jsonrpc_machine_log_send_cmio_response_handler(const json &j, mg_connection *con, http_handler_data *h) {
     (void) con;
     if (!h->machine) {
@@ -1809,6 +2091,7 @@ static json jsonrpc_dispatch_method(const json &j, mg_connection *con, http_hand
     static const std::unordered_map<std::string, jsonrpc_handler> dispatch = {
         {"fork", jsonrpc_fork_handler},
         {"rebind", jsonrpc_rebind_handler},
+        {"attach_shared_memory", jsonrpc_attach_shared_memory_handler},
         {"shutdown", jsonrpc_shutdown_handler},
         {"get_version", jsonrpc_get_version_handler},
         {"rpc.discover", jsonrpc_rpc_discover_handler},
@@ -1817,6 +2100,14 @@ static json jsonrpc_dispatch_method(const json &j, mg_connection *con, http_hand
         {"machine.destroy", jsonrpc_machine_destroy_handler},
         {"machine.store", jsonrpc_machine_store_handler},
         {"machine.run", jsonrpc_machine_run_handler},
+        {"machine.run_record_trace", jsonrpc_machine_run_record_trace_handler},
+        {"machine.run_replay_trace", jsonrpc_machine_run_replay_trace_handler},
+        {"machine.run_until", jsonrpc_machine_run_until_handler},
+        {"machine.serve_gdb", jsonrpc_machine_serve_gdb_handler},
+        {"machine.start_profiler", jsonrpc_machine_start_profiler_handler},
+        {"machine.stop_profiler", jsonrpc_machine_stop_profiler_handler},
+        {"machine.read_console_output", jsonrpc_machine_read_console_output_handler},
+        {"machine.write_profile", jsonrpc_machine_write_profile_handler},
         {"machine.run_uarch", jsonrpc_machine_run_uarch_handler},
         {"machine.log_uarch_step", jsonrpc_machine_log_uarch_step_handler},
         {"machine.reset_uarch", jsonrpc_machine_reset_uarch_handler},
@@ -1830,6 +2121,8 @@ static json jsonrpc_dispatch_method(const json &j, mg_connection *con, http_hand
         {"machine.read_word", jsonrpc_machine_read_word_handler},
         {"machine.read_memory", jsonrpc_machine_read_memory_handler},
         {"machine.write_memory", jsonrpc_machine_write_memory_handler},
+        {"machine.read_memory_to_shared_memory", jsonrpc_machine_read_memory_to_shared_memory_handler},
+        {"machine.write_memory_from_shared_memory", jsonrpc_machine_write_memory_from_shared_memory_handler},
         {"machine.read_virtual_memory", jsonrpc_machine_read_virtual_memory_handler},
         {"machine.write_virtual_memory", jsonrpc_machine_write_virtual_memory_handler},
         {"machine.translate_virtual_address", jsonrpc_machine_translate_virtual_address_handler},
@@ -1863,6 +2156,8 @@ static json jsonrpc_dispatch_method(const json &j, mg_connection *con, http_hand
         {"machine.verify_dirty_page_maps", jsonrpc_machine_verify_dirty_page_maps_handler},
         {"machine.get_memory_ranges", jsonrpc_machine_get_memory_ranges_handler},
         {"machine.send_cmio_response", jsonrpc_machine_send_cmio_response_handler},
+        {"machine.send_cmio_response_from_shared_memory",
+            jsonrpc_machine_send_cmio_response_from_shared_memory_handler},
         {"machine.log_send_cmio_response", jsonrpc_machine_log_send_cmio_response_handler},
         {"machine.verify_send_cmio_response_log", jsonrpc_machine_verify_send_cmio_response_log_handler},
         {"machine.verify_send_cmio_response_state_transition",
@@ -1870,6 +2165,9 @@ static json jsonrpc_dispatch_method(const json &j, mg_connection *con, http_hand
     };
     auto method = j["method"].get<std::string>();
     SLOG(debug) << h->server_address << " handling \"" << method << "\" method";
+    if (h->gdb && method != "get_version" && method != "rpc.discover") {
+        return jsonrpc_response_server_error(j, "machine is being debugged by GDB until it detaches");
+    }
     auto found = dispatch.find(method);
     if (found != dispatch.end()) {
         return found->second(j, con, h);
@@ -1970,10 +2268,18 @@ static void http_handler(mg_connection *con, int ev, void *ev_data, void *h_data
                         "invalid field \"id\" (expected string, number, or null)"));
                 }
             }
+            // The response to machine.serve_gdb is deferred until GDB detaches, so it cannot share a batch
+            if (was_array && ji["method"] == "machine.serve_gdb") {
+                jr.push_back(jsonrpc_response_invalid_request(ji, "machine.serve_gdb cannot be batched"));
+                continue;
+            }
             json jri = jsonrpc_dispatch_method(ji, con, h);
             if (h->status == http_handler_status::forked_child) {
                 return;
             }
+            if (h->gdb_connection == con) {
+                return;
+            }
             // Except for errors, do not add result of "notification" requests
             if (ji.contains("id")) {
                 jr.push_back(std::move(jri));
@@ -1990,6 +2296,10 @@ static void http_handler(mg_connection *con, int ev, void *ev_data, void *h_data
         return jsonrpc_send_empty_reply(con, h);
     }
     if (ev == MG_EV_CLOSE) {
+        if (con == h->gdb_connection) {
+            // The client stopped waiting for GDB to detach, but GDB is still served
+            h->gdb_connection = nullptr;
+        }
         if (con->data[0] == 'X') {
             h->status = http_handler_status::shutdown;
             return;
@@ -2001,6 +2311,34 @@ static void http_handler(mg_connection *con, int ev, void *ev_data, void *h_data
     }
 }
 
+/// \brief Serves GDB from the event loop, and sends the machine.serve_gdb response once it detaches
+/// \param h Handler data
+static void serve_gdb_some(http_handler_data *h) {
+    // Wait a little for GDB, without holding requests from other clients for long
+    constexpr int GDB_WAIT_TIMEOUT_MS = 10;
+    const int fd = h->gdb->get_wait_fd();
+    if (fd >= 0) {
+        pollfd pfd{fd, POLLIN, 0};
+        (void) poll(&pfd, 1, GDB_WAIT_TIMEOUT_MS);
+    }
+    json response;
+    try {
+        if (h->gdb->serve_some()) {
+            return;
+        }
+        SLOG(info) << h->server_address << " GDB detached";
+        response = jsonrpc_response_ok(h->gdb_request);
+    } catch (std::exception &x) {
+        SLOG(error) << h->server_address << " GDB session failed (" << x.what() << ")";
+        response = jsonrpc_response_internal_error(h->gdb_request, x.what());
+    }
+    h->gdb.reset();
+    if (h->gdb_connection != nullptr) {
+        jsonrpc_http_reply(h->gdb_connection, h, response);
+        h->gdb_connection = nullptr;
+    }
+}
+
 /// \brief Prints help message
 /// \param name Executable name
 static void help(const char *name) {
@@ -2021,6 +2359,14 @@ where
 
 and options are
 
+    --gdb-address=<gdb-address>
+      gives the address machine.serve_gdb listens at for GDB when the request does not give one
+      <gdb-address> can be
+        <ipv4-hostname/address>:<port>
+        <ipv6-hostname/address>:<port>
+        unix:<path>
+      default is "localhost:1234"
+
     --log-level=<level>
       sets the log level
       <level> can be
@@ -2068,6 +2414,7 @@ static void init_logger(const char *strlevel) {
 
 int main(int argc, char *argv[]) try {
     const char *server_address = "localhost:0";
+    const char *gdb_address = "localhost:1234";
     const char *log_level = nullptr;
     const char *program_name = PROGRAM_NAME;
 
@@ -2078,6 +2425,8 @@ int main(int argc, char *argv[]) try {
     for (int i = 1; i < argc; i++) {
         if (stringval("--server-address=", argv[i], &server_address)) {
             ;
+        } else if (stringval("--gdb-address=", argv[i], &gdb_address)) {
+            ;
         } else if (stringval("--log-level=", argv[i], &log_level)) {
             ;
         } else if (strcmp(argv[i], "--help") == 0) {
@@ -2129,13 +2478,17 @@ int main(int argc, char *argv[]) try {
     }
     h->listen_connection = con;
     h->server_address = server_address;
+    h->gdb_address = gdb_address;
 
     SLOG(info) << "initial server bound to port " << ntohs(con->loc.port);
 
     while (!abort_due_to_signal) {
         log_signals();
         h->status = http_handler_status::ready_for_next;
-        mg_mgr_poll(&h->event_manager, 10000);
+        if (h->gdb) {
+            serve_gdb_some(h);
+        }
+        mg_mgr_poll(&h->event_manager, h->gdb ? 0 : 10000);
         switch (h->status) {
             case http_handler_status::shutdown:
                 mg_mgr_free(&h->event_manager);
@@ -19,7 +19,11 @@
 #include <algorithm>
 #include <csignal>
 #include <cstdint>
+#include <cstring>
+#include <random>
+#include <sstream>
 #include <string>
+#include <system_error>
 
 #include <mongoose.h>
 
@@ -27,6 +31,8 @@
 #include "htif.h"
 #include "json-util.h"
 #include "jsonrpc-mg-mgr.h"
+#include "os.h"
+#include "pma-constants.h"
 
 using namespace std::string_literals;
 using json = nlohmann::json;
@@ -177,6 +183,15 @@ void jsonrpc_request(struct mg_mgr &mgr, const std::string &url, const std::stri
 
 namespace cartesi {
 
+/// \brief Layout of the memory shared with the server
+enum jsonrpc_shared_memory_layout : uint64_t {
+    JSONRPC_SHM_INPUT_OFFSET = 0,                                               ///< Start of data sent to the server
+    JSONRPC_SHM_INPUT_LENGTH = PMA_CMIO_RX_BUFFER_LENGTH,                       ///< Length of data sent to the server
+    JSONRPC_SHM_OUTPUT_OFFSET = PMA_CMIO_RX_BUFFER_LENGTH,                      ///< Start of data received from server
+    JSONRPC_SHM_OUTPUT_LENGTH = PMA_CMIO_TX_BUFFER_LENGTH,                      ///< Length of data received from server
+    JSONRPC_SHM_LENGTH = PMA_CMIO_RX_BUFFER_LENGTH + PMA_CMIO_TX_BUFFER_LENGTH, ///< Total length
+};
+
 jsonrpc_mg_mgr::jsonrpc_mg_mgr(std::string remote_address) {
     memset(&m_mgr, 0, sizeof(m_mgr));
     mg_mgr_init(&m_mgr);
@@ -189,6 +204,7 @@ jsonrpc_mg_mgr::jsonrpc_mg_mgr(std::string remote_address) {
 }
 
 jsonrpc_mg_mgr::~jsonrpc_mg_mgr() {
+    set_shared_memory(nullptr, 0);
     mg_mgr_free(&m_mgr);
 }
 
@@ -271,6 +287,22 @@ bool jsonrpc_mg_mgr::is_shutdown(void) const {
     return m_address.empty();
 }
 
+void jsonrpc_mg_mgr::set_shared_memory(unsigned char *shared_memory, uint64_t length) {
+    if (m_shared_memory != nullptr) {
+        os_unmap_file(m_shared_memory, m_shared_memory_length);
+    }
+    m_shared_memory = shared_memory;
+    m_shared_memory_length = length;
+}
+
+unsigned char *jsonrpc_mg_mgr::get_shared_memory(void) const {
+    return m_shared_memory;
+}
+
+uint64_t jsonrpc_mg_mgr::get_shared_memory_length(void) const {
+    return m_shared_memory_length;
+}
+
 jsonrpc_virtual_machine::jsonrpc_virtual_machine(jsonrpc_mg_mgr_ptr mgr) : m_mgr(std::move(mgr)) {}
 
 jsonrpc_virtual_machine::jsonrpc_virtual_machine(jsonrpc_mg_mgr_ptr mgr, const std::string &directory,
@@ -356,6 +388,67 @@ interpreter_break_reason jsonrpc_virtual_machine::do_run(uint64_t mcycle_end) {
     return result;
 }
 
+interpreter_break_reason jsonrpc_virtual_machine::do_run_record_trace(uint64_t mcycle_end, execution_trace &trace) {
+    std::string result;
+    jsonrpc_request(m_mgr->get_mgr(), m_mgr->get_remote_address(), "machine.run_record_trace", std::tie(mcycle_end),
+        result);
+    trace = execution_trace::from_binary(cartesi::decode_base64(result));
+    return trace.break_reason;
+}
+
+interpreter_break_reason jsonrpc_virtual_machine::do_run_replay_trace(const execution_trace &trace) {
+    interpreter_break_reason result = interpreter_break_reason::failed;
+    std::string b64 = cartesi::encode_base64(trace.to_binary());
+    jsonrpc_request(m_mgr->get_mgr(), m_mgr->get_remote_address(), "machine.run_replay_trace", std::tie(b64),
+        result);
+    return result;
+}
+
+interpreter_break_reason jsonrpc_virtual_machine::do_run_until(uint64_t mcycle_end,
+    const machine_break_conditions &conditions, machine_break_event &event) {
+    std::pair<interpreter_break_reason, machine_break_event> result{interpreter_break_reason::failed, {}};
+    jsonrpc_request(m_mgr->get_mgr(), m_mgr->get_remote_address(), "machine.run_until",
+        std::tie(mcycle_end, conditions), result);
+    event = result.second;
+    return result.first;
+}
+
+void jsonrpc_virtual_machine::do_serve_gdb(const std::string &address, uint64_t mcycle_end) {
+    bool result = false;
+    jsonrpc_request(m_mgr->get_mgr(), m_mgr->get_remote_address(), "machine.serve_gdb",
+        std::tie(mcycle_end, address), result);
+}
+
+void jsonrpc_virtual_machine::do_start_profiler(uint64_t sample_interval) {
+    bool result = false;
+    jsonrpc_request(m_mgr->get_mgr(), m_mgr->get_remote_address(), "machine.start_profiler",
+        std::tie(sample_interval), result);
+}
+
+void jsonrpc_virtual_machine::do_stop_profiler(void) {
+    bool result = false;
+    jsonrpc_request(m_mgr->get_mgr(), m_mgr->get_remote_address(), "machine.stop_profiler", std::tie(), result);
+}
+
+void jsonrpc_virtual_machine::do_write_profile(const std::string &filename, machine_profile_format format,
+    const std::string &elf_filename) const {
+    bool result = false;
+    jsonrpc_request(m_mgr->get_mgr(), m_mgr->get_remote_address(), "machine.write_profile",
+        std::tie(filename, format, elf_filename), result);
+}
+
+uint64_t jsonrpc_virtual_machine::do_read_console_output(unsigned char *data, uint64_t max_length) {
+    std::string result;
+    jsonrpc_request(m_mgr->get_mgr(), m_mgr->get_remote_address(), "machine.read_console_output",
+        std::tie(max_length), result);
+    std::string bin = cartesi::decode_base64(result);
+    if (bin.size() > max_length) {
+        throw std::runtime_error("jsonrpc server error: invalid decoded base64 data length");
+    }
+    std::memcpy(data, bin.data(), bin.size());
+    return bin.size();
+}
+
 void jsonrpc_virtual_machine::do_store(const std::string &directory) {
     bool result = false;
     jsonrpc_request(m_mgr->get_mgr(), m_mgr->get_remote_address(), "machine.store", std::tie(directory), result);
@@ -395,6 +488,42 @@ uint64_t jsonrpc_virtual_machine::get_x_address(const jsonrpc_mg_mgr_ptr &mgr, i
     return result;
 }
 
+void jsonrpc_virtual_machine::enable_shared_memory(const jsonrpc_mg_mgr_ptr &mgr) {
+    if (mgr->get_shared_memory() != nullptr) {
+        return;
+    }
+    // Pick a random name, so concurrent clients do not collide, and pick another if it is taken anyway
+    constexpr int max_attempts = 16;
+    std::random_device rd;
+    const uint64_t length = JSONRPC_SHM_LENGTH;
+    std::string name;
+    unsigned char *shared_memory = nullptr;
+    for (int attempt = 1; shared_memory == nullptr; ++attempt) {
+        std::ostringstream ss;
+        ss << "/cartesi-jsonrpc-" << std::hex << rd() << rd();
+        name = ss.str();
+        try {
+            shared_memory = os_map_shared_memory(name.c_str(), length, true);
+        } catch (const std::system_error &e) {
+            if (e.code() != std::errc::file_exists || attempt >= max_attempts) {
+                throw;
+            }
+        }
+    }
+    try {
+        bool result = false;
+        jsonrpc_request(mgr->get_mgr(), mgr->get_remote_address(), "attach_shared_memory", std::tie(name, length),
+            result);
+    } catch (...) {
+        os_unlink_shared_memory(name.c_str());
+        os_unmap_file(shared_memory, length);
+        throw;
+    }
+    // Both sides have the segment mapped, so it no longer needs a name
+    os_unlink_shared_memory(name.c_str());
+    mgr->set_shared_memory(shared_memory, length);
+}
+
 std::string jsonrpc_virtual_machine::fork(const jsonrpc_mg_mgr_ptr &mgr) {
     std::string result;
     jsonrpc_request(mgr->get_mgr(), mgr->get_remote_address(), "fork", std::tie(), result);
@@ -430,6 +559,21 @@ uint64_t jsonrpc_virtual_machine::get_uarch_x_address(const jsonrpc_mg_mgr_ptr &
 }
 
 void jsonrpc_virtual_machine::do_read_memory(uint64_t address, unsigned char *data, uint64_t length) const {
+    if (m_mgr->get_shared_memory() != nullptr) {
+        // Move data through the shared memory, one chunk at a time
+        const uint64_t offset = JSONRPC_SHM_OUTPUT_OFFSET;
+        while (length > 0) {
+            const uint64_t chunk = std::min<uint64_t>(length, JSONRPC_SHM_OUTPUT_LENGTH);
+            bool result = false;
+            jsonrpc_request(m_mgr->get_mgr(), m_mgr->get_remote_address(), "machine.read_memory_to_shared_memory",
+                std::tie(address, chunk, offset), result);
+            std::memcpy(data, m_mgr->get_shared_memory() + offset, chunk);
+            address += chunk;
+            data += chunk;
+            length -= chunk;
+        }
+        return;
+    }
     std::string result;
     jsonrpc_request(m_mgr->get_mgr(), m_mgr->get_remote_address(), "machine.read_memory", std::tie(address, length),
         result);
@@ -441,6 +585,21 @@ void jsonrpc_virtual_machine::do_read_memory(uint64_t address, unsigned char *da
 }
 
 void jsonrpc_virtual_machine::do_write_memory(uint64_t address, const unsigned char *data, size_t length) {
+    if (m_mgr->get_shared_memory() != nullptr) {
+        // Move data through the shared memory, one chunk at a time
+        const uint64_t offset = JSONRPC_SHM_INPUT_OFFSET;
+        while (length > 0) {
+            const uint64_t chunk = std::min<uint64_t>(length, JSONRPC_SHM_INPUT_LENGTH);
+            std::memcpy(m_mgr->get_shared_memory() + offset, data, chunk);
+            bool result = false;
+            jsonrpc_request(m_mgr->get_mgr(), m_mgr->get_remote_address(), "machine.write_memory_from_shared_memory",
+                std::tie(address, chunk, offset), result);
+            address += chunk;
+            data += chunk;
+            length -= chunk;
+        }
+        return;
+    }
     bool result = false;
     std::string b64 = cartesi::encode_base64(data, length);
     jsonrpc_request(m_mgr->get_mgr(), m_mgr->get_remote_address(), "machine.write_memory", std::tie(address, b64),
@@ -964,12 +1123,36 @@ machine_memory_range_descrs jsonrpc_virtual_machine::do_get_memory_ranges(void)
 }
 
 void jsonrpc_virtual_machine::do_send_cmio_response(uint16_t reason, const unsigned char *data, size_t length) {
+    if (m_mgr->get_shared_memory() != nullptr && length <= JSONRPC_SHM_INPUT_LENGTH) {
+        const uint64_t offset = JSONRPC_SHM_INPUT_OFFSET;
+        const uint64_t input_length = length;
+        std::memcpy(m_mgr->get_shared_memory() + offset, data, input_length);
+        bool result = false;
+        jsonrpc_request(m_mgr->get_mgr(), m_mgr->get_remote_address(), "machine.send_cmio_response_from_shared_memory",
+            std::tie(reason, input_length, offset), result);
+        return;
+    }
     bool result = false;
     std::string b64 = cartesi::encode_base64(data, length);
     jsonrpc_request(m_mgr->get_mgr(), m_mgr->get_remote_address(), "machine.send_cmio_response", std::tie(reason, b64),
         result);
 }
 
+const unsigned char *jsonrpc_virtual_machine::do_get_cmio_tx_buffer(uint64_t &length) const {
+    if (m_mgr->get_shared_memory() == nullptr) {
+        throw std::runtime_error("direct access to the cmio tx buffer of remote machines requires shared memory");
+    }
+    // Have the server copy the buffer into shared memory, where the client can read it in place
+    const uint64_t address = PMA_CMIO_TX_BUFFER_START;
+    const uint64_t tx_length = PMA_CMIO_TX_BUFFER_LENGTH;
+    const uint64_t offset = JSONRPC_SHM_OUTPUT_OFFSET;
+    bool result = false;
+    jsonrpc_request(m_mgr->get_mgr(), m_mgr->get_remote_address(), "machine.read_memory_to_shared_memory",
+        std::tie(address, tx_length, offset), result);
+    length = tx_length;
+    return m_mgr->get_shared_memory() + offset;
+}
+
 access_log jsonrpc_virtual_machine::do_log_send_cmio_response(uint16_t reason, const unsigned char *data, size_t length,
     const access_log::type &log_type, bool one_based) {
     not_default_constructible<access_log> result;
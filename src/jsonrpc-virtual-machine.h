@@ -75,6 +75,7 @@ public:
 
     static std::string fork(const jsonrpc_mg_mgr_ptr &mgr);
     static void rebind(const jsonrpc_mg_mgr_ptr &mgr, const std::string &address);
+    static void enable_shared_memory(const jsonrpc_mg_mgr_ptr &mgr);
     static uint64_t get_x_address(const jsonrpc_mg_mgr_ptr &mgr, int i);
     static uint64_t get_f_address(const jsonrpc_mg_mgr_ptr &mgr, int i);
     static uint64_t get_uarch_x_address(const jsonrpc_mg_mgr_ptr &mgr, int i);
@@ -84,6 +85,16 @@ private:
     machine_config do_get_initial_config(void) const override;
 
     interpreter_break_reason do_run(uint64_t mcycle_end) override;
+    interpreter_break_reason do_run_record_trace(uint64_t mcycle_end, execution_trace &trace) override;
+    interpreter_break_reason do_run_replay_trace(const execution_trace &trace) override;
+    interpreter_break_reason do_run_until(uint64_t mcycle_end, const machine_break_conditions &conditions,
+        machine_break_event &event) override;
+    void do_serve_gdb(const std::string &address, uint64_t mcycle_end) override;
+    void do_start_profiler(uint64_t sample_interval) override;
+    void do_stop_profiler(void) override;
+    void do_write_profile(const std::string &filename, machine_profile_format format,
+        const std::string &elf_filename) const override;
+    uint64_t do_read_console_output(unsigned char *data, uint64_t max_length) override;
     void do_store(const std::string &dir) override;
     uint64_t do_read_csr(csr r) const override;
     void do_write_csr(csr w, uint64_t val) override;
@@ -207,6 +218,7 @@ private:
     uarch_interpreter_break_reason do_run_uarch(uint64_t uarch_cycle_end) override;
     machine_memory_range_descrs do_get_memory_ranges(void) const override;
     void do_send_cmio_response(uint16_t reason, const unsigned char *data, size_t length) override;
+    const unsigned char *do_get_cmio_tx_buffer(uint64_t &length) const override;
     access_log do_log_send_cmio_response(uint16_t reason, const unsigned char *data, size_t length,
         const access_log::type &log_type, bool one_based) override;
     jsonrpc_mg_mgr_ptr m_mgr;
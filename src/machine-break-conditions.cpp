@@ -0,0 +1,127 @@
+// Copyright Cartesi and individual authors (see AUTHORS)
+// SPDX-License-Identifier: LGPL-3.0-or-later
+//
+// This program is free software: you can redistribute it and/or modify it under
+// the terms of the GNU Lesser General Public License as published by the Free
+// Software Foundation, either version 3 of the License, or (at your option) any
+// later version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+// PARTICULAR PURPOSE. See the GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License along
+// with this program (see COPYING). If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include <algorithm>
+#include <stdexcept>
+
+#include "machine-break-conditions.h"
+#include "riscv-constants.h"
+
+namespace cartesi {
+
+/// \brief Checks if two non-empty ranges that do not wrap around overlap
+static bool ranges_overlap(uint64_t start, uint64_t length, uint64_t other_start, uint64_t other_length) {
+    return start <= other_start + (other_length - 1) && other_start <= start + (length - 1);
+}
+
+break_condition_monitor::break_condition_monitor(const machine_break_conditions &conditions, uint64_t mcycle_begin) :
+    m_watchpoints(conditions.watchpoints),
+    m_csr_predicates(conditions.csr_predicates),
+    m_mcycle_begin(mcycle_begin) {
+    m_breakpoints.reserve(conditions.breakpoints.size());
+    for (uint64_t i = 0; i < conditions.breakpoints.size(); ++i) {
+        const uint64_t pc = conditions.breakpoints[i];
+        if ((pc & 1) != 0) {
+            throw std::invalid_argument{"breakpoint address is misaligned"};
+        }
+        m_breakpoints.emplace_back(pc, i);
+        m_breakpoint_pages.push_back(pc & ~PAGE_OFFSET_MASK);
+    }
+    std::sort(m_breakpoints.begin(), m_breakpoints.end());
+    std::sort(m_breakpoint_pages.begin(), m_breakpoint_pages.end());
+    m_breakpoint_pages.erase(std::unique(m_breakpoint_pages.begin(), m_breakpoint_pages.end()),
+        m_breakpoint_pages.end());
+    for (const auto &w : m_watchpoints) {
+        if (w.length == 0) {
+            throw std::invalid_argument{"watchpoint length is zero"};
+        }
+        if (w.length - 1 > UINT64_MAX - w.start) {
+            throw std::invalid_argument{"watchpoint range wraps around"};
+        }
+        if (!w.read && !w.write) {
+            throw std::invalid_argument{"watchpoint watches neither reads nor writes"};
+        }
+    }
+    for (const auto &p : m_csr_predicates) {
+        if (p.csr >= machine::csr::last) {
+            throw std::invalid_argument{"invalid csr in predicate"};
+        }
+        if (p.comparison != machine_csr_comparison::equal && p.comparison != machine_csr_comparison::not_equal) {
+            throw std::invalid_argument{"invalid comparison in predicate"};
+        }
+    }
+}
+
+bool break_condition_monitor::is_breakpoint_page(uint64_t vaddr_page) const {
+    return std::binary_search(m_breakpoint_pages.begin(), m_breakpoint_pages.end(), vaddr_page);
+}
+
+bool break_condition_monitor::check_breakpoint(uint64_t pc, uint64_t mcycle) {
+    // Allow resuming from the instruction where the last run stopped
+    if (mcycle == m_mcycle_begin) {
+        return false;
+    }
+    const auto it = std::lower_bound(m_breakpoints.begin(), m_breakpoints.end(), std::make_pair(pc, UINT64_C(0)));
+    if (it == m_breakpoints.end() || it->first != pc) {
+        return false;
+    }
+    m_event = machine_break_event{machine_break_event_type::breakpoint, it->second, pc};
+    return true;
+}
+
+bool break_condition_monitor::is_watched_page(uint64_t vaddr_page, uint64_t paddr_page) const {
+    return std::any_of(m_watchpoints.begin(), m_watchpoints.end(), [=](const auto &w) {
+        return ranges_overlap(w.virtual_address ? vaddr_page : paddr_page, PAGE_OFFSET_MASK + 1, w.start, w.length);
+    });
+}
+
+bool break_condition_monitor::check_memory_access(uint64_t vaddr, uint64_t paddr, uint64_t length, bool write) {
+    if (!is_reached()) {
+        for (uint64_t i = 0; i < m_watchpoints.size(); ++i) {
+            const auto &w = m_watchpoints[i];
+            const uint64_t addr = w.virtual_address ? vaddr : paddr;
+            if ((write ? w.write : w.read) && ranges_overlap(addr, length, w.start, w.length)) {
+                m_event = machine_break_event{machine_break_event_type::watchpoint, i, addr};
+                break;
+            }
+        }
+    }
+    return is_watched_page(vaddr & ~PAGE_OFFSET_MASK, paddr & ~PAGE_OFFSET_MASK);
+}
+
+bool break_condition_monitor::check_after_insn(const machine &m, uint64_t pc, uint64_t mcycle) {
+    if (is_reached()) {
+        return true;
+    }
+    for (uint64_t i = 0; i < m_csr_predicates.size(); ++i) {
+        const auto &p = m_csr_predicates[i];
+        uint64_t val = 0;
+        if (p.csr == machine::csr::pc) {
+            val = pc;
+        } else if (p.csr == machine::csr::mcycle) {
+            val = mcycle;
+        } else {
+            val = m.read_csr(p.csr);
+        }
+        if (((val & p.mask) == p.value) == (p.comparison == machine_csr_comparison::equal)) {
+            m_event = machine_break_event{machine_break_event_type::csr_predicate, i, pc};
+            return true;
+        }
+    }
+    return false;
+}
+
+} // namespace cartesi
@@ -0,0 +1,140 @@
+// Copyright Cartesi and individual authors (see AUTHORS)
+// SPDX-License-Identifier: LGPL-3.0-or-later
+//
+// This program is free software: you can redistribute it and/or modify it under
+// the terms of the GNU Lesser General Public License as published by the Free
+// Software Foundation, either version 3 of the License, or (at your option) any
+// later version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+// PARTICULAR PURPOSE. See the GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License along
+// with this program (see COPYING). If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef MACHINE_BREAK_CONDITIONS_H
+#define MACHINE_BREAK_CONDITIONS_H
+
+/// \file
+/// \brief Conditions that stop a machine run at an exact instruction
+
+#include <array>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "machine.h"
+
+namespace cartesi {
+
+/// \brief Memory range that stops the run when accessed
+struct machine_watchpoint {
+    uint64_t start{0};           ///< Start of range
+    uint64_t length{0};          ///< Length of range
+    bool virtual_address{false}; ///< True if range is in virtual address space, false if physical
+    bool read{false};            ///< Break on loads from range
+    bool write{true};            ///< Break on stores to range
+};
+
+/// \brief Comparison performed by a CSR predicate
+enum class machine_csr_comparison {
+    equal,     ///< Holds when (csr & mask) == value
+    not_equal, ///< Holds when (csr & mask) != value
+};
+
+/// \brief Predicate on a CSR value that stops the run when it holds
+struct machine_csr_predicate {
+    machine::csr csr{machine::csr::pc};                               ///< CSR to test
+    uint64_t mask{UINT64_C(-1)};                                      ///< Mask applied to CSR value
+    uint64_t value{0};                                                ///< Value to compare masked CSR value with
+    machine_csr_comparison comparison{machine_csr_comparison::equal}; ///< Comparison to perform
+};
+
+/// \brief Conditions that stop machine::run_until()
+struct machine_break_conditions {
+    std::vector<uint64_t> breakpoints;                 ///< Virtual addresses of instructions to stop before
+    std::vector<machine_watchpoint> watchpoints;       ///< Memory ranges to stop after accessing
+    std::vector<machine_csr_predicate> csr_predicates; ///< CSR predicates to stop after they hold
+};
+
+/// \brief Type of condition that stopped machine::run_until()
+enum class machine_break_event_type {
+    none,          ///< No condition was reached
+    breakpoint,    ///< About to execute instruction at breakpoint
+    watchpoint,    ///< Executed instruction that accessed a watchpoint
+    csr_predicate, ///< Executed instruction after which a CSR predicate holds
+};
+
+/// \brief Condition that stopped machine::run_until()
+struct machine_break_event {
+    machine_break_event_type type{}; ///< Type of condition
+    uint64_t index{0};               ///< Index of condition in its list in machine_break_conditions
+    uint64_t address{0};             ///< Breakpoint address, or address of access that hit watchpoint
+};
+
+/// \brief Tracks break conditions while the interpreter runs
+/// \details The interpreter only consults the monitor in the specialized loop it uses when a monitor is active.
+/// Pages with breakpoints are never kept in the fetch translation cache. Pages with watchpoints stay in the
+/// TLB, which is part of the machine state, but their entries are flagged here so hits on them are checked too.
+class break_condition_monitor {
+public:
+    /// \brief Constructor
+    /// \param conditions Conditions to monitor
+    /// \param mcycle_begin Value of mcycle when the run starts, where breakpoints are ignored
+    break_condition_monitor(const machine_break_conditions &conditions, uint64_t mcycle_begin);
+
+    /// \brief Checks if any instruction in a virtual page has a breakpoint
+    bool is_breakpoint_page(uint64_t vaddr_page) const;
+
+    /// \brief Checks if the instruction about to be executed has a breakpoint, recording the event if so
+    bool check_breakpoint(uint64_t pc, uint64_t mcycle);
+
+    /// \brief Checks a memory access against watchpoints, recording the event if one is hit
+    /// \returns True if the page accessed overlaps a watchpoint
+    bool check_memory_access(uint64_t vaddr, uint64_t paddr, uint64_t length, bool write);
+
+    /// \brief Checks if a page overlaps a watchpoint
+    bool is_watched_page(uint64_t vaddr_page, uint64_t paddr_page) const;
+
+    /// \brief Flags whether a TLB entry maps a page that overlaps a watchpoint
+    void set_tlb_entry_watched(TLB_entry_type etype, uint64_t eidx, bool watched) {
+        m_watched_tlb_entries[etype][eidx] = watched;
+    }
+
+    /// \brief Checks if accesses that hit a TLB entry must be checked against watchpoints
+    bool is_tlb_entry_watched(TLB_entry_type etype, uint64_t eidx) const {
+        return m_watched_tlb_entries[etype][eidx];
+    }
+
+    /// \brief Checks if a condition was reached after executing an instruction
+    /// \param m Machine, whose pc and mcycle are not up to date while the interpreter runs
+    /// \param pc Current pc
+    /// \param mcycle Current mcycle
+    bool check_after_insn(const machine &m, uint64_t pc, uint64_t mcycle);
+
+    /// \brief Checks if a condition was reached
+    bool is_reached(void) const {
+        return m_event.type != machine_break_event_type::none;
+    }
+
+    /// \brief Returns the condition that was reached
+    const machine_break_event &get_event(void) const {
+        return m_event;
+    }
+
+private:
+    std::vector<std::pair<uint64_t, uint64_t>> m_breakpoints; ///< Sorted pairs of breakpoint address and index
+    std::vector<uint64_t> m_breakpoint_pages;                 ///< Sorted virtual pages with breakpoints
+    std::vector<machine_watchpoint> m_watchpoints;            ///< Watchpoints
+    std::vector<machine_csr_predicate> m_csr_predicates;      ///< CSR predicates
+    uint64_t m_mcycle_begin;                                  ///< Value of mcycle when run started
+    machine_break_event m_event;                              ///< Condition reached, if any
+
+    std::array<std::array<bool, PMA_TLB_SIZE>, 3> m_watched_tlb_entries{}; ///< TLB entries mapping watched pages
+};
+
+} // namespace cartesi
+
+#endif
@@ -17,6 +17,7 @@
 #include "machine-c-api.h"
 #include "machine-c-api-internal.h"
 
+#include <algorithm>
 #include <any>
 #include <cstring>
 #include <exception>
@@ -289,6 +290,13 @@ static cartesi::virtio_device_config convert_from_c(const cm_virtio_device_confi
         case CM_VIRTIO_DEVICE_NET_TUNTAP: {
             cartesi::virtio_net_tuntap_config new_cpp_virtio_device_config{};
             new_cpp_virtio_device_config.iface = null_to_empty(c_config->device.net_tuntap.iface);
+            new_cpp_virtio_device_config.queue_pairs = std::max<uint32_t>(c_config->device.net_tuntap.queue_pairs, 1);
+            return new_cpp_virtio_device_config;
+        }
+        case CM_VIRTIO_DEVICE_BLK: {
+            cartesi::virtio_blk_config new_cpp_virtio_device_config{};
+            new_cpp_virtio_device_config.image_filename = null_to_empty(c_config->device.blk.image_filename);
+            new_cpp_virtio_device_config.read_only = c_config->device.blk.read_only;
             return new_cpp_virtio_device_config;
         }
         default:
@@ -322,6 +330,12 @@ static cm_virtio_device_config convert_to_c(const cartesi::virtio_device_config
             } else if constexpr (std::is_same_v<T, cartesi::virtio_net_tuntap_config>) {
                 new_c_virtio_device_config.type = CM_VIRTIO_DEVICE_NET_TUNTAP;
                 new_c_virtio_device_config.device.net_tuntap.iface = convert_to_c(cpp_virtio_device_config.iface);
+                new_c_virtio_device_config.device.net_tuntap.queue_pairs = cpp_virtio_device_config.queue_pairs;
+            } else if constexpr (std::is_same_v<T, cartesi::virtio_blk_config>) {
+                new_c_virtio_device_config.type = CM_VIRTIO_DEVICE_BLK;
+                new_c_virtio_device_config.device.blk.image_filename =
+                    convert_to_c(cpp_virtio_device_config.image_filename);
+                new_c_virtio_device_config.device.blk.read_only = cpp_virtio_device_config.read_only;
             } else {
                 throw std::invalid_argument("invalid virtio device configuration");
             }
@@ -484,10 +498,42 @@ cartesi::machine_runtime_config convert_from_c(const cm_machine_runtime_config *
     new_cpp_machine_runtime_config.concurrency =
         cartesi::concurrency_runtime_config{c_config->concurrency.update_merkle_tree};
     new_cpp_machine_runtime_config.htif = cartesi::htif_runtime_config{c_config->htif.no_console_putchar};
+    switch (c_config->console.output_mode) {
+        case CM_CONSOLE_OUTPUT_DIRECT:
+            new_cpp_machine_runtime_config.console.output_mode = cartesi::console_output_mode::direct;
+            break;
+        case CM_CONSOLE_OUTPUT_BUFFERED:
+            new_cpp_machine_runtime_config.console.output_mode = cartesi::console_output_mode::buffered;
+            break;
+        case CM_CONSOLE_OUTPUT_FILE:
+            new_cpp_machine_runtime_config.console.output_mode = cartesi::console_output_mode::file;
+            break;
+        case CM_CONSOLE_OUTPUT_MEMORY:
+            new_cpp_machine_runtime_config.console.output_mode = cartesi::console_output_mode::memory;
+            break;
+        default:
+            throw std::invalid_argument("invalid console output mode");
+    }
+    new_cpp_machine_runtime_config.console.output_filename = null_to_empty(c_config->console.output_filename);
+    new_cpp_machine_runtime_config.console.output_buffer_size = c_config->console.output_buffer_size;
     new_cpp_machine_runtime_config.skip_root_hash_check = c_config->skip_root_hash_check;
     new_cpp_machine_runtime_config.skip_root_hash_store = c_config->skip_root_hash_store;
     new_cpp_machine_runtime_config.skip_version_check = c_config->skip_version_check;
     new_cpp_machine_runtime_config.soft_yield = c_config->soft_yield;
+    switch (c_config->poll_backend) {
+        case CM_POLL_BACKEND_AUTO:
+            new_cpp_machine_runtime_config.poll_backend = cartesi::os_poll_backend::automatic;
+            break;
+        case CM_POLL_BACKEND_SELECT:
+            new_cpp_machine_runtime_config.poll_backend = cartesi::os_poll_backend::select;
+            break;
+        case CM_POLL_BACKEND_EPOLL:
+            new_cpp_machine_runtime_config.poll_backend = cartesi::os_poll_backend::epoll;
+            break;
+        default:
+            throw std::invalid_argument("invalid poll backend");
+    }
+    new_cpp_machine_runtime_config.huge_pages = c_config->huge_pages;
     return new_cpp_machine_runtime_config;
 }
 
@@ -850,6 +896,7 @@ cm_memory_range_descr convert_to_c(const cartesi::machine_memory_range_descr &cp
     new_mrd.start = cpp_mrd.start;
     new_mrd.length = cpp_mrd.length;
     new_mrd.description = convert_to_c(cpp_mrd.description);
+    new_mrd.huge_pages = cpp_mrd.huge_pages;
     return new_mrd;
 }
 
@@ -896,6 +943,9 @@ void cm_delete_machine_config(const cm_machine_config *config) {
             case CM_VIRTIO_DEVICE_NET_TUNTAP:
                 delete[] entry.device.net_tuntap.iface;
                 break;
+            case CM_VIRTIO_DEVICE_BLK:
+                delete[] entry.device.blk.image_filename;
+                break;
             default:
                 break;
         }
@@ -982,6 +1032,168 @@ int cm_machine_run(cm_machine *m, uint64_t mcycle_end, CM_BREAK_REASON *break_re
     return cm_result_failure(err_msg);
 }
 
+int cm_machine_run_record_trace(cm_machine *m, uint64_t mcycle_end, cm_execution_trace **trace,
+    CM_BREAK_REASON *break_reason_result, char **err_msg) try {
+    if (trace == nullptr) {
+        throw std::invalid_argument("invalid trace output");
+    }
+    auto *cpp_machine = convert_from_c(m);
+    cartesi::execution_trace cpp_trace;
+    cartesi::interpreter_break_reason break_reason = cpp_machine->run_record_trace(mcycle_end, cpp_trace);
+    const std::string bin = cpp_trace.to_binary();
+    auto *new_trace = new cm_execution_trace{};
+    new_trace->data = new unsigned char[bin.size()];
+    new_trace->length = bin.size();
+    memcpy(new_trace->data, bin.data(), bin.size());
+    *trace = new_trace;
+    if (break_reason_result) {
+        *break_reason_result = static_cast<CM_BREAK_REASON>(break_reason);
+    }
+    return cm_result_success(err_msg);
+} catch (...) {
+    if (break_reason_result) {
+        *break_reason_result = CM_BREAK_REASON_FAILED;
+    }
+    return cm_result_failure(err_msg);
+}
+
+void cm_delete_execution_trace(cm_execution_trace *trace) {
+    if (trace == nullptr) {
+        return;
+    }
+    delete[] trace->data;
+    delete trace;
+}
+
+int cm_machine_run_replay_trace(cm_machine *m, const cm_execution_trace *trace, CM_BREAK_REASON *break_reason_result,
+    char **err_msg) try {
+    if (trace == nullptr || (trace->data == nullptr && trace->length != 0)) {
+        throw std::invalid_argument("invalid trace");
+    }
+    auto *cpp_machine = convert_from_c(m);
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+    const std::string bin(reinterpret_cast<const char *>(trace->data), trace->length);
+    cartesi::interpreter_break_reason break_reason =
+        cpp_machine->run_replay_trace(cartesi::execution_trace::from_binary(bin));
+    if (break_reason_result) {
+        *break_reason_result = static_cast<CM_BREAK_REASON>(break_reason);
+    }
+    return cm_result_success(err_msg);
+} catch (...) {
+    if (break_reason_result) {
+        *break_reason_result = CM_BREAK_REASON_FAILED;
+    }
+    return cm_result_failure(err_msg);
+}
+
+static cartesi::machine_break_conditions convert_from_c(const cm_break_conditions *c_conditions) {
+    if (c_conditions == nullptr) {
+        throw std::invalid_argument("invalid break conditions");
+    }
+    if ((c_conditions->breakpoints.entry == nullptr && c_conditions->breakpoints.count != 0) ||
+        (c_conditions->watchpoints.entry == nullptr && c_conditions->watchpoints.count != 0) ||
+        (c_conditions->csr_predicates.entry == nullptr && c_conditions->csr_predicates.count != 0)) {
+        throw std::invalid_argument("invalid break conditions");
+    }
+    cartesi::machine_break_conditions new_cpp_conditions{};
+    for (size_t i = 0; i < c_conditions->breakpoints.count; ++i) {
+        new_cpp_conditions.breakpoints.push_back(c_conditions->breakpoints.entry[i]);
+    }
+    for (size_t i = 0; i < c_conditions->watchpoints.count; ++i) {
+        const auto &w = c_conditions->watchpoints.entry[i];
+        new_cpp_conditions.watchpoints.push_back({w.start, w.length, w.virtual_address, w.read, w.write});
+    }
+    for (size_t i = 0; i < c_conditions->csr_predicates.count; ++i) {
+        const auto &p = c_conditions->csr_predicates.entry[i];
+        new_cpp_conditions.csr_predicates.push_back({static_cast<cartesi::machine::csr>(p.csr), p.mask, p.value,
+            static_cast<cartesi::machine_csr_comparison>(p.comparison)});
+    }
+    return new_cpp_conditions;
+}
+
+int cm_machine_run_until(cm_machine *m, uint64_t mcycle_end, const cm_break_conditions *conditions,
+    CM_BREAK_REASON *break_reason_result, cm_break_event *event, char **err_msg) try {
+    auto *cpp_machine = convert_from_c(m);
+    const cartesi::machine_break_conditions cpp_conditions = convert_from_c(conditions);
+    cartesi::machine_break_event cpp_event{};
+    cartesi::interpreter_break_reason break_reason = cpp_machine->run_until(mcycle_end, cpp_conditions, cpp_event);
+    if (break_reason_result) {
+        *break_reason_result = static_cast<CM_BREAK_REASON>(break_reason);
+    }
+    if (event) {
+        event->type = static_cast<CM_BREAK_EVENT_TYPE>(cpp_event.type);
+        event->index = cpp_event.index;
+        event->address = cpp_event.address;
+    }
+    return cm_result_success(err_msg);
+} catch (...) {
+    if (break_reason_result) {
+        *break_reason_result = CM_BREAK_REASON_FAILED;
+    }
+    return cm_result_failure(err_msg);
+}
+
+int cm_machine_serve_gdb(cm_machine *m, const char *address, uint64_t mcycle_end, char **err_msg) try {
+    if (address == nullptr) {
+        throw std::invalid_argument("invalid address");
+    }
+    auto *cpp_machine = convert_from_c(m);
+    cpp_machine->serve_gdb(address, mcycle_end);
+    return cm_result_success(err_msg);
+} catch (...) {
+    return cm_result_failure(err_msg);
+}
+
+int cm_machine_start_profiler(cm_machine *m, uint64_t sample_interval, char **err_msg) try {
+    auto *cpp_machine = convert_from_c(m);
+    cpp_machine->start_profiler(sample_interval);
+    return cm_result_success(err_msg);
+} catch (...) {
+    return cm_result_failure(err_msg);
+}
+
+int cm_machine_stop_profiler(cm_machine *m, char **err_msg) try {
+    auto *cpp_machine = convert_from_c(m);
+    cpp_machine->stop_profiler();
+    return cm_result_success(err_msg);
+} catch (...) {
+    return cm_result_failure(err_msg);
+}
+
+int cm_machine_write_profile(const cm_machine *m, const char *filename, CM_PROFILE_FORMAT format,
+    const char *elf_filename, char **err_msg) try {
+    if (filename == nullptr) {
+        throw std::invalid_argument("invalid filename");
+    }
+    if (format < CM_PROFILE_FORMAT_COLLAPSED || format > CM_PROFILE_FORMAT_SUMMARY) {
+        throw std::invalid_argument("invalid profile format");
+    }
+    const auto *cpp_machine = convert_from_c(m);
+    cpp_machine->write_profile(filename, static_cast<cartesi::machine_profile_format>(format),
+        elf_filename != nullptr ? elf_filename : "");
+    return cm_result_success(err_msg);
+} catch (...) {
+    return cm_result_failure(err_msg);
+}
+
+int cm_machine_read_console_output(cm_machine *m, uint8_t *data, uint64_t max_length, uint64_t *length,
+    char **err_msg) try {
+    if (data == nullptr && max_length != 0) {
+        throw std::invalid_argument("invalid data buffer");
+    }
+    if (length == nullptr) {
+        throw std::invalid_argument("invalid length output");
+    }
+    auto *cpp_machine = convert_from_c(m);
+    *length = cpp_machine->read_console_output(data, max_length);
+    return cm_result_success(err_msg);
+} catch (...) {
+    if (length != nullptr) {
+        *length = 0;
+    }
+    return cm_result_failure(err_msg);
+}
+
 int cm_read_uarch_x(const cm_machine *m, int i, uint64_t *val, char **err_msg) try {
     if (val == nullptr) {
         throw std::invalid_argument("invalid val output");
@@ -1555,6 +1767,7 @@ void cm_delete_machine_runtime_config(const cm_machine_runtime_config *config) {
     if (config == nullptr) {
         return;
     }
+    delete[] config->console.output_filename;
     delete config;
 }
 
@@ -1636,6 +1849,27 @@ int cm_send_cmio_response(cm_machine *m, uint16_t reason, const unsigned char *d
     return cm_result_failure(err_msg);
 }
 
+int cm_machine_get_cmio_tx_buffer(const cm_machine *m, const unsigned char **data, uint64_t *length,
+    char **err_msg) try {
+    if (data == nullptr) {
+        throw std::invalid_argument("invalid data output");
+    }
+    if (length == nullptr) {
+        throw std::invalid_argument("invalid length output");
+    }
+    const auto *cpp_machine = convert_from_c(m);
+    *data = cpp_machine->get_cmio_tx_buffer(*length);
+    return cm_result_success(err_msg);
+} catch (...) {
+    if (data != nullptr) {
+        *data = nullptr;
+    }
+    if (length != nullptr) {
+        *length = 0;
+    }
+    return cm_result_failure(err_msg);
+}
+
 int cm_log_send_cmio_response(cm_machine *m, uint16_t reason, const unsigned char *data, size_t length,
     cm_access_log_type log_type, bool one_based, cm_access_log **access_log, char **err_msg) try {
     if (access_log == nullptr) {
@@ -94,7 +94,8 @@ typedef enum { // NOLINT(modernize-use-using)
     CM_BREAK_REASON_YIELDED_MANUALLY,
     CM_BREAK_REASON_YIELDED_AUTOMATICALLY,
     CM_BREAK_REASON_YIELDED_SOFTLY,
-    CM_BREAK_REASON_REACHED_TARGET_MCYCLE
+    CM_BREAK_REASON_REACHED_TARGET_MCYCLE,
+    CM_BREAK_REASON_REACHED_BREAK_CONDITION
 } CM_BREAK_REASON;
 
 /// \brief List of CSRs to use with read_csr and write_csr
@@ -245,7 +246,8 @@ typedef enum { // NOLINT(modernize-use-using)
     CM_VIRTIO_DEVICE_CONSOLE,
     CM_VIRTIO_DEVICE_P9FS,
     CM_VIRTIO_DEVICE_NET_USER,
-    CM_VIRTIO_DEVICE_NET_TUNTAP
+    CM_VIRTIO_DEVICE_NET_TUNTAP,
+    CM_VIRTIO_DEVICE_BLK
 } CM_VIRTIO_DEVICE_TYPE;
 
 /// \brief VirtIO Plan 9 filesystem device state configuration
@@ -275,15 +277,23 @@ typedef struct { // NOLINT(modernize-use-using)
 } cm_virtio_net_user_config;
 
 /// \brief VirtIO TUN/TAP network device state configuration
-typedef struct {       // NOLINT(modernize-use-using)
-    const char *iface; ///< Host's tap network interface (e.g "tap0")
+typedef struct {          // NOLINT(modernize-use-using)
+    const char *iface;    ///< Host's tap network interface (e.g "tap0")
+    uint32_t queue_pairs; ///< Number of receive/transmit queue pairs (0 or 1 for a single pair)
 } cm_virtio_net_tuntap_config;
 
+/// \brief VirtIO block device state configuration
+typedef struct {                // NOLINT(modernize-use-using)
+    const char *image_filename; ///< Path to the host image file or block device
+    bool read_only;             ///< Whether the guest is prevented from writing to the image
+} cm_virtio_blk_config;
+
 /// \brief VirtIO device union
 typedef union {                             // NOLINT(modernize-use-using)
     cm_virtio_p9fs_config p9fs;             ///< Plan 9 filesystem
     cm_virtio_net_user_config net_user;     ///< User-mode networking
     cm_virtio_net_tuntap_config net_tuntap; ///< TUN/TAP networking
+    cm_virtio_blk_config blk;               ///< Block device
 } cm_virtio_device_config_union;
 
 /// \brief VirtIO device state configuration
@@ -423,6 +433,97 @@ typedef struct {                    // NOLINT(modernize-use-using)
     cm_access_log_type log_type;    ///< Log type
 } cm_access_log;
 
+/// \brief Trace of the nondeterministic events consumed by a machine run
+typedef struct {         // NOLINT(modernize-use-using)
+    unsigned char *data; ///< Trace in its compact binary representation
+    size_t length;       ///< Length of data in bytes
+} cm_execution_trace;
+
+/// \brief Array of breakpoint addresses
+typedef struct {     // NOLINT(modernize-use-using)
+    uint64_t *entry; ///< Virtual addresses of instructions to stop before
+    size_t count;    ///< Number of breakpoints
+} cm_breakpoint_array;
+
+/// \brief Memory range that stops cm_machine_run_until when accessed
+typedef struct {          // NOLINT(modernize-use-using)
+    uint64_t start;       ///< Start of range
+    uint64_t length;      ///< Length of range
+    bool virtual_address; ///< True if range is in virtual address space, false if physical
+    bool read;            ///< Break on loads from range
+    bool write;           ///< Break on stores to range
+} cm_watchpoint;
+
+/// \brief Array of watchpoints
+typedef struct { // NOLINT(modernize-use-using)
+    cm_watchpoint *entry;
+    size_t count;
+} cm_watchpoint_array;
+
+/// \brief Comparison performed by a CSR predicate
+typedef enum { // NOLINT(modernize-use-using)
+    CM_CSR_COMPARISON_EQUAL,
+    CM_CSR_COMPARISON_NOT_EQUAL
+} CM_CSR_COMPARISON;
+
+/// \brief Predicate on a CSR value that stops cm_machine_run_until when it holds
+typedef struct {                  // NOLINT(modernize-use-using)
+    CM_PROC_CSR csr;              ///< CSR to test
+    uint64_t mask;                ///< Mask applied to CSR value
+    uint64_t value;               ///< Value to compare masked CSR value with
+    CM_CSR_COMPARISON comparison; ///< Comparison to perform
+} cm_csr_predicate;
+
+/// \brief Array of CSR predicates
+typedef struct { // NOLINT(modernize-use-using)
+    cm_csr_predicate *entry;
+    size_t count;
+} cm_csr_predicate_array;
+
+/// \brief Conditions that stop cm_machine_run_until
+typedef struct {                           // NOLINT(modernize-use-using)
+    cm_breakpoint_array breakpoints;       ///< Instructions to stop before
+    cm_watchpoint_array watchpoints;       ///< Memory ranges to stop after accessing
+    cm_csr_predicate_array csr_predicates; ///< CSR predicates to stop after they hold
+} cm_break_conditions;
+
+/// \brief Type of condition that stopped cm_machine_run_until
+typedef enum { // NOLINT(modernize-use-using)
+    CM_BREAK_EVENT_NONE,
+    CM_BREAK_EVENT_BREAKPOINT,
+    CM_BREAK_EVENT_WATCHPOINT,
+    CM_BREAK_EVENT_CSR_PREDICATE
+} CM_BREAK_EVENT_TYPE;
+
+/// \brief Condition that stopped cm_machine_run_until
+typedef struct {              // NOLINT(modernize-use-using)
+    CM_BREAK_EVENT_TYPE type; ///< Type of condition
+    uint64_t index;           ///< Index of condition in its array within cm_break_conditions
+    uint64_t address;         ///< Breakpoint address, or address of access that hit watchpoint
+} cm_break_event;
+
+/// \brief Format of profiles written by cm_machine_write_profile
+typedef enum { // NOLINT(modernize-use-using)
+    CM_PROFILE_FORMAT_COLLAPSED,
+    CM_PROFILE_FORMAT_PPROF,
+    CM_PROFILE_FORMAT_SUMMARY
+} CM_PROFILE_FORMAT;
+
+/// \brief Backends used to wait for host events of VirtIO devices
+typedef enum {              // NOLINT(modernize-use-using)
+    CM_POLL_BACKEND_AUTO,   ///< Best backend available in the host
+    CM_POLL_BACKEND_SELECT, ///< Portable select()
+    CM_POLL_BACKEND_EPOLL   ///< Linux epoll
+} CM_POLL_BACKEND;
+
+/// \brief Destinations of console output
+typedef enum {                  // NOLINT(modernize-use-using)
+    CM_CONSOLE_OUTPUT_DIRECT,   ///< Write each character to stdout as soon as the guest writes it
+    CM_CONSOLE_OUTPUT_BUFFERED, ///< Buffer characters and write them to stdout from a background thread
+    CM_CONSOLE_OUTPUT_FILE,     ///< Buffer characters and write them to a file from a background thread
+    CM_CONSOLE_OUTPUT_MEMORY    ///< Capture characters in memory, to be read with cm_machine_read_console_output
+} CM_CONSOLE_OUTPUT_MODE;
+
 /// \brief Concurrency runtime configuration
 typedef struct { // NOLINT(modernize-use-using)
     uint64_t update_merkle_tree;
@@ -433,14 +534,24 @@ typedef struct { // NOLINT(modernize-use-using)
     bool no_console_putchar;
 } cm_htif_runtime_config;
 
+/// \brief Console runtime configuration
+typedef struct {                        // NOLINT(modernize-use-using)
+    CM_CONSOLE_OUTPUT_MODE output_mode; ///< Destination of console output
+    const char *output_filename;        ///< File written in CM_CONSOLE_OUTPUT_FILE mode
+    uint64_t output_buffer_size;        ///< Size of output buffer, or 0 for the default
+} cm_console_runtime_config;
+
 /// \brief Machine runtime configuration
 typedef struct { // NOLINT(modernize-use-using)
     cm_concurrency_runtime_config concurrency;
     cm_htif_runtime_config htif;
+    cm_console_runtime_config console;
     bool skip_root_hash_check;
     bool skip_root_hash_store;
     bool skip_version_check;
     bool soft_yield;
+    CM_POLL_BACKEND poll_backend;
+    bool huge_pages;
 } cm_machine_runtime_config;
 
 /// \brief Machine instance handle
@@ -465,6 +576,7 @@ typedef struct { // NOLINT(modernize-use-using)
     uint64_t start;
     uint64_t length;
     const char *description;
+    bool huge_pages;
 } cm_memory_range_descr;
 
 /// \brief Memory range description array
@@ -539,6 +651,122 @@ CM_API void cm_delete_machine(cm_machine *m);
 /// \returns 0 for success, non zero code for error
 CM_API int cm_machine_run(cm_machine *m, uint64_t mcycle_end, CM_BREAK_REASON *break_reason_result, char **err_msg);
 
+/// \brief Runs the machine like cm_machine_run, recording the nondeterministic events it consumes.
+/// \param m Pointer to valid machine instance
+/// \param mcycle_end End cycle value
+/// \param trace Receives the execution trace, which must be deleted with cm_delete_execution_trace
+/// \param break_reason Receives reason for machine run interruption when not NULL
+/// \param err_msg Receives the error message if function execution fails
+/// or NULL in case of successful function execution. In case of failure error_msg
+/// must be deleted by the function caller using cm_delete_cstring.
+/// err_msg can be NULL, meaning the error message won't be received.
+/// \returns 0 for success, non zero code for error
+/// \details The trace holds loads and stores to VirtIO and HTIF devices and polls for external interrupts,
+/// together with every change they made to the machine state.
+CM_API int cm_machine_run_record_trace(cm_machine *m, uint64_t mcycle_end, cm_execution_trace **trace,
+    CM_BREAK_REASON *break_reason_result, char **err_msg);
+
+/// \brief Deletes the instance of cm_execution_trace acquired from cm_machine_run_record_trace
+/// \param trace Valid pointer to cm_execution_trace object
+CM_API void cm_delete_execution_trace(cm_execution_trace *trace);
+
+/// \brief Re-executes a run recorded by cm_machine_run_record_trace without emulating host devices.
+/// \param m Pointer to valid machine instance, in the same state the recording machine was when the trace started
+/// \param trace Execution trace to replay
+/// \param break_reason Receives reason for machine run interruption when not NULL
+/// \param err_msg Receives the error message if function execution fails
+/// or NULL in case of successful function execution. In case of failure error_msg
+/// must be deleted by the function caller using cm_delete_cstring.
+/// err_msg can be NULL, meaning the error message won't be received.
+/// \returns 0 for success, non zero code for error, including when the execution diverges from the trace
+/// \details Replay re-executes every instruction, so it only saves the time the recorded run spent waiting on host
+/// devices.
+/// It does not update host-side device state, so afterwards the machine is replay-only:
+/// cm_machine_run, cm_machine_run_until and cm_machine_run_record_trace fail.
+CM_API int cm_machine_run_replay_trace(cm_machine *m, const cm_execution_trace *trace,
+    CM_BREAK_REASON *break_reason_result, char **err_msg);
+
+/// \brief Runs the machine like cm_machine_run, but also stops exactly when a break condition is reached.
+/// \param m Pointer to valid machine instance
+/// \param mcycle_end End cycle value
+/// \param conditions Breakpoints, watchpoints and CSR predicates to stop at
+/// \param break_reason Receives reason for machine run interruption when not NULL,
+/// CM_BREAK_REASON_REACHED_BREAK_CONDITION when a condition was reached
+/// \param event Receives the condition that was reached when not NULL
+/// \param err_msg Receives the error message if function execution fails
+/// or NULL in case of successful function execution. In case of failure error_msg
+/// must be deleted by the function caller using cm_delete_cstring.
+/// err_msg can be NULL, meaning the error message won't be received.
+/// \returns 0 for success, non zero code for error
+/// \details Breakpoints stop before executing the instruction, watchpoints and CSR predicates stop after
+/// executing the instruction that triggered them. Breakpoints are ignored for the first instruction,
+/// so calling the function again resumes from where it stopped.
+CM_API int cm_machine_run_until(cm_machine *m, uint64_t mcycle_end, const cm_break_conditions *conditions,
+    CM_BREAK_REASON *break_reason_result, cm_break_event *event, char **err_msg);
+
+/// \brief Waits for GDB to connect and serves it with the GDB Remote Serial Protocol until it detaches
+/// \param m Pointer to valid machine instance
+/// \param address Address to listen at, either <host>:<port> for TCP or unix:<path> for a Unix socket
+/// \param mcycle_end End cycle value for continue and single-step requests
+/// \param err_msg Receives the error message if function execution fails
+/// or NULL in case of successful function execution. In case of failure error_msg
+/// must be deleted by the function caller using cm_delete_cstring.
+/// err_msg can be NULL, meaning the error message won't be received.
+/// \returns 0 for success, non zero code for error
+/// \details Breakpoints, watchpoints and single-steps are checked by the interpreter, as in cm_machine_run_until.
+/// Remote machines are served by the remote server itself, so GDB must be able to reach the address there.
+/// The server keeps polling its other connections, but fails every other machine request until GDB detaches.
+CM_API int cm_machine_serve_gdb(cm_machine *m, const char *address, uint64_t mcycle_end, char **err_msg);
+
+/// \brief Starts profiling the guest in subsequent runs, discarding any previous profile
+/// \param m Pointer to valid machine instance
+/// \param sample_interval Number of cycles between samples of the program counter
+/// \param err_msg Receives the error message if function execution fails
+/// or NULL in case of successful function execution. In case of failure error_msg
+/// must be deleted by the function caller using cm_delete_cstring.
+/// err_msg can be NULL, meaning the error message won't be received.
+/// \returns 0 for success, non zero code for error
+/// \details Besides sampling the program counter, the profiler counts instructions per opcode and traps per cause.
+/// Profiling does not change the machine state, and machines that are not profiled run at full speed.
+CM_API int cm_machine_start_profiler(cm_machine *m, uint64_t sample_interval, char **err_msg);
+
+/// \brief Stops profiling the guest and discards the profile
+/// \param m Pointer to valid machine instance
+/// \param err_msg Receives the error message if function execution fails
+/// or NULL in case of successful function execution. In case of failure error_msg
+/// must be deleted by the function caller using cm_delete_cstring.
+/// err_msg can be NULL, meaning the error message won't be received.
+/// \returns 0 for success, non zero code for error
+CM_API int cm_machine_stop_profiler(cm_machine *m, char **err_msg);
+
+/// \brief Writes the profile collected since the profiler was started
+/// \param m Pointer to valid machine instance
+/// \param filename Name of file to write
+/// \param format Format of profile
+/// \param elf_filename Guest ELF file with function symbols used to name sampled addresses, or NULL
+/// \param err_msg Receives the error message if function execution fails
+/// or NULL in case of successful function execution. In case of failure error_msg
+/// must be deleted by the function caller using cm_delete_cstring.
+/// err_msg can be NULL, meaning the error message won't be received.
+/// \returns 0 for success, non zero code for error
+CM_API int cm_machine_write_profile(const cm_machine *m, const char *filename, CM_PROFILE_FORMAT format,
+    const char *elf_filename, char **err_msg);
+
+/// \brief Moves console output captured in memory out of the machine
+/// \param m Pointer to valid machine instance
+/// \param data Receives the output, oldest characters first
+/// \param max_length Maximum number of characters to receive
+/// \param length Receives the number of characters actually moved
+/// \param err_msg Receives the error message if function execution fails
+/// or NULL in case of successful function execution. In case of failure error_msg
+/// must be deleted by the function caller using cm_delete_cstring.
+/// err_msg can be NULL, meaning the error message won't be received.
+/// \returns 0 for success, non zero code for error
+/// \details Only machines with console output mode CM_CONSOLE_OUTPUT_MEMORY capture output. When the guest writes
+/// more than the output buffer can hold before it is read, the oldest characters are discarded.
+CM_API int cm_machine_read_console_output(cm_machine *m, uint8_t *data, uint64_t max_length, uint64_t *length,
+    char **err_msg);
+
 /// \brief Runs the machine for one micro cycle logging all accesses to the state.
 /// \param m Pointer to valid machine instance
 /// \param log_type Type of access log to generate.
@@ -1925,6 +2153,22 @@ CM_API void cm_delete_memory_range_descr_array(cm_memory_range_descr_array *mrda
 CM_API int cm_send_cmio_response(cm_machine *m, uint16_t reason, const unsigned char *data, size_t length,
     char **err_msg);
 
+/// \brief Returns the host memory backing the cmio tx buffer, so outputs can be read without copies
+/// \param m Pointer to valid machine instance
+/// \param data Receives pointer to the start of the buffer. It must not be written to or freed by the caller.
+/// \param length Receives the length of the buffer.
+/// \param err_msg Receives the error message if function execution fails
+/// or NULL in case of successful function execution. In case of failure error_msg
+/// must be deleted by the function caller using cm_delete_cstring.
+/// err_msg can be NULL, meaning the error message won't be received.
+/// \returns 0 for success, non zero code for error
+/// \details The pointer remains valid until the machine is destroyed or the buffer range is replaced.
+/// Contents reflect the current machine state, so they change as the machine runs.
+/// Remote machines support it only after cm_jsonrpc_enable_shared_memory, and then return a copy of the buffer in
+/// shared memory that is refreshed on each call.
+CM_API int cm_machine_get_cmio_tx_buffer(const cm_machine *m, const unsigned char **data, uint64_t *length,
+    char **err_msg);
+
 /// \brief Send cmio response and returns an access log
 /// \param m Pointer to valid machine instance
 /// \param reason Reason for sending the response.
@@ -154,14 +154,22 @@ struct virtio_net_user_config final {
 
 /// \brief VirtIO TUN/TAP network device state config
 struct virtio_net_tuntap_config final {
-    std::string iface{}; ///< Host's tap network interface (e.g "tap0")
+    std::string iface{};     ///< Host's tap network interface (e.g "tap0")
+    uint32_t queue_pairs{1}; ///< Number of receive/transmit queue pairs, each with its own tap queue
+};
+
+/// \brief VirtIO block device state config
+struct virtio_blk_config final {
+    std::string image_filename{}; ///< Path to the host image file or block device
+    bool read_only{false};        ///< Whether the guest is prevented from writing to the image
 };
 
 /// \brief VirtIO device state config
 using virtio_device_config = std::variant<virtio_console_config, ///< Console
     virtio_p9fs_config,                                          ///< Plan 9 filesystem
     virtio_net_user_config,                                      ///< User-mode networking
-    virtio_net_tuntap_config                                     ///< TUN/TAP networking
+    virtio_net_tuntap_config,                                    ///< TUN/TAP networking
+    virtio_blk_config                                            ///< Block device
     >;
 
 /// \brief List of VirtIO devices
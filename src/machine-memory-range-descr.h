@@ -28,6 +28,7 @@ struct machine_memory_range_descr { // NOLINT(bugprone-exception-escape)
     uint64_t start = 0;             ///< Start of memory range
     uint64_t length = 0;            ///< Length of memory range
     std::string description{};      ///< User-friendly description for memory range
+    bool huge_pages = false;        ///< True if the host backs the range with huge pages
 };
 
 /// \brief List of memory range descriptions used for introspection (i.e., get_memory_ranges())
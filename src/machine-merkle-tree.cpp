@@ -288,6 +288,119 @@ bool machine_merkle_tree::end_update(hasher_type &h) {
     return true;
 }
 
+machine_merkle_tree::tree_node *machine_merkle_tree::get_node(address_type address, int log2_size, bool create) {
+    tree_node *node = m_root;
+    int log2_node_size = get_log2_root_size();
+    // Descend tree until we reach the node at the end of the path determined by the address,
+    // creating the needed nodes along the way, if requested
+    while (node && log2_node_size > log2_size) {
+        const int log2_child_size = log2_node_size - 1;
+        const int bit = (address & (UINT64_C(1) << log2_child_size)) != 0;
+        tree_node *child = node->child[bit];
+        if (!child && create) {
+            child = create_node();
+            if (!child) {
+                return nullptr;
+            }
+            child->parent = node;
+            child->hash = get_pristine_hash(log2_child_size);
+            node->child[bit] = child;
+        }
+        node = child;
+        log2_node_size = log2_child_size;
+    }
+    return node;
+}
+
+void machine_merkle_tree::get_subtree_hashes(const tree_node *node, int log2_size, size_t index,
+    subtree_hashes_type &hashes) const {
+    hashes[index] = node ? node->hash : get_pristine_hash(log2_size);
+    if (log2_size > get_log2_page_size()) {
+        get_subtree_hashes(node ? node->child[0] : nullptr, log2_size - 1, 2 * index, hashes);
+        get_subtree_hashes(node ? node->child[1] : nullptr, log2_size - 1, 2 * index + 1, hashes);
+    }
+}
+
+machine_merkle_tree::hash_type machine_merkle_tree::get_node_hash(address_type address, int log2_size) {
+    if (log2_size >= get_log2_root_size() || log2_size < get_log2_page_size()) {
+        throw std::runtime_error{"log2_size is out of bounds"};
+    }
+    if (address & ((~UINT64_C(0)) >> (get_log2_root_size() - log2_size))) {
+        throw std::runtime_error{"misaligned node address"};
+    }
+    const tree_node *node = get_node(address, log2_size, false);
+    return node ? node->hash : get_pristine_hash(log2_size);
+}
+
+machine_merkle_tree::subtree_hashes_type machine_merkle_tree::get_subtree_hashes(address_type address,
+    int log2_size) {
+    if (log2_size >= get_log2_root_size() || log2_size < get_log2_page_size()) {
+        throw std::runtime_error{"log2_size is out of bounds"};
+    }
+    if (address & ((~UINT64_C(0)) >> (get_log2_root_size() - log2_size))) {
+        throw std::runtime_error{"misaligned subtree address"};
+    }
+    subtree_hashes_type hashes(size_t{2} << (log2_size - get_log2_page_size()));
+    get_subtree_hashes(get_node(address, log2_size, false), log2_size, 1, hashes);
+    return hashes;
+}
+
+machine_merkle_tree::tree_node *machine_merkle_tree::set_subtree_hashes(tree_node *node, tree_node *parent,
+    address_type address, int log2_size, size_t index, const subtree_hashes_type &hashes) {
+    const hash_type &hash = hashes[index];
+    // Pristine subtrees that are not yet represented in the tree can remain so
+    if (!node) {
+        if (hash == get_pristine_hash(log2_size)) {
+            return nullptr;
+        }
+        node = create_node();
+        if (!node) {
+            return nullptr;
+        }
+        node->parent = parent;
+        if (log2_size == get_log2_page_size() && !set_page_node_map(address, node)) {
+            return nullptr;
+        }
+    }
+    node->hash = hash;
+    if (log2_size > get_log2_page_size()) {
+        const int log2_child_size = log2_size - 1;
+        const address_type child_size = UINT64_C(1) << log2_child_size;
+        node->child[0] = set_subtree_hashes(node->child[0], node, address, log2_child_size, 2 * index, hashes);
+        node->child[1] =
+            set_subtree_hashes(node->child[1], node, address + child_size, log2_child_size, 2 * index + 1, hashes);
+    }
+    return node;
+}
+
+bool machine_merkle_tree::replace_subtree_hashes(address_type address, int log2_size,
+    const subtree_hashes_type &hashes, hasher_type &h) {
+    if (log2_size >= get_log2_root_size() || log2_size < get_log2_page_size()) {
+        throw std::runtime_error{"log2_size is out of bounds"};
+    }
+    if (address & ((~UINT64_C(0)) >> (get_log2_root_size() - log2_size))) {
+        throw std::runtime_error{"misaligned subtree address"};
+    }
+    if (hashes.size() != (size_t{2} << (log2_size - get_log2_page_size()))) {
+        throw std::runtime_error{"invalid number of subtree hashes"};
+    }
+    // Make sure the path from the root down to the parent of the subtree root exists
+    tree_node *parent = get_node(address, log2_size + 1, true);
+    if (!parent) {
+        return false;
+    }
+    const int bit = (address & (UINT64_C(1) << log2_size)) != 0;
+    parent->child[bit] = set_subtree_hashes(parent->child[bit], parent, address, log2_size, 1, hashes);
+    // Only the ancestors of the subtree root need to be recomputed
+    int log2_parent_size = log2_size + 1;
+    while (parent) {
+        update_inner_node_hash(h, log2_parent_size, parent);
+        parent = parent->parent;
+        ++log2_parent_size;
+    }
+    return true;
+}
+
 machine_merkle_tree::machine_merkle_tree(void) : m_root_storage{}, m_root{&m_root_storage}, m_merkle_update_nonce{1} {
     m_root->hash = get_pristine_hash(get_log2_root_size());
 #ifdef MERKLE_DUMP_STATS
@@ -25,6 +25,7 @@
 #include <deque>
 #include <iosfwd>
 #include <unordered_map>
+#include <vector>
 
 #include "keccak-256-hasher.h"
 #include "merkle-tree-proof.h"
@@ -122,6 +123,11 @@ public:
     /// the path from the root to target node.
     using siblings_type = proof_type::sibling_hashes_type;
 
+    /// \brief Storage for the hashes of all nodes in a subtree, from its root down to its page nodes.
+    /// \details Hashes are stored in heap order: entry 1 holds the subtree root,
+    /// and the children of entry i are entries 2i and 2i+1. Entry 0 is unused.
+    using subtree_hashes_type = std::vector<hash_type>;
+
 private:
     /// \brief Merkle tree node structure.
     /// \details A node is known to be an inner-node or a page-node implicitly
@@ -272,6 +278,31 @@ private:
     void get_inside_page_sibling_hashes(address_type address, int log2_size, hash_type &hash,
         const unsigned char *page_data, hash_type &page_hash, proof_type &proof) const;
 
+    /// \brief Finds the node subintending a given range, optionally creating the path towards it.
+    /// \param address Start of range subintended by node.
+    /// \param log2_size log<sub>2</sub> of size subintended by node.
+    /// \param create If true, missing nodes along the path are created.
+    /// \return The node, or nullptr if it is pristine and \p create is false.
+    tree_node *get_node(address_type address, int log2_size, bool create);
+
+    /// \brief Collects hashes of all nodes in subtree rooted at node.
+    /// \param node Root of subtree (or nullptr if pristine).
+    /// \param log2_size log<sub>2</sub> of size subintended by \p node.
+    /// \param index Heap index of \p node in \p hashes.
+    /// \param hashes Receives the hashes.
+    void get_subtree_hashes(const tree_node *node, int log2_size, size_t index, subtree_hashes_type &hashes) const;
+
+    /// \brief Overwrites hashes of all nodes in subtree rooted at node.
+    /// \param node Root of subtree (or nullptr if pristine).
+    /// \param parent Parent of \p node.
+    /// \param address Start of range subintended by \p node.
+    /// \param log2_size log<sub>2</sub> of size subintended by \p node.
+    /// \param index Heap index of \p node in \p hashes.
+    /// \param hashes New hashes.
+    /// \return Root of updated subtree, or nullptr if it remains pristine.
+    tree_node *set_subtree_hashes(tree_node *node, tree_node *parent, address_type address, int log2_size,
+        size_t index, const subtree_hashes_type &hashes);
+
     // Precomputed hashes of spans of zero bytes with
     // increasing power-of-two sizes, from 2^LOG2_WORD_SIZE
     // to 2^LOG2_ROOT_SIZE bytes.
@@ -347,6 +378,32 @@ public:
     /// \param hash Receives the hash.
     void get_page_node_hash(address_type page_index, hash_type &hash) const;
 
+    /// \brief Returns the currently stored hash of a node.
+    /// \param address Address of node. Must be aligned to a 2<sup>log2_size</sup> boundary.
+    /// \param log2_size log<sub>2</sub> of size subintended by node.
+    /// Must be between LOG2_PAGE_SIZE and LOG2_ROOT_SIZE-1, inclusive.
+    /// \returns Hash of node, which only reflects pages that have been updated.
+    hash_type get_node_hash(address_type address, int log2_size);
+
+    /// \brief Returns the currently stored hashes of all nodes in a subtree.
+    /// \param address Address of subtree root. Must be aligned to a 2<sup>log2_size</sup> boundary.
+    /// \param log2_size log<sub>2</sub> of size subintended by subtree root.
+    /// Must be between LOG2_PAGE_SIZE and LOG2_ROOT_SIZE-1, inclusive.
+    /// \returns Hashes of all nodes in subtree, down to its page nodes, in heap order.
+    subtree_hashes_type get_subtree_hashes(address_type address, int log2_size);
+
+    /// \brief Replaces the hashes of all nodes in a subtree with precomputed values.
+    /// \param address Address of subtree root. Must be aligned to a 2<sup>log2_size</sup> boundary.
+    /// \param log2_size log<sub>2</sub> of size subintended by subtree root.
+    /// Must be between LOG2_PAGE_SIZE and LOG2_ROOT_SIZE-1, inclusive.
+    /// \param hashes Hashes of all nodes in subtree, as returned by get_subtree_hashes().
+    /// \param h Hasher object.
+    /// \returns True if succeeded, false otherwise.
+    /// \details No page data is hashed. Only the ancestors of the subtree root are recomputed.
+    /// This method must not be called between begin_update() and end_update().
+    bool replace_subtree_hashes(address_type address, int log2_size, const subtree_hashes_type &hashes,
+        hasher_type &h);
+
     /// \brief Returns the hash for a log2_size pristine node.
     /// \param log2_size log<sub>2</sub> of size subintended by node.
     /// \return Reference to precomputed hash.
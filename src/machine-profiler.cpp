@@ -0,0 +1,492 @@
+// Copyright Cartesi and individual authors (see AUTHORS)
+// SPDX-License-Identifier: LGPL-3.0-or-later
+//
+// This program is free software: you can redistribute it and/or modify it under
+// the terms of the GNU Lesser General Public License as published by the Free
+// Software Foundation, either version 3 of the License, or (at your option) any
+// later version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+// PARTICULAR PURPOSE. See the GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License along
+// with this program (see COPYING). If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include <algorithm>
+#include <cerrno>
+#include <fstream>
+#include <iomanip>
+#include <iterator>
+#include <sstream>
+#include <stdexcept>
+#include <system_error>
+#include <tuple>
+#include <utility>
+
+#include "machine-profiler.h"
+#include "riscv-constants.h"
+
+namespace cartesi {
+
+using namespace std::string_literals;
+
+/// \brief ELF constants used when loading symbols
+enum ELF_constants : uint32_t {
+    ELF_HEADER_SIZE = 64,   ///< Size of ELF64 header
+    ELF_CLASS_64 = 2,       ///< EI_CLASS of 64-bit files
+    ELF_DATA_LSB = 1,       ///< EI_DATA of little-endian files
+    ELF_SHT_SYMTAB = 2,     ///< Section type of symbol table
+    ELF_SHT_DYNSYM = 11,    ///< Section type of dynamic symbol table
+    ELF_STT_FUNC = 2,       ///< Symbol type of functions
+    ELF_SYM_SIZE = 24,      ///< Size of ELF64 symbol
+    ELF_SECTION_SIZE = 64,  ///< Size of ELF64 section header
+};
+
+/// \brief Reads a little-endian integer from an ELF file image
+template <typename T>
+static T elf_read(const std::string &image, uint64_t offset) {
+    if (offset > image.size() || image.size() - offset < sizeof(T)) {
+        throw std::invalid_argument{"truncated ELF file"};
+    }
+    T val = 0;
+    for (size_t i = sizeof(T); i > 0; --i) {
+        val = static_cast<T>((static_cast<uint64_t>(val) << 8) | static_cast<unsigned char>(image[offset + i - 1]));
+    }
+    return val;
+}
+
+elf_symbol_table::elf_symbol_table(const std::string &filename) {
+    std::ifstream file(filename, std::ios::binary);
+    if (!file) {
+        throw std::system_error{errno, std::generic_category(), "could not open ELF file '"s + filename + "'"s};
+    }
+    const std::string image{std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>()};
+    if (image.size() < ELF_HEADER_SIZE || image.compare(0, 4, "\x7f"
+                                                               "ELF") != 0) {
+        throw std::invalid_argument{"'"s + filename + "' is not an ELF file"s};
+    }
+    if (image[4] != ELF_CLASS_64 || image[5] != ELF_DATA_LSB) {
+        throw std::invalid_argument{"'"s + filename + "' is not a 64-bit little-endian ELF file"s};
+    }
+    const auto shoff = elf_read<uint64_t>(image, 0x28);
+    const auto shentsize = elf_read<uint16_t>(image, 0x3a);
+    const auto shnum = elf_read<uint16_t>(image, 0x3c);
+    if (shentsize < ELF_SECTION_SIZE) {
+        throw std::invalid_argument{"'"s + filename + "' has invalid section headers"s};
+    }
+    for (uint64_t i = 0; i < shnum; ++i) {
+        const uint64_t section = shoff + i * shentsize;
+        const auto type = elf_read<uint32_t>(image, section + 0x04);
+        if (type != ELF_SHT_SYMTAB && type != ELF_SHT_DYNSYM) {
+            continue;
+        }
+        const auto offset = elf_read<uint64_t>(image, section + 0x18);
+        const auto size = elf_read<uint64_t>(image, section + 0x20);
+        const auto link = elf_read<uint32_t>(image, section + 0x28);
+        const auto entsize = elf_read<uint64_t>(image, section + 0x38);
+        if (entsize < ELF_SYM_SIZE) {
+            throw std::invalid_argument{"'"s + filename + "' has an invalid symbol table"s};
+        }
+        const uint64_t strtab = shoff + link * static_cast<uint64_t>(shentsize);
+        const auto str_offset = elf_read<uint64_t>(image, strtab + 0x18);
+        const auto str_size = elf_read<uint64_t>(image, strtab + 0x20);
+        for (uint64_t j = 0; j < size / entsize; ++j) {
+            const uint64_t sym = offset + j * entsize;
+            const auto name = elf_read<uint32_t>(image, sym);
+            const auto info = elf_read<uint8_t>(image, sym + 0x04);
+            const auto value = elf_read<uint64_t>(image, sym + 0x08);
+            const auto sym_size = elf_read<uint64_t>(image, sym + 0x10);
+            if ((info & 0xf) != ELF_STT_FUNC || value == 0 || name >= str_size ||
+                str_offset + str_size > image.size()) {
+                continue;
+            }
+            const auto *begin = image.data() + str_offset + name;
+            const auto *end = std::find(begin, image.data() + str_offset + str_size, '\0');
+            m_symbols.push_back(symbol{value, sym_size, std::string(begin, end)});
+        }
+    }
+    if (m_symbols.empty()) {
+        throw std::invalid_argument{"'"s + filename + "' has no function symbols"s};
+    }
+    std::sort(m_symbols.begin(), m_symbols.end(),
+        [](const symbol &a, const symbol &b) { return std::tie(a.start, a.size) < std::tie(b.start, b.size); });
+}
+
+std::string elf_symbol_table::lookup(uint64_t vaddr) const {
+    auto it = std::upper_bound(m_symbols.begin(), m_symbols.end(), vaddr,
+        [](uint64_t addr, const symbol &s) { return addr < s.start; });
+    if (it == m_symbols.begin()) {
+        return {};
+    }
+    --it;
+    // Symbols without size extend up to the next symbol
+    if (it->size != 0 && vaddr - it->start >= it->size) {
+        return {};
+    }
+    return it->name;
+}
+
+machine_profiler::machine_profiler(uint64_t sample_interval, uint64_t mcycle) :
+    m_sample_interval(sample_interval),
+    m_next_sample(mcycle) {
+    if (sample_interval == 0) {
+        throw std::invalid_argument{"profiler sample interval must be positive"};
+    }
+}
+
+void machine_profiler::sample(uint64_t pc, uint64_t mcycle) {
+    ++m_pc_samples[pc];
+    // Samples are aligned to the interval, so profiles taken over several runs sample the same cycles
+    const uint64_t next = (mcycle / m_sample_interval + 1) * m_sample_interval;
+    m_next_sample = next > mcycle ? next : UINT64_MAX;
+}
+
+std::string machine_profiler::opcode_name(uint32_t key) {
+    static const std::array<const char *, 8> c0{"c.addi4spn", "c.fld", "c.lw", "c.ld", "c.q0/4", "c.fsd", "c.sw",
+        "c.sd"};
+    static const std::array<const char *, 8> c1{"c.addi", "c.addiw", "c.li", "c.lui/c.addi16sp", "c.alu", "c.j",
+        "c.beqz", "c.bnez"};
+    static const std::array<const char *, 8> c2{"c.slli", "c.fldsp", "c.lwsp", "c.ldsp", "c.jr/c.mv/c.add/c.ebreak",
+        "c.fsdsp", "c.swsp", "c.sdsp"};
+    static const std::array<const char *, 8> load{"lb", "lh", "lw", "ld", "lbu", "lhu", "lwu", nullptr};
+    static const std::array<const char *, 8> store{"sb", "sh", "sw", "sd", nullptr, nullptr, nullptr, nullptr};
+    static const std::array<const char *, 8> branch{"beq", "bne", nullptr, nullptr, "blt", "bge", "bltu", "bgeu"};
+    static const std::array<const char *, 8> op_imm{"addi", "slli", "slti", "sltiu", "xori", "srli/srai", "ori",
+        "andi"};
+    static const std::array<const char *, 8> op_imm_32{"addiw", "slliw", nullptr, nullptr, nullptr, "srliw/sraiw",
+        nullptr, nullptr};
+    static const std::array<const char *, 8> op{"add/sub/mul", "sll/mulh", "slt/mulhsu", "sltu/mulhu", "xor/div",
+        "srl/sra/divu", "or/rem", "and/remu"};
+    static const std::array<const char *, 8> op_32{"addw/subw/mulw", "sllw", nullptr, nullptr, "divw",
+        "srlw/sraw/divuw", "remw", "remuw"};
+    static const std::array<const char *, 8> system{"ecall/ebreak/xret/wfi/sfence.vma", "csrrw", "csrrs", "csrrc",
+        nullptr, "csrrwi", "csrrsi", "csrrci"};
+    static const std::array<const char *, 8> fp_load{nullptr, nullptr, "flw", "fld", nullptr, nullptr, nullptr,
+        nullptr};
+    static const std::array<const char *, 8> fp_store{nullptr, nullptr, "fsw", "fsd", nullptr, nullptr, nullptr,
+        nullptr};
+    static const std::array<const char *, 8> misc_mem{"fence", "fence.i", nullptr, nullptr, nullptr, nullptr, nullptr,
+        nullptr};
+    static const std::array<const char *, 8> amo{nullptr, nullptr, "amo.w/lr.w/sc.w", "amo.d/lr.d/sc.d", nullptr,
+        nullptr, nullptr, nullptr};
+    const uint32_t funct3 = (key >> ((key & 3) != 3 ? 2 : 7)) & 7;
+    const char *name = nullptr;
+    switch ((key & 3) != 3 ? key & 3 : key & 0x7f) {
+        case 0x0:
+            name = c0[funct3];
+            break;
+        case 0x1:
+            name = c1[funct3];
+            break;
+        case 0x2:
+            name = c2[funct3];
+            break;
+        case 0x03:
+            name = load[funct3];
+            break;
+        case 0x07:
+            name = fp_load[funct3];
+            break;
+        case 0x0f:
+            name = misc_mem[funct3];
+            break;
+        case 0x13:
+            name = op_imm[funct3];
+            break;
+        case 0x17:
+            name = "auipc";
+            break;
+        case 0x1b:
+            name = op_imm_32[funct3];
+            break;
+        case 0x23:
+            name = store[funct3];
+            break;
+        case 0x27:
+            name = fp_store[funct3];
+            break;
+        case 0x2f:
+            name = amo[funct3];
+            break;
+        case 0x33:
+            name = op[funct3];
+            break;
+        case 0x37:
+            name = "lui";
+            break;
+        case 0x3b:
+            name = op_32[funct3];
+            break;
+        case 0x43:
+            name = "fmadd";
+            break;
+        case 0x47:
+            name = "fmsub";
+            break;
+        case 0x4b:
+            name = "fnmsub";
+            break;
+        case 0x4f:
+            name = "fnmadd";
+            break;
+        case 0x53:
+            name = "op-fp";
+            break;
+        case 0x63:
+            name = branch[funct3];
+            break;
+        case 0x67:
+            name = "jalr";
+            break;
+        case 0x6f:
+            name = "jal";
+            break;
+        case 0x73:
+            name = system[funct3];
+            break;
+        default:
+            break;
+    }
+    if (name) {
+        return name;
+    }
+    std::ostringstream sout;
+    sout << "opcode 0x" << std::hex << (key & 0x7f) << " funct3 " << funct3;
+    return sout.str();
+}
+
+/// \brief Returns a name for a trap cause
+static std::string trap_name(uint64_t cause) {
+    static const std::map<uint64_t, const char *> names{
+        {MCAUSE_INSN_ADDRESS_MISALIGNED, "instruction address misaligned"},
+        {MCAUSE_INSN_ACCESS_FAULT, "instruction access fault"},
+        {MCAUSE_ILLEGAL_INSN, "illegal instruction"},
+        {MCAUSE_BREAKPOINT, "breakpoint"},
+        {MCAUSE_LOAD_ADDRESS_MISALIGNED, "load address misaligned"},
+        {MCAUSE_LOAD_ACCESS_FAULT, "load access fault"},
+        {MCAUSE_STORE_AMO_ADDRESS_MISALIGNED, "store/amo address misaligned"},
+        {MCAUSE_STORE_AMO_ACCESS_FAULT, "store/amo access fault"},
+        {MCAUSE_USER_ECALL, "environment call from u-mode"},
+        {MCAUSE_SUPERVISOR_ECALL, "environment call from s-mode"},
+        {MCAUSE_MACHINE_ECALL, "environment call from m-mode"},
+        {MCAUSE_FETCH_PAGE_FAULT, "instruction page fault"},
+        {MCAUSE_LOAD_PAGE_FAULT, "load page fault"},
+        {MCAUSE_STORE_AMO_PAGE_FAULT, "store/amo page fault"},
+        {MCAUSE_INTERRUPT_FLAG | 1, "supervisor software interrupt"},
+        {MCAUSE_INTERRUPT_FLAG | 3, "machine software interrupt"},
+        {MCAUSE_INTERRUPT_FLAG | 5, "supervisor timer interrupt"},
+        {MCAUSE_INTERRUPT_FLAG | 7, "machine timer interrupt"},
+        {MCAUSE_INTERRUPT_FLAG | 9, "supervisor external interrupt"},
+        {MCAUSE_INTERRUPT_FLAG | 11, "machine external interrupt"},
+    };
+    const auto it = names.find(cause);
+    if (it != names.end()) {
+        return it->second;
+    }
+    return ((cause & MCAUSE_INTERRUPT_FLAG) != 0 ? "interrupt "s : "exception "s) +
+        std::to_string(cause & ~MCAUSE_INTERRUPT_FLAG);
+}
+
+/// \brief Returns the name of the function containing a pc, or the pc itself in hexadecimal
+static std::string pc_name(uint64_t pc, const guest_symbolizer &symbolizer) {
+    if (symbolizer) {
+        std::string name = symbolizer(pc);
+        if (!name.empty()) {
+            return name;
+        }
+    }
+    std::ostringstream sout;
+    sout << "0x" << std::hex << pc;
+    return sout.str();
+}
+
+/// \brief Returns sample counts aggregated by function name, sorted by name
+static std::map<std::string, uint64_t> samples_by_name(const std::unordered_map<uint64_t, uint64_t> &pc_samples,
+    const guest_symbolizer &symbolizer) {
+    std::map<std::string, uint64_t> samples;
+    for (const auto &[pc, count] : pc_samples) {
+        samples[pc_name(pc, symbolizer)] += count;
+    }
+    return samples;
+}
+
+/// \brief Returns entries of a map sorted by decreasing count, then by key
+template <typename K>
+static std::vector<std::pair<K, uint64_t>> sort_by_count(const std::map<K, uint64_t> &counts) {
+    std::vector<std::pair<K, uint64_t>> sorted(counts.begin(), counts.end());
+    std::stable_sort(sorted.begin(), sorted.end(), [](const auto &a, const auto &b) { return a.second > b.second; });
+    return sorted;
+}
+
+std::string machine_profiler::to_collapsed(const guest_symbolizer &symbolizer) const {
+    std::ostringstream sout;
+    for (const auto &[name, count] : samples_by_name(m_pc_samples, symbolizer)) {
+        sout << name << ' ' << count << '\n';
+    }
+    return sout.str();
+}
+
+/// \brief Minimal protocol buffer encoder used to write pprof profiles
+class protobuf_writer {
+public:
+    void put_uint(int field, uint64_t val) {
+        put_varint(static_cast<uint64_t>(field) << 3);
+        put_varint(val);
+    }
+
+    void put_bytes(int field, const std::string &bytes) {
+        put_varint((static_cast<uint64_t>(field) << 3) | 2);
+        put_varint(bytes.size());
+        m_out += bytes;
+    }
+
+    void put_packed(int field, const std::vector<uint64_t> &vals) {
+        protobuf_writer packed;
+        for (const uint64_t val : vals) {
+            packed.put_varint(val);
+        }
+        put_bytes(field, packed.str());
+    }
+
+    const std::string &str(void) const {
+        return m_out;
+    }
+
+private:
+    void put_varint(uint64_t val) {
+        while (val >= 0x80) {
+            m_out.push_back(static_cast<char>((val & 0x7f) | 0x80));
+            val >>= 7;
+        }
+        m_out.push_back(static_cast<char>(val));
+    }
+
+    std::string m_out;
+};
+
+std::string machine_profiler::to_pprof(const guest_symbolizer &symbolizer) const {
+    // Field numbers from https://github.com/google/pprof/blob/main/proto/profile.proto
+    enum : int { sample_type = 1, sample = 2, location = 4, function = 5, string_table = 6, period_type = 11 };
+    enum : int { period = 12 };
+    std::vector<std::string> strings{"", "samples", "count", "cycles"};
+    std::map<std::string, uint64_t> string_ids;
+    const auto string_id = [&](const std::string &s) {
+        const auto [it, inserted] = string_ids.emplace(s, strings.size());
+        if (inserted) {
+            strings.push_back(s);
+        }
+        return it->second;
+    };
+    const auto value_type = [](uint64_t type, uint64_t unit) {
+        protobuf_writer vt;
+        vt.put_uint(1, type);
+        vt.put_uint(2, unit);
+        return vt.str();
+    };
+    protobuf_writer profile;
+    profile.put_bytes(sample_type, value_type(1, 2));
+    profile.put_bytes(sample_type, value_type(3, 2));
+    std::vector<std::pair<uint64_t, uint64_t>> pcs(m_pc_samples.begin(), m_pc_samples.end());
+    std::sort(pcs.begin(), pcs.end());
+    std::map<std::string, uint64_t> function_ids;
+    for (uint64_t i = 0; i < pcs.size(); ++i) {
+        const auto [pc, count] = pcs[i];
+        protobuf_writer s;
+        s.put_packed(1, {i + 1});
+        s.put_packed(2, {count, count * m_sample_interval});
+        profile.put_bytes(sample, s.str());
+    }
+    for (uint64_t i = 0; i < pcs.size(); ++i) {
+        const uint64_t pc = pcs[i].first;
+        protobuf_writer loc;
+        loc.put_uint(1, i + 1);
+        loc.put_uint(3, pc);
+        const std::string name = symbolizer ? symbolizer(pc) : std::string{};
+        if (!name.empty()) {
+            const auto [it, inserted] = function_ids.emplace(name, function_ids.size() + 1);
+            if (inserted) {
+                protobuf_writer fn;
+                fn.put_uint(1, it->second);
+                fn.put_uint(2, string_id(name));
+                fn.put_uint(3, string_id(name));
+                profile.put_bytes(function, fn.str());
+            }
+            protobuf_writer line;
+            line.put_uint(1, it->second);
+            loc.put_bytes(4, line.str());
+        }
+        profile.put_bytes(location, loc.str());
+    }
+    for (const auto &s : strings) {
+        profile.put_bytes(string_table, s);
+    }
+    profile.put_bytes(period_type, value_type(3, 2));
+    profile.put_uint(period, m_sample_interval);
+    return profile.str();
+}
+
+std::string machine_profiler::to_summary(const guest_symbolizer &symbolizer) const {
+    std::ostringstream sout;
+    sout << std::fixed << std::setprecision(2);
+    const auto by_name = samples_by_name(m_pc_samples, symbolizer);
+    uint64_t total = 0;
+    for (const auto &entry : by_name) {
+        total += entry.second;
+    }
+    sout << "samples: " << total << " (one every " << m_sample_interval << " cycles)\n";
+    for (const auto &[name, count] : sort_by_count(by_name)) {
+        sout << std::setw(14) << count << std::setw(8) << 100.0 * count / total << "%  " << name << '\n';
+    }
+    std::map<std::string, uint64_t> opcodes;
+    total = 0;
+    for (uint32_t key = 0; key < OPCODE_KEY_COUNT; ++key) {
+        if (m_opcode_counts[key] != 0) {
+            opcodes[opcode_name(key)] += m_opcode_counts[key];
+            total += m_opcode_counts[key];
+        }
+    }
+    sout << "instructions: " << total << '\n';
+    for (const auto &[name, count] : sort_by_count(opcodes)) {
+        sout << std::setw(14) << count << std::setw(8) << 100.0 * count / total << "%  " << name << '\n';
+    }
+    total = 0;
+    for (const auto &entry : m_trap_counts) {
+        total += entry.second;
+    }
+    sout << "traps: " << total << '\n';
+    for (const auto &[cause, count] : sort_by_count(m_trap_counts)) {
+        sout << std::setw(14) << count << std::setw(8) << 100.0 * count / total << "%  " << trap_name(cause)
+             << '\n';
+    }
+    return sout.str();
+}
+
+void machine_profiler::write(const std::string &filename, machine_profile_format format,
+    const guest_symbolizer &symbolizer) const {
+    std::string contents;
+    switch (format) {
+        case machine_profile_format::collapsed:
+            contents = to_collapsed(symbolizer);
+            break;
+        case machine_profile_format::pprof:
+            contents = to_pprof(symbolizer);
+            break;
+        case machine_profile_format::summary:
+            contents = to_summary(symbolizer);
+            break;
+        default:
+            throw std::invalid_argument{"invalid profile format"};
+    }
+    std::ofstream file(filename, std::ios::binary);
+    if (!file) {
+        throw std::system_error{errno, std::generic_category(), "could not create profile file '"s + filename + "'"s};
+    }
+    file << contents;
+    if (!file) {
+        throw std::system_error{errno, std::generic_category(), "could not write profile file '"s + filename + "'"s};
+    }
+}
+
+} // namespace cartesi
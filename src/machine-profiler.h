@@ -0,0 +1,154 @@
+// Copyright Cartesi and individual authors (see AUTHORS)
+// SPDX-License-Identifier: LGPL-3.0-or-later
+//
+// This program is free software: you can redistribute it and/or modify it under
+// the terms of the GNU Lesser General Public License as published by the Free
+// Software Foundation, either version 3 of the License, or (at your option) any
+// later version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+// PARTICULAR PURPOSE. See the GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License along
+// with this program (see COPYING). If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef MACHINE_PROFILER_H
+#define MACHINE_PROFILER_H
+
+/// \file
+/// \brief Guest profiler enabled at run time
+
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "compiler-defines.h"
+
+namespace cartesi {
+
+/// \brief Format of profiles written by machine_profiler::write()
+enum class machine_profile_format {
+    collapsed, ///< One "<symbol> <samples>" line per symbol, as consumed by flame graph tools
+    pprof,     ///< Uncompressed protocol buffer, as consumed by pprof
+    summary,   ///< Human readable report of samples, instruction counts and traps
+};
+
+/// \brief Maps a guest virtual address to the name of the function containing it, or to an empty string
+using guest_symbolizer = std::function<std::string(uint64_t vaddr)>;
+
+/// \brief Function symbols loaded from a guest ELF file
+class elf_symbol_table {
+public:
+    /// \brief Loads the function symbols of a 64-bit little-endian ELF file
+    /// \param filename Name of ELF file, which must not be stripped
+    explicit elf_symbol_table(const std::string &filename);
+
+    /// \brief Returns the name of the function containing an address, or an empty string
+    std::string lookup(uint64_t vaddr) const;
+
+private:
+    /// \brief Function symbol
+    struct symbol {
+        uint64_t start; ///< Start address
+        uint64_t size;  ///< Size in bytes, or 0 if unknown
+        std::string name;
+    };
+
+    std::vector<symbol> m_symbols; ///< Symbols sorted by start address
+};
+
+/// \brief Collects a profile of the guest while the interpreter runs
+/// \details The profile has a histogram of the pc sampled every sample interval cycles, instruction counts per
+/// opcode, and trap counts per cause. The interpreter only consults the profiler in the specialized loop it uses
+/// when a profiler is active, so machines without one pay nothing for it. The profiler never changes the machine
+/// state, so profiled runs remain reproducible.
+class machine_profiler {
+public:
+    /// \brief Number of distinct opcode keys
+    static constexpr int OPCODE_KEY_COUNT = 1024;
+
+    /// \brief Constructor
+    /// \param sample_interval Number of cycles between pc samples
+    /// \param mcycle Current value of mcycle
+    machine_profiler(uint64_t sample_interval, uint64_t mcycle);
+
+    /// \brief Accounts for an instruction about to be executed
+    /// \param pc Virtual address of instruction
+    /// \param mcycle Current value of mcycle
+    /// \param insn Instruction
+    void on_insn(uint64_t pc, uint64_t mcycle, uint32_t insn) {
+        ++m_opcode_counts[opcode_key(insn)];
+        if (unlikely(mcycle >= m_next_sample)) {
+            sample(pc, mcycle);
+        }
+    }
+
+    /// \brief Accounts for a trap
+    /// \param cause Value written to mcause or scause
+    void on_trap(uint64_t cause) {
+        ++m_trap_counts[cause];
+    }
+
+    /// \brief Writes the profile to a file
+    /// \param filename Name of file
+    /// \param format Format of profile
+    /// \param symbolizer Maps sampled pcs to function names, may be empty
+    void write(const std::string &filename, machine_profile_format format, const guest_symbolizer &symbolizer) const;
+
+    /// \brief Returns the number of cycles between pc samples
+    uint64_t get_sample_interval(void) const {
+        return m_sample_interval;
+    }
+
+    /// \brief Returns the number of samples taken at each pc
+    const std::unordered_map<uint64_t, uint64_t> &get_pc_samples(void) const {
+        return m_pc_samples;
+    }
+
+    /// \brief Returns the number of instructions executed for an opcode key
+    uint64_t get_opcode_count(uint32_t key) const {
+        return m_opcode_counts[key % OPCODE_KEY_COUNT];
+    }
+
+    /// \brief Returns the number of traps taken for each cause
+    const std::map<uint64_t, uint64_t> &get_trap_counts(void) const {
+        return m_trap_counts;
+    }
+
+    /// \brief Returns the key under which an instruction is counted
+    /// \details Uncompressed instructions are keyed by major opcode and funct3, compressed instructions by
+    /// quadrant and funct3. The two never collide because only uncompressed instructions have both low bits set.
+    static uint32_t opcode_key(uint32_t insn) {
+        if ((insn & 3) != 3) {
+            return (insn & 3) | (((insn >> 13) & 7) << 2);
+        }
+        return (insn & 0x7f) | (((insn >> 12) & 7) << 7);
+    }
+
+    /// \brief Returns a name for an opcode key, listing every mnemonic the key covers
+    static std::string opcode_name(uint32_t key);
+
+private:
+    /// \brief Takes a pc sample and schedules the next one
+    void sample(uint64_t pc, uint64_t mcycle);
+
+    std::string to_collapsed(const guest_symbolizer &symbolizer) const;
+    std::string to_pprof(const guest_symbolizer &symbolizer) const;
+    std::string to_summary(const guest_symbolizer &symbolizer) const;
+
+    uint64_t m_sample_interval;                               ///< Number of cycles between pc samples
+    uint64_t m_next_sample;                                   ///< Value of mcycle at next pc sample
+    std::unordered_map<uint64_t, uint64_t> m_pc_samples;      ///< Number of samples taken at each pc
+    std::array<uint64_t, OPCODE_KEY_COUNT> m_opcode_counts{}; ///< Instructions executed per opcode key
+    std::map<uint64_t, uint64_t> m_trap_counts;               ///< Traps taken per cause
+};
+
+} // namespace cartesi
+
+#endif
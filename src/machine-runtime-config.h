@@ -18,6 +18,9 @@
 #define MACHINE_RUNTIME_CONFIG_H
 
 #include <cstdint>
+#include <string>
+
+#include "os.h"
 
 /// \file
 /// \brief Runtime configuration for machines.
@@ -34,14 +37,32 @@ struct htif_runtime_config {
     bool no_console_putchar;
 };
 
+/// \brief Destination of console output
+enum class console_output_mode {
+    direct,   ///< Write each character to stdout as soon as the guest writes it
+    buffered, ///< Buffer characters and write them to stdout from a background thread
+    file,     ///< Buffer characters and write them to a file from a background thread
+    memory,   ///< Capture characters in memory, to be read by the host
+};
+
+/// \brief Console runtime configuration
+struct console_runtime_config {
+    console_output_mode output_mode{console_output_mode::direct}; ///< Destination of console output
+    std::string output_filename;                                 ///< File written in file mode
+    uint64_t output_buffer_size{};                               ///< Size of output buffer, or 0 for the default
+};
+
 /// \brief Machine runtime configuration
 struct machine_runtime_config {
     concurrency_runtime_config concurrency{};
     htif_runtime_config htif{};
+    console_runtime_config console{};
     bool skip_root_hash_check{};
     bool skip_root_hash_store{};
     bool skip_version_check{};
     bool soft_yield{};
+    os_poll_backend poll_backend{os_poll_backend::automatic};
+    bool huge_pages{};
 };
 
 /// \brief CONCURRENCY constants
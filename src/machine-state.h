@@ -28,6 +28,8 @@
 
 #include <boost/container/static_vector.hpp>
 
+#include "page-walk-cache.h"
+#include "pma-lookup-table.h"
 #include "pma.h"
 #include "riscv-constants.h"
 #include "shadow-tlb.h"
@@ -129,6 +131,9 @@ struct machine_state {
 
     // Entries below this mark are not needed in the blockchain
 
+    page_walk_cache pwc;          ///< Non-architectural cache of non-leaf PTEs
+    pma_lookup_table pmas_lookup; ///< Fast lookup of entries in pmas
+
 #ifdef DUMP_COUNTERS
     machine_statistics stats;
 #endif
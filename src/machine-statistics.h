@@ -30,6 +30,8 @@ struct machine_statistics {
     uint64_t m_int;         ///< Counts machine interrupts
     uint64_t m_ex;          ///< Counts machine exceptions (except ECALL)
     uint64_t atomic_mop;    ///< Counts atomic memory operations
+    uint64_t fused_pair;    ///< Counts instruction pairs executed as a single fused operation
+    uint64_t idle_skip;     ///< Counts WFI idle loops fast-forwarded to the next interrupt check
     uint64_t flush_all;     ///< Counts flush all calls
     uint64_t flush_va;      ///< Counts flush virtual address calls
     uint64_t fence;         ///< Counts fence calls
@@ -56,6 +58,15 @@ struct machine_statistics {
     uint64_t tlb_flush_fence_vma_asid;       ///< Counts TLB flush originated from SFENCE.VMA (asid)
     uint64_t tlb_flush_fence_vma_vaddr;      ///< Counts TLB flush originated from SFENCE.VMA (vaddr)
     uint64_t tlb_flush_fence_vma_asid_vaddr; ///< Counts TLB flush originated originated from SFENCE.VMA (vaddr,asid)
+
+    // Page-walk cache
+    uint64_t pwc_hit;           ///< Counts page-walk cache hits
+    uint64_t pwc_miss;          ///< Counts page-walk cache misses
+    uint64_t pwc_flush;         ///< Counts page-walk cache flushes
+    uint64_t pwc_superpage_hit; ///< Counts page-walk cache hits that skipped the whole walk to a superpage
+
+    // Fetch translation cache
+    uint64_t fetch_cache_flush; ///< Counts fetch translation cache invalidations
 };
 
 #ifdef DUMP_COUNTERS
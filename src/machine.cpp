@@ -27,6 +27,7 @@
 #include "htif-factory.h"
 #include "htif.h"
 #include "interpret.h"
+#include "machine-break-conditions.h"
 #include "plic-factory.h"
 #include "record-state-access.h"
 #include "replay-state-access.h"
@@ -39,12 +40,14 @@
 #include "strict-aliasing.h"
 #include "translate-virtual-address.h"
 #include "uarch-interpret.h"
+#include "uarch-pristine-state-hash.h"
 #include "uarch-record-state-access.h"
 #include "uarch-replay-state-access.h"
 #include "uarch-reset-state.h"
 #include "uarch-state-access.h"
 #include "uarch-step.h"
 #include "unique-c-ptr.h"
+#include "virtio-blk.h"
 #include "virtio-console.h"
 #include "virtio-factory.h"
 #include "virtio-net-carrier-slirp.h"
@@ -108,14 +111,16 @@ const pma_entry::flags machine::m_cmio_tx_buffer_flags{
     PMA_ISTART_DID::cmio_tx_buffer // DID
 };
 
-pma_entry machine::make_memory_range_pma_entry(const std::string &description, const memory_range_config &c) {
+pma_entry machine::make_memory_range_pma_entry(const std::string &description,
+    const memory_range_config &c) const {
     if (c.image_filename.empty()) {
-        return make_callocd_memory_pma_entry(description, c.start, c.length);
+        return make_callocd_memory_pma_entry(description, c.start, c.length, ""s, m_r.huge_pages);
     }
     return make_mmapd_memory_pma_entry(description, c.start, c.length, c.image_filename, c.shared);
 }
 
-pma_entry machine::make_flash_drive_pma_entry(const std::string &description, const memory_range_config &c) {
+pma_entry machine::make_flash_drive_pma_entry(const std::string &description,
+    const memory_range_config &c) const {
     return make_memory_range_pma_entry(description, c).set_flags(m_flash_drive_flags);
 }
 
@@ -175,6 +180,7 @@ pma_entry &machine::register_pma_entry(pma_entry &&pma) {
     }
     pma.set_index(static_cast<int>(m_s.pmas.size()));
     m_s.pmas.push_back(std::move(pma));
+    m_s.pmas_lookup.rebuild(m_s.pmas);
     return m_s.pmas.back();
 }
 
@@ -200,6 +206,14 @@ void machine::replace_memory_range(const memory_range_config &range) {
             }
             // replace range preserving original flags
             pma = make_memory_range_pma_entry(pma.get_description(), range).set_flags(pma.get_flags());
+            m_s.pmas_lookup.rebuild(m_s.pmas);
+            // The page-walk cache holds host pointers into the memory that was just replaced
+            m_s.pwc.flush();
+            for (auto &mrd : m_mrds) {
+                if (mrd.start == range.start) {
+                    mrd.huge_pages = pma.get_memory().get_huge_pages();
+                }
+            }
             return;
         }
     }
@@ -323,12 +337,9 @@ machine::machine(const machine_config &c, const machine_runtime_config &r) :
     write_iunrep(m_c.processor.iunrep);
 
     // Register RAM
-    if (m_c.ram.image_filename.empty()) {
-        register_pma_entry(make_callocd_memory_pma_entry("RAM"s, PMA_RAM_START, m_c.ram.length).set_flags(m_ram_flags));
-    } else {
-        register_pma_entry(make_callocd_memory_pma_entry("RAM"s, PMA_RAM_START, m_c.ram.length, m_c.ram.image_filename)
-                               .set_flags(m_ram_flags));
-    }
+    register_pma_entry(
+        make_callocd_memory_pma_entry("RAM"s, PMA_RAM_START, m_c.ram.length, m_c.ram.image_filename, m_r.huge_pages)
+            .set_flags(m_ram_flags));
 
     // Register DTB
     pma_entry &dtb = register_pma_entry((m_c.dtb.image_filename.empty() ?
@@ -364,7 +375,9 @@ machine::machine(const machine_config &c, const machine_runtime_config &r) :
     register_pma_entry(make_cmio_rx_buffer_pma_entry(m_c.cmio));
 
     // Register HTIF device
-    register_pma_entry(make_htif_pma_entry(PMA_HTIF_START, PMA_HTIF_LENGTH, &m_r.htif));
+    m_console = std::make_unique<console_output>(m_r.console);
+    m_htif_context = htif_context{&m_r.htif, m_console.get()};
+    register_pma_entry(make_htif_pma_entry(PMA_HTIF_START, PMA_HTIF_LENGTH, &m_htif_context));
 
     // Copy HTIF state to from config to machine
     write_htif_tohost(m_c.htif.tohost);
@@ -406,6 +419,9 @@ machine::machine(const machine_config &c, const machine_runtime_config &r) :
             throw std::invalid_argument{"virtio devices are only supported in unreproducible machines"};
         }
 
+        // All devices share a single poller, so host registrations persist across polls
+        m_poller = std::make_unique<os_poller>(m_r.poll_backend);
+
         for (const auto &vdev_config_entry : m_c.virtio) {
             std::visit(
                 [&](const auto &vdev_config) {
@@ -414,7 +430,7 @@ machine::machine(const machine_config &c, const machine_runtime_config &r) :
                     std::unique_ptr<virtio_device> vdev;
                     if constexpr (std::is_same_v<T, cartesi::virtio_console_config>) {
                         pma_name = "VirtIO Console";
-                        vdev = std::make_unique<virtio_console>(m_vdevs.size());
+                        vdev = std::make_unique<virtio_console>(m_vdevs.size(), m_console.get());
                     } else if constexpr (std::is_same_v<T, cartesi::virtio_p9fs_config>) {
 #ifdef HAVE_POSIX_FS
                         pma_name = "VirtIO 9P";
@@ -436,10 +452,18 @@ machine::machine(const machine_config &c, const machine_runtime_config &r) :
 #ifdef HAVE_TUNTAP
                         pma_name = "VirtIO Net TUN/TAP";
                         vdev = std::make_unique<virtio_net>(m_vdevs.size(),
-                            std::make_unique<virtio_net_carrier_tuntap>(vdev_config.iface));
+                            std::make_unique<virtio_net_carrier_tuntap>(vdev_config.iface, vdev_config.queue_pairs));
 #else
 
                         throw std::invalid_argument("virtio network TUN/TAP device is unsupported in this platform");
+#endif
+                    } else if constexpr (std::is_same_v<T, cartesi::virtio_blk_config>) {
+#ifdef HAVE_POSIX_FS
+                        pma_name = "VirtIO Block";
+                        vdev = std::make_unique<virtio_blk>(m_vdevs.size(), vdev_config.image_filename,
+                            vdev_config.read_only);
+#else
+                        throw std::invalid_argument("virtio block device is unsupported in this platform");
 #endif
                     } else {
                         throw std::invalid_argument("invalid virtio device configuration");
@@ -447,6 +471,7 @@ machine::machine(const machine_config &c, const machine_runtime_config &r) :
                     register_pma_entry(
                         make_virtio_pma_entry(PMA_FIRST_VIRTIO_START + vdev->get_virtio_index() * PMA_VIRTIO_LENGTH,
                             PMA_VIRTIO_LENGTH, pma_name, &virtio_driver, vdev.get()));
+                    vdev->set_poller(m_poller.get());
                     m_vdevs.push_back(std::move(vdev));
                 },
                 vdev_config_entry);
@@ -474,6 +499,7 @@ machine::machine(const machine_config &c, const machine_runtime_config &r) :
 
     // Last, add sentinel
     m_pmas.push_back(&m_s.empty_pma);
+    m_pmas_lookup.rebuild(m_pmas);
 
     // Initialize TLB device
     // this must be done after all PMA entries are already registered, so we can lookup page addresses
@@ -506,7 +532,8 @@ machine::machine(const machine_config &c, const machine_runtime_config &r) :
     // Initialize memory range descriptions returned by get_memory_ranges method
     for (auto *pma : m_pmas) {
         if (pma->get_length() != 0) {
-            m_mrds.push_back(machine_memory_range_descr{pma->get_start(), pma->get_length(), pma->get_description()});
+            m_mrds.push_back(machine_memory_range_descr{pma->get_start(), pma->get_length(), pma->get_description(),
+                pma->get_istart_M() && pma->get_memory().get_huge_pages()});
         }
     }
     // Sort it by increasing start address
@@ -543,24 +570,24 @@ machine::machine(const std::string &dir, const machine_runtime_config &r) : mach
     }
 }
 
-void machine::prepare_virtio_devices_select(select_fd_sets *fds, uint64_t *timeout_us) {
+void machine::prepare_virtio_devices_select(os_poller *poller, uint64_t *timeout_us) {
     for (auto &vdev : m_vdevs) {
-        vdev->prepare_select(fds, timeout_us);
+        vdev->prepare_select(poller, timeout_us);
     }
 }
 
-bool machine::poll_selected_virtio_devices(int select_ret, select_fd_sets *fds, i_device_state_access *da) {
+bool machine::poll_selected_virtio_devices(int select_ret, os_poller *poller, i_device_state_access *da) {
     bool interrupt_requested = false;
     for (auto &vdev : m_vdevs) {
-        interrupt_requested |= vdev->poll_selected(select_ret, fds, da);
+        interrupt_requested |= vdev->poll_selected(select_ret, poller, da);
     }
     return interrupt_requested;
 }
 
 bool machine::poll_virtio_devices(uint64_t *timeout_us, i_device_state_access *da) {
-    return os_select_fds(
-        [&](select_fd_sets *fds, uint64_t *timeout_us) -> void { prepare_virtio_devices_select(fds, timeout_us); },
-        [&](int select_ret, select_fd_sets *fds) -> bool { return poll_selected_virtio_devices(select_ret, fds, da); },
+    return m_poller->poll(
+        [&](os_poller *poller, uint64_t *timeout_us) -> void { prepare_virtio_devices_select(poller, timeout_us); },
+        [&](int select_ret, os_poller *poller) -> bool { return poll_selected_virtio_devices(select_ret, poller, da); },
         timeout_us);
 }
 
@@ -700,30 +727,23 @@ pma_entry &machine::find_pma_entry(uint64_t paddr, size_t length) {
 }
 
 const pma_entry &machine::find_pma_entry(uint64_t paddr, size_t length) const {
-    return find_pma_entry(m_s.pmas, paddr, length);
+    return find_pma_entry(m_s.pmas, m_s.pmas_lookup, paddr, length);
 }
 
 template <typename CONTAINER>
-pma_entry &machine::find_pma_entry(const CONTAINER &pmas, uint64_t paddr, size_t length) {
+pma_entry &machine::find_pma_entry(const CONTAINER &pmas, const pma_lookup_table &lookup, uint64_t paddr,
+    size_t length) {
     // NOLINTNEXTLINE(cppcoreguidelines-pro-type-const-cast): remove const to reuse code
-    return const_cast<pma_entry &>(std::as_const(*this).find_pma_entry(pmas, paddr, length));
+    return const_cast<pma_entry &>(std::as_const(*this).find_pma_entry(pmas, lookup, paddr, length));
 }
 
 template <typename CONTAINER>
-const pma_entry &machine::find_pma_entry(const CONTAINER &pmas, uint64_t paddr, size_t length) const {
-    for (const auto &p : pmas) {
-        const auto &pma = deref(p);
-        // Stop at first empty PMA
-        if (pma.get_length() == 0) {
-            return pma;
-        }
-        // Check if data is in range
-        if (paddr >= pma.get_start() && pma.get_length() >= length &&
-            paddr - pma.get_start() <= pma.get_length() - length) {
-            return pma;
-        }
+const pma_entry &machine::find_pma_entry(const CONTAINER &pmas, const pma_lookup_table &lookup, uint64_t paddr,
+    size_t length) const {
+    const int index = lookup.find(pmas, paddr, length);
+    if (index >= 0) {
+        return deref(pmas[static_cast<size_t>(index)]);
     }
-
     // Last PMA is always the empty range
     return deref(pmas.back());
 }
@@ -804,6 +824,8 @@ machine::~machine() {
     (void) fprintf(stderr, "machine ints: %" PRIu64 "\n", m_s.stats.m_int);
     (void) fprintf(stderr, "machine ex: %" PRIu64 "\n", m_s.stats.m_ex);
     (void) fprintf(stderr, "atomic mem ops: %" PRIu64 "\n", m_s.stats.atomic_mop);
+    (void) fprintf(stderr, "fused insn pairs: %" PRIu64 "\n", m_s.stats.fused_pair);
+    (void) fprintf(stderr, "idle loop skips: %" PRIu64 "\n", m_s.stats.idle_skip);
     (void) fprintf(stderr, "fence: %" PRIu64 "\n", m_s.stats.fence);
     (void) fprintf(stderr, "fence.i: %" PRIu64 "\n", m_s.stats.fence_i);
     (void) fprintf(stderr, "fence.vma: %" PRIu64 "\n", m_s.stats.fence_vma);
@@ -832,6 +854,12 @@ machine::~machine() {
     (void) fprintf(stderr, "tlb_flush_fence_vma_asid: %" PRIu64 "\n", m_s.stats.tlb_flush_fence_vma_asid);
     (void) fprintf(stderr, "tlb_flush_fence_vma_vaddr: %" PRIu64 "\n", m_s.stats.tlb_flush_fence_vma_vaddr);
     (void) fprintf(stderr, "tlb_flush_fence_vma_asid_vaddr: %" PRIu64 "\n", m_s.stats.tlb_flush_fence_vma_asid_vaddr);
+    (void) fprintf(stderr, "pwc hit ratio: %.4f\n", TLB_HIT_RATIO(m_s, pwc_miss, pwc_hit));
+    (void) fprintf(stderr, "pwc_hit: %" PRIu64 "\n", m_s.stats.pwc_hit);
+    (void) fprintf(stderr, "pwc_miss: %" PRIu64 "\n", m_s.stats.pwc_miss);
+    (void) fprintf(stderr, "pwc_flush: %" PRIu64 "\n", m_s.stats.pwc_flush);
+    (void) fprintf(stderr, "pwc_superpage_hit: %" PRIu64 "\n", m_s.stats.pwc_superpage_hit);
+    (void) fprintf(stderr, "fetch_cache_flush: %" PRIu64 "\n", m_s.stats.fetch_cache_flush);
 #endif
 }
 
@@ -1635,7 +1663,7 @@ bool machine::update_merkle_tree_page(uint64_t address) {
         "PMA and machine_merkle_tree page sizes must match");
     // Align address to beginning of page
     address &= ~(PMA_PAGE_SIZE - 1);
-    pma_entry &pma = find_pma_entry(m_pmas, address, sizeof(uint64_t));
+    pma_entry &pma = find_pma_entry(m_pmas, m_pmas_lookup, address, sizeof(uint64_t));
     const uint64_t page_start_in_range = address - pma.get_start();
     machine_merkle_tree::hasher_type h;
     auto scratch = unique_calloc<unsigned char>(PMA_PAGE_SIZE, std::nothrow_t{});
@@ -1662,6 +1690,30 @@ bool machine::update_merkle_tree_page(uint64_t address) {
     return m_t.end_update(h);
 }
 
+bool machine::is_uarch_ram_pristine(void) {
+    const auto &ram = m_uarch.get_state().ram;
+    for (uint64_t offset = 0; offset < ram.get_length(); offset += PMA_PAGE_SIZE) {
+        if (ram.is_page_marked_dirty(offset)) {
+            return false;
+        }
+    }
+    // The uarch RAM is the second child of the uarch state subtree, at heap index 3
+    static_assert(UARCH_RAM_START_ADDRESS == UARCH_STATE_START_ADDRESS + (UINT64_C(1) << UARCH_STATE_CHILD_LOG2_SIZE),
+        "uarch RAM must be the second child of the uarch state");
+    return m_t.get_node_hash(UARCH_RAM_START_ADDRESS, UARCH_STATE_CHILD_LOG2_SIZE) ==
+        get_uarch_pristine_state_subtree_hashes()[3];
+}
+
+void machine::update_merkle_tree_uarch_pristine(void) {
+    machine_merkle_tree::hasher_type h;
+    if (!m_t.replace_subtree_hashes(UARCH_STATE_START_ADDRESS, UARCH_STATE_LOG2_SIZE,
+            get_uarch_pristine_state_subtree_hashes(), h)) {
+        throw std::runtime_error{"error updating Merkle tree"};
+    }
+    // The tree now matches the contents of uarch RAM, so its pages are no longer dirty
+    m_uarch.get_state().ram.mark_pages_clean();
+}
+
 const boost::container::static_vector<pma_entry, PMA_MAX> &machine::get_pmas(void) const {
     return m_s.pmas;
 }
@@ -1702,7 +1754,7 @@ machine_merkle_tree::proof_type machine::get_proof(uint64_t address, int log2_si
     // or entirely outside it.
     if (log2_size < machine_merkle_tree::get_log2_page_size()) {
         const uint64_t length = UINT64_C(1) << log2_size;
-        const pma_entry &pma = find_pma_entry(m_pmas, address, length);
+        const pma_entry &pma = find_pma_entry(m_pmas, m_pmas_lookup, address, length);
         auto scratch = unique_calloc<unsigned char>(PMA_PAGE_SIZE);
         const unsigned char *page_data = nullptr;
         // If the PMA range is empty, we know the desired range is
@@ -1738,7 +1790,7 @@ void machine::read_memory(uint64_t address, unsigned char *data, uint64_t length
     if (!data) {
         throw std::invalid_argument{"invalid data buffer"};
     }
-    const pma_entry &pma = find_pma_entry(m_pmas, address, length);
+    const pma_entry &pma = find_pma_entry(m_pmas, m_pmas_lookup, address, length);
     if (pma.get_istart_M()) {
         memcpy(data, pma.get_memory().get_host_memory() + (address - pma.get_start()), length);
         return;
@@ -1788,7 +1840,7 @@ void machine::write_memory(uint64_t address, const unsigned char *data, size_t l
     if (!data) {
         throw std::invalid_argument{"invalid data buffer"};
     }
-    pma_entry &pma = find_pma_entry(m_pmas, address, length);
+    pma_entry &pma = find_pma_entry(m_pmas, m_pmas_lookup, address, length);
     if (!pma.get_istart_M() || pma.get_istart_E()) {
         throw std::invalid_argument{"address range not entirely in memory PMA"};
     }
@@ -1799,7 +1851,7 @@ void machine::fill_memory(uint64_t address, uint8_t data, size_t length) {
     if (length == 0) {
         return;
     }
-    pma_entry &pma = find_pma_entry(m_pmas, address, length);
+    pma_entry &pma = find_pma_entry(m_pmas, m_pmas_lookup, address, length);
     if (!pma.get_istart_M() || pma.get_istart_E()) {
         throw std::invalid_argument{"address range not entirely in memory PMA"};
     }
@@ -1941,6 +1993,15 @@ void machine::send_cmio_response(uint16_t reason, const unsigned char *data, siz
     cartesi::send_cmio_response(a, reason, data, length);
 }
 
+const unsigned char *machine::get_cmio_tx_buffer(uint64_t &length) const {
+    const pma_entry &pma = find_pma_entry(PMA_CMIO_TX_BUFFER_START, PMA_CMIO_TX_BUFFER_LENGTH);
+    if (pma.get_istart_DID() != PMA_ISTART_DID::cmio_tx_buffer || !pma.get_istart_M()) {
+        throw std::runtime_error{"cmio tx buffer not found"};
+    }
+    length = pma.get_length();
+    return pma.get_memory().get_host_memory();
+}
+
 access_log machine::log_send_cmio_response(uint16_t reason, const unsigned char *data, size_t length,
     const access_log::type &log_type, bool one_based) {
     hash_type root_hash_before;
@@ -2008,8 +2069,10 @@ void machine::set_uarch_halt_flag() {
 }
 
 void machine::reset_uarch() {
-    uarch_state_access a(m_uarch.get_state(), get_state());
+    // Skip reloading the uarch RAM image when it has not changed since the last reset
+    uarch_state_access a(m_uarch.get_state(), get_state(), is_uarch_ram_pristine());
     uarch_reset_state(a);
+    update_merkle_tree_uarch_pristine();
 }
 
 access_log machine::log_uarch_reset(const access_log::type &log_type, bool one_based) {
@@ -2142,12 +2205,135 @@ uarch_interpreter_break_reason machine::run_uarch(uint64_t uarch_cycle_end) {
     return uarch_interpret(a, uarch_cycle_end);
 }
 
+/// \brief Throws if host device state is out of sync with the machine state after a replay
+static void check_not_replay_only(const machine &m) {
+    if (m.is_replay_only()) {
+        throw std::runtime_error{"machine was replayed from an execution trace and can only replay further traces"};
+    }
+}
+
 interpreter_break_reason machine::run(uint64_t mcycle_end) {
+    if (m_tracer == nullptr || !m_tracer->is_replaying()) {
+        check_not_replay_only(*this);
+    }
+    if (mcycle_end < read_mcycle()) {
+        throw std::invalid_argument{"mcycle is past"};
+    }
+    state_access a(*this);
+    const auto break_reason = interpret(a, mcycle_end);
+    // Make sure the host sees all output produced by the guest before run returns
+    m_console->flush();
+    return break_reason;
+}
+
+uint64_t machine::read_console_output(unsigned char *data, uint64_t max_length) {
+    return m_console->read(data, max_length);
+}
+
+interpreter_break_reason machine::run_record_trace(uint64_t mcycle_end, execution_trace &trace) {
+    if (m_tracer != nullptr) {
+        throw std::runtime_error{"execution tracer is already active"};
+    }
+    check_not_replay_only(*this);
+    trace = execution_trace{};
+    trace.mcycle_begin = read_mcycle();
+    trace.mcycle_end = mcycle_end;
+    execution_tracer tracer(trace);
+    m_tracer = &tracer;
+    try {
+        trace.break_reason = run(mcycle_end);
+    } catch (...) {
+        m_tracer = nullptr;
+        throw;
+    }
+    m_tracer = nullptr;
+    trace.mcycle_final = read_mcycle();
+    return trace.break_reason;
+}
+
+interpreter_break_reason machine::run_replay_trace(const execution_trace &trace) {
+    if (m_tracer != nullptr) {
+        throw std::runtime_error{"execution tracer is already active"};
+    }
+    if (read_mcycle() != trace.mcycle_begin) {
+        throw std::invalid_argument{"mcycle does not match beginning of execution trace"};
+    }
+    // Replayed device accesses never reach the host devices, so their host-side state goes stale
+    m_replay_only = true;
+    execution_tracer tracer(trace);
+    m_tracer = &tracer;
+    interpreter_break_reason break_reason = interpreter_break_reason::failed;
+    try {
+        break_reason = run(trace.mcycle_end);
+    } catch (...) {
+        m_tracer = nullptr;
+        throw;
+    }
+    m_tracer = nullptr;
+    if (!tracer.is_done() || break_reason != trace.break_reason || read_mcycle() != trace.mcycle_final) {
+        throw std::runtime_error{"execution diverged from trace"};
+    }
+    return break_reason;
+}
+
+/// \brief Flags TLB entries for pages that overlap watchpoints
+template <TLB_entry_type ETYPE>
+static void mark_watched_tlb_entries(const machine &m, break_condition_monitor &monitor) {
+    for (uint64_t i = 0; i < PMA_TLB_SIZE; ++i) {
+        const tlb_hot_entry &tlbhe = m.get_state().tlb.hot[ETYPE][i];
+        const tlb_cold_entry &tlbce = m.get_state().tlb.cold[ETYPE][i];
+        monitor.set_tlb_entry_watched(ETYPE, i,
+            tlbhe.vaddr_page != TLB_INVALID_PAGE && monitor.is_watched_page(tlbhe.vaddr_page, tlbce.paddr_page));
+    }
+}
+
+interpreter_break_reason machine::run_until(uint64_t mcycle_end, const machine_break_conditions &conditions,
+    machine_break_event &event) {
+    if (m_break_monitor != nullptr) {
+        throw std::runtime_error{"break condition monitor is already active"};
+    }
+    check_not_replay_only(*this);
     if (mcycle_end < read_mcycle()) {
         throw std::invalid_argument{"mcycle is past"};
     }
+    break_condition_monitor monitor(conditions, read_mcycle());
     state_access a(*this);
-    return interpret(a, mcycle_end);
+    // Hits on watched pages are checked on the side, evicting them would change the shadow TLB and the root hash
+    mark_watched_tlb_entries<TLB_READ>(*this, monitor);
+    mark_watched_tlb_entries<TLB_WRITE>(*this, monitor);
+    m_break_monitor = &monitor;
+    interpreter_break_reason break_reason = interpreter_break_reason::failed;
+    try {
+        break_reason = interpret(a, mcycle_end);
+    } catch (...) {
+        m_break_monitor = nullptr;
+        throw;
+    }
+    m_break_monitor = nullptr;
+    event = monitor.get_event();
+    return break_reason;
+}
+
+void machine::start_profiler(uint64_t sample_interval) {
+    m_profiler = std::make_unique<machine_profiler>(sample_interval, read_mcycle());
+}
+
+void machine::stop_profiler(void) {
+    m_profiler.reset();
+}
+
+void machine::write_profile(const std::string &filename, machine_profile_format format,
+    const std::string &elf_filename) const {
+    if (!m_profiler) {
+        throw std::runtime_error{"profiler is not started"};
+    }
+    guest_symbolizer symbolizer;
+    if (!elf_filename.empty()) {
+        symbolizer = [symbols = std::make_shared<elf_symbol_table>(elf_filename)](uint64_t vaddr) {
+            return symbols->lookup(vaddr);
+        };
+    }
+    m_profiler->write(filename, format, symbolizer);
 }
 
 } // namespace cartesi
@@ -24,10 +24,14 @@
 #include <memory>
 
 #include "access-log.h"
+#include "console-output.h"
+#include "execution-trace.h"
+#include "htif.h"
 #include "interpret.h"
 #include "machine-config.h"
 #include "machine-memory-range-descr.h"
 #include "machine-merkle-tree.h"
+#include "machine-profiler.h"
 #include "machine-runtime-config.h"
 #include "machine-state.h"
 #include "os.h"
@@ -37,6 +41,11 @@
 
 namespace cartesi {
 
+// Forward declarations
+struct machine_break_conditions;
+struct machine_break_event;
+class break_condition_monitor;
+
 /// \brief Tag type used to indicate that merkle tree updates should be skipped.
 struct skip_merkle_tree_update_t {
     explicit skip_merkle_tree_update_t() = default;
@@ -59,13 +68,23 @@ private:
     mutable machine_state m_s;          ///< Opaque machine state
     mutable machine_merkle_tree m_t;    ///< Merkle tree of state
     std::vector<pma_entry *> m_pmas;    ///< List of all pmas used to compute the machine hash: big machine and uarch
+    pma_lookup_table m_pmas_lookup;     ///< Fast lookup of entries in m_pmas
     machine_config m_c;                 ///< Copy of initialization config
     uarch_machine m_uarch;              ///< Microarchitecture machine
     machine_runtime_config m_r;         ///< Copy of initialization runtime config
     machine_memory_range_descrs m_mrds; ///< List of memory ranges returned by get_memory_ranges().
 
+    std::unique_ptr<console_output> m_console; ///< Receives output of HTIF and VirtIO consoles
+    htif_context m_htif_context{};             ///< Context of HTIF device
+
+    std::unique_ptr<os_poller> m_poller;                                                 ///< Poller of VirtIO devices
     boost::container::static_vector<std::unique_ptr<virtio_device>, VIRTIO_MAX> m_vdevs; ///< Array of VirtIO devices
 
+    execution_tracer *m_tracer{nullptr};               ///< Execution tracer active during run, if any
+    break_condition_monitor *m_break_monitor{nullptr}; ///< Break condition monitor active during run, if any
+    std::unique_ptr<machine_profiler> m_profiler;      ///< Guest profiler, if started
+    bool m_replay_only{false};                         ///< Host device state is out of sync after a trace replay
+
     static const pma_entry::flags m_dtb_flags;            ///< PMA flags used for DTB
     static const pma_entry::flags m_ram_flags;            ///< PMA flags used for RAM
     static const pma_entry::flags m_flash_drive_flags;    ///< PMA flags used for flash drives
@@ -81,13 +100,13 @@ private:
     /// \param description Informative description of PMA entry for use in error messages
     /// \param c Memory range configuration.
     /// \returns New PMA entry (with default flags).
-    static pma_entry make_memory_range_pma_entry(const std::string &description, const memory_range_config &c);
+    pma_entry make_memory_range_pma_entry(const std::string &description, const memory_range_config &c) const;
 
     /// \brief Creates a new flash drive PMA entry.
     /// \param description Informative description of PMA entry for use in error messages
     /// \param c Memory range configuration.
     /// \returns New PMA entry with flash drive flags already set.
-    static pma_entry make_flash_drive_pma_entry(const std::string &description, const memory_range_config &c);
+    pma_entry make_flash_drive_pma_entry(const std::string &description, const memory_range_config &c) const;
 
     /// \brief Creates a new cmio rx buffer PMA entry.
     // \param c Optional cmio configuration
@@ -106,16 +125,17 @@ private:
 
     /// \brief Obtain PMA entry that covers a given physical memory region
     /// \param pmas Container of pmas to be searched.
-    /// \param s Pointer to machine state.
+    /// \param lookup Lookup table built from the container.
     /// \param paddr Start of physical memory region.
     /// \param length Length of physical memory region.
     /// \returns Corresponding entry if found, or a sentinel entry
     /// for an empty range.
     template <typename CONTAINER>
-    pma_entry &find_pma_entry(const CONTAINER &pmas, uint64_t paddr, size_t length);
+    pma_entry &find_pma_entry(const CONTAINER &pmas, const pma_lookup_table &lookup, uint64_t paddr, size_t length);
 
     template <typename CONTAINER>
-    const pma_entry &find_pma_entry(const CONTAINER &pmas, uint64_t paddr, size_t length) const;
+    const pma_entry &find_pma_entry(const CONTAINER &pmas, const pma_lookup_table &lookup, uint64_t paddr,
+        size_t length) const;
 
 public:
     /// \brief Type of hash
@@ -202,6 +222,84 @@ public:
     ///  frequent scenario is when the program executes a WFI instruction. Another example is when the machine halts.
     interpreter_break_reason run(uint64_t mcycle_end);
 
+    /// \brief Runs the machine like run(), recording the nondeterministic events it consumes.
+    /// \param mcycle_end Maximum value of mcycle before function returns.
+    /// \param trace Receives the execution trace.
+    /// \returns The reason the machine was interrupted.
+    /// \details The trace contains loads and stores to VirtIO and HTIF devices, polls for external interrupts that
+    ///  advanced mcycle or raised interrupts, and every change these made to the machine state.
+    ///  Everything else the interpreter does is a function of the machine state, so it is not recorded.
+    interpreter_break_reason run_record_trace(uint64_t mcycle_end, execution_trace &trace);
+
+    /// \brief Re-executes a run recorded by run_record_trace().
+    /// \param trace Execution trace to replay.
+    /// \returns The reason the machine was interrupted, which is always the one recorded in the trace.
+    /// \details The machine must start from the same state the recording machine was in.
+    ///  Device accesses and polls are served from the trace, so host devices are never touched and
+    ///  the interpreter never waits for the host. Throws if the execution diverges from the trace,
+    ///  in which case the machine state is left undefined.
+    ///  Replay is not a faster way to reach the final state: every instruction is re-executed, and
+    ///  only the waits for host devices are skipped.
+    ///  Host-side device state (VirtIO queue indices, console, network and file system backends) is
+    ///  not updated by replay, so it no longer matches the machine state. From then on the machine is
+    ///  replay-only: run(), run_until() and run_record_trace() throw, and only further traces can be replayed.
+    interpreter_break_reason run_replay_trace(const execution_trace &trace);
+
+    /// rief Tells whether the machine was replayed from an execution trace and can only replay further traces.
+    bool is_replay_only(void) const {
+        return m_replay_only;
+    }
+
+    /// \brief Returns the execution tracer active during run, or nullptr if there is none.
+    execution_tracer *get_execution_tracer(void) const {
+        return m_tracer;
+    }
+
+    /// \brief Runs the machine like run(), but also stops exactly when a break condition is reached.
+    /// \param mcycle_end Maximum value of mcycle before function returns.
+    /// \param conditions Breakpoints, watchpoints and CSR predicates to stop at.
+    /// \param event Receives the condition that was reached, if any.
+    /// \returns The reason the machine was interrupted, interpreter_break_reason::reached_break_condition
+    ///  when a condition was reached.
+    /// \details Breakpoints stop before executing the instruction, watchpoints and CSR predicates stop after
+    ///  executing the instruction that triggered them. Breakpoints are ignored for the first instruction, so
+    ///  calling the function again resumes from where it stopped. Watched pages stay in the TLB, and accesses
+    ///  that hit them are checked on the side, so the machine state and hash match the ones left by run().
+    interpreter_break_reason run_until(uint64_t mcycle_end, const machine_break_conditions &conditions,
+        machine_break_event &event);
+
+    /// \brief Returns the break condition monitor active during run, or nullptr if there is none.
+    break_condition_monitor *get_break_condition_monitor(void) const {
+        return m_break_monitor;
+    }
+
+    /// \brief Starts profiling the guest in subsequent runs, discarding any previous profile.
+    /// \param sample_interval Number of cycles between pc samples.
+    /// \details Only run() and run_until() collect profiles. The machine state and hash are not affected.
+    void start_profiler(uint64_t sample_interval);
+
+    /// \brief Stops profiling the guest and discards the profile.
+    void stop_profiler(void);
+
+    /// \brief Moves console output captured in memory out of the machine.
+    /// \param data Receives the output, oldest characters first.
+    /// \param max_length Maximum number of characters to move.
+    /// \returns Number of characters moved.
+    /// \details Only the memory console output mode captures output, in other modes this always returns 0.
+    uint64_t read_console_output(unsigned char *data, uint64_t max_length);
+
+    /// \brief Writes the profile collected since the profiler was started.
+    /// \param filename Name of file to write.
+    /// \param format Format of profile.
+    /// \param elf_filename Name of guest ELF file with function symbols, or empty to report bare addresses.
+    void write_profile(const std::string &filename, machine_profile_format format,
+        const std::string &elf_filename) const;
+
+    /// \brief Returns the guest profiler, or nullptr if it is not started.
+    machine_profiler *get_profiler(void) const {
+        return m_profiler.get();
+    }
+
     /// \brief Runs the machine in the microarchitecture until the mcycles advances by one unit or the micro cycle
     /// counter (uarch_cycle) reaches uarch_cycle_end
     /// \param uarch_cycle_end uarch_cycle limit
@@ -275,20 +373,20 @@ public:
     /// \brief Destructor.
     ~machine();
 
-    /// \brief Fill file descriptors to be polled by select() for all VirtIO devices.
-    /// \param fds Pointer to sets of read, write and except file descriptors to be updated.
+    /// \brief Register or renew interest in file descriptors to be polled for all VirtIO devices.
+    /// \param poller Poller to register file descriptors in.
     /// \param timeout_us Maximum amount of time to wait in microseconds, this may be updated (always to lower values).
-    void prepare_virtio_devices_select(select_fd_sets *fds, uint64_t *timeout_us);
+    void prepare_virtio_devices_select(os_poller *poller, uint64_t *timeout_us);
 
-    /// \brief Poll file descriptors that were marked as ready by select() for all VirtIO devices.
-    /// \param select_ret Return value from the most recent select() call.
-    /// \param fds Pointer to sets of read, write and except file descriptors to be checked.
+    /// \brief Poll file descriptors that were marked as ready for all VirtIO devices.
+    /// \param select_ret Return value from the most recent poll.
+    /// \param poller Poller holding ready file descriptors.
     /// \returns True if an interrupt was requested, false otherwise.
     /// \details This function process pending events and trigger interrupt requests (if any).
-    bool poll_selected_virtio_devices(int select_ret, select_fd_sets *fds, i_device_state_access *da);
+    bool poll_selected_virtio_devices(int select_ret, os_poller *poller, i_device_state_access *da);
 
-    /// \brief Poll file descriptors through select() for all VirtIO devices.
-    /// \details Basically call prepare_virtio_devices_select(), select() and poll_selected_virtio_devices().
+    /// \brief Poll file descriptors for all VirtIO devices, using the poll backend of the runtime config.
+    /// \details Basically call prepare_virtio_devices_select(), wait and poll_selected_virtio_devices().
     /// \param timeout_us Maximum amount of time to wait in microseconds, this may be updated (always to lower values).
     /// \returns True if an interrupt was requested, false otherwise.
     bool poll_virtio_devices(uint64_t *timeout_us, i_device_state_access *da);
@@ -314,6 +412,15 @@ public:
     /// \returns true if succeeded, false otherwise.
     bool update_merkle_tree_page(uint64_t address);
 
+    /// \brief Checks if the uarch RAM is known to hold its pristine contents.
+    /// \returns True if no uarch RAM page is dirty and the Merkle tree holds the pristine uarch RAM hash.
+    /// \details Clean pages are reflected in the Merkle tree, so comparing hashes compares contents.
+    bool is_uarch_ram_pristine(void);
+
+    /// \brief Update the Merkle tree after the uarch state has been reset to its pristine values.
+    /// \details Replaces the uarch subtree with precomputed pristine hashes instead of re-hashing every uarch page.
+    void update_merkle_tree_uarch_pristine(void);
+
     /// \brief Obtains the proof for a node in the Merkle tree.
     /// \param address Address of target node. Must be aligned to a 2<sup>log2_size</sup> boundary.
     /// \param log2_size log<sub>2</sub> of size subintended by target node.
@@ -858,6 +965,12 @@ public:
     /// \param length Length of response data.
     void send_cmio_response(uint16_t reason, const unsigned char *data, size_t length);
 
+    /// \brief Returns the host memory backing the cmio tx buffer, so its contents can be read without copies
+    /// \param length Receives the length of the buffer.
+    /// \return Pointer to the start of the buffer.
+    /// \details The pointer remains valid until the machine is destroyed or the buffer range is replaced.
+    const unsigned char *get_cmio_tx_buffer(uint64_t &length) const;
+
     /// \brief Sends cmio response and returns an access log
     /// \param reason Reason for sending response.
     /// \param data Reponse data.
@@ -57,6 +57,10 @@
 #define HAVE_SELECT
 #endif
 
+#if !defined(NO_EPOLL) && defined(__linux__)
+#define HAVE_EPOLL
+#endif
+
 #if !defined(NO_POSIX_FILE) && !defined(__wasi__) && !defined(_WIN32)
 #define HAVE_POSIX_FS
 #endif
@@ -65,4 +69,8 @@
 #define HAVE_USLEEP
 #endif
 
+#if !defined(NO_SOCKETS) && !defined(__wasi__) && !defined(_WIN32)
+#define HAVE_SOCKETS
+#endif
+
 #endif
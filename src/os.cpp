@@ -14,12 +14,16 @@
 // with this program (see COPYING). If not, see <https://www.gnu.org/licenses/>.
 //
 
+#include <algorithm>
 #include <array>
+#include <cerrno>
 #include <chrono>
+#include <climits>
 #include <cstdint>
 #include <cstdio>
 #include <cstring>
 #include <iostream>
+#include <stdexcept>
 #include <string>
 #include <system_error>
 #include <vector>
@@ -38,8 +42,8 @@
 #include <thread>
 #endif
 
-#if defined(HAVE_TTY) || defined(HAVE_MMAP) || defined(HAVE_TERMIOS) || defined(_WIN32)
-#include <fcntl.h> // open
+#if defined(HAVE_TTY) || defined(HAVE_MMAP) || defined(HAVE_TERMIOS) || defined(HAVE_SELECT) || defined(_WIN32)
+#include <fcntl.h> // open/fcntl
 #endif
 
 #ifdef HAVE_TERMIOS
@@ -84,14 +88,19 @@
 
 #else // not _WIN32
 
-#if defined(HAVE_TTY) || defined(HAVE_MMAP) || defined(HAVE_TERMIOS) || defined(HAVE_USLEEP)
-#include <unistd.h> // write/read/close
+#if defined(HAVE_TTY) || defined(HAVE_MMAP) || defined(HAVE_TERMIOS) || defined(HAVE_USLEEP) ||                        \
+    defined(HAVE_SELECT) || defined(HAVE_EPOLL)
+#include <unistd.h> // write/read/close/getpid
 #endif
 
 #if defined(HAVE_SELECT)
 #include <sys/select.h> // select
 #endif
 
+#if defined(HAVE_EPOLL)
+#include <sys/epoll.h> // epoll_create1/epoll_ctl/epoll_wait
+#endif
+
 #define plat_write write
 #define plat_mkdir mkdir
 
@@ -354,7 +363,7 @@ void os_get_tty_size(uint16_t *pwidth, uint16_t *pheight) {
     *pheight = s->rows;
 }
 
-void os_prepare_tty_select(select_fd_sets *fds) {
+void os_prepare_tty_select(os_poller *poller) {
 #ifdef HAVE_TTY
     auto *s = get_state();
     // Ignore if TTY is not initialized or stdin was closed
@@ -362,19 +371,14 @@ void os_prepare_tty_select(select_fd_sets *fds) {
         return;
     }
 #ifndef _WIN32
-    // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
-    fd_set *readfds = reinterpret_cast<fd_set *>(fds->readfds);
-    FD_SET(STDIN_FILENO, readfds);
-    if (STDIN_FILENO > fds->maxfd) {
-        fds->maxfd = STDIN_FILENO;
-    }
+    poller->watch(STDIN_FILENO, OS_POLL_IN);
 #else
-    (void) fds;
+    (void) poller;
 #endif
 #endif
 }
 
-bool os_poll_selected_tty(int select_ret, select_fd_sets *fds) {
+bool os_poll_selected_tty(int select_ret, const os_poller *poller) {
     auto *s = get_state();
     if (!s->initialized) { // We can't poll when TTY is not initialized
         return false;
@@ -409,10 +413,8 @@ bool os_poll_selected_tty(int select_ret, select_fd_sets *fds) {
         }
     }
 #else
-    // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
-    fd_set *readfds = reinterpret_cast<fd_set *>(fds->readfds);
     // If the stdin file description is not ready, we can't obtain more characters
-    if (select_ret <= 0 || !FD_ISSET(STDIN_FILENO, readfds)) {
+    if (select_ret <= 0 || (poller->get_ready(STDIN_FILENO) & OS_POLL_IN) == 0) {
         return false;
     }
     const intptr_t len = static_cast<intptr_t>(read(STDIN_FILENO, s->buf.data(), s->buf.size()));
@@ -447,12 +449,14 @@ bool os_poll_tty(uint64_t timeout_us) {
     return os_poll_selected_tty(-1, nullptr);
 
 #else
-    return os_select_fds(
-        [](select_fd_sets *fds, const uint64_t *timeout_us) -> void {
+    // The TTY poller lives as long as the TTY global state
+    static os_poller poller{os_poll_backend::automatic};
+    return poller.poll([](os_poller *poller, const uint64_t *timeout_us) -> void {
             (void) timeout_us;
-            os_prepare_tty_select(fds);
+            os_prepare_tty_select(poller);
         },
-        [](int select_ret, select_fd_sets *fds) -> bool { return os_poll_selected_tty(select_ret, fds); }, &timeout_us);
+        [](int select_ret, os_poller *poller) -> bool { return os_poll_selected_tty(select_ret, poller); },
+        &timeout_us);
 
 #endif // _WIN32
 }
@@ -492,6 +496,38 @@ static void fputc_with_line_buffering(uint8_t ch) {
     }
 }
 
+#ifdef HAVE_TTY
+/// \brief Writes all characters to stdout, without buffering.
+/// \details Interrupted writes are retried, and when stdout is non-blocking and full, waits until it
+/// becomes writable again. Gives up only on other errors, dropping the remaining characters.
+static void write_all_stdout(const uint8_t *data, size_t len) {
+    while (len > 0) {
+        const auto written = plat_write(STDOUT_FILENO, data, len);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno == EAGAIN) {
+#if defined(HAVE_SELECT) && !defined(_WIN32)
+                fd_set writefds;
+                FD_ZERO(&writefds);
+                FD_SET(STDOUT_FILENO, &writefds);
+                // Any error here, other than being interrupted, is reported again by the next write
+                (void) select(STDOUT_FILENO + 1, nullptr, &writefds, nullptr, nullptr);
+#endif
+                continue;
+            }
+            break;
+        }
+        if (written == 0) {
+            break;
+        }
+        data += written;
+        len -= static_cast<size_t>(written);
+    }
+}
+#endif // HAVE_TTY
+
 void os_putchar(uint8_t ch) {
 #ifdef HAVE_TTY
     auto *s = get_state();
@@ -501,9 +537,7 @@ void os_putchar(uint8_t ch) {
     } else {
         // In interactive sessions we want to immediately write the character to stdout,
         // without any buffering.
-        if (plat_write(STDOUT_FILENO, &ch, 1) < 1) {
-            ;
-        }
+        write_all_stdout(&ch, 1);
     }
 #else
     fputc_with_line_buffering(ch);
@@ -511,8 +545,19 @@ void os_putchar(uint8_t ch) {
 }
 
 void os_putchars(const uint8_t *data, size_t len) {
-    for (size_t i = 0; i < len; ++i) {
-        os_putchar(data[i]);
+#ifdef HAVE_TTY
+    auto *s = get_state();
+    if (s->initialized) {
+        // In interactive sessions we want to immediately write the characters to stdout,
+        // without any buffering, but there is no need to do it one at a time.
+        write_all_stdout(data, len);
+        return;
+    }
+#endif // HAVE_TTY
+    // Write through fwrite(), flushing only when there is a new line to perform line buffering.
+    (void) fwrite(data, 1, len, stdout);
+    if (memchr(data, '\n', len) != nullptr) {
+        (void) fflush(stdout);
     }
 }
 
@@ -670,6 +715,85 @@ void os_unmap_file(unsigned char *host_memory, uint64_t length) {
 #endif // HAVE_MMAP
 }
 
+unsigned char *os_map_shared_memory(const char *name, uint64_t length, bool create) {
+    if (!name || *name == '\0') {
+        throw std::runtime_error{"shared memory name must be specified"s};
+    }
+#ifdef HAVE_MMAP
+    const int oflag = create ? (O_RDWR | O_CREAT | O_EXCL) : O_RDWR;
+    const int fd = shm_open(name, oflag, S_IRUSR | S_IWUSR);
+    if (fd < 0) {
+        throw std::system_error{errno, std::generic_category(), "could not open shared memory '"s + name + "'"s};
+    }
+    if (create) {
+        if (ftruncate(fd, static_cast<off_t>(length)) < 0) {
+            const int errno_copy = errno;
+            close(fd);
+            shm_unlink(name);
+            throw std::system_error{errno_copy, std::generic_category(),
+                "could not resize shared memory '"s + name + "'"s};
+        }
+    } else {
+        struct stat statbuf {};
+        if (fstat(fd, &statbuf) < 0) {
+            const int errno_copy = errno;
+            close(fd);
+            throw std::system_error{errno_copy, std::generic_category(),
+                "unable to obtain length of shared memory '"s + name + "'"s};
+        }
+        if (static_cast<uint64_t>(statbuf.st_size) != length) {
+            close(fd);
+            throw std::invalid_argument{"shared memory '"s + name + "' size ("s +
+                std::to_string(static_cast<uint64_t>(statbuf.st_size)) + ") does not match length ("s +
+                std::to_string(length) + ")"s};
+        }
+    }
+    auto *host_memory = static_cast<unsigned char *>(mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0));
+    if (host_memory == MAP_FAILED) { // NOLINT(cppcoreguidelines-pro-type-cstyle-cast,performance-no-int-to-ptr)
+        const int errno_copy = errno;
+        close(fd);
+        if (create) {
+            shm_unlink(name);
+        }
+        throw std::system_error{errno_copy, std::generic_category(),
+            "could not map shared memory '"s + name + "' to memory"s};
+    }
+    // The mapping keeps its own reference to the segment
+    close(fd);
+    return host_memory;
+#else
+    (void) length;
+    (void) create;
+    throw std::runtime_error{"shared memory is not supported"s};
+#endif // HAVE_MMAP
+}
+
+void os_unlink_shared_memory(const char *name) {
+#ifdef HAVE_MMAP
+    shm_unlink(name);
+#else
+    (void) name;
+#endif // HAVE_MMAP
+}
+
+bool os_advise_huge_pages(unsigned char *host_memory, uint64_t length) {
+#if defined(HAVE_MMAP) && defined(MADV_HUGEPAGE)
+    constexpr uint64_t huge_page_size = UINT64_C(1) << 21;
+    const auto start = reinterpret_cast<uintptr_t>(host_memory); // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+    const uint64_t aligned_start = (start + huge_page_size - 1) & ~(huge_page_size - 1);
+    const uint64_t aligned_end = (start + length) & ~(huge_page_size - 1);
+    if (aligned_end <= aligned_start) {
+        return false;
+    }
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast,performance-no-int-to-ptr)
+    return madvise(reinterpret_cast<void *>(aligned_start), aligned_end - aligned_start, MADV_HUGEPAGE) == 0;
+#else
+    (void) host_memory;
+    (void) length;
+    return false;
+#endif
+}
+
 int64_t os_now_us() {
     std::chrono::time_point<std::chrono::high_resolution_clock> start{};
     static bool started = false;
@@ -717,11 +841,207 @@ bool os_parallel_for(uint64_t n, const std::function<bool(uint64_t j, const para
     return succeeded;
 }
 
-bool os_select_fds(const os_select_before_callback &before_cb, const os_select_after_callback &after_cb,
-    uint64_t *timeout_us) {
-    // Create empty fd sets
-    select_fd_sets fds{};
-    fds.maxfd = -1;
+os_poller::os_poller(os_poll_backend backend) : m_backend(backend) {
+    if (m_backend == os_poll_backend::automatic) {
+#ifdef HAVE_EPOLL
+        m_backend = os_poll_backend::epoll;
+#else
+        m_backend = os_poll_backend::select;
+#endif
+    }
+    if (m_backend == os_poll_backend::epoll) {
+#ifdef HAVE_EPOLL
+        m_epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+        if (m_epoll_fd < 0) {
+            throw std::system_error{errno, std::generic_category(), "could not create epoll instance"};
+        }
+        m_epoll_pid = static_cast<int>(getpid());
+#else
+        throw std::invalid_argument{"epoll poll backend is unsupported in this platform"};
+#endif
+    }
+}
+
+os_poller::~os_poller() {
+#ifdef HAVE_EPOLL
+    if (m_epoll_fd >= 0) {
+        close(m_epoll_fd);
+    }
+#endif
+}
+
+#ifdef HAVE_EPOLL
+/// \brief Maximum number of ready file descriptors retrieved by a single epoll_wait()
+/// \details Others stay ready and are retrieved by the next poll, since epoll is level-triggered
+constexpr int OS_POLL_MAX_EVENTS = 256;
+
+static uint32_t to_epoll_events(uint32_t events) {
+    uint32_t epoll_events = 0;
+    if ((events & OS_POLL_IN) != 0) {
+        epoll_events |= EPOLLIN;
+    }
+    if ((events & OS_POLL_OUT) != 0) {
+        epoll_events |= EPOLLOUT;
+    }
+    if ((events & OS_POLL_PRI) != 0) {
+        epoll_events |= EPOLLPRI;
+    }
+    return epoll_events;
+}
+
+void os_poller::renew_epoll_after_fork() {
+    const int pid = static_cast<int>(getpid());
+    if (pid == m_epoll_pid) {
+        return;
+    }
+    // A forked child shares the epoll instance with its parent, so registration changes made by one would affect
+    // the other. Give the child its own instance, holding the file descriptors it inherited.
+    const int epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (epoll_fd < 0) {
+        throw std::system_error{errno, std::generic_category(), "could not create epoll instance"};
+    }
+    close(m_epoll_fd);
+    m_epoll_fd = epoll_fd;
+    m_epoll_pid = pid;
+    for (auto it = m_registrations.begin(); it != m_registrations.end();) {
+        epoll_event ev{};
+        ev.events = to_epoll_events(it->second.events);
+        ev.data.fd = it->first;
+        if (epoll_ctl(m_epoll_fd, EPOLL_CTL_ADD, it->first, &ev) < 0) {
+            // The file descriptor was closed, so there is nothing to wait for
+            it = m_registrations.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+#endif
+
+#if defined(HAVE_SELECT) && !defined(_WIN32)
+bool os_poller::drop_closed() {
+    bool dropped = false;
+    for (auto it = m_registrations.begin(); it != m_registrations.end();) {
+        if (fcntl(it->first, F_GETFD) < 0 && errno == EBADF) {
+            it = m_registrations.erase(it);
+            dropped = true;
+        } else {
+            ++it;
+        }
+    }
+    return dropped;
+}
+#endif
+
+void os_poller::watch(int fd, uint32_t events) {
+    events &= OS_POLL_IN | OS_POLL_OUT | OS_POLL_PRI;
+    auto found = m_registrations.find(fd);
+    if (found != m_registrations.end() && found->second.events == events) {
+        found->second.renewed = m_full_poll_count;
+        return;
+    }
+#ifdef HAVE_EPOLL
+    if (m_backend == os_poll_backend::epoll) {
+        renew_epoll_after_fork();
+    }
+#endif
+    auto [it, inserted] = m_registrations.try_emplace(fd);
+    registration &reg = it->second;
+    reg.renewed = m_full_poll_count;
+#ifdef HAVE_EPOLL
+    if (m_backend == os_poll_backend::epoll) {
+        epoll_event ev{};
+        ev.events = to_epoll_events(events);
+        ev.data.fd = fd;
+        int ret = epoll_ctl(m_epoll_fd, inserted ? EPOLL_CTL_ADD : EPOLL_CTL_MOD, fd, &ev);
+        if (ret < 0 && errno == ENOENT) {
+            // The file descriptor was closed without being unwatched and its number reused, so the kernel forgot it
+            ret = epoll_ctl(m_epoll_fd, EPOLL_CTL_ADD, fd, &ev);
+        }
+        if (ret < 0) {
+            const int error = errno;
+            m_registrations.erase(it);
+            if (error == EBADF) {
+                // The file descriptor was closed, so there is nothing to wait for
+                return;
+            }
+            throw std::system_error{error, std::generic_category(), "could not register file descriptor in epoll"};
+        }
+    }
+#endif
+#ifdef HAVE_SELECT
+    if (m_backend == os_poll_backend::select && fd >= FD_SETSIZE) {
+        m_registrations.erase(it);
+        throw std::runtime_error{"file descriptor exceeds the select poll backend limit, use the epoll poll backend"};
+    }
+#endif
+    reg.events = events;
+}
+
+void os_poller::unwatch(int fd) {
+    auto it = m_registrations.find(fd);
+    if (it == m_registrations.end()) {
+        return;
+    }
+    m_registrations.erase(it);
+#ifdef HAVE_EPOLL
+    if (m_backend == os_poll_backend::epoll) {
+        renew_epoll_after_fork();
+        // The file descriptor may already be closed, in which case the kernel already forgot it
+        epoll_ctl(m_epoll_fd, EPOLL_CTL_DEL, fd, nullptr);
+    }
+#endif
+}
+
+uint32_t os_poller::get_ready(int fd) const {
+    auto it = m_registrations.find(fd);
+    if (it == m_registrations.end() || it->second.ready_poll != m_poll_count) {
+        return 0;
+    }
+    return it->second.ready;
+}
+
+int os_poller::wait(uint64_t timeout_us) {
+#ifdef HAVE_EPOLL
+    if (m_backend == os_poll_backend::epoll) {
+        renew_epoll_after_fork();
+        // Round up, so we never wake up before the deadline
+        const uint64_t timeout_ms = std::min<uint64_t>((timeout_us + 999) / 1000, INT_MAX);
+        std::array<epoll_event, OS_POLL_MAX_EVENTS> events{};
+        const int ret = epoll_wait(m_epoll_fd, events.data(), static_cast<int>(events.size()),
+            static_cast<int>(timeout_ms));
+        for (int i = 0; i < ret; ++i) {
+            auto it = m_registrations.find(events[i].data.fd);
+            if (it == m_registrations.end()) {
+                continue;
+            }
+            registration &reg = it->second;
+            uint32_t ready = 0;
+            if ((events[i].events & EPOLLIN) != 0) {
+                ready |= OS_POLL_IN;
+            }
+            if ((events[i].events & EPOLLOUT) != 0) {
+                ready |= OS_POLL_OUT;
+            }
+            if ((events[i].events & EPOLLPRI) != 0) {
+                ready |= OS_POLL_PRI;
+            }
+            if ((events[i].events & (EPOLLERR | EPOLLHUP)) != 0) {
+                // Like select(), report errors as readiness for the events waited for,
+                // so users find about them on their next read or write
+                ready |= reg.events & (OS_POLL_IN | OS_POLL_OUT);
+            }
+            if ((events[i].events & EPOLLERR) != 0) {
+                ready |= OS_POLL_ERR;
+            }
+            if ((events[i].events & EPOLLHUP) != 0) {
+                ready |= OS_POLL_HUP;
+            }
+            reg.ready = ready;
+            reg.ready_poll = m_poll_count;
+        }
+        return ret;
+    }
+#endif
 #ifdef HAVE_SELECT
     fd_set readfds{};
     fd_set writefds{};
@@ -729,25 +1049,76 @@ bool os_select_fds(const os_select_before_callback &before_cb, const os_select_a
     FD_ZERO(&readfds);
     FD_ZERO(&writefds);
     FD_ZERO(&exceptfds);
-    fds.readfds = &readfds;
-    fds.writefds = &writefds;
-    fds.exceptfds = &exceptfds;
-    // Fill fds
-    before_cb(&fds, timeout_us);
-    // Configure timeout
+    int maxfd = -1;
+    for (const auto &[fd, reg] : m_registrations) {
+        if ((reg.events & OS_POLL_IN) != 0) {
+            FD_SET(fd, &readfds);
+        }
+        if ((reg.events & OS_POLL_OUT) != 0) {
+            FD_SET(fd, &writefds);
+        }
+        if ((reg.events & OS_POLL_PRI) != 0) {
+            FD_SET(fd, &exceptfds);
+        }
+        maxfd = std::max(maxfd, fd);
+    }
     timeval tv{};
-    tv.tv_sec = static_cast<decltype(tv.tv_sec)>(*timeout_us / 1000000);
-    tv.tv_usec = static_cast<decltype(tv.tv_usec)>(*timeout_us % 1000000);
-    // Wait for events
-    const int select_ret = select(fds.maxfd + 1, &readfds, &writefds, &exceptfds, &tv);
-    return after_cb(select_ret, &fds);
+    tv.tv_sec = static_cast<decltype(tv.tv_sec)>(timeout_us / 1000000);
+    tv.tv_usec = static_cast<decltype(tv.tv_usec)>(timeout_us % 1000000);
+    const int ret = select(maxfd + 1, &readfds, &writefds, &exceptfds, &tv);
+#ifndef _WIN32
+    if (ret < 0 && errno == EBADF && drop_closed()) {
+        // A single closed file descriptor fails the whole select(), so wait again without it
+        return wait(timeout_us);
+    }
+#endif
+    if (ret > 0) {
+        for (auto &[fd, reg] : m_registrations) {
+            uint32_t ready = 0;
+            if (FD_ISSET(fd, &readfds)) {
+                ready |= OS_POLL_IN;
+            }
+            if (FD_ISSET(fd, &writefds)) {
+                ready |= OS_POLL_OUT;
+            }
+            if (FD_ISSET(fd, &exceptfds)) {
+                ready |= OS_POLL_PRI;
+            }
+            if (ready != 0) {
+                reg.ready = ready;
+                reg.ready_poll = m_poll_count;
+            }
+        }
+    }
+    return ret;
 #else
     // Act like select failed
-    before_cb(&fds, timeout_us);
-    const int select_ret = -1;
+    (void) timeout_us;
+    return -1;
 #endif
+}
+
+bool os_poller::poll(const os_poll_before_callback &before_cb, const os_poll_after_callback &after_cb,
+    uint64_t *timeout_us, bool full) {
+    // Renew interest in file descriptors
+    before_cb(this, timeout_us);
+    if (full) {
+        // Drop registrations nobody renewed
+        for (auto it = m_registrations.begin(); it != m_registrations.end();) {
+            const int fd = it->first;
+            const bool stale = it->second.renewed != m_full_poll_count;
+            ++it;
+            if (stale) {
+                unwatch(fd);
+            }
+        }
+        ++m_full_poll_count;
+    }
+    // Wait for events
+    ++m_poll_count;
+    const int poll_ret = wait(*timeout_us);
     // Process ready fds
-    return after_cb(select_ret, &fds);
+    return after_cb(poll_ret, this);
 }
 
 void os_disable_sigpipe() {
@@ -769,17 +1140,10 @@ void os_sleep_us(uint64_t timeout_us) {
     }
 #ifdef HAVE_SELECT
     // Select without fds just to sleep
-    os_select_fds(
-        [](select_fd_sets *fds, const uint64_t *timeout_us) -> void {
-            (void) fds;
-            (void) timeout_us;
-        },
-        [](int select_ret, select_fd_sets *fds) -> bool {
-            (void) select_ret;
-            (void) fds;
-            return false;
-        },
-        &timeout_us);
+    timeval tv{};
+    tv.tv_sec = static_cast<decltype(tv.tv_sec)>(timeout_us / 1000000);
+    tv.tv_usec = static_cast<decltype(tv.tv_usec)>(timeout_us % 1000000);
+    select(0, nullptr, nullptr, nullptr, &tv);
 #elif defined(HAVE_USLEEP)
     usleep(static_cast<useconds_t>(*timeout_us));
 #elif defined(_WIN32)
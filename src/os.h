@@ -19,6 +19,7 @@
 
 #include <cstdint>
 #include <functional>
+#include <unordered_map>
 
 /// \file
 /// \brief System-specific OS handling operations
@@ -33,12 +34,102 @@ enum TTY_constants : uint32_t {
     TTY_CTRL_D = 4,        ///< End of session character (Ctrl+D)
 };
 
-/// \brief Set of file descriptions to be polled with select().
-struct select_fd_sets {
-    int maxfd;
-    void *readfds;
-    void *writefds;
-    void *exceptfds;
+/// \brief Backends used to wait for events on host file descriptors
+enum class os_poll_backend {
+    automatic, ///< Best backend available in the host
+    select,    ///< Portable select(), which rebuilds its file descriptor sets on every poll
+    epoll,     ///< Linux epoll, which keeps file descriptor registrations in the kernel across polls
+};
+
+/// \brief Events waited for on host file descriptors
+enum os_poll_event : uint32_t {
+    OS_POLL_IN = 1,   ///< Data available for reading
+    OS_POLL_OUT = 2,  ///< Ready for writing
+    OS_POLL_PRI = 4,  ///< Urgent data available for reading
+    OS_POLL_ERR = 8,  ///< Error condition (only reported, never waited for)
+    OS_POLL_HUP = 16, ///< Peer hung up (only reported, never waited for)
+};
+
+class os_poller;
+
+// Callbacks used by os_poller::poll().
+using os_poll_before_callback = std::function<void(os_poller *poller, uint64_t *timeout_us)>;
+using os_poll_after_callback = std::function<bool(int poll_ret, os_poller *poller)>;
+
+/// \brief Waits for events on host file descriptors
+/// \details Registrations persist across polls, so renewing interest in a file descriptor is only a table lookup,
+/// and the epoll backend only makes system calls when interest changes. Full polls drop registrations that were
+/// not renewed since the previous full poll, so users simply stop renewing interest in file descriptors they no
+/// longer care about. File descriptors should be unwatched before they are closed, because the kernel forgets
+/// closed file descriptors and their numbers may be reused. Registrations the poller finds closed are dropped.
+/// A forked child gets its own epoll instance on its first use of the poller.
+class os_poller final {
+public:
+    /// \brief Constructor
+    /// \param backend Backend used to wait for events
+    explicit os_poller(os_poll_backend backend);
+    ~os_poller();
+    os_poller(const os_poller &other) = delete;
+    os_poller(os_poller &&other) = delete;
+    os_poller &operator=(const os_poller &other) = delete;
+    os_poller &operator=(os_poller &&other) = delete;
+
+    /// \brief Returns the backend actually in use
+    os_poll_backend get_backend() const {
+        return m_backend;
+    }
+
+    /// \brief Registers or renews interest in events on a file descriptor
+    /// \param fd File descriptor
+    /// \param events Events to wait for, see os_poll_event
+    void watch(int fd, uint32_t events);
+
+    /// \brief Removes the registration of a file descriptor
+    /// \param fd File descriptor
+    void unwatch(int fd);
+
+    /// \brief Returns events ready on a file descriptor in the most recent poll
+    /// \param fd File descriptor
+    /// \returns Ready events, see os_poll_event
+    uint32_t get_ready(int fd) const;
+
+    /// \brief Polls file descriptors for events.
+    /// \param before_cb Callback called before waiting, to register or renew interest in file descriptors.
+    /// \param after_cb Callback called after waiting, to process ready file descriptors.
+    /// \param timeout_us Maximum amount of time in microseconds to wait for an event,
+    /// this value may be updated in case a before_cb() has an deadline timer before the timeout.
+    /// \param full True if all users of the poller take part in this poll, so it can drop stale registrations.
+    /// \returns Value returned by after_cb().
+    bool poll(const os_poll_before_callback &before_cb, const os_poll_after_callback &after_cb, uint64_t *timeout_us,
+        bool full = true);
+
+private:
+    /// \brief Registration of a file descriptor
+    struct registration {
+        uint32_t events{0};     ///< Events waited for
+        uint32_t ready{0};      ///< Events ready in poll number ready_poll
+        uint64_t renewed{0};    ///< Number of the full poll in which interest was last renewed
+        uint64_t ready_poll{0}; ///< Number of the poll that set ready
+    };
+
+    /// \brief Waits for events on all registered file descriptors
+    /// \returns Number of ready file descriptors, 0 on timeout, or -1 on error.
+    int wait(uint64_t timeout_us);
+
+    /// \brief Replaces the epoll instance inherited from the parent process after a fork, registering all
+    /// file descriptors again
+    void renew_epoll_after_fork();
+
+    /// \brief Drops registrations of closed file descriptors
+    /// \returns True if any registration was dropped
+    bool drop_closed();
+
+    os_poll_backend m_backend;                               ///< Backend in use
+    int m_epoll_fd{-1};                                      ///< Epoll instance, when using the epoll backend
+    int m_epoll_pid{-1};                                     ///< Process that created the epoll instance
+    uint64_t m_full_poll_count{1};                           ///< Number of full polls, to detect stale registrations
+    uint64_t m_poll_count{1};                                ///< Number of polls, to detect stale ready events
+    std::unordered_map<int, registration> m_registrations{}; ///< Registered file descriptors
 };
 
 /// \brief Initialize console
@@ -47,15 +138,15 @@ void os_open_tty(void);
 /// \brief Cleanup console initialization
 void os_close_tty(void);
 
-/// \brief Fill file descriptors to be polled by select() with TTY's file descriptors.
-/// \param fds Pointer to sets of read, write and except file descriptors to be updated.
-void os_prepare_tty_select(select_fd_sets *fds);
+/// \brief Register TTY's file descriptors to be polled.
+/// \param poller Poller to register file descriptors in.
+void os_prepare_tty_select(os_poller *poller);
 
-/// \brief Poll TTY's file descriptors that were marked as ready by select().
-/// \param select_ret Return value from the most recent select() call.
-/// \param fds Pointer to sets of read, write and except file descriptors to be checked.
+/// \brief Poll TTY's file descriptors that were marked as ready.
+/// \param select_ret Return value from the most recent poll.
+/// \param poller Poller holding ready file descriptors.
 /// \returns True if there are pending TTY characters available to be read, false otherwise.
-bool os_poll_selected_tty(int select_ret, select_fd_sets *fds);
+bool os_poll_selected_tty(int select_ret, const os_poller *poller);
 
 /// \brief Polls console for input characters
 /// \param wait Timeout to wait for characters in microseconds
@@ -94,6 +185,24 @@ unsigned char *os_map_file(const char *path, uint64_t length, bool shared);
 /// \brief Unmaps a file from memory
 void os_unmap_file(unsigned char *host_memory, uint64_t length);
 
+/// \brief Maps a named shared memory segment to memory
+/// \param name Name of segment
+/// \param length Length of segment
+/// \param create If true, creates a new segment, failing if the name is taken. Otherwise, the segment must exist and
+/// have the given length.
+/// \returns Pointer to host memory, which must be released with os_unmap_file
+unsigned char *os_map_shared_memory(const char *name, uint64_t length, bool create);
+
+/// \brief Removes the name of a shared memory segment, which is destroyed once no longer mapped
+void os_unlink_shared_memory(const char *name);
+
+/// \brief Asks the host to back a memory region with transparent huge pages
+/// \param host_memory Start of region
+/// \param length Length of region
+/// \returns True if the host accepted the advice, false if huge pages are unavailable or the region is too small
+/// \details Only the part of the region that is aligned to the huge page size is affected.
+bool os_advise_huge_pages(unsigned char *host_memory, uint64_t length);
+
 /// \brief Get time elapsed since its first call with microsecond precision
 int64_t os_now_us();
 
@@ -129,18 +238,6 @@ private:
 /// \return True if all thread tasks succeeded
 bool os_parallel_for(uint64_t n, const std::function<bool(uint64_t j, const parallel_for_mutex &mutex)> &task);
 
-// Callbacks used by os_select_fds().
-using os_select_before_callback = std::function<void(select_fd_sets *fds, uint64_t *timeout_us)>;
-using os_select_after_callback = std::function<bool(int select_ret, select_fd_sets *fds)>;
-
-/// \brief Poll file descriptions for events.
-/// \param before_cb Callback called before calling select().
-/// \param after_cb Callback called after calling select().
-/// \param timeout_us Maximum amount of time in microseconds to wait for an event,
-/// this value may be updated in case a before_cb() has an deadline timer before the timeout.
-bool os_select_fds(const os_select_before_callback &before_cb, const os_select_after_callback &after_cb,
-    uint64_t *timeout_us);
-
 /// \brief Disable sigpipe
 void os_disable_sigpipe();
 
@@ -0,0 +1,177 @@
+// Copyright Cartesi and individual authors (see AUTHORS)
+// SPDX-License-Identifier: LGPL-3.0-or-later
+//
+// This program is free software: you can redistribute it and/or modify it under
+// the terms of the GNU Lesser General Public License as published by the Free
+// Software Foundation, either version 3 of the License, or (at your option) any
+// later version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+// PARTICULAR PURPOSE. See the GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License along
+// with this program (see COPYING). If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef PAGE_WALK_CACHE_H
+#define PAGE_WALK_CACHE_H
+
+/// \file
+/// \brief Page-walk cache.
+
+#include <array>
+#include <cstdint>
+
+#include "strict-aliasing.h"
+
+namespace cartesi {
+
+/// \brief Page-walk cache constants
+enum PWC_constants : uint64_t {
+    PWC_SIZE = 64,                  ///< Number of entries of each kind (must be a power of 2)
+    PWC_MAX_LEVELS = 4,             ///< Maximum number of PTEs per entry (Sv57 walks have 5 levels)
+    PWC_INVALID_VPN = UINT64_C(-1), ///< Marks an invalid entry (vaddr >> PWC_VPN_SHIFT never reaches it)
+    PWC_VPN_SHIFT = 21,             ///< Virtual address bits translated by the last-level page table
+};
+
+/// \brief Non-architectural cache of the page table entries visited by recent page walks.
+/// \details Two kinds of entries are kept, both keyed by satp and by the virtual page number bits above the last
+/// level. Table entries yield the physical address of the last-level page table, so the walk only has to read the
+/// leaf PTE. Superpage entries yield the translation itself for megapages and gigapages, so there is no walk at all.
+/// Superpages are cached in 2MiB slices, and only for walks that would not update the A and D bits of the leaf PTE.
+/// Their key also includes everything besides the PTEs that the permission checks depend on.
+///
+/// Each entry remembers where in host memory the PTEs it skips live and what they contained when the entry was
+/// filled. A hit requires all of them to be unchanged, so stores to page tables by the guest, by devices, or by the
+/// host can never produce a translation that differs from a full walk. Host pointers are only stable while the PMAs
+/// are, so the cache must be flushed whenever a memory range is replaced.
+class page_walk_cache {
+    struct entry {
+        uint64_t satp;                                              ///< Value of satp used by the walk
+        uint64_t vpn;                                               ///< Virtual address shifted right by PWC_VPN_SHIFT
+        uint64_t access;                                            ///< Permission check inputs (superpages only)
+        uint64_t target;                                            ///< Last-level page table or superpage address
+        uint64_t vaddr_mask;                                        ///< Superpage offset mask (superpages only)
+        uint64_t count;                                             ///< Number of PTEs skipped by a hit
+        std::array<const unsigned char *, PWC_MAX_LEVELS> pte_hptr; ///< Host pointers to PTEs
+        std::array<uint64_t, PWC_MAX_LEVELS> pte;                   ///< Values of PTEs
+    };
+
+    std::array<entry, PWC_SIZE> m_tables{};
+    std::array<entry, PWC_SIZE> m_superpages{};
+
+    static uint64_t get_entry_index(uint64_t vpn) {
+        return vpn & (PWC_SIZE - 1);
+    }
+
+    static bool is_unchanged(const entry &e) {
+        for (uint64_t i = 0; i < e.count; ++i) {
+            if (aliased_aligned_read<uint64_t>(e.pte_hptr[i]) != e.pte[i]) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    static void fill(entry &e, uint64_t satp, uint64_t vpn, uint64_t count, const unsigned char *const *pte_hptr,
+        const uint64_t *pte) {
+        e.satp = satp;
+        e.vpn = vpn;
+        e.count = count;
+        for (uint64_t i = 0; i < count; ++i) {
+            e.pte_hptr[i] = pte_hptr[i];
+            e.pte[i] = pte[i];
+        }
+    }
+
+public:
+    page_walk_cache() {
+        flush();
+    }
+
+    /// \brief Looks up the last-level page table for a virtual address.
+    /// \param satp Current value of satp.
+    /// \param vaddr Virtual address being translated.
+    /// \param table_addr Receives the physical address of the last-level page table on a hit.
+    /// \returns True on a hit, false otherwise.
+    bool lookup(uint64_t satp, uint64_t vaddr, uint64_t &table_addr) const {
+        const uint64_t vpn = vaddr >> PWC_VPN_SHIFT;
+        const entry &e = m_tables[get_entry_index(vpn)];
+        if (e.vpn != vpn || e.satp != satp || !is_unchanged(e)) {
+            return false;
+        }
+        table_addr = e.target;
+        return true;
+    }
+
+    /// \brief Records the non-leaf PTEs visited by a walk that reached the last-level page table.
+    /// \param satp Value of satp used by the walk.
+    /// \param vaddr Virtual address being translated.
+    /// \param count Number of non-leaf PTEs visited.
+    /// \param pte_hptr Host pointers to the non-leaf PTEs.
+    /// \param pte Values of the non-leaf PTEs.
+    /// \param table_addr Physical address of the last-level page table.
+    void insert(uint64_t satp, uint64_t vaddr, uint64_t count, const unsigned char *const *pte_hptr,
+        const uint64_t *pte, uint64_t table_addr) {
+        if (count > PWC_MAX_LEVELS) {
+            return;
+        }
+        const uint64_t vpn = vaddr >> PWC_VPN_SHIFT;
+        entry &e = m_tables[get_entry_index(vpn)];
+        fill(e, satp, vpn, count, pte_hptr, pte);
+        e.target = table_addr;
+    }
+
+    /// \brief Looks up the translation of a virtual address that falls in a superpage.
+    /// \param satp Current value of satp.
+    /// \param vaddr Virtual address being translated.
+    /// \param access Inputs of the permission checks other than the PTEs.
+    /// \param paddr Receives the physical address on a hit.
+    /// \returns True on a hit, false otherwise.
+    bool lookup_superpage(uint64_t satp, uint64_t vaddr, uint64_t access, uint64_t &paddr) const {
+        const uint64_t vpn = vaddr >> PWC_VPN_SHIFT;
+        const entry &e = m_superpages[get_entry_index(vpn)];
+        if (e.vpn != vpn || e.satp != satp || e.access != access || !is_unchanged(e)) {
+            return false;
+        }
+        paddr = (vaddr & e.vaddr_mask) | (e.target & ~e.vaddr_mask);
+        return true;
+    }
+
+    /// \brief Records the PTEs visited by a walk that ended in a superpage leaf PTE.
+    /// \param satp Value of satp used by the walk.
+    /// \param vaddr Virtual address being translated.
+    /// \param access Inputs of the permission checks other than the PTEs.
+    /// \param count Number of PTEs visited, including the leaf.
+    /// \param pte_hptr Host pointers to the PTEs.
+    /// \param pte Values of the PTEs.
+    /// \param ppn Physical address of the superpage.
+    /// \param vaddr_mask Mask of the superpage offset bits.
+    void insert_superpage(uint64_t satp, uint64_t vaddr, uint64_t access, uint64_t count,
+        const unsigned char *const *pte_hptr, const uint64_t *pte, uint64_t ppn, uint64_t vaddr_mask) {
+        if (count > PWC_MAX_LEVELS) {
+            return;
+        }
+        const uint64_t vpn = vaddr >> PWC_VPN_SHIFT;
+        entry &e = m_superpages[get_entry_index(vpn)];
+        fill(e, satp, vpn, count, pte_hptr, pte);
+        e.access = access;
+        e.target = ppn;
+        e.vaddr_mask = vaddr_mask;
+    }
+
+    /// \brief Invalidates all entries.
+    void flush() {
+        for (auto &e : m_tables) {
+            e.vpn = PWC_INVALID_VPN;
+        }
+        for (auto &e : m_superpages) {
+            e.vpn = PWC_INVALID_VPN;
+        }
+    }
+};
+
+} // namespace cartesi
+
+#endif
@@ -0,0 +1,137 @@
+// Copyright Cartesi and individual authors (see AUTHORS)
+// SPDX-License-Identifier: LGPL-3.0-or-later
+//
+// This program is free software: you can redistribute it and/or modify it under
+// the terms of the GNU Lesser General Public License as published by the Free
+// Software Foundation, either version 3 of the License, or (at your option) any
+// later version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+// PARTICULAR PURPOSE. See the GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License along
+// with this program (see COPYING). If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef PMA_LOOKUP_TABLE_H
+#define PMA_LOOKUP_TABLE_H
+
+/// \file
+/// \brief Fast lookup of the PMA entry covering a physical address.
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace cartesi {
+
+/// \brief Table of PMA ranges sorted by start address.
+/// \details Searching a container of PMAs linearly returns the first entry, in container order, that covers the
+/// access, stopping at the first empty entry (the sentinel). The table returns the same entry with a branchless
+/// binary search over the start addresses. It must be rebuilt whenever the container changes. If the ranges in the
+/// container overlap, the first covering entry is not necessarily the one with the closest start address, so the
+/// table falls back to the linear search.
+class pma_lookup_table {
+    /// \brief Range of a PMA in the table
+    struct range {
+        uint64_t start;  ///< Start of range
+        uint64_t length; ///< Length of range
+        int index;       ///< Index of PMA entry in the container
+    };
+
+    std::vector<uint64_t> m_starts; ///< Start addresses, in increasing order
+    std::vector<range> m_ranges;    ///< Ranges, in the same order as m_starts
+    bool m_linear{true};            ///< True if lookups must search the container linearly
+
+    template <typename T>
+    static T &deref(T &t) {
+        return t;
+    }
+
+    template <typename T>
+    static T &deref(T *t) {
+        return *t;
+    }
+
+    template <typename CONTAINER>
+    static int find_linear(const CONTAINER &pmas, uint64_t paddr, uint64_t length) {
+        int index = 0;
+        for (const auto &p : pmas) {
+            const auto &pma = deref(p);
+            // Stop at first empty PMA
+            if (pma.get_length() == 0) {
+                return -1;
+            }
+            // Check if data is in range
+            if (paddr >= pma.get_start() && pma.get_length() >= length &&
+                paddr - pma.get_start() <= pma.get_length() - length) {
+                return index;
+            }
+            ++index;
+        }
+        return -1;
+    }
+
+public:
+    /// \brief Rebuilds the table from a container of PMAs.
+    /// \param pmas Container of PMA entries or of pointers to PMA entries.
+    template <typename CONTAINER>
+    void rebuild(const CONTAINER &pmas) {
+        m_starts.clear();
+        m_ranges.clear();
+        int index = 0;
+        for (const auto &p : pmas) {
+            const auto &pma = deref(p);
+            // Entries past the first empty PMA are never reached by the linear search
+            if (pma.get_length() == 0) {
+                break;
+            }
+            m_ranges.push_back(range{pma.get_start(), pma.get_length(), index});
+            ++index;
+        }
+        std::sort(m_ranges.begin(), m_ranges.end(), [](const range &a, const range &b) { return a.start < b.start; });
+        m_linear = false;
+        for (size_t i = 1; i < m_ranges.size(); ++i) {
+            if (m_ranges[i].start - m_ranges[i - 1].start < m_ranges[i - 1].length) {
+                m_linear = true;
+            }
+        }
+        for (const auto &r : m_ranges) {
+            m_starts.push_back(r.start);
+        }
+    }
+
+    /// \brief Finds the PMA entry covering a physical memory region.
+    /// \param pmas Container of PMAs the table was last built from.
+    /// \param paddr Start of physical memory region.
+    /// \param length Length of physical memory region.
+    /// \returns Index of the entry in the container, or -1 if no entry covers the region.
+    template <typename CONTAINER>
+    int find(const CONTAINER &pmas, uint64_t paddr, uint64_t length) const {
+        if (m_linear) {
+            return find_linear(pmas, paddr, length);
+        }
+        size_t n = m_starts.size();
+        if (n == 0) {
+            return -1;
+        }
+        // Find the last range that starts at or before paddr
+        const uint64_t *base = m_starts.data();
+        while (n > 1) {
+            const size_t half = n / 2;
+            base = (base[half] <= paddr) ? base + half : base;
+            n -= half;
+        }
+        const range &r = m_ranges[static_cast<size_t>(base - m_starts.data())];
+        if (paddr >= r.start && r.length >= length && paddr - r.start <= r.length - length) {
+            return r.index;
+        }
+        return -1;
+    }
+};
+
+} // namespace cartesi
+
+#endif
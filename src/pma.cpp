@@ -16,6 +16,7 @@
 
 #include "pma.h"
 
+#include <algorithm>
 #include <cerrno>
 #include <cstring>
 #include <string>
@@ -36,6 +37,7 @@ void pma_memory::release(void) {
         std::free(m_host_memory); // NOLINT(cppcoreguidelines-no-malloc)
     }
     m_host_memory = nullptr;
+    m_huge_pages = false;
     m_length = 0;
 }
 
@@ -46,30 +48,37 @@ pma_memory::~pma_memory() {
 pma_memory::pma_memory(pma_memory &&other) noexcept :
     m_length{std::move(other.m_length)},
     m_host_memory{std::move(other.m_host_memory)},
-    m_mmapped{std::move(other.m_mmapped)} {
+    m_mmapped{std::move(other.m_mmapped)},
+    m_huge_pages{std::move(other.m_huge_pages)} {
     // set other to safe state
     other.m_host_memory = nullptr;
     other.m_mmapped = false;
+    other.m_huge_pages = false;
     other.m_length = 0;
 }
 
 pma_memory::pma_memory(const std::string &description, uint64_t length, const callocd &c) :
     m_length{length},
     m_host_memory{nullptr},
-    m_mmapped{false} {
-    (void) c;
+    m_mmapped{false},
+    m_huge_pages{false} {
     // use calloc to improve performance
     // NOLINTNEXTLINE(cppcoreguidelines-no-malloc, cppcoreguidelines-prefer-member-initializer)
     m_host_memory = static_cast<unsigned char *>(std::calloc(1, length));
     if (!m_host_memory) {
         throw std::runtime_error{"error allocating memory for "s + description};
     }
+    // Advise before any page is touched, so pages can be faulted in as huge pages from the start
+    if (c.huge_pages) {
+        m_huge_pages = os_advise_huge_pages(m_host_memory, length);
+    }
 }
 
 pma_memory::pma_memory(const std::string &description, uint64_t length, const mockd &m) :
     m_length{length},
     m_host_memory{nullptr},
-    m_mmapped{false} {
+    m_mmapped{false},
+    m_huge_pages{false} {
     (void) m;
     (void) description;
 }
@@ -110,7 +119,8 @@ pma_memory::pma_memory(const std::string &description, uint64_t length, const st
 pma_memory::pma_memory(const std::string &description, uint64_t length, const std::string &path, const mmapd &m) :
     m_length{length},
     m_host_memory{nullptr},
-    m_mmapped{false} {
+    m_mmapped{false},
+    m_huge_pages{false} {
     try {
         m_host_memory = os_map_file(path.c_str(), length, m.shared);
         m_mmapped = true;
@@ -124,10 +134,12 @@ pma_memory &pma_memory::operator=(pma_memory &&other) noexcept {
     // copy from other
     m_host_memory = std::move(other.m_host_memory);
     m_mmapped = std::move(other.m_mmapped);
+    m_huge_pages = std::move(other.m_huge_pages);
     m_length = std::move(other.m_length);
     // set other to safe state
     other.m_host_memory = nullptr;
     other.m_mmapped = false;
+    other.m_huge_pages = false;
     other.m_length = 0;
     return *this;
 }
@@ -171,8 +183,21 @@ void pma_entry::fill_memory(uint64_t paddr, unsigned char value, uint64_t size)
     if (!contains(paddr, size)) {
         throw std::invalid_argument{"range not contained in pma"};
     }
-    memset(get_memory().get_host_memory() + (paddr - get_start()), value, size);
-    mark_dirty_pages(paddr, size);
+    // Fill page by page, leaving alone pages that already hold the value. This is the common case when zero padding
+    // a buffer, and it saves both the writes and the rehashing of pages that would be marked dirty for no reason.
+    unsigned char *host_memory = get_memory().get_host_memory();
+    const uint64_t end = paddr + size;
+    while (paddr < end) {
+        const uint64_t page_end = std::min(end, (paddr & ~(PMA_PAGE_SIZE - 1)) + PMA_PAGE_SIZE);
+        unsigned char *chunk = host_memory + (paddr - get_start());
+        const uint64_t chunk_size = page_end - paddr;
+        // A chunk holds the value everywhere iff its first byte does and it compares equal to itself shifted by one
+        if (chunk[0] != value || memcmp(chunk, chunk + 1, chunk_size - 1) != 0) {
+            memset(chunk, value, chunk_size);
+            mark_dirty_pages(paddr, chunk_size);
+        }
+        paddr = page_end;
+    }
 }
 
 bool pma_peek_error(const pma_entry &, const machine &, uint64_t, const unsigned char **, unsigned char *) {
@@ -226,6 +251,15 @@ pma_entry make_callocd_memory_pma_entry(const std::string &description, uint64_t
         memory_peek};
 }
 
+pma_entry make_callocd_memory_pma_entry(const std::string &description, uint64_t start, uint64_t length,
+    const std::string &path, bool huge_pages) {
+    if (length == 0) {
+        throw std::invalid_argument{description + " length cannot be zero"s};
+    }
+    return pma_entry{description, start, length,
+        pma_memory{description, length, path, pma_memory::callocd{huge_pages}}, memory_peek};
+}
+
 pma_entry make_mockd_memory_pma_entry(const std::string &description, uint64_t start, uint64_t length) {
     if (length == 0) {
         throw std::invalid_argument{description + " length cannot be zero"s};
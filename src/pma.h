@@ -95,6 +95,7 @@ class pma_memory final {
     uint64_t m_length;            ///< Length of memory range (copy of PMA length field).
     unsigned char *m_host_memory; ///< Start of associated memory region in host.
     bool m_mmapped;               ///< True if memory was mapped from a file.
+    bool m_huge_pages;            ///< True if the host agreed to back memory with huge pages.
 
     /// \brief Close file and/or release memory.
     void release(void);
@@ -112,8 +113,10 @@ public:
     /// \param m Mmap'd range data (shared or not).
     pma_memory(const std::string &description, uint64_t length, const std::string &path, const mmapd &m);
 
-    /// \brief Calloc'd range data (just a tag).
-    struct callocd {};
+    /// \brief Calloc'd range data.
+    struct callocd {
+        bool huge_pages = false; ///< Ask the host to back the range with huge pages
+    };
 
     /// \brief Mock'd range data (just a tag).
     struct mockd {};
@@ -122,13 +125,13 @@ public:
     /// \param description Informative description of PMA entry for use in error messages
     /// \param length Length of range.
     /// \param path Path for backing file.
-    /// \param c Calloc'd range data (just a tag).
+    /// \param c Calloc'd range data.
     pma_memory(const std::string &description, uint64_t length, const std::string &path, const callocd &c);
 
     /// \brief Constructor for calloc'd ranges.
     /// \param description Informative description of PMA entry for use in error messages
     /// \param length Length of range.
-    /// \param c Calloc'd range data (just a tag).
+    /// \param c Calloc'd range data.
     pma_memory(const std::string &description, uint64_t length, const callocd &c);
 
     /// \brief Constructor for mock ranges.
@@ -162,6 +165,11 @@ public:
         return m_host_memory;
     }
 
+    /// \brief Returns true if the host agreed to back memory with huge pages
+    bool get_huge_pages(void) const {
+        return m_huge_pages;
+    }
+
     /// \brief Returns copy of PMA length field (needed for munmap).
     uint64_t get_length(void) const {
         return m_length;
@@ -444,7 +452,9 @@ public:
         constexpr const auto log2_page_size = PMA_constants::PMA_PAGE_SIZE_LOG2;
         uint64_t page_in_range = ((address - get_start()) >> log2_page_size) << log2_page_size;
         constexpr const auto page_size = PMA_constants::PMA_PAGE_SIZE;
-        auto npages = (size + page_size - 1) / page_size;
+        // Count pages from the one containing the first byte to the one containing the last byte, so
+        // unaligned ranges that straddle a page boundary mark both pages
+        auto npages = (address - get_start() + size - page_in_range + page_size - 1) / page_size;
         for (decltype(npages) i = 0; i < npages; ++i) {
             mark_dirty_page(page_in_range);
             page_in_range += page_size;
@@ -527,6 +537,17 @@ pma_entry make_callocd_memory_pma_entry(const std::string &description, uint64_t
 pma_entry make_callocd_memory_pma_entry(const std::string &description, uint64_t start, uint64_t length,
     const std::string &path);
 
+/// \brief Creates a PMA entry for a new memory range, optionally backed by huge pages in the host.
+/// \param description Informative description of PMA entry for use in error messages
+/// \param start Start of PMA range.
+/// \param length Length of PMA range.
+/// \param path Path to backing file, or an empty string for a range initially filled with zeros.
+/// \param huge_pages Ask the host to back the range with huge pages.
+/// \returns Corresponding PMA entry
+/// \details Whether the host agreed can be queried with pma_memory::get_huge_pages().
+pma_entry make_callocd_memory_pma_entry(const std::string &description, uint64_t start, uint64_t length,
+    const std::string &path, bool huge_pages);
+
 /// \brief Creates a PMA entry for a new memory region using the host's
 /// mmap functionality.
 /// \param description Informative description of PMA entry for use in error messages
@@ -260,7 +260,8 @@ private:
         // NOLINTBEGIN(bugprone-unchecked-optional-access)
         a.get_written_hash().emplace();
         hasher_type hasher{};
-        get_merkle_tree_hash(hasher, pma.get_memory().get_host_memory(), write_length, sizeof(uint64_t),
+        // The padding is all zeros, so only the subtrees that overlap the data need to be hashed
+        get_padded_merkle_tree_hash(hasher, data, data_length, write_length, sizeof(uint64_t),
             a.get_written_hash().value());
         if (m_log->get_log_type().has_large_data()) {
             access_data &data = a.get_written().emplace(write_length);
@@ -28,7 +28,6 @@
 #include "machine-merkle-tree.h"
 #include "machine.h"
 #include "shadow-state.h"
-#include "unique-c-ptr.h"
 
 namespace cartesi {
 
@@ -268,7 +267,7 @@ private:
         m_next_access++;
     }
 
-    void do_push_bracket(bracket_type &type, const char *text) {}
+    void do_push_bracket(bracket_type & /*type*/, const char * /*text*/) {}
 
     void do_reset_iflags_Y(void) {
         auto old_iflags = check_read_word(shadow_state_get_csr_abs_addr(shadow_state_csr::iflags), "iflags.Y");
@@ -327,15 +326,7 @@ private:
         const auto &written_hash = access.get_written_hash().value(); // NOLINT(bugprone-unchecked-optional-access)
         // compute hash of data argument padded with zeroes
         hash_type computed_data_hash{};
-        auto scratch = unique_calloc<unsigned char>(write_length, std::nothrow_t{});
-        if (!scratch) {
-            throw std::runtime_error("Could not allocate scratch memory");
-        }
-        memcpy(scratch.get(), data, data_length);
-        if (write_length > data_length) {
-            memset(scratch.get() + data_length, 0, write_length - data_length);
-        }
-        get_merkle_tree_hash(hasher, scratch.get(), write_length, sizeof(uint64_t), computed_data_hash);
+        get_padded_merkle_tree_hash(hasher, data, data_length, write_length, sizeof(uint64_t), computed_data_hash);
         // check if logged written hash matches the computed data hash
         if (written_hash != computed_data_hash) {
             throw std::invalid_argument{"logged written hash of " + text +
@@ -51,6 +51,13 @@
 #include "riscv-constants.h"
 #include "uint128.h"
 
+// The host FPU is used as a fast path only on hosts where float and double are IEEE 754 binary32 and binary64
+// evaluated without excess precision, and never in the microarchitecture, which has no FPU
+#if !defined(MICROARCHITECTURE) && (defined(__x86_64__) || defined(__aarch64__))
+#define SOFT_FLOAT_HOST_FPU
+#include <cstring>
+#endif
+
 namespace cartesi {
 
 /// \brief Returns the number of leading 0-bits in x, starting at the most significant bit position.
@@ -326,8 +333,72 @@ struct i_sfloat {
         return a_exp == EXP_MASK && a_mant != 0;
     }
 
+#ifdef SOFT_FLOAT_HOST_FPU
+    /// \brief Host floating-point type with the same binary representation.
+    using H_FLOAT = std::conditional_t<sizeof(F_UINT) == sizeof(float), float, double>;
+
+    /// \brief Reinterprets a float binary representation as a host float.
+    static inline H_FLOAT to_host(F_UINT a) {
+        H_FLOAT h{};
+        memcpy(&h, &a, sizeof(h));
+        return h;
+    }
+
+    /// \brief Reinterprets a host float as a float binary representation.
+    static inline F_UINT from_host(H_FLOAT h) {
+        F_UINT a{};
+        memcpy(&a, &h, sizeof(a));
+        return a;
+    }
+
+    /// \brief Checks if the host FPU is in its default environment.
+    /// \details Host results only match the software implementation when the host FPU rounds to nearest even, keeps
+    /// subnormal operands and results, and does not trap. The process may have changed this with fesetround(), or
+    /// enabled flush to zero and denormals are zero the way -ffast-math does at startup, so it is checked every time.
+    static inline bool host_fpu_is_default() {
+#if defined(__x86_64__)
+        // MXCSR exception masks (bits 7-12) set, DAZ (bit 6), rounding control (bits 13-14) and FTZ (bit 15) clear
+        constexpr uint32_t MXCSR_CONTROL_MASK = 0xffc0;
+        constexpr uint32_t MXCSR_CONTROL_DEFAULT = 0x1f80;
+        return (__builtin_ia32_stmxcsr() & MXCSR_CONTROL_MASK) == MXCSR_CONTROL_DEFAULT;
+#else
+        // FPCR trap enables (bits 8-12 and 15), rounding mode (bits 22-23) and FZ (bit 24) clear
+        constexpr uint64_t FPCR_CONTROL_MASK = 0x1c09f00;
+        uint64_t fpcr = 0;
+        __asm__ volatile("mrs %0, fpcr" : "=r"(fpcr));
+        return (fpcr & FPCR_CONTROL_MASK) == 0;
+#endif
+    }
+
+    /// \brief Checks if an operation can be computed by the host FPU.
+    /// \details The host FPU is expected to be in its default round to nearest even mode, because switching modes on
+    /// every operation costs more than it saves. Operations fall back to software when it is not. Reading the host
+    /// exception flags to find out if a result is inexact would be just as costly, so the host FPU is only used once
+    /// the guest inexact flag is set and cannot change.
+    static inline bool host_can_compute(FRM_modes rm, uint32_t fflags) {
+        return rm == FRM_RNE && (fflags & FFLAGS_NX_MASK) != 0 && host_fpu_is_default();
+    }
+
+    /// \brief Checks if a result computed by the host FPU is the one the software implementation produces.
+    /// \details A finite result with magnitude above the smallest normal rules out invalid operation, division by
+    /// zero, overflow and underflow, so the only exception it can raise is inexact. Anything else, including NaNs that
+    /// must be canonicalized and results that may be tiny, is recomputed in software.
+    static inline bool host_result_is_exact(F_UINT r) {
+        const F_UINT r_abs = r & ~SIGN_MASK;
+        return r_abs > (static_cast<F_UINT>(1) << MANT_SIZE) && (r_abs >> MANT_SIZE) != EXP_MASK;
+    }
+#endif
+
     /// \brief Addition operation.
     static F_UINT add(F_UINT a, F_UINT b, FRM_modes rm, uint32_t *pfflags) {
+#ifdef SOFT_FLOAT_HOST_FPU
+        if (likely(host_can_compute(rm, *pfflags))) {
+            const F_UINT r = from_host(to_host(a) + to_host(b));
+            if (likely(host_result_is_exact(r))) {
+                return r;
+            }
+        }
+#endif
         // swap so that  abs(a) >= abs(b)
         if ((a & ~SIGN_MASK) < (b & ~SIGN_MASK)) {
             const F_UINT tmp = a;
@@ -381,6 +452,14 @@ struct i_sfloat {
 
     /// \brief Multiply operation.
     static F_UINT mul(F_UINT a, F_UINT b, FRM_modes rm, uint32_t *pfflags) {
+#ifdef SOFT_FLOAT_HOST_FPU
+        if (likely(host_can_compute(rm, *pfflags))) {
+            const F_UINT r = from_host(to_host(a) * to_host(b));
+            if (likely(host_result_is_exact(r))) {
+                return r;
+            }
+        }
+#endif
         const uint32_t a_sign = a >> (F_SIZE - 1);
         const uint32_t b_sign = b >> (F_SIZE - 1);
         const uint32_t r_sign = a_sign ^ b_sign;
@@ -429,6 +508,20 @@ struct i_sfloat {
 
     /// \brief Fused multiply and add operation.
     static F_UINT fma(F_UINT a, F_UINT b, F_UINT c, FRM_modes rm, uint32_t *pfflags) {
+        // Without a hardware fused multiply-add, the host library emulates it in software as well
+#if defined(SOFT_FLOAT_HOST_FPU) && defined(__FP_FAST_FMA) && defined(__FP_FAST_FMAF)
+        if (likely(host_can_compute(rm, *pfflags))) {
+            F_UINT r = 0;
+            if constexpr (std::is_same_v<H_FLOAT, float>) {
+                r = from_host(__builtin_fmaf(to_host(a), to_host(b), to_host(c)));
+            } else {
+                r = from_host(__builtin_fma(to_host(a), to_host(b), to_host(c)));
+            }
+            if (likely(host_result_is_exact(r))) {
+                return r;
+            }
+        }
+#endif
         const uint32_t a_sign = a >> (F_SIZE - 1);
         const uint32_t b_sign = b >> (F_SIZE - 1);
         uint32_t c_sign = c >> (F_SIZE - 1);
@@ -557,6 +650,14 @@ struct i_sfloat {
 
     /// \brief Division operation.
     static F_UINT div(F_UINT a, F_UINT b, FRM_modes rm, uint32_t *pfflags) {
+#ifdef SOFT_FLOAT_HOST_FPU
+        if (likely(host_can_compute(rm, *pfflags))) {
+            const F_UINT r = from_host(to_host(a) / to_host(b));
+            if (likely(host_result_is_exact(r))) {
+                return r;
+            }
+        }
+#endif
         const uint32_t a_sign = a >> (F_SIZE - 1);
         const uint32_t b_sign = b >> (F_SIZE - 1);
         const uint32_t r_sign = a_sign ^ b_sign;
@@ -619,6 +720,19 @@ struct i_sfloat {
 
     /// \brief Square root operation.
     static F_UINT sqrt(F_UINT a, FRM_modes rm, uint32_t *pfflags) {
+#ifdef SOFT_FLOAT_HOST_FPU
+        if (likely(host_can_compute(rm, *pfflags))) {
+            F_UINT r = 0;
+            if constexpr (std::is_same_v<H_FLOAT, float>) {
+                r = from_host(__builtin_sqrtf(to_host(a)));
+            } else {
+                r = from_host(__builtin_sqrt(to_host(a)));
+            }
+            if (likely(host_result_is_exact(r))) {
+                return r;
+            }
+        }
+#endif
         const uint32_t a_sign = a >> (F_SIZE - 1);
         int32_t a_exp = (a >> MANT_SIZE) & EXP_MASK;
         F_UINT a_mant = a & MANT_MASK;
@@ -884,7 +998,7 @@ using i_sfloat32 = i_sfloat<uint32_t, 23, 8>;  // Interface for single-precision
 using i_sfloat64 = i_sfloat<uint64_t, 52, 11>; // Interface for double-precision floating-point
 
 /// \brief Conversion from float32 to float64.
-static uint64_t sfloat_cvt_f32_f64(uint32_t a, uint32_t *pfflags) {
+static inline uint64_t sfloat_cvt_f32_f64(uint32_t a, uint32_t *pfflags) {
     uint32_t a_sign = 0;
     int32_t a_exp = 0;
     i_sfloat64::F_UINT a_mant = i_sfloat32::unpack(&a_sign, &a_exp, a);
@@ -914,7 +1028,7 @@ static uint64_t sfloat_cvt_f32_f64(uint32_t a, uint32_t *pfflags) {
 }
 
 /// \brief Conversion from float64 to float32.
-static uint32_t sfloat_cvt_f64_f32(uint64_t a, FRM_modes rm, uint32_t *pfflags) {
+static inline uint32_t sfloat_cvt_f64_f32(uint64_t a, FRM_modes rm, uint32_t *pfflags) {
     uint32_t a_sign = 0;
     int32_t a_exp = 0;
     i_sfloat64::F_UINT a_mant = i_sfloat64::unpack(&a_sign, &a_exp, a);
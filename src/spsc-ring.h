@@ -0,0 +1,86 @@
+// Copyright Cartesi and individual authors (see AUTHORS)
+// SPDX-License-Identifier: LGPL-3.0-or-later
+//
+// This program is free software: you can redistribute it and/or modify it under
+// the terms of the GNU Lesser General Public License as published by the Free
+// Software Foundation, either version 3 of the License, or (at your option) any
+// later version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+// PARTICULAR PURPOSE. See the GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License along
+// with this program (see COPYING). If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef SPSC_RING_H
+#define SPSC_RING_H
+
+/// \file
+/// \brief Lock-free ring shared by a single producer thread and a single consumer thread
+
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+namespace cartesi {
+
+/// \brief Fixed capacity lock-free FIFO with a single producer thread and a single consumer thread
+/// \tparam T Type of elements, all slots are allocated once, so elements are filled and consumed in place
+/// \details The producer fills the slot returned by back() and publishes it with push().
+/// The consumer reads the slot returned by front() and releases it with pop().
+template <typename T>
+class spsc_ring {
+public:
+    /// \brief Constructor
+    /// \param capacity Maximum number of elements in the ring
+    explicit spsc_ring(size_t capacity) : m_slots(capacity) {}
+
+    /// \brief Returns the slot for the next element, or nullptr if the ring is full (producer only)
+    T *back() {
+        const size_t tail = m_tail.load(std::memory_order_relaxed);
+        if (tail - m_head.load(std::memory_order_acquire) == m_slots.size()) {
+            return nullptr;
+        }
+        return &m_slots[tail % m_slots.size()];
+    }
+
+    /// \brief Publishes the element filled in the slot returned by back() (producer only)
+    void push() {
+        m_tail.store(m_tail.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    /// \brief Returns the oldest element, or nullptr if the ring is empty (consumer only)
+    T *front() {
+        const size_t head = m_head.load(std::memory_order_relaxed);
+        if (head == m_tail.load(std::memory_order_acquire)) {
+            return nullptr;
+        }
+        return &m_slots[head % m_slots.size()];
+    }
+
+    /// \brief Releases the slot of the oldest element back to the producer (consumer only)
+    void pop() {
+        m_head.store(m_head.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    /// \brief Returns true if the ring has no elements
+    bool empty() const {
+        return m_head.load(std::memory_order_acquire) == m_tail.load(std::memory_order_acquire);
+    }
+
+    /// \brief Returns true if the ring has no free slots
+    bool full() const {
+        return m_tail.load(std::memory_order_acquire) - m_head.load(std::memory_order_acquire) == m_slots.size();
+    }
+
+private:
+    std::vector<T> m_slots;                    ///< Preallocated slots
+    alignas(64) std::atomic<size_t> m_head{0}; ///< Number of elements popped, written by the consumer
+    alignas(64) std::atomic<size_t> m_tail{0}; ///< Number of elements pushed, written by the producer
+};
+
+} // namespace cartesi
+
+#endif
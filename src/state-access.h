@@ -20,12 +20,16 @@
 /// \file
 /// \brief Fast state access implementation
 
+#include <array>
 #include <cassert>
 
 #include "compiler-defines.h"
 #include "device-state-access.h"
+#include "execution-trace.h"
 #include "htif.h"
 #include "i-state-access.h"
+#include "machine-break-conditions.h"
+#include "machine-statistics.h"
 #include "machine.h"
 #include "os.h"
 #include "pma.h"
@@ -428,40 +432,58 @@ private:
         const bool interrupt_raised = false;
         // Only poll external interrupts if we are in unreproducible mode
         if (unlikely(do_read_iunrep())) {
-            // Convert the relative interval of cycles we can wait to the interval of host time we can wait
-            uint64_t timeout_us = (mcycle_max - mcycle) / RTC_CYCLES_PER_US;
-            int64_t start_us = 0;
-            if (timeout_us > 0) {
-                start_us = os_now_us();
-            }
             device_state_access da(*this, mcycle);
-            // Poll virtio for events (e.g console stdin, network sockets)
-            // Timeout may be decremented in case a device has deadline timers (e.g network device)
-            if (m_m.has_virtio_devices() && m_m.has_virtio_console()) { // VirtIO + VirtIO console
-                m_m.poll_virtio_devices(&timeout_us, &da);
-                // VirtIO console device will poll TTY
-            } else if (m_m.has_virtio_devices()) { // VirtIO without a console
-                m_m.poll_virtio_devices(&timeout_us, &da);
-                if (m_m.has_htif_console()) { // VirtIO + HTIF console
-                    // Poll tty without waiting more time, because the pool above should have waited enough time
-                    os_poll_tty(0);
+            auto *tracer = m_m.get_execution_tracer();
+            if (unlikely(tracer != nullptr)) {
+                if (tracer->is_replaying()) {
+                    return {tracer->replay_poll(da, mcycle, mcycle_max), interrupt_raised};
                 }
-            } else if (m_m.has_htif_console()) { // Only HTIF console
-                os_poll_tty(timeout_us);
-            } else if (timeout_us > 0) { // No interrupts to check, just keep the CPU idle
-                os_sleep_us(timeout_us);
-            }
-            // If timeout is greater than zero, we should also increment mcycle relative to the elapsed time
-            if (timeout_us > 0) {
-                const int64_t end_us = os_now_us();
-                const uint64_t elapsed_us = static_cast<uint64_t>(std::max(end_us - start_us, INT64_C(0)));
-                const uint64_t next_mcycle = mcycle + (elapsed_us * RTC_CYCLES_PER_US);
-                mcycle = std::min(std::max(next_mcycle, mcycle), mcycle_max);
+                std::vector<execution_trace_effect> effects;
+                recording_device_state_access rda(da, effects);
+                const uint64_t next_mcycle = poll_host(rda, mcycle, mcycle_max);
+                tracer->record_poll(mcycle, mcycle_max, next_mcycle, std::move(effects));
+                return {next_mcycle, interrupt_raised};
             }
+            mcycle = poll_host(da, mcycle, mcycle_max);
         }
         return {mcycle, interrupt_raised};
     }
 
+    /// \brief Polls host devices for external interrupts, possibly waiting for them.
+    /// \returns Value of mcycle advanced relative to the elapsed host time.
+    uint64_t poll_host(i_device_state_access &da, uint64_t mcycle, uint64_t mcycle_max) {
+        // Convert the relative interval of cycles we can wait to the interval of host time we can wait
+        uint64_t timeout_us = (mcycle_max - mcycle) / RTC_CYCLES_PER_US;
+        int64_t start_us = 0;
+        if (timeout_us > 0) {
+            start_us = os_now_us();
+        }
+        // Poll virtio for events (e.g console stdin, network sockets)
+        // Timeout may be decremented in case a device has deadline timers (e.g network device)
+        if (m_m.has_virtio_devices() && m_m.has_virtio_console()) { // VirtIO + VirtIO console
+            m_m.poll_virtio_devices(&timeout_us, &da);
+            // VirtIO console device will poll TTY
+        } else if (m_m.has_virtio_devices()) { // VirtIO without a console
+            m_m.poll_virtio_devices(&timeout_us, &da);
+            if (m_m.has_htif_console()) { // VirtIO + HTIF console
+                // Poll tty without waiting more time, because the pool above should have waited enough time
+                os_poll_tty(0);
+            }
+        } else if (m_m.has_htif_console()) { // Only HTIF console
+            os_poll_tty(timeout_us);
+        } else if (timeout_us > 0) { // No interrupts to check, just keep the CPU idle
+            os_sleep_us(timeout_us);
+        }
+        // If timeout is greater than zero, we should also increment mcycle relative to the elapsed time
+        if (timeout_us > 0) {
+            const int64_t end_us = os_now_us();
+            const uint64_t elapsed_us = static_cast<uint64_t>(std::max(end_us - start_us, INT64_C(0)));
+            const uint64_t next_mcycle = mcycle + (elapsed_us * RTC_CYCLES_PER_US);
+            mcycle = std::min(std::max(next_mcycle, mcycle), mcycle_max);
+        }
+        return mcycle;
+    }
+
     uint64_t do_read_pma_istart(int i) const {
         assert(i >= 0 && i < (int) PMA_MAX);
         const auto &pmas = m_m.get_pmas();
@@ -516,28 +538,30 @@ private:
         }
     }
 
+    unsigned char *do_get_host_memory(uint64_t paddr, uint64_t length, bool write) {
+        if (length == 0) {
+            return nullptr;
+        }
+        pma_entry &pma = m_m.find_pma_entry(paddr, length);
+        if (pma.get_length() == 0 || !pma.get_istart_M() || pma.get_istart_E()) {
+            return nullptr;
+        }
+        if (write) {
+            pma.mark_dirty_pages(paddr, length);
+        }
+        return pma.get_memory().get_host_memory() + (paddr - pma.get_start());
+    }
+
     template <typename T>
     pma_entry &do_find_pma_entry(uint64_t paddr) {
-        int i = 0;
-        while (true) {
-            auto &pma = m_m.get_state().pmas[i];
-            // The pmas array always contain a sentinel. It is an entry with
-            // zero length. If we hit it, return it
-            if (pma.get_length() == 0) {
-                return pma;
-            }
-            // Otherwise, if we found an entry where the access fits, return it
-            // Note the "strange" order of arithmetic operations.
-            // This is to ensure there is no overflow.
-            // Since we know paddr >= start, there is no chance of overflow
-            // in the first subtraction.
-            // Since length is at least 4096 (an entire page), there is no
-            // chance of overflow in the second subtraction.
-            if (paddr >= pma.get_start() && paddr - pma.get_start() <= pma.get_length() - sizeof(T)) {
-                return pma;
-            }
-            i++;
+        auto &pmas = m_m.get_state().pmas;
+        const int i = m_m.get_state().pmas_lookup.find(pmas, paddr, sizeof(T));
+        if (i >= 0) {
+            return pmas[i];
         }
+        // The pmas array always ends with a sentinel. It is an entry with
+        // zero length. If no entry covers the access, return it
+        return pmas.back();
     }
 
     static unsigned char *do_get_host_memory(pma_entry &pma) {
@@ -562,12 +586,20 @@ private:
 
     bool do_read_device(pma_entry &pma, uint64_t mcycle, uint64_t offset, uint64_t *pval, int log2_size) {
         device_state_access da(*this, mcycle);
+        auto *tracer = m_m.get_execution_tracer();
+        if (unlikely(tracer != nullptr) && execution_tracer::is_traced(pma)) {
+            return tracer->read_device(pma, da, mcycle, offset, pval, log2_size);
+        }
         return pma.get_device_noexcept().get_driver()->read(pma.get_device_noexcept().get_context(), &da, offset, pval,
             log2_size);
     }
 
     execute_status do_write_device(pma_entry &pma, uint64_t mcycle, uint64_t offset, uint64_t val, int log2_size) {
         device_state_access da(*this, mcycle);
+        auto *tracer = m_m.get_execution_tracer();
+        if (unlikely(tracer != nullptr) && execution_tracer::is_traced(pma)) {
+            return tracer->write_device(pma, da, mcycle, offset, val, log2_size);
+        }
         return pma.get_device_noexcept().get_driver()->write(pma.get_device_noexcept().get_context(), &da, offset, val,
             log2_size);
     }
@@ -664,6 +696,60 @@ private:
         do_flush_tlb_type<TLB_WRITE>();
     }
 
+    bool do_read_page_walk_cache(uint64_t satp, uint64_t vaddr, uint64_t &table_addr) {
+        if (m_m.get_state().pwc.lookup(satp, vaddr, table_addr)) {
+            INC_COUNTER(m_m.get_state().stats, pwc_hit);
+            return true;
+        }
+        INC_COUNTER(m_m.get_state().stats, pwc_miss);
+        return false;
+    }
+
+    /// \brief Obtains host pointers to PTEs read by a page walk
+    /// \returns False if there are too many PTEs to fit a page-walk cache entry
+    bool get_pte_host_pointers(int count, const uint64_t *pte_addr,
+        std::array<const unsigned char *, PWC_MAX_LEVELS> &pte_hptr) {
+        if (count < 0 || count > static_cast<int>(pte_hptr.size())) {
+            return false;
+        }
+        // The walk already read these PTEs, so they are known to be in readable memory
+        for (int i = 0; i < count; ++i) {
+            auto &pma = do_find_pma_entry<uint64_t>(pte_addr[i]);
+            pte_hptr[i] = do_get_host_memory(pma) + (pte_addr[i] - pma.get_start());
+        }
+        return true;
+    }
+
+    void do_write_page_walk_cache(uint64_t satp, uint64_t vaddr, int count, const uint64_t *pte_addr,
+        const uint64_t *pte, uint64_t table_addr) {
+        std::array<const unsigned char *, PWC_MAX_LEVELS> pte_hptr{};
+        if (get_pte_host_pointers(count, pte_addr, pte_hptr)) {
+            m_m.get_state().pwc.insert(satp, vaddr, static_cast<uint64_t>(count), pte_hptr.data(), pte, table_addr);
+        }
+    }
+
+    bool do_read_superpage_walk_cache(uint64_t satp, uint64_t vaddr, uint64_t access, uint64_t &paddr) {
+        if (m_m.get_state().pwc.lookup_superpage(satp, vaddr, access, paddr)) {
+            INC_COUNTER(m_m.get_state().stats, pwc_superpage_hit);
+            return true;
+        }
+        return false;
+    }
+
+    void do_write_superpage_walk_cache(uint64_t satp, uint64_t vaddr, uint64_t access, int count,
+        const uint64_t *pte_addr, const uint64_t *pte, uint64_t ppn, uint64_t vaddr_mask) {
+        std::array<const unsigned char *, PWC_MAX_LEVELS> pte_hptr{};
+        if (get_pte_host_pointers(count, pte_addr, pte_hptr)) {
+            m_m.get_state().pwc.insert_superpage(satp, vaddr, access, static_cast<uint64_t>(count), pte_hptr.data(),
+                pte, ppn, vaddr_mask);
+        }
+    }
+
+    void do_flush_page_walk_cache() {
+        m_m.get_state().pwc.flush();
+        INC_COUNTER(m_m.get_state().stats, pwc_flush);
+    }
+
     bool do_get_soft_yield() {
         return m_m.get_state().soft_yield;
     }
@@ -683,6 +769,59 @@ private:
         }
     }
 
+    bool do_has_break_conditions() const {
+        return m_m.get_break_condition_monitor() != nullptr;
+    }
+
+    bool do_check_breakpoint(uint64_t pc, uint64_t mcycle) {
+        return m_m.get_break_condition_monitor()->check_breakpoint(pc, mcycle);
+    }
+
+    bool do_is_breakpoint_page(uint64_t vaddr_page) const {
+        return m_m.get_break_condition_monitor()->is_breakpoint_page(vaddr_page);
+    }
+
+    bool do_check_memory_access(uint64_t vaddr, uint64_t paddr, uint64_t length, bool write) {
+        return m_m.get_break_condition_monitor()->check_memory_access(vaddr, paddr, length, write);
+    }
+
+    template <TLB_entry_type ETYPE>
+    void do_check_memory_access_via_tlb(uint64_t vaddr, uint64_t length) {
+        auto *monitor = m_m.get_break_condition_monitor();
+        const uint64_t eidx = tlb_get_entry_index(vaddr);
+        if (monitor->is_tlb_entry_watched(ETYPE, eidx)) {
+            const tlb_cold_entry &tlbce = m_m.get_state().tlb.cold[ETYPE][eidx];
+            const uint64_t paddr = tlbce.paddr_page | (vaddr & PAGE_OFFSET_MASK);
+            monitor->check_memory_access(vaddr, paddr, length, ETYPE == TLB_WRITE);
+        }
+    }
+
+    template <TLB_entry_type ETYPE>
+    void do_set_tlb_entry_watched(uint64_t eidx, bool watched) {
+        m_m.get_break_condition_monitor()->set_tlb_entry_watched(ETYPE, eidx, watched);
+    }
+
+    bool do_check_break_conditions(uint64_t pc, uint64_t mcycle) {
+        return m_m.get_break_condition_monitor()->check_after_insn(m_m, pc, mcycle);
+    }
+
+    bool do_is_break_condition_reached() const {
+        auto *monitor = m_m.get_break_condition_monitor();
+        return monitor != nullptr && monitor->is_reached();
+    }
+
+    bool do_has_profiler() const {
+        return m_m.get_profiler() != nullptr;
+    }
+
+    void do_profile_insn(uint64_t pc, uint64_t mcycle, uint32_t insn) {
+        m_m.get_profiler()->on_insn(pc, mcycle, insn);
+    }
+
+    void do_profile_trap(uint64_t cause) {
+        m_m.get_profiler()->on_trap(cause);
+    }
+
 #ifdef DUMP_COUNTERS
     machine_statistics &do_get_statistics() {
         return m_m.get_state().stats;
@@ -43,9 +43,11 @@
 #ifndef TRANSLATE_VIRTUAL_ADDRESS_H
 #define TRANSLATE_VIRTUAL_ADDRESS_H
 
+#include <array>
 #include <cstdint>
 
 #include "compiler-defines.h"
+#include "page-walk-cache.h"
 #include "riscv-constants.h"
 
 namespace cartesi {
@@ -95,46 +97,19 @@ static inline bool read_ram_uint64(STATE_ACCESS &a, uint64_t paddr, uint64_t *pv
 /// \tparam STATE_ACCESS Class of machine state accessor object.
 /// \tparam UPDATE_PTE Whether PTE entries can be modified during the translation.
 /// \param a Machine state accessor object.
-/// \param vaddr Virtual address
 /// \param ppaddr Pointer to physical address.
+/// \param vaddr Virtual address
 /// \param xwr_shift Encodes the access mode by the shift to the XWR triad (PTE_XWR_R_SHIFT,
 ///  PTE_XWR_R_SHIFT, or PTE_XWR_R_SHIFT)
+/// \param priv Effective privilege level of the access (PRV_S or PRV_U).
+/// \param mstatus Value of the mstatus register.
+/// \param satp Value of the satp register, in sv39, sv48 or sv57 mode.
 /// \details This function is outlined to minimize host CPU code cache pressure.
 /// \returns True if succeeded, false otherwise.
-template <typename STATE_ACCESS, bool UPDATE_PTE = true>
-static NO_INLINE bool translate_virtual_address(STATE_ACCESS &a, uint64_t *ppaddr, uint64_t vaddr, int xwr_shift) {
-    auto priv = a.read_iflags_PRV();
-    const uint64_t mstatus = a.read_mstatus();
-
-    // When MPRV is set, data loads and stores use privilege in MPP
-    // instead of the current privilege level (code access is unaffected)
-    if (xwr_shift != PTE_XWR_X_SHIFT && (mstatus & MSTATUS_MPRV_MASK)) {
-        priv = (mstatus & MSTATUS_MPP_MASK) >> MSTATUS_MPP_SHIFT;
-    }
-
-    // The satp register is considered active when the effective privilege mode is S-mode or U-mode.
-    // Executions of the address-translation algorithm may only begin using a given value of satp when
-    // satp is active.
-    if (unlikely(priv > PRV_S)) {
-        // We are in M-mode (or in HS-mode if Hypervisor extension is active)
-        *ppaddr = vaddr;
-        return true;
-    }
-
-    const uint64_t satp = a.read_satp();
-
+template <typename STATE_ACCESS, bool UPDATE_PTE>
+static NO_INLINE bool walk_page_table(STATE_ACCESS &a, uint64_t *ppaddr, uint64_t vaddr, int xwr_shift, int priv,
+    uint64_t mstatus, uint64_t satp) {
     const uint64_t mode = satp >> SATP_MODE_SHIFT;
-    switch (mode) {
-        case SATP_MODE_BARE: // Bare: No translation or protection
-            *ppaddr = vaddr;
-            return true;
-        case SATP_MODE_SV39: // Sv39: Page-based 39-bit virtual addressing
-        case SATP_MODE_SV48: // Sv48: Page-based 48-bit virtual addressing
-        case SATP_MODE_SV57: // Sv57: Page-based 57-bit virtual addressing
-            break;
-        default: // Unsupported mode
-            return false;
-    }
     // Here we know we are in sv39, sv48 or sv57 modes
 
     // Page table hierarchy of sv39 has 3 levels, sv48 has 4 levels,
@@ -154,9 +129,25 @@ static NO_INLINE bool translate_virtual_address(STATE_ACCESS &a, uint64_t *ppadd
         return false;
     }
 
+    // Besides the PTEs, the permission checks only depend on these
+    const uint64_t access = (mstatus & (MSTATUS_SUM_MASK | MSTATUS_MXR_MASK)) | (static_cast<uint64_t>(priv) << 2) |
+        static_cast<uint64_t>(xwr_shift);
+    // Translations within megapages and gigapages may be found in the page-walk cache with no walk at all
+    if (a.read_superpage_walk_cache(satp, vaddr, access, *ppaddr)) {
+        return true;
+    }
+
     // Initialize pte_addr with the base address for the root page table
     uint64_t pte_addr = (satp & SATP_PPN_MASK) << LOG2_PAGE_SIZE;
-    for (int i = 0; i < levels; i++) {
+    int first_level = 0;
+    // On a page-walk cache hit, only the leaf PTE in the last-level page table remains to be read
+    if (a.read_page_walk_cache(satp, vaddr, pte_addr)) {
+        first_level = levels - 1;
+    }
+    // Non-leaf PTEs visited, used to fill the page-walk cache when the walk reaches the last level
+    std::array<uint64_t, PWC_MAX_LEVELS> walk_pte_addr{};
+    std::array<uint64_t, PWC_MAX_LEVELS> walk_pte{};
+    for (int i = first_level; i < levels; i++) {
         // Mask out VPN[levels-i-1]
         const int vaddr_shift = LOG2_PAGE_SIZE + LOG2_VPN_SIZE * (levels - 1 - i);
         const uint64_t vpn = (vaddr >> vaddr_shift) & VPN_MASK;
@@ -225,27 +216,88 @@ static NO_INLINE bool translate_virtual_address(STATE_ACCESS &a, uint64_t *ppadd
                 return false;
             }
             // Decide if we need to update access bits in pte
+            uint64_t update_pte = pte;
+            update_pte |= PTE_A_MASK; // Set access bit
+            if (xwr_shift == PTE_XWR_W_SHIFT) {
+                update_pte |= PTE_D_MASK; // Set dirty bit
+            }
             if constexpr (UPDATE_PTE) {
-                uint64_t update_pte = pte;
-                update_pte |= PTE_A_MASK; // Set access bit
-                if (xwr_shift == PTE_XWR_W_SHIFT) {
-                    update_pte |= PTE_D_MASK; // Set dirty bit
-                }
                 if (pte != update_pte) {
                     write_ram_uint64(a, pte_addr, update_pte); // Can't fail since read succeeded earlier
+                    pte = update_pte;
                 }
             }
+            // Cache superpage walks, unless repeating them would still have to update access bits
+            if (i < levels - 1 && pte == update_pte) {
+                walk_pte_addr[i] = pte_addr;
+                walk_pte[i] = pte;
+                a.write_superpage_walk_cache(satp, vaddr, access, i + 1, walk_pte_addr.data(), walk_pte.data(), ppn,
+                    vaddr_mask);
+            }
             // Add page offset in vaddr to ppn to form physical address
             *ppaddr = (vaddr & vaddr_mask) | (ppn & ~vaddr_mask);
             return true;
             // xwr == 0 means we have a pointer to the start of the next page table
         } else {
+            if (i < levels - 1) {
+                walk_pte_addr[i] = pte_addr;
+                walk_pte[i] = pte;
+                if (i == levels - 2) {
+                    a.write_page_walk_cache(satp, vaddr, levels - 1, walk_pte_addr.data(), walk_pte.data(), ppn);
+                }
+            }
             pte_addr = ppn;
         }
     }
     return false;
 }
 
+/// \brief Translate a virtual address to the corresponding physical address
+/// \tparam STATE_ACCESS Class of machine state accessor object.
+/// \tparam UPDATE_PTE Whether PTE entries can be modified during the translation.
+/// \param a Machine state accessor object.
+/// \param ppaddr Pointer to physical address.
+/// \param vaddr Virtual address
+/// \param xwr_shift Encodes the access mode by the shift to the XWR triad (PTE_XWR_R_SHIFT,
+///  PTE_XWR_R_SHIFT, or PTE_XWR_R_SHIFT)
+/// \details The effective privilege level and the satp mode are decided inline, so M-mode and bare accesses
+/// never pay for the call to the outlined page walk.
+/// \returns True if succeeded, false otherwise.
+template <typename STATE_ACCESS, bool UPDATE_PTE = true>
+static FORCE_INLINE bool translate_virtual_address(STATE_ACCESS &a, uint64_t *ppaddr, uint64_t vaddr, int xwr_shift) {
+    auto priv = a.read_iflags_PRV();
+    const uint64_t mstatus = a.read_mstatus();
+
+    // When MPRV is set, data loads and stores use privilege in MPP
+    // instead of the current privilege level (code access is unaffected)
+    if (xwr_shift != PTE_XWR_X_SHIFT && (mstatus & MSTATUS_MPRV_MASK)) {
+        priv = (mstatus & MSTATUS_MPP_MASK) >> MSTATUS_MPP_SHIFT;
+    }
+
+    // The satp register is considered active when the effective privilege mode is S-mode or U-mode.
+    // Executions of the address-translation algorithm may only begin using a given value of satp when
+    // satp is active.
+    if (unlikely(priv > PRV_S)) {
+        // We are in M-mode (or in HS-mode if Hypervisor extension is active)
+        *ppaddr = vaddr;
+        return true;
+    }
+
+    const uint64_t satp = a.read_satp();
+
+    switch (satp >> SATP_MODE_SHIFT) {
+        case SATP_MODE_BARE: // Bare: No translation or protection
+            *ppaddr = vaddr;
+            return true;
+        case SATP_MODE_SV39: // Sv39: Page-based 39-bit virtual addressing
+        case SATP_MODE_SV48: // Sv48: Page-based 48-bit virtual addressing
+        case SATP_MODE_SV57: // Sv57: Page-based 57-bit virtual addressing
+            return walk_page_table<STATE_ACCESS, UPDATE_PTE>(a, ppaddr, vaddr, xwr_shift, priv, mstatus, satp);
+        default: // Unsupported mode
+            return false;
+    }
+}
+
 } // namespace cartesi
 
 #endif /* end of include guard: TRANSLATE_VIRTUAL_ADDRESS_H */
@@ -15,9 +15,11 @@
 //
 
 #include "uarch-pristine-state-hash.h"
+#include "uarch-constants.h"
 #include "uarch-pristine.h"
 
-#include <algorithm>
+#include <cstring>
+#include <stdexcept>
 
 namespace cartesi {
 
@@ -33,4 +35,26 @@ static machine_merkle_tree::hash_type get_uarch_pristine_state_hash() noexcept {
 /// \details This hash is computed at compile time by the program compute-uarch-pristine-hash.cpp
 const machine_merkle_tree::hash_type uarch_pristine_state_hash = get_uarch_pristine_state_hash();
 
+static machine_merkle_tree::subtree_hashes_type get_uarch_pristine_state_subtree_hashes_from_image() {
+    machine_merkle_tree::subtree_hashes_type hashes(
+        UINT64_C(2) << (UARCH_STATE_LOG2_SIZE - machine_merkle_tree::get_log2_page_size()));
+    if (uarch_pristine_subtree_hashes_len != hashes.size() * sizeof(machine_merkle_tree::hash_type)) {
+        throw std::runtime_error("embedded uarch subtree hashes do not match uarch state size");
+    }
+    for (size_t i = 0; i < hashes.size(); ++i) {
+        memcpy(hashes[i].data(), uarch_pristine_subtree_hashes + i * sizeof(machine_merkle_tree::hash_type),
+            sizeof(machine_merkle_tree::hash_type));
+    }
+    // Entry 1 holds the subtree root, which must match the hash generated along with the subtree hashes
+    if (hashes[1] != uarch_pristine_state_hash) {
+        throw std::runtime_error("embedded uarch subtree hashes do not match pristine uarch state hash");
+    }
+    return hashes;
+}
+
+const machine_merkle_tree::subtree_hashes_type &get_uarch_pristine_state_subtree_hashes(void) {
+    static const machine_merkle_tree::subtree_hashes_type hashes = get_uarch_pristine_state_subtree_hashes_from_image();
+    return hashes;
+}
+
 } // namespace cartesi
@@ -25,6 +25,12 @@ namespace cartesi {
 /// \details This hash is computed at compile time by the program compute-uarch-pristine-hash.cpp
 extern const machine_merkle_tree::hash_type uarch_pristine_state_hash;
 
+/// \brief Hashes of all nodes in the pristine uarch state subtree, down to its pages.
+/// \returns Reference to hashes in the format used by machine_merkle_tree::replace_subtree_hashes().
+/// \details These hashes are computed at compile time by the program compute-uarch-pristine-hash.cpp,
+/// and are checked against uarch_pristine_state_hash on first use.
+const machine_merkle_tree::subtree_hashes_type &get_uarch_pristine_state_subtree_hashes(void);
+
 } // namespace cartesi
 
 #endif
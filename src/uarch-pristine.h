@@ -29,4 +29,12 @@ extern "C" const unsigned char uarch_pristine_hash[];
 /// \brief Length of the embedded pristine uarch ram image. This symbol is created by "compute-uarch-pristine-hash"
 extern "C" const unsigned int uarch_pristine_hash_len;
 
+/// \brief Hashes of all nodes in the pristine uarch state subtree, in heap order.
+/// This symbol is created by "compute-uarch-pristine-hash --subtree-hashes"
+extern "C" const unsigned char uarch_pristine_subtree_hashes[];
+
+/// \brief Length of the hashes of the pristine uarch state subtree.
+/// This symbol is created by "compute-uarch-pristine-hash --subtree-hashes"
+extern "C" const unsigned int uarch_pristine_subtree_hashes_len;
+
 #endif // UARCH_PRISTINE_H
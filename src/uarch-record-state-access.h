@@ -429,8 +429,13 @@ private:
         for (int i = 1; i < UARCH_X_REG_COUNT; i++) {
             m_us.x[i] = UARCH_X_INIT;
         }
-        m_us.ram.fill_memory(m_us.ram.get_start(), 0, m_us.ram.get_length());
-        m_us.ram.write_memory(m_us.ram.get_start(), uarch_pristine_ram, uarch_pristine_ram_len);
+        // Skip refilling uarch RAM that is already pristine
+        if (!m_m.is_uarch_ram_pristine()) {
+            m_us.ram.fill_memory(m_us.ram.get_start(), 0, m_us.ram.get_length());
+            m_us.ram.write_memory(m_us.ram.get_start(), uarch_pristine_ram, uarch_pristine_ram_len);
+        }
+        // Swap in the precomputed pristine uarch subtree instead of re-hashing every uarch page
+        m_m.update_merkle_tree_uarch_pristine();
         if (m_log->get_log_type().has_large_data()) {
             // log written data, if debug info is enabled
             a.get_written().emplace(get_uarch_state_image());
@@ -29,6 +29,7 @@ class uarch_state_access : public i_uarch_state_access<uarch_state_access> {
     uarch_state &m_us;
     machine_state &m_s;
     // NOLINTEND(cppcoreguidelines-avoid-const-or-ref-data-members)1
+    bool m_ram_pristine; ///< Whether uarch RAM is known to already hold the pristine image
 
     /// \brief Obtain Memory PMA entry that covers a given physical memory region
     /// \param paddr Start of physical memory region.
@@ -60,7 +61,11 @@ public:
     /// \brief Constructor from machine and uarch states.
     /// \param um Reference to uarch state.
     /// \param m Reference to machine state.
-    explicit uarch_state_access(uarch_state &us, machine_state &s) : m_us(us), m_s(s) {
+    /// \param ram_pristine Whether uarch RAM already holds the pristine image, so reset can skip reloading it.
+    explicit uarch_state_access(uarch_state &us, machine_state &s, bool ram_pristine = false) :
+        m_us(us),
+        m_s(s),
+        m_ram_pristine(ram_pristine) {
         ;
     }
 
@@ -189,6 +194,9 @@ private:
         if (uarch_pristine_ram_len > m_us.ram.get_length()) {
             throw std::runtime_error("embedded uarch ram image does not fit in uarch ram pma");
         }
+        if (m_ram_pristine) {
+            return;
+        }
         m_us.ram.fill_memory(m_us.ram.get_start(), 0, m_us.ram.get_length());
         m_us.ram.write_memory(m_us.ram.get_start(), uarch_pristine_ram, uarch_pristine_ram_len);
     }
@@ -0,0 +1,391 @@
+// Copyright Cartesi and individual authors (see AUTHORS)
+// SPDX-License-Identifier: LGPL-3.0-or-later
+//
+// This program is free software: you can redistribute it and/or modify it under
+// the terms of the GNU Lesser General Public License as published by the Free
+// Software Foundation, either version 3 of the License, or (at your option) any
+// later version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+// PARTICULAR PURPOSE. See the GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License along
+// with this program (see COPYING). If not, see <https://www.gnu.org/licenses/>.
+//
+
+/// \file
+/// \brief VirtIO block device.
+/// \details \{
+///
+/// The block device exposes a host image file to the guest as a disk,
+/// without mapping it into the guest physical address space.
+///
+/// The disk appears in the guest as /dev/vda, /dev/vdb, ...
+///
+/// \}
+
+// Enable this define to debug VirtIO block device operations
+// #define DEBUG_VIRTIO_BLK
+
+#include "virtio-blk.h"
+
+#ifdef HAVE_POSIX_FS
+
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <system_error>
+
+#include <fcntl.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+namespace cartesi {
+
+virtio_blk::virtio_blk(uint32_t virtio_idx, const std::string &image_filename, bool read_only) :
+    virtio_device(virtio_idx, VIRTIO_DEVICE_BLOCK,
+        VIRTIO_BLK_F_SIZE_MAX | VIRTIO_BLK_F_SEG_MAX | VIRTIO_BLK_F_BLK_SIZE | VIRTIO_BLK_F_FLUSH |
+            (read_only ? VIRTIO_BLK_F_RO : UINT64_C(0)),
+        sizeof(virtio_blk_config_space)),
+    m_read_only(read_only) {
+    m_fd = open(image_filename.c_str(), (read_only ? O_RDONLY : O_RDWR) | O_CLOEXEC);
+    if (m_fd < 0) {
+        throw std::system_error{errno, std::generic_category(),
+            "could not open virtio block image '" + image_filename + "'"};
+    }
+    // Seeking works for both regular files and host block devices
+    const off_t length = lseek(m_fd, 0, SEEK_END);
+    if (length < 0 || length % VIRTIO_BLK_SECTOR_SIZE != 0) {
+        close_all();
+        throw std::invalid_argument{
+            "virtio block image '" + image_filename + "' length must be a multiple of 512 bytes"};
+    }
+    m_length = static_cast<uint64_t>(length);
+    // Initialize config space
+    virtio_blk_config_space *config = get_config();
+    config->capacity = m_length / VIRTIO_BLK_SECTOR_SIZE;
+    config->size_max = VIRTIO_BLK_SIZE_MAX;
+    config->seg_max = VIRTIO_BLK_SEG_MAX;
+    config->blk_size = VIRTIO_BLK_SECTOR_SIZE;
+#ifdef HAVE_THREADS
+    // Workers report completions through a pipe, so the machine wakes up from WFI while polling devices
+    if (pipe(m_completion_pipe.data()) < 0) {
+        const int error = errno;
+        close_all();
+        throw std::system_error{error, std::generic_category(), "could not create virtio block completion pipe"};
+    }
+    for (const int fd : m_completion_pipe) {
+        (void) fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+        (void) fcntl(fd, F_SETFD, FD_CLOEXEC);
+    }
+    m_workers.reserve(VIRTIO_BLK_WORKER_COUNT);
+    for (uint32_t i = 0; i < VIRTIO_BLK_WORKER_COUNT; ++i) {
+        m_workers.emplace_back([this] { work(); });
+    }
+#endif
+}
+
+virtio_blk::~virtio_blk() {
+#ifdef HAVE_THREADS
+    {
+        const std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_cv.notify_all();
+    for (auto &worker : m_workers) {
+        worker.join();
+    }
+#endif
+    close_all();
+}
+
+void virtio_blk::close_all() {
+#ifdef HAVE_THREADS
+    if (poller != nullptr && m_completion_pipe[0] >= 0) {
+        poller->unwatch(m_completion_pipe[0]);
+    }
+    for (int &fd : m_completion_pipe) {
+        if (fd >= 0) {
+            close(fd);
+            fd = -1;
+        }
+    }
+#endif
+    if (m_fd >= 0) {
+        close(m_fd);
+        m_fd = -1;
+    }
+}
+
+void virtio_blk::on_device_reset() {
+    // Requests taken before the reset are discarded when they complete
+    ++m_generation;
+#ifdef HAVE_THREADS
+    const std::lock_guard<std::mutex> lock(m_mutex);
+    m_pending.clear();
+    m_completed.clear();
+#endif
+}
+
+void virtio_blk::on_device_ok(i_device_state_access *a) {
+    (void) a;
+}
+
+bool virtio_blk::on_device_queue_available(i_device_state_access *a, uint32_t queue_idx, uint16_t desc_idx,
+    uint32_t read_avail_len, uint32_t write_avail_len) {
+    // Only the request queue is expected, and every request has a header and a status byte
+    if (queue_idx != VIRTIO_BLK_REQUESTQ || read_avail_len < VIRTIO_BLK_REQ_HEADER_SIZE || write_avail_len < 1) {
+        notify_device_needs_reset(a);
+        return false;
+    }
+    virtq &vq = queue[queue_idx];
+    std::array<unsigned char, VIRTIO_BLK_REQ_HEADER_SIZE> header{};
+    if (!vq.read_desc_mem(a, desc_idx, 0, header.data(), header.size())) {
+        notify_device_needs_reset(a);
+        return false;
+    }
+    auto req = std::make_unique<virtio_blk_request>();
+    req->desc_idx = desc_idx;
+    req->status_offset = write_avail_len - 1;
+    req->generation = m_generation;
+    uint64_t sector = 0;
+    memcpy(&req->type, header.data(), sizeof(req->type));
+    memcpy(&sector, header.data() + 8, sizeof(sector));
+    switch (req->type) {
+        case VIRTIO_BLK_T_IN:
+            // Drivers split larger transfers as advertised by size_max and seg_max, so larger requests
+            // are malformed and are not allowed to make the host allocate their length
+            if (write_avail_len - 1 > VIRTIO_BLK_DATA_MAX) {
+                req->status = VIRTIO_BLK_S_IOERR;
+                break;
+            }
+            req->data.resize(write_avail_len - 1);
+            break;
+        case VIRTIO_BLK_T_OUT:
+            if (m_read_only || read_avail_len - VIRTIO_BLK_REQ_HEADER_SIZE > VIRTIO_BLK_DATA_MAX) {
+                req->status = VIRTIO_BLK_S_IOERR;
+                break;
+            }
+            req->data.resize(read_avail_len - VIRTIO_BLK_REQ_HEADER_SIZE);
+            if (!vq.read_desc_mem(a, desc_idx, VIRTIO_BLK_REQ_HEADER_SIZE, req->data.data(), req->data.size())) {
+                notify_device_needs_reset(a);
+                return false;
+            }
+            break;
+        case VIRTIO_BLK_T_FLUSH:
+            break;
+        case VIRTIO_BLK_T_GET_ID: {
+            std::array<char, VIRTIO_BLK_ID_BYTES + 1> id{};
+            (void) snprintf(id.data(), id.size(), "cartesi-vd%u", static_cast<unsigned int>(virtio_idx));
+            req->data.assign(id.begin(), id.begin() + std::min<uint32_t>(VIRTIO_BLK_ID_BYTES, write_avail_len - 1));
+            break;
+        }
+        default:
+            req->status = VIRTIO_BLK_S_UNSUPP;
+            break;
+    }
+    // Reject accesses outside the image
+    if ((req->type == VIRTIO_BLK_T_IN || req->type == VIRTIO_BLK_T_OUT) && req->status == VIRTIO_BLK_S_OK) {
+        if (sector > m_length / VIRTIO_BLK_SECTOR_SIZE ||
+            req->data.size() > m_length - sector * VIRTIO_BLK_SECTOR_SIZE) {
+            req->status = VIRTIO_BLK_S_IOERR;
+        }
+        req->offset = sector * VIRTIO_BLK_SECTOR_SIZE;
+    }
+#ifdef DEBUG_VIRTIO_BLK
+    (void) fprintf(stderr, "virtio-blk[%d]: request type=%u sector=%llu length=%zu status=%u\n", virtio_idx,
+        req->type, static_cast<unsigned long long>(sector), req->data.size(), req->status);
+#endif
+    const bool needs_io = req->status == VIRTIO_BLK_S_OK && req->type != VIRTIO_BLK_T_GET_ID;
+#ifdef HAVE_THREADS
+    if (needs_io) {
+        // Take the request in flight and keep going through the queue, so all available requests
+        // are handed to the workers together
+        ++vq.in_flight;
+        {
+            const std::lock_guard<std::mutex> lock(m_mutex);
+            m_pending.push_back(std::move(req));
+        }
+        m_cv.notify_one();
+        return true;
+    }
+#else
+    if (needs_io) {
+        execute_requests({req.get()});
+    }
+#endif
+    if (!complete_request(a, *req)) {
+        notify_device_needs_reset(a);
+        return false;
+    }
+    notify_queue_used(a, VIRTIO_BLK_REQUESTQ);
+    return true;
+}
+
+/// \brief Transfers data between the image file and a list of buffers, retrying partial transfers
+/// \returns True if all data was transferred
+static bool transfer_iov(int fd, bool write, std::vector<iovec> &iov, uint64_t offset) {
+    size_t i = 0;
+    while (i < iov.size()) {
+        const int count = static_cast<int>(std::min<size_t>(iov.size() - i, IOV_MAX));
+        const ssize_t ret = write ? pwritev(fd, &iov[i], count, static_cast<off_t>(offset)) :
+                                    preadv(fd, &iov[i], count, static_cast<off_t>(offset));
+        if (ret < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        if (ret == 0) {
+            // The image file shrunk since it was opened
+            return false;
+        }
+        offset += static_cast<uint64_t>(ret);
+        // Skip buffers completely transferred and advance into the partially transferred one
+        auto left = static_cast<size_t>(ret);
+        while (i < iov.size() && left >= iov[i].iov_len) {
+            left -= iov[i].iov_len;
+            ++i;
+        }
+        if (left > 0) {
+            iov[i].iov_base = static_cast<unsigned char *>(iov[i].iov_base) + left;
+            iov[i].iov_len -= left;
+        }
+    }
+    return true;
+}
+
+void virtio_blk::execute_requests(const std::vector<virtio_blk_request *> &batch) const {
+    const uint32_t type = batch.front()->type;
+    bool ok = false;
+    if (type == VIRTIO_BLK_T_FLUSH) {
+#ifdef __APPLE__
+        ok = fsync(m_fd) == 0;
+#else
+        ok = fdatasync(m_fd) == 0;
+#endif
+    } else {
+        std::vector<iovec> iov;
+        iov.reserve(batch.size());
+        for (auto *req : batch) {
+            if (!req->data.empty()) {
+                iov.push_back(iovec{req->data.data(), req->data.size()});
+            }
+        }
+        ok = transfer_iov(m_fd, type == VIRTIO_BLK_T_OUT, iov, batch.front()->offset);
+    }
+    if (!ok) {
+        for (auto *req : batch) {
+            req->status = VIRTIO_BLK_S_IOERR;
+        }
+    }
+}
+
+bool virtio_blk::complete_request(i_device_state_access *a, const virtio_blk_request &req) {
+    const virtq &vq = queue[VIRTIO_BLK_REQUESTQ];
+    if (req.status == VIRTIO_BLK_S_OK && (req.type == VIRTIO_BLK_T_IN || req.type == VIRTIO_BLK_T_GET_ID)) {
+        if (!vq.write_desc_mem(a, req.desc_idx, 0, req.data.data(), req.data.size())) {
+            return false;
+        }
+    }
+    if (!vq.write_desc_mem(a, req.desc_idx, req.status_offset, &req.status, 1)) {
+        return false;
+    }
+    return queue[VIRTIO_BLK_REQUESTQ].consume_desc(a, req.desc_idx, req.status_offset + 1, 0);
+}
+
+void virtio_blk::prepare_select(os_poller *poller, uint64_t *timeout_us) {
+    (void) timeout_us;
+#ifdef HAVE_THREADS
+    if (!driver_ok) {
+        return;
+    }
+    poller->watch(m_completion_pipe[0], OS_POLL_IN);
+#else
+    (void) poller;
+#endif
+}
+
+bool virtio_blk::poll_selected(int select_ret, os_poller *poller, i_device_state_access *da) {
+#ifdef HAVE_THREADS
+    if (!driver_ok || select_ret <= 0 || (poller->get_ready(m_completion_pipe[0]) & OS_POLL_IN) == 0) {
+        return false;
+    }
+    // Drain wake up bytes before taking completions, so no completion is left without a wake up
+    std::array<unsigned char, 256> drain{};
+    while (read(m_completion_pipe[0], drain.data(), drain.size()) > 0) {
+    }
+    std::vector<std::unique_ptr<virtio_blk_request>> completed;
+    {
+        const std::lock_guard<std::mutex> lock(m_mutex);
+        completed.swap(m_completed);
+    }
+    // Use all completed requests before raising a single interrupt
+    bool used = false;
+    for (const auto &req : completed) {
+        if (req->generation != m_generation) {
+            continue;
+        }
+        --queue[VIRTIO_BLK_REQUESTQ].in_flight;
+        if (!complete_request(da, *req)) {
+            notify_device_needs_reset(da);
+            return true;
+        }
+        used = true;
+    }
+    if (used) {
+        notify_queue_used(da, VIRTIO_BLK_REQUESTQ);
+    }
+    return used;
+#else
+    (void) select_ret;
+    (void) poller;
+    (void) da;
+    return false;
+#endif
+}
+
+#ifdef HAVE_THREADS
+void virtio_blk::work() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (true) {
+        m_cv.wait(lock, [this] { return m_stopping || !m_pending.empty(); });
+        if (m_stopping) {
+            return;
+        }
+        // Take the oldest request, along with the requests queued after it that continue it in the image file
+        std::vector<std::unique_ptr<virtio_blk_request>> batch;
+        batch.push_back(std::move(m_pending.front()));
+        m_pending.pop_front();
+        while (!m_pending.empty() && batch.size() < VIRTIO_BLK_BATCH_MAX) {
+            const auto &last = *batch.back();
+            const auto &next = *m_pending.front();
+            if (last.type == VIRTIO_BLK_T_FLUSH || next.type != last.type ||
+                next.offset != last.offset + last.data.size()) {
+                break;
+            }
+            batch.push_back(std::move(m_pending.front()));
+            m_pending.pop_front();
+        }
+        lock.unlock();
+        std::vector<virtio_blk_request *> reqs(batch.size());
+        std::transform(batch.begin(), batch.end(), reqs.begin(), [](const auto &req) { return req.get(); });
+        execute_requests(reqs);
+        lock.lock();
+        for (auto &req : batch) {
+            m_completed.push_back(std::move(req));
+        }
+        // The pipe is non-blocking, a full pipe already has wake ups pending
+        const unsigned char wakeup = 0;
+        (void) write(m_completion_pipe[1], &wakeup, 1);
+    }
+}
+#endif
+
+} // namespace cartesi
+
+#endif // HAVE_POSIX_FS
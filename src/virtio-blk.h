@@ -0,0 +1,163 @@
+// Copyright Cartesi and individual authors (see AUTHORS)
+// SPDX-License-Identifier: LGPL-3.0-or-later
+//
+// This program is free software: you can redistribute it and/or modify it under
+// the terms of the GNU Lesser General Public License as published by the Free
+// Software Foundation, either version 3 of the License, or (at your option) any
+// later version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+// PARTICULAR PURPOSE. See the GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License along
+// with this program (see COPYING). If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef VIRTIO_BLK_H
+#define VIRTIO_BLK_H
+
+#include "os-features.h"
+
+#ifdef HAVE_POSIX_FS
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#ifdef HAVE_THREADS
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#endif
+
+#include "virtio-device.h"
+
+namespace cartesi {
+
+/// \brief VirtIO block device features
+enum virtio_blk_features : uint64_t {
+    VIRTIO_BLK_F_SIZE_MAX = (UINT64_C(1) << 1), ///< Maximum size of any single segment is in size_max.
+    VIRTIO_BLK_F_SEG_MAX = (UINT64_C(1) << 2),  ///< Maximum number of segments in a request is in seg_max.
+    VIRTIO_BLK_F_RO = (UINT64_C(1) << 5),       ///< Device is read-only.
+    VIRTIO_BLK_F_BLK_SIZE = (UINT64_C(1) << 6), ///< Block size of disk is in blk_size.
+    VIRTIO_BLK_F_FLUSH = (UINT64_C(1) << 9),    ///< Cache flush command support.
+};
+
+/// \brief VirtIO block device virtqueue indexes
+enum virtio_blk_virtq : uint32_t {
+    VIRTIO_BLK_REQUESTQ = 0, ///< Queue of requests from guest to host
+};
+
+/// \brief VirtIO block device constants
+enum virtio_blk_constants : uint32_t {
+    VIRTIO_BLK_SECTOR_SIZE = 512,                                   ///< Size of sectors addressed by requests
+    VIRTIO_BLK_REQ_HEADER_SIZE = 16,                                ///< Size of request header read by the device
+    VIRTIO_BLK_ID_BYTES = 20,                                       ///< Size of the id returned by VIRTIO_BLK_T_GET_ID
+    VIRTIO_BLK_SEG_MAX = VIRTIO_QUEUE_NUM_MAX - 2,                  ///< Maximum number of data segments per request
+    VIRTIO_BLK_SIZE_MAX = 0x10000,                                  ///< Maximum size of a data segment
+    VIRTIO_BLK_DATA_MAX = VIRTIO_BLK_SEG_MAX * VIRTIO_BLK_SIZE_MAX, ///< Maximum data size of a request
+    VIRTIO_BLK_WORKER_COUNT = 4,                                    ///< Number of host threads servicing requests
+    VIRTIO_BLK_BATCH_MAX = 64,                                      ///< Maximum requests merged into a single host I/O
+};
+
+/// \brief VirtIO block device request types
+enum virtio_blk_req_type : uint32_t {
+    VIRTIO_BLK_T_IN = 0,     ///< Read sectors
+    VIRTIO_BLK_T_OUT = 1,    ///< Write sectors
+    VIRTIO_BLK_T_FLUSH = 4,  ///< Flush written sectors to stable storage
+    VIRTIO_BLK_T_GET_ID = 8, ///< Get device id string
+};
+
+/// \brief VirtIO block device request status
+enum virtio_blk_req_status : uint8_t {
+    VIRTIO_BLK_S_OK = 0,     ///< Request succeeded
+    VIRTIO_BLK_S_IOERR = 1,  ///< Request failed
+    VIRTIO_BLK_S_UNSUPP = 2, ///< Request type is not supported
+};
+
+/// \brief VirtIO block device config space
+struct virtio_blk_config_space {
+    uint64_t capacity;           ///< Capacity in 512-byte sectors
+    uint32_t size_max;           ///< Maximum segment size (if VIRTIO_BLK_F_SIZE_MAX)
+    uint32_t seg_max;            ///< Maximum number of segments in a request (if VIRTIO_BLK_F_SEG_MAX)
+    uint16_t geometry_cylinders; ///< Number of cylinders (unused)
+    uint8_t geometry_heads;      ///< Number of heads (unused)
+    uint8_t geometry_sectors;    ///< Number of sectors per track (unused)
+    uint32_t blk_size;           ///< Block size (if VIRTIO_BLK_F_BLK_SIZE)
+};
+
+/// \brief VirtIO block device request taken from the request queue
+struct virtio_blk_request {
+    uint16_t desc_idx{0};            ///< Queue's descriptor index holding the request
+    uint32_t type{0};                ///< Request type (see virtio_blk_req_type)
+    uint64_t offset{0};              ///< Offset in image file, in bytes
+    std::vector<unsigned char> data; ///< Data read from or to be written to the image file
+    uint32_t status_offset{0};       ///< Offset of status byte in the descriptor write buffer
+    uint8_t status{VIRTIO_BLK_S_OK}; ///< Request status (see virtio_blk_req_status)
+    uint64_t generation{0};          ///< Device generation when the request was taken
+};
+
+/// \brief VirtIO block device backed by a host image file
+/// \details Requests are serviced by a pool of host threads, so the guest keeps running while the host
+/// performs I/O. Sector-contiguous reads or writes queued together are merged into a single host I/O.
+/// Completions wake up the machine through a pipe polled with the other VirtIO devices.
+class virtio_blk final : public virtio_device {
+    int m_fd = -1;            ///< Image file descriptor
+    bool m_read_only{false};  ///< Whether the guest can write to the image
+    uint64_t m_length{0};     ///< Length of image in bytes
+    uint64_t m_generation{0}; ///< Incremented on every device reset, to discard requests taken before it
+#ifdef HAVE_THREADS
+    std::array<int, 2> m_completion_pipe{-1, -1};                 ///< Pipe written by workers on completion
+    std::vector<std::thread> m_workers;                           ///< Worker threads
+    std::mutex m_mutex;                                           ///< Protects the fields below
+    std::condition_variable m_cv;                                 ///< Signals new pending requests
+    std::deque<std::unique_ptr<virtio_blk_request>> m_pending;    ///< Requests waiting for a worker
+    std::vector<std::unique_ptr<virtio_blk_request>> m_completed; ///< Requests waiting to be used
+    bool m_stopping{false};                                       ///< Whether workers must exit
+#endif
+
+public:
+    virtio_blk(uint32_t virtio_idx, const std::string &image_filename, bool read_only);
+    ~virtio_blk() override;
+    virtio_blk(const virtio_blk &other) = delete;
+    virtio_blk(virtio_blk &&other) = delete;
+    virtio_blk &operator=(const virtio_blk &other) = delete;
+    virtio_blk &operator=(virtio_blk &&other) = delete;
+
+    void on_device_reset() override;
+    void on_device_ok(i_device_state_access *a) override;
+    bool on_device_queue_available(i_device_state_access *a, uint32_t queue_idx, uint16_t desc_idx,
+        uint32_t read_avail_len, uint32_t write_avail_len) override;
+
+    void prepare_select(os_poller *poller, uint64_t *timeout_us) override;
+    bool poll_selected(int select_ret, os_poller *poller, i_device_state_access *da) override;
+
+    virtio_blk_config_space *get_config() {
+        // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+        return reinterpret_cast<virtio_blk_config_space *>(config_space.data());
+    }
+
+private:
+    /// \brief Performs the host I/O of a batch of requests of the same type, contiguous in the image file.
+    void execute_requests(const std::vector<virtio_blk_request *> &batch) const;
+
+    /// \brief Writes a request results to the guest and marks its descriptor as used.
+    bool complete_request(i_device_state_access *a, const virtio_blk_request &req);
+
+    void close_all();
+
+#ifdef HAVE_THREADS
+    /// \brief Worker thread main loop.
+    void work();
+#endif
+};
+
+} // namespace cartesi
+
+#endif // HAVE_POSIX_FS
+
+#endif
@@ -19,8 +19,9 @@
 
 namespace cartesi {
 
-virtio_console::virtio_console(uint32_t virtio_idx) :
-    virtio_device(virtio_idx, VIRTIO_DEVICE_CONSOLE, VIRTIO_CONSOLE_F_SIZE, sizeof(virtio_console_config_space)) {}
+virtio_console::virtio_console(uint32_t virtio_idx, console_output *output) :
+    virtio_device(virtio_idx, VIRTIO_DEVICE_CONSOLE, VIRTIO_CONSOLE_F_SIZE, sizeof(virtio_console_config_space)),
+    m_output{output} {}
 
 void virtio_console::on_device_reset() {
     m_stdin_ready = false;
@@ -50,17 +51,25 @@ bool virtio_console::on_device_queue_available(i_device_state_access *a, uint32_
 bool virtio_console::write_next_chars_to_host(i_device_state_access *a, uint32_t queue_idx, uint16_t desc_idx,
     uint32_t read_avail_len) {
     const virtq &vq = queue[queue_idx];
-    // Read stdout characters from queue buffer in chunks
-    std::array<uint8_t, TTY_BUF_SIZE> chunk{};
-    for (uint32_t off = 0; off < read_avail_len; off += chunk.size()) {
-        // Read from queue buffer
-        const uint32_t chunk_len = std::min<uint32_t>(chunk.size(), read_avail_len - off);
-        if (!vq.read_desc_mem(a, desc_idx, off, chunk.data(), chunk_len)) {
-            notify_device_needs_reset(a);
-            return false;
+    std::array<virtq_iovec, VIRTIO_QUEUE_NUM_MAX> iovs{};
+    uint32_t iovcnt = 0;
+    if (vq.map_desc_mem(a, desc_idx, 0, read_avail_len, false, iovs.data(), &iovcnt)) {
+        // Write characters directly from the queue buffer
+        for (uint32_t i = 0; i < iovcnt; ++i) {
+            m_output->write(iovs[i].base, iovs[i].len);
+        }
+    } else {
+        // Otherwise, read characters from queue buffer in chunks
+        std::array<uint8_t, TTY_BUF_SIZE> chunk{};
+        for (uint32_t off = 0; off < read_avail_len; off += chunk.size()) {
+            // Read from queue buffer
+            const uint32_t chunk_len = std::min<uint32_t>(chunk.size(), read_avail_len - off);
+            if (!vq.read_desc_mem(a, desc_idx, off, chunk.data(), chunk_len)) {
+                notify_device_needs_reset(a);
+                return false;
+            }
+            m_output->write(chunk.data(), chunk_len);
         }
-        // Write to stdout
-        os_putchars(chunk.data(), chunk_len);
     }
     // Consume the queue and notify the driver
     if (!consume_and_notify_queue(a, queue_idx, desc_idx)) {
@@ -124,7 +133,7 @@ bool virtio_console::notify_console_size_to_guest(i_device_state_access *a) {
     return true;
 }
 
-void virtio_console::prepare_select(select_fd_sets *fds, uint64_t *timeout_us) {
+void virtio_console::prepare_select(os_poller *poller, uint64_t *timeout_us) {
     // Ignore if driver is not initialized
     if (!driver_ok) {
         return;
@@ -144,16 +153,16 @@ void virtio_console::prepare_select(select_fd_sets *fds, uint64_t *timeout_us) {
             return;
         }
     }
-    os_prepare_tty_select(fds);
+    os_prepare_tty_select(poller);
 }
 
-bool virtio_console::poll_selected(int select_ret, select_fd_sets *fds, i_device_state_access *da) {
+bool virtio_console::poll_selected(int select_ret, os_poller *poller, i_device_state_access *da) {
     // Ignore if driver is not initialized or stdin is not ready
     if (!driver_ok || !m_stdin_ready) {
         return false;
     }
     bool interrupt_requested = notify_console_size_to_guest(da);
-    if (os_poll_selected_tty(select_ret, fds)) {
+    if (os_poll_selected_tty(select_ret, poller)) {
         while (write_next_chars_to_guest(da)) {
             interrupt_requested = true;
         }
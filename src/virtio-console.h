@@ -17,6 +17,7 @@
 #ifndef VIRTIO_CONSOLE_H
 #define VIRTIO_CONSOLE_H
 
+#include "console-output.h"
 #include "virtio-device.h"
 
 namespace cartesi {
@@ -45,9 +46,10 @@ struct virtio_console_config_space {
 /// \brief VirtIO console device
 class virtio_console final : public virtio_device {
     bool m_stdin_ready = false;
+    console_output *m_output; ///< Receives characters written by the guest
 
 public:
-    virtio_console(uint32_t virtio_idx);
+    virtio_console(uint32_t virtio_idx, console_output *output);
 
     void on_device_reset() override;
     void on_device_ok(i_device_state_access *a) override;
@@ -59,8 +61,8 @@ public:
     bool write_next_chars_to_guest(i_device_state_access *a);
     bool notify_console_size_to_guest(i_device_state_access *a);
 
-    void prepare_select(select_fd_sets *fds, uint64_t *timeout_us) override;
-    bool poll_selected(int select_ret, select_fd_sets *fds, i_device_state_access *da) override;
+    void prepare_select(os_poller *poller, uint64_t *timeout_us) override;
+    bool poll_selected(int select_ret, os_poller *poller, i_device_state_access *da) override;
 
     virtio_console_config_space *get_config() {
         // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
@@ -23,6 +23,8 @@
 #include "plic.h"
 #include "strict-aliasing.h"
 
+#include <stdexcept>
+
 namespace cartesi {
 
 static inline bool is_power_of_2(uint32_t val) {
@@ -61,6 +63,25 @@ static bool virtq_get_ring_avail_elem_desc_idx(const virtq &vq, i_device_state_a
     return a->read_memory(addr, reinterpret_cast<unsigned char *>(pdesc_idx), sizeof(uint16_t));
 }
 
+static bool virtq_get_used_event(const virtq &vq, i_device_state_access *a, uint16_t *pused_event) {
+    // The used_event field follows the available ring
+    const uint64_t addr = vq.avail_addr + sizeof(virtq_header) + vq.num * sizeof(uint16_t);
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+    return a->read_memory(addr, reinterpret_cast<unsigned char *>(pused_event), sizeof(uint16_t));
+}
+
+static bool virtq_set_avail_event(const virtq &vq, i_device_state_access *a, uint16_t avail_event) {
+    // The avail_event field follows the used ring
+    const uint64_t addr = vq.used_addr + sizeof(virtq_header) + vq.num * sizeof(virtq_used_elem);
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+    return a->write_memory(addr, reinterpret_cast<const unsigned char *>(&avail_event), sizeof(uint16_t));
+}
+
+/// \brief Checks whether the ring index moving from old_idx to new_idx crossed the event index.
+static inline bool virtq_need_event(uint16_t event_idx, uint16_t new_idx, uint16_t old_idx) {
+    return static_cast<uint16_t>(new_idx - event_idx - 1) < static_cast<uint16_t>(new_idx - old_idx);
+}
+
 static bool virtq_get_desc(const virtq &vq, i_device_state_access *a, uint16_t desc_idx, virtq_desc *pdesc) {
     const uint64_t addr = vq.desc_addr + (desc_idx & (vq.num - 1)) * sizeof(virtq_desc);
     // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
@@ -272,6 +293,61 @@ bool virtq::write_desc_mem(i_device_state_access *a, uint16_t desc_idx, uint32_t
     }
 }
 
+bool virtq::map_desc_mem(i_device_state_access *a, uint16_t desc_idx, uint32_t start_off, uint32_t len, bool write,
+    virtq_iovec *iovs, uint32_t *piovcnt) const {
+    uint32_t iovcnt = 0;
+    *piovcnt = 0;
+    // Really do nothing when length is 0
+    if (len == 0) {
+        return true;
+    }
+    const uint32_t end_off = start_off + len;
+    uint32_t buf_start_off = 0;
+    // Traverse all buffers in queue
+    while (true) {
+        virtq_desc desc{};
+        // Retrieve queue buffer description
+        if (!virtq_get_desc(*this, a, desc_idx, &desc)) {
+            return false;
+        }
+        // We are only interested in buffers with the requested direction
+        if (((desc.flags & VIRTQ_DESC_F_WRITE) != 0) == write) {
+            const uint32_t buf_end_off = buf_start_off + desc.len;
+            const uint32_t chunk_start_off = std::max(buf_start_off, start_off);
+            const uint32_t chunk_end_off = std::min(buf_end_off, end_off);
+            // Resolve chunk when it intersects with the desired interval
+            if (chunk_end_off > chunk_start_off) {
+                // Give up on chains with more chunks than any well-formed queue can hold
+                if (iovcnt >= VIRTIO_QUEUE_NUM_MAX) {
+                    return false;
+                }
+                const uint32_t paddr_off = chunk_start_off - buf_start_off;
+                const uint32_t chunk_len = chunk_end_off - chunk_start_off;
+                unsigned char *base = a->get_host_memory(desc.paddr + paddr_off, chunk_len, write);
+                if (!base) {
+                    return false;
+                }
+                iovs[iovcnt].base = base;
+                iovs[iovcnt].len = chunk_len;
+                ++iovcnt;
+            }
+            buf_start_off += desc.len;
+            // Stop when we reach the buffer end offset
+            if (chunk_end_off >= end_off) {
+                *piovcnt = iovcnt;
+                return true;
+            }
+        }
+        // Stop when there are no more buffers in queue
+        if (!(desc.flags & VIRTQ_DESC_F_NEXT)) {
+            // Operation failed because more chunks were expected
+            return false;
+        }
+        // Move to the next buffer description
+        desc_idx = desc.next;
+    }
+}
+
 bool virtq::consume_desc(i_device_state_access *a, uint16_t desc_idx, uint32_t written_len, uint16_t used_flags) {
     // Sets the used ring element desc index and written length
     virtq_used_elem used_elem{};
@@ -295,11 +371,16 @@ bool virtq::consume_desc(i_device_state_access *a, uint16_t desc_idx, uint32_t w
 }
 
 virtio_device::virtio_device(uint32_t virtio_idx, uint32_t device_id, uint64_t device_features,
-    uint32_t config_space_size) :
+    uint32_t config_space_size, uint32_t queue_count) :
     virtio_idx(virtio_idx),
     device_id(device_id),
-    device_features(device_features | VIRTIO_F_VERSION_1),
-    config_space_size(config_space_size) {}
+    device_features(device_features | VIRTIO_F_VERSION_1 | VIRTIO_F_EVENT_IDX),
+    config_space_size(config_space_size),
+    queue_count(queue_count) {
+    if (queue_count > VIRTIO_QUEUE_COUNT_MAX) {
+        throw std::invalid_argument("too many virtio device queues");
+    }
+}
 
 void virtio_device::reset(i_device_state_access *a) {
     on_device_reset();
@@ -322,6 +403,8 @@ void virtio_device::reset(i_device_state_access *a) {
         vq.num = 0;
         vq.last_used_idx = 0;
         vq.ready = 0;
+        vq.in_flight = 0;
+        vq.signalled_used_idx = 0;
     }
     // The device MUST have all queue and configuration change events unmapped upon reset.
     reset_irq(a, VIRTIO_INT_STATUS_USED_BUFFER | VIRTIO_INT_STATUS_CONFIG_CHANGE);
@@ -352,14 +435,46 @@ void virtio_device::reset_irq(i_device_state_access *a, uint32_t rem_int_status)
     }
 }
 
-void virtio_device::notify_queue_used(i_device_state_access *a) {
+void virtio_device::notify_queue_used(i_device_state_access *a, uint32_t queue_idx) {
 #if defined(DEBUG_VIRTIO)
-    (void) fprintf(stderr, "virtio[%d]: notify_queue_used\n", virtio_idx);
+    (void) fprintf(stderr, "virtio[%d]: notify_queue_used queue_idx=%d\n", virtio_idx, queue_idx);
 #endif
     // A device MUST NOT consume buffers or send any used buffer notifications to the driver before DRIVER_OK.
-    if (driver_ok) {
-        set_irq(a, VIRTIO_INT_STATUS_USED_BUFFER);
+    if (!driver_ok) {
+        return;
     }
+    assert(queue_idx < queue_count);
+    virtq &vq = queue[queue_idx];
+    if (driver_features & VIRTIO_F_EVENT_IDX) {
+        // The buffers used so far were taken, so the driver only needs to notify about the next ones
+        update_queue_avail_event(a, queue_idx);
+        // The device SHOULD NOT send a notification if the used ring index did not move past used_event
+        // since the last notification, because the driver is still processing previous used buffers.
+        const uint16_t old_used_idx = vq.signalled_used_idx;
+        vq.signalled_used_idx = vq.last_used_idx;
+        uint16_t used_event{};
+        if (virtq_get_used_event(vq, a, &used_event) &&
+            !virtq_need_event(used_event, vq.last_used_idx, old_used_idx)) {
+            return;
+        }
+    } else {
+        // The device SHOULD NOT send a notification if the driver set VIRTQ_AVAIL_F_NO_INTERRUPT
+        virtq_header avail_header{};
+        if (virtq_get_avail_header(vq, a, &avail_header) && (avail_header.flags & VIRTQ_AVAIL_F_NO_INTERRUPT)) {
+            return;
+        }
+    }
+    set_irq(a, VIRTIO_INT_STATUS_USED_BUFFER);
+}
+
+void virtio_device::update_queue_avail_event(i_device_state_access *a, uint32_t queue_idx) {
+    if (!(driver_features & VIRTIO_F_EVENT_IDX)) {
+        return;
+    }
+    assert(queue_idx < queue_count);
+    const virtq &vq = queue[queue_idx];
+    // Failing to write is harmless, the driver would just notify the device more often
+    (void) virtq_set_avail_event(vq, a, static_cast<uint16_t>(vq.last_used_idx + vq.in_flight));
 }
 
 void virtio_device::notify_device_needs_reset(i_device_state_access *a) {
@@ -393,7 +508,7 @@ bool virtio_device::prepare_queue_write(i_device_state_access *a, uint32_t queue
     *pwrite_avail_len = 0;
     // A device MUST NOT send notifications until the driver initializes the device.
     assert(driver_ok);
-    assert(queue_idx < VIRTIO_QUEUE_COUNT);
+    assert(queue_idx < queue_count);
     // Retrieve queue
     const virtq &vq = queue[queue_idx];
     // Silently ignore when the queue is not ready yet
@@ -433,7 +548,7 @@ bool virtio_device::consume_and_notify_queue(i_device_state_access *a, uint32_t
     uint32_t written_len, uint16_t used_flags) {
     // A device MUST NOT consume buffers or send any used buffer notifications to the driver before DRIVER_OK.
     assert(driver_ok);
-    assert(queue_idx < VIRTIO_QUEUE_COUNT);
+    assert(queue_idx < queue_count);
     // Retrieve queue
     virtq &vq = queue[queue_idx];
     // Consume the buffer, so the driver is free to reuse it again
@@ -445,7 +560,7 @@ bool virtio_device::consume_and_notify_queue(i_device_state_access *a, uint32_t
         queue_idx, desc_idx, written_len);
 #endif
     // After consuming a queue, we must notify the driver right-away
-    notify_queue_used(a);
+    notify_queue_used(a, queue_idx);
     return true;
 }
 
@@ -468,12 +583,13 @@ void virtio_device::on_device_queue_notify(i_device_state_access *a, uint32_t qu
         return;
     }
     const uint16_t last_avail_idx = avail_header.idx;
-    // Process all queues until we reach the last available index
-    while (vq.last_used_idx != last_avail_idx) {
+    // Process all queues until we reach the last available index,
+    // skipping buffers the device has taken but not used yet
+    while (static_cast<uint16_t>(vq.last_used_idx + vq.in_flight) != last_avail_idx) {
         // Retrieve description index for this ring element
-        const uint32_t last_used_idx = vq.last_used_idx;
+        const uint32_t next_avail_idx = static_cast<uint16_t>(vq.last_used_idx + vq.in_flight);
         uint16_t desc_idx{};
-        if (!virtq_get_ring_avail_elem_desc_idx(vq, a, last_used_idx, &desc_idx)) {
+        if (!virtq_get_ring_avail_elem_desc_idx(vq, a, next_avail_idx, &desc_idx)) {
             notify_device_needs_reset(a);
             return;
         }
@@ -485,38 +601,54 @@ void virtio_device::on_device_queue_notify(i_device_state_access *a, uint32_t qu
         }
 #if defined(DEBUG_VIRTIO)
         (void) fprintf(stderr,
-            "virtio[%d]: on_device_queue_available queue_idx=%d last_avail_idx=%d last_used_idx=%d desc_idx=%d "
+            "virtio[%d]: on_device_queue_available queue_idx=%d last_avail_idx=%d next_avail_idx=%d desc_idx=%d "
             "read_avail_len=%d write_avail_len=%d\n",
-            virtio_idx, queue_idx, last_avail_idx, last_used_idx, desc_idx, read_avail_len, write_avail_len);
+            virtio_idx, queue_idx, last_avail_idx, next_avail_idx, desc_idx, read_avail_len, write_avail_len);
 #endif
         // Process the queue
         if (!on_device_queue_available(a, queue_idx, desc_idx, read_avail_len, write_avail_len)) {
             // The device doesn't want to continue consuming this queue
             break;
         }
-        // We expect the device receive to always consume queue before continuing
-        assert(last_used_idx != vq.last_used_idx);
+        // We expect the device receive to always consume or take the buffer before continuing
+        assert(next_avail_idx != static_cast<uint16_t>(vq.last_used_idx + vq.in_flight));
     }
+    // Only ask for another notification after new buffers past the ones taken above are made available
+    update_queue_avail_event(a, queue_idx);
+    on_device_queue_drained(a, queue_idx);
 }
 
-void virtio_device::prepare_select(select_fd_sets *fds, uint64_t *timeout_us) {
-    (void) fds;
+void virtio_device::on_device_queue_drained(i_device_state_access *a, uint32_t queue_idx) {
+    (void) a;
+    (void) queue_idx;
+}
+
+void virtio_device::prepare_select(os_poller *poller, uint64_t *timeout_us) {
+    (void) poller;
     (void) timeout_us;
 }
 
-bool virtio_device::poll_selected(int select_ret, select_fd_sets *fds, i_device_state_access *da) {
+bool virtio_device::poll_selected(int select_ret, os_poller *poller, i_device_state_access *da) {
     (void) select_ret;
-    (void) fds;
+    (void) poller;
     (void) da;
     return false;
 };
 
 bool virtio_device::poll_nowait(i_device_state_access *da) {
     uint64_t timeout_us = 0;
-    return os_select_fds(
-        [&](select_fd_sets *fds, uint64_t *timeout_us) -> void { this->prepare_select(fds, timeout_us); },
-        [&](int select_ret, select_fd_sets *fds) -> bool { return this->poll_selected(select_ret, fds, da); },
-        &timeout_us);
+    const auto before_cb = [&](os_poller *poller, uint64_t *timeout_us) -> void {
+        this->prepare_select(poller, timeout_us);
+    };
+    const auto after_cb = [&](int select_ret, os_poller *poller) -> bool {
+        return this->poll_selected(select_ret, poller, da);
+    };
+    // Other devices are not taking part in this poll, so it must not drop their registrations
+    if (poller != nullptr) {
+        return poller->poll(before_cb, after_cb, &timeout_us, false);
+    }
+    os_poller standalone_poller{os_poll_backend::select};
+    return standalone_poller.poll(before_cb, after_cb, &timeout_us);
 }
 
 uint64_t virtio_device::read_shm_base(uint32_t shm_sel) {
@@ -630,11 +762,11 @@ bool virtio_device::mmio_read(i_device_state_access *a, uint64_t offset, uint32_
         case VIRTIO_MMIO_QUEUE_NUM_MAX:
             // Reading from this register returns the maximum size (number of elements) of the queue the device is ready
             // to process or zero if the queue is not available.
-            *pval = (queue_sel < VIRTIO_QUEUE_COUNT) ? static_cast<uint32_t>(VIRTIO_QUEUE_NUM_MAX) : 0;
+            *pval = (queue_sel < queue_count) ? static_cast<uint32_t>(VIRTIO_QUEUE_NUM_MAX) : 0;
             return true;
         case VIRTIO_MMIO_QUEUE_READY:
             // Reading from this register returns the last value written to it.
-            *pval = queue_sel < VIRTIO_QUEUE_COUNT ? queue[queue_sel].ready : 0;
+            *pval = queue_sel < queue_count ? queue[queue_sel].ready : 0;
             return true;
         case VIRTIO_MMIO_INTERRUPT_STATUS:
             // Reading from this register returns a bit mask of events that caused the device interrupt to be asserted.
@@ -712,20 +844,20 @@ execute_status virtio_device::mmio_write(i_device_state_access *a, uint64_t offs
         case VIRTIO_MMIO_QUEUE_NUM:
             // Writing to this register notifies the device what size of the queue the driver will use.
             // QueueSize value must always be less than QueueMax and a power of 2.
-            if (queue_sel < VIRTIO_QUEUE_COUNT && val <= VIRTIO_QUEUE_NUM_MAX && is_power_of_2(val)) {
+            if (queue_sel < queue_count && val <= VIRTIO_QUEUE_NUM_MAX && is_power_of_2(val)) {
                 queue[queue_sel].num = val;
             }
             return execute_status::success;
         case VIRTIO_MMIO_QUEUE_READY:
             // Writing one to this register notifies the device that it can execute requests from this virtual queue.
-            if (queue_sel < VIRTIO_QUEUE_COUNT) {
+            if (queue_sel < queue_count) {
                 queue[queue_sel].ready = (val == 1) ? 1 : 0;
             }
             return execute_status::success;
         case VIRTIO_MMIO_QUEUE_NOTIFY:
             // Writing a value to this register notifies the device that there are new buffers to process in a queue.
             // The value written should be the queue index.
-            if (val < VIRTIO_QUEUE_COUNT) {
+            if (val < queue_count) {
                 on_device_queue_notify(a, val);
             }
             // Most of times we will need to serve interrupts due to either used buffer or config change
@@ -767,32 +899,32 @@ execute_status virtio_device::mmio_write(i_device_state_access *a, uint64_t offs
             // We may have triggered an interrupt request
             return (int_status != 0) ? execute_status::success_and_serve_interrupts : execute_status::success;
         case VIRTIO_MMIO_QUEUE_DESC_LOW:
-            if (queue_sel < VIRTIO_QUEUE_COUNT) {
+            if (queue_sel < queue_count) {
                 set_low32(&queue[queue_sel].desc_addr, val);
             }
             return execute_status::success;
         case VIRTIO_MMIO_QUEUE_AVAIL_LOW:
-            if (queue_sel < VIRTIO_QUEUE_COUNT) {
+            if (queue_sel < queue_count) {
                 set_low32(&queue[queue_sel].avail_addr, val);
             }
             return execute_status::success;
         case VIRTIO_MMIO_QUEUE_USED_LOW:
-            if (queue_sel < VIRTIO_QUEUE_COUNT) {
+            if (queue_sel < queue_count) {
                 set_low32(&queue[queue_sel].used_addr, val);
             }
             return execute_status::success;
         case VIRTIO_MMIO_QUEUE_DESC_HIGH:
-            if (queue_sel < VIRTIO_QUEUE_COUNT) {
+            if (queue_sel < queue_count) {
                 set_high32(&queue[queue_sel].desc_addr, val);
             }
             return execute_status::success;
         case VIRTIO_MMIO_QUEUE_AVAIL_HIGH:
-            if (queue_sel < VIRTIO_QUEUE_COUNT) {
+            if (queue_sel < queue_count) {
                 set_high32(&queue[queue_sel].avail_addr, val);
             }
             return execute_status::success;
         case VIRTIO_MMIO_QUEUE_USED_HIGH:
-            if (queue_sel < VIRTIO_QUEUE_COUNT) {
+            if (queue_sel < queue_count) {
                 set_high32(&queue[queue_sel].used_addr, val);
             }
             return execute_status::success;
@@ -32,7 +32,8 @@ enum virtio_constants : uint32_t {
     VIRTIO_MAGIC_VALUE = 0x74726976, // Little-endian equivalent of the "virt" string
     VIRTIO_VERSION = 0x2,            ///< Compliance with VirtIO v1.2 specification for non-legacy devices
     VIRTIO_VENDOR_ID = 0xffff,       ///< Dummy vendor ID
-    VIRTIO_QUEUE_COUNT = 2,          ///< All devices we implement so far just need 2 queues
+    VIRTIO_QUEUE_COUNT = 2,          ///< Number of queues needed by most devices we implement
+    VIRTIO_QUEUE_COUNT_MAX = 17,     ///< Maximum number of queues in a device (8 network queue pairs and a control)
     VIRTIO_QUEUE_NUM_MAX = 128,      ///< Number of elements in queue ring, it should be at least 128 for most drivers
     VIRTIO_MAX_CONFIG_SPACE_SIZE = 256, ///< Maximum size of config space
     VIRTIO_MAX = 31,                    ///< Maximum number of virtio devices
@@ -193,14 +194,22 @@ struct virtq_used_elem {
     uint32_t len; ///< Total length of the descriptor chain which was written to.
 };
 
+/// \brief Chunk of a queue buffer, resolved to host memory
+struct virtq_iovec {
+    unsigned char *base; ///< Pointer to the chunk in host memory
+    uint32_t len;        ///< Length of the chunk
+};
+
 /// \brief VirtIO's split Virtqueue implementation
 struct virtq {
-    uint64_t desc_addr;     ///< Used for describing buffers
-    uint64_t avail_addr;    ///< Data supplied by driver to the device (available ring)
-    uint64_t used_addr;     ///< Data supplied by device to driver (used ring)
-    uint32_t num;           ///< Maximum number of elements in the queue ring
-    uint16_t last_used_idx; ///< Last used ring index, this always increment
-    uint16_t ready;         ///< Whether the queue is ready
+    uint64_t desc_addr;          ///< Used for describing buffers
+    uint64_t avail_addr;         ///< Data supplied by driver to the device (available ring)
+    uint64_t used_addr;          ///< Data supplied by device to driver (used ring)
+    uint32_t num;                ///< Maximum number of elements in the queue ring
+    uint16_t last_used_idx;      ///< Last used ring index, this always increment
+    uint16_t ready;              ///< Whether the queue is ready
+    uint16_t in_flight;          ///< Number of available buffers taken by the device that are not used yet
+    uint16_t signalled_used_idx; ///< Last used ring index when the driver was last notified
 
     /// \brief Gets how many bytes are available in queue read/write buffers.
     /// \param a The state accessor for the current device.
@@ -231,6 +240,20 @@ struct virtq {
     bool write_desc_mem(i_device_state_access *a, uint16_t desc_idx, uint32_t start_off, const unsigned char *data,
         uint32_t len) const;
 
+    /// \brief Resolves a range of a queue buffer to chunks of host memory, for zero-copy transfers.
+    /// \param a The state accessor for the current device.
+    /// \param desc_idx Index of queue's descriptor be traversed.
+    /// \param start_off Starting offset in the queue read or write buffer.
+    /// \param len Amount of bytes in range.
+    /// \param write True to resolve the write buffer, marking its pages dirty, false to resolve the read buffer.
+    /// \param iovs Receives the chunks, must have room for VIRTIO_QUEUE_NUM_MAX entries.
+    /// \param piovcnt Receives the number of chunks.
+    /// \returns True if successful, false if the range cannot be accessed directly.
+    /// \details When it fails, devices must fall back to read_desc_mem() or write_desc_mem().
+    /// The chunks are only valid until the machine state is next modified by other means.
+    bool map_desc_mem(i_device_state_access *a, uint16_t desc_idx, uint32_t start_off, uint32_t len, bool write,
+        virtq_iovec *iovs, uint32_t *piovcnt) const;
+
     /// \brief Consumes a queue buffer, marking it a used to the driver.
     /// \brief The driver will notify later when the buffer becomes available again,
     /// after it finishes processing the buffer.
@@ -258,15 +281,17 @@ protected:
     uint32_t device_status = 0;       ///< Device status mask (see virtio_status)
     uint32_t config_generation = 0;   ///< Configuration generation counter
     uint32_t config_space_size = 0;   ///< Configuration size
+    uint32_t queue_count = 0;         ///< Number of queues used by the device
     bool driver_ok = false;           ///< True when the device was successfully initialized by the driver
+    os_poller *poller = nullptr;      ///< Poller shared with the other devices of the machine, if any
 
     // Use an array of uint32 instead of uint8, to make sure we can perform 4-byte aligned reads on config space
     std::array<uint32_t, VIRTIO_MAX_CONFIG_SPACE_SIZE / sizeof(uint32_t)> config_space{}; ///< Configuration space
-    std::array<virtq, VIRTIO_QUEUE_COUNT> queue{};                                        ///< Virtqueues
+    std::array<virtq, VIRTIO_QUEUE_COUNT_MAX> queue{};                                    ///< Virtqueues
 
 public:
     explicit virtio_device(uint32_t virtio_idx, uint32_t device_id, uint64_t device_features,
-        uint32_t config_space_size);
+        uint32_t config_space_size, uint32_t queue_count = VIRTIO_QUEUE_COUNT);
     virtio_device() = delete;
     virtual ~virtio_device() = default;
     virtio_device(const virtio_device &other) = delete;
@@ -292,8 +317,11 @@ public:
     /// \details A good driver implementation will issue a reset and reinitialize the device this call.
     void notify_device_needs_reset(i_device_state_access *a);
 
-    /// \brief Notify the driver that a queue buffer has just been used.
-    void notify_queue_used(i_device_state_access *a);
+    /// \brief Notify the driver that queue buffers have just been used.
+    /// \param queue_idx Queue index with used buffers.
+    /// \details The notification is suppressed when the driver asked not to be interrupted,
+    /// either through the used_event field (VIRTIO_F_EVENT_IDX) or the VIRTQ_AVAIL_F_NO_INTERRUPT flag.
+    void notify_queue_used(i_device_state_access *a, uint32_t queue_idx);
 
     /// \brief Notify the driver that device has configuration changed.
     /// \details The driver will eventually re-read the configuration space to detect the change.
@@ -318,6 +346,13 @@ public:
     bool consume_and_notify_queue(i_device_state_access *a, uint32_t queue_idx, uint16_t desc_idx,
         uint32_t written_len = 0, uint16_t used_flags = 0);
 
+    /// \brief Asks the driver to notify the device only after it makes new buffers available past the ones
+    /// taken so far, through the avail_event field (VIRTIO_F_EVENT_IDX).
+    /// \param queue_idx Queue index.
+    /// \details Buffers the device never takes (such as receive buffers while there is no input) don't cause
+    /// further notifications. This is a no-op when VIRTIO_F_EVENT_IDX was not negotiated.
+    void update_queue_avail_event(i_device_state_access *a, uint32_t queue_idx);
+
     /// \brief Called when driver request a device reset, this function must clean-up all device internal state.
     virtual void on_device_reset() = 0;
 
@@ -333,26 +368,40 @@ public:
     /// \param desc_idx Queue's available descriptor index.
     /// \param read_avail_len Total readable length in the descriptor buffer.
     /// \param write_avail_len Total writable length in the descriptor buffer.
+    /// \returns True to continue with the next available descriptor, false to stop.
+    /// \details Returning true requires the descriptor to be either consumed or taken in flight,
+    /// by incrementing the queue in_flight counter, to be consumed later and out of order.
     virtual bool on_device_queue_available(i_device_state_access *a, uint32_t queue_idx, uint16_t desc_idx,
         uint32_t read_avail_len, uint32_t write_avail_len) = 0;
 
-    /// \brief Fill file descriptors to be polled by select().
-    /// \param fds Pointer to sets of read, write and except file descriptors to be updated.
+    /// \brief Called after all descriptors made available by a driver notification were processed.
+    /// \param queue_idx Queue index that was notified.
+    /// \details Devices that consume buffers without notifying the driver can notify it here once per batch.
+    virtual void on_device_queue_drained(i_device_state_access *a, uint32_t queue_idx);
+
+    /// \brief Register or renew interest in file descriptors to be polled.
+    /// \param poller Poller to register file descriptors in.
     /// \param timeout_us Maximum amount of time to wait, this may be updated (always to lower values).
-    virtual void prepare_select(select_fd_sets *fds, uint64_t *timeout_us);
+    /// \details Registrations persist across polls, but must be renewed on every poll or they are dropped.
+    virtual void prepare_select(os_poller *poller, uint64_t *timeout_us);
 
-    /// \brief Poll file descriptors that were marked as ready by select().
-    /// \param select_ret Return value from the most recent select() call.
-    /// \param fds Pointer to sets of read, write and except file descriptors to be checked.
+    /// \brief Poll file descriptors that were marked as ready.
+    /// \param select_ret Return value from the most recent poll.
+    /// \param poller Poller holding ready file descriptors.
     /// \returns True if an interrupt was requested, false otherwise.
     /// \details This function process pending events and trigger interrupt requests (if any).
-    virtual bool poll_selected(int select_ret, select_fd_sets *fds, i_device_state_access *da);
+    virtual bool poll_selected(int select_ret, os_poller *poller, i_device_state_access *da);
 
     /// \brief Poll pending events without waiting (non-blocking).
-    /// \details Basically call prepare_select(), select() and poll_selected() with timeout set to 0.
+    /// \details Basically call prepare_select(), wait and poll_selected() with timeout set to 0.
     /// \returns True if an interrupt was requested, false otherwise.
     bool poll_nowait(i_device_state_access *da);
 
+    /// \brief Sets the poller shared with the other devices of the machine, used by poll_nowait().
+    void set_poller(os_poller *p) {
+        poller = p;
+    }
+
     /// \brief Reads device's shared memory base address.
     /// \returns Guest a valid physical address, or -1 in case shared memory is not supported by the device.
     virtual uint64_t read_shm_base(uint32_t shm_sel);
@@ -70,7 +70,7 @@ namespace cartesi {
 static ssize_t slirp_send_packet(const void *buf, size_t len, void *opaque) {
     // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
     virtio_net_carrier_slirp *carrier = reinterpret_cast<virtio_net_carrier_slirp *>(opaque);
-    if (carrier->send_packets.size() >= SLIRP_MAX_PENDING_PACKETS) {
+    if (carrier->send_packets.full()) {
         // Too many send_packets in the write queue, we can just drop it.
         // Network re-transmission can recover from this.
 #ifdef DEBUG_VIRTIO_ERRORS
@@ -88,17 +88,11 @@ static ssize_t slirp_send_packet(const void *buf, size_t len, void *opaque) {
     }
     // Add packet to the send packet queue,
     // the packet will actually be sent only the next time the device calls read_packet()
-    slirp_packet packet{len};
+    slirp_packet &packet = carrier->send_packets.back_slot();
+    packet.len = len;
     memcpy(packet.buf.data(), buf, len);
-    try {
-        carrier->send_packets.emplace_back(std::move(packet));
-        return static_cast<ssize_t>(len);
-    } catch (...) {
-#ifdef DEBUG_VIRTIO_ERRORS
-        (void) fprintf(stderr, "slirp: exception thrown while adding a send packet\n");
-#endif
-        return 0;
-    }
+    carrier->send_packets.push();
+    return static_cast<ssize_t>(len);
 }
 
 static void slirp_guest_error(const char *msg, void *opaque) {
@@ -158,13 +152,16 @@ static void slirp_timer_mod(void *timer_ptr, int64_t expire_timer_msec, void *op
 static void slirp_register_poll_fd(int fd, void *opaque) {
     (void) fd;
     (void) opaque;
-    // Nothing to do, this callback is only useful on implementations using poll() instead of select().
+    // Nothing to do, sockets are registered in the poller when slirp asks for them to be polled.
 }
 
 static void slirp_unregister_poll_fd(int fd, void *opaque) {
-    (void) fd;
-    (void) opaque;
-    // Nothing to do, this callback is only useful on implementations using poll() instead of select().
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+    virtio_net_carrier_slirp *carrier = reinterpret_cast<virtio_net_carrier_slirp *>(opaque);
+    // Slirp is closing the socket, so its number may be reused by another socket
+    if (carrier->poller) {
+        carrier->poller->unwatch(fd);
+    }
 }
 
 static void slirp_notify(void *opaque) {
@@ -234,80 +231,69 @@ void virtio_net_carrier_slirp::reset() {
     // Nothing to do, we don't want to reset slirp to not lose network state.
 }
 
-struct slirp_select_fds {
-    int *pmaxfd;
-    fd_set *readfds;
-    fd_set *writefds;
-    fd_set *exceptfds;
-};
-
 static int slirp_add_poll_cb(int fd, int events, void *opaque) {
     // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
-    slirp_select_fds *fds = reinterpret_cast<slirp_select_fds *>(opaque);
+    os_poller *poller = reinterpret_cast<os_poller *>(opaque);
+    uint32_t poll_events = 0;
     if (events & SLIRP_POLL_IN) {
-        FD_SET(fd, fds->readfds);
+        poll_events |= OS_POLL_IN;
     }
     if (events & SLIRP_POLL_OUT) {
-        FD_SET(fd, fds->writefds);
+        poll_events |= OS_POLL_OUT;
     }
     if (events & SLIRP_POLL_PRI) {
-        FD_SET(fd, fds->exceptfds);
-    }
-    if (fd > *fds->pmaxfd) {
-        *fds->pmaxfd = fd;
+        poll_events |= OS_POLL_PRI;
     }
+    poller->watch(fd, poll_events);
     return fd;
 }
 
 static int slirp_get_revents_cb(int fd, void *opaque) {
     // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
-    slirp_select_fds *fds = reinterpret_cast<slirp_select_fds *>(opaque);
+    const os_poller *poller = reinterpret_cast<const os_poller *>(opaque);
+    const uint32_t ready = poller->get_ready(fd);
     int event = 0;
-    if (FD_ISSET(fd, fds->readfds)) {
+    if (ready & OS_POLL_IN) {
         event |= SLIRP_POLL_IN;
     }
-    if (FD_ISSET(fd, fds->writefds)) {
+    if (ready & OS_POLL_OUT) {
         event |= SLIRP_POLL_OUT;
     }
-    if (FD_ISSET(fd, fds->exceptfds)) {
+    if (ready & OS_POLL_PRI) {
         event |= SLIRP_POLL_PRI;
     }
+    if (ready & OS_POLL_ERR) {
+        event |= SLIRP_POLL_ERR;
+    }
+    if (ready & OS_POLL_HUP) {
+        event |= SLIRP_POLL_HUP;
+    }
     return event;
 }
 
-void virtio_net_carrier_slirp::do_prepare_select(select_fd_sets *fds, uint64_t *timeout_us) {
+void virtio_net_carrier_slirp::do_prepare_select(os_poller *poller, uint64_t *timeout_us) {
     // Did device reset and slirp failed to reinitialize?
     if (!slirp) {
         return;
     }
-    // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
-    fd_set *readfds = reinterpret_cast<fd_set *>(fds->readfds);
-    // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
-    fd_set *writefds = reinterpret_cast<fd_set *>(fds->writefds);
-    // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
-    fd_set *exceptfds = reinterpret_cast<fd_set *>(fds->exceptfds);
-    slirp_select_fds slirp_fds{&fds->maxfd, readfds, writefds, exceptfds};
+    // Remember the poller, so sockets closed by slirp can be unregistered from it
+    this->poller = poller;
     const uint32_t initial_timeout_ms = *timeout_us / 1000;
     uint32_t timeout_ms = initial_timeout_ms;
-    slirp_pollfds_fill(slirp, &timeout_ms, slirp_add_poll_cb, &slirp_fds);
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+    slirp_pollfds_fill(slirp, &timeout_ms, slirp_add_poll_cb, reinterpret_cast<void *>(poller));
     if (initial_timeout_ms != timeout_ms) {
         *timeout_us = static_cast<uint64_t>(timeout_ms) * 1000;
     }
 }
 
-bool virtio_net_carrier_slirp::do_poll_selected(int select_ret, select_fd_sets *fds) {
+bool virtio_net_carrier_slirp::do_poll_selected(int select_ret, os_poller *poller) {
     // Did device reset and slirp failed to reinitialize?
     if (!slirp) {
         return false;
     }
     // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
-    fd_set *readfds = reinterpret_cast<fd_set *>(fds->readfds);
-    // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
-    fd_set *writefds = reinterpret_cast<fd_set *>(fds->writefds);
-    // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
-    fd_set *exceptfds = reinterpret_cast<fd_set *>(fds->exceptfds);
-    slirp_select_fds slirp_fds{nullptr, readfds, writefds, exceptfds};
-    slirp_pollfds_poll(slirp, select_ret < 0, slirp_get_revents_cb, &slirp_fds);
+    slirp_pollfds_poll(slirp, select_ret < 0, slirp_get_revents_cb, reinterpret_cast<void *>(poller));
     // Fire expired timers
     const int64_t now_ms = slirp_clock_get_ns(nullptr) / 1000000;
     for (slirp_timer *timer : timers) {
@@ -322,8 +308,10 @@ bool virtio_net_carrier_slirp::do_poll_selected(int select_ret, select_fd_sets *
     return !send_packets.empty();
 }
 
-bool virtio_net_carrier_slirp::write_packet_to_host(i_device_state_access *a, virtq &vq, uint16_t desc_idx,
-    uint32_t read_avail_len, uint32_t *pread_len) {
+bool virtio_net_carrier_slirp::write_packet_to_host(i_device_state_access *a, uint32_t queue_pair, virtq &vq,
+    uint16_t desc_idx, uint32_t read_avail_len, uint32_t *pread_len) {
+    // Slirp has a single queue pair
+    (void) queue_pair;
     // Did device reset and slirp failed to reinitialize?
     if (!slirp) {
         // Just drop it.
@@ -340,27 +328,37 @@ bool virtio_net_carrier_slirp::write_packet_to_host(i_device_state_access *a, vi
 #endif
         return true;
     }
-    slirp_packet packet{packet_len};
-    if (!vq.read_desc_mem(a, desc_idx, VIRTIO_NET_ETHERNET_FRAME_OFFSET, packet.buf.data(), packet.len)) {
-        // Failure while accessing guest memory, the driver or guest messed up, return false to reset the device.
-        return false;
+    // Hand the packet to slirp straight from guest memory when it is contiguous in the host,
+    // otherwise gather it into the scratch buffer
+    std::array<virtq_iovec, VIRTIO_QUEUE_NUM_MAX> iovs{};
+    uint32_t iovcnt = 0;
+    if (vq.map_desc_mem(a, desc_idx, VIRTIO_NET_ETHERNET_FRAME_OFFSET, packet_len, false, iovs.data(), &iovcnt) &&
+        iovcnt == 1) {
+        slirp_input(slirp, iovs[0].base, static_cast<int>(packet_len));
+    } else {
+        if (!vq.read_desc_mem(a, desc_idx, VIRTIO_NET_ETHERNET_FRAME_OFFSET, recv_packet.buf.data(), packet_len)) {
+            // Failure while accessing guest memory, the driver or guest messed up, return false to reset the device.
+            return false;
+        }
+        slirp_input(slirp, recv_packet.buf.data(), static_cast<int>(packet_len));
     }
-    slirp_input(slirp, packet.buf.data(), static_cast<int>(packet.len));
     // Packet was read and the queue is ready to be consumed.
     *pread_len = read_avail_len;
     return true;
 }
 
-bool virtio_net_carrier_slirp::read_packet_from_host(i_device_state_access *a, virtq &vq, uint16_t desc_idx,
-    uint32_t write_avail_len, uint32_t *pwritten_len) {
+bool virtio_net_carrier_slirp::read_packet_from_host(i_device_state_access *a, uint32_t queue_pair, virtq &vq,
+    uint16_t desc_idx, uint32_t write_avail_len, uint32_t *pwritten_len) {
+    (void) queue_pair;
     // If no packet was send by slirp, we can just ignore.
     if (send_packets.empty()) {
         *pwritten_len = 0;
         return true;
     }
     // Retrieve the next packet sent by slirp.
-    slirp_packet packet = std::move(send_packets.front());
-    send_packets.pop_front();
+    // The packet is dropped from the queue even when it cannot be written.
+    const slirp_packet &packet = send_packets.front();
+    send_packets.pop();
     // Is there enough space in the write buffer to write this packet?
     if (VIRTIO_NET_ETHERNET_FRAME_OFFSET + packet.len > write_avail_len) {
 #ifdef DEBUG_VIRTIO_ERRORS
@@ -24,8 +24,9 @@
 #include "machine-config.h"
 #include "virtio-net.h"
 
-#include <list>
+#include <array>
 #include <unordered_set>
+#include <vector>
 
 #include <slirp/libslirp.h>
 
@@ -61,13 +62,56 @@ struct slirp_packet {
     std::array<unsigned char, VIRTIO_NET_ETHERNET_MAX_LENGTH> buf{};
 };
 
+/// \brief Fixed capacity FIFO of packets sent by slirp and waiting to be written to the guest
+/// \details All slots are allocated once, so queueing a packet never allocates and never throws.
+class slirp_packet_ring {
+    std::vector<slirp_packet> m_slots; ///< Preallocated packet slots
+    size_t m_head{0};                  ///< Index of the oldest packet
+    size_t m_count{0};                 ///< Number of queued packets
+
+public:
+    explicit slirp_packet_ring(size_t capacity) : m_slots(capacity) {}
+
+    bool empty() const {
+        return m_count == 0;
+    }
+
+    bool full() const {
+        return m_count == m_slots.size();
+    }
+
+    /// \brief Returns the slot that will hold the next queued packet
+    /// \details The packet is only queued after a call to push().
+    slirp_packet &back_slot() {
+        return m_slots[(m_head + m_count) % m_slots.size()];
+    }
+
+    /// \brief Queues the packet written to back_slot()
+    void push() {
+        ++m_count;
+    }
+
+    /// \brief Returns the oldest packet
+    const slirp_packet &front() const {
+        return m_slots[m_head];
+    }
+
+    /// \brief Removes the oldest packet
+    void pop() {
+        m_head = (m_head + 1) % m_slots.size();
+        --m_count;
+    }
+};
+
 class virtio_net_carrier_slirp final : public virtio_net_carrier {
 public:
     Slirp *slirp = nullptr;
     SlirpConfig slirp_cfg{};
     SlirpCb slirp_cbs{};
-    std::list<slirp_packet> send_packets;
+    slirp_packet_ring send_packets{SLIRP_MAX_PENDING_PACKETS};
+    slirp_packet recv_packet; ///< Scratch buffer for guest packets scattered across descriptors
     std::unordered_set<slirp_timer *> timers;
+    os_poller *poller = nullptr;
 
     virtio_net_carrier_slirp(const cartesi::virtio_net_user_config &config);
     ~virtio_net_carrier_slirp() override;
@@ -78,13 +122,13 @@ public:
 
     void reset() override;
 
-    void do_prepare_select(select_fd_sets *fds, uint64_t *timeout_us) override;
-    bool do_poll_selected(int select_ret, select_fd_sets *fds) override;
+    void do_prepare_select(os_poller *poller, uint64_t *timeout_us) override;
+    bool do_poll_selected(int select_ret, os_poller *poller) override;
 
-    bool write_packet_to_host(i_device_state_access *a, virtq &vq, uint16_t desc_idx, uint32_t read_avail_len,
-        uint32_t *pread_len) override;
-    bool read_packet_from_host(i_device_state_access *a, virtq &vq, uint16_t desc_idx, uint32_t write_avail_len,
-        uint32_t *pwritten_len) override;
+    bool write_packet_to_host(i_device_state_access *a, uint32_t queue_pair, virtq &vq, uint16_t desc_idx,
+        uint32_t read_avail_len, uint32_t *pread_len) override;
+    bool read_packet_from_host(i_device_state_access *a, uint32_t queue_pair, virtq &vq, uint16_t desc_idx,
+        uint32_t write_avail_len, uint32_t *pwritten_len) override;
 };
 
 } // namespace cartesi
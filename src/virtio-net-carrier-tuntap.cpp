@@ -36,6 +36,10 @@
 ///
 /// In the example above the host public internet interface is eth0, but this depends in the host.
 ///
+/// To use several queue pairs, create the tap interface with the multi_queue option:
+///
+///   ip tuntap add dev tap0 mode tap multi_queue user $USER
+///
 /// Finally start the machine with using tap0 network carrier and
 /// execute the following commands in the guest with root privilege:
 ///
@@ -56,12 +60,18 @@
 
 #ifdef HAVE_TUNTAP
 
+#include <algorithm>
 #include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <system_error>
 
 #include <fcntl.h>
 #include <net/if.h>
+#include <poll.h>
 #include <sched.h>
 #include <sys/ioctl.h>
+#include <sys/uio.h>
 #include <unistd.h>
 
 // Include TUN/TAP headers
@@ -70,39 +80,132 @@
 constexpr const char NET_TUN_DEV[] = "/dev/net/tun";
 #else // Other platform, most likely MacOS or FreeBSD
 #define IFF_TAP 0x0002
-#define IFF_NO_PI 0x1000 // Don't provide packet info
+#define IFF_NO_PI 0x1000        // Don't provide packet info
+#define IFF_MULTI_QUEUE 0x0100 // Attach one of several queues of the interface
 #define TUNSETIFF _IOW('T', 202, int)
 constexpr const char NET_TUN_DEV[] = "/dev/tun";
 #endif
 
 namespace cartesi {
 
-virtio_net_carrier_tuntap::virtio_net_carrier_tuntap(const std::string &tap_name) {
-    // Open the tun device
-    const int flags = O_RDWR | // Read/write
-        O_NONBLOCK |           // Read/write should never block
-        O_DSYNC;               // Flush packets right-away upon write
-    const int fd = open(NET_TUN_DEV, flags);
-    if (fd < 0) {
-        throw std::runtime_error(
-            std::string("could not open tun network device '") + NET_TUN_DEV + "': " + strerror(errno));
-    }
-    // Set the tap network interface
-    ifreq ifr{};
-    ifr.ifr_flags = IFF_TAP | // TAP device
-        IFF_NO_PI;            // Do not provide packet information
-    strncpy(ifr.ifr_name, tap_name.c_str(), sizeof(ifr.ifr_name));
-    if (ioctl(fd, TUNSETIFF, &ifr) != 0) {
-        close(fd);
-        throw std::runtime_error(
-            std::string("could not configure tap network device '") + tap_name + "': " + strerror(errno));
-    }
-    m_tapfd = fd;
+#ifdef HAVE_THREADS
+/// \brief Creates a pipe whose ends never block
+static bool open_nonblocking_pipe(std::array<int, 2> &fds) {
+    if (pipe(fds.data()) < 0) {
+        return false;
+    }
+    for (const int fd : fds) {
+        (void) fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+        (void) fcntl(fd, F_SETFD, FD_CLOEXEC);
+    }
+    return true;
+}
+
+/// \brief Reads all bytes written to a non-blocking pipe
+static void drain_pipe(int fd) {
+    std::array<unsigned char, 256> drain{};
+    while (read(fd, drain.data(), drain.size()) > 0) {
+    }
+}
+#endif
+
+virtio_net_carrier_tuntap::virtio_net_carrier_tuntap(const std::string &tap_name, uint32_t queue_pairs) {
+    if (queue_pairs < 1 || queue_pairs > VIRTIO_NET_QUEUE_PAIRS_MAX) {
+        throw std::invalid_argument("tap network device queue pairs must be between 1 and " +
+            std::to_string(VIRTIO_NET_QUEUE_PAIRS_MAX));
+    }
+    m_queue_pairs.reserve(queue_pairs);
+    for (uint32_t i = 0; i < queue_pairs; ++i) {
+        m_queue_pairs.push_back(std::make_unique<tuntap_queue_pair>());
+        // Open the tun device
+        const int flags = O_RDWR | // Read/write
+            O_NONBLOCK |           // Read/write should never block
+            O_DSYNC;               // Flush packets right-away upon write
+        const int fd = open(NET_TUN_DEV, flags);
+        if (fd < 0) {
+            const int error = errno;
+            close_all();
+            throw std::runtime_error(
+                std::string("could not open tun network device '") + NET_TUN_DEV + "': " + strerror(error));
+        }
+        m_queue_pairs.back()->fd = fd;
+        // Set the tap network interface, each queue pair attaching to its own queue of the interface
+        ifreq ifr{};
+        ifr.ifr_flags = IFF_TAP | // TAP device
+            IFF_NO_PI;            // Do not provide packet information
+        if (queue_pairs > 1) {
+            ifr.ifr_flags |= IFF_MULTI_QUEUE; // Attach to one of several queues of the interface
+        }
+        strncpy(ifr.ifr_name, tap_name.c_str(), sizeof(ifr.ifr_name));
+        if (ioctl(fd, TUNSETIFF, &ifr) != 0) {
+            const int error = errno;
+            close_all();
+            throw std::runtime_error(
+                std::string("could not configure tap network device '") + tap_name + "': " + strerror(error));
+        }
+    }
+#ifdef HAVE_THREADS
+    // Threads report received packets through a pipe, so the machine wakes up from WFI while polling devices
+    if (!open_nonblocking_pipe(m_ready_pipe)) {
+        const int error = errno;
+        close_all();
+        throw std::system_error{error, std::generic_category(), "could not create tap network device pipe"};
+    }
+    for (auto &qp : m_queue_pairs) {
+        if (!open_nonblocking_pipe(qp->wake_pipe)) {
+            const int error = errno;
+            close_all();
+            throw std::system_error{error, std::generic_category(), "could not create tap network device pipe"};
+        }
+    }
+    for (auto &qp : m_queue_pairs) {
+        qp->thread = std::thread([this, &qp = *qp] { work(qp); });
+    }
+#endif
 }
 
 virtio_net_carrier_tuntap::~virtio_net_carrier_tuntap() {
-    if (m_tapfd != -1) {
-        close(m_tapfd);
+#ifdef HAVE_THREADS
+    m_stopping = true;
+    for (auto &qp : m_queue_pairs) {
+        if (qp->thread.joinable()) {
+            wake_up(*qp);
+            qp->thread.join();
+        }
+    }
+#endif
+    close_all();
+}
+
+void virtio_net_carrier_tuntap::close_all() {
+#ifdef HAVE_THREADS
+    if (m_poller != nullptr && m_ready_pipe[0] >= 0) {
+        m_poller->unwatch(m_ready_pipe[0]);
+    }
+    for (int &fd : m_ready_pipe) {
+        if (fd >= 0) {
+            close(fd);
+            fd = -1;
+        }
+    }
+#endif
+    for (auto &qp : m_queue_pairs) {
+#ifdef HAVE_THREADS
+        for (int &fd : qp->wake_pipe) {
+            if (fd >= 0) {
+                close(fd);
+                fd = -1;
+            }
+        }
+#else
+        if (m_poller != nullptr && qp->fd >= 0) {
+            m_poller->unwatch(qp->fd);
+        }
+#endif
+        if (qp->fd >= 0) {
+            close(qp->fd);
+            qp->fd = -1;
+        }
     }
 }
 
@@ -110,24 +213,118 @@ void virtio_net_carrier_tuntap::reset() {
     // Nothing to do.
 }
 
-void virtio_net_carrier_tuntap::do_prepare_select(select_fd_sets *fds, uint64_t *timeout_us) {
+void virtio_net_carrier_tuntap::do_prepare_select(os_poller *poller, uint64_t *timeout_us) {
     (void) timeout_us;
-    // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
-    fd_set *readfds = reinterpret_cast<fd_set *>(fds->readfds);
-    FD_SET(m_tapfd, readfds);
-    if (m_tapfd > fds->maxfd) {
-        fds->maxfd = m_tapfd;
+    // Remember the poller, so file descriptors can be unregistered from it when closed
+    m_poller = poller;
+#ifdef HAVE_THREADS
+    poller->watch(m_ready_pipe[0], OS_POLL_IN);
+#else
+    for (const auto &qp : m_queue_pairs) {
+        poller->watch(qp->fd, OS_POLL_IN);
+    }
+#endif
+}
+
+bool virtio_net_carrier_tuntap::do_poll_selected(int select_ret, os_poller *poller) {
+#ifdef HAVE_THREADS
+    if (select_ret > 0 && (poller->get_ready(m_ready_pipe[0]) & OS_POLL_IN) != 0) {
+        // Take wake ups before looking at the rings, so no packet is left without a wake up
+        m_ready_pending = false;
+        drain_pipe(m_ready_pipe[0]);
     }
+    // Packets left behind by a previous poll are also pending
+    return std::any_of(m_queue_pairs.begin(), m_queue_pairs.end(),
+        [](const auto &qp) { return !qp->rx_ring.empty() || qp->failed; });
+#else
+    return select_ret > 0 && std::any_of(m_queue_pairs.begin(), m_queue_pairs.end(), [poller](const auto &qp) {
+        return (poller->get_ready(qp->fd) & OS_POLL_IN) != 0;
+    });
+#endif
 }
 
-bool virtio_net_carrier_tuntap::do_poll_selected(int select_ret, select_fd_sets *fds) {
-    // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
-    fd_set *readfds = reinterpret_cast<fd_set *>(fds->readfds);
-    return select_ret > 0 && FD_ISSET(m_tapfd, readfds);
+#ifdef HAVE_THREADS
+void virtio_net_carrier_tuntap::wake_up(tuntap_queue_pair &qp) {
+    // The pipe is non-blocking, a full pipe already has wake ups pending
+    if (!qp.wake_pending.exchange(true)) {
+        const unsigned char wakeup = 0;
+        (void) write(qp.wake_pipe[1], &wakeup, 1);
+    }
 }
 
-bool virtio_net_carrier_tuntap::write_packet_to_host(i_device_state_access *a, virtq &vq, uint16_t desc_idx,
-    uint32_t read_avail_len, uint32_t *pread_len) {
+void virtio_net_carrier_tuntap::work(tuntap_queue_pair &qp) {
+    const auto fail = [this, &qp] {
+        // Report the failure to the interpreter, which resets the device
+        qp.failed = true;
+        const unsigned char wakeup = 0;
+        (void) write(m_ready_pipe[1], &wakeup, 1);
+    };
+    while (!m_stopping) {
+        // Take wake ups before looking at the rings, so no packet is left without a wake up
+        qp.wake_pending = false;
+        drain_pipe(qp.wake_pipe[0]);
+        // Write packets sent by the guest to the tap, until it would block
+        bool tx_blocked = false;
+        while (const tuntap_packet *packet = qp.tx_ring.front()) {
+            if (write(qp.fd, packet->buf.data(), packet->len) < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                if (errno == EAGAIN) {
+                    tx_blocked = true;
+                    break;
+                }
+                fail();
+                return;
+            }
+            qp.tx_ring.pop();
+        }
+        // Read packets from the tap for the guest, until there are no more or the ring is full
+        bool received = false;
+        while (tuntap_packet *packet = qp.rx_ring.back()) {
+            const ssize_t len = read(qp.fd, packet->buf.data(), packet->buf.size());
+            if (len < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                if (errno == EAGAIN) {
+                    break;
+                }
+                fail();
+                return;
+            }
+            if (len == 0) {
+                break;
+            }
+            // Packets filling the whole buffer may have been truncated, drop them
+            if (static_cast<size_t>(len) == packet->buf.size()) {
+#ifdef DEBUG_VIRTIO_ERRORS
+                (void) fprintf(stderr, "tun: dropped large packet sent by the host\n");
+#endif
+                continue;
+            }
+            packet->len = static_cast<uint32_t>(len);
+            qp.rx_ring.push();
+            received = true;
+        }
+        if (received && !m_ready_pending.exchange(true)) {
+            const unsigned char wakeup = 0;
+            (void) write(m_ready_pipe[1], &wakeup, 1);
+        }
+        // Wait for the tap, or for the interpreter to send packets or to free slots in the receive ring
+        std::array<pollfd, 2> fds{};
+        fds[0].fd = qp.fd;
+        fds[0].events = static_cast<short>((qp.rx_ring.full() ? 0 : POLLIN) | (tx_blocked ? POLLOUT : 0));
+        fds[1].fd = qp.wake_pipe[0];
+        fds[1].events = POLLIN;
+        (void) poll(fds.data(), fds.size(), -1);
+    }
+}
+#endif
+
+bool virtio_net_carrier_tuntap::write_packet_to_host(i_device_state_access *a, uint32_t queue_pair, virtq &vq,
+    uint16_t desc_idx, uint32_t read_avail_len, uint32_t *pread_len) {
+    tuntap_queue_pair &qp = *m_queue_pairs[queue_pair];
     // Determinate packet size
     const uint32_t packet_len = read_avail_len - VIRTIO_NET_ETHERNET_FRAME_OFFSET;
     if (packet_len > VIRTIO_NET_ETHERNET_MAX_LENGTH) {
@@ -139,20 +336,57 @@ bool virtio_net_carrier_tuntap::write_packet_to_host(i_device_state_access *a, v
 #endif
         return true;
     }
-    // Read packet from queue buffer
-    std::array<uint8_t, VIRTIO_NET_ETHERNET_MAX_LENGTH> packet_buf{};
-    if (!vq.read_desc_mem(a, desc_idx, VIRTIO_NET_ETHERNET_FRAME_OFFSET, packet_buf.data(), packet_len)) {
+#ifdef HAVE_THREADS
+    if (qp.failed) {
+        // Unexpected tap error, return false to reset the device.
+        return false;
+    }
+    // Hand the packet to the queue pair thread
+    tuntap_packet *packet = qp.tx_ring.back();
+    if (packet == nullptr) {
+        // Too many packets waiting to be written to the tap, just drop it.
+        // Network re-transmission can recover from this.
+        *pread_len = 0;
+#ifdef DEBUG_VIRTIO_ERRORS
+        (void) fprintf(stderr, "tun: dropped packet sent by the guest because the write queue is full\n");
+#endif
+        return true;
+    }
+    if (!vq.read_desc_mem(a, desc_idx, VIRTIO_NET_ETHERNET_FRAME_OFFSET, packet->buf.data(), packet_len)) {
         // Failure while accessing guest memory, the driver or guest messed up, return false to reset the device.
         return false;
     }
+    packet->len = packet_len;
+    qp.tx_ring.push();
+    wake_up(qp);
+#else
+    // Gather the packet straight from guest memory when possible
+    std::array<virtq_iovec, VIRTIO_QUEUE_NUM_MAX> viovs{};
+    std::array<iovec, VIRTIO_QUEUE_NUM_MAX> iovs{};
+    std::array<uint8_t, VIRTIO_NET_ETHERNET_MAX_LENGTH> packet_buf{};
+    uint32_t iovcnt = 0;
+    if (vq.map_desc_mem(a, desc_idx, VIRTIO_NET_ETHERNET_FRAME_OFFSET, packet_len, false, viovs.data(), &iovcnt)) {
+        for (uint32_t i = 0; i < iovcnt; ++i) {
+            iovs[i].iov_base = viovs[i].base;
+            iovs[i].iov_len = viovs[i].len;
+        }
+    } else {
+        // Otherwise, read packet from queue buffer
+        if (!vq.read_desc_mem(a, desc_idx, VIRTIO_NET_ETHERNET_FRAME_OFFSET, packet_buf.data(), packet_len)) {
+            // Failure while accessing guest memory, the driver or guest messed up, return false to reset the device.
+            return false;
+        }
+        iovs[0].iov_base = packet_buf.data();
+        iovs[0].iov_len = packet_len;
+        iovcnt = packet_len > 0 ? 1 : 0;
+    }
     // Keep writing until all packet bytes are written
-    uint32_t written_packet_len = 0;
-    while (written_packet_len < packet_len) {
-        // Set errno to zero because write() may not set it when its return is zero
+    uint32_t iov_idx = 0;
+    while (iov_idx < iovcnt) {
+        // Set errno to zero because writev() may not set it when its return is zero
         errno = 0;
         // Write to the network interface
-        const ssize_t written_len =
-            write(m_tapfd, packet_buf.data() + written_packet_len, packet_len - written_packet_len);
+        const ssize_t written_len = writev(qp.fd, &iovs[iov_idx], static_cast<int>(iovcnt - iov_idx));
         if (written_len <= 0) {
             // Retry again when the operation would block or was interrupted
             if (errno == EAGAIN || errno == EINTR) {
@@ -160,26 +394,96 @@ bool virtio_net_carrier_tuntap::write_packet_to_host(i_device_state_access *a, v
                 // so we avoid consuming host CPU resources in this infinite loop,
                 // ??E: We could also use a usleep() here when sched_yield() is not supported.
                 sched_yield();
-            } else {
-                // Unexpected error, return false to reset the device.
-                return false;
+                continue;
             }
+            // Unexpected error, return false to reset the device.
+            return false;
+        }
+        // Skip chunks that were fully written and advance into a partially written one
+        auto left = static_cast<size_t>(written_len);
+        while (iov_idx < iovcnt && left >= iovs[iov_idx].iov_len) {
+            left -= iovs[iov_idx].iov_len;
+            ++iov_idx;
+        }
+        if (left > 0) {
+            iovs[iov_idx].iov_base = static_cast<uint8_t *>(iovs[iov_idx].iov_base) + left;
+            iovs[iov_idx].iov_len -= left;
         }
-        written_packet_len += static_cast<uint32_t>(written_len);
     }
+#endif
     // Packet was read and the queue is ready to be consumed.
     *pread_len = read_avail_len;
     return true;
 }
 
-bool virtio_net_carrier_tuntap::read_packet_from_host(i_device_state_access *a, virtq &vq, uint16_t desc_idx,
-    uint32_t write_avail_len, uint32_t *pwritten_len) {
-    // Write network to queue buffer in chunks
+bool virtio_net_carrier_tuntap::read_packet_from_host(i_device_state_access *a, uint32_t queue_pair, virtq &vq,
+    uint16_t desc_idx, uint32_t write_avail_len, uint32_t *pwritten_len) {
+    tuntap_queue_pair &qp = *m_queue_pairs[queue_pair];
+#ifdef HAVE_THREADS
+    if (qp.failed) {
+        // Unexpected tap error, return false to reset the device.
+        return false;
+    }
+    // Take the next packet read by the queue pair thread
+    const tuntap_packet *packet = qp.rx_ring.front();
+    if (packet == nullptr) {
+        // There is no packet available.
+        *pwritten_len = 0;
+        return true;
+    }
+    const uint32_t packet_len = packet->len;
+    // Is there enough space in the write buffer to write this packet?
+    const bool fits = VIRTIO_NET_ETHERNET_FRAME_OFFSET + packet_len <= write_avail_len;
+    if (fits && !vq.write_desc_mem(a, desc_idx, VIRTIO_NET_ETHERNET_FRAME_OFFSET, packet->buf.data(), packet_len)) {
+        // Failure while accessing guest memory, the driver or guest messed up, return false to reset the device.
+        return false;
+    }
+    // The thread stops reading from the tap while the ring is full, so wake it up when freeing a slot
+    const bool was_full = qp.rx_ring.full();
+    qp.rx_ring.pop();
+    if (was_full) {
+        wake_up(qp);
+    }
+    if (!fits) {
+#ifdef DEBUG_VIRTIO_ERRORS
+        (void) fprintf(stderr, "tun: dropped large packet with length %u sent by the host\n",
+            static_cast<unsigned int>(packet_len));
+#endif
+        // Despite being a failure, return true to only drop the packet, we don't want to reset the device.
+        *pwritten_len = 0;
+        return true;
+    }
+#else
+    // Scatter the packet straight into guest memory when possible, with a host buffer after it
+    // receiving the tail of packets larger than the queue buffer, so they can be detected and dropped
+    std::array<virtq_iovec, VIRTIO_QUEUE_NUM_MAX> viovs{};
+    std::array<iovec, VIRTIO_QUEUE_NUM_MAX + 1> iovs{};
     std::array<uint8_t, VIRTIO_NET_ETHERNET_MAX_LENGTH> packet_buf{};
-    // Set errno to zero because read() will not set it when it returns zero (end of file)
+    uint32_t iovcnt = 0;
+    uint32_t direct_len = 0;
+    if (write_avail_len > VIRTIO_NET_ETHERNET_FRAME_OFFSET) {
+        direct_len = std::min<uint32_t>(write_avail_len - VIRTIO_NET_ETHERNET_FRAME_OFFSET,
+            VIRTIO_NET_ETHERNET_MAX_LENGTH);
+        if (vq.map_desc_mem(a, desc_idx, VIRTIO_NET_ETHERNET_FRAME_OFFSET, direct_len, true, viovs.data(),
+                &iovcnt)) {
+            for (uint32_t i = 0; i < iovcnt; ++i) {
+                iovs[i].iov_base = viovs[i].base;
+                iovs[i].iov_len = viovs[i].len;
+            }
+        } else {
+            direct_len = 0;
+            iovcnt = 0;
+        }
+    }
+    if (direct_len < VIRTIO_NET_ETHERNET_MAX_LENGTH) {
+        iovs[iovcnt].iov_base = packet_buf.data();
+        iovs[iovcnt].iov_len = VIRTIO_NET_ETHERNET_MAX_LENGTH - direct_len;
+        ++iovcnt;
+    }
+    // Set errno to zero because readv() will not set it when it returns zero (end of file)
     errno = 0;
     // Read the next packet from the network interface
-    const ssize_t read_len = read(m_tapfd, packet_buf.data(), VIRTIO_NET_ETHERNET_MAX_LENGTH);
+    const ssize_t read_len = readv(qp.fd, iovs.data(), static_cast<int>(iovcnt));
     if (read_len <= 0) {
         // Stop when the operation would block or was interrupted,
         // the next poll will read any pending packet.
@@ -204,11 +508,13 @@ bool virtio_net_carrier_tuntap::read_packet_from_host(i_device_state_access *a,
         *pwritten_len = 0;
         return true;
     }
-    // Write to queue buffer
-    if (!vq.write_desc_mem(a, desc_idx, VIRTIO_NET_ETHERNET_FRAME_OFFSET, packet_buf.data(), packet_len)) {
+    // Write to queue buffer, unless the packet was read directly into it
+    if (direct_len == 0 &&
+        !vq.write_desc_mem(a, desc_idx, VIRTIO_NET_ETHERNET_FRAME_OFFSET, packet_buf.data(), packet_len)) {
         // Failure while accessing guest memory, the driver or guest messed up, return false to reset the device.
         return false;
     }
+#endif
     // Packet was written and the queue is ready to be consumed.
     *pwritten_len = VIRTIO_NET_ETHERNET_FRAME_OFFSET + packet_len;
     return true;
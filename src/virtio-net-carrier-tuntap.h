@@ -21,15 +21,64 @@
 
 #ifdef HAVE_TUNTAP
 
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#ifdef HAVE_THREADS
+#include <atomic>
+#include <thread>
+
+#include "spsc-ring.h"
+#endif
+
 #include "virtio-net.h"
 
 namespace cartesi {
 
+/// \brief TUN/TAP carrier constants
+enum virtio_net_tuntap_constants : uint32_t {
+    VIRTIO_NET_TUNTAP_RING_SIZE = 256, ///< Number of packets buffered in each direction of a queue pair
+};
+
+#ifdef HAVE_THREADS
+/// \brief Packet exchanged between the interpreter and the thread of a TUN/TAP queue pair
+struct tuntap_packet {
+    uint32_t len{0};                                           ///< Packet length
+    std::array<uint8_t, VIRTIO_NET_ETHERNET_MAX_LENGTH> buf{}; ///< Packet data
+};
+#endif
+
+/// \brief TUN/TAP queue pair, backed by its own tap file descriptor
+struct tuntap_queue_pair {
+    int fd = -1; ///< Tap file descriptor
+#ifdef HAVE_THREADS
+    spsc_ring<tuntap_packet> rx_ring{VIRTIO_NET_TUNTAP_RING_SIZE}; ///< Packets read from the tap, for the guest
+    spsc_ring<tuntap_packet> tx_ring{VIRTIO_NET_TUNTAP_RING_SIZE}; ///< Packets from the guest, for the tap
+    std::array<int, 2> wake_pipe{-1, -1};                          ///< Pipe written to wake up the thread
+    std::atomic<bool> wake_pending{false};                         ///< Whether the wake pipe was written to
+    std::atomic<bool> failed{false};                               ///< Whether the tap failed unexpectedly
+    std::thread thread;                                            ///< Thread performing tap I/O
+#endif
+};
+
+/// \brief VirtIO network carrier using host TUN/TAP interfaces
+/// \details Each queue pair has its own tap file descriptor, attached with IFF_MULTI_QUEUE when there are several.
+/// When threads are available, tap I/O happens in a host thread per queue pair, which exchanges packets with the
+/// interpreter through lock-free rings, so network I/O never stalls instruction execution.
 class virtio_net_carrier_tuntap final : public virtio_net_carrier {
-    int m_tapfd = -1;
+    std::vector<std::unique_ptr<tuntap_queue_pair>> m_queue_pairs; ///< Queue pairs
+    os_poller *m_poller = nullptr;                                 ///< Poller file descriptors are registered in
+#ifdef HAVE_THREADS
+    std::array<int, 2> m_ready_pipe{-1, -1};  ///< Pipe written by threads when packets are read from the tap
+    std::atomic<bool> m_ready_pending{false}; ///< Whether the ready pipe was written to
+    std::atomic<bool> m_stopping{false};      ///< Whether threads must exit
+#endif
 
 public:
-    virtio_net_carrier_tuntap(const std::string &tap_name);
+    virtio_net_carrier_tuntap(const std::string &tap_name, uint32_t queue_pairs);
     ~virtio_net_carrier_tuntap() override;
     virtio_net_carrier_tuntap(const virtio_net_carrier_tuntap &other) = delete;
     virtio_net_carrier_tuntap(virtio_net_carrier_tuntap &&other) = delete;
@@ -38,13 +87,28 @@ public:
 
     void reset() override;
 
-    void do_prepare_select(select_fd_sets *fds, uint64_t *timeout_us) override;
-    bool do_poll_selected(int select_ret, select_fd_sets *fds) override;
+    uint32_t get_queue_pairs() const override {
+        return static_cast<uint32_t>(m_queue_pairs.size());
+    }
+
+    void do_prepare_select(os_poller *poller, uint64_t *timeout_us) override;
+    bool do_poll_selected(int select_ret, os_poller *poller) override;
 
-    bool write_packet_to_host(i_device_state_access *a, virtq &vq, uint16_t desc_idx, uint32_t read_avail_len,
-        uint32_t *pread_len) override;
-    bool read_packet_from_host(i_device_state_access *a, virtq &vq, uint16_t desc_idx, uint32_t write_avail_len,
-        uint32_t *pwritten_len) override;
+    bool write_packet_to_host(i_device_state_access *a, uint32_t queue_pair, virtq &vq, uint16_t desc_idx,
+        uint32_t read_avail_len, uint32_t *pread_len) override;
+    bool read_packet_from_host(i_device_state_access *a, uint32_t queue_pair, virtq &vq, uint16_t desc_idx,
+        uint32_t write_avail_len, uint32_t *pwritten_len) override;
+
+private:
+    void close_all();
+
+#ifdef HAVE_THREADS
+    /// \brief Wakes up the thread of a queue pair, unless it was already woken up.
+    static void wake_up(tuntap_queue_pair &qp);
+
+    /// \brief Queue pair thread main loop.
+    void work(tuntap_queue_pair &qp);
+#endif
 };
 
 } // namespace cartesi
@@ -18,13 +18,33 @@
 
 #if defined(HAVE_SLIRP) || defined(HAVE_TUNTAP)
 
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+
 namespace cartesi {
 
 virtio_net::virtio_net(uint32_t virtio_idx, std::unique_ptr<virtio_net_carrier> &&carrier) :
-    virtio_device(virtio_idx, VIRTIO_DEVICE_NETWORK, 0, 0),
-    m_carrier(std::move(carrier)) {}
+    virtio_device(virtio_idx, VIRTIO_DEVICE_NETWORK, 0, sizeof(virtio_net_config_space)),
+    m_carrier(std::move(carrier)),
+    m_queue_pairs(m_carrier->get_queue_pairs()) {
+    if (m_queue_pairs < 1 || m_queue_pairs > VIRTIO_NET_QUEUE_PAIRS_MAX) {
+        throw std::invalid_argument("virtio network queue pairs must be between 1 and " +
+            std::to_string(VIRTIO_NET_QUEUE_PAIRS_MAX));
+    }
+    if (m_queue_pairs > 1) {
+        // The driver chooses how many queue pairs to use through the control queue, which follows the last pair
+        device_features |= VIRTIO_NET_F_CTRL_VQ | VIRTIO_NET_F_MQ;
+        queue_count = 2 * m_queue_pairs + 1;
+    }
+    get_config()->max_virtqueue_pairs = m_queue_pairs;
+}
 
 void virtio_net::on_device_reset() {
+    // Until the driver enables more queue pairs, only the first one is used
+    m_active_queue_pairs = 1;
+    m_transmitted = false;
+    m_rx_backlog = false;
     m_carrier->reset();
 }
 
@@ -35,48 +55,98 @@ void virtio_net::on_device_ok(i_device_state_access *a) {
 
 bool virtio_net::on_device_queue_available(i_device_state_access *a, uint32_t queue_idx, uint16_t desc_idx,
     uint32_t read_avail_len, uint32_t write_avail_len) {
-    (void) write_avail_len;
-    if (queue_idx == VIRTIO_NET_RECEIVEQ) { // Guest has a new slot available in the write queue
+    if (queue_idx >= 2 * m_queue_pairs) { // Guest sent a command through the control queue
+        return execute_control_command(a, queue_idx, desc_idx, read_avail_len, write_avail_len);
+    } else if (queue_idx % 2 == VIRTIO_NET_RECEIVEQ) { // Guest has a new slot available in a write queue
         // Write any pending packets from host to guest
         return poll_nowait(a);
-    } else if (queue_idx == VIRTIO_NET_TRANSMITQ) { // Guest sent a new packet to the host
-        if (write_next_packet_to_host(a, queue_idx, desc_idx, read_avail_len)) {
-            // When a packet is just sent, poll for a response right-away.
-            // This is necessary to have fast communication between the guest and its host
-            // with the Slirp carrier.
-            poll_nowait(a);
-            return true;
-        }
+    } else { // Guest sent a new packet to the host
+        // The driver is notified once all packets it made available were sent
+        return write_next_packet_to_host(a, queue_idx, desc_idx, read_avail_len);
+    }
+}
+
+bool virtio_net::execute_control_command(i_device_state_access *a, uint32_t queue_idx, uint16_t desc_idx,
+    uint32_t read_avail_len, uint32_t write_avail_len) {
+    const virtq &vq = queue[queue_idx];
+    // Commands have a class and command byte, followed by command data, and are acknowledged with a single byte
+    std::array<uint8_t, 4> command{};
+    if (read_avail_len < 2 || write_avail_len < 1 ||
+        !vq.read_desc_mem(a, desc_idx, 0, command.data(), std::min<uint32_t>(read_avail_len, command.size()))) {
+        notify_device_needs_reset(a);
         return false;
-    } else {
-        // Other queues are unexpected
+    }
+    uint8_t ack = VIRTIO_NET_ERR;
+    if (command[0] == VIRTIO_NET_CTRL_MQ && command[1] == VIRTIO_NET_CTRL_MQ_VQ_PAIRS_SET && read_avail_len >= 4) {
+        const uint32_t queue_pairs = command[2] | (command[3] << 8);
+        if (queue_pairs >= 1 && queue_pairs <= m_queue_pairs) {
+            m_active_queue_pairs = queue_pairs;
+            ack = VIRTIO_NET_OK;
+        }
+    }
+    if (!vq.write_desc_mem(a, desc_idx, 0, &ack, sizeof(ack)) ||
+        !consume_and_notify_queue(a, queue_idx, desc_idx, sizeof(ack))) {
         notify_device_needs_reset(a);
         return false;
     }
+    return true;
+}
+
+void virtio_net::on_device_queue_drained(i_device_state_access *a, uint32_t queue_idx) {
+    if (queue_idx >= 2 * m_queue_pairs || queue_idx % 2 != VIRTIO_NET_TRANSMITQ || !m_transmitted) {
+        return;
+    }
+    m_transmitted = false;
+    notify_queue_used(a, queue_idx);
+    // When packets are just sent, poll for responses right-away.
+    // This is necessary to have fast communication between the guest and its host
+    // with the Slirp carrier.
+    poll_nowait(a);
 }
 
-void virtio_net::prepare_select(select_fd_sets *fds, uint64_t *timeout_us) {
+void virtio_net::prepare_select(os_poller *poller, uint64_t *timeout_us) {
     if (!driver_ok) {
         return;
     }
-    m_carrier->do_prepare_select(fds, timeout_us);
+    m_carrier->do_prepare_select(poller, timeout_us);
+    // Don't wait for host events when there are packets left from the last batch
+    if (m_rx_backlog) {
+        *timeout_us = 0;
+    }
 }
 
-bool virtio_net::poll_selected(int select_ret, select_fd_sets *fds, i_device_state_access *da) {
+bool virtio_net::poll_selected(int select_ret, os_poller *poller, i_device_state_access *da) {
     if (!driver_ok) {
         return false;
     }
+    m_rx_backlog = false;
     // Is there any pending to be read from the host?
-    if (!m_carrier->do_poll_selected(select_ret, fds)) {
+    if (!m_carrier->do_poll_selected(select_ret, poller)) {
         return false;
     }
-    bool interrupt_requested = false;
-    // Read packets from host and write them the guest,
-    // until the are no more pending packets to write or the write queue is full.
-    while (read_next_packet_from_host(da)) {
-        interrupt_requested = true;
+    // For each queue pair, read packets from host and write them to the guest, until there are no more pending
+    // packets to write, the write queue is full or the batch is complete.
+    // Packets left behind are received on the next poll.
+    uint32_t received_queues = 0;
+    for (uint32_t queue_pair = 0; queue_pair < m_queue_pairs; ++queue_pair) {
+        uint32_t received = 0;
+        while (received < VIRTIO_NET_RX_BATCH_MAX && read_next_packet_from_host(da, queue_pair)) {
+            ++received;
+        }
+        if (received == VIRTIO_NET_RX_BATCH_MAX) {
+            m_rx_backlog = true;
+        }
+        if (received > 0) {
+            received_queues |= UINT32_C(1) << get_receive_queue(queue_pair);
+        }
+    }
+    // Then notify the driver once for all packets of each queue
+    for (uint32_t queue_idx = VIRTIO_NET_RECEIVEQ; queue_idx < 2 * m_queue_pairs; queue_idx += 2) {
+        if (received_queues & (UINT32_C(1) << queue_idx)) {
+            notify_queue_used(da, queue_idx);
+        }
     }
-    return interrupt_requested;
+    return received_queues != 0;
 }
 
 bool virtio_net::write_next_packet_to_host(i_device_state_access *a, uint32_t queue_idx, uint16_t desc_idx,
@@ -84,21 +154,22 @@ bool virtio_net::write_next_packet_to_host(i_device_state_access *a, uint32_t qu
     virtq &vq = queue[queue_idx];
     // Write a single packet to the network interface
     uint32_t read_len{};
-    if (!m_carrier->write_packet_to_host(a, vq, desc_idx, read_avail_len, &read_len)) {
+    if (!m_carrier->write_packet_to_host(a, queue_idx / 2, vq, desc_idx, read_avail_len, &read_len)) {
         notify_device_needs_reset(a);
         return false;
     }
-    // Consume the queue and notify the driver
-    if (!consume_and_notify_queue(a, queue_idx, desc_idx)) {
+    // Consume the queue, the driver is notified after the whole batch
+    if (!vq.consume_desc(a, desc_idx, 0, 0)) {
         notify_device_needs_reset(a);
         return false;
     }
+    m_transmitted = true;
     return true;
 }
 
-bool virtio_net::read_next_packet_from_host(i_device_state_access *a) {
-    // Bytes from host must be written to queue 0
-    constexpr uint32_t queue_idx = VIRTIO_NET_RECEIVEQ;
+bool virtio_net::read_next_packet_from_host(i_device_state_access *a, uint32_t queue_pair) {
+    // Bytes from host must be written to a receive queue in use
+    const uint32_t queue_idx = get_receive_queue(queue_pair);
     virtq &vq = queue[queue_idx];
     // Prepare queue buffer for writing
     uint16_t desc_idx{};
@@ -114,7 +185,7 @@ bool virtio_net::read_next_packet_from_host(i_device_state_access *a) {
     }
     // Read a single packet from the network interface
     uint32_t written_len{};
-    if (!m_carrier->read_packet_from_host(a, vq, desc_idx, write_avail_len, &written_len)) {
+    if (!m_carrier->read_packet_from_host(a, queue_pair, vq, desc_idx, write_avail_len, &written_len)) {
         notify_device_needs_reset(a);
         return false;
     }
@@ -131,8 +202,8 @@ bool virtio_net::read_next_packet_from_host(i_device_state_access *a) {
         notify_device_needs_reset(a);
         return false;
     }
-    // Consume and notify the queue
-    if (!consume_and_notify_queue(a, queue_idx, desc_idx, written_len)) {
+    // Consume the queue, the driver is notified after the whole batch
+    if (!vq.consume_desc(a, desc_idx, written_len, 0)) {
         notify_device_needs_reset(a);
         return false;
     }
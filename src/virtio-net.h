@@ -22,6 +22,7 @@
 #if defined(HAVE_SLIRP) || defined(HAVE_TUNTAP)
 
 #include "virtio-device.h"
+#include <array>
 #include <memory>
 
 namespace cartesi {
@@ -37,18 +38,48 @@ struct virtio_net_header {
     uint16_t num_buffers;
 };
 
+/// \brief VirtIO net device config space
+struct virtio_net_config_space {
+    std::array<uint8_t, 6> mac;   ///< MAC address (unused)
+    uint16_t status;              ///< Link status (unused)
+    uint16_t max_virtqueue_pairs; ///< Maximum number of queue pairs (if VIRTIO_NET_F_MQ)
+};
+
+/// \brief VirtIO net features
+enum virtio_net_features : uint64_t {
+    VIRTIO_NET_F_CTRL_VQ = (UINT64_C(1) << 17), ///< Control channel is available.
+    VIRTIO_NET_F_MQ = (UINT64_C(1) << 22),      ///< Device supports multiqueue with automatic receive steering.
+};
+
 /// \brief VirtIO net constants
 enum virtio_net_constants : uint32_t {
     VIRTIO_NET_ETHERNET_FRAME_OFFSET = sizeof(virtio_net_header), ///< Offset for writing Ethernet frames
     VIRTIO_NET_ETHERNET_MAX_LENGTH = 2048,                        ///< Large enough to fit Ethernet maximum frame size
+    VIRTIO_NET_RX_BATCH_MAX = 64,                                 ///< Maximum number of packets received per poll
+    VIRTIO_NET_QUEUE_PAIRS_MAX = 8,                               ///< Maximum number of receive/transmit queue pairs
 };
 
+static_assert(2 * VIRTIO_NET_QUEUE_PAIRS_MAX + 1 <= VIRTIO_QUEUE_COUNT_MAX, "not enough virtio queues");
+
 /// \brief VirtIO net Virtqueue indexes
+/// \details Queue pair k uses queues 2k and 2k+1, the control queue follows the last pair.
 enum virtio_net_virtq : uint32_t {
     VIRTIO_NET_RECEIVEQ = 0,  ///< Queue of packets from host to guest
     VIRTIO_NET_TRANSMITQ = 1, ///< Queue of packets from guest to host
 };
 
+/// \brief VirtIO net control commands
+enum virtio_net_ctrl : uint8_t {
+    VIRTIO_NET_CTRL_MQ = 4,              ///< Class of multiqueue commands
+    VIRTIO_NET_CTRL_MQ_VQ_PAIRS_SET = 0, ///< Sets the number of queue pairs in use
+};
+
+/// \brief VirtIO net control command acknowledgements
+enum virtio_net_ctrl_ack : uint8_t {
+    VIRTIO_NET_OK = 0,  ///< Command succeeded
+    VIRTIO_NET_ERR = 1, ///< Command failed
+};
+
 /// \brief Generic interface for a network carrier on the host.
 /// \details The sole purpose of a network carrier
 /// is to carry incoming or outgoing packets between the host and the guest.
@@ -64,13 +95,19 @@ public:
     /// \brief Reset carrier internal state, discarding all network state.
     virtual void reset() = 0;
 
-    /// \brief Fill file descriptors to be polled by select().
-    virtual void do_prepare_select(select_fd_sets *fds, uint64_t *timeout_us) = 0;
+    /// \brief Returns the number of queue pairs the carrier can carry packets through in parallel.
+    virtual uint32_t get_queue_pairs() const {
+        return 1;
+    }
 
-    /// \brief Poll file descriptors that were marked as ready by select().
-    virtual bool do_poll_selected(int select_ret, select_fd_sets *fds) = 0;
+    /// \brief Register or renew interest in file descriptors to be polled.
+    virtual void do_prepare_select(os_poller *poller, uint64_t *timeout_us) = 0;
+
+    /// \brief Poll file descriptors that were marked as ready.
+    virtual bool do_poll_selected(int select_ret, os_poller *poller) = 0;
 
     /// \brief Called for carrying outgoing packets from the guest to the host.
+    /// \param queue_pair Index of the queue pair the packet was sent through.
     /// \param vq Queue reference.
     /// \param desc_idx Queue's descriptor index.
     /// \param read_avail_len Total readable length in the descriptor buffer.
@@ -78,10 +115,11 @@ public:
     /// \returns True on success, false otherwise.
     /// \details This function will return true even if when the write queue is full,
     /// pread_len will be set to 0 in this case and the packet dropped.
-    virtual bool write_packet_to_host(i_device_state_access *a, virtq &vq, uint16_t desc_idx, uint32_t read_avail_len,
-        uint32_t *pread_len) = 0;
+    virtual bool write_packet_to_host(i_device_state_access *a, uint32_t queue_pair, virtq &vq, uint16_t desc_idx,
+        uint32_t read_avail_len, uint32_t *pread_len) = 0;
 
     /// \brief Called for carrying incoming packets from the host to the guest.
+    /// \param queue_pair Index of the queue pair to receive the packet from.
     /// \param vq Queue reference.
     /// \param desc_idx Queue's descriptor index.
     /// \param write_avail_len Total writable length in the descriptor buffer.
@@ -89,11 +127,14 @@ public:
     /// \returns True on success, false otherwise.
     /// \details This function will true even if when there are no more packets to write,
     /// pwritten_len will be set to 0 in this case.
-    virtual bool read_packet_from_host(i_device_state_access *a, virtq &vq, uint16_t desc_idx, uint32_t write_avail_len,
-        uint32_t *pwritten_len) = 0;
+    virtual bool read_packet_from_host(i_device_state_access *a, uint32_t queue_pair, virtq &vq, uint16_t desc_idx,
+        uint32_t write_avail_len, uint32_t *pwritten_len) = 0;
 };
 
 /// \brief VirtIO net device
+/// \details When the carrier has several queue pairs, the device offers VIRTIO_NET_F_MQ and the guest can spread
+/// its traffic across them. Packets received through a carrier queue pair are delivered to the receive queue of
+/// the same pair, or of a pair in use when the guest enabled fewer pairs than the carrier has.
 class virtio_net final : public virtio_device {
 public:
     virtio_net(uint32_t virtio_idx, std::unique_ptr<virtio_net_carrier> &&carrier);
@@ -102,16 +143,40 @@ public:
     void on_device_ok(i_device_state_access *a) override;
     bool on_device_queue_available(i_device_state_access *a, uint32_t queue_idx, uint16_t desc_idx,
         uint32_t read_avail_len, uint32_t write_avail_len) override;
+    void on_device_queue_drained(i_device_state_access *a, uint32_t queue_idx) override;
 
-    void prepare_select(select_fd_sets *fds, uint64_t *timeout_us) override;
-    bool poll_selected(int select_ret, select_fd_sets *fds, i_device_state_access *da) override;
+    void prepare_select(os_poller *poller, uint64_t *timeout_us) override;
+    bool poll_selected(int select_ret, os_poller *poller, i_device_state_access *da) override;
 
+    /// \brief Carries a packet from the guest to the host, marking its buffer as used without notifying the driver.
     bool write_next_packet_to_host(i_device_state_access *a, uint32_t queue_idx, uint16_t desc_idx,
         uint32_t read_avail_len);
-    bool read_next_packet_from_host(i_device_state_access *a);
+
+    /// \brief Carries a packet from the host to the guest, marking its buffer as used without notifying the driver.
+    /// \param queue_pair Index of the carrier queue pair to receive the packet from.
+    /// \returns True if a packet was received by the guest, false otherwise.
+    bool read_next_packet_from_host(i_device_state_access *a, uint32_t queue_pair);
+
+    virtio_net_config_space *get_config() {
+        // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+        return reinterpret_cast<virtio_net_config_space *>(config_space.data());
+    }
 
 private:
+    /// \brief Executes a command sent by the driver through the control queue.
+    bool execute_control_command(i_device_state_access *a, uint32_t queue_idx, uint16_t desc_idx,
+        uint32_t read_avail_len, uint32_t write_avail_len);
+
+    /// \brief Returns the index of the receive queue getting packets from a carrier queue pair.
+    uint32_t get_receive_queue(uint32_t queue_pair) const {
+        return 2 * (queue_pair % m_active_queue_pairs) + VIRTIO_NET_RECEIVEQ;
+    }
+
     std::unique_ptr<virtio_net_carrier> m_carrier;
+    uint32_t m_queue_pairs{1};        ///< Number of queue pairs offered to the driver
+    uint32_t m_active_queue_pairs{1}; ///< Number of queue pairs the driver is using
+    bool m_transmitted{false}; ///< Whether packets were sent by the guest since the driver was last notified
+    bool m_rx_backlog{false};  ///< Whether the last poll stopped receiving packets because the batch was full
 };
 
 } // namespace cartesi
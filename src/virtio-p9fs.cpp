@@ -36,13 +36,16 @@
 
 #ifdef HAVE_POSIX_FS
 
+#include <algorithm>
 #include <cerrno>
 #include <cstring>
+#include <system_error>
 
 #include <dirent.h>
 #include <fcntl.h>
 #include <sys/file.h>
 #include <sys/stat.h>
+#include <sys/uio.h>
 #ifdef __APPLE__
 #include <sys/mount.h>
 #include <sys/param.h>
@@ -474,6 +477,16 @@ static int close_fid_state(p9_fid_state *fidp) {
     return err;
 }
 
+/// \brief Converts queue buffer chunks to host I/O vectors
+static std::array<iovec, VIRTIO_QUEUE_NUM_MAX> to_host_iovecs(const virtq_iovec *viovs, uint32_t iovcnt) {
+    std::array<iovec, VIRTIO_QUEUE_NUM_MAX> iovs{};
+    for (uint32_t i = 0; i < iovcnt; ++i) {
+        iovs[i].iov_base = viovs[i].base;
+        iovs[i].iov_len = viovs[i].len;
+    }
+    return iovs;
+}
+
 static std::string join_path_name(const std::string &path, const std::string &name) {
     if (path.empty()) {
         return name;
@@ -530,9 +543,35 @@ virtio_p9fs_device::virtio_p9fs_device(uint32_t virtio_idx, const std::string &m
     strncpy(config->mount_tag.data(), mount_tag.c_str(), mount_tag.length());
     config->mount_tag_len = mount_tag.length();
     config_space_size = mount_tag.length() + sizeof(uint16_t);
+#ifdef HAVE_THREADS
+    // Workers report completions through a pipe, so the machine wakes up from WFI while polling devices
+    if (pipe(m_completion_pipe.data()) < 0) {
+        throw std::system_error{errno, std::generic_category(), "could not create virtio p9fs completion pipe"};
+    }
+    for (const int fd : m_completion_pipe) {
+        (void) fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+        (void) fcntl(fd, F_SETFD, FD_CLOEXEC);
+    }
+#endif
 }
 
 virtio_p9fs_device::~virtio_p9fs_device() {
+#ifdef HAVE_THREADS
+    {
+        const std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_cv.notify_all();
+    for (auto &worker : m_workers) {
+        worker.join();
+    }
+    if (poller != nullptr) {
+        poller->unwatch(m_completion_pipe[0]);
+    }
+    for (const int fd : m_completion_pipe) {
+        close(fd);
+    }
+#endif
     // Close all file descriptors
     for (auto &it : m_fids) {
         p9_fid_state *fidp = &it.second;
@@ -543,6 +582,16 @@ virtio_p9fs_device::~virtio_p9fs_device() {
 
 void virtio_p9fs_device::on_device_reset() {
     m_msize = P9_MAX_MSIZE;
+#ifdef HAVE_THREADS
+    // Requests taken before the reset are discarded when they complete
+    ++m_generation;
+    {
+        const std::lock_guard<std::mutex> lock(m_mutex);
+        m_pending.clear();
+        m_completed.clear();
+    }
+#endif
+    m_attr_cache.clear();
     // Close all file descriptors
     for (auto &it : m_fids) {
         p9_fid_state *fidp = &it.second;
@@ -551,6 +600,39 @@ void virtio_p9fs_device::on_device_reset() {
     m_fids.clear();
 }
 
+p9_async_request::~p9_async_request() {
+    if (fd >= 0) {
+        (void) close(fd);
+    }
+}
+
+int virtio_p9fs_device::cached_lstat(const std::string &path, stat_t *st) {
+    const auto now = std::chrono::steady_clock::now();
+    auto it = m_attr_cache.find(path);
+    if (it == m_attr_cache.end() || now >= it->second.expiry) {
+        p9_attr_cache_entry entry{};
+        if (lstat(path.c_str(), &entry.st) != 0) {
+            entry.error = errno;
+            // Only missing paths are worth remembering, other errors are unexpected
+            if (entry.error != ENOENT && entry.error != ENOTDIR) {
+                return -1;
+            }
+        }
+        entry.expiry = now + std::chrono::milliseconds(P9_ATTR_CACHE_TTL_MS);
+        // Dropping all entries keeps the cache bounded, and is rare enough to be cheap
+        if (m_attr_cache.size() >= P9_ATTR_CACHE_MAX) {
+            m_attr_cache.clear();
+        }
+        it = m_attr_cache.insert_or_assign(path, entry).first;
+    }
+    if (it->second.error != 0) {
+        errno = it->second.error;
+        return -1;
+    }
+    *st = it->second.st;
+    return 0;
+}
+
 void virtio_p9fs_device::on_device_ok(i_device_state_access *a) {
     (void) a;
     // Nothing to do.
@@ -576,6 +658,20 @@ bool virtio_p9fs_device::on_device_queue_available(i_device_state_access *a, uin
     // which can theoretically throw std::bad_alloc exceptions (although very unlikely).
     // We don't want any exception to leak outside this function, so we try to catch any exception here.
     try {
+        // Operations that change the namespace may affect the attributes of any cached path
+        switch (opcode) {
+            case P9_TLCREATE:
+            case P9_TSYMLINK:
+            case P9_TMKNOD:
+            case P9_TLINK:
+            case P9_TMKDIR:
+            case P9_TRENAMEAT:
+            case P9_TUNLINKAT:
+                m_attr_cache.clear();
+                break;
+            default:
+                break;
+        }
         switch (opcode) {
             case P9_TSTATFS:
                 return op_statfs(std::move(msg), tag);
@@ -719,6 +815,8 @@ bool virtio_p9fs_device::op_lopen(virtq_unserializer &&msg, uint16_t tag) {
     if (fidp->fd >= 0) {
         return send_error(msg, tag, P9_EPROTO);
     }
+    // Opening may truncate the file
+    invalidate_attr_cache(fidp->path);
     // Open the file
     const int oflags = p9_open_flags_to_host(flags);
     const int fd = open(fidp->path.c_str(), oflags);
@@ -940,6 +1038,7 @@ bool virtio_p9fs_device::op_setattr(virtq_unserializer &&msg, uint16_t tag) {
     if (!fidp) {
         return send_error(msg, tag, P9_EPROTO);
     }
+    invalidate_attr_cache(fidp->path);
     bool ctime_updated = false;
     // Modify ownership
     if (mask & (P9_SETATTR_UID | P9_SETATTR_GID)) {
@@ -1092,7 +1191,7 @@ bool virtio_p9fs_device::op_getattr(virtq_unserializer &&msg, uint16_t tag) {
         }
     } else {
         // Get the attributes
-        if (lstat(fidp->path.c_str(), &st) != 0) {
+        if (cached_lstat(fidp->path, &st) != 0) {
             return send_error(msg, tag, host_errno_to_p9(errno));
         }
     }
@@ -1364,12 +1463,17 @@ bool virtio_p9fs_device::op_fsync(virtq_unserializer &&msg, uint16_t tag) {
     if (!fidp || fidp->fd < 0) {
         return send_error(msg, tag, P9_EPROTO);
     }
+#ifdef HAVE_THREADS
+    // Leave the I/O to a worker
+    return take_request(msg, tag, P9_TFSYNC, fidp, 0, 0);
+#else
     // Sync the file
     if (fsync(fidp->fd) != 0) {
         return send_error(msg, tag, host_errno_to_p9(errno));
     }
     // Reply
     return send_ok(msg, tag, P9_RFSYNC);
+#endif
 }
 
 bool virtio_p9fs_device::op_link(virtq_unserializer &&msg, uint16_t tag) {
@@ -1539,10 +1643,10 @@ bool virtio_p9fs_device::op_version(virtq_unserializer &&msg, uint16_t tag) {
         return send_error(msg, tag, P9_EPROTO);
     }
 #ifdef DEBUG_VIRTIO_P9FS
-    (void) fprintf(stderr, "p9fs version: tag=%d msize=%d version=%s\n", tag, m_msize, version);
+    (void) fprintf(stderr, "p9fs version: tag=%d msize=%d version=%s\n", tag, msize, version);
 #endif
-    // Set msize
-    m_msize = std::min<uint32_t>(m_msize, P9_MAX_MSIZE);
+    // Set msize, the largest the driver wants up to the largest we support
+    m_msize = std::clamp<uint32_t>(msize, P9_IOUNIT_HEADER_SIZE + 1, P9_MAX_MSIZE);
     // Reply with the protocol version we support
     virtq_serializer out_msg(msg.a, msg.vq, msg.queue_idx, msg.desc_idx, P9_OUT_MSG_OFFSET);
     const char P9_PROTO_VERSION[] = "9P2000.L";
@@ -1619,7 +1723,7 @@ bool virtio_p9fs_device::op_walk(virtq_unserializer &&msg, uint16_t tag) {
     // Get the start for the starting path and root path
     stat_t st{};
     stat_t root_st{};
-    if (lstat(fidp->path.c_str(), &st) != 0 || lstat(m_root_path.c_str(), &root_st) != 0) {
+    if (cached_lstat(fidp->path, &st) != 0 || cached_lstat(m_root_path, &root_st) != 0) {
         return send_error(msg, tag, host_errno_to_p9(errno));
     }
     // Walk path retrieving qid for each name
@@ -1645,7 +1749,7 @@ bool virtio_p9fs_device::op_walk(virtq_unserializer &&msg, uint16_t tag) {
                 next_path = join_path_name(path, name);
             }
             // Get next path qid
-            if (lstat(next_path.c_str(), &st) != 0) {
+            if (cached_lstat(next_path, &st) != 0) {
                 // Return an error only for the first walk
                 if (nwalked == 0) {
                     return send_error(msg, tag, host_errno_to_p9(errno));
@@ -1706,23 +1810,46 @@ bool virtio_p9fs_device::op_read(virtq_unserializer &&msg, uint16_t tag) {
     if (!fidp || fidp->fd < 0) {
         return send_error(msg, tag, P9_EPROTO);
     }
-    // Prepare temporary output buffer
-    std::array<uint8_t, P9_IOUNIT_MAX> buf{};
-    if (count > buf.size()) {
+    if (count > get_iounit()) {
         return send_error(msg, tag, P9_EPROTO);
     }
-    // Read from fd
+#ifdef HAVE_THREADS
+    // Leave the I/O to a worker
+    return take_request(msg, tag, P9_TREAD, fidp, offset, count);
+#else
+    // Reply data follows the reply count, try to read from fd directly into it
+    virtq_serializer out_msg(msg.a, msg.vq, msg.queue_idx, msg.desc_idx, P9_OUT_MSG_OFFSET);
+    const uint32_t data_offset = out_msg.offset + sizeof(uint32_t);
+    std::array<virtq_iovec, VIRTIO_QUEUE_NUM_MAX> viovs{};
+    uint32_t iovcnt = 0;
+    if (msg.vq.map_desc_mem(msg.a, msg.desc_idx, data_offset, count, true, viovs.data(), &iovcnt)) {
+        const auto iovs = to_host_iovecs(viovs.data(), iovcnt);
+        const ssize_t ret = preadv(fidp->fd, iovs.data(), static_cast<int>(iovcnt), static_cast<off_t>(offset));
+        if (ret < 0) {
+            return send_error(msg, tag, host_errno_to_p9(errno));
+        }
+        uint32_t ret_count = static_cast<uint32_t>(ret);
+        // Reply
+        if (!out_msg.pack(&ret_count)) {
+            return send_error(msg, tag, P9_EPROTO);
+        }
+        out_msg.offset += ret_count;
+        out_msg.length = std::max(out_msg.length, out_msg.offset);
+        return send_reply(std::move(out_msg), tag, P9_RREAD);
+    }
+    // Otherwise, read from fd into a temporary buffer
+    std::vector<uint8_t> buf(count);
     const ssize_t ret = pread(fidp->fd, buf.data(), static_cast<size_t>(count), static_cast<off_t>(offset));
     if (ret < 0) {
         return send_error(msg, tag, host_errno_to_p9(errno));
     }
     uint32_t ret_count = static_cast<uint32_t>(ret);
     // Reply
-    virtq_serializer out_msg(msg.a, msg.vq, msg.queue_idx, msg.desc_idx, P9_OUT_MSG_OFFSET);
-    if (!out_msg.pack(&ret_count) || !out_msg.write_bytes(buf.data(), count)) {
+    if (!out_msg.pack(&ret_count) || !out_msg.write_bytes(buf.data(), ret_count)) {
         return send_error(msg, tag, P9_EPROTO);
     }
     return send_reply(std::move(out_msg), tag, P9_RREAD);
+#endif
 }
 
 bool virtio_p9fs_device::op_write(virtq_unserializer &&msg, uint16_t tag) {
@@ -1740,13 +1867,31 @@ bool virtio_p9fs_device::op_write(virtq_unserializer &&msg, uint16_t tag) {
     if (!fidp || fidp->fd < 0) {
         return send_error(msg, tag, P9_EPROTO);
     }
-    // Read from input buffer
-    std::array<uint8_t, P9_IOUNIT_MAX> buf{};
-    if (count > buf.size() || !msg.read_bytes(buf.data(), count)) {
+    if (count > get_iounit()) {
         return send_error(msg, tag, P9_EPROTO);
     }
-    // Write to fd
-    const ssize_t ret = pwrite(fidp->fd, buf.data(), static_cast<size_t>(count), static_cast<off_t>(offset));
+    // Writing changes the file size and times
+    invalidate_attr_cache(fidp->path);
+#ifdef HAVE_THREADS
+    // Leave the I/O to a worker
+    return take_request(msg, tag, P9_TWRITE, fidp, offset, count);
+#else
+    ssize_t ret = 0;
+    std::array<virtq_iovec, VIRTIO_QUEUE_NUM_MAX> viovs{};
+    uint32_t iovcnt = 0;
+    if (msg.vq.map_desc_mem(msg.a, msg.desc_idx, msg.offset, count, false, viovs.data(), &iovcnt)) {
+        // Write to fd directly from the input buffer
+        const auto iovs = to_host_iovecs(viovs.data(), iovcnt);
+        ret = pwritev(fidp->fd, iovs.data(), static_cast<int>(iovcnt), static_cast<off_t>(offset));
+    } else {
+        // Otherwise, read from input buffer into a temporary buffer
+        std::vector<uint8_t> buf(count);
+        if (!msg.read_bytes(buf.data(), count)) {
+            return send_error(msg, tag, P9_EPROTO);
+        }
+        // Write to fd
+        ret = pwrite(fidp->fd, buf.data(), static_cast<size_t>(count), static_cast<off_t>(offset));
+    }
     if (ret < 0) {
         return send_error(msg, tag, host_errno_to_p9(errno));
     }
@@ -1756,7 +1901,8 @@ bool virtio_p9fs_device::op_write(virtq_unserializer &&msg, uint16_t tag) {
     if (!out_msg.pack(&ret_count)) {
         return send_error(msg, tag, P9_EPROTO);
     }
-    return send_reply(std::move(out_msg), tag, P9_RREAD);
+    return send_reply(std::move(out_msg), tag, P9_RWRITE);
+#endif
 }
 
 bool virtio_p9fs_device::op_clunk(virtq_unserializer &&msg, uint16_t tag) {
@@ -1827,6 +1973,199 @@ bool virtio_p9fs_device::send_error(const virtq_unserializer &in_msg, uint16_t t
     return send_reply(std::move(out_msg), tag, P9_RLERROR);
 }
 
+void virtio_p9fs_device::prepare_select(os_poller *poller, uint64_t *timeout_us) {
+    (void) timeout_us;
+#ifdef HAVE_THREADS
+    if (!driver_ok) {
+        return;
+    }
+    poller->watch(m_completion_pipe[0], OS_POLL_IN);
+#else
+    (void) poller;
+#endif
+}
+
+bool virtio_p9fs_device::poll_selected(int select_ret, os_poller *poller, i_device_state_access *da) {
+#ifdef HAVE_THREADS
+    if (!driver_ok || select_ret <= 0 || (poller->get_ready(m_completion_pipe[0]) & OS_POLL_IN) == 0) {
+        return false;
+    }
+    // Drain wake up bytes before taking completions, so no completion is left without a wake up
+    std::array<unsigned char, 256> drain{};
+    while (read(m_completion_pipe[0], drain.data(), drain.size()) > 0) {
+    }
+    std::vector<std::unique_ptr<p9_async_request>> completed;
+    {
+        const std::lock_guard<std::mutex> lock(m_mutex);
+        completed.swap(m_completed);
+    }
+    bool used = false;
+    for (const auto &req : completed) {
+        if (req->generation != m_generation) {
+            continue;
+        }
+        --queue[0].in_flight;
+        if (!complete_request(da, *req)) {
+            return true;
+        }
+        used = true;
+    }
+    return used;
+#else
+    (void) select_ret;
+    (void) poller;
+    (void) da;
+    return false;
+#endif
+}
+
+#ifdef HAVE_THREADS
+bool virtio_p9fs_device::take_request(virtq_unserializer &msg, uint16_t tag, p9_opcode opcode,
+    const p9_fid_state *fidp, uint64_t offset, uint32_t count) {
+    auto req = std::make_unique<p9_async_request>();
+    req->desc_idx = static_cast<uint16_t>(msg.desc_idx);
+    req->tag = tag;
+    req->opcode = opcode;
+    req->offset = offset;
+    req->count = count;
+    req->path = fidp->path;
+    req->generation = m_generation;
+    if (opcode != P9_TFSYNC) {
+        // Map the guest buffers now, so the worker reads into the reply data (which follows the reply count),
+        // or writes from the request data, without copying them
+        const bool write = opcode == P9_TREAD;
+        const uint32_t data_offset = write ? static_cast<uint32_t>(P9_OUT_MSG_OFFSET + sizeof(uint32_t)) : msg.offset;
+        std::array<virtq_iovec, VIRTIO_QUEUE_NUM_MAX> viovs{};
+        uint32_t iovcnt = 0;
+        if (msg.vq.map_desc_mem(msg.a, msg.desc_idx, data_offset, count, write, viovs.data(), &iovcnt)) {
+            const auto iovs = to_host_iovecs(viovs.data(), iovcnt);
+            req->iovs.assign(iovs.begin(), iovs.begin() + iovcnt);
+        } else if (opcode == P9_TWRITE) {
+            // Otherwise, copy the data to be written into a temporary buffer
+            req->data.resize(count);
+            if (!msg.read_bytes(req->data.data(), count)) {
+                return send_error(msg, tag, P9_EPROTO);
+            }
+        }
+    }
+    // The request gets its own file descriptor, so a clunk cannot close it under the worker
+    req->fd = fcntl(fidp->fd, F_DUPFD_CLOEXEC, 0);
+    if (req->fd < 0) {
+        return send_error(msg, tag, host_errno_to_p9(errno));
+    }
+    // Take the request in flight and keep going through the queue, so all available requests
+    // are handed to the workers together
+    ++msg.vq.in_flight;
+    start_workers();
+    {
+        const std::lock_guard<std::mutex> lock(m_mutex);
+        m_pending.push_back(std::move(req));
+    }
+    m_cv.notify_one();
+    return true;
+}
+
+void virtio_p9fs_device::start_workers() {
+    // Machines that never touch a file through the device do not pay for the threads
+    if (!m_workers.empty()) {
+        return;
+    }
+    m_workers.reserve(P9_WORKER_COUNT);
+    for (uint32_t i = 0; i < P9_WORKER_COUNT; ++i) {
+        m_workers.emplace_back([this] { work(); });
+    }
+}
+
+void virtio_p9fs_device::execute_request(p9_async_request &req) {
+    ssize_t ret = 0;
+    do {
+        switch (req.opcode) {
+            case P9_TREAD:
+                if (!req.iovs.empty()) {
+                    ret = preadv(req.fd, req.iovs.data(), static_cast<int>(req.iovs.size()),
+                        static_cast<off_t>(req.offset));
+                    break;
+                }
+                req.data.resize(req.count);
+                ret = pread(req.fd, req.data.data(), req.data.size(), static_cast<off_t>(req.offset));
+                break;
+            case P9_TWRITE:
+                if (!req.iovs.empty()) {
+                    ret = pwritev(req.fd, req.iovs.data(), static_cast<int>(req.iovs.size()),
+                        static_cast<off_t>(req.offset));
+                    break;
+                }
+                ret = pwrite(req.fd, req.data.data(), req.data.size(), static_cast<off_t>(req.offset));
+                break;
+            default:
+                ret = fsync(req.fd);
+                break;
+        }
+    } while (ret < 0 && errno == EINTR);
+    req.result = ret < 0 ? -static_cast<int64_t>(errno) : static_cast<int64_t>(ret);
+    // Release the file descriptor right away, rather than when the request is replied
+    (void) close(req.fd);
+    req.fd = -1;
+}
+
+bool virtio_p9fs_device::complete_request(i_device_state_access *a, const p9_async_request &req) {
+    const virtq_unserializer msg(a, queue[0], 0, req.desc_idx);
+    if (req.opcode == P9_TWRITE) {
+        invalidate_attr_cache(req.path);
+    }
+    if (req.result < 0) {
+        return send_error(msg, req.tag, host_errno_to_p9(static_cast<int>(-req.result)));
+    }
+    virtq_serializer out_msg(a, queue[0], 0, req.desc_idx, P9_OUT_MSG_OFFSET);
+    uint32_t ret_count = static_cast<uint32_t>(req.result);
+    switch (req.opcode) {
+        case P9_TREAD:
+            if (!out_msg.pack(&ret_count)) {
+                return send_error(msg, req.tag, P9_EPROTO);
+            }
+            if (!req.iovs.empty()) {
+                // The worker wrote the reply data behind the dirty page tracking, so map it again to mark its pages
+                std::array<virtq_iovec, VIRTIO_QUEUE_NUM_MAX> viovs{};
+                uint32_t iovcnt = 0;
+                if (!queue[0].map_desc_mem(a, req.desc_idx, out_msg.offset, ret_count, true, viovs.data(), &iovcnt)) {
+                    return send_error(msg, req.tag, P9_EPROTO);
+                }
+                out_msg.offset += ret_count;
+                out_msg.length = std::max(out_msg.length, out_msg.offset);
+            } else if (!out_msg.write_bytes(req.data.data(), ret_count)) {
+                return send_error(msg, req.tag, P9_EPROTO);
+            }
+            return send_reply(std::move(out_msg), req.tag, P9_RREAD);
+        case P9_TWRITE:
+            if (!out_msg.pack(&ret_count)) {
+                return send_error(msg, req.tag, P9_EPROTO);
+            }
+            return send_reply(std::move(out_msg), req.tag, P9_RWRITE);
+        default:
+            return send_reply(std::move(out_msg), req.tag, P9_RFSYNC);
+    }
+}
+
+void virtio_p9fs_device::work() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (true) {
+        m_cv.wait(lock, [this] { return m_stopping || !m_pending.empty(); });
+        if (m_stopping) {
+            return;
+        }
+        auto req = std::move(m_pending.front());
+        m_pending.pop_front();
+        lock.unlock();
+        execute_request(*req);
+        lock.lock();
+        m_completed.push_back(std::move(req));
+        // The pipe is non-blocking, a full pipe already has wake ups pending
+        const unsigned char wakeup = 0;
+        (void) write(m_completion_pipe[1], &wakeup, 1);
+    }
+}
+#endif
+
 } // namespace cartesi
 
 #endif // HAVE_POSIX_FS
\ No newline at end of file
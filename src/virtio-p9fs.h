@@ -24,7 +24,21 @@
 #include "virtio-device.h"
 #include "virtio-serializer.h"
 
+#include <chrono>
+#include <memory>
+#include <string>
 #include <unordered_map>
+#include <vector>
+
+#include <sys/stat.h>
+#include <sys/uio.h>
+
+#ifdef HAVE_THREADS
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#endif
 
 namespace cartesi {
 
@@ -40,10 +54,13 @@ enum virtio_p9fs_constants : uint32_t {
     P9_PATH_MAX = 4096,      ///< Maximum filesystem path length
     P9_ROOT_PATH_MAX = 1024, ///< Maximum root path size
     P9_MOUNT_TAG_MAX = VIRTIO_MAX_CONFIG_SPACE_SIZE - sizeof(uint16_t), ///< Maximum mount tag size
-    P9_IOUNIT_MAX = 8192,                                 ///< Maximum buffer size for IO operations (read/write)
+    P9_IOUNIT_MAX = 512 * 1024,                           ///< Maximum buffer size for IO operations (read/write)
     P9_IOUNIT_HEADER_SIZE = 24,                           ///< Message header size of IO operations (read/write)
     P9_MAX_MSIZE = P9_IOUNIT_MAX + P9_IOUNIT_HEADER_SIZE, ///< Maximum message size, including message headers
     P9_OUT_MSG_OFFSET = 7,                                ///< Offset for 9P reply messages
+    P9_WORKER_COUNT = 4,                                  ///< Number of host threads servicing I/O requests
+    P9_ATTR_CACHE_MAX = 4096,                             ///< Maximum number of cached path attributes
+    P9_ATTR_CACHE_TTL_MS = 1000, ///< Time cached path attributes remain valid, bounding staleness of host changes
 };
 
 /// \brief 9P2000.L opcodes
@@ -385,6 +402,37 @@ struct p9_fid_state {
     void *dirp = nullptr; ///< Host directory (valid only for opened directories)
 };
 
+/// \brief 9P2000.L request serviced by a host worker
+/// \details Only requests that do not touch the fid table are serviced by workers, so they are independent of
+/// any other request taken before or after them.
+struct p9_async_request {
+    uint16_t desc_idx{0};            ///< Queue's descriptor index holding the request
+    uint16_t tag{0};                 ///< Request tag
+    p9_opcode opcode{};              ///< Request opcode (P9_TREAD, P9_TWRITE or P9_TFSYNC)
+    int fd{-1};                      ///< Duplicate of the fid's host file descriptor, owned by the request
+    uint64_t offset{0};              ///< Offset in file
+    uint32_t count{0};               ///< Number of bytes to read
+    std::string path;                ///< File system path, for cache invalidation
+    std::vector<iovec> iovs;         ///< Guest buffers mapped to host memory, for transfers without a copy
+    std::vector<unsigned char> data; ///< Data read from or to be written to the file, when buffers are not mapped
+    int64_t result{0};               ///< Number of bytes transferred, or negated errno on failure
+    uint64_t generation{0};          ///< Device generation when the request was taken
+
+    p9_async_request() = default;
+    ~p9_async_request();
+    p9_async_request(const p9_async_request &other) = delete;
+    p9_async_request(p9_async_request &&other) = delete;
+    p9_async_request &operator=(const p9_async_request &other) = delete;
+    p9_async_request &operator=(p9_async_request &&other) = delete;
+};
+
+/// \brief Cached attributes of a host path
+struct p9_attr_cache_entry {
+    struct stat st {};                            ///< Attributes returned by lstat()
+    int error{0};                                 ///< Error returned by lstat(), or 0 on success
+    std::chrono::steady_clock::time_point expiry; ///< When the entry stops being valid
+};
+
 /// \brief VirtIO Plan 9 filesystem configuration space
 struct virtio_p9fs_config_space {
     uint16_t mount_tag_len;                       ///< Length of mount tag
@@ -392,10 +440,25 @@ struct virtio_p9fs_config_space {
 };
 
 /// \brief VirtIO Plan 9 filesystem device
+/// \details Reads, writes and syncs are serviced by a pool of host threads, so the guest keeps running while the
+/// host performs I/O. The threads are started by the first such request, and transfer data directly to and from
+/// the guest buffers. Completions wake up the machine through a pipe polled with the other VirtIO devices.
+/// Attributes of host paths are cached for a short while, to speed up the walk and getattr storms of guest builds.
 class virtio_p9fs_device final : public virtio_device {
     uint32_t m_msize = 0;
     std::string m_root_path;
     std::unordered_map<uint32_t, p9_fid_state> m_fids;
+    std::unordered_map<std::string, p9_attr_cache_entry> m_attr_cache; ///< Attributes of host paths
+#ifdef HAVE_THREADS
+    uint64_t m_generation{0}; ///< Incremented on every device reset, to discard requests taken before it
+    std::array<int, 2> m_completion_pipe{-1, -1};               ///< Pipe written by workers on completion
+    std::vector<std::thread> m_workers;                         ///< Worker threads
+    std::mutex m_mutex;                                         ///< Protects the fields below
+    std::condition_variable m_cv;                               ///< Signals new pending requests
+    std::deque<std::unique_ptr<p9_async_request>> m_pending;    ///< Requests waiting for a worker
+    std::vector<std::unique_ptr<p9_async_request>> m_completed; ///< Requests waiting to be replied
+    bool m_stopping{false};                                     ///< Whether workers must exit
+#endif
 
 public:
     virtio_p9fs_device(uint32_t virtio_idx, const std::string &mount_tag, const std::string &root_path);
@@ -410,6 +473,9 @@ public:
     bool on_device_queue_available(i_device_state_access *a, uint32_t queue_idx, uint16_t desc_idx,
         uint32_t read_avail_len, uint32_t write_avail_len) override;
 
+    void prepare_select(os_poller *poller, uint64_t *timeout_us) override;
+    bool poll_selected(int select_ret, os_poller *poller, i_device_state_access *da) override;
+
     bool op_statfs(virtq_unserializer &&msg, uint16_t tag);
     bool op_lopen(virtq_unserializer &&msg, uint16_t tag);
     bool op_lcreate(virtq_unserializer &&msg, uint16_t tag);
@@ -450,6 +516,35 @@ public:
     uint32_t get_iounit() const {
         return std::min<uint32_t>(m_msize - P9_IOUNIT_HEADER_SIZE, P9_IOUNIT_MAX);
     }
+
+private:
+    /// \brief Gets the attributes of a host path, like lstat(), going through the attribute cache.
+    int cached_lstat(const std::string &path, struct stat *st);
+
+    /// \brief Drops the cached attributes of a host path.
+    void invalidate_attr_cache(const std::string &path) {
+        (void) m_attr_cache.erase(path);
+    }
+
+#ifdef HAVE_THREADS
+    /// \brief Takes a request to be serviced by a worker, replying when it completes.
+    /// \details The guest buffers are mapped right away, so workers transfer data directly to or from them.
+    /// Data of write requests whose buffers cannot be mapped is copied out of the message instead.
+    bool take_request(virtq_unserializer &msg, uint16_t tag, p9_opcode opcode, const p9_fid_state *fidp,
+        uint64_t offset, uint32_t count);
+
+    /// \brief Performs the host I/O of a request.
+    static void execute_request(p9_async_request &req);
+
+    /// \brief Replies to a request serviced by a worker.
+    bool complete_request(i_device_state_access *a, const p9_async_request &req);
+
+    /// \brief Starts the worker threads, unless they are already running.
+    void start_workers();
+
+    /// \brief Worker thread main loop.
+    void work();
+#endif
 };
 
 } // namespace cartesi
@@ -16,6 +16,8 @@
 
 #include "virtual-machine.h"
 
+#include "gdb-stub.h"
+
 namespace cartesi {
 
 virtual_machine::virtual_machine(const machine_config &c, const machine_runtime_config &r) :
@@ -36,6 +38,41 @@ interpreter_break_reason virtual_machine::do_run(uint64_t mcycle_end) {
     return m_machine->run(mcycle_end);
 }
 
+interpreter_break_reason virtual_machine::do_run_record_trace(uint64_t mcycle_end, execution_trace &trace) {
+    return m_machine->run_record_trace(mcycle_end, trace);
+}
+
+interpreter_break_reason virtual_machine::do_run_replay_trace(const execution_trace &trace) {
+    return m_machine->run_replay_trace(trace);
+}
+
+interpreter_break_reason virtual_machine::do_run_until(uint64_t mcycle_end, const machine_break_conditions &conditions,
+    machine_break_event &event) {
+    return m_machine->run_until(mcycle_end, conditions, event);
+}
+
+void virtual_machine::do_serve_gdb(const std::string &address, uint64_t mcycle_end) {
+    gdb_stub stub{*m_machine};
+    stub.serve(address, mcycle_end);
+}
+
+void virtual_machine::do_start_profiler(uint64_t sample_interval) {
+    m_machine->start_profiler(sample_interval);
+}
+
+void virtual_machine::do_stop_profiler(void) {
+    m_machine->stop_profiler();
+}
+
+void virtual_machine::do_write_profile(const std::string &filename, machine_profile_format format,
+    const std::string &elf_filename) const {
+    m_machine->write_profile(filename, format, elf_filename);
+}
+
+uint64_t virtual_machine::do_read_console_output(unsigned char *data, uint64_t max_length) {
+    return m_machine->read_console_output(data, max_length);
+}
+
 access_log virtual_machine::do_log_uarch_step(const access_log::type &log_type, bool one_based) {
     return m_machine->log_uarch_step(log_type, one_based);
 }
@@ -528,6 +565,10 @@ void virtual_machine::do_send_cmio_response(uint16_t reason, const unsigned char
     m_machine->send_cmio_response(reason, data, length);
 }
 
+const unsigned char *virtual_machine::do_get_cmio_tx_buffer(uint64_t &length) const {
+    return m_machine->get_cmio_tx_buffer(length);
+}
+
 access_log virtual_machine::do_log_send_cmio_response(uint16_t reason, const unsigned char *data, size_t length,
     const access_log::type &log_type, bool one_based) {
     return m_machine->log_send_cmio_response(reason, data, length, log_type, one_based);
@@ -41,6 +41,16 @@ public:
 private:
     void do_store(const std::string &dir) override;
     interpreter_break_reason do_run(uint64_t mcycle_end) override;
+    interpreter_break_reason do_run_record_trace(uint64_t mcycle_end, execution_trace &trace) override;
+    interpreter_break_reason do_run_replay_trace(const execution_trace &trace) override;
+    interpreter_break_reason do_run_until(uint64_t mcycle_end, const machine_break_conditions &conditions,
+        machine_break_event &event) override;
+    void do_serve_gdb(const std::string &address, uint64_t mcycle_end) override;
+    void do_start_profiler(uint64_t sample_interval) override;
+    void do_stop_profiler(void) override;
+    void do_write_profile(const std::string &filename, machine_profile_format format,
+        const std::string &elf_filename) const override;
+    uint64_t do_read_console_output(unsigned char *data, uint64_t max_length) override;
     access_log do_log_uarch_step(const access_log::type &log_type, bool one_based = false) override;
     machine_merkle_tree::proof_type do_get_proof(uint64_t address, int log2_size) const override;
     void do_get_root_hash(hash_type &hash) const override;
@@ -164,6 +174,7 @@ private:
     uarch_interpreter_break_reason do_run_uarch(uint64_t uarch_cycle_end) override;
     machine_memory_range_descrs do_get_memory_ranges(void) const override;
     void do_send_cmio_response(uint16_t reason, const unsigned char *data, size_t length) override;
+    const unsigned char *do_get_cmio_tx_buffer(uint64_t &length) const override;
     access_log do_log_send_cmio_response(uint16_t reason, const unsigned char *data, size_t length,
         const access_log::type &log_type, bool one_based) override;
 };
@@ -403,6 +403,26 @@ if machine_type ~= "local" then
         assert(err:match("no machine"))
     end)
 
+    print("\n\n check remote shared memory")
+    do_test("memory should move through shared memory and leave no segment behind", function(machine)
+        local function list_segments()
+            local p = assert(io.popen("ls /dev/shm 2>/dev/null | grep '^cartesi-jsonrpc-'"))
+            local segments = p:read("a")
+            p:close()
+            return segments
+        end
+        local before = list_segments()
+        remote.enable_shared_memory()
+        -- The segment is unlinked as soon as the server attaches, so a crashed client leaves nothing behind
+        assert(list_segments() == before, "shared memory segment was not unlinked after attach")
+        local data = string.rep("0123456789abcdef", 4096)
+        machine:write_memory(0x80000000, data)
+        assert(machine:read_memory(0x80000000, #data) == data, "data read through shared memory does not match")
+        -- Enabling again keeps the segment already in use
+        remote.enable_shared_memory()
+        assert(machine:read_memory(0x80000000, #data) == data, "data read through shared memory does not match")
+    end)
+
     do_test("jsonrpc connection error 49 after rapid successive requests ", function(machine)
         -- On a Mac, this loop will break with  EADDRNOTAVAIL(49)
         -- Setting up the SO_LINGER to 0 fixed this issue
@@ -0,0 +1,193 @@
+#!/usr/bin/env lua5.4
+
+-- Copyright Cartesi and individual authors (see AUTHORS)
+-- SPDX-License-Identifier: LGPL-3.0-or-later
+--
+-- This program is free software: you can redistribute it and/or modify it under
+-- the terms of the GNU Lesser General Public License as published by the Free
+-- Software Foundation, either version 3 of the License, or (at your option) any
+-- later version.
+--
+-- This program is distributed in the hope that it will be useful, but WITHOUT ANY
+-- WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+-- PARTICULAR PURPOSE. See the GNU Lesser General Public License for more details.
+--
+-- You should have received a copy of the GNU Lesser General Public License along
+-- with this program (see COPYING). If not, see <https://www.gnu.org/licenses/>.
+--
+
+local jsonrpc = require("cartesi.jsonrpc")
+local socket = require("socket")
+
+local remote_address = nil
+local gdb_address = "127.0.0.1:6002"
+
+-- Print help and exit
+local function help()
+    io.stderr:write(string.format(
+        [=[
+Usage:
+
+  %s --remote-address=<host>:<port> [--gdb-address=<host>:<port>]
+
+where remote-address gives the address of a running
+jsonrpc remote Cartesi machine server, and gdb-address
+gives the address it serves GDB at (default: 127.0.0.1:6002).
+
+]=],
+        arg[0]
+    ))
+    os.exit()
+end
+
+local options = {
+    {
+        "^%-%-h$",
+        function(all)
+            if not all then return false end
+            help()
+        end,
+    },
+    {
+        "^%-%-help$",
+        function(all)
+            if not all then return false end
+            help()
+        end,
+    },
+    {
+        "^%-%-remote%-address%=(.*)$",
+        function(o)
+            if not o or #o < 1 then return false end
+            remote_address = o
+            return true
+        end,
+    },
+    {
+        "^%-%-gdb%-address%=(.*)$",
+        function(o)
+            if not o or #o < 1 then return false end
+            gdb_address = o
+            return true
+        end,
+    },
+    { ".*", function(all) error("unrecognized option " .. all) end },
+}
+
+-- Process command line options
+for _, argument in ipairs({ ... }) do
+    if argument:sub(1, 1) == "-" then
+        for _, option in ipairs(options) do
+            if option[2](argument:match(option[1])) then break end
+        end
+    else
+        error("unrecognized argument " .. argument)
+    end
+end
+
+-- This test serves GDB through machine.serve_gdb, checking the server keeps answering
+-- other requests from its event loop while a GDB packet arrives in pieces
+
+local function split_address(address)
+    local host, port = string.match(address, "^(.*):(%d+)$")
+    assert(host, "invalid address " .. address)
+    return host, tonumber(port)
+end
+
+-- Connects to an address, retrying while the server is not listening yet
+local function connect(address)
+    local host, port = split_address(address)
+    for _ = 1, 100 do
+        local con = socket.connect(host, port)
+        if con then
+            con:settimeout(10)
+            return con
+        end
+        socket.sleep(0.1)
+    end
+    error("could not connect to " .. address)
+end
+
+local function gdb_frame(data)
+    local sum = 0
+    for i = 1, #data do
+        sum = sum + string.byte(data, i)
+    end
+    return string.format("$%s#%02x", data, sum & 0xff)
+end
+
+local function gdb_reply(gdb)
+    local c
+    repeat
+        c = assert(gdb:receive(1))
+    until c == "$"
+    local data = {}
+    c = assert(gdb:receive(1))
+    while c ~= "#" do
+        data[#data + 1] = c
+        c = assert(gdb:receive(1))
+    end
+    assert(gdb:receive(2))
+    -- The server closes the connection right after replying to a detach, so the ack may fail
+    gdb:send("+")
+    return table.concat(data)
+end
+
+local function gdb_request(gdb, data)
+    assert(gdb:send(gdb_frame(data)))
+    return gdb_reply(gdb)
+end
+
+-- Receives the body of an HTTP response
+local function http_receive_body(con)
+    local length
+    local line = assert(con:receive("*l"))
+    while line ~= "" do
+        local value = string.match(string.lower(line), "^content%-length:%s*(%d+)")
+        if value then length = tonumber(value) end
+        line = assert(con:receive("*l"))
+    end
+    assert(length, "missing content length")
+    return assert(con:receive(length))
+end
+
+assert(remote_address, "missing remote address")
+local stub = assert(jsonrpc.stub(remote_address))
+local config = stub.machine.get_default_config()
+config.ram.length = 1 << 22
+config.processor.pc = 0x80000000
+local machine = stub.machine(config)
+machine:write_memory(0x80000000, "\x6f\x00\x00\x00") -- j .
+
+-- The machine.serve_gdb response only comes once GDB detaches, so send the request by hand
+local request = string.format(
+    '{"jsonrpc":"2.0","id":1,"method":"machine.serve_gdb","params":[1000,"%s"]}',
+    gdb_address
+)
+local http = connect(remote_address)
+assert(http:send(string.format(
+    "POST / HTTP/1.1\r\nHost: %s\r\nContent-Type: application/json\r\nContent-Length: %d\r\n\r\n%s",
+    remote_address,
+    #request,
+    request
+)))
+
+local gdb = connect(gdb_address)
+assert(string.find(gdb_request(gdb, "qSupported"), "PacketSize=", 1, true))
+local packet = gdb_frame("m80000000,4")
+assert(gdb:send(string.sub(packet, 1, 5)))
+-- The rest of the packet has not arrived, and the server must not wait for it
+assert(stub.get_version())
+assert(gdb:send(string.sub(packet, 6)))
+assert(gdb_reply(gdb) == "6f000000")
+assert(gdb_request(gdb, "c") == "S03")
+assert(gdb_request(gdb, "D") == "OK")
+gdb:close()
+
+local response = http_receive_body(http)
+http:close()
+assert(string.find(response, '"result"', 1, true), response)
+assert(machine:read_mcycle() == 1000)
+
+stub.shutdown()
+print("passed")
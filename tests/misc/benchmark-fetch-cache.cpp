@@ -0,0 +1,198 @@
+// Copyright Cartesi and individual authors (see AUTHORS)
+// SPDX-License-Identifier: LGPL-3.0-or-later
+//
+// This program is free software: you can redistribute it and/or modify it under
+// the terms of the GNU Lesser General Public License as published by the Free
+// Software Foundation, either version 3 of the License, or (at your option) any
+// later version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+// PARTICULAR PURPOSE. See the GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License along
+// with this program (see COPYING). If not, see <https://www.gnu.org/licenses/>.
+//
+
+/// \file
+/// \brief Measures the interpreter fetch translation cache on call-heavy code
+/// \details Runs a guest loop that calls one tiny function in each of several code pages, first without traps and
+/// then with an ECALL handled in machine mode on every iteration. The number of pages kept in the fetch translation
+/// cache is fixed when the emulator is built, so compare sizes by rebuilding it, for example with
+/// make MYDEFS=-DFETCH_CACHE_SIZE=8.
+
+#include <algorithm>
+#include <chrono>
+#include <cinttypes>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <initializer_list>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <machine-c-api.h>
+
+namespace {
+
+constexpr uint64_t ram_start = 0x80000000;
+constexpr uint64_t page_size = 4096;
+constexpr uint64_t handler_offset = 0x400;
+
+struct options {
+    uint64_t pages = 4;
+    uint64_t mcycle = 100000000;
+    int repeat = 3;
+};
+
+void check(int error_code, char *err_msg) {
+    if (error_code != CM_ERROR_OK) {
+        const std::string what = err_msg != nullptr ? err_msg : "unknown error";
+        cm_delete_cstring(err_msg);
+        throw std::runtime_error(what);
+    }
+}
+
+uint64_t parse_uint(const char *value) {
+    char *end = nullptr;
+    const uint64_t result = strtoull(value, &end, 0);
+    if (end == value || *end != '\0') {
+        throw std::invalid_argument(std::string("invalid number '") + value + "'");
+    }
+    return result;
+}
+
+void help(const char *name) {
+    (void) fprintf(stderr,
+        "Usage:\n\n"
+        "  %s [options]\n\n"
+        "where options are:\n\n"
+        "  --pages=<n>           number of pages with functions called by the loop (default: 4)\n"
+        "  --mcycle=<n>          number of cycles to run on each machine (default: 100000000)\n"
+        "  --repeat=<n>          number of runs with each setting (default: 3)\n",
+        name);
+}
+
+// Encodes jal rd, offset
+uint32_t jal(uint32_t rd, int64_t offset) {
+    const auto imm = static_cast<uint32_t>(offset);
+    return ((imm & 0x100000) << 11) | ((imm & 0x7fe) << 20) | ((imm & 0x800) << 9) | (imm & 0xff000) | (rd << 7) |
+        0x6f;
+}
+
+// Writes instructions to guest memory
+void write_insns(cm_machine *m, uint64_t paddr, const std::vector<uint32_t> &insns) {
+    char *err_msg{};
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+    const auto *data = reinterpret_cast<const unsigned char *>(insns.data());
+    check(cm_write_memory(m, paddr, data, insns.size() * sizeof(uint32_t), &err_msg), err_msg);
+}
+
+// Loads a loop that calls a function in each of the following pages, optionally traps, then counts an iteration
+void load_program(cm_machine *m, uint64_t pages, bool traps) {
+    std::vector<uint32_t> loop{
+        0x00000297, // auipc x5, 0
+        0x00028293 | static_cast<uint32_t>(handler_offset << 20), // addi x5, x5, handler_offset
+        0x30529073, // csrw mtvec, x5
+    };
+    const uint64_t loop_start = loop.size() * sizeof(uint32_t);
+    for (uint64_t page = 1; page <= pages; ++page) {
+        const int64_t pc = static_cast<int64_t>(loop.size() * sizeof(uint32_t));
+        loop.push_back(jal(1, static_cast<int64_t>(page * page_size) - pc)); // jal x1, function in page
+    }
+    if (traps) {
+        loop.push_back(0x00000073); // ecall
+    }
+    loop.push_back(0x00140413); // addi x8, x8, 1
+    const int64_t pc = static_cast<int64_t>(loop.size() * sizeof(uint32_t));
+    loop.push_back(jal(0, static_cast<int64_t>(loop_start) - pc)); // j loop
+    if (loop.size() * sizeof(uint32_t) > handler_offset) {
+        throw std::invalid_argument("too many pages");
+    }
+    write_insns(m, ram_start, loop);
+    write_insns(m, ram_start + handler_offset,
+        {
+            0x34102373, // csrr x6, mepc
+            0x00430313, // addi x6, x6, 4
+            0x34131073, // csrw mepc, x6
+            0x30200073, // mret
+        });
+    for (uint64_t page = 1; page <= pages; ++page) {
+        write_insns(m, ram_start + page * page_size,
+            {
+                0x00150513, // addi x10, x10, 1
+                0x00008067, // ret
+            });
+    }
+    char *err_msg{};
+    check(cm_write_pc(m, ram_start, &err_msg), err_msg);
+}
+
+// Creates a machine and times the guest program
+double run(const options &opts, bool traps) {
+    const cm_machine_config *default_config = cm_new_default_machine_config();
+    cm_machine_config config = *default_config;
+    config.ram.length = (opts.pages + 1) * page_size;
+    cm_machine_runtime_config runtime_config{};
+    cm_machine *m{};
+    char *err_msg{};
+    const int error_code = cm_create_machine(&config, &runtime_config, &m, &err_msg);
+    cm_delete_machine_config(default_config);
+    check(error_code, err_msg);
+    double elapsed = 0.0;
+    try {
+        load_program(m, opts.pages, traps);
+        CM_BREAK_REASON break_reason{};
+        uint64_t mcycle{};
+        check(cm_read_mcycle(m, &mcycle, &err_msg), err_msg);
+        const auto begin = std::chrono::steady_clock::now();
+        check(cm_machine_run(m, mcycle + opts.mcycle, &break_reason, &err_msg), err_msg);
+        const auto end = std::chrono::steady_clock::now();
+        elapsed = std::chrono::duration<double>(end - begin).count();
+    } catch (...) {
+        cm_delete_machine(m);
+        throw;
+    }
+    cm_delete_machine(m);
+    return elapsed;
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) try {
+    options opts;
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        const auto eq = arg.find('=');
+        const std::string name = arg.substr(0, eq);
+        const char *value = eq != std::string::npos ? argv[i] + eq + 1 : "";
+        if (name == "--pages") {
+            opts.pages = parse_uint(value);
+        } else if (name == "--mcycle") {
+            opts.mcycle = parse_uint(value);
+        } else if (name == "--repeat") {
+            opts.repeat = static_cast<int>(parse_uint(value));
+        } else {
+            help(argv[0]);
+            return arg == "--help" || arg == "-h" ? 0 : 1;
+        }
+    }
+    if (opts.pages == 0) {
+        throw std::invalid_argument("pages is zero");
+    }
+    (void) printf("pages: %" PRIu64 ", mcycle: %" PRIu64 "\n", opts.pages, opts.mcycle);
+    for (const bool traps : {false, true}) {
+        double best = 0.0;
+        for (int r = 0; r < opts.repeat; ++r) {
+            const double elapsed = run(opts, traps);
+            best = r == 0 ? elapsed : std::min(best, elapsed);
+        }
+        (void) printf("traps: %-3s best: %8.3f s  %8.2f MIPS\n", traps ? "yes" : "no", best,
+            static_cast<double>(opts.mcycle) / best / 1e6);
+    }
+    return 0;
+} catch (std::exception &e) {
+    (void) fprintf(stderr, "error: %s\n", e.what());
+    return 1;
+}
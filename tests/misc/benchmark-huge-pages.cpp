@@ -0,0 +1,185 @@
+// Copyright Cartesi and individual authors (see AUTHORS)
+// SPDX-License-Identifier: LGPL-3.0-or-later
+//
+// This program is free software: you can redistribute it and/or modify it under
+// the terms of the GNU Lesser General Public License as published by the Free
+// Software Foundation, either version 3 of the License, or (at your option) any
+// later version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+// PARTICULAR PURPOSE. See the GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License along
+// with this program (see COPYING). If not, see <https://www.gnu.org/licenses/>.
+//
+
+/// \file
+/// \brief Measures the host-side effect of backing guest RAM with huge pages
+/// \details Runs the same guest program on two machines that differ only in the huge_pages runtime option. The
+/// program loads one word from every page of a large RAM region in a loop, so most guest accesses miss in the
+/// emulator TLB and translate to scattered host accesses.
+
+#include <algorithm>
+#include <chrono>
+#include <cinttypes>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <initializer_list>
+#include <stdexcept>
+#include <string>
+
+#include <machine-c-api.h>
+
+namespace {
+
+constexpr uint64_t ram_start = 0x80000000;
+constexpr uint64_t code_length = 1 << 20;
+
+// Loads one word every x7 bytes in [x8, x6), then starts over
+const uint32_t program[] = {
+    0x0002b503, // 0x80000000: ld x10, 0(x5)
+    0x007282b3, // 0x80000004: add x5, x5, x7
+    0xfe62ec63, // 0x80000008: bltu x5, x6, 0x80000000
+    0x00040293, // 0x8000000c: mv x5, x8
+    0xff1ff06f, // 0x80000010: j 0x80000000
+};
+
+struct options {
+    uint64_t ram_length = UINT64_C(256) << 20;
+    uint64_t stride = 4096 + 64;
+    uint64_t mcycle = 50000000;
+    int repeat = 3;
+};
+
+void check(int error_code, char *err_msg) {
+    if (error_code != CM_ERROR_OK) {
+        const std::string what = err_msg != nullptr ? err_msg : "unknown error";
+        cm_delete_cstring(err_msg);
+        throw std::runtime_error(what);
+    }
+}
+
+uint64_t parse_uint(const char *value) {
+    char *end = nullptr;
+    const uint64_t result = strtoull(value, &end, 0);
+    if (end == value || *end != '\0') {
+        throw std::invalid_argument(std::string("invalid number '") + value + "'");
+    }
+    return result;
+}
+
+void help(const char *name) {
+    (void) fprintf(stderr,
+        "Usage:\n\n"
+        "  %s [options]\n\n"
+        "where options are:\n\n"
+        "  --ram-length=<MiB>    guest RAM length (default: 256)\n"
+        "  --stride=<bytes>      distance between consecutive guest loads (default: 4160)\n"
+        "  --mcycle=<n>          number of cycles to run on each machine (default: 50000000)\n"
+        "  --repeat=<n>          number of runs with each setting (default: 3)\n",
+        name);
+}
+
+// Returns true if the RAM range reports being backed by huge pages
+bool ram_has_huge_pages(cm_machine *m) {
+    cm_memory_range_descr_array *mrds{};
+    char *err_msg{};
+    check(cm_get_memory_ranges(m, &mrds, &err_msg), err_msg);
+    bool huge_pages = false;
+    for (size_t i = 0; i < mrds->count; ++i) {
+        if (mrds->entry[i].start == ram_start) {
+            huge_pages = mrds->entry[i].huge_pages;
+        }
+    }
+    cm_delete_memory_range_descr_array(mrds);
+    return huge_pages;
+}
+
+// Creates a machine, touches all of its RAM, then times the guest program
+double run(const options &opts, bool huge_pages, bool &reported) {
+    const cm_machine_config *default_config = cm_new_default_machine_config();
+    cm_machine_config config = *default_config;
+    config.ram.length = opts.ram_length;
+    cm_machine_runtime_config runtime_config{};
+    runtime_config.huge_pages = huge_pages;
+    cm_machine *m{};
+    char *err_msg{};
+    const int error_code = cm_create_machine(&config, &runtime_config, &m, &err_msg);
+    cm_delete_machine_config(default_config);
+    check(error_code, err_msg);
+    double elapsed = 0.0;
+    try {
+        reported = ram_has_huge_pages(m);
+        // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+        const auto *data = reinterpret_cast<const unsigned char *>(program);
+        check(cm_write_memory(m, ram_start, data, sizeof(program), &err_msg), err_msg);
+        check(cm_write_x(m, 5, ram_start + code_length, &err_msg), err_msg);
+        check(cm_write_x(m, 6, ram_start + opts.ram_length, &err_msg), err_msg);
+        check(cm_write_x(m, 7, opts.stride, &err_msg), err_msg);
+        check(cm_write_x(m, 8, ram_start + code_length, &err_msg), err_msg);
+        check(cm_write_pc(m, ram_start, &err_msg), err_msg);
+        // Populate the host pages up front so page faults do not pollute the measurement
+        const unsigned char zero = 0;
+        for (uint64_t offset = code_length; offset < opts.ram_length; offset += 4096) {
+            check(cm_write_memory(m, ram_start + offset, &zero, sizeof(zero), &err_msg), err_msg);
+        }
+        CM_BREAK_REASON break_reason{};
+        uint64_t mcycle{};
+        check(cm_read_mcycle(m, &mcycle, &err_msg), err_msg);
+        const auto begin = std::chrono::steady_clock::now();
+        check(cm_machine_run(m, mcycle + opts.mcycle, &break_reason, &err_msg), err_msg);
+        const auto end = std::chrono::steady_clock::now();
+        elapsed = std::chrono::duration<double>(end - begin).count();
+    } catch (...) {
+        cm_delete_machine(m);
+        throw;
+    }
+    cm_delete_machine(m);
+    return elapsed;
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) try {
+    options opts;
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        const auto eq = arg.find('=');
+        const std::string name = arg.substr(0, eq);
+        const char *value = eq != std::string::npos ? argv[i] + eq + 1 : "";
+        if (name == "--ram-length") {
+            opts.ram_length = parse_uint(value) << 20;
+        } else if (name == "--stride") {
+            opts.stride = parse_uint(value);
+        } else if (name == "--mcycle") {
+            opts.mcycle = parse_uint(value);
+        } else if (name == "--repeat") {
+            opts.repeat = static_cast<int>(parse_uint(value));
+        } else {
+            help(argv[0]);
+            return arg == "--help" || arg == "-h" ? 0 : 1;
+        }
+    }
+    if (opts.ram_length <= 2 * code_length || opts.stride == 0) {
+        throw std::invalid_argument("RAM too small or stride is zero");
+    }
+    (void) printf("ram-length: %" PRIu64 " MiB, stride: %" PRIu64 " bytes, mcycle: %" PRIu64 "\n",
+        opts.ram_length >> 20, opts.stride, opts.mcycle);
+    for (const bool huge_pages : {false, true}) {
+        double best = 0.0;
+        bool reported = false;
+        for (int r = 0; r < opts.repeat; ++r) {
+            const double elapsed = run(opts, huge_pages, reported);
+            best = r == 0 ? elapsed : std::min(best, elapsed);
+        }
+        (void) printf("huge-pages requested: %-3s reported: %-3s best: %8.3f s  %8.2f MIPS\n",
+            huge_pages ? "yes" : "no", reported ? "yes" : "no", best, static_cast<double>(opts.mcycle) / best / 1e6);
+    }
+    return 0;
+} catch (std::exception &e) {
+    (void) fprintf(stderr, "error: %s\n", e.what());
+    return 1;
+}
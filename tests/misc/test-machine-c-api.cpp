@@ -25,6 +25,7 @@
 
 #pragma GCC diagnostic push
 #pragma GCC diagnostic ignored "-Wunused-parameter"
+#include <boost/asio.hpp>
 #include <boost/endian/conversion.hpp>
 #include <boost/process.hpp>
 #include <boost/process/search_path.hpp>
@@ -34,17 +35,35 @@
 #define JSON_HAS_FILESYSTEM 0
 #include <json.hpp>
 
+#include <algorithm>
 #include <array>
+#include <cerrno>
 #include <chrono>
 #include <filesystem>
 #include <fstream>
+#include <initializer_list>
 #include <iostream>
+#include <map>
+#include <string>
+#include <system_error>
 #include <thread>
+#include <vector>
+
+#include <sys/wait.h>
+#include <unistd.h>
 
 #include <machine-c-api.h>
+#include <os.h>
 #include <riscv-constants.h>
+#include <rtc.h>
+#include <spsc-ring.h>
 #include <uarch-constants.h>
 #include <uarch-solidity-compat.h>
+#include <virtio-blk.h>
+#include <virtio-device.h>
+#include <virtio-net-carrier-slirp.h>
+#include <virtio-net.h>
+#include <virtio-p9fs.h>
 
 #include "test-utils.h"
 
@@ -286,6 +305,239 @@ BOOST_FIXTURE_TEST_CASE_NOLINT(create_machine_null_machine_test, incomplete_mach
     cm_delete_cstring(err_msg);
 }
 
+BOOST_FIXTURE_TEST_CASE_NOLINT(create_machine_virtio_blk_missing_image_test, incomplete_machine_fixture) {
+    cm_virtio_device_config blk_cfg{};
+    blk_cfg.type = CM_VIRTIO_DEVICE_BLK;
+    blk_cfg.device.blk.image_filename = "/unknown_dir/blk.img";
+    _machine_config.processor.iunrep = 1;
+    _machine_config.virtio.entry = &blk_cfg;
+    _machine_config.virtio.count = 1;
+
+    char *err_msg{};
+    int error_code = cm_create_machine(&_machine_config, &_runtime_config, &_machine, &err_msg);
+    _machine_config.virtio = cm_virtio_config_array{};
+    BOOST_CHECK_EQUAL(error_code, CM_ERROR_RUNTIME_ERROR);
+
+    std::string result = err_msg;
+    std::string origin("could not open virtio block image '/unknown_dir/blk.img'");
+    BOOST_CHECK_EQUAL(result.substr(0, origin.size()), origin);
+
+    cm_delete_cstring(err_msg);
+}
+
+BOOST_FIXTURE_TEST_CASE_NOLINT(create_machine_virtio_blk_test, incomplete_machine_fixture) {
+    const std::string image_path = "./blk.img";
+    std::filesystem::remove(image_path);
+    std::ofstream(image_path).close();
+    std::filesystem::resize_file(image_path, 4096);
+
+    cm_virtio_device_config blk_cfg{};
+    blk_cfg.type = CM_VIRTIO_DEVICE_BLK;
+    blk_cfg.device.blk.image_filename = image_path.c_str();
+    blk_cfg.device.blk.read_only = true;
+    _machine_config.processor.iunrep = 1;
+    _machine_config.virtio.entry = &blk_cfg;
+    _machine_config.virtio.count = 1;
+
+    char *err_msg{};
+    int error_code = cm_create_machine(&_machine_config, &_runtime_config, &_machine, &err_msg);
+    _machine_config.virtio = cm_virtio_config_array{};
+    BOOST_REQUIRE_EQUAL(error_code, CM_ERROR_OK);
+    BOOST_CHECK_EQUAL(err_msg, nullptr);
+
+    const cm_machine_config *cfg{};
+    error_code = cm_get_initial_config(_machine, &cfg, &err_msg);
+    BOOST_REQUIRE_EQUAL(error_code, CM_ERROR_OK);
+    BOOST_REQUIRE_EQUAL(cfg->virtio.count, 1);
+    BOOST_CHECK_EQUAL(cfg->virtio.entry[0].type, CM_VIRTIO_DEVICE_BLK);
+    BOOST_CHECK_EQUAL(std::string(cfg->virtio.entry[0].device.blk.image_filename), image_path);
+    BOOST_CHECK(cfg->virtio.entry[0].device.blk.read_only);
+    cm_delete_machine_config(cfg);
+
+    cm_delete_machine(_machine);
+    std::filesystem::remove(image_path);
+}
+
+BOOST_FIXTURE_TEST_CASE_NOLINT(create_machine_invalid_poll_backend_test, incomplete_machine_fixture) {
+    _runtime_config.poll_backend = static_cast<CM_POLL_BACKEND>(-1);
+    char *err_msg{};
+    int error_code = cm_create_machine(&_machine_config, &_runtime_config, &_machine, &err_msg);
+    BOOST_CHECK_EQUAL(error_code, CM_ERROR_INVALID_ARGUMENT);
+
+    std::string result = err_msg;
+    std::string origin("invalid poll backend");
+    BOOST_CHECK_EQUAL(origin, result);
+
+    cm_delete_cstring(err_msg);
+}
+
+BOOST_FIXTURE_TEST_CASE_NOLINT(machine_run_virtio_poll_backend_test, incomplete_machine_fixture) {
+    const std::string image_path = "./blk.img";
+    std::filesystem::remove(image_path);
+    std::ofstream(image_path).close();
+    std::filesystem::resize_file(image_path, 4096);
+
+    cm_virtio_device_config blk_cfg{};
+    blk_cfg.type = CM_VIRTIO_DEVICE_BLK;
+    blk_cfg.device.blk.image_filename = image_path.c_str();
+    _machine_config.processor.iunrep = 1;
+    _machine_config.virtio.entry = &blk_cfg;
+    _machine_config.virtio.count = 1;
+
+    // The run goes through many RTC ticks, where the machine polls its VirtIO devices
+    for (const auto backend : {CM_POLL_BACKEND_AUTO, CM_POLL_BACKEND_SELECT, CM_POLL_BACKEND_EPOLL}) {
+        _runtime_config.poll_backend = backend;
+        char *err_msg{};
+        int error_code = cm_create_machine(&_machine_config, &_runtime_config, &_machine, &err_msg);
+        BOOST_REQUIRE_EQUAL(error_code, CM_ERROR_OK);
+        CM_BREAK_REASON break_reason{};
+        error_code = cm_machine_run(_machine, 100000, &break_reason, &err_msg);
+        BOOST_CHECK_EQUAL(error_code, CM_ERROR_OK);
+        BOOST_CHECK_EQUAL(err_msg, nullptr);
+        BOOST_CHECK_EQUAL(break_reason, CM_BREAK_REASON_REACHED_TARGET_MCYCLE);
+        cm_delete_machine(_machine);
+        _machine = nullptr;
+    }
+
+    _machine_config.virtio = cm_virtio_config_array{};
+    std::filesystem::remove(image_path);
+}
+
+// Writes "hi\n" to the HTIF console, then loops forever
+static void load_console_program(cm_machine *m) {
+    static const uint32_t program[] = {
+        0x400082b7, // 0x80000000: lui x5, 0x40008
+        0x00100313, // 0x80000004: addi x6, x0, 1
+        0x03831313, // 0x80000008: slli x6, x6, 56
+        0x00100393, // 0x8000000c: addi x7, x0, 1
+        0x03039393, // 0x80000010: slli x7, x7, 48
+        0x00736333, // 0x80000014: or x6, x6, x7
+        0x06836413, // 0x80000018: ori x8, x6, 'h'
+        0x0082b023, // 0x8000001c: sd x8, 0(x5)
+        0x06936413, // 0x80000020: ori x8, x6, 'i'
+        0x0082b023, // 0x80000024: sd x8, 0(x5)
+        0x00a36413, // 0x80000028: ori x8, x6, '\n'
+        0x0082b023, // 0x8000002c: sd x8, 0(x5)
+        0x0000006f, // 0x80000030: j 0x80000030
+    };
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+    const auto *data = reinterpret_cast<const unsigned char *>(program);
+    BOOST_REQUIRE_EQUAL(cm_write_memory(m, 0x80000000, data, sizeof(program), nullptr), CM_ERROR_OK);
+    BOOST_REQUIRE_EQUAL(cm_write_pc(m, 0x80000000, nullptr), CM_ERROR_OK);
+}
+
+BOOST_FIXTURE_TEST_CASE_NOLINT(create_machine_invalid_console_output_test, incomplete_machine_fixture) {
+    _runtime_config.console.output_mode = static_cast<CM_CONSOLE_OUTPUT_MODE>(-1);
+    char *err_msg{};
+    int error_code = cm_create_machine(&_machine_config, &_runtime_config, &_machine, &err_msg);
+    BOOST_CHECK_EQUAL(error_code, CM_ERROR_INVALID_ARGUMENT);
+    BOOST_CHECK_EQUAL(std::string(err_msg), "invalid console output mode");
+    cm_delete_cstring(err_msg);
+
+    _runtime_config.console.output_mode = CM_CONSOLE_OUTPUT_FILE;
+    error_code = cm_create_machine(&_machine_config, &_runtime_config, &_machine, &err_msg);
+    BOOST_CHECK_EQUAL(error_code, CM_ERROR_INVALID_ARGUMENT);
+    BOOST_CHECK_EQUAL(std::string(err_msg), "console output file name must be specified");
+    cm_delete_cstring(err_msg);
+    _runtime_config.console = cm_console_runtime_config{};
+}
+
+BOOST_FIXTURE_TEST_CASE_NOLINT(machine_console_output_memory_test, incomplete_machine_fixture) {
+    _runtime_config.console.output_mode = CM_CONSOLE_OUTPUT_MEMORY;
+    BOOST_REQUIRE_EQUAL(cm_create_machine(&_machine_config, &_runtime_config, &_machine, nullptr), CM_ERROR_OK);
+    load_console_program(_machine);
+    CM_BREAK_REASON break_reason{};
+    BOOST_REQUIRE_EQUAL(cm_machine_run(_machine, 100, &break_reason, nullptr), CM_ERROR_OK);
+
+    std::array<uint8_t, 16> data{};
+    uint64_t length = 0;
+    BOOST_REQUIRE_EQUAL(cm_machine_read_console_output(_machine, data.data(), 2, &length, nullptr), CM_ERROR_OK);
+    BOOST_CHECK_EQUAL(std::string(data.begin(), data.begin() + length), "hi");
+    BOOST_REQUIRE_EQUAL(cm_machine_read_console_output(_machine, data.data(), data.size(), &length, nullptr),
+        CM_ERROR_OK);
+    BOOST_CHECK_EQUAL(std::string(data.begin(), data.begin() + length), "\n");
+    BOOST_REQUIRE_EQUAL(cm_machine_read_console_output(_machine, data.data(), data.size(), &length, nullptr),
+        CM_ERROR_OK);
+    BOOST_CHECK_EQUAL(length, 0);
+    cm_delete_machine(_machine);
+    _machine = nullptr;
+
+    // A buffer too small for the output keeps only the most recent characters
+    _runtime_config.console.output_buffer_size = 2;
+    BOOST_REQUIRE_EQUAL(cm_create_machine(&_machine_config, &_runtime_config, &_machine, nullptr), CM_ERROR_OK);
+    load_console_program(_machine);
+    BOOST_REQUIRE_EQUAL(cm_machine_run(_machine, 100, &break_reason, nullptr), CM_ERROR_OK);
+    BOOST_REQUIRE_EQUAL(cm_machine_read_console_output(_machine, data.data(), data.size(), &length, nullptr),
+        CM_ERROR_OK);
+    BOOST_CHECK_EQUAL(std::string(data.begin(), data.begin() + length), "i\n");
+    cm_delete_machine(_machine);
+    _machine = nullptr;
+    _runtime_config.console = cm_console_runtime_config{};
+}
+
+BOOST_FIXTURE_TEST_CASE_NOLINT(machine_console_output_file_test, incomplete_machine_fixture) {
+    const std::string output_path = "./console.txt";
+    _runtime_config.console.output_mode = CM_CONSOLE_OUTPUT_FILE;
+    _runtime_config.console.output_filename = output_path.c_str();
+    BOOST_REQUIRE_EQUAL(cm_create_machine(&_machine_config, &_runtime_config, &_machine, nullptr), CM_ERROR_OK);
+    load_console_program(_machine);
+    CM_BREAK_REASON break_reason{};
+    BOOST_REQUIRE_EQUAL(cm_machine_run(_machine, 100, &break_reason, nullptr), CM_ERROR_OK);
+
+    // Output is flushed before run returns
+    std::ifstream output(output_path);
+    const std::string contents((std::istreambuf_iterator<char>(output)), std::istreambuf_iterator<char>());
+    BOOST_CHECK_EQUAL(contents, "hi\n");
+
+    // Only memory mode captures output
+    std::array<uint8_t, 16> data{};
+    uint64_t length = 1;
+    BOOST_REQUIRE_EQUAL(cm_machine_read_console_output(_machine, data.data(), data.size(), &length, nullptr),
+        CM_ERROR_OK);
+    BOOST_CHECK_EQUAL(length, 0);
+
+    cm_delete_machine(_machine);
+    _machine = nullptr;
+    _runtime_config.console = cm_console_runtime_config{};
+    std::filesystem::remove(output_path);
+}
+
+BOOST_FIXTURE_TEST_CASE_NOLINT(machine_huge_pages_test, incomplete_machine_fixture) {
+    _machine_config.ram.length = 64 << 20;
+    std::array<cm_hash, 2> hashes{};
+    for (int i = 0; i < 2; ++i) {
+        _runtime_config.huge_pages = (i != 0);
+        char *err_msg{};
+        int error_code = cm_create_machine(&_machine_config, &_runtime_config, &_machine, &err_msg);
+        BOOST_REQUIRE_EQUAL(error_code, CM_ERROR_OK);
+        BOOST_CHECK_EQUAL(err_msg, nullptr);
+
+        cm_memory_range_descr_array *mrds{};
+        error_code = cm_get_memory_ranges(_machine, &mrds, &err_msg);
+        BOOST_REQUIRE_EQUAL(error_code, CM_ERROR_OK);
+        for (size_t j = 0; j < mrds->count; ++j) {
+            const auto &mrd = mrds->entry[j];
+            if (mrd.start != cartesi::PMA_RAM_START) {
+                // Only ranges allocated by the emulator itself are advised
+                BOOST_CHECK(!mrd.huge_pages);
+            } else if (!_runtime_config.huge_pages) {
+                BOOST_CHECK(!mrd.huge_pages);
+            } else if (std::filesystem::exists("/sys/kernel/mm/transparent_hugepage/enabled")) {
+                BOOST_CHECK(mrd.huge_pages);
+            }
+        }
+        cm_delete_memory_range_descr_array(mrds);
+
+        // Huge pages are a host-side detail and must not change the machine state
+        error_code = cm_get_root_hash(_machine, &hashes[i], &err_msg);
+        BOOST_REQUIRE_EQUAL(error_code, CM_ERROR_OK);
+        cm_delete_machine(_machine);
+        _machine = nullptr;
+    }
+    BOOST_CHECK_EQUAL_COLLECTIONS(hashes[0], hashes[0] + sizeof(cm_hash), hashes[1], hashes[1] + sizeof(cm_hash));
+    _runtime_config.huge_pages = false;
+}
+
 class machine_flash_fixture : public incomplete_machine_fixture {
 public:
     machine_flash_fixture() {
@@ -861,6 +1113,64 @@ BOOST_FIXTURE_TEST_CASE_NOLINT(write_memory_null_error_placeholder_test, ordinar
     BOOST_CHECK_EQUAL(read_value, write_value);
 }
 
+BOOST_FIXTURE_TEST_CASE_NOLINT(send_cmio_response_padding_test, ordinary_machine_fixture) {
+    constexpr uint64_t rx_buffer_start = 0x60000000;
+    // Leave garbage in the rx buffer, so the padding must overwrite some of it
+    std::vector<uint8_t> garbage(3 * 4096 + 5, 0xaa);
+    BOOST_REQUIRE_EQUAL(cm_write_memory(_machine, rx_buffer_start, garbage.data(), garbage.size(), nullptr),
+        CM_ERROR_OK);
+    // Response of 5000 bytes is padded to 8192
+    std::vector<uint8_t> response(5000);
+    for (size_t i = 0; i < response.size(); ++i) {
+        response[i] = static_cast<uint8_t>(i + 1);
+    }
+    BOOST_REQUIRE_EQUAL(cm_set_iflags_Y(_machine, nullptr), CM_ERROR_OK);
+    cm_hash root_hash_before{};
+    BOOST_REQUIRE_EQUAL(cm_get_root_hash(_machine, &root_hash_before, nullptr), CM_ERROR_OK);
+    const cm_access_log_type log_type{true, false, true};
+    cm_access_log *access_log{};
+    BOOST_REQUIRE_EQUAL(cm_log_send_cmio_response(_machine, 1, response.data(), response.size(), log_type, false,
+                            &access_log, nullptr),
+        CM_ERROR_OK);
+    cm_hash root_hash_after{};
+    BOOST_REQUIRE_EQUAL(cm_get_root_hash(_machine, &root_hash_after, nullptr), CM_ERROR_OK);
+    char *err_msg{};
+    int error_code = cm_verify_send_cmio_response_state_transition(1, response.data(), response.size(),
+        &root_hash_before, access_log, &root_hash_after, &_runtime_config, false, &err_msg);
+    BOOST_CHECK_EQUAL(error_code, CM_ERROR_OK);
+    BOOST_CHECK_EQUAL(err_msg, nullptr);
+    cm_delete_cstring(err_msg);
+    cm_delete_access_log(access_log);
+    bool result = false;
+    BOOST_REQUIRE_EQUAL(cm_verify_merkle_tree(_machine, &result, nullptr), CM_ERROR_OK);
+    BOOST_CHECK(result);
+    // Data is followed by zeros up to the padded length, and the garbage past it is left alone
+    std::vector<uint8_t> rx(garbage.size());
+    BOOST_REQUIRE_EQUAL(cm_read_memory(_machine, rx_buffer_start, rx.data(), rx.size(), nullptr), CM_ERROR_OK);
+    std::vector<uint8_t> expected(garbage);
+    std::copy(response.begin(), response.end(), expected.begin());
+    std::fill(expected.begin() + response.size(), expected.begin() + 8192, 0);
+    BOOST_CHECK(rx == expected);
+}
+
+BOOST_FIXTURE_TEST_CASE_NOLINT(get_cmio_tx_buffer_test, ordinary_machine_fixture) {
+    constexpr uint64_t tx_buffer_start = 0x60800000;
+    const std::array<uint8_t, 8> output{0xde, 0xad, 0xbe, 0xef, 0x01, 0x02, 0x03, 0x04};
+    BOOST_REQUIRE_EQUAL(cm_write_memory(_machine, tx_buffer_start + 16, output.data(), output.size(), nullptr),
+        CM_ERROR_OK);
+    const unsigned char *data{};
+    uint64_t length = 0;
+    BOOST_REQUIRE_EQUAL(cm_machine_get_cmio_tx_buffer(_machine, &data, &length, nullptr), CM_ERROR_OK);
+    BOOST_REQUIRE(data != nullptr);
+    BOOST_CHECK_EQUAL(length, static_cast<uint64_t>(1) << 21);
+    BOOST_CHECK_EQUAL_COLLECTIONS(data + 16, data + 16 + output.size(), output.begin(), output.end());
+    char *err_msg{};
+    BOOST_CHECK_EQUAL(cm_machine_get_cmio_tx_buffer(_machine, nullptr, &length, &err_msg),
+        CM_ERROR_INVALID_ARGUMENT);
+    BOOST_CHECK_EQUAL(std::string(err_msg), "invalid data output");
+    cm_delete_cstring(err_msg);
+}
+
 BOOST_FIXTURE_TEST_CASE_NOLINT(read_write_virtual_memory_null_data_test, ordinary_machine_fixture) {
     int error_code = cm_read_virtual_memory(_machine, 0x80000000, nullptr, 1, nullptr);
     BOOST_CHECK_EQUAL(error_code, CM_ERROR_INVALID_ARGUMENT);
@@ -1056,6 +1366,157 @@ BOOST_FIXTURE_TEST_CASE_NOLINT(read_write_virtual_memory_massive_test, ordinary_
     BOOST_CHECK_EQUAL_COLLECTIONS(write_data.begin(), write_data.end(), read_data.begin(), read_data.end());
 }
 
+BOOST_FIXTURE_TEST_CASE_NOLINT(translate_virtual_address_page_table_change_test, ordinary_machine_fixture) {
+    // Sv39 page tables mapping virtual page 0x1000 through a root table, a middle table, and one of two leaf tables
+    const uint64_t root_table = 0x80080000;
+    const uint64_t middle_table = 0x80081000;
+    const uint64_t leaf_table_a = 0x80082000;
+    const uint64_t leaf_table_b = 0x80083000;
+    const uint64_t leaf_flags =
+        cartesi::PTE_V_MASK | cartesi::PTE_R_MASK | cartesi::PTE_W_MASK | cartesi::PTE_A_MASK | cartesi::PTE_D_MASK;
+    const auto make_pte = [](uint64_t paddr, uint64_t flags) {
+        return ((paddr >> 12) << cartesi::PTE_PPN_SHIFT) | flags;
+    };
+    const auto write_pte = [this](uint64_t paddr, uint64_t pte) {
+        BOOST_REQUIRE_EQUAL(cm_write_memory(_machine, paddr, reinterpret_cast<const unsigned char *>(&pte),
+                                sizeof(pte), nullptr),
+            CM_ERROR_OK);
+    };
+    write_pte(root_table, make_pte(middle_table, cartesi::PTE_V_MASK));
+    write_pte(middle_table, make_pte(leaf_table_a, cartesi::PTE_V_MASK));
+    write_pte(leaf_table_a + sizeof(uint64_t), make_pte(0x80090000, leaf_flags));
+    write_pte(leaf_table_b + sizeof(uint64_t), make_pte(0x800a0000, leaf_flags));
+    const uint64_t satp = (static_cast<uint64_t>(cartesi::SATP_MODE_SV39) << cartesi::SATP_MODE_SHIFT) |
+        (root_table >> 12);
+    BOOST_REQUIRE_EQUAL(cm_write_satp(_machine, satp, nullptr), CM_ERROR_OK);
+    BOOST_REQUIRE_EQUAL(cm_write_iflags(_machine, cm_packed_iflags(cartesi::PRV_S, 0, 0, 0), nullptr), CM_ERROR_OK);
+
+    uint64_t paddr = 0;
+    BOOST_REQUIRE_EQUAL(cm_translate_virtual_address(_machine, 0x1234, &paddr, nullptr), CM_ERROR_OK);
+    BOOST_CHECK_EQUAL(paddr, 0x80090234);
+    BOOST_REQUIRE_EQUAL(cm_translate_virtual_address(_machine, 0x1238, &paddr, nullptr), CM_ERROR_OK);
+    BOOST_CHECK_EQUAL(paddr, 0x80090238);
+
+    // Changing a non-leaf PTE must be seen by the next translation, even without SFENCE.VMA
+    write_pte(middle_table, make_pte(leaf_table_b, cartesi::PTE_V_MASK));
+    BOOST_REQUIRE_EQUAL(cm_translate_virtual_address(_machine, 0x1234, &paddr, nullptr), CM_ERROR_OK);
+    BOOST_CHECK_EQUAL(paddr, 0x800a0234);
+
+    // Invalidating a non-leaf PTE must make the translation fail
+    write_pte(middle_table, 0);
+    BOOST_CHECK_EQUAL(cm_translate_virtual_address(_machine, 0x1234, &paddr, nullptr), CM_ERROR_INVALID_ARGUMENT);
+}
+
+BOOST_FIXTURE_TEST_CASE_NOLINT(translate_virtual_address_superpage_change_test, ordinary_machine_fixture) {
+    // Sv39 page tables mapping the first 2MiB of virtual memory with a megapage
+    const uint64_t root_table = 0x80080000;
+    const uint64_t middle_table = 0x80081000;
+    const uint64_t leaf_flags =
+        cartesi::PTE_V_MASK | cartesi::PTE_R_MASK | cartesi::PTE_W_MASK | cartesi::PTE_A_MASK | cartesi::PTE_D_MASK;
+    const auto make_pte = [](uint64_t paddr, uint64_t flags) {
+        return ((paddr >> 12) << cartesi::PTE_PPN_SHIFT) | flags;
+    };
+    const auto write_pte = [this](uint64_t paddr, uint64_t pte) {
+        BOOST_REQUIRE_EQUAL(cm_write_memory(_machine, paddr, reinterpret_cast<const unsigned char *>(&pte),
+                                sizeof(pte), nullptr),
+            CM_ERROR_OK);
+    };
+    write_pte(root_table, make_pte(middle_table, cartesi::PTE_V_MASK));
+    write_pte(middle_table, make_pte(0x80200000, leaf_flags));
+    const uint64_t satp = (static_cast<uint64_t>(cartesi::SATP_MODE_SV39) << cartesi::SATP_MODE_SHIFT) |
+        (root_table >> 12);
+    BOOST_REQUIRE_EQUAL(cm_write_satp(_machine, satp, nullptr), CM_ERROR_OK);
+    BOOST_REQUIRE_EQUAL(cm_write_iflags(_machine, cm_packed_iflags(cartesi::PRV_S, 0, 0, 0), nullptr), CM_ERROR_OK);
+
+    uint64_t paddr = 0;
+    BOOST_REQUIRE_EQUAL(cm_translate_virtual_address(_machine, 0x1234, &paddr, nullptr), CM_ERROR_OK);
+    BOOST_CHECK_EQUAL(paddr, 0x80201234);
+    BOOST_REQUIRE_EQUAL(cm_translate_virtual_address(_machine, 0x5678, &paddr, nullptr), CM_ERROR_OK);
+    BOOST_CHECK_EQUAL(paddr, 0x80205678);
+
+    // Changing the leaf PTE must be seen by the next translation, even without SFENCE.VMA
+    write_pte(middle_table, make_pte(0x80400000, leaf_flags));
+    BOOST_REQUIRE_EQUAL(cm_translate_virtual_address(_machine, 0x1234, &paddr, nullptr), CM_ERROR_OK);
+    BOOST_CHECK_EQUAL(paddr, 0x80401234);
+
+    // Revoking read permission must make the translation fail
+    write_pte(middle_table, make_pte(0x80400000, cartesi::PTE_V_MASK | cartesi::PTE_X_MASK | cartesi::PTE_A_MASK));
+    BOOST_CHECK_EQUAL(cm_translate_virtual_address(_machine, 0x1234, &paddr, nullptr), CM_ERROR_INVALID_ARGUMENT);
+}
+
+BOOST_FIXTURE_TEST_CASE_NOLINT(translate_virtual_address_mode_test, ordinary_machine_fixture) {
+    // Sv39 page tables mapping the first 2MiB of virtual memory with a megapage
+    const uint64_t root_table = 0x80080000;
+    const uint64_t middle_table = 0x80081000;
+    const uint64_t leaf_flags =
+        cartesi::PTE_V_MASK | cartesi::PTE_R_MASK | cartesi::PTE_W_MASK | cartesi::PTE_A_MASK | cartesi::PTE_D_MASK;
+    const auto make_pte = [](uint64_t paddr, uint64_t flags) {
+        return ((paddr >> 12) << cartesi::PTE_PPN_SHIFT) | flags;
+    };
+    const auto write_pte = [this](uint64_t paddr, uint64_t pte) {
+        BOOST_REQUIRE_EQUAL(cm_write_memory(_machine, paddr, reinterpret_cast<const unsigned char *>(&pte),
+                                sizeof(pte), nullptr),
+            CM_ERROR_OK);
+    };
+    write_pte(root_table, make_pte(middle_table, cartesi::PTE_V_MASK));
+    write_pte(middle_table, make_pte(0x80200000, leaf_flags));
+    const uint64_t satp = (static_cast<uint64_t>(cartesi::SATP_MODE_SV39) << cartesi::SATP_MODE_SHIFT) |
+        (root_table >> 12);
+    BOOST_REQUIRE_EQUAL(cm_write_satp(_machine, satp, nullptr), CM_ERROR_OK);
+    uint64_t mstatus{};
+    BOOST_REQUIRE_EQUAL(cm_read_mstatus(_machine, &mstatus, nullptr), CM_ERROR_OK);
+    mstatus &= ~(cartesi::MSTATUS_MPRV_MASK | cartesi::MSTATUS_MPP_MASK);
+    BOOST_REQUIRE_EQUAL(cm_write_mstatus(_machine, mstatus, nullptr), CM_ERROR_OK);
+
+    // M-mode ignores satp
+    uint64_t paddr = 0;
+    BOOST_REQUIRE_EQUAL(cm_write_iflags(_machine, cm_packed_iflags(cartesi::PRV_M, 0, 0, 0), nullptr), CM_ERROR_OK);
+    BOOST_REQUIRE_EQUAL(cm_translate_virtual_address(_machine, 0x1234, &paddr, nullptr), CM_ERROR_OK);
+    BOOST_CHECK_EQUAL(paddr, 0x1234);
+
+    // Unless MPRV makes data accesses use the privilege in MPP
+    const uint64_t mpp_s = static_cast<uint64_t>(cartesi::PRV_S) << cartesi::MSTATUS_MPP_SHIFT;
+    BOOST_REQUIRE_EQUAL(cm_write_mstatus(_machine, mstatus | cartesi::MSTATUS_MPRV_MASK | mpp_s, nullptr),
+        CM_ERROR_OK);
+    BOOST_REQUIRE_EQUAL(cm_translate_virtual_address(_machine, 0x1234, &paddr, nullptr), CM_ERROR_OK);
+    BOOST_CHECK_EQUAL(paddr, 0x80201234);
+    BOOST_REQUIRE_EQUAL(cm_write_mstatus(_machine, mstatus, nullptr), CM_ERROR_OK);
+
+    // S-mode translates through the page tables
+    BOOST_REQUIRE_EQUAL(cm_write_iflags(_machine, cm_packed_iflags(cartesi::PRV_S, 0, 0, 0), nullptr), CM_ERROR_OK);
+    BOOST_REQUIRE_EQUAL(cm_translate_virtual_address(_machine, 0x1234, &paddr, nullptr), CM_ERROR_OK);
+    BOOST_CHECK_EQUAL(paddr, 0x80201234);
+
+    // Bare mode does not translate
+    BOOST_REQUIRE_EQUAL(cm_write_satp(_machine, 0, nullptr), CM_ERROR_OK);
+    BOOST_REQUIRE_EQUAL(cm_translate_virtual_address(_machine, 0x1234, &paddr, nullptr), CM_ERROR_OK);
+    BOOST_CHECK_EQUAL(paddr, 0x1234);
+
+    // Unsupported modes make the translation fail
+    const uint64_t reserved_mode = UINT64_C(1) << cartesi::SATP_MODE_SHIFT;
+    BOOST_REQUIRE_EQUAL(cm_write_satp(_machine, reserved_mode | (root_table >> 12), nullptr), CM_ERROR_OK);
+    BOOST_CHECK_EQUAL(cm_translate_virtual_address(_machine, 0x1234, &paddr, nullptr), CM_ERROR_INVALID_ARGUMENT);
+}
+
+BOOST_FIXTURE_TEST_CASE_NOLINT(read_memory_range_boundaries_test, ordinary_machine_fixture) {
+    cm_memory_range_descr_array *mrda{};
+    BOOST_REQUIRE_EQUAL(cm_get_memory_ranges(_machine, &mrda, nullptr), CM_ERROR_OK);
+    std::array<uint8_t, sizeof(uint64_t)> read_data{};
+    // The first and the last words of every range must be found
+    for (size_t i = 0; i < mrda->count; ++i) {
+        const auto &mrd = mrda->entry[i];
+        BOOST_CHECK_EQUAL(cm_read_memory(_machine, mrd.start, read_data.data(), read_data.size(), nullptr),
+            CM_ERROR_OK);
+        BOOST_CHECK_EQUAL(cm_read_memory(_machine, mrd.start + mrd.length - read_data.size(), read_data.data(),
+                              read_data.size(), nullptr),
+            CM_ERROR_OK);
+    }
+    cm_delete_memory_range_descr_array(mrda);
+    // A word straddling the end of RAM is not covered by any range
+    const uint64_t ram_end = 0x80000000 + (1 << 20);
+    BOOST_CHECK_NE(cm_read_memory(_machine, ram_end - 4, read_data.data(), read_data.size(), nullptr), CM_ERROR_OK);
+}
+
 // NOLINTNEXTLINE
 #define CHECK_READER_FAILS_ON_nullptr_MACHINE(T, reader_f)                                                             \
     BOOST_FIXTURE_TEST_CASE_NOLINT(read_##reader_f##_null_machine_test, ordinary_machine_fixture) {                    \
@@ -1434,6 +1895,25 @@ BOOST_FIXTURE_TEST_CASE_NOLINT(verify_dirty_page_maps_success_test, ordinary_mac
     BOOST_CHECK(result);
 }
 
+BOOST_FIXTURE_TEST_CASE_NOLINT(verify_dirty_page_maps_unaligned_write_test, ordinary_machine_fixture) {
+    char *err_msg{};
+    cm_hash hash{};
+    int error_code = cm_get_root_hash(_machine, &hash, &err_msg);
+    BOOST_REQUIRE_EQUAL(error_code, CM_ERROR_OK);
+
+    // Write a range that straddles a page boundary without covering a whole page
+    std::array<unsigned char, 16> data{};
+    data.fill(0xda);
+    error_code = cm_write_memory(_machine, 0x80000000 + 4096 - 8, data.data(), data.size(), &err_msg);
+    BOOST_REQUIRE_EQUAL(error_code, CM_ERROR_OK);
+
+    bool result{};
+    error_code = cm_verify_dirty_page_maps(_machine, &result, &err_msg);
+    BOOST_CHECK_EQUAL(error_code, CM_ERROR_OK);
+    BOOST_CHECK_EQUAL(err_msg, nullptr);
+    BOOST_CHECK(result);
+}
+
 BOOST_FIXTURE_TEST_CASE_NOLINT(replace_memory_range_null_flash_config_test, ordinary_machine_fixture) {
     char *err_msg{};
     int error_code = cm_replace_memory_range(_machine, nullptr, &err_msg);
@@ -2219,6 +2699,835 @@ BOOST_FIXTURE_TEST_CASE_NOLINT(machine_run_long_cycle_test, ordinary_machine_fix
     BOOST_CHECK_EQUAL_COLLECTIONS(verification.begin(), verification.end(), hash_end, hash_end + sizeof(cm_hash));
 }
 
+// Runs instruction pairs the interpreter executes fused, ending with a load that faults in the second instruction
+static void load_fused_pairs_program(cm_machine *m) {
+    static const uint32_t program[] = {
+        0x12345537, // 0x80000000: lui x10, 0x12345
+        0x67850513, // 0x80000004: addi x10, x10, 0x678
+        0x800005b7, // 0x80000008: lui x11, 0x80000
+        0xfff5859b, // 0x8000000c: addiw x11, x11, -1
+        0x00000617, // 0x80000010: auipc x12, 0
+        0x10060613, // 0x80000014: addi x12, x12, 0x100
+        0x00000697, // 0x80000018: auipc x13, 0
+        0x1006b683, // 0x8000001c: ld x13, 0x100(x13)
+        0xfff00713, // 0x80000020: addi x14, x0, -1
+        0x02071793, // 0x80000024: slli x15, x14, 32
+        0x0207d793, // 0x80000028: srli x15, x15, 32
+        0x00e03833, // 0x8000002c: sltu x16, x0, x14
+        0x00081463, // 0x80000030: bnez x16, 0x80000038
+        0x00100893, // 0x80000034: addi x17, x0, 1
+        0x00072833, // 0x80000038: slt x16, x14, x0
+        0x00080463, // 0x8000003c: beqz x16, 0x80000044
+        0x00200913, // 0x80000040: addi x18, x0, 2
+        0x00000097, // 0x80000044: auipc x1, 0
+        0x014080e7, // 0x80000048: jalr x1, 0x14(x1)
+        0x00300893, // 0x8000004c: addi x17, x0, 3
+        0x0000006f, // 0x80000050: j 0x80000050
+        0x00000013, // 0x80000054: nop
+        0x40000997, // 0x80000058: auipc x19, 0x40000
+        0x0009ba03, // 0x8000005c: ld x20, 0(x19)
+        0x00400a93, // 0x80000060: addi x21, x0, 4
+        0x0000006f, // 0x80000064: j 0x80000064
+    };
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+    const auto *data = reinterpret_cast<const unsigned char *>(program);
+    BOOST_REQUIRE_EQUAL(cm_write_memory(m, 0x80000000, data, sizeof(program), nullptr), CM_ERROR_OK);
+    const uint64_t value = 0x0123456789abcdef;
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+    const auto *value_data = reinterpret_cast<const unsigned char *>(&value);
+    BOOST_REQUIRE_EQUAL(cm_write_memory(m, 0x80000118, value_data, sizeof(value), nullptr), CM_ERROR_OK);
+    BOOST_REQUIRE_EQUAL(cm_write_csr(m, CM_PROC_MTVEC, 0x80000060, nullptr), CM_ERROR_OK);
+    BOOST_REQUIRE_EQUAL(cm_write_pc(m, 0x80000000, nullptr), CM_ERROR_OK);
+}
+
+BOOST_FIXTURE_TEST_CASE_NOLINT(machine_run_fused_pairs_test, incomplete_machine_fixture) {
+    // Running one cycle at a time never fuses instructions, so it is the reference for all other step sizes
+    const uint64_t mcycle_end = 64;
+    std::array<cm_hash, 4> hashes{};
+    const std::array<uint64_t, 4> steps{1, 2, 3, mcycle_end};
+    for (size_t i = 0; i < steps.size(); ++i) {
+        BOOST_REQUIRE_EQUAL(cm_create_machine(&_machine_config, &_runtime_config, &_machine, nullptr), CM_ERROR_OK);
+        load_fused_pairs_program(_machine);
+        for (uint64_t mcycle = steps[i]; mcycle < mcycle_end + steps[i]; mcycle += steps[i]) {
+            BOOST_REQUIRE_EQUAL(cm_machine_run(_machine, std::min(mcycle, mcycle_end), nullptr, nullptr), CM_ERROR_OK);
+        }
+        const std::array<std::pair<int, uint64_t>, 12> expected_x{{
+            {1, 0x8000004c},
+            {10, 0x12345678},
+            {11, 0x7fffffff},
+            {12, 0x80000110},
+            {13, 0x0123456789abcdef},
+            {15, 0xffffffff},
+            {16, 1},
+            {17, 0},
+            {18, 2},
+            {19, 0xc0000058},
+            {20, 0},
+            {21, 4},
+        }};
+        for (const auto &[reg, value] : expected_x) {
+            uint64_t x{};
+            BOOST_REQUIRE_EQUAL(cm_read_x(_machine, reg, &x, nullptr), CM_ERROR_OK);
+            BOOST_CHECK_EQUAL(x, value);
+        }
+        uint64_t mepc{};
+        uint64_t mcause{};
+        BOOST_REQUIRE_EQUAL(cm_read_csr(_machine, CM_PROC_MEPC, &mepc, nullptr), CM_ERROR_OK);
+        BOOST_REQUIRE_EQUAL(cm_read_csr(_machine, CM_PROC_MCAUSE, &mcause, nullptr), CM_ERROR_OK);
+        BOOST_CHECK_EQUAL(mepc, 0x8000005c);
+        BOOST_CHECK_EQUAL(mcause, cartesi::MCAUSE_LOAD_ACCESS_FAULT);
+        BOOST_REQUIRE_EQUAL(cm_get_root_hash(_machine, &hashes[i], nullptr), CM_ERROR_OK);
+        cm_delete_machine(_machine);
+        _machine = nullptr;
+        BOOST_CHECK_EQUAL_COLLECTIONS(hashes[0], hashes[0] + sizeof(cm_hash), hashes[i], hashes[i] + sizeof(cm_hash));
+    }
+}
+
+// Calls functions in pages that share a code TLB entry, crosses a page in the middle of an instruction, flushes
+// the TLB, traps and returns without changing privilege, and switches between machine and user mode 100 times.
+// It ends spinning either right after a TLB flush, or right after returning from a page that evicted the spinning
+// page from the TLB, so any TLB state that depends on the fetch translation cache remains visible.
+static void load_fetch_cache_program(cm_machine *m, bool flush_at_end) {
+    struct code {
+        uint64_t paddr;
+        std::vector<uint32_t> insns;
+    };
+    static const std::array<code, 6> program{{
+        {0x80000000,
+            {
+                0x00003297, // 0x80000000: auipc x5, 0x3
+                0x00028293, // 0x80000004: addi x5, x5, 0
+                0x30529073, // 0x80000008: csrw mtvec, x5
+                0x00000413, // 0x8000000c: addi x8, x0, 0
+                0x06400493, // 0x80000010: addi x9, x0, 100
+                0x7ed070ef, // 0x80000014: jal x1, 0x80008000
+                0x00100097, // 0x80000018: auipc x1, 0x100
+                0xfe8080e7, // 0x8000001c: jalr x1, -24(x1)
+                0x7d9010ef, // 0x80000020: jal x1, 0x80001ff8
+                0x12000073, // 0x80000024: sfence.vma
+                0x00004297, // 0x80000028: auipc x5, 0x4
+                0xfd828293, // 0x8000002c: addi x5, x5, -40
+                0x34129073, // 0x80000030: csrw mepc, x5
+                0x000022b7, // 0x80000034: lui x5, 0x2
+                0x8002829b, // 0x80000038: addiw x5, x5, -2048
+                0x3002b073, // 0x8000003c: csrc mstatus, x5
+                0x30200073, // 0x80000040: mret
+                0x00140413, // 0x80000044: addi x8, x8, 1
+                0xfc9466e3, // 0x80000048: bltu x8, x9, 0x80000014
+                0x7ad010ef, // 0x8000004c: jal x1, 0x80001ff8
+                0x12000073, // 0x80000050: sfence.vma
+                0x7a5010ef, // 0x80000054: jal x1, 0x80001ff8
+                0x00100097, // 0x80000058: auipc x1, 0x100
+                0xfa8080e7, // 0x8000005c: jalr x1, -88(x1)
+                0x12000073, // 0x80000060: sfence.vma
+                0x0000006f, // 0x80000064: j 0x80000064
+            }},
+        {0x80001ff8,
+            {
+                0x00158593, // 0x80001ff8: addi x11, x11, 1
+                0x06130001, // 0x80001ffc: c.nop; 0x80001ffe: addi x12, x12, 1 (crosses the page boundary)
+                0x80670016, // 0x80002002: ret
+                0x00000000,
+            }},
+        {0x80003000,
+            {
+                0x00170713, // 0x80003000: addi x14, x14, 1
+                0xffffd297, // 0x80003004: auipc x5, 0xffffd
+                0x04028293, // 0x80003008: addi x5, x5, 64
+                0x34129073, // 0x8000300c: csrw mepc, x5
+                0x000022b7, // 0x80003010: lui x5, 0x2
+                0x8002829b, // 0x80003014: addiw x5, x5, -2048
+                0x3002a073, // 0x80003018: csrs mstatus, x5
+                0x30200073, // 0x8000301c: mret
+            }},
+        {0x80004000,
+            {
+                0x00168693, // 0x80004000: addi x13, x13, 1
+                0x7fd030ef, // 0x80004004: jal x1, 0x80008000
+                0x00000073, // 0x80004008: ecall
+            }},
+        {0x80008000,
+            {
+                0x00150513, // 0x80008000: addi x10, x10, 1
+                0x00008067, // 0x80008004: ret
+            }},
+        {0x80100000,
+            {
+                0x00178793, // 0x80100000: addi x15, x15, 1
+                0x00008067, // 0x80100004: ret
+            }},
+    }};
+    for (const auto &[paddr, insns] : program) {
+        // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+        const auto *data = reinterpret_cast<const unsigned char *>(insns.data());
+        BOOST_REQUIRE_EQUAL(cm_write_memory(m, paddr, data, insns.size() * sizeof(uint32_t), nullptr), CM_ERROR_OK);
+    }
+    if (!flush_at_end) {
+        const uint32_t nop = 0x00000013; // 0x80000060: addi x0, x0, 0
+        // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+        const auto *data = reinterpret_cast<const unsigned char *>(&nop);
+        BOOST_REQUIRE_EQUAL(cm_write_memory(m, 0x80000060, data, sizeof(nop), nullptr), CM_ERROR_OK);
+    }
+    BOOST_REQUIRE_EQUAL(cm_write_pc(m, 0x80000000, nullptr), CM_ERROR_OK);
+}
+
+BOOST_FIXTURE_TEST_CASE_NOLINT(machine_run_fetch_cache_test, incomplete_machine_fixture) {
+    // Running one cycle at a time starts every instruction with an empty fetch translation cache, so it is the
+    // reference for all other step sizes. The root hash covers the TLB, which must not depend on the cache.
+    _machine_config.ram.length = 2 << 20;
+    const uint64_t mcycle_end = 6000;
+    const std::array<uint64_t, 5> steps{1, 2, 3, 7, mcycle_end};
+    for (const bool flush_at_end : {true, false}) {
+        std::array<cm_hash, 5> hashes{};
+        for (size_t i = 0; i < steps.size(); ++i) {
+            BOOST_REQUIRE_EQUAL(cm_create_machine(&_machine_config, &_runtime_config, &_machine, nullptr),
+                CM_ERROR_OK);
+            load_fetch_cache_program(_machine, flush_at_end);
+            // Registers x10 to x15 count events
+            std::array<uint64_t, 6> x_begin{};
+            for (size_t reg = 0; reg < x_begin.size(); ++reg) {
+                BOOST_REQUIRE_EQUAL(cm_read_x(_machine, static_cast<int>(reg + 10), &x_begin[reg], nullptr),
+                    CM_ERROR_OK);
+            }
+            for (uint64_t mcycle = steps[i]; mcycle < mcycle_end + steps[i]; mcycle += steps[i]) {
+                BOOST_REQUIRE_EQUAL(cm_machine_run(_machine, std::min(mcycle, mcycle_end), nullptr, nullptr),
+                    CM_ERROR_OK);
+            }
+            std::array<uint64_t, 6> x{};
+            for (size_t reg = 0; reg < x.size(); ++reg) {
+                BOOST_REQUIRE_EQUAL(cm_read_x(_machine, static_cast<int>(reg + 10), &x[reg], nullptr), CM_ERROR_OK);
+                x[reg] -= x_begin[reg];
+            }
+            uint64_t iterations{};
+            BOOST_REQUIRE_EQUAL(cm_read_x(_machine, 8, &iterations, nullptr), CM_ERROR_OK);
+            BOOST_CHECK_EQUAL(iterations, 100);
+            BOOST_CHECK_EQUAL(x[0], 200); // calls to 0x80008000
+            BOOST_CHECK_EQUAL(x[1], 102); // calls to 0x80001ff8
+            BOOST_CHECK_EQUAL(x[2], 102); // instructions across the page boundary
+            BOOST_CHECK_EQUAL(x[3], 100); // user mode entries
+            BOOST_CHECK_EQUAL(x[4], 100); // traps from user mode
+            BOOST_CHECK_EQUAL(x[5], 101); // calls to 0x80100000
+            BOOST_REQUIRE_EQUAL(cm_get_root_hash(_machine, &hashes[i], nullptr), CM_ERROR_OK);
+            cm_delete_machine(_machine);
+            _machine = nullptr;
+            BOOST_CHECK_EQUAL_COLLECTIONS(hashes[0], hashes[0] + sizeof(cm_hash), hashes[i],
+                hashes[i] + sizeof(cm_hash));
+        }
+    }
+}
+
+// Arms the timer two ticks ahead and spins. The interrupt handler counts and disarms the timer, and the spin loop
+// arms it again, so only the write to mtimecmp tells the interpreter when the next interrupt is due.
+static void load_timer_program(cm_machine *m) {
+    static const std::array<uint32_t, 26> program{
+        0x00000297, // 0x80000000: auipc x5, 0
+        0x05428293, // 0x80000004: addi x5, x5, 84
+        0x30529073, // 0x80000008: csrw mtvec, x5
+        0x02004937, // 0x8000000c: lui x18, 0x2004 (mtimecmp)
+        0x0200c9b7, // 0x80000010: lui x19, 0x200c (mtime + 8)
+        0x00000413, // 0x80000014: addi x8, x0, 0
+        0x00000493, // 0x80000018: addi x9, x0, 0
+        0x00000a93, // 0x8000001c: addi x21, x0, 0
+        0xff89b283, // 0x80000020: ld x5, -8(x19)
+        0x00228293, // 0x80000024: addi x5, x5, 2
+        0x00593023, // 0x80000028: sd x5, 0(x18)
+        0x08000293, // 0x8000002c: addi x5, x0, 128
+        0x3042a073, // 0x80000030: csrs mie, x5
+        0x30046073, // 0x80000034: csrsi mstatus, 8
+        0x00140413, // 0x80000038: addi x8, x8, 1
+        0xff548ee3, // 0x8000003c: beq x9, x21, 0x80000038
+        0x00048a93, // 0x80000040: addi x21, x9, 0
+        0xff89b283, // 0x80000044: ld x5, -8(x19)
+        0x00228293, // 0x80000048: addi x5, x5, 2
+        0x00593023, // 0x8000004c: sd x5, 0(x18)
+        0xfe9ff06f, // 0x80000050: j 0x80000038
+        0x00148493, // 0x80000054: addi x9, x9, 1
+        0x34202a73, // 0x80000058: csrr x20, mcause
+        0xfff00293, // 0x8000005c: addi x5, x0, -1
+        0x00593023, // 0x80000060: sd x5, 0(x18)
+        0x30200073, // 0x80000064: mret
+    };
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+    const auto *data = reinterpret_cast<const unsigned char *>(program.data());
+    BOOST_REQUIRE_EQUAL(cm_write_memory(m, 0x80000000, data, program.size() * sizeof(uint32_t), nullptr), CM_ERROR_OK);
+    BOOST_REQUIRE_EQUAL(cm_write_pc(m, 0x80000000, nullptr), CM_ERROR_OK);
+}
+
+BOOST_FIXTURE_TEST_CASE_NOLINT(machine_run_timer_test, incomplete_machine_fixture) {
+    // Running one cycle at a time checks for interrupts before every instruction, so it is the reference for the
+    // interpreter running until the next timer event
+    const uint64_t mcycle_end = 100000;
+    std::array<cm_hash, 4> hashes{};
+    std::array<uint64_t, 4> interrupts{};
+    const std::array<uint64_t, 4> steps{1, 3, 8191, mcycle_end};
+    for (size_t i = 0; i < steps.size(); ++i) {
+        BOOST_REQUIRE_EQUAL(cm_create_machine(&_machine_config, &_runtime_config, &_machine, nullptr), CM_ERROR_OK);
+        load_timer_program(_machine);
+        for (uint64_t mcycle = steps[i]; mcycle < mcycle_end + steps[i]; mcycle += steps[i]) {
+            BOOST_REQUIRE_EQUAL(cm_machine_run(_machine, std::min(mcycle, mcycle_end), nullptr, nullptr), CM_ERROR_OK);
+        }
+        uint64_t mcause{};
+        BOOST_REQUIRE_EQUAL(cm_read_x(_machine, 9, &interrupts[i], nullptr), CM_ERROR_OK);
+        BOOST_REQUIRE_EQUAL(cm_read_x(_machine, 20, &mcause, nullptr), CM_ERROR_OK);
+        BOOST_CHECK_EQUAL(mcause, cartesi::MCAUSE_INTERRUPT_FLAG | cartesi::MIP_MTIP_SHIFT);
+        BOOST_CHECK_EQUAL(interrupts[i], interrupts[0]);
+        BOOST_REQUIRE_EQUAL(cm_get_root_hash(_machine, &hashes[i], nullptr), CM_ERROR_OK);
+        cm_delete_machine(_machine);
+        _machine = nullptr;
+        BOOST_CHECK_EQUAL_COLLECTIONS(hashes[0], hashes[0] + sizeof(cm_hash), hashes[i], hashes[i] + sizeof(cm_hash));
+    }
+    // Each interrupt is due two or three RTC ticks after the previous one
+    BOOST_CHECK_GE(interrupts[0], mcycle_end / (3 * cartesi::RTC_FREQ_DIV));
+}
+
+// Arms the timer three ticks ahead and waits for interrupts in an idle loop made of WFI and a jump back to it. The
+// interrupt handler counts and arms the timer again.
+static void load_idle_program(cm_machine *m, uint32_t jump) {
+    const std::array<uint32_t, 20> program{
+        0x00000297, // 0x80000000: auipc x5, 0
+        0x03c28293, // 0x80000004: addi x5, x5, 60
+        0x30529073, // 0x80000008: csrw mtvec, x5
+        0x02004937, // 0x8000000c: lui x18, 0x2004 (mtimecmp)
+        0x0200c9b7, // 0x80000010: lui x19, 0x200c (mtime + 8)
+        0x00000493, // 0x80000014: addi x9, x0, 0
+        0xff89b283, // 0x80000018: ld x5, -8(x19)
+        0x00328293, // 0x8000001c: addi x5, x5, 3
+        0x00593023, // 0x80000020: sd x5, 0(x18)
+        0x08000293, // 0x80000024: addi x5, x0, 128
+        0x3042a073, // 0x80000028: csrs mie, x5
+        0x30046073, // 0x8000002c: csrsi mstatus, 8
+        0x10500073, // 0x80000030: wfi
+        jump,       // 0x80000034: jump back to wfi
+        0x00000013, // 0x80000038: nop
+        0x00148493, // 0x8000003c: addi x9, x9, 1
+        0x00093283, // 0x80000040: ld x5, 0(x18)
+        0x00328293, // 0x80000044: addi x5, x5, 3
+        0x00593023, // 0x80000048: sd x5, 0(x18)
+        0x30200073, // 0x8000004c: mret
+    };
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+    const auto *data = reinterpret_cast<const unsigned char *>(program.data());
+    BOOST_REQUIRE_EQUAL(cm_write_memory(m, 0x80000000, data, program.size() * sizeof(uint32_t), nullptr), CM_ERROR_OK);
+    BOOST_REQUIRE_EQUAL(cm_write_pc(m, 0x80000000, nullptr), CM_ERROR_OK);
+}
+
+BOOST_FIXTURE_TEST_CASE_NOLINT(machine_run_idle_test, incomplete_machine_fixture) {
+    // Running one cycle at a time executes every iteration of the idle loop, so it is the reference for skipping them
+    const uint64_t mcycle_end = 100001;
+    const std::array<uint32_t, 2> jumps{
+        0xffdff06f, // j 0x80000030
+        0x0001bff5, // c.j 0x80000030; c.nop
+    };
+    for (const uint32_t jump : jumps) {
+        std::array<cm_hash, 4> hashes{};
+        std::array<uint64_t, 4> interrupts{};
+        const std::array<uint64_t, 4> steps{1, 2, 8191, mcycle_end};
+        for (size_t i = 0; i < steps.size(); ++i) {
+            BOOST_REQUIRE_EQUAL(cm_create_machine(&_machine_config, &_runtime_config, &_machine, nullptr),
+                CM_ERROR_OK);
+            load_idle_program(_machine, jump);
+            for (uint64_t mcycle = steps[i]; mcycle < mcycle_end + steps[i]; mcycle += steps[i]) {
+                BOOST_REQUIRE_EQUAL(cm_machine_run(_machine, std::min(mcycle, mcycle_end), nullptr, nullptr),
+                    CM_ERROR_OK);
+            }
+            uint64_t mepc{};
+            BOOST_REQUIRE_EQUAL(cm_read_x(_machine, 9, &interrupts[i], nullptr), CM_ERROR_OK);
+            BOOST_REQUIRE_EQUAL(cm_read_csr(_machine, CM_PROC_MEPC, &mepc, nullptr), CM_ERROR_OK);
+            BOOST_CHECK((mepc == 0x80000030 || mepc == 0x80000034));
+            BOOST_CHECK_EQUAL(interrupts[i], interrupts[0]);
+            BOOST_REQUIRE_EQUAL(cm_get_root_hash(_machine, &hashes[i], nullptr), CM_ERROR_OK);
+            cm_delete_machine(_machine);
+            _machine = nullptr;
+            BOOST_CHECK_EQUAL_COLLECTIONS(hashes[0], hashes[0] + sizeof(cm_hash), hashes[i],
+                hashes[i] + sizeof(cm_hash));
+        }
+        // Each interrupt is due three RTC ticks after the previous one
+        BOOST_CHECK_EQUAL(interrupts[0], mcycle_end / (3 * cartesi::RTC_FREQ_DIV));
+    }
+}
+
+BOOST_AUTO_TEST_CASE_NOLINT(machine_run_record_trace_null_machine_test) {
+    cm_execution_trace *trace{};
+    CM_BREAK_REASON break_reason{};
+    int error_code = cm_machine_run_record_trace(nullptr, 1000, &trace, &break_reason, nullptr);
+    BOOST_REQUIRE_EQUAL(error_code, CM_ERROR_INVALID_ARGUMENT);
+    BOOST_CHECK_EQUAL(break_reason, CM_BREAK_REASON_FAILED);
+    BOOST_CHECK_EQUAL(trace, nullptr);
+}
+
+BOOST_FIXTURE_TEST_CASE_NOLINT(machine_run_record_trace_null_trace_test, ordinary_machine_fixture) {
+    int error_code = cm_machine_run_record_trace(_machine, 1000, nullptr, nullptr, nullptr);
+    BOOST_REQUIRE_EQUAL(error_code, CM_ERROR_INVALID_ARGUMENT);
+}
+
+BOOST_FIXTURE_TEST_CASE_NOLINT(machine_run_replay_trace_test, ordinary_machine_fixture) {
+    char *err_msg{};
+    cm_execution_trace *trace{};
+    CM_BREAK_REASON recorded_reason{};
+    int error_code = cm_machine_run_record_trace(_machine, 600000, &trace, &recorded_reason, &err_msg);
+    BOOST_REQUIRE_EQUAL(error_code, CM_ERROR_OK);
+    BOOST_REQUIRE_EQUAL(err_msg, nullptr);
+    BOOST_REQUIRE(trace != nullptr);
+
+    cm_hash recorded_hash;
+    error_code = cm_get_root_hash(_machine, &recorded_hash, &err_msg);
+    BOOST_REQUIRE_EQUAL(error_code, CM_ERROR_OK);
+
+    // The recording machine is no longer at the beginning of the trace
+    error_code = cm_machine_run_replay_trace(_machine, trace, nullptr, &err_msg);
+    BOOST_CHECK_EQUAL(error_code, CM_ERROR_INVALID_ARGUMENT);
+    cm_delete_cstring(err_msg);
+    err_msg = nullptr;
+
+    cm_machine *replay_machine{};
+    error_code = cm_create_machine(&_machine_config, &_runtime_config, &replay_machine, &err_msg);
+    BOOST_REQUIRE_EQUAL(error_code, CM_ERROR_OK);
+
+    CM_BREAK_REASON replayed_reason{};
+    error_code = cm_machine_run_replay_trace(replay_machine, trace, &replayed_reason, &err_msg);
+    BOOST_REQUIRE_EQUAL(error_code, CM_ERROR_OK);
+    BOOST_REQUIRE_EQUAL(err_msg, nullptr);
+    BOOST_CHECK_EQUAL(replayed_reason, recorded_reason);
+
+    cm_hash replayed_hash;
+    error_code = cm_get_root_hash(replay_machine, &replayed_hash, &err_msg);
+    BOOST_REQUIRE_EQUAL(error_code, CM_ERROR_OK);
+    BOOST_CHECK_EQUAL_COLLECTIONS(recorded_hash, recorded_hash + sizeof(cm_hash), replayed_hash,
+        replayed_hash + sizeof(cm_hash));
+
+    // Host device state was not updated by the replay, so the machine can no longer run on its own
+    error_code = cm_machine_run(replay_machine, UINT64_MAX, nullptr, &err_msg);
+    BOOST_CHECK_EQUAL(error_code, CM_ERROR_RUNTIME_ERROR);
+    BOOST_CHECK_EQUAL(std::string(err_msg),
+        std::string("machine was replayed from an execution trace and can only replay further traces"));
+    cm_delete_cstring(err_msg);
+    err_msg = nullptr;
+    cm_break_conditions conditions{};
+    cm_break_event event{};
+    error_code = cm_machine_run_until(replay_machine, UINT64_MAX, &conditions, nullptr, &event, &err_msg);
+    BOOST_CHECK_EQUAL(error_code, CM_ERROR_RUNTIME_ERROR);
+    cm_delete_cstring(err_msg);
+    err_msg = nullptr;
+    cm_execution_trace *rerecorded{};
+    error_code = cm_machine_run_record_trace(replay_machine, UINT64_MAX, &rerecorded, nullptr, &err_msg);
+    BOOST_CHECK_EQUAL(error_code, CM_ERROR_RUNTIME_ERROR);
+    BOOST_CHECK_EQUAL(rerecorded, nullptr);
+    cm_delete_cstring(err_msg);
+    err_msg = nullptr;
+
+    // A corrupted trace must be rejected
+    trace->data[0] ^= 0xff;
+    error_code = cm_machine_run_replay_trace(replay_machine, trace, nullptr, &err_msg);
+    BOOST_CHECK_EQUAL(error_code, CM_ERROR_INVALID_ARGUMENT);
+    cm_delete_cstring(err_msg);
+
+    cm_delete_machine(replay_machine);
+    cm_delete_execution_trace(trace);
+}
+
+BOOST_AUTO_TEST_CASE_NOLINT(machine_run_until_null_machine_test) {
+    cm_break_conditions conditions{};
+    int error_code = cm_machine_run_until(nullptr, 1000, &conditions, nullptr, nullptr, nullptr);
+    BOOST_CHECK_EQUAL(error_code, CM_ERROR_INVALID_ARGUMENT);
+}
+
+BOOST_FIXTURE_TEST_CASE_NOLINT(machine_run_until_null_conditions_test, ordinary_machine_fixture) {
+    char *err_msg{};
+    int error_code = cm_machine_run_until(_machine, 1000, nullptr, nullptr, nullptr, &err_msg);
+    BOOST_CHECK_EQUAL(error_code, CM_ERROR_INVALID_ARGUMENT);
+    BOOST_CHECK_EQUAL(std::string(err_msg), std::string("invalid break conditions"));
+    cm_delete_cstring(err_msg);
+}
+
+class run_until_machine_fixture : public ordinary_machine_fixture {
+public:
+    run_until_machine_fixture() {
+        load_program(_machine);
+    }
+
+protected:
+    // Stores x1 to 0x80000100, then increments x3 forever
+    static void load_program(cm_machine *m) {
+        static const uint32_t program[] = {
+            0x07f00093, // 0x80000000: addi x1, x0, 127
+            0x00100113, // 0x80000004: addi x2, x0, 1
+            0x01f11113, // 0x80000008: slli x2, x2, 31
+            0x10113023, // 0x8000000c: sd x1, 256(x2)
+            0x00118193, // 0x80000010: addi x3, x3, 1
+            0xffdff06f, // 0x80000014: j 0x80000010
+        };
+        // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+        const auto *data = reinterpret_cast<const unsigned char *>(program);
+        BOOST_REQUIRE_EQUAL(cm_write_memory(m, 0x80000000, data, sizeof(program), nullptr), CM_ERROR_OK);
+        BOOST_REQUIRE_EQUAL(cm_write_pc(m, 0x80000000, nullptr), CM_ERROR_OK);
+    }
+
+    void check_stop(uint64_t expected_pc, uint64_t expected_mcycle, uint64_t expected_x3) {
+        uint64_t pc{};
+        uint64_t mcycle{};
+        uint64_t x3{};
+        BOOST_REQUIRE_EQUAL(cm_read_pc(_machine, &pc, nullptr), CM_ERROR_OK);
+        BOOST_REQUIRE_EQUAL(cm_read_mcycle(_machine, &mcycle, nullptr), CM_ERROR_OK);
+        BOOST_REQUIRE_EQUAL(cm_read_x(_machine, 3, &x3, nullptr), CM_ERROR_OK);
+        BOOST_CHECK_EQUAL(pc, expected_pc);
+        BOOST_CHECK_EQUAL(mcycle, expected_mcycle);
+        BOOST_CHECK_EQUAL(x3, expected_x3);
+    }
+};
+
+BOOST_FIXTURE_TEST_CASE_NOLINT(machine_run_until_breakpoint_test, run_until_machine_fixture) {
+    uint64_t breakpoint = 0x80000010;
+    cm_break_conditions conditions{};
+    conditions.breakpoints = {&breakpoint, 1};
+    CM_BREAK_REASON reason{};
+    cm_break_event event{};
+    char *err_msg{};
+    int error_code = cm_machine_run_until(_machine, 1000, &conditions, &reason, &event, &err_msg);
+    BOOST_REQUIRE_EQUAL(error_code, CM_ERROR_OK);
+    BOOST_REQUIRE_EQUAL(err_msg, nullptr);
+    BOOST_CHECK_EQUAL(reason, CM_BREAK_REASON_REACHED_BREAK_CONDITION);
+    BOOST_CHECK_EQUAL(event.type, CM_BREAK_EVENT_BREAKPOINT);
+    BOOST_CHECK_EQUAL(event.index, 0);
+    BOOST_CHECK_EQUAL(event.address, breakpoint);
+    // Stopped before executing the instruction at the breakpoint
+    check_stop(breakpoint, 4, 0);
+
+    // Running again resumes from the breakpoint and stops at it on the next iteration
+    error_code = cm_machine_run_until(_machine, 1000, &conditions, &reason, &event, &err_msg);
+    BOOST_REQUIRE_EQUAL(error_code, CM_ERROR_OK);
+    BOOST_CHECK_EQUAL(reason, CM_BREAK_REASON_REACHED_BREAK_CONDITION);
+    check_stop(breakpoint, 6, 1);
+}
+
+BOOST_FIXTURE_TEST_CASE_NOLINT(machine_run_until_matches_run_test, run_until_machine_fixture) {
+    // A breakpoint that is never reached and a watchpoint that stops the run once must not change the outcome
+    uint64_t breakpoint = 0x80000020;
+    cm_watchpoint watchpoint{0x80000100, 8, false, false, true};
+    cm_break_conditions conditions{};
+    conditions.breakpoints = {&breakpoint, 1};
+    conditions.watchpoints = {&watchpoint, 1};
+    CM_BREAK_REASON reason{};
+    cm_break_event event{};
+    int error_code = cm_machine_run_until(_machine, 1000, &conditions, &reason, &event, nullptr);
+    BOOST_REQUIRE_EQUAL(error_code, CM_ERROR_OK);
+    BOOST_CHECK_EQUAL(reason, CM_BREAK_REASON_REACHED_BREAK_CONDITION);
+    BOOST_CHECK_EQUAL(event.type, CM_BREAK_EVENT_WATCHPOINT);
+    check_stop(0x80000010, 4, 0);
+    // The watched page is still in the TLB, as it would be after run()
+    error_code = cm_machine_run_until(_machine, 1000, &conditions, &reason, &event, nullptr);
+    BOOST_REQUIRE_EQUAL(error_code, CM_ERROR_OK);
+    BOOST_CHECK_EQUAL(reason, CM_BREAK_REASON_REACHED_TARGET_MCYCLE);
+    BOOST_CHECK_EQUAL(event.type, CM_BREAK_EVENT_NONE);
+    cm_hash until_hash;
+    BOOST_REQUIRE_EQUAL(cm_get_root_hash(_machine, &until_hash, nullptr), CM_ERROR_OK);
+
+    cm_machine *run_machine{};
+    BOOST_REQUIRE_EQUAL(cm_create_machine(&_machine_config, &_runtime_config, &run_machine, nullptr), CM_ERROR_OK);
+    load_program(run_machine);
+    BOOST_REQUIRE_EQUAL(cm_machine_run(run_machine, 1000, &reason, nullptr), CM_ERROR_OK);
+    cm_hash run_hash;
+    BOOST_REQUIRE_EQUAL(cm_get_root_hash(run_machine, &run_hash, nullptr), CM_ERROR_OK);
+    BOOST_CHECK_EQUAL_COLLECTIONS(until_hash, until_hash + sizeof(cm_hash), run_hash, run_hash + sizeof(cm_hash));
+    cm_delete_machine(run_machine);
+}
+
+BOOST_FIXTURE_TEST_CASE_NOLINT(machine_run_until_watchpoint_test, run_until_machine_fixture) {
+    // Loads from the range are not watched, so the store does not stop the run
+    cm_watchpoint watchpoint{0x80000104, 4, false, true, false};
+    cm_break_conditions conditions{};
+    conditions.watchpoints = {&watchpoint, 1};
+    CM_BREAK_REASON reason{};
+    cm_break_event event{};
+    int error_code = cm_machine_run_until(_machine, 5, &conditions, &reason, &event, nullptr);
+    BOOST_REQUIRE_EQUAL(error_code, CM_ERROR_OK);
+    BOOST_CHECK_EQUAL(reason, CM_BREAK_REASON_REACHED_TARGET_MCYCLE);
+    BOOST_CHECK_EQUAL(event.type, CM_BREAK_EVENT_NONE);
+
+    // Execute the store again, now watching stores
+    BOOST_REQUIRE_EQUAL(cm_write_pc(_machine, 0x8000000c, nullptr), CM_ERROR_OK);
+    watchpoint.write = true;
+    error_code = cm_machine_run_until(_machine, 1000, &conditions, &reason, &event, nullptr);
+    BOOST_REQUIRE_EQUAL(error_code, CM_ERROR_OK);
+    BOOST_CHECK_EQUAL(reason, CM_BREAK_REASON_REACHED_BREAK_CONDITION);
+    BOOST_CHECK_EQUAL(event.type, CM_BREAK_EVENT_WATCHPOINT);
+    BOOST_CHECK_EQUAL(event.index, 0);
+    BOOST_CHECK_EQUAL(event.address, 0x80000100);
+    // Stopped after executing the store
+    check_stop(0x80000010, 6, 1);
+    uint64_t stored{};
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+    error_code = cm_read_memory(_machine, 0x80000100, reinterpret_cast<unsigned char *>(&stored), sizeof(stored),
+        nullptr);
+    BOOST_REQUIRE_EQUAL(error_code, CM_ERROR_OK);
+    BOOST_CHECK_EQUAL(stored, 127);
+
+    // Empty watchpoints are rejected
+    watchpoint.length = 0;
+    char *err_msg{};
+    error_code = cm_machine_run_until(_machine, 1000, &conditions, &reason, &event, &err_msg);
+    BOOST_CHECK_EQUAL(error_code, CM_ERROR_INVALID_ARGUMENT);
+    BOOST_CHECK_EQUAL(reason, CM_BREAK_REASON_FAILED);
+    cm_delete_cstring(err_msg);
+}
+
+BOOST_FIXTURE_TEST_CASE_NOLINT(machine_run_until_csr_predicate_test, run_until_machine_fixture) {
+    cm_csr_predicate predicates[] = {
+        {CM_PROC_MCYCLE, UINT64_C(-1), 500, CM_CSR_COMPARISON_EQUAL},
+        {CM_PROC_PC, UINT64_C(-1), 0x80000014, CM_CSR_COMPARISON_EQUAL},
+    };
+    cm_break_conditions conditions{};
+    conditions.csr_predicates = {predicates, std::size(predicates)};
+    CM_BREAK_REASON reason{};
+    cm_break_event event{};
+    int error_code = cm_machine_run_until(_machine, 1000, &conditions, &reason, &event, nullptr);
+    BOOST_REQUIRE_EQUAL(error_code, CM_ERROR_OK);
+    BOOST_CHECK_EQUAL(reason, CM_BREAK_REASON_REACHED_BREAK_CONDITION);
+    BOOST_CHECK_EQUAL(event.type, CM_BREAK_EVENT_CSR_PREDICATE);
+    BOOST_CHECK_EQUAL(event.index, 1);
+    // Stopped right after the instruction that made the predicate hold
+    check_stop(0x80000014, 5, 1);
+
+    predicates[1].comparison = CM_CSR_COMPARISON_NOT_EQUAL;
+    predicates[1].mask = 0;
+    predicates[1].value = 0;
+    error_code = cm_machine_run_until(_machine, 1000, &conditions, &reason, &event, nullptr);
+    BOOST_REQUIRE_EQUAL(error_code, CM_ERROR_OK);
+    BOOST_CHECK_EQUAL(reason, CM_BREAK_REASON_REACHED_BREAK_CONDITION);
+    BOOST_CHECK_EQUAL(event.index, 0);
+    uint64_t mcycle{};
+    BOOST_REQUIRE_EQUAL(cm_read_mcycle(_machine, &mcycle, nullptr), CM_ERROR_OK);
+    BOOST_CHECK_EQUAL(mcycle, 500);
+}
+
+BOOST_FIXTURE_TEST_CASE_NOLINT(machine_serve_gdb_null_address_test, ordinary_machine_fixture) {
+    char *err_msg{};
+    int error_code = cm_machine_serve_gdb(_machine, nullptr, 1000, &err_msg);
+    BOOST_CHECK_EQUAL(error_code, CM_ERROR_INVALID_ARGUMENT);
+    std::string result = err_msg;
+    std::string origin("invalid address");
+    BOOST_CHECK_EQUAL(origin, result);
+    cm_delete_cstring(err_msg);
+}
+
+// Minimal GDB client talking to the stub over a Unix socket
+class gdb_client {
+public:
+    explicit gdb_client(const std::string &path) : _socket(_io) {
+        // The stub listens from another thread, so retry until it is ready
+        for (int i = 0;; ++i) {
+            boost::system::error_code ec;
+            _socket.connect(boost::asio::local::stream_protocol::endpoint(path), ec);
+            if (!ec) {
+                break;
+            }
+            BOOST_REQUIRE(i < 500);
+            _socket.close();
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+    }
+
+    static std::string frame(const std::string &data) {
+        unsigned sum = 0;
+        for (const char c : data) {
+            sum += static_cast<unsigned char>(c);
+        }
+        std::array<char, 3> checksum{};
+        (void) snprintf(checksum.data(), checksum.size(), "%02x", sum & 0xff);
+        return "$" + data + "#" + checksum.data();
+    }
+
+    void send(const std::string &data) {
+        write(frame(data));
+    }
+
+    void write(const std::string &bytes) {
+        boost::asio::write(_socket, boost::asio::buffer(bytes));
+    }
+
+    char read_byte() {
+        char c = 0;
+        boost::asio::read(_socket, boost::asio::buffer(&c, 1));
+        return c;
+    }
+
+    std::string request(const std::string &data) {
+        send(data);
+        return reply();
+    }
+
+    void interrupt() {
+        boost::asio::write(_socket, boost::asio::buffer("\x03", 1));
+    }
+
+    std::string reply(bool ack = true) {
+        char c = 0;
+        do {
+            boost::asio::read(_socket, boost::asio::buffer(&c, 1));
+        } while (c != '$');
+        std::string data;
+        for (boost::asio::read(_socket, boost::asio::buffer(&c, 1)); c != '#';
+             boost::asio::read(_socket, boost::asio::buffer(&c, 1))) {
+            data.push_back(c);
+        }
+        std::array<char, 2> checksum{};
+        boost::asio::read(_socket, boost::asio::buffer(checksum));
+        if (ack) {
+            // The stub closes the connection right after replying to a detach, without waiting for the ack
+            boost::system::error_code ec;
+            boost::asio::write(_socket, boost::asio::buffer("+", 1), ec);
+        }
+        return data;
+    }
+
+private:
+    boost::asio::io_context _io;
+    boost::asio::local::stream_protocol::socket _socket;
+};
+
+BOOST_FIXTURE_TEST_CASE_NOLINT(machine_serve_gdb_test, run_until_machine_fixture) {
+    const std::string path = (std::filesystem::temp_directory_path() / "test-machine-c-api-gdb.sock").string();
+    std::filesystem::remove(path);
+    int serve_error_code = -1;
+    const std::string address = "unix:" + path;
+    std::thread server([&]() { serve_error_code = cm_machine_serve_gdb(_machine, address.c_str(), 1000, nullptr); });
+    {
+        gdb_client gdb(path);
+        BOOST_CHECK(gdb.request("qSupported:hwbreak+").find("QStartNoAckMode+") != std::string::npos);
+        BOOST_CHECK_EQUAL(gdb.request("m80000000,4"), "9300f007");
+        BOOST_CHECK_EQUAL(gdb.request("Z0,80000010,4"), "OK");
+        BOOST_CHECK_EQUAL(gdb.request("c"), "S05");
+        // Registers are x0 to x31 followed by pc, in target byte order
+        const std::string regs = gdb.request("g");
+        BOOST_REQUIRE_EQUAL(regs.size(), 33 * 16);
+        BOOST_CHECK_EQUAL(regs.substr(1 * 16, 16), "7f00000000000000");
+        BOOST_CHECK_EQUAL(regs.substr(32 * 16, 16), "1000008000000000");
+        BOOST_CHECK_EQUAL(gdb.request("s"), "S05");
+        BOOST_CHECK_EQUAL(gdb.request("p20"), "1400008000000000");
+        BOOST_CHECK_EQUAL(gdb.request("qRcmd,6379636c6573"), "O350a"); // monitor cycles
+        BOOST_CHECK_EQUAL(gdb.reply(), "OK");
+        BOOST_CHECK_EQUAL(gdb.request("c"), "S05");
+        BOOST_CHECK_EQUAL(gdb.request("z0,80000010,4"), "OK");
+        BOOST_CHECK_EQUAL(gdb.request("c"), "S03");
+        BOOST_CHECK_EQUAL(gdb.request("D"), "OK");
+    }
+    server.join();
+    BOOST_CHECK_EQUAL(serve_error_code, CM_ERROR_OK);
+    uint64_t mcycle{};
+    BOOST_REQUIRE_EQUAL(cm_read_mcycle(_machine, &mcycle, nullptr), CM_ERROR_OK);
+    BOOST_CHECK_EQUAL(mcycle, 1000);
+    BOOST_CHECK(!std::filesystem::exists(path));
+}
+
+BOOST_FIXTURE_TEST_CASE_NOLINT(machine_serve_gdb_packet_test, run_until_machine_fixture) {
+    const std::string path = (std::filesystem::temp_directory_path() / "test-machine-c-api-gdb.sock").string();
+    std::filesystem::remove(path);
+    int serve_error_code = -1;
+    const std::string address = "unix:" + path;
+    std::thread server([&]() { serve_error_code = cm_machine_serve_gdb(_machine, address.c_str(), 1000, nullptr); });
+    {
+        gdb_client gdb(path);
+        // A packet arriving in pieces is handled once it is complete
+        const std::string packet = gdb_client::frame("m80000000,4");
+        gdb.write(packet.substr(0, 5));
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        gdb.write(packet.substr(5));
+        BOOST_CHECK_EQUAL(gdb.reply(), "9300f007");
+        // The stub retransmits its last packet until acknowledged
+        gdb.send("m80000000,4");
+        BOOST_CHECK_EQUAL(gdb.reply(false), "9300f007");
+        gdb.write("-");
+        BOOST_CHECK_EQUAL(gdb.reply(), "9300f007");
+        // A packet larger than the advertised packet size is rejected, and the next one is served
+        const std::string supported = gdb.request("qSupported");
+        BOOST_REQUIRE(supported.find("PacketSize=4000;") != std::string::npos);
+        gdb.send("m" + std::string(0x4000, '0'));
+        BOOST_CHECK_EQUAL(gdb.read_byte(), '-');
+        BOOST_CHECK_EQUAL(gdb.request("m80000000,4"), "9300f007");
+        // A packet with a bad checksum is rejected as well
+        gdb.write("$m80000000,4#00");
+        BOOST_CHECK_EQUAL(gdb.read_byte(), '-');
+        BOOST_CHECK_EQUAL(gdb.request("D"), "OK");
+    }
+    server.join();
+    BOOST_CHECK_EQUAL(serve_error_code, CM_ERROR_OK);
+}
+
+BOOST_FIXTURE_TEST_CASE_NOLINT(machine_serve_gdb_interrupt_test, run_until_machine_fixture) {
+    const std::string path = (std::filesystem::temp_directory_path() / "test-machine-c-api-gdb.sock").string();
+    std::filesystem::remove(path);
+    int serve_error_code = -1;
+    const std::string address = "unix:" + path;
+    std::thread server(
+        [&]() { serve_error_code = cm_machine_serve_gdb(_machine, address.c_str(), UINT64_MAX, nullptr); });
+    {
+        gdb_client gdb(path);
+        // The program loops forever, so the machine runs in slices until GDB interrupts it
+        gdb.send("c");
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        gdb.interrupt();
+        BOOST_CHECK_EQUAL(gdb.reply(), "S02");
+        const std::string regs = gdb.request("g");
+        BOOST_REQUIRE_EQUAL(regs.size(), 33 * 16);
+        BOOST_CHECK_NE(regs.substr(3 * 16, 16), "0000000000000000");
+        BOOST_CHECK_EQUAL(gdb.request("D"), "OK");
+    }
+    server.join();
+    BOOST_CHECK_EQUAL(serve_error_code, CM_ERROR_OK);
+}
+
+BOOST_FIXTURE_TEST_CASE_NOLINT(machine_write_profile_not_started_test, ordinary_machine_fixture) {
+    char *err_msg{};
+    const std::string path = (std::filesystem::temp_directory_path() / "test-machine-c-api.profile").string();
+    int error_code = cm_machine_write_profile(_machine, path.c_str(), CM_PROFILE_FORMAT_COLLAPSED, nullptr, &err_msg);
+    BOOST_CHECK_EQUAL(error_code, CM_ERROR_RUNTIME_ERROR);
+    std::string result = err_msg;
+    std::string origin("profiler is not started");
+    BOOST_CHECK_EQUAL(origin, result);
+    cm_delete_cstring(err_msg);
+}
+
+BOOST_FIXTURE_TEST_CASE_NOLINT(machine_start_profiler_zero_interval_test, ordinary_machine_fixture) {
+    char *err_msg{};
+    int error_code = cm_machine_start_profiler(_machine, 0, &err_msg);
+    BOOST_CHECK_EQUAL(error_code, CM_ERROR_INVALID_ARGUMENT);
+    std::string result = err_msg;
+    std::string origin("profiler sample interval must be positive");
+    BOOST_CHECK_EQUAL(origin, result);
+    cm_delete_cstring(err_msg);
+}
+
+BOOST_FIXTURE_TEST_CASE_NOLINT(machine_profiler_test, run_until_machine_fixture) {
+    const std::string path = (std::filesystem::temp_directory_path() / "test-machine-c-api.profile").string();
+    const auto read_profile = [&path]() {
+        std::ifstream ifs(path);
+        return std::string{std::istreambuf_iterator<char>(ifs), std::istreambuf_iterator<char>()};
+    };
+    BOOST_REQUIRE_EQUAL(cm_machine_start_profiler(_machine, 10, nullptr), CM_ERROR_OK);
+    CM_BREAK_REASON reason{};
+    BOOST_REQUIRE_EQUAL(cm_machine_run(_machine, 1000, &reason, nullptr), CM_ERROR_OK);
+    BOOST_CHECK_EQUAL(reason, CM_BREAK_REASON_REACHED_TARGET_MCYCLE);
+    check_stop(0x80000010, 1000, 498);
+    // Samples are taken at cycles 0, 10, ..., 990, and the loop is at 0x80000010 in every even cycle past 4
+    BOOST_REQUIRE_EQUAL(
+        cm_machine_write_profile(_machine, path.c_str(), CM_PROFILE_FORMAT_COLLAPSED, nullptr, nullptr), CM_ERROR_OK);
+    BOOST_CHECK_EQUAL(read_profile(), "0x80000000 1\n0x80000010 99\n");
+    BOOST_REQUIRE_EQUAL(
+        cm_machine_write_profile(_machine, path.c_str(), CM_PROFILE_FORMAT_SUMMARY, nullptr, nullptr), CM_ERROR_OK);
+    const std::string summary = read_profile();
+    BOOST_CHECK(summary.find("instructions: 1000\n") != std::string::npos);
+    BOOST_CHECK(summary.find("           500   50.00%  addi\n") != std::string::npos);
+    BOOST_CHECK(summary.find("           498   49.80%  jal\n") != std::string::npos);
+    BOOST_CHECK(summary.find("traps: 0\n") != std::string::npos);
+    BOOST_REQUIRE_EQUAL(
+        cm_machine_write_profile(_machine, path.c_str(), CM_PROFILE_FORMAT_PPROF, nullptr, nullptr), CM_ERROR_OK);
+    BOOST_CHECK(!read_profile().empty());
+    BOOST_REQUIRE_EQUAL(cm_machine_stop_profiler(_machine, nullptr), CM_ERROR_OK);
+    BOOST_CHECK_EQUAL(
+        cm_machine_write_profile(_machine, path.c_str(), CM_PROFILE_FORMAT_COLLAPSED, nullptr, nullptr),
+        CM_ERROR_RUNTIME_ERROR);
+    std::filesystem::remove(path);
+}
+
 BOOST_AUTO_TEST_CASE_NOLINT(machine_run_uarch_null_machine_test) {
     auto status{CM_UARCH_BREAK_REASON_REACHED_TARGET_CYCLE};
     int error_code = cm_machine_run_uarch(nullptr, 1000, &status, nullptr);
@@ -2395,6 +3704,63 @@ BOOST_FIXTURE_TEST_CASE_NOLINT(machine_reset_uarch, ordinary_machine_fixture) {
 
     // confirm ram was restored to initial state
     BOOST_REQUIRE(initial_uarch_ram == reset_uarch_ram);
+
+    // confirm the pristine uarch subtree swapped into the Merkle tree matches a full recomputation
+    cm_hash reset_hash;
+    error_code = cm_get_root_hash(_machine, &reset_hash, &err_msg);
+    BOOST_REQUIRE_EQUAL(error_code, CM_ERROR_OK);
+    BOOST_REQUIRE_EQUAL(err_msg, nullptr);
+    auto verification = calculate_emulator_hash(_machine);
+    BOOST_CHECK_EQUAL_COLLECTIONS(verification.begin(), verification.end(), reset_hash, reset_hash + sizeof(cm_hash));
+    bool ret{};
+    error_code = cm_verify_merkle_tree(_machine, &ret, &err_msg);
+    BOOST_REQUIRE_EQUAL(error_code, CM_ERROR_OK);
+    BOOST_REQUIRE_EQUAL(err_msg, nullptr);
+    BOOST_CHECK(ret);
+}
+
+BOOST_FIXTURE_TEST_CASE_NOLINT(machine_log_uarch_reset_test, ordinary_machine_fixture) {
+    std::vector<unsigned char> initial_uarch_ram(cartesi::UARCH_RAM_LENGTH);
+    BOOST_REQUIRE_EQUAL(cm_read_memory(_machine, cartesi::UARCH_RAM_START_ADDRESS, initial_uarch_ram.data(),
+                            initial_uarch_ram.size(), nullptr),
+        CM_ERROR_OK);
+    const cm_access_log_type log_type{true, false, false};
+    const auto log_reset_and_check = [&]() {
+        cm_access_log *access_log{};
+        BOOST_REQUIRE_EQUAL(cm_log_uarch_reset(_machine, log_type, false, &access_log, nullptr), CM_ERROR_OK);
+        cm_delete_access_log(access_log);
+        std::vector<unsigned char> uarch_ram(cartesi::UARCH_RAM_LENGTH);
+        BOOST_REQUIRE_EQUAL(cm_read_memory(_machine, cartesi::UARCH_RAM_START_ADDRESS, uarch_ram.data(),
+                                uarch_ram.size(), nullptr),
+            CM_ERROR_OK);
+        BOOST_CHECK(uarch_ram == initial_uarch_ram);
+        cm_hash hash{};
+        BOOST_REQUIRE_EQUAL(cm_get_root_hash(_machine, &hash, nullptr), CM_ERROR_OK);
+        auto verification = calculate_emulator_hash(_machine);
+        BOOST_CHECK_EQUAL_COLLECTIONS(verification.begin(), verification.end(), hash, hash + sizeof(cm_hash));
+    };
+
+    // uarch RAM modified by running the uarch must be refilled
+    auto status{CM_UARCH_BREAK_REASON_UARCH_HALTED};
+    BOOST_REQUIRE_EQUAL(cm_machine_run_uarch(_machine, -1, &status, nullptr), CM_ERROR_OK);
+    log_reset_and_check();
+
+    // uarch RAM that is already pristine is kept
+    log_reset_and_check();
+
+    // uarch RAM modified after the Merkle tree was last updated must also be refilled
+    const std::array<uint8_t, 8> bytes{1, 2, 3, 4, 5, 6, 7, 8};
+    BOOST_REQUIRE_EQUAL(cm_write_memory(_machine, cartesi::UARCH_RAM_START_ADDRESS + cartesi::PMA_PAGE_SIZE,
+                            bytes.data(), bytes.size(), nullptr),
+        CM_ERROR_OK);
+    log_reset_and_check();
+
+    // Same for uarch RAM modified and then hashed into the Merkle tree
+    BOOST_REQUIRE_EQUAL(cm_write_memory(_machine, cartesi::UARCH_RAM_START_ADDRESS, bytes.data(), bytes.size(), nullptr),
+        CM_ERROR_OK);
+    cm_hash hash{};
+    BOOST_REQUIRE_EQUAL(cm_get_root_hash(_machine, &hash, nullptr), CM_ERROR_OK);
+    log_reset_and_check();
 }
 
 BOOST_FIXTURE_TEST_CASE_NOLINT(machine_verify_merkle_tree_root_updates_test, ordinary_machine_fixture) {
@@ -2451,6 +3817,1037 @@ BOOST_FIXTURE_TEST_CASE_NOLINT(machine_verify_merkle_tree_proof_updates_test, or
     cm_delete_merkle_tree_proof(end_proof);
 }
 
+BOOST_AUTO_TEST_CASE_NOLINT(os_shared_memory_test) {
+    using namespace cartesi;
+    const std::string name = "/cartesi-test-shm-" + std::to_string(getpid());
+    const uint64_t length = 2 * 4096;
+    os_unlink_shared_memory(name.c_str());
+
+    // The server creates the segment and the client attaches to it by name
+    unsigned char *server = os_map_shared_memory(name.c_str(), length, true);
+    unsigned char *client = os_map_shared_memory(name.c_str(), length, false);
+    BOOST_REQUIRE(server != client);
+    for (uint64_t i = 0; i < length; ++i) {
+        server[i] = static_cast<unsigned char>(i * 7 + 1);
+    }
+    BOOST_CHECK(std::equal(server, server + length, client));
+    client[length - 1] = 0xaa;
+    BOOST_CHECK_EQUAL(server[length - 1], 0xaa);
+
+    // Creating a segment under a name that is taken must fail with EEXIST, so the caller can pick another
+    try {
+        os_map_shared_memory(name.c_str(), length, true);
+        BOOST_FAIL("creating a taken shared memory name should fail");
+    } catch (const std::system_error &e) {
+        BOOST_CHECK_EQUAL(e.code().value(), EEXIST);
+    }
+    // The failed creation must not have unlinked or truncated the existing segment
+    BOOST_CHECK_EQUAL(server[0], 1);
+    BOOST_CHECK_THROW(os_map_shared_memory(name.c_str(), length + 4096, false), std::invalid_argument);
+
+    // Once both sides have it mapped, the name is removed, so nothing is left behind if either side crashes
+    os_unlink_shared_memory(name.c_str());
+#ifdef __linux__
+    BOOST_CHECK(!std::filesystem::exists("/dev/shm" + name));
+#endif
+    try {
+        os_map_shared_memory(name.c_str(), length, false);
+        BOOST_FAIL("attaching to an unlinked shared memory name should fail");
+    } catch (const std::system_error &e) {
+        BOOST_CHECK_EQUAL(e.code().value(), ENOENT);
+    }
+    server[0] = 0x55;
+    BOOST_CHECK_EQUAL(client[0], 0x55);
+    os_unmap_file(client, length);
+    os_unmap_file(server, length);
+}
+
+namespace {
+
+/// \brief Device state accessor over a flat buffer of guest memory, used to drive devices without a machine
+class flat_device_state_access final : public cartesi::i_device_state_access {
+public:
+    explicit flat_device_state_access(uint64_t length) : _memory(length, 0) {}
+
+    template <typename T>
+    T peek(uint64_t paddr) const {
+        T val{};
+        memcpy(&val, _memory.data() + paddr, sizeof(T));
+        return val;
+    }
+
+    template <typename T>
+    void poke(uint64_t paddr, const T &val) {
+        memcpy(_memory.data() + paddr, &val, sizeof(T));
+    }
+
+private:
+    std::vector<unsigned char> _memory;
+    uint64_t _mip{};
+    uint64_t _girqpend{};
+    uint64_t _girqsrvd{};
+
+    void do_set_mip(uint64_t mask) override {
+        _mip |= mask;
+    }
+    void do_reset_mip(uint64_t mask) override {
+        _mip &= ~mask;
+    }
+    uint64_t do_read_mip() override {
+        return _mip;
+    }
+    uint64_t do_read_mcycle() override {
+        return 0;
+    }
+    void do_set_iflags_H() override {}
+    void do_set_iflags_Y() override {}
+    void do_set_iflags_X() override {}
+    uint64_t do_read_clint_mtimecmp() override {
+        return 0;
+    }
+    void do_write_clint_mtimecmp(uint64_t /*val*/) override {}
+    uint64_t do_read_plic_girqpend() override {
+        return _girqpend;
+    }
+    void do_write_plic_girqpend(uint64_t val) override {
+        _girqpend = val;
+    }
+    uint64_t do_read_plic_girqsrvd() override {
+        return _girqsrvd;
+    }
+    void do_write_plic_girqsrvd(uint64_t val) override {
+        _girqsrvd = val;
+    }
+    uint64_t do_read_htif_fromhost() override {
+        return 0;
+    }
+    void do_write_htif_fromhost(uint64_t /*val*/) override {}
+    uint64_t do_read_htif_tohost() override {
+        return 0;
+    }
+    void do_write_htif_tohost(uint64_t /*val*/) override {}
+    uint64_t do_read_htif_ihalt() override {
+        return 0;
+    }
+    uint64_t do_read_htif_iconsole() override {
+        return 0;
+    }
+    uint64_t do_read_htif_iyield() override {
+        return 0;
+    }
+    bool do_read_memory(uint64_t paddr, unsigned char *data, uint64_t length) override {
+        if (paddr > _memory.size() || length > _memory.size() - paddr) {
+            return false;
+        }
+        memcpy(data, _memory.data() + paddr, length);
+        return true;
+    }
+    bool do_write_memory(uint64_t paddr, const unsigned char *data, uint64_t length) override {
+        if (paddr > _memory.size() || length > _memory.size() - paddr) {
+            return false;
+        }
+        memcpy(_memory.data() + paddr, data, length);
+        return true;
+    }
+    unsigned char *do_get_host_memory(uint64_t paddr, uint64_t length, bool /*write*/) override {
+        if (paddr > _memory.size() || length > _memory.size() - paddr) {
+            return nullptr;
+        }
+        return _memory.data() + paddr;
+    }
+    uint64_t do_read_pma_istart(int /*p*/) override {
+        return 0;
+    }
+    uint64_t do_read_pma_ilength(int /*p*/) override {
+        return 0;
+    }
+};
+
+/// \brief Guest memory layout of the virtqueues used by the virtio tests
+enum test_virtq_layout : uint64_t {
+    TEST_VIRTQ_NUM = 16,
+    TEST_VIRTQ_DESC_ADDR = 0x000,
+    TEST_VIRTQ_AVAIL_ADDR = 0x100,
+    TEST_VIRTQ_USED_ADDR = 0x200,
+    TEST_VIRTQ_STRIDE = 0x300, ///< Distance between the rings of consecutive queues
+    TEST_VIRTQ_USED_EVENT_ADDR = TEST_VIRTQ_AVAIL_ADDR + sizeof(cartesi::virtq_header) + TEST_VIRTQ_NUM * 2,
+    TEST_VIRTQ_AVAIL_EVENT_ADDR =
+        TEST_VIRTQ_USED_ADDR + sizeof(cartesi::virtq_header) + TEST_VIRTQ_NUM * sizeof(cartesi::virtq_used_elem),
+};
+
+/// \brief Minimal device with one queue, with the driver already set up and VIRTIO_F_EVENT_IDX negotiated
+class event_idx_test_device final : public cartesi::virtio_device {
+public:
+    explicit event_idx_test_device(uint16_t used_idx) : virtio_device(0, cartesi::VIRTIO_DEVICE_CONSOLE, 0, 0, 1) {
+        driver_features = device_features;
+        driver_ok = true;
+        auto &vq = queue[0];
+        vq.desc_addr = TEST_VIRTQ_DESC_ADDR;
+        vq.avail_addr = TEST_VIRTQ_AVAIL_ADDR;
+        vq.used_addr = TEST_VIRTQ_USED_ADDR;
+        vq.num = TEST_VIRTQ_NUM;
+        vq.ready = 1;
+        vq.last_used_idx = used_idx;
+        vq.signalled_used_idx = used_idx;
+    }
+
+    cartesi::virtq &get_queue() {
+        return queue[0];
+    }
+
+    /// \brief Returns whether a used buffer interrupt is pending, acknowledging it like the driver would
+    bool ack_used_buffer_irq(cartesi::i_device_state_access *a) {
+        const bool raised = (int_status & cartesi::VIRTIO_INT_STATUS_USED_BUFFER) != 0;
+        reset_irq(a, cartesi::VIRTIO_INT_STATUS_USED_BUFFER);
+        return raised;
+    }
+
+    void on_device_reset() override {}
+    void on_device_ok(cartesi::i_device_state_access * /*a*/) override {}
+    bool on_device_queue_available(cartesi::i_device_state_access * /*a*/, uint32_t /*queue_idx*/,
+        uint16_t /*desc_idx*/, uint32_t /*read_avail_len*/, uint32_t /*write_avail_len*/) override {
+        return false;
+    }
+};
+
+/// \brief Returns whether used ring index used_event + 1 is in (old_idx, new_idx], walking the ring one entry at a time
+bool crosses_used_event(uint16_t used_event, uint16_t old_idx, uint16_t new_idx) {
+    for (uint16_t idx = old_idx; idx != new_idx;) {
+        ++idx;
+        if (idx == static_cast<uint16_t>(used_event + 1)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_CASE_NOLINT(virtio_event_idx_wrap_test) {
+    flat_device_state_access a(0x1000);
+    event_idx_test_device device(0xfff0);
+    auto &vq = device.get_queue();
+    uint16_t used_event = 0xfff3;
+    a.poke<uint16_t>(TEST_VIRTQ_USED_EVENT_ADDR, used_event);
+    // Use buffers one at a time across the 0xffff -> 0 wrap, with the driver always asking to be interrupted again
+    // three buffers after the one it was last interrupted for
+    int interrupts = 0;
+    for (int i = 0; i < 64; ++i) {
+        const uint16_t old_idx = vq.last_used_idx;
+        BOOST_REQUIRE(device.consume_and_notify_queue(&a, 0, 0));
+        BOOST_CHECK_EQUAL(a.peek<uint16_t>(TEST_VIRTQ_USED_ADDR + offsetof(cartesi::virtq_header, idx)),
+            vq.last_used_idx);
+        BOOST_CHECK_EQUAL(a.peek<uint16_t>(TEST_VIRTQ_AVAIL_EVENT_ADDR), vq.last_used_idx);
+        const bool expected = crosses_used_event(used_event, old_idx, vq.last_used_idx);
+        BOOST_CHECK_MESSAGE(device.ack_used_buffer_irq(&a) == expected,
+            "used_idx " << old_idx << " -> " << vq.last_used_idx << " with used_event " << used_event);
+        if (expected) {
+            ++interrupts;
+            used_event = static_cast<uint16_t>(vq.last_used_idx + 2);
+            a.poke<uint16_t>(TEST_VIRTQ_USED_EVENT_ADDR, used_event);
+        }
+    }
+    BOOST_CHECK_EQUAL(vq.last_used_idx, 0x0030);
+    BOOST_CHECK_EQUAL(interrupts, 21);
+
+    // Use buffers in batches that straddle the wrap, with used_event just behind, inside, and just past each batch
+    for (const uint16_t start : {0xfffc, 0xfffd, 0xfffe, 0xffff}) {
+        for (int event_delta = -2; event_delta <= 6; ++event_delta) {
+            event_idx_test_device batch_device(start);
+            auto &batch_vq = batch_device.get_queue();
+            used_event = static_cast<uint16_t>(start + event_delta);
+            a.poke<uint16_t>(TEST_VIRTQ_USED_EVENT_ADDR, used_event);
+            for (int i = 0; i < 4; ++i) {
+                BOOST_REQUIRE(batch_vq.consume_desc(&a, 0, 0, 0));
+            }
+            batch_device.notify_queue_used(&a, 0);
+            const bool expected = crosses_used_event(used_event, start, batch_vq.last_used_idx);
+            BOOST_CHECK_MESSAGE(batch_device.ack_used_buffer_irq(&a) == expected,
+                "used_idx " << start << " -> " << batch_vq.last_used_idx << " with used_event " << used_event);
+            // Nothing new was used, so notifying again must not interrupt the driver a second time
+            batch_device.notify_queue_used(&a, 0);
+            BOOST_CHECK(!batch_device.ack_used_buffer_irq(&a));
+        }
+    }
+}
+
+#ifdef HAVE_POSIX_FS
+
+namespace {
+
+/// \brief Guest memory layout of the request and reply buffers used by the virtio tests
+enum test_virtq_buffers : uint64_t {
+    TEST_VIRTQ_REQUEST_ADDR = 0x1000,
+    TEST_VIRTQ_REQUEST_LENGTH = 0xf000,
+    TEST_VIRTQ_REPLY_ADDR = 0x10000,
+    TEST_VIRTQ_REPLY_LENGTH = 0x10000,
+    TEST_VIRTQ_MEMORY_LENGTH = TEST_VIRTQ_REPLY_ADDR + TEST_VIRTQ_REPLY_LENGTH,
+};
+
+/// \brief Guest buffer in a descriptor chain
+struct test_virtq_buffer {
+    uint64_t addr;
+    uint32_t len;
+    bool write;
+};
+
+/// \brief Drives a device through its MMIO registers like a guest driver
+class test_virtio_driver {
+public:
+    explicit test_virtio_driver(cartesi::virtio_device &device, uint32_t queue_count = 1) :
+        _device(device),
+        _a(TEST_VIRTQ_MEMORY_LENGTH) {
+        using namespace cartesi;
+        BOOST_REQUIRE(queue_count * TEST_VIRTQ_STRIDE <= TEST_VIRTQ_REQUEST_ADDR);
+        for (uint32_t sel = 0; sel < 2; ++sel) {
+            uint32_t features = 0;
+            _write_reg(VIRTIO_MMIO_DEVICE_FEATURES_SEL, sel);
+            BOOST_REQUIRE(_device.mmio_read(&_a, VIRTIO_MMIO_DEVICE_FEATURES, &features, 2));
+            _write_reg(VIRTIO_MMIO_DRIVER_FEATURES_SEL, sel);
+            _write_reg(VIRTIO_MMIO_DRIVER_FEATURES, features);
+        }
+        _write_reg(VIRTIO_MMIO_STATUS, VIRTIO_STATUS_ACKNOWLEDGE | VIRTIO_STATUS_DRIVER);
+        for (uint32_t queue_idx = 0; queue_idx < queue_count; ++queue_idx) {
+            _write_reg(VIRTIO_MMIO_QUEUE_SEL, queue_idx);
+            _write_reg(VIRTIO_MMIO_QUEUE_NUM, TEST_VIRTQ_NUM);
+            _write_reg(VIRTIO_MMIO_QUEUE_DESC_LOW, _ring(TEST_VIRTQ_DESC_ADDR, queue_idx));
+            _write_reg(VIRTIO_MMIO_QUEUE_AVAIL_LOW, _ring(TEST_VIRTQ_AVAIL_ADDR, queue_idx));
+            _write_reg(VIRTIO_MMIO_QUEUE_USED_LOW, _ring(TEST_VIRTQ_USED_ADDR, queue_idx));
+            _write_reg(VIRTIO_MMIO_QUEUE_READY, 1);
+        }
+        _write_reg(VIRTIO_MMIO_STATUS,
+            VIRTIO_STATUS_ACKNOWLEDGE | VIRTIO_STATUS_DRIVER | VIRTIO_STATUS_FEATURES_OK | VIRTIO_STATUS_DRIVER_OK);
+    }
+
+    /// \brief Makes a request available, waits for the device to use it, and returns the reply
+    std::vector<unsigned char> request(const std::vector<unsigned char> &req) {
+        BOOST_REQUIRE(req.size() <= TEST_VIRTQ_REQUEST_LENGTH);
+        for (size_t i = 0; i < req.size(); ++i) {
+            _a.poke<unsigned char>(TEST_VIRTQ_REQUEST_ADDR + i, req[i]);
+        }
+        const uint16_t avail_idx = make_available(0,
+            {{TEST_VIRTQ_REQUEST_ADDR, static_cast<uint32_t>(req.size()), false},
+                {TEST_VIRTQ_REPLY_ADDR, TEST_VIRTQ_REPLY_LENGTH, true}});
+        notify();
+        wait_used(avail_idx + 1);
+        const auto used = get_used(avail_idx);
+        std::vector<unsigned char> reply(used.len);
+        for (size_t i = 0; i < reply.size(); ++i) {
+            reply[i] = _a.peek<unsigned char>(TEST_VIRTQ_REPLY_ADDR + i);
+        }
+        return reply;
+    }
+
+    /// \brief Chains buffers in consecutive descriptors starting at head, and makes the chain available
+    /// \returns Index of the chain in the available ring
+    uint16_t make_available(uint16_t head, const std::vector<test_virtq_buffer> &bufs, uint32_t queue_idx = 0) {
+        using namespace cartesi;
+        BOOST_REQUIRE(!bufs.empty());
+        BOOST_REQUIRE(head + bufs.size() <= TEST_VIRTQ_NUM);
+        for (size_t i = 0; i < bufs.size(); ++i) {
+            uint16_t flags = 0;
+            if (bufs[i].write) {
+                flags |= VIRTQ_DESC_F_WRITE;
+            }
+            if (i + 1 < bufs.size()) {
+                flags |= VIRTQ_DESC_F_NEXT;
+            }
+            _a.poke(_ring(TEST_VIRTQ_DESC_ADDR, queue_idx) + (head + i) * sizeof(virtq_desc),
+                virtq_desc{bufs[i].addr, bufs[i].len, flags, static_cast<uint16_t>(head + i + 1)});
+        }
+        const uint64_t avail_addr = _ring(TEST_VIRTQ_AVAIL_ADDR, queue_idx);
+        const uint16_t avail_idx = _a.peek<uint16_t>(avail_addr + offsetof(virtq_header, idx));
+        _a.poke<uint16_t>(avail_addr + sizeof(virtq_header) + (avail_idx % TEST_VIRTQ_NUM) * 2, head);
+        _a.poke<uint16_t>(avail_addr + offsetof(virtq_header, idx), avail_idx + 1);
+        return avail_idx;
+    }
+
+    /// \brief Notifies the device that a queue has new available buffers
+    void notify(uint32_t queue_idx = 0) {
+        _write_reg(cartesi::VIRTIO_MMIO_QUEUE_NOTIFY, queue_idx);
+    }
+
+    /// \brief Polls the device until the index of the used ring of a queue reaches used_idx
+    void wait_used(uint16_t used_idx, uint32_t queue_idx = 0) {
+        // Requests serviced by host workers are only used once their completion is polled
+        const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+        while (get_used_idx(queue_idx) != used_idx) {
+            BOOST_REQUIRE_MESSAGE(std::chrono::steady_clock::now() < deadline, "device did not use the request");
+            if (!_device.poll_nowait(&_a)) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+        }
+    }
+
+    uint16_t get_used_idx(uint32_t queue_idx = 0) {
+        return _a.peek<uint16_t>(_ring(TEST_VIRTQ_USED_ADDR, queue_idx) + offsetof(cartesi::virtq_header, idx));
+    }
+
+    cartesi::virtq_used_elem get_used(uint16_t idx, uint32_t queue_idx = 0) {
+        return _a.peek<cartesi::virtq_used_elem>(_ring(TEST_VIRTQ_USED_ADDR, queue_idx) +
+            sizeof(cartesi::virtq_header) + (idx % TEST_VIRTQ_NUM) * sizeof(cartesi::virtq_used_elem));
+    }
+
+    flat_device_state_access &memory() {
+        return _a;
+    }
+
+private:
+    cartesi::virtio_device &_device;
+    flat_device_state_access _a;
+
+    void _write_reg(uint64_t offset, uint32_t val) {
+        BOOST_REQUIRE(_device.mmio_write(&_a, offset, val, 2) != cartesi::execute_status::failure);
+    }
+
+    static uint64_t _ring(uint64_t addr, uint32_t queue_idx) {
+        return addr + queue_idx * TEST_VIRTQ_STRIDE;
+    }
+};
+
+/// \brief Builds a 9P2000.L message
+class p9_test_message {
+public:
+    p9_test_message(uint8_t opcode, uint16_t tag) {
+        put<uint32_t>(0).put(opcode).put(tag);
+    }
+
+    template <typename T>
+    p9_test_message &put(T val) {
+        // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+        const auto *bytes = reinterpret_cast<const unsigned char *>(&val);
+        _bytes.insert(_bytes.end(), bytes, bytes + sizeof(T));
+        return *this;
+    }
+
+    p9_test_message &put_string(const std::string &str) {
+        put(static_cast<uint16_t>(str.size()));
+        _bytes.insert(_bytes.end(), str.begin(), str.end());
+        return *this;
+    }
+
+    std::vector<unsigned char> bytes() const {
+        auto bytes = _bytes;
+        const auto size = static_cast<uint32_t>(bytes.size());
+        memcpy(bytes.data(), &size, sizeof(size));
+        return bytes;
+    }
+
+private:
+    std::vector<unsigned char> _bytes;
+};
+
+template <typename T>
+T p9_test_reply_field(const std::vector<unsigned char> &reply, size_t offset) {
+    T val{};
+    BOOST_REQUIRE(offset + sizeof(T) <= reply.size());
+    memcpy(&val, reply.data() + offset, sizeof(T));
+    return val;
+}
+
+/// \brief Sends a request to the 9P device, checking the reply opcode and tag
+std::vector<unsigned char> p9_test_request(test_virtio_driver &driver, const p9_test_message &msg, uint8_t opcode) {
+    const auto req = msg.bytes();
+    auto reply = driver.request(req);
+    BOOST_REQUIRE(reply.size() >= cartesi::P9_OUT_MSG_OFFSET);
+    BOOST_CHECK_EQUAL(p9_test_reply_field<uint32_t>(reply, 0), reply.size());
+    BOOST_CHECK_EQUAL(static_cast<int>(p9_test_reply_field<uint8_t>(reply, 4)), static_cast<int>(opcode));
+    BOOST_CHECK_EQUAL(p9_test_reply_field<uint16_t>(reply, 5), p9_test_reply_field<uint16_t>(req, 5));
+    return reply;
+}
+
+/// \brief Gets the size of a file through Tgetattr
+uint64_t p9_test_getattr_size(test_virtio_driver &driver, uint32_t fid) {
+    using namespace cartesi;
+    const auto reply = p9_test_request(driver,
+        p9_test_message(P9_TGETATTR, 1).put<uint32_t>(fid).put<uint64_t>(P9_GETATTR_SIZE), P9_RGETATTR);
+    // The size follows the mask, qid, mode, uid, gid, nlink and rdev fields
+    return p9_test_reply_field<uint64_t>(reply, P9_OUT_MSG_OFFSET + sizeof(uint64_t) + sizeof(p9_qid) +
+            offsetof(p9_stat, size));
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_CASE_NOLINT(virtio_p9fs_write_test) {
+    using namespace cartesi;
+    const auto root_path = std::filesystem::temp_directory_path() / ("cartesi-test-p9fs-" + std::to_string(getpid()));
+    std::filesystem::remove_all(root_path);
+    std::filesystem::create_directory(root_path);
+    {
+        std::ofstream file(root_path / "file", std::ios::binary);
+        file << "hello";
+    }
+    {
+        virtio_p9fs_device device(0, "vfs0", root_path.string());
+        test_virtio_driver driver(device);
+        p9_test_request(driver, p9_test_message(P9_TVERSION, 0xffff).put<uint32_t>(P9_MAX_MSIZE).put_string("9P2000.L"),
+            P9_RVERSION);
+        p9_test_request(driver,
+            p9_test_message(P9_TATTACH, 1)
+                .put<uint32_t>(0)
+                .put<uint32_t>(~0U)
+                .put_string("")
+                .put_string("")
+                .put<uint32_t>(0),
+            P9_RATTACH);
+        // Fid 1 is opened for I/O, fid 2 only refers to the path, so its attributes go through the cache
+        for (const uint32_t fid : {1, 2}) {
+            const auto reply = p9_test_request(driver,
+                p9_test_message(P9_TWALK, 1).put<uint32_t>(0).put<uint32_t>(fid).put<uint16_t>(1).put_string("file"),
+                P9_RWALK);
+            BOOST_CHECK_EQUAL(p9_test_reply_field<uint16_t>(reply, P9_OUT_MSG_OFFSET), 1);
+        }
+        p9_test_request(driver, p9_test_message(P9_TLOPEN, 1).put<uint32_t>(1).put<uint32_t>(P9_O_RDWR), P9_RLOPEN);
+        BOOST_CHECK_EQUAL(p9_test_getattr_size(driver, 2), 5);
+
+        // Writes are replied with Rwrite carrying the number of bytes written
+        const std::string data = "world";
+        p9_test_message write_msg(P9_TWRITE, 1);
+        write_msg.put<uint32_t>(1).put<uint64_t>(5).put<uint32_t>(data.size());
+        for (const char c : data) {
+            write_msg.put(c);
+        }
+        const auto reply = p9_test_request(driver, write_msg, P9_RWRITE);
+        BOOST_CHECK_EQUAL(reply.size(), P9_OUT_MSG_OFFSET + sizeof(uint32_t));
+        BOOST_CHECK_EQUAL(p9_test_reply_field<uint32_t>(reply, P9_OUT_MSG_OFFSET), data.size());
+        std::ifstream file(root_path / "file", std::ios::binary);
+        const std::string contents{std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>()};
+        BOOST_CHECK_EQUAL(contents, "helloworld");
+
+        // Reads are replied with Rread carrying the number of bytes read, followed by the data
+        const auto read_reply = p9_test_request(driver,
+            p9_test_message(P9_TREAD, 1).put<uint32_t>(1).put<uint64_t>(2).put<uint32_t>(64), P9_RREAD);
+        BOOST_REQUIRE_EQUAL(p9_test_reply_field<uint32_t>(read_reply, P9_OUT_MSG_OFFSET), 8);
+        BOOST_CHECK_EQUAL(read_reply.size(), P9_OUT_MSG_OFFSET + sizeof(uint32_t) + 8);
+        const auto *read_data = read_reply.data() + P9_OUT_MSG_OFFSET + sizeof(uint32_t);
+        BOOST_CHECK_EQUAL(std::string(read_data, read_data + 8), "lloworld");
+
+        // The write must drop the cached attributes of the path, so other fids see the new size right away
+        BOOST_CHECK_EQUAL(p9_test_getattr_size(driver, 2), 10);
+
+        // So must a setattr, even when made through another fid
+        p9_test_request(driver,
+            p9_test_message(P9_TSETATTR, 1)
+                .put<uint32_t>(1)
+                .put<uint32_t>(P9_SETATTR_SIZE)
+                .put<uint32_t>(0)
+                .put<uint32_t>(0)
+                .put<uint32_t>(0)
+                .put<uint64_t>(3)
+                .put<uint64_t>(0)
+                .put<uint64_t>(0)
+                .put<uint64_t>(0)
+                .put<uint64_t>(0),
+            P9_RSETATTR);
+        BOOST_CHECK_EQUAL(p9_test_getattr_size(driver, 2), 3);
+        BOOST_CHECK_EQUAL(std::filesystem::file_size(root_path / "file"), 3);
+    }
+    std::filesystem::remove_all(root_path);
+}
+
+namespace {
+
+/// \brief Guest memory layout of the virtio block test requests
+enum blk_test_layout : uint64_t {
+    BLK_TEST_HEADER_ADDR = 0x1000, ///< Request headers, one per descriptor chain head
+    BLK_TEST_STATUS_ADDR = 0x1800, ///< Status bytes, one per descriptor chain head
+    BLK_TEST_DATA_ADDR = 0x2000,   ///< Data buffers
+};
+
+/// \brief Makes a virtio block request available as a header, data and status descriptor chain starting at head
+uint16_t blk_test_make_available(test_virtio_driver &driver, uint16_t head, uint32_t type, uint64_t sector,
+    uint64_t data_addr, uint32_t data_len) {
+    using namespace cartesi;
+    auto &mem = driver.memory();
+    const uint64_t header_addr = BLK_TEST_HEADER_ADDR + head * VIRTIO_BLK_REQ_HEADER_SIZE;
+    mem.poke<uint32_t>(header_addr, type);
+    mem.poke<uint32_t>(header_addr + 4, 0);
+    mem.poke<uint64_t>(header_addr + 8, sector);
+    // Poison the status byte, so a request left without status is caught
+    mem.poke<uint8_t>(BLK_TEST_STATUS_ADDR + head, 0xff);
+    std::vector<test_virtq_buffer> bufs{{header_addr, VIRTIO_BLK_REQ_HEADER_SIZE, false}};
+    if (data_len > 0) {
+        bufs.push_back({data_addr, data_len, type != VIRTIO_BLK_T_OUT});
+    }
+    bufs.push_back({BLK_TEST_STATUS_ADDR + head, 1, true});
+    return driver.make_available(head, bufs);
+}
+
+/// \brief Returns the used ring elements from from_idx to the current used ring index, keyed by chain head
+std::map<uint32_t, uint32_t> blk_test_used_lengths(test_virtio_driver &driver, uint16_t from_idx) {
+    std::map<uint32_t, uint32_t> lens;
+    for (uint16_t idx = from_idx; idx != driver.get_used_idx(); ++idx) {
+        const auto used = driver.get_used(idx);
+        BOOST_CHECK_MESSAGE(lens.emplace(used.id, used.len).second, "chain " << used.id << " used twice");
+    }
+    return lens;
+}
+
+std::vector<unsigned char> blk_test_read_image(const std::filesystem::path &path) {
+    std::ifstream file(path, std::ios::binary);
+    return {std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>()};
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_CASE_NOLINT(virtio_blk_queue_test) {
+    using namespace cartesi;
+    const auto image_path =
+        std::filesystem::temp_directory_path() / ("cartesi-test-blk-" + std::to_string(getpid()) + ".img");
+    // The image is larger than the largest request, so only the request size bound can reject requests beyond it
+    const uint64_t sectors = VIRTIO_BLK_DATA_MAX / VIRTIO_BLK_SECTOR_SIZE + 128;
+    std::vector<unsigned char> image(sectors * VIRTIO_BLK_SECTOR_SIZE);
+    for (size_t i = 0; i < image.size(); ++i) {
+        image[i] = static_cast<unsigned char>(i * 7);
+    }
+    {
+        std::ofstream file(image_path, std::ios::binary);
+        file.write(reinterpret_cast<const char *>(image.data()), // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+            static_cast<std::streamsize>(image.size()));
+    }
+    {
+        virtio_blk device(0, image_path.string(), false);
+        test_virtio_driver driver(device);
+        auto &mem = driver.memory();
+
+        // Writes to consecutive sectors made available together are merged into a single host I/O
+        for (uint16_t i = 0; i < 3; ++i) {
+            const uint64_t data_addr = BLK_TEST_DATA_ADDR + i * VIRTIO_BLK_SECTOR_SIZE;
+            for (uint32_t j = 0; j < VIRTIO_BLK_SECTOR_SIZE; ++j) {
+                mem.poke<uint8_t>(data_addr + j, static_cast<uint8_t>(0xa0 + i));
+            }
+            blk_test_make_available(driver, i * 3, VIRTIO_BLK_T_OUT, 2 + i, data_addr, VIRTIO_BLK_SECTOR_SIZE);
+        }
+        driver.notify();
+        driver.wait_used(3);
+        BOOST_CHECK((blk_test_used_lengths(driver, 0) == std::map<uint32_t, uint32_t>{{0, 1}, {3, 1}, {6, 1}}));
+        for (uint16_t i = 0; i < 3; ++i) {
+            BOOST_CHECK_EQUAL(mem.peek<uint8_t>(BLK_TEST_STATUS_ADDR + i * 3), VIRTIO_BLK_S_OK);
+            std::fill_n(image.begin() + (2 + i) * VIRTIO_BLK_SECTOR_SIZE, VIRTIO_BLK_SECTOR_SIZE,
+                static_cast<unsigned char>(0xa0 + i));
+        }
+        BOOST_CHECK(blk_test_read_image(image_path) == image);
+
+        // Reads, a flush, an id request and an access past the end of the image, made available together
+        const uint64_t read_addr = BLK_TEST_DATA_ADDR;
+        const uint64_t far_read_addr = read_addr + 3 * VIRTIO_BLK_SECTOR_SIZE;
+        const uint64_t id_addr = far_read_addr + VIRTIO_BLK_SECTOR_SIZE;
+        blk_test_make_available(driver, 0, VIRTIO_BLK_T_IN, 2, read_addr, 3 * VIRTIO_BLK_SECTOR_SIZE);
+        blk_test_make_available(driver, 3, VIRTIO_BLK_T_IN, 100, far_read_addr, VIRTIO_BLK_SECTOR_SIZE);
+        blk_test_make_available(driver, 6, VIRTIO_BLK_T_FLUSH, 0, 0, 0);
+        blk_test_make_available(driver, 9, VIRTIO_BLK_T_GET_ID, 0, id_addr, VIRTIO_BLK_ID_BYTES);
+        blk_test_make_available(driver, 12, VIRTIO_BLK_T_IN, sectors - 1, read_addr, 2 * VIRTIO_BLK_SECTOR_SIZE);
+        driver.notify();
+#ifdef HAVE_THREADS
+        // Requests without host I/O are used right away, ahead of the requests still in flight with the workers
+        BOOST_REQUIRE_EQUAL(driver.get_used_idx(), 5U);
+        BOOST_CHECK_EQUAL(driver.get_used(3).id, 9U);
+        BOOST_CHECK_EQUAL(driver.get_used(4).id, 12U);
+#endif
+        driver.wait_used(8);
+        BOOST_CHECK((blk_test_used_lengths(driver, 3) ==
+            std::map<uint32_t, uint32_t>{{0, 3 * VIRTIO_BLK_SECTOR_SIZE + 1}, {3, VIRTIO_BLK_SECTOR_SIZE + 1}, {6, 1},
+                {9, VIRTIO_BLK_ID_BYTES + 1}, {12, 2 * VIRTIO_BLK_SECTOR_SIZE + 1}}));
+        for (const uint16_t head : {0, 3, 6, 9}) {
+            BOOST_CHECK_EQUAL(mem.peek<uint8_t>(BLK_TEST_STATUS_ADDR + head), VIRTIO_BLK_S_OK);
+        }
+        BOOST_CHECK_EQUAL(mem.peek<uint8_t>(BLK_TEST_STATUS_ADDR + 12), VIRTIO_BLK_S_IOERR);
+        for (uint32_t i = 0; i < 3 * VIRTIO_BLK_SECTOR_SIZE; ++i) {
+            BOOST_REQUIRE_EQUAL(mem.peek<uint8_t>(read_addr + i), image[2 * VIRTIO_BLK_SECTOR_SIZE + i]);
+        }
+        for (uint32_t i = 0; i < VIRTIO_BLK_SECTOR_SIZE; ++i) {
+            BOOST_REQUIRE_EQUAL(mem.peek<uint8_t>(far_read_addr + i), image[100 * VIRTIO_BLK_SECTOR_SIZE + i]);
+        }
+        std::string id(VIRTIO_BLK_ID_BYTES, '\0');
+        for (uint32_t i = 0; i < VIRTIO_BLK_ID_BYTES; ++i) {
+            id[i] = static_cast<char>(mem.peek<uint8_t>(id_addr + i));
+        }
+        BOOST_CHECK_EQUAL(id.c_str(), "cartesi-vd0");
+
+        // Requests larger than seg_max segments of size_max bytes are rejected without being allocated
+        blk_test_make_available(driver, 0, VIRTIO_BLK_T_IN, 0, 0x100000000, VIRTIO_BLK_DATA_MAX + 1);
+        blk_test_make_available(driver, 3, VIRTIO_BLK_T_OUT, 0, 0x100000000, VIRTIO_BLK_DATA_MAX + 1);
+        driver.notify();
+        driver.wait_used(10);
+        BOOST_CHECK((blk_test_used_lengths(driver, 8) ==
+            std::map<uint32_t, uint32_t>{{0, VIRTIO_BLK_DATA_MAX + 2}, {3, 1}}));
+        BOOST_CHECK_EQUAL(mem.peek<uint8_t>(BLK_TEST_STATUS_ADDR + 0), VIRTIO_BLK_S_IOERR);
+        BOOST_CHECK_EQUAL(mem.peek<uint8_t>(BLK_TEST_STATUS_ADDR + 3), VIRTIO_BLK_S_IOERR);
+        BOOST_CHECK(blk_test_read_image(image_path) == image);
+    }
+    std::filesystem::remove(image_path);
+}
+
+#if defined(HAVE_SLIRP) || defined(HAVE_TUNTAP)
+
+namespace {
+
+/// \brief Network carrier with several queue pairs, whose packets carry the index of the pair they came from
+class mq_test_carrier final : public cartesi::virtio_net_carrier {
+public:
+    explicit mq_test_carrier(uint32_t queue_pairs) : _pending(queue_pairs, 0) {}
+
+    /// \brief Makes a packet pending on a queue pair
+    void queue_packet(uint32_t queue_pair) {
+        ++_pending[queue_pair];
+    }
+
+    void reset() override {
+        std::fill(_pending.begin(), _pending.end(), 0);
+    }
+
+    uint32_t get_queue_pairs() const override {
+        return static_cast<uint32_t>(_pending.size());
+    }
+
+    void do_prepare_select(cartesi::os_poller * /*poller*/, uint64_t * /*timeout_us*/) override {}
+
+    bool do_poll_selected(int /*select_ret*/, cartesi::os_poller * /*poller*/) override {
+        return std::any_of(_pending.begin(), _pending.end(), [](uint32_t pending) { return pending > 0; });
+    }
+
+    bool write_packet_to_host(cartesi::i_device_state_access * /*a*/, uint32_t /*queue_pair*/, cartesi::virtq & /*vq*/,
+        uint16_t /*desc_idx*/, uint32_t /*read_avail_len*/, uint32_t *pread_len) override {
+        *pread_len = 0;
+        return true;
+    }
+
+    bool read_packet_from_host(cartesi::i_device_state_access *a, uint32_t queue_pair, cartesi::virtq &vq,
+        uint16_t desc_idx, uint32_t /*write_avail_len*/, uint32_t *pwritten_len) override {
+        using namespace cartesi;
+        *pwritten_len = 0;
+        if (_pending[queue_pair] == 0) {
+            return true;
+        }
+        --_pending[queue_pair];
+        const auto tag = static_cast<uint8_t>(queue_pair);
+        if (!vq.write_desc_mem(a, desc_idx, VIRTIO_NET_ETHERNET_FRAME_OFFSET, &tag, sizeof(tag))) {
+            return false;
+        }
+        *pwritten_len = VIRTIO_NET_ETHERNET_FRAME_OFFSET + sizeof(tag);
+        return true;
+    }
+
+private:
+    std::vector<uint32_t> _pending;
+};
+
+} // namespace
+
+BOOST_AUTO_TEST_CASE_NOLINT(virtio_net_mq_vq_pairs_set_test) {
+    using namespace cartesi;
+    constexpr uint32_t queue_pairs = 2;
+    constexpr uint32_t ctrl_queue = 2 * queue_pairs;
+    constexpr uint32_t rx_buffer_length = 0x100;
+    auto carrier_owner = std::make_unique<mq_test_carrier>(queue_pairs);
+    auto &carrier = *carrier_owner;
+    virtio_net device(0, std::move(carrier_owner));
+    BOOST_CHECK_EQUAL(device.get_config()->max_virtqueue_pairs, queue_pairs);
+    test_virtio_driver driver(device, ctrl_queue + 1);
+    auto &mem = driver.memory();
+
+    // Offers one buffer to each receive queue
+    const auto rx_buffer_addr = [](uint32_t queue_idx) { return TEST_VIRTQ_REPLY_ADDR + queue_idx * rx_buffer_length; };
+    const auto offer_rx_buffer = [&](uint32_t queue_idx) {
+        driver.make_available(0, {{rx_buffer_addr(queue_idx), rx_buffer_length, true}}, queue_idx);
+        driver.notify(queue_idx);
+    };
+    for (uint32_t queue_pair = 0; queue_pair < queue_pairs; ++queue_pair) {
+        offer_rx_buffer(2 * queue_pair + VIRTIO_NET_RECEIVEQ);
+    }
+
+    // Sends VIRTIO_NET_CTRL_MQ_VQ_PAIRS_SET through the control queue, and returns its acknowledgement
+    const auto set_queue_pairs = [&](uint16_t pairs) {
+        mem.poke<uint8_t>(TEST_VIRTQ_REQUEST_ADDR, VIRTIO_NET_CTRL_MQ);
+        mem.poke<uint8_t>(TEST_VIRTQ_REQUEST_ADDR + 1, VIRTIO_NET_CTRL_MQ_VQ_PAIRS_SET);
+        mem.poke<uint16_t>(TEST_VIRTQ_REQUEST_ADDR + 2, pairs);
+        mem.poke<uint8_t>(TEST_VIRTQ_REPLY_ADDR - 1, 0xff);
+        const uint16_t avail_idx =
+            driver.make_available(0, {{TEST_VIRTQ_REQUEST_ADDR, 4, false}, {TEST_VIRTQ_REPLY_ADDR - 1, 1, true}},
+                ctrl_queue);
+        driver.notify(ctrl_queue);
+        BOOST_REQUIRE_EQUAL(driver.get_used_idx(ctrl_queue), avail_idx + 1);
+        BOOST_CHECK_EQUAL(driver.get_used(avail_idx, ctrl_queue).len, 1U);
+        return static_cast<int>(mem.peek<uint8_t>(TEST_VIRTQ_REPLY_ADDR - 1));
+    };
+
+    // Receives a packet from each carrier queue pair, and returns the receive queue each one was delivered to
+    const auto get_queue_mapping = [&]() {
+        std::vector<uint32_t> mapping;
+        for (uint32_t queue_pair = 0; queue_pair < queue_pairs; ++queue_pair) {
+            std::vector<uint16_t> used_before;
+            for (uint32_t queue_idx = 0; queue_idx < ctrl_queue; ++queue_idx) {
+                used_before.push_back(driver.get_used_idx(queue_idx));
+            }
+            carrier.queue_packet(queue_pair);
+            BOOST_REQUIRE(device.poll_nowait(&mem));
+            for (uint32_t queue_idx = 0; queue_idx < ctrl_queue; ++queue_idx) {
+                if (driver.get_used_idx(queue_idx) != used_before[queue_idx]) {
+                    BOOST_CHECK_EQUAL(queue_idx % 2, VIRTIO_NET_RECEIVEQ);
+                    BOOST_CHECK_EQUAL(driver.get_used_idx(queue_idx), used_before[queue_idx] + 1);
+                    BOOST_CHECK_EQUAL(mem.peek<uint8_t>(rx_buffer_addr(queue_idx) + VIRTIO_NET_ETHERNET_FRAME_OFFSET),
+                        queue_pair);
+                    mapping.push_back(queue_idx);
+                    offer_rx_buffer(queue_idx);
+                }
+            }
+        }
+        return mapping;
+    };
+
+    // Until the driver enables more pairs, packets from all carrier pairs go to the first receive queue
+    BOOST_CHECK((get_queue_mapping() == std::vector<uint32_t>{0, 0}));
+    BOOST_CHECK_EQUAL(set_queue_pairs(2), VIRTIO_NET_OK);
+    BOOST_CHECK((get_queue_mapping() == std::vector<uint32_t>{0, 2}));
+    // Zero pairs, or more than max_virtqueue_pairs, are rejected and leave the mapping alone
+    BOOST_CHECK_EQUAL(set_queue_pairs(0), VIRTIO_NET_ERR);
+    BOOST_CHECK((get_queue_mapping() == std::vector<uint32_t>{0, 2}));
+    BOOST_CHECK_EQUAL(set_queue_pairs(queue_pairs + 1), VIRTIO_NET_ERR);
+    BOOST_CHECK((get_queue_mapping() == std::vector<uint32_t>{0, 2}));
+    BOOST_CHECK_EQUAL(set_queue_pairs(1), VIRTIO_NET_OK);
+    BOOST_CHECK((get_queue_mapping() == std::vector<uint32_t>{0, 0}));
+}
+
+#endif // defined(HAVE_SLIRP) || defined(HAVE_TUNTAP)
+
+#endif // HAVE_POSIX_FS
+
+#ifdef HAVE_SLIRP
+
+namespace {
+
+/// \brief Queues a host packet in the slirp carrier the way slirp does, tagging it with a sequence number
+ssize_t slirp_test_send_packet(cartesi::virtio_net_carrier_slirp &carrier, uint32_t seq, size_t len = 64) {
+    std::vector<unsigned char> frame(len, 0xab);
+    memcpy(frame.data(), &seq, sizeof(seq));
+    return carrier.slirp_cbs.send_packet(frame.data(), frame.size(), &carrier);
+}
+
+/// \brief Writes the next host packet queued in the slirp carrier to a guest buffer, returning its sequence number
+uint32_t slirp_test_read_packet(cartesi::virtio_net_carrier_slirp &carrier, flat_device_state_access &a,
+    uint32_t write_avail_len = cartesi::VIRTIO_NET_ETHERNET_FRAME_OFFSET + cartesi::VIRTIO_NET_ETHERNET_MAX_LENGTH) {
+    using namespace cartesi;
+    constexpr uint64_t buf_addr = 0x1000;
+    virtq vq{};
+    vq.desc_addr = TEST_VIRTQ_DESC_ADDR;
+    vq.num = TEST_VIRTQ_NUM;
+    a.poke(TEST_VIRTQ_DESC_ADDR, virtq_desc{buf_addr, write_avail_len, VIRTQ_DESC_F_WRITE, 0});
+    uint32_t written_len = 0;
+    BOOST_REQUIRE(carrier.read_packet_from_host(&a, 0, vq, 0, write_avail_len, &written_len));
+    if (written_len == 0) {
+        return UINT32_MAX;
+    }
+    BOOST_CHECK_EQUAL(written_len, VIRTIO_NET_ETHERNET_FRAME_OFFSET + 64);
+    return a.peek<uint32_t>(buf_addr + VIRTIO_NET_ETHERNET_FRAME_OFFSET);
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_CASE_NOLINT(virtio_net_slirp_packet_ring_test) {
+    using namespace cartesi;
+    flat_device_state_access a(0x2000);
+    virtio_net_carrier_slirp carrier(virtio_net_user_config{});
+    BOOST_CHECK_EQUAL(slirp_test_read_packet(carrier, a), UINT32_MAX);
+
+    // Fill the ring, any further packet is dropped until the guest takes some
+    uint32_t next_send = 0;
+    for (; next_send < SLIRP_MAX_PENDING_PACKETS; ++next_send) {
+        BOOST_REQUIRE_EQUAL(slirp_test_send_packet(carrier, next_send), 64);
+    }
+    BOOST_CHECK(carrier.send_packets.full());
+    BOOST_CHECK_EQUAL(slirp_test_send_packet(carrier, UINT32_MAX), 0);
+    BOOST_CHECK_EQUAL(slirp_test_send_packet(carrier, UINT32_MAX, VIRTIO_NET_ETHERNET_MAX_LENGTH + 1), 0);
+
+    // Packets come out in order while the ring wraps around several times
+    uint32_t next_read = 0;
+    for (int round = 0; round < 3; ++round) {
+        for (int i = 0; i < SLIRP_MAX_PENDING_PACKETS / 3; ++i) {
+            BOOST_REQUIRE_EQUAL(slirp_test_read_packet(carrier, a), next_read++);
+        }
+        BOOST_CHECK(!carrier.send_packets.full());
+        while (!carrier.send_packets.full()) {
+            BOOST_REQUIRE_EQUAL(slirp_test_send_packet(carrier, next_send++), 64);
+        }
+        BOOST_CHECK_EQUAL(slirp_test_send_packet(carrier, UINT32_MAX), 0);
+    }
+
+    // A packet that does not fit the guest buffer is dropped without stalling the ones after it
+    BOOST_CHECK_EQUAL(slirp_test_read_packet(carrier, a, VIRTIO_NET_ETHERNET_FRAME_OFFSET + 32), UINT32_MAX);
+    ++next_read;
+    while (next_read != next_send) {
+        BOOST_REQUIRE_EQUAL(slirp_test_read_packet(carrier, a), next_read++);
+    }
+    BOOST_CHECK(carrier.send_packets.empty());
+    BOOST_CHECK_EQUAL(slirp_test_read_packet(carrier, a), UINT32_MAX);
+}
+
+#endif // HAVE_SLIRP
+
+BOOST_AUTO_TEST_CASE_NOLINT(spsc_ring_wrap_test) {
+    cartesi::spsc_ring<int> ring(3);
+    BOOST_CHECK(ring.empty());
+    BOOST_CHECK(!ring.full());
+    BOOST_CHECK(ring.front() == nullptr);
+    // Fill the ring and drain it partially, several times, so its indices wrap around the slots
+    int pushed = 0;
+    int popped = 0;
+    for (int round = 0; round < 5; ++round) {
+        while (int *slot = ring.back()) {
+            *slot = pushed++;
+            ring.push();
+        }
+        BOOST_CHECK(ring.full());
+        BOOST_CHECK(!ring.empty());
+        BOOST_CHECK_EQUAL(pushed - popped, 3);
+        for (int i = 0; i < 2; ++i) {
+            const int *elem = ring.front();
+            BOOST_REQUIRE(elem != nullptr);
+            BOOST_CHECK_EQUAL(*elem, popped++);
+            ring.pop();
+        }
+        BOOST_CHECK(!ring.full());
+    }
+    while (const int *elem = ring.front()) {
+        BOOST_CHECK_EQUAL(*elem, popped++);
+        ring.pop();
+    }
+    BOOST_CHECK_EQUAL(popped, pushed);
+    BOOST_CHECK(ring.empty());
+    BOOST_CHECK(ring.back() != nullptr);
+}
+
+BOOST_AUTO_TEST_CASE_NOLINT(spsc_ring_threads_test) {
+    constexpr uint64_t count = 200000;
+    cartesi::spsc_ring<uint64_t> ring(8);
+    std::thread producer([&ring] {
+        for (uint64_t i = 0; i < count; ++i) {
+            uint64_t *slot = nullptr;
+            while ((slot = ring.back()) == nullptr) {
+                std::this_thread::yield();
+            }
+            *slot = i;
+            ring.push();
+        }
+    });
+    // Elements come out in order, whether the consumer finds the ring empty or full
+    uint64_t popped = 0;
+    bool in_order = true;
+    while (popped < count) {
+        const uint64_t *elem = ring.front();
+        if (elem == nullptr) {
+            std::this_thread::yield();
+            continue;
+        }
+        in_order = in_order && *elem == popped;
+        ring.pop();
+        ++popped;
+    }
+    producer.join();
+    BOOST_CHECK(in_order);
+    BOOST_CHECK(ring.empty());
+}
+
+#ifdef HAVE_POSIX_FS
+
+namespace {
+
+/// \brief Pipe closed on destruction
+struct test_pipe {
+    std::array<int, 2> fds{-1, -1};
+    test_pipe() {
+        BOOST_REQUIRE_EQUAL(pipe(fds.data()), 0);
+    }
+    ~test_pipe() {
+        close_ends();
+    }
+    test_pipe(const test_pipe &other) = delete;
+    test_pipe(test_pipe &&other) = delete;
+    test_pipe &operator=(const test_pipe &other) = delete;
+    test_pipe &operator=(test_pipe &&other) = delete;
+    void close_ends() {
+        for (int &fd : fds) {
+            if (fd >= 0) {
+                close(fd);
+                fd = -1;
+            }
+        }
+    }
+    void write_byte() const {
+        const char c = 'x';
+        BOOST_REQUIRE_EQUAL(write(fds[1], &c, 1), 1);
+    }
+};
+
+/// \brief Polls without waiting for the read end of pipes, and returns the number of ready file descriptors
+int test_poll_readable(cartesi::os_poller &poller, const std::vector<int> &fds) {
+    uint64_t timeout_us = 0;
+    int ready = -1;
+    poller.poll(
+        [&fds](cartesi::os_poller *p, uint64_t * /*timeout_us*/) {
+            for (const int fd : fds) {
+                p->watch(fd, cartesi::OS_POLL_IN);
+            }
+        },
+        [&ready](int poll_ret, cartesi::os_poller * /*p*/) {
+            ready = poll_ret;
+            return true;
+        },
+        &timeout_us);
+    return ready;
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_CASE_NOLINT(os_poller_closed_fd_test) {
+    using namespace cartesi;
+    for (const auto backend : {os_poll_backend::select, os_poll_backend::epoll}) {
+#ifndef HAVE_EPOLL
+        if (backend == os_poll_backend::epoll) {
+            continue;
+        }
+#endif
+        os_poller poller{backend};
+        test_pipe closed;
+        test_pipe open;
+        open.write_byte();
+        const int closed_fd = closed.fds[0];
+        BOOST_CHECK_EQUAL(test_poll_readable(poller, {closed_fd, open.fds[0]}), 1);
+        // Closing a watched file descriptor without unwatching it must not break polling for the others
+        closed.close_ends();
+        BOOST_CHECK_EQUAL(test_poll_readable(poller, {closed_fd, open.fds[0]}), 1);
+        BOOST_CHECK_EQUAL(poller.get_ready(open.fds[0]), OS_POLL_IN);
+        BOOST_CHECK_EQUAL(poller.get_ready(closed_fd), 0U);
+    }
+}
+
+#ifdef HAVE_EPOLL
+BOOST_AUTO_TEST_CASE_NOLINT(os_poller_fork_test) {
+    using namespace cartesi;
+    os_poller poller{os_poll_backend::epoll};
+    test_pipe parent_pipe;
+    test_pipe child_pipe;
+    BOOST_CHECK_EQUAL(test_poll_readable(poller, {parent_pipe.fds[0], child_pipe.fds[0]}), 0);
+    const pid_t pid = fork();
+    BOOST_REQUIRE(pid >= 0);
+    if (pid == 0) {
+        // Stop watching the parent pipe, and check the child can still poll its own pipe
+        child_pipe.write_byte();
+        const int ready = test_poll_readable(poller, {child_pipe.fds[0]});
+        _exit(ready == 1 && poller.get_ready(child_pipe.fds[0]) == OS_POLL_IN ? 0 : 1);
+    }
+    int status = 0;
+    BOOST_REQUIRE_EQUAL(waitpid(pid, &status, 0), pid);
+    BOOST_REQUIRE(WIFEXITED(status));
+    BOOST_CHECK_EQUAL(WEXITSTATUS(status), 0);
+    // The child must not have dropped the parent pipe from the epoll instance of the parent
+    parent_pipe.write_byte();
+    BOOST_CHECK_EQUAL(test_poll_readable(poller, {parent_pipe.fds[0]}), 1);
+    BOOST_CHECK_EQUAL(poller.get_ready(parent_pipe.fds[0]), OS_POLL_IN);
+}
+#endif // HAVE_EPOLL
+
+#endif // HAVE_POSIX_FS
+
 BOOST_AUTO_TEST_CASE_NOLINT(uarch_solidity_compatibility_layer) {
     using namespace cartesi;
     BOOST_CHECK_EQUAL(UINT16_MAX, 65535);
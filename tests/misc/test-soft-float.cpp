@@ -0,0 +1,314 @@
+// Copyright Cartesi and individual authors (see AUTHORS)
+// SPDX-License-Identifier: LGPL-3.0-or-later
+//
+// This program is free software: you can redistribute it and/or modify it under
+// the terms of the GNU Lesser General Public License as published by the Free
+// Software Foundation, either version 3 of the License, or (at your option) any
+// later version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+// PARTICULAR PURPOSE. See the GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License along
+// with this program (see COPYING). If not, see <https://www.gnu.org/licenses/>.
+//
+
+/// \file
+/// \brief Differential test of the soft-float host FPU fast path against the software implementation
+/// \details Operations only use the host FPU when the inexact flag is already set. Running each operation with the
+/// flag clear and then set therefore compares the software implementation against the fast path, which must produce
+/// the same result and the same flags. The comparison is repeated with the host FPU rounding upward and flushing
+/// subnormals to zero, where the fast path must not be used.
+
+#include <algorithm>
+#include <array>
+#include <cfenv>
+#include <cinttypes>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+#include <soft-float.h>
+
+using namespace cartesi;
+
+namespace {
+
+/// \brief Checks if string matches prefix and captures remaninder
+/// \param pre Prefix to match in str.
+/// \param str Input string
+/// \param val If string matches prefix, points to remaninder
+/// \returns True if string matches prefix, false otherwise
+bool stringval(const char *pre, const char *str, const char **val) {
+    const size_t len = strlen(pre);
+    if (strncmp(pre, str, len) == 0) {
+        *val = str + len;
+        return true;
+    }
+    return false;
+}
+
+/// \brief Tallies the comparisons of one operation
+struct tally {
+    uint64_t total = 0;    ///< Number of comparisons
+    uint64_t fast = 0;     ///< Number of comparisons the host FPU could have computed
+    uint64_t failures = 0; ///< Number of mismatches
+};
+
+/// \brief Operations under test for a given float type
+template <typename SF>
+struct ops {
+    using F_UINT = typename SF::F_UINT;
+    using args_type = std::array<F_UINT, 3>;
+    using op_type = F_UINT (*)(const args_type &, uint32_t *);
+
+    struct op {
+        const char *name;
+        int arity;
+        op_type f;
+    };
+
+    static constexpr std::array<op, 6> all{{
+        {"add", 2, [](const args_type &x, uint32_t *pf) { return SF::add(x[0], x[1], FRM_RNE, pf); }},
+        {"sub", 2, [](const args_type &x, uint32_t *pf) { return SF::add(x[0], x[1] ^ SF::SIGN_MASK, FRM_RNE, pf); }},
+        {"mul", 2, [](const args_type &x, uint32_t *pf) { return SF::mul(x[0], x[1], FRM_RNE, pf); }},
+        {"div", 2, [](const args_type &x, uint32_t *pf) { return SF::div(x[0], x[1], FRM_RNE, pf); }},
+        {"sqrt", 1, [](const args_type &x, uint32_t *pf) { return SF::sqrt(x[0], FRM_RNE, pf); }},
+        {"fma", 3, [](const args_type &x, uint32_t *pf) { return SF::fma(x[0], x[1], x[2], FRM_RNE, pf); }},
+    }};
+
+    /// \brief Compares the software implementation and the fast path on one set of operands
+    static void check(const char *type, const op &o, const args_type &x, tally &t) {
+        uint32_t soft_fflags = 0;
+        const F_UINT soft = o.f(x, &soft_fflags);
+        uint32_t fast_fflags = FFLAGS_NX_MASK;
+        const F_UINT fast = o.f(x, &fast_fflags);
+        ++t.total;
+#ifdef SOFT_FLOAT_HOST_FPU
+        t.fast += SF::host_result_is_exact(soft);
+#endif
+        if (fast != soft || fast_fflags != (soft_fflags | FFLAGS_NX_MASK)) {
+            if (t.failures++ < 10) {
+                (void) fprintf(stderr,
+                    "%s.%s(%#" PRIx64 ", %#" PRIx64 ", %#" PRIx64 "): soft %#" PRIx64 " fflags %#x, fast %#" PRIx64
+                    " fflags %#x\n",
+                    type, o.name, static_cast<uint64_t>(x[0]), static_cast<uint64_t>(x[1]),
+                    static_cast<uint64_t>(x[2]), static_cast<uint64_t>(soft),
+                    static_cast<uint32_t>(soft_fflags | FFLAGS_NX_MASK), static_cast<uint64_t>(fast), fast_fflags);
+            }
+        }
+    }
+
+    /// \brief Returns values at and around the boundaries of the float format
+    static std::vector<F_UINT> edges() {
+        const F_UINT one = static_cast<F_UINT>(SF::EXP_MASK / 2) << SF::MANT_SIZE;
+        const F_UINT min_normal = static_cast<F_UINT>(1) << SF::MANT_SIZE;
+        const F_UINT inf = static_cast<F_UINT>(SF::EXP_MASK) << SF::MANT_SIZE;
+        const F_UINT half_exp = static_cast<F_UINT>(SF::EXP_MASK / 4) << SF::MANT_SIZE;
+        const std::array<F_UINT, 19> magnitudes{
+            0,                                // zero
+            1,                                // smallest subnormal
+            SF::MANT_MASK,                    // largest subnormal
+            min_normal,                       // smallest normal
+            min_normal + 1,                   // right after smallest normal
+            2 * min_normal,                   // twice the smallest normal
+            half_exp,                         // about the square root of the smallest normal
+            one - half_exp,                   // about the reciprocal of the square root of the largest finite
+            one - 1,                          // right before one
+            one,                              // one
+            one + 1,                          // right after one
+            one + (static_cast<F_UINT>(1) << (SF::MANT_SIZE - 1)), // one and a half
+            one + half_exp,                                         // about the square root of the largest finite
+            inf - (static_cast<F_UINT>(2) << SF::MANT_SIZE),        // a quarter of the largest finite range
+            inf - min_normal,                                       // smallest number in the largest binade
+            inf - 1,                                                // largest finite
+            inf,                                                    // infinity
+            SF::F_QNAN,                                             // quiet NaN
+            inf | 1,                                                // signaling NaN
+        };
+        std::vector<F_UINT> values;
+        for (const F_UINT m : magnitudes) {
+            values.push_back(m);
+            values.push_back(m | SF::SIGN_MASK);
+        }
+        return values;
+    }
+
+    /// \brief Returns a random value, biased towards exponents and operands that stress the boundaries
+    static F_UINT random_value(std::mt19937_64 &gen, F_UINT other) {
+        const F_UINT bits = static_cast<F_UINT>(gen());
+        switch (gen() % 4) {
+            case 0: // Any bit pattern
+                return bits;
+            case 1: // Few significant bits, so results are often exact
+                return bits & ~((static_cast<F_UINT>(1) << (SF::MANT_SIZE - 4)) - 1);
+            case 2: // Close to the other operand, so additions cancel
+                return other ^ SF::SIGN_MASK ^ (bits & 0xff);
+            default: { // Exponent that makes products and quotients land near the ends of the range
+                const auto bias = static_cast<int64_t>(SF::EXP_MASK / 2);
+                const auto other_exp = static_cast<int64_t>((other >> SF::MANT_SIZE) & SF::EXP_MASK);
+                const int64_t target = (gen() & 1) != 0 ? 1 : static_cast<int64_t>(SF::EXP_MASK) - 1;
+                const int64_t delta = static_cast<int64_t>(gen() % 5) - 2;
+                const int64_t exp = std::clamp<int64_t>(target - other_exp + bias + delta, 0,
+                    static_cast<int64_t>(SF::EXP_MASK));
+                return (bits & (SF::SIGN_MASK | SF::MANT_MASK)) | (static_cast<F_UINT>(exp) << SF::MANT_SIZE);
+            }
+        }
+    }
+
+    /// \brief Runs all comparisons for this float type
+    static uint64_t run(const char *type, uint64_t random_count, uint64_t seed) {
+        uint64_t failures = 0;
+        // With the inexact flag clear, operations must still detect inexact results, or they are no reference
+        const F_UINT one = static_cast<F_UINT>(SF::EXP_MASK / 2) << SF::MANT_SIZE;
+        uint32_t ref_fflags = 0;
+        const F_UINT three = SF::add(one, SF::add(one, one, FRM_RNE, &ref_fflags), FRM_RNE, &ref_fflags);
+        (void) SF::div(one, three, FRM_RNE, &ref_fflags);
+        if (ref_fflags != FFLAGS_NX_MASK) {
+            (void) fprintf(stderr, "%s.div(1, 3): expected fflags %#x, got %#x\n", type,
+                static_cast<uint32_t>(FFLAGS_NX_MASK), ref_fflags);
+            ++failures;
+        }
+        const auto values = edges();
+        std::mt19937_64 gen{seed};
+        for (const auto &o : all) {
+            tally t;
+            // Every combination of boundary values
+            const size_t n = values.size();
+            const size_t n1 = o.arity > 1 ? n : 1;
+            const size_t n2 = o.arity > 2 ? n : 1;
+            for (size_t i = 0; i < n; ++i) {
+                for (size_t j = 0; j < n1; ++j) {
+                    for (size_t k = 0; k < n2; ++k) {
+                        check(type, o, {values[i], values[j], values[k]}, t);
+                    }
+                }
+            }
+            // Random operands
+            for (uint64_t r = 0; r < random_count; ++r) {
+                args_type x{};
+                x[0] = random_value(gen, static_cast<F_UINT>(gen()));
+                x[1] = random_value(gen, x[0]);
+                uint32_t fflags = 0;
+                x[2] = random_value(gen, SF::mul(x[0], x[1], FRM_RNE, &fflags));
+                check(type, o, x, t);
+            }
+            (void) fprintf(stderr, "%s.%s: %" PRIu64 " cases, %" PRIu64 " eligible for the host FPU, %" PRIu64
+                " failures\n", type, o.name, t.total, t.fast, t.failures);
+            failures += t.failures;
+        }
+        return failures;
+    }
+};
+
+/// \brief Compares sqrt on every single-precision operand
+uint64_t run_exhaustive_sqrt32() {
+    using ops32 = ops<i_sfloat32>;
+    const auto &o = ops32::all[4];
+    tally t;
+    uint32_t a = 0;
+    do {
+        ops32::check("f32", o, {a, 0, 0}, t);
+    } while (++a != 0);
+    (void) fprintf(stderr, "f32.sqrt exhaustive: %" PRIu64 " cases, %" PRIu64 " eligible for the host FPU, %" PRIu64
+        " failures\n", t.total, t.fast, t.failures);
+    return t.failures;
+}
+
+/// \brief Enables or disables flushing subnormal operands and results to zero on the host FPU, as -ffast-math does
+void set_host_flush_to_zero(bool enabled) {
+#if defined(__x86_64__)
+    // MXCSR FTZ (bit 15) and DAZ (bit 6)
+    constexpr uint32_t MXCSR_FTZ_DAZ = 0x8040;
+    const uint32_t mxcsr = __builtin_ia32_stmxcsr();
+    __builtin_ia32_ldmxcsr(enabled ? (mxcsr | MXCSR_FTZ_DAZ) : (mxcsr & ~MXCSR_FTZ_DAZ));
+#elif defined(__aarch64__)
+    // FPCR FZ (bit 24)
+    constexpr uint64_t FPCR_FZ = UINT64_C(1) << 24;
+    uint64_t fpcr = 0;
+    __asm__ volatile("mrs %0, fpcr" : "=r"(fpcr));
+    fpcr = enabled ? (fpcr | FPCR_FZ) : (fpcr & ~FPCR_FZ);
+    __asm__ volatile("msr fpcr, %0" : : "r"(fpcr));
+#else
+    (void) enabled;
+#endif
+}
+
+/// \brief Compares all operations on both float types
+uint64_t run_all(const char *type32, const char *type64, uint64_t random_count, uint64_t seed) {
+    return ops<i_sfloat32>::run(type32, random_count, seed) + ops<i_sfloat64>::run(type64, random_count, seed);
+}
+
+void help(const char *name) {
+    (void) fprintf(stderr, R"(Usage:
+
+  %s [options]
+
+where options are:
+
+  --random=<n>
+    number of random operands per operation (default: 1000000)
+
+  --seed=<n>
+    seed for the random operands (default: 0)
+
+  --exhaustive
+    also compare single-precision sqrt on every operand
+
+)",
+        name);
+    exit(0);
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) try {
+    uint64_t random_count = 1000000;
+    uint64_t seed = 0;
+    bool exhaustive = false;
+    for (int i = 1; i < argc; i++) {
+        const char *val = nullptr;
+        if (stringval("--random=", argv[i], &val)) {
+            random_count = strtoull(val, nullptr, 0);
+        } else if (stringval("--seed=", argv[i], &val)) {
+            seed = strtoull(val, nullptr, 0);
+        } else if (strcmp(argv[i], "--exhaustive") == 0) {
+            exhaustive = true;
+        } else if (strcmp(argv[i], "--help") == 0) {
+            help(argv[0]);
+        } else {
+            (void) fprintf(stderr, "invalid option '%s'\n", argv[i]);
+            exit(1);
+        }
+    }
+#ifndef SOFT_FLOAT_HOST_FPU
+    (void) fprintf(stderr, "the host FPU fast path is not available on this host\n");
+#endif
+    uint64_t failures = run_all("f32", "f64", random_count, seed);
+    if (exhaustive) {
+        failures += run_exhaustive_sqrt32();
+    }
+    // The fast path must notice when the host FPU is not in its default environment
+    if (fesetround(FE_UPWARD) != 0) {
+        throw std::runtime_error("unable to change the host rounding mode");
+    }
+    failures += run_all("f32/upward", "f64/upward", random_count, seed);
+    (void) fesetround(FE_TONEAREST);
+    set_host_flush_to_zero(true);
+    failures += run_all("f32/ftz-daz", "f64/ftz-daz", random_count, seed);
+    set_host_flush_to_zero(false);
+    if (failures != 0) {
+        (void) fprintf(stderr, "%" PRIu64 " failures\n", failures);
+        return 1;
+    }
+    return 0;
+} catch (std::exception &x) {
+    (void) fprintf(stderr, "Caught exception: %s\n", x.what());
+    return 1;
+}
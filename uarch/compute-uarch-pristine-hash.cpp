@@ -17,6 +17,8 @@
 #include <cstring>
 #include <iomanip>
 #include <iostream>
+#include <string>
+#include <vector>
 
 #include <machine-merkle-tree.h>
 #include <shadow-uarch-state.h>
@@ -26,6 +28,8 @@
 
 /// \file
 /// \brief This program computes the hash of the pristine uarch state ad writes it to stdout
+/// \details With --subtree-hashes, it writes the hashes of all nodes in the pristine uarch state subtree instead,
+/// so resetting the uarch can swap them into the machine Merkle tree without hashing the uarch RAM
 
 using namespace cartesi;
 
@@ -47,21 +51,41 @@ Computes the hash of the pristine uarch state.
 
 Options:
 
+  --subtree-hashes
+  Prints the hashes of all nodes in the pristine uarch state subtree, in heap order.
+
   --help
   Prints this message and returns.
 )";
     exit(0);
 }
 
+/// \brief Prints a byte array as C source
+static void print_array(const std::string &name, const unsigned char *data, size_t length) {
+    std::cout << "unsigned char " << name << "[] = {\n  ";
+    for (size_t i = 0; i < length; ++i) {
+        if (i > 0 && i % 12 == 0) {
+            std::cout << ",\n  ";
+        } else if (i > 0) {
+            std::cout << ", ";
+        }
+        std::cout << "0x" << std::setw(2) << std::setfill('0') << std::hex << static_cast<int>(data[i]);
+    }
+    std::cout << "\n};\nunsigned int " << name << "_len = " << std::dec << length << ";" << std::endl;
+}
+
 int main(int argc, char *argv[]) try {
     tree_type tree{};
     hashertype hasher{};
     hash_type hash{};
+    bool subtree_hashes = false;
 
     // Process command line arguments
     for (int i = 1; i < argc; ++i) {
         if (strcmp(argv[i], "--help") == 0) {
             help(argv[0]);
+        } else if (strcmp(argv[i], "--subtree-hashes") == 0) {
+            subtree_hashes = true;
         } else {
             std::cerr << "unrecognized option '" << argv[i] << "'\n";
             exit(1);
@@ -110,26 +134,26 @@ int main(int argc, char *argv[]) try {
     if (!tree.end_update(hasher)) {
         throw std::runtime_error("end_update merkle tree failed");
     }
-    proof_type proof = tree.get_proof(UARCH_STATE_START_ADDRESS, UARCH_STATE_LOG2_SIZE, nullptr);
-    auto &uarch_state_hash = proof.get_target_hash();
 
     // Print header
     std::cout << "// This file is auto-generated and should not be modified" << std::endl;
 
-    // Print hash
-    std::cout << "unsigned char uarch_pristine_hash[] = {\n  ";
-    int i = 0;
-    for (auto c : uarch_state_hash) {
-        if (i > 0 && i % 12 == 0) {
-            std::cout << ",\n  ";
-        } else if (i > 0) {
-            std::cout << ", ";
+    if (subtree_hashes) {
+        // Print hashes of all nodes in uarch state subtree, entry 0 included so they keep their heap indices
+        const auto hashes = tree.get_subtree_hashes(UARCH_STATE_START_ADDRESS, UARCH_STATE_LOG2_SIZE);
+        std::vector<unsigned char> data;
+        data.reserve(hashes.size() * sizeof(hash_type));
+        for (const auto &h : hashes) {
+            data.insert(data.end(), h.begin(), h.end());
         }
-        std::cout << "0x" << std::setw(2) << std::setfill('0') << std::hex << static_cast<int>(c);
-        i++;
+        print_array("uarch_pristine_subtree_hashes", data.data(), data.size());
+        return 0;
     }
-    std::cout << "\n};\nunsigned int uarch_pristine_hash_len = " << std::dec << uarch_state_hash.size() << ";"
-              << std::endl;
+
+    // Print hash
+    proof_type proof = tree.get_proof(UARCH_STATE_START_ADDRESS, UARCH_STATE_LOG2_SIZE, nullptr);
+    auto &uarch_state_hash = proof.get_target_hash();
+    print_array("uarch_pristine_hash", uarch_state_hash.data(), uarch_state_hash.size());
 
     return 0;
 } catch (std::exception &e) {
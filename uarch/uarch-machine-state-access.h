@@ -762,10 +762,88 @@ private:
         do_flush_tlb_type<TLB_WRITE>();
     }
 
+    bool do_read_page_walk_cache(uint64_t satp, uint64_t vaddr, uint64_t &table_addr) {
+        (void) satp;
+        (void) vaddr;
+        (void) table_addr;
+        // The page-walk cache only exists in the host interpreter
+        return false;
+    }
+
+    void do_write_page_walk_cache(uint64_t satp, uint64_t vaddr, int count, const uint64_t *pte_addr,
+        const uint64_t *pte, uint64_t table_addr) {
+        (void) satp;
+        (void) vaddr;
+        (void) count;
+        (void) pte_addr;
+        (void) pte;
+        (void) table_addr;
+    }
+
+    bool do_read_superpage_walk_cache(uint64_t satp, uint64_t vaddr, uint64_t access, uint64_t &paddr) {
+        (void) satp;
+        (void) vaddr;
+        (void) access;
+        (void) paddr;
+        return false;
+    }
+
+    void do_write_superpage_walk_cache(uint64_t satp, uint64_t vaddr, uint64_t access, int count,
+        const uint64_t *pte_addr, const uint64_t *pte, uint64_t ppn, uint64_t vaddr_mask) {
+        (void) satp;
+        (void) vaddr;
+        (void) access;
+        (void) count;
+        (void) pte_addr;
+        (void) pte;
+        (void) ppn;
+        (void) vaddr_mask;
+    }
+
+    void do_flush_page_walk_cache() {}
+
     bool do_get_soft_yield() {
         // Soft yield is meaningless in microarchitecture
         return false;
     }
+
+    bool do_has_break_conditions() {
+        // Break conditions are only monitored by the host interpreter
+        return false;
+    }
+
+    bool do_check_memory_access(uint64_t vaddr, uint64_t paddr, uint64_t length, bool write) {
+        (void) vaddr;
+        (void) paddr;
+        (void) length;
+        (void) write;
+        return false;
+    }
+
+    template <TLB_entry_type ETYPE>
+    void do_check_memory_access_via_tlb(uint64_t vaddr, uint64_t length) {
+        (void) vaddr;
+        (void) length;
+    }
+
+    template <TLB_entry_type ETYPE>
+    void do_set_tlb_entry_watched(uint64_t eidx, bool watched) {
+        (void) eidx;
+        (void) watched;
+    }
+
+    bool do_is_break_condition_reached() {
+        return false;
+    }
+
+    bool do_has_profiler() {
+        // The guest is only profiled by the host interpreter
+        return false;
+    }
+
+    void do_profile_trap(uint64_t cause) {
+        (void) cause;
+    }
 };
 
 } // namespace cartesi